@@ -366,6 +366,20 @@ contains(USE_UPNP, -) {
     win32:LIBS += -liphlpapi
 }
 
+# use: qmake "USE_SECP256K1=1" to sign and verify ECDSA with libsecp256k1
+#  instead of OpenSSL (disabled by default; needs --enable-module-recovery)
+contains(USE_SECP256K1, 1) {
+    message(Building with libsecp256k1 ECDSA)
+    DEFINES += USE_SECP256K1
+    LIBS += -lsecp256k1
+}
+
+# use: qmake "USE_EPOLL=0" to run the socket handler on select() instead of
+#  epoll (Linux only; enabled by default)
+linux:!contains(USE_EPOLL, 0) {
+    DEFINES += USE_EPOLL
+}
+
 # use: qmake "USE_DBUS=1" or qmake "USE_DBUS=0"
 linux:count(USE_DBUS, 0) {
     USE_DBUS=1
@@ -507,6 +521,8 @@ HEADERS += src/qt/bitcoingui.h \
     src/base58.h \
     src/bignum.h \
     src/checkpoints.h \
+    src/checkqueue.h \
+    src/rpcqueue.h \
     src/compat.h \
     src/coincontrol.h \
     src/sync.h \
@@ -525,6 +541,7 @@ HEADERS += src/qt/bitcoingui.h \
     src/ringsig.h \
     src/miner.h \
     src/net.h \
+    src/netpoll.h \
     src/key.h \
     src/db.h \
     src/txdb.h \
@@ -543,6 +560,13 @@ HEADERS += src/qt/bitcoingui.h \
     src/nullsend.h \
     src/zkproof.h \
     src/verifycache.h \
+    src/shieldedpool.h \
+    src/txcache.h \
+    src/blockindexsnapshot.h \
+    src/msm.h \
+    src/tribus.h \
+    src/debuglog.h \
+    src/blockimport.h \
     src/lelantus.h \
     src/curvetree.h \
     src/ipa.h \
@@ -553,6 +577,7 @@ HEADERS += src/qt/bitcoingui.h \
     src/silentpayments.h \
     src/dandelion.h \
     src/finality.h \
+    src/finalityverify.h \
     src/dag.h \
     src/init.h \
     src/bootstrap.h \
@@ -684,6 +709,7 @@ SOURCES += src/qt/bitcoin.cpp src/qt/bitcoingui.cpp \
     src/init.cpp \
     src/bootstrap.cpp \
     src/net.cpp \
+    src/netpoll.cpp \
     src/checkpoints.cpp \
     src/addrman.cpp \
     src/db.cpp \
@@ -760,6 +786,13 @@ SOURCES += src/qt/bitcoin.cpp src/qt/bitcoingui.cpp \
     src/rpcshielded.cpp \
     src/zkproof.cpp \
     src/verifycache.cpp \
+    src/shieldedpool.cpp \
+    src/txcache.cpp \
+    src/blockindexsnapshot.cpp \
+    src/msm.cpp \
+    src/tribus.cpp \
+    src/debuglog.cpp \
+    src/blockimport.cpp \
     src/lelantus.cpp \
     src/curvetree.cpp \
     src/ipa.cpp \
@@ -770,6 +803,7 @@ SOURCES += src/qt/bitcoin.cpp src/qt/bitcoingui.cpp \
     src/silentpayments.cpp \
     src/dandelion.cpp \
     src/finality.cpp \
+    src/finalityverify.cpp \
     src/dag.cpp
 
 #### I n n o v a sources
@@ -0,0 +1,48 @@
+// Time to scan a block file the old way, one block at a time, against the
+// pipelined import, with the time each stage spent.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../test/blockimport_file.h"
+
+BOOST_AUTO_TEST_SUITE(blockimport_bench)
+
+BOOST_AUTO_TEST_CASE(import)
+{
+    CBlockFile blocks;
+    const int nBlocks = 2000;
+    for (int i = 0; i < nBlocks; i++)
+        blocks.Add(MakeBlock(i, 50));
+
+    // The old scan: read, deserialize and hand over one block at a time
+    FILE* file = blocks.Open();
+    int64_t nStart = GetTimeMicros();
+    CAutoFile blkdat(file, SER_DISK, CLIENT_VERSION);
+    int nSerial = 0;
+    for (int i = 0; i < nBlocks; i++)
+    {
+        unsigned char pchMagic[4];
+        unsigned int nSize;
+        CBlock block;
+        blkdat >> FLATDATA(pchMagic) >> nSize >> block;
+        nSerial++;
+    }
+    int64_t nSerialMicros = GetTimeMicros() - nStart;
+    blkdat.fclose();
+
+    unsigned int nThreads = std::max(1U, std::min(boost::thread::hardware_concurrency(), IMPORT_MAX_THREADS));
+    file = blocks.Open();
+    nStart = GetTimeMicros();
+    CBlockImportStats stats;
+    std::vector<uint256> vHash = Import(file, nThreads, &stats);
+    int64_t nPipelineMicros = GetTimeMicros() - nStart;
+    BOOST_CHECK_EQUAL(vHash.size(), (size_t)nSerial);
+
+    BOOST_TEST_MESSAGE(strprintf("block import: %d blocks (%.1fMB), serial %dus, pipelined %dus on %u threads "
+                                 "(read %dus, parse %dus, consumer waited %dus)",
+                                 nBlocks, blocks.ss.size() / 1048576.0, (int)nSerialMicros, (int)nPipelineMicros,
+                                 nThreads, (int)stats.nReadMicros, (int)stats.nParseMicros,
+                                 (int)stats.nNextStallMicros));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
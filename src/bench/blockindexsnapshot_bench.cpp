@@ -0,0 +1,33 @@
+// Time to write and read back a block index snapshot of a 150000 block chain.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../test/blockindexsnapshot_chain.h"
+
+BOOST_AUTO_TEST_SUITE(blockindexsnapshot_bench)
+
+BOOST_AUTO_TEST_CASE(write_read)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path("blockindex-%%%%%%%%.snapshot");
+    SnapshotChain chain(150000, 100000, 40);
+
+    uint256 hashSnapshot;
+    int64_t nStart = GetTimeMillis();
+    BOOST_REQUIRE(WriteBlockIndexSnapshot(path, chain.mapIndex, chain.hashBest, hashSnapshot));
+    int64_t nWrite = GetTimeMillis() - nStart;
+
+    std::vector<std::pair<uint256, CBlockIndex*> > vIndex;
+    nStart = GetTimeMillis();
+    BOOST_REQUIRE(ReadBlockIndexSnapshot(path, hashSnapshot, chain.hashBest, vIndex));
+    int64_t nRead = GetTimeMillis() - nStart;
+    BOOST_CHECK_EQUAL(vIndex.size(), chain.mapIndex.size());
+    BOOST_TEST_MESSAGE(strprintf("block index snapshot: %u entries, %d bytes, write %dms, read %dms",
+                                 (unsigned int)vIndex.size(), (int)boost::filesystem::file_size(path),
+                                 (int)nWrite, (int)nRead));
+
+    FreeIndex(vIndex);
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
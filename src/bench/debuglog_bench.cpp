@@ -0,0 +1,63 @@
+// Time for the logging thread to hand debug.log lines to the writer thread,
+// against writing them unbuffered itself.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../debuglog.h"
+#include "../util.h"
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+
+struct CLogFile
+{
+    boost::filesystem::path path;
+    FILE* file;
+
+    CLogFile()
+    {
+        path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("debuglog-%%%%%%%%.log");
+        file = fopen(path.string().c_str(), "a");
+        setbuf(file, NULL);
+    }
+
+    ~CLogFile()
+    {
+        fclose(file);
+        boost::filesystem::remove(path);
+    }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(debuglog_bench)
+
+BOOST_AUTO_TEST_CASE(append)
+{
+    const int nLines = 20000;
+    std::string strLine = "CTxMemPool::accept() : accepted 0123456789abcdef (poolsz 1234)\n";
+
+    CLogFile logSync;
+    int64_t nStart = GetTimeMicros();
+    for (int i = 0; i < nLines; i++)
+        fwrite(strLine.data(), 1, strLine.size(), logSync.file);
+    int64_t nSync = GetTimeMicros() - nStart;
+
+    CLogFile logAsync;
+    CDebugLogWriter writer;
+    BOOST_REQUIRE(writer.Start(logAsync.file, logAsync.path.string(), false));
+    nStart = GetTimeMicros();
+    for (int i = 0; i < nLines; i++)
+        writer.Append(strLine);
+    int64_t nAppend = GetTimeMicros() - nStart;
+    writer.Stop();
+    CDebugLogStats stats = writer.GetStats();
+
+    BOOST_TEST_MESSAGE(strprintf("debug log: %d lines, unbuffered %dus, queued %dus, %u writes, %u dropped",
+                                 nLines, (int)nSync, (int)nAppend, (unsigned int)stats.nWrites,
+                                 (unsigned int)stats.nDropped));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
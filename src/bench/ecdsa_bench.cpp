@@ -0,0 +1,41 @@
+// ECDSA verifications per second through CPubKey::Verify() and through
+// OpenSSL's CECKey.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../key.h"
+#include "../util.h"
+
+BOOST_AUTO_TEST_SUITE(ecdsa_bench)
+
+BOOST_AUTO_TEST_CASE(verify)
+{
+    const int nSigs = 200;
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+    std::vector<uint256> vHash(nSigs);
+    std::vector<std::vector<unsigned char> > vSigs(nSigs);
+    for (int i = 0; i < nSigs; i++)
+    {
+        vHash[i] = Hash(BEGIN(i), END(i));
+        BOOST_REQUIRE(key.Sign(vHash[i], vSigs[i]));
+    }
+
+    int64_t nStart = GetTimeMicros();
+    for (int i = 0; i < nSigs; i++)
+        BOOST_CHECK(pubkey.Verify(vHash[i], vSigs[i]));
+    int64_t nPubKey = std::max(GetTimeMicros() - nStart, (int64_t)1);
+
+    CECKey eckey;
+    BOOST_REQUIRE(eckey.SetPubKey(pubkey));
+    nStart = GetTimeMicros();
+    for (int i = 0; i < nSigs; i++)
+        BOOST_CHECK(eckey.Verify(vHash[i], vSigs[i]));
+    int64_t nOpenSSL = std::max(GetTimeMicros() - nStart, (int64_t)1);
+
+    BOOST_TEST_MESSAGE(strprintf("ECDSA verify: CPubKey::Verify %d/s, OpenSSL %d/s",
+                                 (int)(nSigs * 1000000LL / nPubKey), (int)(nSigs * 1000000LL / nOpenSSL)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
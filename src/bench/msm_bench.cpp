@@ -0,0 +1,47 @@
+// Multi-scalar multiplication time by size for the naive sum, the bucket
+// method on one and four threads, and a fixed base table.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../test/msm_terms.h"
+
+BOOST_AUTO_TEST_SUITE(msm_bench)
+
+BOOST_AUTO_TEST_CASE(throughput)
+{
+    const size_t vSize[] = { 16, 64, 130, 256, 1024, 4097 };
+    for (unsigned int k = 0; k < sizeof(vSize) / sizeof(vSize[0]); k++)
+    {
+        CMSMTestTerms terms(vSize[k]);
+        EC_POINT* result = EC_POINT_new(terms.group);
+        EC_POINT* naive = EC_POINT_new(terms.group);
+
+        int64_t nStart = GetTimeMicros();
+        BOOST_REQUIRE(terms.Naive(naive));
+        int64_t nNaive = GetTimeMicros() - nStart;
+
+        nStart = GetTimeMicros();
+        BOOST_REQUIRE(MultiScalarMul(terms.group, terms.ctx, terms.vPoint, terms.vScalar, result));
+        int64_t nBucket = GetTimeMicros() - nStart;
+        BOOST_CHECK(EC_POINT_cmp(terms.group, naive, result, terms.ctx) == 0);
+
+        nStart = GetTimeMicros();
+        BOOST_REQUIRE(MultiScalarMul(terms.group, terms.ctx, terms.vPoint, terms.vScalar, result, 4));
+        int64_t nThreaded = GetTimeMicros() - nStart;
+
+        CMSMFixedBase table;
+        BOOST_REQUIRE(table.Init(terms.group, terms.vPoint, terms.ctx));
+        nStart = GetTimeMicros();
+        BOOST_REQUIRE(table.Mul(terms.group, terms.ctx, terms.vScalar, result));
+        int64_t nFixed = GetTimeMicros() - nStart;
+        BOOST_CHECK(EC_POINT_cmp(terms.group, naive, result, terms.ctx) == 0);
+
+        BOOST_TEST_MESSAGE(strprintf("msm n=%5u: naive %7dus, bucket %7dus, 4 threads %7dus, fixed base %7dus (%.0f terms/ms)",
+                                     (unsigned int)vSize[k], (int)nNaive, (int)nBucket, (int)nThreaded, (int)nFixed,
+                                     vSize[k] * 1000.0 / std::max(nBucket, (int64_t)1)));
+        EC_POINT_free(result);
+        EC_POINT_free(naive);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,26 @@
+// CPU time per message for the select() and epoll CSocketPoller backends,
+// with a few hundred loopback connections and a handful active at a time.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../test/netpoll_loopback.h"
+
+BOOST_AUTO_TEST_SUITE(netpoll_bench)
+
+BOOST_AUTO_TEST_CASE(loopback_stress)
+{
+    const int nPeers = 400;
+    const int nRounds = 2000;
+    const int nActive = 4;
+    LoopbackPeers peers(nPeers);
+
+    double dSelect = RunMessages(false, peers, nRounds, nActive);
+    BOOST_TEST_MESSAGE(strprintf("select(): %d peers, %.2f us CPU per message", nPeers, dSelect));
+    if (CSocketPoller::HaveEdgeTriggered())
+    {
+        double dEpoll = RunMessages(true, peers, nRounds, nActive);
+        BOOST_TEST_MESSAGE(strprintf("epoll: %d peers, %.2f us CPU per message", nPeers, dEpoll));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
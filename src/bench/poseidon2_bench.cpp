@@ -0,0 +1,44 @@
+// Poseidon2 permutations per second through the Montgomery-limb
+// Poseidon2Permute and the BIGNUM Poseidon2PermuteReference.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../poseidon2.h"
+#include "../util.h"
+
+BOOST_AUTO_TEST_SUITE(poseidon2_bench)
+
+BOOST_AUTO_TEST_CASE(throughput)
+{
+    BOOST_REQUIRE(CPoseidon2Params::Initialize());
+    CPoseidon2State start;
+    for (int i = 0; i < POSEIDON2_T; i++)
+        start.SetElement(i, GetRandHash());
+    const int nReferencePermutations = 256;
+    const int nPermutations = 16384;
+
+    // Each permutation feeds the next, so neither loop can be skipped
+    CPoseidon2State reference(start);
+    int64_t nStart = GetTimeMicros();
+    for (int n = 0; n < nReferencePermutations; n++)
+        Poseidon2PermuteReference(reference);
+    int64_t nReference = GetTimeMicros() - nStart;
+
+    CPoseidon2State state(start);
+    nStart = GetTimeMicros();
+    for (int n = 0; n < nPermutations; n++)
+    {
+        Poseidon2Permute(state);
+        if (n == nReferencePermutations - 1)
+            for (int i = 0; i < POSEIDON2_T; i++)
+                BOOST_CHECK(state.GetElement(i) == reference.GetElement(i));
+    }
+    int64_t nMontgomery = GetTimeMicros() - nStart;
+
+    double dReferenceRate = nReferencePermutations * 1e6 / std::max(nReference, (int64_t)1);
+    double dMontgomeryRate = nPermutations * 1e6 / std::max(nMontgomery, (int64_t)1);
+    BOOST_TEST_MESSAGE(strprintf("poseidon2: reference %.0f perm/s, montgomery %.0f perm/s (%.1fx)",
+                                 dReferenceRate, dMontgomeryRate, dMontgomeryRate / dReferenceRate));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,52 @@
+// Tribus hashes per second through Tribus() over whole headers and through
+// the midstate search kernel.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../tribus.h"
+#include "../hashblock.h"
+#include "../util.h"
+
+namespace
+{
+
+uint256 ReferenceHash(unsigned char* pHeader, uint32_t nNonce)
+{
+    pHeader[76] = nNonce;
+    pHeader[77] = nNonce >> 8;
+    pHeader[78] = nNonce >> 16;
+    pHeader[79] = nNonce >> 24;
+    return Tribus(pHeader, pHeader + 80);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(tribus_bench)
+
+BOOST_AUTO_TEST_CASE(throughput)
+{
+    unsigned char vchHeader[80];
+    for (int i = 0; i < 80; i++)
+        vchHeader[i] = insecure_rand();
+    const uint32_t nHashes = 4096;
+
+    int64_t nStart = GetTimeMicros();
+    for (uint32_t n = 0; n < nHashes; n++)
+        ReferenceHash(vchHeader, n);
+    int64_t nReference = GetTimeMicros() - nStart;
+
+    CTribusMidstate midstate(vchHeader);
+    uint32_t nFound, nDone;
+    uint256 hashFound;
+    nStart = GetTimeMicros();
+    BOOST_CHECK(!midstate.Scan(0, nHashes, 0, nFound, hashFound, nDone));
+    int64_t nKernel = GetTimeMicros() - nStart;
+    BOOST_CHECK_EQUAL(nDone, nHashes);
+
+    BOOST_TEST_MESSAGE(strprintf("tribus %s: reference %.0f H/s, kernel %.0f H/s",
+                                 TribusKernelName(),
+                                 nHashes * 1e6 / std::max(nReference, (int64_t)1),
+                                 nHashes * 1e6 / std::max(nKernel, (int64_t)1)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
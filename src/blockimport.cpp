@@ -0,0 +1,336 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+unsigned int nImportThreads = 1;
+
+namespace
+{
+
+// Read-ahead a frame holds against IMPORT_MAX_QUEUED_BYTES
+size_t FrameBytes(const CImportedBlock* pframe)
+{
+    return pframe->fBadSize ? 0 : pframe->nSize;
+}
+
+}
+
+CBlockImporter::CBlockImporter(FILE* fileIn, unsigned int nThreads)
+    : file(fileIn), nNextSeq(0), nReadSeq(0), nQueued(0), nQueuedBytes(0), nGeneration(0),
+      nRestartPos(0), fReaderDone(false), fStopping(false), nBufPos(0), nBufLen(0), fEOF(false)
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.nParseThreads = max(1U, min(nThreads, IMPORT_MAX_THREADS));
+    fseek(file, 0, SEEK_SET);
+
+    threads.create_thread(boost::bind(&CBlockImporter::ThreadRead, this));
+    for (unsigned int i = 0; i < stats.nParseThreads; i++)
+        threads.create_thread(boost::bind(&CBlockImporter::ThreadParse, this));
+}
+
+CBlockImporter::~CBlockImporter()
+{
+    Stop();
+}
+
+void CBlockImporter::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStopping = true;
+    }
+    condReader.notify_all();
+    condParse.notify_all();
+    condNext.notify_all();
+    threads.join_all();
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    for (CImportedBlock* pframe : vParse)
+        Release(pframe);
+    vParse.clear();
+    for (auto& item : mapDone)
+        Release(item.second);
+    mapDone.clear();
+}
+
+CBlockImportStats CBlockImporter::GetStats() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return stats;
+}
+
+void CBlockImporter::Release(CImportedBlock* pframe)
+{
+    nQueued--;
+    nQueuedBytes -= FrameBytes(pframe);
+    delete pframe;
+    condReader.notify_one();
+}
+
+// Make the bytes from nPos on available at pch, reading more of the file when
+// fewer than nWant are buffered. Returns how many are buffered, which is less
+// than nWant only at end of file.
+size_t CBlockImporter::Fill(uint64_t nPos, size_t nWant, const char*& pch)
+{
+    if (nPos < nBufPos || nPos > nBufPos + nBufLen)
+    {
+        nBufPos = nPos;
+        nBufLen = 0;
+        fEOF = false;
+        fseek(file, nPos, SEEK_SET);
+    }
+    size_t nOffset = nPos - nBufPos;
+    while (nBufLen - nOffset < nWant && !fEOF)
+    {
+        // Keep only the unread tail, then read at least IMPORT_READ_BYTES
+        // behind it in one call
+        if (nOffset > 0)
+        {
+            memmove(vBuf.data(), vBuf.data() + nOffset, nBufLen - nOffset);
+            nBufPos += nOffset;
+            nBufLen -= nOffset;
+            nOffset = 0;
+        }
+        size_t nRoom = max(nWant - nBufLen, IMPORT_READ_BYTES);
+        if (vBuf.size() < nBufLen + nRoom)
+            vBuf.resize(nBufLen + nRoom);
+
+        int64_t nStart = GetTimeMicros();
+        size_t nRead = fread(vBuf.data() + nBufLen, 1, nRoom, file);
+        int64_t nElapsed = GetTimeMicros() - nStart;
+        if (nRead < nRoom)
+            fEOF = true;
+        nBufLen += nRead;
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        stats.nBytesRead += nRead;
+        stats.nReadMicros += nElapsed;
+    }
+    pch = vBuf.data() + nOffset;
+    return nBufLen - nOffset;
+}
+
+// Queue a frame for parsing, waiting for room. False, with the frame freed,
+// if the import stopped or restarted in the meantime.
+bool CBlockImporter::Push(CImportedBlock* pframe, int nReaderGeneration)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    int64_t nStart = GetTimeMicros();
+    while (!fStopping && nGeneration == nReaderGeneration &&
+           (nQueued >= IMPORT_MAX_QUEUED_BLOCKS ||
+            (nQueued > 0 && nQueuedBytes + FrameBytes(pframe) > IMPORT_MAX_QUEUED_BYTES)))
+        condReader.wait(lock);
+    stats.nReadStallMicros += GetTimeMicros() - nStart;
+    if (fStopping || nGeneration != nReaderGeneration)
+    {
+        delete pframe;
+        return false;
+    }
+
+    pframe->nSeq = nReadSeq++;
+    pframe->nGeneration = nGeneration;
+    nQueued++;
+    nQueuedBytes += FrameBytes(pframe);
+    stats.nFrames++;
+    if (pframe->fBadSize)
+    {
+        // Nothing to parse
+        mapDone[pframe->nSeq] = pframe;
+        condNext.notify_one();
+    }
+    else
+    {
+        vParse.push_back(pframe);
+        condParse.notify_one();
+    }
+    return true;
+}
+
+void CBlockImporter::ThreadRead()
+{
+    RenameThread("innova-impread");
+
+    int nReaderGeneration = 0;
+    uint64_t nPos = 0;
+    while (true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fStopping)
+                return;
+            if (nGeneration != nReaderGeneration)
+            {
+                nReaderGeneration = nGeneration;
+                nPos = nRestartPos;
+            }
+        }
+
+        // Find the next magic
+        const char* pch;
+        size_t nAvail = Fill(nPos, sizeof(pchMessageStart), pch);
+        if (nAvail < sizeof(pchMessageStart))
+        {
+            // End of file: wait for a restart or the end of the import
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (nGeneration == nReaderGeneration)
+            {
+                fReaderDone = true;
+                condNext.notify_all();
+            }
+            while (!fStopping && nGeneration == nReaderGeneration)
+                condReader.wait(lock);
+            continue;
+        }
+        const char* pchEnd = pch + nAvail + 1 - sizeof(pchMessageStart);
+        const char* pchFound = NULL;
+        for (const char* p = pch; p < pchEnd; p++)
+        {
+            p = (const char*)memchr(p, pchMessageStart[0], pchEnd - p);
+            if (!p)
+                break;
+            if (memcmp(p, pchMessageStart, sizeof(pchMessageStart)) == 0)
+            {
+                pchFound = p;
+                break;
+            }
+        }
+        if (!pchFound)
+        {
+            nPos += pchEnd - pch;
+            continue;
+        }
+        nPos += (pchFound - pch) + sizeof(pchMessageStart);
+
+        CImportedBlock* pframe = new CImportedBlock();
+        pframe->nPos = nPos;
+        nAvail = Fill(nPos, sizeof(pframe->nSize), pch);
+        if (nAvail >= sizeof(pframe->nSize))
+        {
+            memcpy(&pframe->nSize, pch, sizeof(pframe->nSize));
+            if (pframe->nSize == 0 || pframe->nSize > ADAPTIVE_BLOCK_CEILING)
+            {
+                // Skip the field and look for the next magic
+                pframe->fBadSize = true;
+                nPos += sizeof(pframe->nSize);
+            }
+            else
+            {
+                nAvail = Fill(nPos + sizeof(pframe->nSize), pframe->nSize, pch);
+                pframe->vch.assign(pch, pch + min(nAvail, (size_t)pframe->nSize));
+                nPos += sizeof(pframe->nSize) + pframe->nSize;
+            }
+        }
+        else
+        {
+            // Size field cut short by the end of the file; the empty frame
+            // fails to parse like the old scan's read did
+            pframe->nSize = nAvail;
+            nPos += nAvail;
+        }
+        Push(pframe, nReaderGeneration);
+    }
+}
+
+void CBlockImporter::ThreadParse()
+{
+    RenameThread("innova-impparse");
+
+    while (true)
+    {
+        CImportedBlock* pframe;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fStopping && vParse.empty())
+                condParse.wait(lock);
+            if (fStopping)
+                return;
+            pframe = vParse.front();
+            vParse.pop_front();
+        }
+
+        // Hash the header and every transaction here, so the validator
+        // finds them memoized
+        int64_t nStart = GetTimeMicros();
+        try
+        {
+            CDataStream ss(pframe->vch, SER_DISK, CLIENT_VERSION);
+            ss >> pframe->block;
+            pframe->block.GetHash();
+            for (const CTransaction& tx : pframe->block.vtx)
+                tx.GetHash();
+            pframe->fParsed = true;
+        }
+        catch (std::exception& e)
+        {
+            pframe->strError = e.what();
+        }
+        vector<char>().swap(pframe->vch);
+        int64_t nElapsed = GetTimeMicros() - nStart;
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        stats.nParseMicros += nElapsed;
+        if (pframe->fParsed)
+            stats.nParsed++;
+        if (fStopping || pframe->nGeneration != nGeneration)
+        {
+            Release(pframe);
+            continue;
+        }
+        mapDone[pframe->nSeq] = pframe;
+        if (pframe->nSeq == nNextSeq)
+            condNext.notify_one();
+    }
+}
+
+unique_ptr<CImportedBlock> CBlockImporter::Next()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    int64_t nStart = GetTimeMicros();
+    CImportedBlock* pframe = NULL;
+    while (!fStopping)
+    {
+        map<uint64_t, CImportedBlock*>::iterator it = mapDone.find(nNextSeq);
+        if (it != mapDone.end())
+        {
+            pframe = it->second;
+            mapDone.erase(it);
+            nNextSeq++;
+            nQueued--;
+            nQueuedBytes -= FrameBytes(pframe);
+            condReader.notify_one();
+            break;
+        }
+        if (fReaderDone && nReadSeq == nNextSeq)
+            break;
+        condNext.wait(lock);
+    }
+    stats.nNextStallMicros += GetTimeMicros() - nStart;
+
+    if (pframe && !pframe->fParsed && !pframe->fBadSize)
+    {
+        // Everything read after a frame that did not deserialize was framed
+        // from the wrong offset: start over just past its size field
+        nGeneration++;
+        nRestartPos = pframe->nPos + sizeof(pframe->nSize);
+        nReadSeq = nNextSeq;
+        fReaderDone = false;
+        for (CImportedBlock* p : vParse)
+            Release(p);
+        vParse.clear();
+        for (auto& item : mapDone)
+            Release(item.second);
+        mapDone.clear();
+        stats.nRestarts++;
+        condReader.notify_all();
+    }
+    return unique_ptr<CImportedBlock>(pframe);
+}
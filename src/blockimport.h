@@ -0,0 +1,127 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_BLOCKIMPORT_H
+#define INNOVA_BLOCKIMPORT_H
+
+#include "main.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+/** Maximum number of threads deserializing blocks for an import (-importthreads) */
+static const unsigned int IMPORT_MAX_THREADS = 16;
+/** Bytes the reader asks the file for at a time */
+static const size_t IMPORT_READ_BYTES = 8 * 1024 * 1024;
+/** Blocks read ahead of the one being validated */
+static const unsigned int IMPORT_MAX_QUEUED_BLOCKS = 1024;
+/** Serialized bytes read ahead of the block being validated */
+static const size_t IMPORT_MAX_QUEUED_BYTES = 64 * 1024 * 1024;
+
+/** Threads deserializing blocks for LoadExternalBlockFile */
+extern unsigned int nImportThreads;
+
+/** One frame of a block file: the magic, a size field and the block */
+struct CImportedBlock
+{
+    unsigned int nPos;      // file offset of the size field
+    unsigned int nSize;     // the size field
+    std::vector<char> vch;  // the serialized block, cut short at end of file;
+                            // freed once parsed
+    bool fBadSize;          // size field was zero or over the ceiling
+    bool fParsed;
+    std::string strError;   // why the block did not deserialize
+    CBlock block;
+
+    uint64_t nSeq;
+    int nGeneration;
+
+    CImportedBlock() : nPos(0), nSize(0), fBadSize(false), fParsed(false), nSeq(0), nGeneration(0) {}
+};
+
+struct CBlockImportStats
+{
+    uint64_t nBytesRead;
+    int64_t nReadMicros;        // in fread
+    int64_t nReadStallMicros;   // reader waiting for room in the queue
+    uint64_t nFrames;
+    uint64_t nParsed;
+    int64_t nParseMicros;       // summed over the parse threads
+    unsigned int nParseThreads;
+    int64_t nNextStallMicros;   // consumer waiting for the next block
+    unsigned int nRestarts;     // rescans after a frame failed to deserialize
+};
+
+/** Streams the blocks of a blk*.dat or bootstrap file in file order.
+ *
+ * A reader thread pulls the file in IMPORT_READ_BYTES sequential reads and
+ * cuts it into frames at the network magic. Parse threads deserialize the
+ * frames and compute the Tribus header hash and every transaction hash,
+ * which the blocks memoize. Next() hands the blocks out in the order they
+ * appear in the file, so the caller validates exactly what a single threaded
+ * scan would have, while the next IMPORT_MAX_QUEUED_BLOCKS blocks are read
+ * and parsed behind it.
+ *
+ * Framing matches the old scan: a bad size field is skipped and the search
+ * for the magic resumes after it. A frame that does not deserialize is
+ * handed out failed and the reader starts over from just past its size
+ * field, dropping everything it had read ahead.
+ */
+class CBlockImporter
+{
+public:
+    /** The file is read from its start and is not closed */
+    CBlockImporter(FILE* file, unsigned int nThreads);
+    ~CBlockImporter();
+
+    /** Next frame in file order; NULL at end of file or after Stop() */
+    std::unique_ptr<CImportedBlock> Next();
+    /** Stop and join every thread; Next() returns NULL from here on */
+    void Stop();
+
+    CBlockImportStats GetStats() const;
+
+private:
+    FILE* file;
+    boost::thread_group threads;
+
+    mutable boost::mutex mutex;
+    boost::condition_variable condReader;   // room in the queue, restart or stop
+    boost::condition_variable condParse;    // frames to parse or stop
+    boost::condition_variable condNext;     // a parsed frame or end of file
+    std::deque<CImportedBlock*> vParse;
+    std::map<uint64_t, CImportedBlock*> mapDone;
+    uint64_t nNextSeq;              // next sequence number Next() hands out
+    uint64_t nReadSeq;              // next sequence number the reader assigns
+    unsigned int nQueued;           // frames between the reader and the consumer
+    size_t nQueuedBytes;
+    int nGeneration;                // bumped on every restart
+    unsigned int nRestartPos;
+    bool fReaderDone;               // end of file for the current generation
+    bool fStopping;
+
+    CBlockImportStats stats;
+
+    // Reader state, only touched by the reader thread
+    std::vector<char> vBuf;
+    uint64_t nBufPos;               // file offset of vBuf[0]
+    size_t nBufLen;
+    bool fEOF;
+
+    size_t Fill(uint64_t nPos, size_t nWant, const char*& pch);
+    bool Push(CImportedBlock* pframe, int nReaderGeneration);
+    void ThreadRead();
+    void ThreadParse();
+    void Release(CImportedBlock* pframe);
+
+    CBlockImporter(const CBlockImporter&);
+    CBlockImporter& operator=(const CBlockImporter&);
+};
+
+#endif
@@ -0,0 +1,327 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockindexsnapshot.h"
+#include "util.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include <boost/thread.hpp>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const unsigned int BLOCK_INDEX_SNAPSHOT_MAGIC = 0x58444942; // "BIDX"
+static const int BLOCK_INDEX_SNAPSHOT_FORMAT = 1;
+// Records per checksummed chunk; also the unit of work for the decode threads
+static const unsigned int BLOCK_INDEX_SNAPSHOT_CHUNK = 65536;
+// Magic, format, client version, best chain, record count, chunk size
+static const unsigned int BLOCK_INDEX_SNAPSHOT_FIXED_HEADER = 4 + 4 + 4 + 32 + 8 + 4;
+static const unsigned int BLOCK_INDEX_SNAPSHOT_MAX_THREADS = 8;
+
+static size_t SnapshotHeaderSize(uint64_t nRecords)
+{
+    uint64_t nChunks = (nRecords + BLOCK_INDEX_SNAPSHOT_CHUNK - 1) / BLOCK_INDEX_SNAPSHOT_CHUNK;
+    return BLOCK_INDEX_SNAPSHOT_FIXED_HEADER + (nChunks + 1) * 32;
+}
+
+template<typename Stream>
+static void WriteRecord(Stream& s, const uint256& hash, int nPrev, int nNext, const CBlockIndex& index)
+{
+    s << hash << nPrev << nNext;
+    s << index.nFile << index.nBlockPos << index.nChainTrust << index.nHeight;
+    s << index.nMint << index.nMoneySupply << index.nFlags;
+    s << index.nStakeModifier << index.nStakeModifierChecksum;
+    s << index.prevoutStake << index.nStakeTime << index.hashProof;
+    s << index.nVersion << index.hashMerkleRoot << index.nTime << index.nBits << index.nNonce;
+}
+
+template<typename Stream>
+static void ReadRecord(Stream& s, uint256& hash, int& nPrev, int& nNext, CBlockIndex& index)
+{
+    s >> hash >> nPrev >> nNext;
+    s >> index.nFile >> index.nBlockPos >> index.nChainTrust >> index.nHeight;
+    s >> index.nMint >> index.nMoneySupply >> index.nFlags;
+    s >> index.nStakeModifier >> index.nStakeModifierChecksum;
+    s >> index.prevoutStake >> index.nStakeTime >> index.hashProof;
+    s >> index.nVersion >> index.hashMerkleRoot >> index.nTime >> index.nBits >> index.nNonce;
+}
+
+static bool SortByHeight(const pair<uint256, CBlockIndex*>& a, const pair<uint256, CBlockIndex*>& b)
+{
+    if (a.second->nHeight != b.second->nHeight)
+        return a.second->nHeight < b.second->nHeight;
+    return a.first < b.first;
+}
+
+bool WriteBlockIndexSnapshot(const boost::filesystem::path& path,
+                             const map<uint256, CBlockIndex*>& mapIndex,
+                             const uint256& hashBestChain, uint256& hashSnapshotRet)
+{
+    vector<pair<uint256, CBlockIndex*> > vIndex(mapIndex.begin(), mapIndex.end());
+    sort(vIndex.begin(), vIndex.end(), SortByHeight);
+    unordered_map<const CBlockIndex*, int> mapRecord;
+    mapRecord.reserve(vIndex.size());
+    for (unsigned int i = 0; i < vIndex.size(); i++)
+        mapRecord[vIndex[i].second] = i;
+
+    boost::filesystem::path pathTmp(path.string() + ".new");
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
+    if (!file)
+        return error("WriteBlockIndexSnapshot() : can't open %s", pathTmp.string().c_str());
+
+    // The header is rewritten once the chunk hashes are known
+    size_t nHeaderSize = SnapshotHeaderSize(vIndex.size());
+    vector<char> vchZero(nHeaderSize, 0);
+    bool fOk = fwrite(&vchZero[0], 1, nHeaderSize, file) == nHeaderSize;
+
+    vector<uint256> vChunkHash;
+    for (unsigned int nStart = 0; fOk && nStart < vIndex.size(); nStart += BLOCK_INDEX_SNAPSHOT_CHUNK)
+    {
+        unsigned int nEnd = min((unsigned int)vIndex.size(), nStart + BLOCK_INDEX_SNAPSHOT_CHUNK);
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss.reserve((nEnd - nStart) * BLOCK_INDEX_SNAPSHOT_RECORD_SIZE);
+        for (unsigned int i = nStart; i < nEnd; i++)
+        {
+            const CBlockIndex* pindex = vIndex[i].second;
+            int nPrev = -1, nNext = -1;
+            if (pindex->pprev)
+            {
+                unordered_map<const CBlockIndex*, int>::const_iterator it = mapRecord.find(pindex->pprev);
+                if (it == mapRecord.end())
+                    fOk = false;
+                else
+                    nPrev = it->second;
+            }
+            if (pindex->pnext)
+            {
+                unordered_map<const CBlockIndex*, int>::const_iterator it = mapRecord.find(pindex->pnext);
+                if (it == mapRecord.end())
+                    fOk = false;
+                else
+                    nNext = it->second;
+            }
+            WriteRecord(ss, vIndex[i].first, nPrev, nNext, *pindex);
+        }
+        if (!fOk)
+        {
+            error("WriteBlockIndexSnapshot() : block index links outside the index");
+            break;
+        }
+        assert(ss.size() == (nEnd - nStart) * BLOCK_INDEX_SNAPSHOT_RECORD_SIZE);
+        vChunkHash.push_back(Hash(ss.begin(), ss.end()));
+        fOk = fwrite(&ss[0], 1, ss.size(), file) == ss.size();
+    }
+
+    if (fOk)
+    {
+        CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+        ssHeader << BLOCK_INDEX_SNAPSHOT_MAGIC << BLOCK_INDEX_SNAPSHOT_FORMAT << CLIENT_VERSION;
+        ssHeader << hashBestChain << (uint64_t)vIndex.size() << BLOCK_INDEX_SNAPSHOT_CHUNK;
+        for (unsigned int i = 0; i < vChunkHash.size(); i++)
+            ssHeader << vChunkHash[i];
+        hashSnapshotRet = Hash(ssHeader.begin(), ssHeader.end());
+        ssHeader << hashSnapshotRet;
+        assert(ssHeader.size() == nHeaderSize);
+        fOk = fseek(file, 0, SEEK_SET) == 0 &&
+              fwrite(&ssHeader[0], 1, ssHeader.size(), file) == ssHeader.size() &&
+              fflush(file) == 0;
+    }
+    if (fOk)
+        FileCommit(file);
+    fclose(file);
+
+    if (!fOk || !RenameOver(pathTmp, path))
+    {
+        boost::filesystem::remove(pathTmp);
+        return error("WriteBlockIndexSnapshot() : writing %s failed", path.string().c_str());
+    }
+    return true;
+}
+
+namespace
+{
+
+// Read-only view of a whole file, mapped where the platform allows it
+class CSnapshotFile
+{
+public:
+    const char* pBegin;
+    size_t nSize;
+
+    CSnapshotFile() : pBegin(NULL), nSize(0), pMap(NULL) {}
+
+    bool Open(const boost::filesystem::path& path)
+    {
+#ifndef WIN32
+        int fd = open(path.string().c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                pMap = p;
+                pBegin = (const char*)p;
+                nSize = st.st_size;
+            }
+        }
+        close(fd);
+        return pMap != NULL;
+#else
+        FILE* file = fopen(path.string().c_str(), "rb");
+        if (!file)
+            return false;
+        char buf[65536];
+        size_t nRead;
+        while ((nRead = fread(buf, 1, sizeof(buf), file)) > 0)
+            vch.insert(vch.end(), buf, buf + nRead);
+        fclose(file);
+        pBegin = vch.empty() ? NULL : &vch[0];
+        nSize = vch.size();
+        return nSize > 0;
+#endif
+    }
+
+    ~CSnapshotFile()
+    {
+#ifndef WIN32
+        if (pMap)
+            munmap(pMap, nSize);
+#endif
+    }
+
+private:
+    CSnapshotFile(const CSnapshotFile&);
+    void operator=(const CSnapshotFile&);
+
+    void* pMap;
+    std::vector<char> vch;
+};
+
+struct CSnapshotDecoder
+{
+    const char* pRecords;
+    uint64_t nRecords;
+    const vector<uint256>* pvChunkHash;
+    vector<pair<uint256, CBlockIndex*> >* pvIndex;
+    vector<char>* pvChunkOk;
+
+    void DecodeChunk(unsigned int nChunk)
+    {
+        vector<pair<uint256, CBlockIndex*> >& vIndex = *pvIndex;
+        uint64_t nStart = (uint64_t)nChunk * BLOCK_INDEX_SNAPSHOT_CHUNK;
+        uint64_t nEnd = min(nRecords, nStart + BLOCK_INDEX_SNAPSHOT_CHUNK);
+        const char* pChunk = pRecords + nStart * BLOCK_INDEX_SNAPSHOT_RECORD_SIZE;
+        const char* pChunkEnd = pRecords + nEnd * BLOCK_INDEX_SNAPSHOT_RECORD_SIZE;
+        if (Hash(pChunk, pChunkEnd) != (*pvChunkHash)[nChunk])
+            return;
+
+        try
+        {
+            CDataStream ss(pChunk, pChunkEnd, SER_DISK, CLIENT_VERSION);
+            for (uint64_t i = nStart; i < nEnd; i++)
+            {
+                int nPrev, nNext;
+                ReadRecord(ss, vIndex[i].first, nPrev, nNext, *vIndex[i].second);
+                if (nPrev < -1 || nPrev >= (int64_t)nRecords || nNext < -1 || nNext >= (int64_t)nRecords)
+                    return;
+                vIndex[i].second->pprev = nPrev < 0 ? NULL : vIndex[nPrev].second;
+                vIndex[i].second->pnext = nNext < 0 ? NULL : vIndex[nNext].second;
+            }
+        }
+        catch (std::exception& e)
+        {
+            return;
+        }
+        (*pvChunkOk)[nChunk] = 1;
+    }
+
+    void Run(unsigned int nThread, unsigned int nThreads)
+    {
+        for (unsigned int nChunk = nThread; nChunk < pvChunkHash->size(); nChunk += nThreads)
+            DecodeChunk(nChunk);
+    }
+};
+
+}
+
+bool ReadBlockIndexSnapshot(const boost::filesystem::path& path,
+                            const uint256& hashSnapshot, const uint256& hashBestChain,
+                            vector<pair<uint256, CBlockIndex*> >& vIndexRet)
+{
+    vIndexRet.clear();
+    CSnapshotFile file;
+    if (!file.Open(path))
+        return false;
+    if (file.nSize < BLOCK_INDEX_SNAPSHOT_FIXED_HEADER)
+        return error("ReadBlockIndexSnapshot() : %s is truncated", path.string().c_str());
+
+    unsigned int nMagic, nChunkRecords;
+    int nFormat, nClientVersion;
+    uint256 hashBestChainFile;
+    uint64_t nRecords;
+    CDataStream ssFixed(file.pBegin, file.pBegin + BLOCK_INDEX_SNAPSHOT_FIXED_HEADER, SER_DISK, CLIENT_VERSION);
+    ssFixed >> nMagic >> nFormat >> nClientVersion >> hashBestChainFile >> nRecords >> nChunkRecords;
+    if (nMagic != BLOCK_INDEX_SNAPSHOT_MAGIC || nFormat != BLOCK_INDEX_SNAPSHOT_FORMAT ||
+        nChunkRecords != BLOCK_INDEX_SNAPSHOT_CHUNK)
+        return error("ReadBlockIndexSnapshot() : %s has an unknown format", path.string().c_str());
+    if (nClientVersion != CLIENT_VERSION || hashBestChainFile != hashBestChain)
+    {
+        printf("ReadBlockIndexSnapshot() : %s was written by another client version or for another best chain\n", path.string().c_str());
+        return false;
+    }
+    if (nRecords > (file.nSize - BLOCK_INDEX_SNAPSHOT_FIXED_HEADER) / BLOCK_INDEX_SNAPSHOT_RECORD_SIZE ||
+        file.nSize != SnapshotHeaderSize(nRecords) + nRecords * BLOCK_INDEX_SNAPSHOT_RECORD_SIZE)
+        return error("ReadBlockIndexSnapshot() : %s has the wrong size", path.string().c_str());
+
+    size_t nHeaderSize = SnapshotHeaderSize(nRecords);
+    unsigned int nChunks = (nHeaderSize - BLOCK_INDEX_SNAPSHOT_FIXED_HEADER) / 32 - 1;
+    vector<uint256> vChunkHash(nChunks);
+    uint256 hashHeader;
+    CDataStream ssHashes(file.pBegin + BLOCK_INDEX_SNAPSHOT_FIXED_HEADER, file.pBegin + nHeaderSize, SER_DISK, CLIENT_VERSION);
+    for (unsigned int i = 0; i < nChunks; i++)
+        ssHashes >> vChunkHash[i];
+    ssHashes >> hashHeader;
+    if (Hash(file.pBegin, file.pBegin + nHeaderSize - 32) != hashHeader || hashHeader != hashSnapshot)
+        return error("ReadBlockIndexSnapshot() : %s does not match the block database", path.string().c_str());
+
+    vector<pair<uint256, CBlockIndex*> > vIndex(nRecords);
+    for (uint64_t i = 0; i < nRecords; i++)
+        vIndex[i].second = new CBlockIndex();
+
+    vector<char> vChunkOk(nChunks, 0);
+    CSnapshotDecoder decoder;
+    decoder.pRecords = file.pBegin + nHeaderSize;
+    decoder.nRecords = nRecords;
+    decoder.pvChunkHash = &vChunkHash;
+    decoder.pvIndex = &vIndex;
+    decoder.pvChunkOk = &vChunkOk;
+
+    unsigned int nThreads = max(1U, min(min(boost::thread::hardware_concurrency(), BLOCK_INDEX_SNAPSHOT_MAX_THREADS), nChunks));
+    boost::thread_group threads;
+    for (unsigned int i = 1; i < nThreads; i++)
+        threads.create_thread(std::bind(&CSnapshotDecoder::Run, &decoder, i, nThreads));
+    decoder.Run(0, nThreads);
+    threads.join_all();
+
+    if (count(vChunkOk.begin(), vChunkOk.end(), 0) > 0)
+    {
+        for (uint64_t i = 0; i < nRecords; i++)
+            delete vIndex[i].second;
+        return error("ReadBlockIndexSnapshot() : %s is corrupt", path.string().c_str());
+    }
+    vIndexRet.swap(vIndex);
+    return true;
+}
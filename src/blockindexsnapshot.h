@@ -0,0 +1,48 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_BLOCKINDEXSNAPSHOT_H
+#define INNOVA_BLOCKINDEXSNAPSHOT_H
+
+#include "main.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+// Flat-file copy of mapBlockIndex, written at a clean shutdown so the next
+// startup can rebuild the index without walking every LevelDB blockindex
+// record, rehashing headers the record carries no trusted hash for, or
+// recomputing chain trust with bignum arithmetic.
+//
+// The file is a header followed by fixed-size records in height order. Each
+// record holds the block hash, the record numbers of pprev and pnext, and the
+// CBlockIndex fields LoadBlockIndex() would have restored, plus the chain
+// trust and stake modifier checksum it would have computed. Records are hashed
+// in chunks; the header commits to the chunk hashes, the best chain hash and
+// the client version, and the hash of the header is what the caller keeps in
+// LevelDB to tie the file to exactly one database state. Chunks are checked
+// and decoded in parallel.
+//
+// nSize is left out: the LevelDB record doesn't carry it either, and the
+// snapshot must load to the same state the database would.
+
+static const unsigned int BLOCK_INDEX_SNAPSHOT_RECORD_SIZE = 236;
+
+/** Write every entry of mapIndex to path, replacing any existing file. On
+  * success hashSnapshotRet identifies the file for ReadBlockIndexSnapshot(). */
+bool WriteBlockIndexSnapshot(const boost::filesystem::path& path,
+                             const std::map<uint256, CBlockIndex*>& mapIndex,
+                             const uint256& hashBestChain, uint256& hashSnapshotRet);
+
+/** Read a snapshot written by this client version for hashBestChain whose
+  * header hashes to hashSnapshot. On success vIndexRet holds newly allocated
+  * entries with their hashes, in file order, with pprev and pnext linked
+  * among them and phashBlock left for the caller to set. */
+bool ReadBlockIndexSnapshot(const boost::filesystem::path& path,
+                            const uint256& hashSnapshot, const uint256& hashBestChain,
+                            std::vector<std::pair<uint256, CBlockIndex*> >& vIndexRet);
+
+#endif
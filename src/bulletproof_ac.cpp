@@ -9,6 +9,7 @@
 #include "util.h"
 #include "bignum.h"
 #include "kernel.h"
+#include "msm.h"
 
 #include <openssl/ec.h>
 #include <openssl/bn.h>
@@ -386,92 +387,6 @@ static bool AddPointTimesScalar(const EC_GROUP* group,
     return true;
 }
 
-// Pippenger bucket-method multi-scalar multiplication over secp256k1:
-//   result = sum_i scalars[i] * points[i]
-// The returned group element is IDENTICAL to the naive accumulation, so this is a
-// drop-in replacement for the per-point EC_POINT_mul+add loops in the proof
-// verifier (the AC verify's dominant cost). It is validated bit-for-bit against the
-// naive method over random inputs by a differential unit test. Verification-only,
-// not constant time; scalars are reduced mod the group order, points may be the
-// identity. External linkage so the test can reach it.
-bool BPACMultiScalarMul(const EC_GROUP* group, BN_CTX* ctx,
-                        const std::vector<EC_POINT*>& points,
-                        const std::vector<BIGNUM*>& scalars,
-                        EC_POINT* result)
-{
-    if (points.size() != scalars.size())
-        return false;
-    if (EC_POINT_set_to_infinity(group, result) != 1)
-        return false;
-    const size_t n = points.size();
-    if (n == 0)
-        return true;
-
-    // Window size, tuned for n up to ~2n+5 with n<=2048 in the AC verifier.
-    int c;
-    if (n >= 1024)     c = 11;
-    else if (n >= 256) c = 9;
-    else if (n >= 32)  c = 7;
-    else               c = 4;
-
-    CBPACBNGuard order;
-    if (EC_GROUP_get_order(group, order, ctx) != 1)
-        return false;
-    const int nbits = BN_num_bits(order);
-    const int numWindows = (nbits + c - 1) / c;
-    const int numBuckets = (1 << c) - 1;
-
-    bool ok = true;
-    std::vector<EC_POINT*> buckets(numBuckets, (EC_POINT*)NULL);
-    for (int b = 0; b < numBuckets && ok; b++)
-    {
-        buckets[b] = EC_POINT_new(group);
-        ok = (buckets[b] != NULL);
-    }
-    EC_POINT* running = EC_POINT_new(group);
-    EC_POINT* windowSum = EC_POINT_new(group);
-    ok = ok && running && windowSum;
-
-    for (int w = numWindows - 1; w >= 0 && ok; w--)
-    {
-        // result <<= c (skip on the most-significant window)
-        if (w != numWindows - 1)
-            for (int b = 0; b < c && ok; b++)
-                ok = (EC_POINT_dbl(group, result, result, ctx) == 1);
-
-        for (int b = 0; b < numBuckets && ok; b++)
-            ok = (EC_POINT_set_to_infinity(group, buckets[b]) == 1);
-
-        const int base = w * c;
-        for (size_t i = 0; i < n && ok; i++)
-        {
-            int digit = 0;
-            for (int b = 0; b < c; b++)
-                if (BN_is_bit_set(scalars[i], base + b))
-                    digit |= (1 << b);
-            if (digit != 0)
-                ok = (EC_POINT_add(group, buckets[digit - 1], buckets[digit - 1], points[i], ctx) == 1);
-        }
-
-        // windowSum = sum_{d=1..numBuckets} d * buckets[d-1] via the running-sum trick.
-        ok = ok && (EC_POINT_set_to_infinity(group, running) == 1)
-                && (EC_POINT_set_to_infinity(group, windowSum) == 1);
-        for (int d = numBuckets; d >= 1 && ok; d--)
-        {
-            ok = (EC_POINT_add(group, running, running, buckets[d - 1], ctx) == 1)
-              && (EC_POINT_add(group, windowSum, windowSum, running, ctx) == 1);
-        }
-
-        ok = ok && (EC_POINT_add(group, result, result, windowSum, ctx) == 1);
-    }
-
-    for (int b = 0; b < numBuckets; b++)
-        if (buckets[b]) EC_POINT_free(buckets[b]);
-    if (running) EC_POINT_free(running);
-    if (windowSum) EC_POINT_free(windowSum);
-    return ok;
-}
-
 static void AppendIPAScalar(CIPATranscript& transcript, const uint256& scalar)
 {
     std::vector<unsigned char> scalarBytes;
@@ -582,7 +497,7 @@ static bool ComputeBPACIPAStatementPoint(const EC_GROUP* group,
 
     CBPACPointGuard P(group);
 
-    // Evaluate the IPA statement point as ONE Pippenger multiexp over all ~2n+5
+    // Evaluate the IPA statement point as ONE multiexp over all ~2n+5
     // (point, scalar) terms instead of a per-term EC_POINT_mul+add. The result is
     // identical to the naive accumulation (multiscalarmul_matches_naive test):
     //   P = x*AI + x^2*AO + x^3*S - mu*G + tHat*U
@@ -624,7 +539,7 @@ static bool ComputeBPACIPAStatementPoint(const EC_GROUP* group,
     }
 
     if (ok)
-        ok = BPACMultiScalarMul(group, ctx, vPts, vScs, P);
+        ok = MultiScalarMul(group, ctx, vPts, vScs, P, nMSMThreads);
 
     for (size_t i = 0; i < vPts.size(); i++) EC_POINT_free(vPts[i]);
     for (size_t i = 0; i < vScs.size(); i++) BN_free(vScs[i]);
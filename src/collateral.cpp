@@ -122,6 +122,7 @@ void CCollaTeralPool::Reset(){
 void CCollaTeralPool::SetNull(bool clearEverything){
     finalTransaction.vin.clear();
     finalTransaction.vout.clear();
+    finalTransaction.ClearHashCache();
 
     entries.clear();
 
@@ -464,6 +465,7 @@ bool CCollaTeralPool::AddScriptSig(const CTxIn newVin){
             if(newVin.prevout == vin.prevout && vin.nSequence == newVin.nSequence){
                 vin.scriptSig = newVin.scriptSig;
                 vin.prevPubKey = newVin.prevPubKey;
+                finalTransaction.ClearHashCache();
                 if(fDebug) printf("CCollaTeralPool::AddScriptSig -- adding to finalTransaction  %s\n", newVin.scriptSig.ToString().substr(0,24).c_str());
             }
         }
@@ -62,7 +62,7 @@ inline int myclosesocket(SOCKET& hSocket)
 #define closesocket(s)      myclosesocket(s)
 
 bool static inline IsSelectableSocket(SOCKET s) {
-#ifdef WIN32
+#if defined(WIN32) || defined(USE_EPOLL)
     return true;
 #else
     return (s < FD_SETSIZE);
@@ -17,6 +17,7 @@
 #include <openssl/obj_mac.h>
 #include <string.h>
 #include <algorithm>
+#include <map>
 
 class CCTBNCtxGuard
 {
@@ -477,6 +478,95 @@ int CCurveTree::GetTreeDepth(uint64_t nLeaves)
     return nDepth;
 }
 
+void CCurveTreeLevel::Append(const unsigned char* pch, size_t nLen)
+{
+    size_t nOffset = vchSlab.size();
+    vchSlab.resize(nOffset + nPointSize);
+    if (nLen == nPointSize)
+        memcpy(&vchSlab[nOffset], pch, nLen);
+    else
+    {
+        memset(&vchSlab[nOffset], 0, nPointSize);
+        mapOdd[nSize].assign(pch, pch + nLen);
+    }
+    nSize++;
+}
+
+void CCurveTreeLevel::Resize(uint64_t n)
+{
+    if (n < nSize)
+    {
+        vchSlab.resize(n * nPointSize);
+        mapOdd.erase(mapOdd.lower_bound(n), mapOdd.end());
+        nSize = n;
+    }
+    while (nSize < n)
+        Append(NULL, 0);
+}
+
+void CCurveTreeLevel::Set(uint64_t i, const unsigned char* pch, size_t nLen)
+{
+    if (nLen == nPointSize)
+    {
+        memcpy(&vchSlab[i * nPointSize], pch, nLen);
+        if (!mapOdd.empty())
+            mapOdd.erase(i);
+    }
+    else
+    {
+        memset(&vchSlab[i * nPointSize], 0, nPointSize);
+        mapOdd[i].assign(pch, pch + nLen);
+    }
+}
+
+size_t CCurveTreeLevel::GetMemoryUsage() const
+{
+    size_t nUsage = vchSlab.capacity();
+    for (std::map<uint64_t, std::vector<unsigned char> >::const_iterator it = mapOdd.begin(); it != mapOdd.end(); ++it)
+        nUsage += 64 + it->second.capacity();
+    return nUsage;
+}
+
+
+unsigned int CCurveTree::GetSerializeSize(int nType, int nVersion) const
+{
+    uint64_t nSize = sizeof(nLeafCount) + GetSizeOfCompactSize(vLevels.size());
+    for (unsigned int d = 0; d < vLevels.size(); d++)
+    {
+        const CCurveTreeLevel& level = vLevels[d];
+        nSize += GetSizeOfCompactSize(level.nSize);
+        nSize += level.nSize * (GetSizeOfCompactSize(level.nPointSize) + level.nPointSize + sizeof(int) + sizeof(uint64_t));
+        for (std::map<uint64_t, std::vector<unsigned char> >::const_iterator it = level.mapOdd.begin(); it != level.mapOdd.end(); ++it)
+            nSize += GetSizeOfCompactSize(it->second.size()) + it->second.size() -
+                     GetSizeOfCompactSize(level.nPointSize) - level.nPointSize;
+    }
+    return nSize + sizeof(uint32_t);
+}
+
+void CCurveTree::AddLevel()
+{
+    vLevels.push_back(CCurveTreeLevel(vLevels.size()));
+}
+
+CCurveTreeNode CCurveTree::GetNode(int nDepth, uint64_t nIndex) const
+{
+    CCurveTreeNode node;
+    node.nDepth = nDepth;
+    node.nIndex = nIndex;
+    node.UpdateCurveType();
+    if (nDepth < (int)vLevels.size() && nIndex < vLevels[nDepth].nSize)
+        vLevels[nDepth].GetPoint(nIndex, node.vchPoint);
+    return node;
+}
+
+size_t CCurveTree::GetMemoryUsage() const
+{
+    size_t nUsage = vLeafTable.capacity() * sizeof(uint32_t);
+    for (unsigned int d = 0; d < vLevels.size(); d++)
+        nUsage += vLevels[d].GetMemoryUsage();
+    return nUsage;
+}
+
 uint256 CCurveTree::GetRoot() const
 {
     CCurveTreeNode rootNode = GetRootNode();
@@ -495,38 +585,21 @@ CCurveTreeNode CCurveTree::GetRootNode() const
 
     for (int i = (int)vLevels.size() - 1; i >= 0; i--)
     {
-        if (!vLevels[i].empty())
-            return vLevels[i][0];
+        if (vLevels[i].nSize > 0)
+            return GetNode(i, 0);
     }
 
     CCurveTreeNode empty;
     return empty;
 }
 
-CCurveTreeNode HashCurveTreeChildren(int nChildDepth,
-                                      const std::vector<CCurveTreeNode>& vChildren)
+// Map a hash of a node's children onto its curve by try-and-increment.
+static CCurveTreeNode MapChildrenHashToCurve(int nParentDepth, const uint256& hash)
 {
     CCurveTreeNode parent;
-    int nParentDepth = nChildDepth + 1;
     parent.nDepth = nParentDepth;
     parent.curveType = CCurveTreeNode::GetCurveAtDepth(nParentDepth);
 
-    if (vChildren.empty())
-        return parent;
-
-    CHashWriter ss(SER_GETHASH, 0);
-    ss << (uint8_t)0x61;
-    ss << (int32_t)nParentDepth;
-    ss << (uint32_t)vChildren.size();
-
-    for (size_t i = 0; i < vChildren.size(); i++)
-    {
-        for (size_t j = 0; j < vChildren[i].vchPoint.size(); j++)
-            ss << vChildren[i].vchPoint[j];
-    }
-
-    uint256 hash = ss.GetHash();
-
     if (parent.curveType == CURVE_SECP256K1)
     {
         CCTECGroupGuard group;
@@ -590,58 +663,104 @@ CCurveTreeNode HashCurveTreeChildren(int nChildDepth,
     return parent;
 }
 
+CCurveTreeNode HashCurveTreeChildren(int nChildDepth,
+                                      const std::vector<CCurveTreeNode>& vChildren)
+{
+    if (vChildren.empty())
+    {
+        CCurveTreeNode parent;
+        parent.nDepth = nChildDepth + 1;
+        parent.UpdateCurveType();
+        return parent;
+    }
+
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << (uint8_t)0x61;
+    ss << (int32_t)(nChildDepth + 1);
+    ss << (uint32_t)vChildren.size();
+
+    for (size_t i = 0; i < vChildren.size(); i++)
+    {
+        if (!vChildren[i].vchPoint.empty())
+            ss.write((const char*)&vChildren[i].vchPoint[0], vChildren[i].vchPoint.size());
+    }
+
+    return MapChildrenHashToCurve(nChildDepth + 1, ss.GetHash());
+}
+
+// HashCurveTreeChildren() of nodes [nBegin, nEnd) of a level, nBegin < nEnd,
+// hashed in place.
+static CCurveTreeNode HashLevelChildren(const CCurveTreeLevel& level, int nChildDepth,
+                                        uint64_t nBegin, uint64_t nEnd)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << (uint8_t)0x61;
+    ss << (int32_t)(nChildDepth + 1);
+    ss << (uint32_t)(nEnd - nBegin);
+
+    if (level.mapOdd.empty())
+        ss.write((const char*)&level.vchSlab[nBegin * level.nPointSize], (nEnd - nBegin) * level.nPointSize);
+    else
+    {
+        for (uint64_t i = nBegin; i < nEnd; i++)
+        {
+            size_t nLen;
+            const unsigned char* pch = level.GetPoint(i, nLen);
+            if (nLen)
+                ss.write((const char*)pch, nLen);
+        }
+    }
+
+    return MapChildrenHashToCurve(nChildDepth + 1, ss.GetHash());
+}
+
+void CCurveTree::UpdateParent(int nChildDepth, uint64_t nParentIndex)
+{
+    const CCurveTreeLevel& children = vLevels[nChildDepth];
+    uint64_t childStart = nParentIndex * CURVE_TREE_ARITY;
+    uint64_t childEnd = std::min(childStart + CURVE_TREE_ARITY, children.nSize);
+
+    CCurveTreeNode parent;
+    if (childStart < childEnd)
+        parent = HashLevelChildren(children, nChildDepth, childStart, childEnd);
+
+    if (nChildDepth + 1 >= (int)vLevels.size())
+        AddLevel();
+    CCurveTreeLevel& parents = vLevels[nChildDepth + 1];
+    if (nParentIndex >= parents.nSize)
+        parents.Resize(nParentIndex + 1);
+    parents.Set(nParentIndex, parent.vchPoint);
+}
+
 bool CCurveTree::InsertLeaf(const CPedersenCommitment& commitment)
 {
     if (commitment.IsNull())
         return false;
 
-    CCurveTreeNode leaf;
-    leaf.nDepth = 0;
-    leaf.curveType = CURVE_SECP256K1;
-    leaf.vchPoint = commitment.vchCommitment;
-    leaf.nIndex = nLeafCount;
-
     int nNeededDepth = GetTreeDepth(nLeafCount + 1);
     while ((int)vLevels.size() <= nNeededDepth)
-        vLevels.push_back(std::vector<CCurveTreeNode>());
+        AddLevel();
 
-    if (leaf.nIndex < vLevels[0].size())
-        vLevels[0][leaf.nIndex] = leaf;
+    const std::vector<unsigned char>& vch = commitment.vchCommitment;
+    CCurveTreeLevel& leaves = vLevels[0];
+    if (nLeafCount < leaves.nSize)
+        leaves.Set(nLeafCount, vch);
     else
-        vLevels[0].push_back(leaf);
+    {
+        leaves.Resize(nLeafCount);
+        leaves.Append(&vch[0], vch.size());
+    }
 
     uint64_t idx = nLeafCount;
     for (int depth = 0; depth < nNeededDepth; depth++)
     {
-        uint64_t parentIdx = idx / CURVE_TREE_ARITY;
-        uint64_t childStart = parentIdx * CURVE_TREE_ARITY;
-        uint64_t childEnd = std::min(childStart + CURVE_TREE_ARITY,
-                                      (uint64_t)vLevels[depth].size());
-
-        std::vector<CCurveTreeNode> children;
-        for (uint64_t i = childStart; i < childEnd; i++)
-            children.push_back(vLevels[depth][i]);
-
-        CCurveTreeNode parent = HashCurveTreeChildren(depth, children);
-        parent.nIndex = parentIdx;
-
-        int parentLevel = depth + 1;
-        if (parentLevel >= (int)vLevels.size())
-            vLevels.push_back(std::vector<CCurveTreeNode>());
-
-        if (parentIdx < vLevels[parentLevel].size())
-            vLevels[parentLevel][parentIdx] = parent;
-        else
-        {
-            while (vLevels[parentLevel].size() < parentIdx)
-                vLevels[parentLevel].push_back(CCurveTreeNode());
-            vLevels[parentLevel].push_back(parent);
-        }
-
-        idx = parentIdx;
+        idx /= CURVE_TREE_ARITY;
+        UpdateParent(depth, idx);
     }
 
     nLeafCount++;
+    if (!vLeafTable.empty())
+        AddToLeafTable(nLeafCount - 1);
     return true;
 }
 
@@ -649,36 +768,98 @@ bool CCurveTree::RebuildParentNodes()
 {
     if (nLeafCount == 0 || vLevels.empty())
         return false;
+    if (fParentsCurrent)
+        return true;
 
     int nDepth = GetTreeDepth(nLeafCount);
 
     while ((int)vLevels.size() <= nDepth)
-        vLevels.push_back(std::vector<CCurveTreeNode>());
+        AddLevel();
 
     for (int d = 0; d < nDepth; d++)
     {
-        int parentLevel = d + 1;
-        uint64_t nNodes = vLevels[d].size();
-        uint64_t nParents = (nNodes + CURVE_TREE_ARITY - 1) / CURVE_TREE_ARITY;
+        uint64_t nParents = (vLevels[d].nSize + CURVE_TREE_ARITY - 1) / CURVE_TREE_ARITY;
+        vLevels[d + 1].Resize(nParents);
+        for (uint64_t p = 0; p < nParents; p++)
+            UpdateParent(d, p);
+    }
 
-        vLevels[parentLevel].resize(nParents);
+    fParentsCurrent = true;
+    return true;
+}
 
-        for (uint64_t p = 0; p < nParents; p++)
-        {
-            uint64_t childStart = p * CURVE_TREE_ARITY;
-            uint64_t childEnd = std::min(childStart + CURVE_TREE_ARITY, nNodes);
+void CCurveTree::GetBlockDelta(CCurveTreeBlockDelta& deltaOut) const
+{
+    deltaOut = CCurveTreeBlockDelta();
+    deltaOut.nLeafCount = nLeafCount;
+    deltaOut.hashRoot = GetRoot();
+
+    // Appending leaf N rewrites node N / ARITY^d on level d and nothing to
+    // its left, so only the nodes from there on need to be kept.
+    uint64_t nFirst = nLeafCount;
+    for (size_t d = 0; d < vLevels.size(); d++)
+    {
+        deltaOut.vLevelSize.push_back(vLevels[d].nSize);
+        for (uint64_t i = nFirst; i < vLevels[d].nSize; i++)
+            deltaOut.vTail.push_back(GetNode(d, i));
+        nFirst /= CURVE_TREE_ARITY;
+    }
+}
 
-            std::vector<CCurveTreeNode> children;
-            for (uint64_t i = childStart; i < childEnd; i++)
-                children.push_back(vLevels[d][i]);
+bool CCurveTree::RewindToDelta(const CCurveTreeBlockDelta& delta)
+{
+    if (delta.nLeafCount > nLeafCount || delta.vLevelSize.size() > vLevels.size())
+        return false;
 
-            CCurveTreeNode parent = HashCurveTreeChildren(d, children);
-            parent.nIndex = p;
-            vLevels[parentLevel][p] = parent;
-        }
+    uint64_t nFirst = delta.nLeafCount;
+    size_t nTail = 0;
+    for (size_t d = 0; d < delta.vLevelSize.size(); d++)
+    {
+        if (delta.vLevelSize[d] > vLevels[d].nSize)
+            return false;
+        if (delta.vLevelSize[d] > nFirst)
+            nTail += delta.vLevelSize[d] - nFirst;
+        nFirst /= CURVE_TREE_ARITY;
     }
+    if (nTail != delta.vTail.size())
+        return false;
 
-    return true;
+    vLevels.resize(delta.vLevelSize.size());
+    vLeafTable.clear();
+    nFirst = delta.nLeafCount;
+    nTail = 0;
+    for (size_t d = 0; d < vLevels.size(); d++)
+    {
+        vLevels[d].Resize(delta.vLevelSize[d]);
+        for (uint64_t i = nFirst; i < vLevels[d].nSize; i++)
+            vLevels[d].Set(i, delta.vTail[nTail++].vchPoint);
+        nFirst /= CURVE_TREE_ARITY;
+    }
+    nLeafCount = delta.nLeafCount;
+
+    // The kept prefix came from this tree, the tail from the delta. Every
+    // restored interior node must still hash from its children; if this
+    // tree was not the delta's state plus appends, a difference anywhere
+    // in the prefix shows up in some restored ancestor (the root is always
+    // restored). The caller must discard the tree on failure.
+    nFirst = delta.nLeafCount / CURVE_TREE_ARITY;
+    for (size_t d = 1; d < vLevels.size(); d++)
+    {
+        for (uint64_t p = nFirst; p < vLevels[d].nSize; p++)
+        {
+            uint64_t childStart = p * CURVE_TREE_ARITY;
+            uint64_t childEnd = std::min(childStart + CURVE_TREE_ARITY, vLevels[d - 1].nSize);
+            if (childStart >= childEnd)
+                return false;
+            CCurveTreeNode node = HashLevelChildren(vLevels[d - 1], d - 1, childStart, childEnd);
+            size_t nLen;
+            const unsigned char* pch = vLevels[d].GetPoint(p, nLen);
+            if (nLen != node.vchPoint.size() || (nLen && memcmp(pch, &node.vchPoint[0], nLen) != 0))
+                return false;
+        }
+        nFirst /= CURVE_TREE_ARITY;
+    }
+    return GetRoot() == delta.hashRoot;
 }
 
 bool CCurveTree::GetMembershipProof(uint64_t nLeafIndex, CFCMPProof& proofOut) const
@@ -690,9 +871,9 @@ bool CCurveTree::GetMembershipProof(uint64_t nLeafIndex, CFCMPProof& proofOut) c
 
     proofOut.nLeafIndex = nLeafIndex;
 
-    if (nLeafIndex < vLevels[0].size())
+    if (nLeafIndex < vLevels[0].nSize)
     {
-        proofOut.leafCommitment.vchCommitment = vLevels[0][nLeafIndex].vchPoint;
+        vLevels[0].GetPoint(nLeafIndex, proofOut.leafCommitment.vchCommitment);
     }
 
     proofOut.vchProof.clear();
@@ -710,7 +891,7 @@ bool CCurveTree::GetMembershipProof(uint64_t nLeafIndex, CFCMPProof& proofOut) c
         uint64_t parentIdx = idx / CURVE_TREE_ARITY;
         uint64_t childStart = parentIdx * CURVE_TREE_ARITY;
         uint64_t childEnd = std::min(childStart + CURVE_TREE_ARITY,
-                                      (uint64_t)vLevels[d].size());
+                                      vLevels[d].nSize);
 
         uint32_t posInParent = (uint32_t)(idx - childStart);
         proofOut.vchProof.insert(proofOut.vchProof.end(),
@@ -726,14 +907,13 @@ bool CCurveTree::GetMembershipProof(uint64_t nLeafIndex, CFCMPProof& proofOut) c
         {
             if (i == idx)
                 continue;
-            const CCurveTreeNode& sibling = vLevels[d][i];
-            uint32_t ptSize = (uint32_t)sibling.vchPoint.size();
+            size_t nLen;
+            const unsigned char* pch = vLevels[d].GetPoint(i, nLen);
+            uint32_t ptSize = (uint32_t)nLen;
             proofOut.vchProof.insert(proofOut.vchProof.end(),
                                       (unsigned char*)&ptSize,
                                       (unsigned char*)&ptSize + 4);
-            proofOut.vchProof.insert(proofOut.vchProof.end(),
-                                      sibling.vchPoint.begin(),
-                                      sibling.vchPoint.end());
+            proofOut.vchProof.insert(proofOut.vchProof.end(), pch, pch + nLen);
         }
 
         idx = parentIdx;
@@ -1206,6 +1386,34 @@ static bool VerifyFCMPProofUncached(const CCurveTreeNode& root,
     return true;
 }
 
+// Apply the header gates VerifyFCMPProofUncached runs before handing a V5
+// proof to VerifyFCMPProofV5, then defer its IPA check. False means the proof
+// is not a batchable V5 proof and must be verified on its own.
+static bool PrepareFCMPProofForBatch(const CCurveTreeNode& root,
+                                     const CFCMPProof& proof,
+                                     const CPedersenCommitment& cv,
+                                     CIPADeferredCheck& checkOut,
+                                     int& nGensLengthOut)
+{
+    if (proof.IsNull()) return false;
+    if (proof.GetSize() > FCMP_PROOF_MAX_SIZE) return false;
+    if (root.IsNull()) return false;
+    if (cv.IsNull()) return false;
+
+    const size_t MIN_HEADER_SIZE = 4 + 32 + 4;
+    if (proof.vchProof.size() < MIN_HEADER_SIZE)
+        return false;
+
+    uint32_t nVersion;
+    memcpy(&nVersion, proof.vchProof.data(), 4);
+    if (nVersion != FCMP_PROOF_VERSION_IPA)
+        return false;
+
+    uint256 expectedRootHash = root.GetHash();
+    std::vector<unsigned char> vchRoot(expectedRootHash.begin(), expectedRootHash.end());
+    return PrepareFCMPProofV5Check(vchRoot, cv.vchCommitment, proof.vchProof, checkOut, nGensLengthOut);
+}
+
 bool BatchVerifyFCMPProofs(const CCurveTreeNode& root,
                             const std::vector<CFCMPProof>& vProofs,
                             const std::vector<CPedersenCommitment>& vCommitments)
@@ -1213,23 +1421,141 @@ bool BatchVerifyFCMPProofs(const CCurveTreeNode& root,
     if (vProofs.size() != vCommitments.size())
         return false;
 
+    // V5 proofs are pre-checked and their final IPA multi-exponentiations
+    // deferred, grouped by generator length (one group per tree depth in
+    // practice), then each group is settled by a single randomized combined
+    // check. Anything else is verified on its own. The verify-once cache
+    // works exactly as in VerifyFCMPProof: hits are skipped and only proofs
+    // that passed are stored.
+    bool fCache = VerifyProofCacheEnabled();
+    std::vector<uint256> vKeys(vProofs.size());
+    std::map<int, std::vector<size_t> > mapBatchIndex;
+    std::map<int, std::vector<CIPADeferredCheck> > mapBatchChecks;
+
     for (size_t i = 0; i < vProofs.size(); i++)
     {
-        if (!VerifyFCMPProof(root, vProofs[i], vCommitments[i]))
+        if (fCache)
+        {
+            CHashWriter ss(SER_GETHASH, 0);
+            ss << (unsigned char)VERIFYCACHE_FCMP << root << vProofs[i] << vCommitments[i];
+            vKeys[i] = ss.GetHash();
+            if (VerifyProofCacheCheck(vKeys[i]))
+                continue;
+        }
+
+        CIPADeferredCheck check;
+        int nGensLength = 0;
+        if (PrepareFCMPProofForBatch(root, vProofs[i], vCommitments[i], check, nGensLength))
+        {
+            mapBatchIndex[nGensLength].push_back(i);
+            mapBatchChecks[nGensLength].push_back(check);
+            continue;
+        }
+
+        if (!VerifyFCMPProofUncached(root, vProofs[i], vCommitments[i]))
             return false;
+        if (fCache)
+            VerifyProofCacheStore(vKeys[i]);
+    }
+
+    for (std::map<int, std::vector<size_t> >::const_iterator it = mapBatchIndex.begin(); it != mapBatchIndex.end(); ++it)
+    {
+        const std::vector<size_t>& vIndex = it->second;
+        if (!VerifyFCMPProofV5Batch(it->first, mapBatchChecks[it->first]))
+        {
+            // The combined check only says something is wrong; the serial
+            // verifier decides which proof, if any, is invalid.
+            for (size_t j = 0; j < vIndex.size(); j++)
+            {
+                if (!VerifyFCMPProofUncached(root, vProofs[vIndex[j]], vCommitments[vIndex[j]]))
+                    return false;
+            }
+            if (fDebug)
+                printf("BatchVerifyFCMPProofs() : batch of %u failed but all proofs verify individually\n",
+                       (unsigned int)vIndex.size());
+        }
+        if (fCache)
+        {
+            for (size_t j = 0; j < vIndex.size(); j++)
+                VerifyProofCacheStore(vKeys[vIndex[j]]);
+        }
     }
+
     return true;
 }
 
+// Secret per-process salt, so leaves cannot be ground to collide in the table.
+static uint64_t LeafTableHash(const unsigned char* pch, size_t nLen)
+{
+    static const uint256 hashSalt = GetRandHash();
+    SHA256_CTX sha;
+    SHA256_Init(&sha);
+    SHA256_Update(&sha, hashSalt.begin(), 32);
+    SHA256_Update(&sha, pch, nLen);
+    unsigned char digest[32];
+    SHA256_Final(digest, &sha);
+    uint64_t nHash;
+    memcpy(&nHash, digest, sizeof(nHash));
+    return nHash;
+}
+
+void CCurveTree::BuildLeafTable() const
+{
+    // At most half full, so a miss ends after a couple of probes.
+    uint64_t nSlots = 1024;
+    while (nSlots < 2 * (vLevels[0].nSize + 1))
+        nSlots *= 2;
+    vLeafTable.assign(nSlots, 0);
+    for (uint64_t i = 0; i < vLevels[0].nSize; i++)
+        AddToLeafTable(i);
+}
+
+void CCurveTree::AddToLeafTable(uint64_t nLeaf) const
+{
+    if (2 * (nLeaf + 1) > vLeafTable.size())
+    {
+        BuildLeafTable();
+        return;
+    }
+    size_t nLen;
+    const unsigned char* pch = vLevels[0].GetPoint(nLeaf, nLen);
+    uint64_t nMask = vLeafTable.size() - 1;
+    uint64_t nSlot = LeafTableHash(pch, nLen) & nMask;
+    while (vLeafTable[nSlot] != 0)
+        nSlot = (nSlot + 1) & nMask;
+    vLeafTable[nSlot] = (uint32_t)(nLeaf + 1);
+}
+
 int64_t CCurveTree::FindLeafIndex(const CPedersenCommitment& cv) const
 {
     if (vLevels.empty() || cv.IsNull())
         return -1;
 
-    const std::vector<CCurveTreeNode>& leaves = vLevels[0];
-    for (size_t i = 0; i < leaves.size(); i++)
+    const CCurveTreeLevel& leaves = vLevels[0];
+    const std::vector<unsigned char>& vch = cv.vchCommitment;
+    size_t nLen;
+    if (leaves.nSize >= 0xffffffffU)
+    {
+        for (uint64_t i = 0; i < leaves.nSize; i++)
+        {
+            const unsigned char* pch = leaves.GetPoint(i, nLen);
+            if (nLen == vch.size() && memcmp(pch, &vch[0], nLen) == 0)
+                return (int64_t)i;
+        }
+        return -1;
+    }
+
+    if (vLeafTable.empty())
+        BuildLeafTable();
+
+    // Leaves are added in index order and never removed, so among equal
+    // leaves the lowest index is probed first.
+    uint64_t nMask = vLeafTable.size() - 1;
+    for (uint64_t nSlot = LeafTableHash(&vch[0], vch.size()) & nMask; vLeafTable[nSlot] != 0; nSlot = (nSlot + 1) & nMask)
     {
-        if (leaves[i].vchPoint == cv.vchCommitment)
+        uint64_t i = vLeafTable[nSlot] - 1;
+        const unsigned char* pch = leaves.GetPoint(i, nLen);
+        if (nLen == vch.size() && memcmp(pch, &vch[0], nLen) == 0)
             return (int64_t)i;
     }
     return -1;
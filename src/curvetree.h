@@ -9,6 +9,7 @@
 #include "serialize.h"
 #include "zkproof.h"
 
+#include <map>
 #include <vector>
 #include <stdint.h>
 
@@ -151,22 +152,141 @@ public:
 };
 
 
-class CCurveTree
+// Interval, in blocks, at which a full curve-tree snapshot is kept next to
+// the per-block deltas.
+static const int CURVE_TREE_CHECKPOINT_INTERVAL = 1000;
+
+/** Per-block curve-tree snapshot, stored in place of a full copy of the tree.
+ *
+ *  The tree is append-only: connecting a block only adds leaves, and that
+ *  rewrites at most the right-most nodes of each interior level. A delta
+ *  taken before the block keeps the level sizes and those nodes, so the
+ *  pre-block tree is recovered from any later tree of the same chain by
+ *  truncating each level and restoring the saved tail. New leaves are not
+ *  repeated here; they live in the shielded commitment index. Every
+ *  CURVE_TREE_CHECKPOINT_INTERVAL blocks a full snapshot is written as well,
+ *  from which a state can be replayed forward if the live tree is unusable.
+ */
+class CCurveTreeBlockDelta
 {
 public:
+    int nVersion;
     uint64_t nLeafCount;
-    std::vector<std::vector<CCurveTreeNode>> vLevels;
+    std::vector<uint64_t> vLevelSize;
+    std::vector<CCurveTreeNode> vTail;   // nodes at index >= nLeafCount / ARITY^d, level by level
+    uint256 hashRoot;
+    bool fCheckpoint;
 
-    CCurveTree()
+    CCurveTreeBlockDelta()
     {
+        nVersion = 1;
         nLeafCount = 0;
+        hashRoot = 0;
+        fCheckpoint = false;
     }
 
     IMPLEMENT_SERIALIZE
     (
+        READWRITE(nVersion);
         READWRITE(nLeafCount);
-        READWRITE(vLevels);
+        READWRITE(vLevelSize);
+        READWRITE(vTail);
+        READWRITE(hashRoot);
+        READWRITE(fCheckpoint);
     )
+};
+
+
+// Trailing flags word of a serialized CCurveTree. Trees written before it
+// existed end after the last node, and older readers ignore it.
+static const uint32_t CURVE_TREE_FLAG_PARENTS_CURRENT = 1;  // interior nodes hash from their children
+
+/** One level of a curve tree: the points of all its nodes back to back in a
+ *  single buffer, GetPointSizeAtDepth() bytes each. A node whose point is not
+ *  that size (a null gap, or a leaf in some other encoding) is kept in
+ *  mapOdd instead, with its slot zeroed. The depth, curve and index of a node
+ *  follow from its level and position, so nothing else is stored.
+ */
+class CCurveTreeLevel
+{
+public:
+    unsigned int nPointSize;
+    uint64_t nSize;
+    std::vector<unsigned char> vchSlab;
+    std::map<uint64_t, std::vector<unsigned char> > mapOdd;
+
+    CCurveTreeLevel()
+    {
+        nPointSize = SECP256K1_POINT_SIZE;
+        nSize = 0;
+    }
+
+    explicit CCurveTreeLevel(int nDepth)
+    {
+        nPointSize = CCurveTreeNode::GetPointSizeAtDepth(nDepth);
+        nSize = 0;
+    }
+
+    void Append(const unsigned char* pch, size_t nLen);
+    /** Grow with null nodes, or truncate. */
+    void Resize(uint64_t n);
+    void Set(uint64_t i, const unsigned char* pch, size_t nLen);
+    void Set(uint64_t i, const std::vector<unsigned char>& vch) { Set(i, vch.empty() ? NULL : &vch[0], vch.size()); }
+
+    /** Pointer to and length of node i's point; length 0 for a null node. */
+    const unsigned char* GetPoint(uint64_t i, size_t& nLenOut) const
+    {
+        if (!mapOdd.empty())
+        {
+            std::map<uint64_t, std::vector<unsigned char> >::const_iterator it = mapOdd.find(i);
+            if (it != mapOdd.end())
+            {
+                nLenOut = it->second.size();
+                return nLenOut ? &it->second[0] : NULL;
+            }
+        }
+        nLenOut = nPointSize;
+        return &vchSlab[i * nPointSize];
+    }
+
+    void GetPoint(uint64_t i, std::vector<unsigned char>& vchOut) const
+    {
+        size_t nLen;
+        const unsigned char* pch = GetPoint(i, nLen);
+        vchOut.assign(pch, pch + nLen);
+    }
+
+    size_t GetMemoryUsage() const;
+};
+
+/** Append-only tree of Pedersen commitments, CURVE_TREE_ARITY children per
+ *  node, alternating secp256k1 and ed25519 levels.
+ *
+ *  Levels are flat point buffers (CCurveTreeLevel), about 33 bytes per leaf
+ *  plus 1/255 of that for interior levels, instead of a CCurveTreeNode with
+ *  its own heap buffer per node. InsertLeaf() recomputes only the new leaf's
+ *  path. FindLeafIndex() uses a hash table of leaves built on first use.
+ *
+ *  The serialized form is unchanged: node by node as (point, depth, index),
+ *  so snapshots stay readable in both directions, plus the flags word above.
+ *  A tree read without CURVE_TREE_FLAG_PARENTS_CURRENT has interior nodes
+ *  from an older writer, and RebuildParentNodes() recomputes them once; for
+ *  any other tree it has nothing to do.
+ */
+class CCurveTree
+{
+public:
+    uint64_t nLeafCount;
+
+    CCurveTree()
+    {
+        nLeafCount = 0;
+        fParentsCurrent = true;
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const;
+    template<typename Stream> void Serialize(Stream& s, int nType, int nVersion) const;
+    template<typename Stream> void Unserialize(Stream& s, int nType, int nVersion);
 
     uint256 GetRoot() const;
 
@@ -188,11 +308,99 @@ public:
         return nLeafCount == 0;
     }
 
+    /** Recompute every interior node, unless they are already known to be
+     *  current. Returns false for an empty tree. */
     bool RebuildParentNodes();
 
+    /** Position of the leaf cv, or -1. Not safe against concurrent calls on
+     *  the same tree: the first call builds the leaf table. */
     int64_t FindLeafIndex(const CPedersenCommitment& cv) const;
+
+    size_t GetLevelCount() const { return vLevels.size(); }
+    uint64_t GetLevelSize(int nDepth) const { return nDepth < (int)vLevels.size() ? vLevels[nDepth].nSize : 0; }
+    CCurveTreeNode GetNode(int nDepth, uint64_t nIndex) const;
+
+    /** Bytes held by the levels and the leaf table. */
+    size_t GetMemoryUsage() const;
+
+    /** Record what appending leaves to this tree can overwrite. */
+    void GetBlockDelta(CCurveTreeBlockDelta& deltaOut) const;
+
+    /** Undo appends back to the state a delta was taken from. Fails if this
+     *  tree is not that state plus appended leaves. */
+    bool RewindToDelta(const CCurveTreeBlockDelta& delta);
+
+private:
+    std::vector<CCurveTreeLevel> vLevels;
+    bool fParentsCurrent;
+
+    // Open-addressed table of leaf index + 1 (0 = empty slot), keyed by a
+    // salted hash of the leaf point. Empty until FindLeafIndex() needs it.
+    mutable std::vector<uint32_t> vLeafTable;
+
+    void AddLevel();
+    void UpdateParent(int nChildDepth, uint64_t nParentIndex);
+    void BuildLeafTable() const;
+    void AddToLeafTable(uint64_t nLeaf) const;
 };
 
+template<typename Stream>
+void CCurveTree::Serialize(Stream& s, int nType, int nVersion) const
+{
+    ::Serialize(s, nLeafCount, nType, nVersion);
+    WriteCompactSize(s, vLevels.size());
+    for (unsigned int d = 0; d < vLevels.size(); d++)
+    {
+        const CCurveTreeLevel& level = vLevels[d];
+        WriteCompactSize(s, level.nSize);
+        for (uint64_t i = 0; i < level.nSize; i++)
+        {
+            size_t nLen;
+            const unsigned char* pch = level.GetPoint(i, nLen);
+            WriteCompactSize(s, nLen);
+            if (nLen)
+                s.write((const char*)pch, nLen);
+            ::Serialize(s, (int)d, nType, nVersion);
+            ::Serialize(s, i, nType, nVersion);
+        }
+    }
+    uint32_t nFlags = fParentsCurrent ? CURVE_TREE_FLAG_PARENTS_CURRENT : 0;
+    ::Serialize(s, nFlags, nType, nVersion);
+}
+
+template<typename Stream>
+void CCurveTree::Unserialize(Stream& s, int nType, int nVersion)
+{
+    ::Unserialize(s, nLeafCount, nType, nVersion);
+    vLevels.clear();
+    vLeafTable.clear();
+    uint64_t nLevels = ReadCompactSize(s);
+    if (nLevels > CURVE_TREE_MAX_DEPTH + 1)
+        throw std::ios_base::failure("CCurveTree::Unserialize() : too many levels");
+    std::vector<unsigned char> vchPoint;
+    for (uint64_t d = 0; d < nLevels; d++)
+    {
+        AddLevel();
+        CCurveTreeLevel& level = vLevels.back();
+        uint64_t nNodes = ReadCompactSize(s);
+        // The count is untrusted; reserve a bounded amount and grow from there.
+        level.vchSlab.reserve(std::min(nNodes, (uint64_t)65536) * level.nPointSize);
+        for (uint64_t i = 0; i < nNodes; i++)
+        {
+            int nDepth;
+            uint64_t nIndex;
+            ::Unserialize(s, vchPoint, nType, nVersion);
+            ::Unserialize(s, nDepth, nType, nVersion);
+            ::Unserialize(s, nIndex, nType, nVersion);
+            level.Append(vchPoint.empty() ? NULL : &vchPoint[0], vchPoint.size());
+        }
+    }
+    uint32_t nFlags = 0;
+    if (!s.empty())
+        ::Unserialize(s, nFlags, nType, nVersion);
+    fParentsCurrent = (nFlags & CURVE_TREE_FLAG_PARENTS_CURRENT) != 0;
+}
+
 
 bool CreateFCMPProof(const CCurveTree& tree,
                       uint64_t nLeafIndex,
@@ -9,10 +9,57 @@
 #include "util.h"
 
 #include <algorithm>
-#include <queue>
+#include <limits>
 
 CDAGManager g_dagManager;
 
+namespace {
+
+/** Orders DAG ordinals by block hash, the tie order every traversal result uses. */
+struct CompareDAGNodeHash
+{
+    const std::vector<uint256>& vHash;
+    explicit CompareDAGNodeHash(const std::vector<uint256>& vHashIn) : vHash(vHashIn) {}
+    bool operator()(uint32_t a, uint32_t b) const { return vHash[a] < vHash[b]; }
+};
+
+/** Same order, on ordinals paired with the top 64 bits of their hash. */
+struct CompareDAGNodeKey
+{
+    const std::vector<uint256>& vHash;
+    explicit CompareDAGNodeKey(const std::vector<uint256>& vHashIn) : vHash(vHashIn) {}
+    bool operator()(const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) const
+    {
+        return a.first != b.first ? a.first < b.first : vHash[a.second] < vHash[b.second];
+    }
+};
+
+/** Sorts ordinals by block hash; most comparisons never load the hashes. */
+void SortDAGNodesByHash(std::vector<uint32_t>& vNodes, const std::vector<uint256>& vHash)
+{
+    std::vector<std::pair<uint64_t, uint32_t> > vKeyed;
+    vKeyed.reserve(vNodes.size());
+    for (uint32_t n : vNodes)
+        vKeyed.push_back(std::make_pair((vHash[n] >> 192).Get64(), n));
+    std::sort(vKeyed.begin(), vKeyed.end(), CompareDAGNodeKey(vHash));
+    for (size_t i = 0; i < vKeyed.size(); i++)
+        vNodes[i] = vKeyed[i].second;
+}
+
+/** Orders ordinals by the start of their reachability interval. */
+struct CompareReachLo
+{
+    const std::vector<uint64_t>& vLo;
+    explicit CompareReachLo(const std::vector<uint64_t>& vLoIn) : vLo(vLoIn) {}
+    bool operator()(uint32_t a, uint32_t b) const { return vLo[a] < vLo[b]; }
+};
+
+/** A new forest child takes all but 1/REACH_SIBLING_SHARE of the free range,
+ *  so a chain uses up a range slowly and later siblings still find room. */
+const uint64_t REACH_SIBLING_SHARE = 8;
+
+} // namespace
+
 
 // ---------------------------------------------------------------------------
 // DAG Parent Commitment: coinbase OP_RETURN encoding
@@ -87,44 +134,396 @@ CScript BuildDAGParentScript(const std::vector<uint256>& vParents)
 
 
 // ---------------------------------------------------------------------------
-// CDAGManager: Initialization
+// CDAGManager: Dense storage
 // ---------------------------------------------------------------------------
 
-void CDAGManager::AddChildNoDuplicate(std::vector<uint256>& vChildren, const uint256& hashChild) const
+const uint32_t CDAGManager::DAG_NO_NODE;
+const unsigned char CDAGManager::DAGNODE_PRESENT;
+const unsigned char CDAGManager::DAGNODE_BLUE;
+const int CDAGManager::ANTICONE_WALK_STEPS;
+const uint32_t CDAGManager::ANTICONE_WALK_SLOTS;
+const uint64_t CDAGManager::REACH_INTERVAL_END;
+
+/** Visited set over DAG ordinals for one traversal. Borrows a mark array from
+ *  the manager's pool (traversals nest strictly) and clears it in O(1) by
+ *  bumping that array's generation. Caller holds cs_dag. */
+class CDAGVisitSet
+{
+public:
+    explicit CDAGVisitSet(const CDAGManager& dagIn) : dag(dagIn)
+    {
+        nSlot = dag.nVisitDepth++;
+        if (nSlot == dag.dequeVisitMarks.size())
+        {
+            dag.dequeVisitMarks.push_back(std::vector<uint32_t>());
+            dag.vVisitGeneration.push_back(0);
+        }
+        pMarks = &dag.dequeVisitMarks[nSlot];
+        if (pMarks->size() < dag.vNodeHash.size())
+            pMarks->resize(dag.vNodeHash.size(), 0);
+        nGeneration = ++dag.vVisitGeneration[nSlot];
+        if (nGeneration == 0)
+        {
+            std::fill(pMarks->begin(), pMarks->end(), 0);
+            nGeneration = dag.vVisitGeneration[nSlot] = 1;
+        }
+    }
+
+    ~CDAGVisitSet()
+    {
+        dag.nVisitDepth--;
+    }
+
+    bool Insert(uint32_t n)
+    {
+        if ((*pMarks)[n] == nGeneration)
+            return false;
+        (*pMarks)[n] = nGeneration;
+        return true;
+    }
+
+    bool Contains(uint32_t n) const
+    {
+        return (*pMarks)[n] == nGeneration;
+    }
+
+private:
+    const CDAGManager& dag;
+    size_t nSlot;
+    std::vector<uint32_t>* pMarks;
+    uint32_t nGeneration;
+};
+
+uint32_t CDAGManager::FindNode(const uint256& hash) const
 {
-    if (std::find(vChildren.begin(), vChildren.end(), hashChild) == vChildren.end())
-        vChildren.push_back(hashChild);
+    std::map<uint256, uint32_t>::const_iterator it = mapNodeOrdinal.find(hash);
+    return it == mapNodeOrdinal.end() ? DAG_NO_NODE : it->second;
 }
 
-void CDAGManager::InvalidateBlueSetCacheForBlock(const uint256& hashBlock) const
+uint32_t CDAGManager::FindPresentNode(const uint256& hash) const
 {
-    mapBlueSetCache.erase(hashBlock);
+    uint32_t n = FindNode(hash);
+    return (n != DAG_NO_NODE && IsPresent(n)) ? n : DAG_NO_NODE;
+}
+
+uint32_t CDAGManager::GetOrCreateNode(const uint256& hash)
+{
+    std::pair<std::map<uint256, uint32_t>::iterator, bool> ins =
+        mapNodeOrdinal.insert(std::make_pair(hash, (uint32_t)vNodeHash.size()));
+    if (!ins.second)
+        return ins.first->second;
+
+    vNodeHash.push_back(hash);
+    vNodeIndex.push_back(NULL);
+    vNodeFlags.push_back(0);
+    vNodeScore.push_back(0);
+    vNodeOrder.push_back(-1);
+    vNodeInferredK.push_back(-1);
+    vNodeRefs.push_back(0);
+    vParentBegin.push_back(0);
+    vParentCount.push_back(0);
+    vChildHead.push_back(DAG_NO_NODE);
+    vChildTail.push_back(DAG_NO_NODE);
+    vReachLo.push_back(0);
+    vReachHi.push_back(0);
+    vReachNext.push_back(0);
+    vCoverSet.push_back(std::vector<uint32_t>());
+    vWalkSlot.push_back(DAG_NO_NODE);
+    return ins.first->second;
+}
+
+void CDAGManager::SetBlue(uint32_t n, bool fBlue)
+{
+    if (fBlue)
+        vNodeFlags[n] |= DAGNODE_BLUE;
+    else
+        vNodeFlags[n] &= ~DAGNODE_BLUE;
+}
+
+CBlockIndex* CDAGManager::GetNodeIndex(uint32_t n) const
+{
+    if (IsPresent(n))
+        return vNodeIndex[n];
+    // Pending or pre-DAG parent: only reached at the DAG boundary.
+    std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(vNodeHash[n]);
+    return mi == mapBlockIndex.end() ? NULL : mi->second;
+}
+
+void CDAGManager::AddChildNoDuplicate(uint32_t nParent, uint32_t nChild)
+{
+    for (uint32_t e = vChildHead[nParent]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
+        if (vChildEdgeNode[e] == nChild)
+            return;
+
+    uint32_t e = nFreeChildEdge;
+    if (e != DAG_NO_NODE)
+    {
+        nFreeChildEdge = vChildEdgeNext[e];
+        vChildEdgeNode[e] = nChild;
+        vChildEdgeNext[e] = DAG_NO_NODE;
+    }
+    else
+    {
+        e = (uint32_t)vChildEdgeNode.size();
+        vChildEdgeNode.push_back(nChild);
+        vChildEdgeNext.push_back(DAG_NO_NODE);
+    }
+
+    if (vChildTail[nParent] == DAG_NO_NODE)
+        vChildHead[nParent] = e;
+    else
+        vChildEdgeNext[vChildTail[nParent]] = e;
+    vChildTail[nParent] = e;
+}
+
+void CDAGManager::RemoveChild(uint32_t nParent, uint32_t nChild)
+{
+    uint32_t ePrev = DAG_NO_NODE;
+    for (uint32_t e = vChildHead[nParent]; e != DAG_NO_NODE; ePrev = e, e = vChildEdgeNext[e])
+    {
+        if (vChildEdgeNode[e] != nChild)
+            continue;
+        uint32_t eNext = vChildEdgeNext[e];
+        if (ePrev == DAG_NO_NODE)
+            vChildHead[nParent] = eNext;
+        else
+            vChildEdgeNext[ePrev] = eNext;
+        if (vChildTail[nParent] == e)
+            vChildTail[nParent] = ePrev;
+        vChildEdgeNext[e] = nFreeChildEdge;
+        nFreeChildEdge = e;
+        return;
+    }
+}
+
+void CDAGManager::ClearChildren(uint32_t n)
+{
+    uint32_t e = vChildHead[n];
+    while (e != DAG_NO_NODE)
+    {
+        uint32_t eNext = vChildEdgeNext[e];
+        vChildEdgeNext[e] = nFreeChildEdge;
+        nFreeChildEdge = e;
+        e = eNext;
+    }
+    vChildHead[n] = DAG_NO_NODE;
+    vChildTail[n] = DAG_NO_NODE;
+}
+
+bool CDAGManager::SameNodeParents(uint32_t n, const std::vector<uint256>& vParents) const
+{
+    if (vParentCount[n] != vParents.size())
+        return false;
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
+        if (vNodeHash[vParentEdges[vParentBegin[n] + i]] != vParents[i])
+            return false;
+    return true;
+}
+
+void CDAGManager::SetNodeParents(uint32_t n, const std::vector<uint256>& vParents)
+{
+    vParentBegin[n] = (uint32_t)vParentEdges.size();
+    vParentCount[n] = (uint32_t)vParents.size();
+    for (const uint256& hashParent : vParents)
+    {
+        // GetOrCreateNode may grow the columns; nothing here holds a reference into them.
+        uint32_t nParent = GetOrCreateNode(hashParent);
+        vParentEdges.push_back(nParent);
+        vNodeRefs[nParent]++;
+        AddChildNoDuplicate(nParent, n);
+    }
+}
+
+void CDAGManager::DetachNodeParents(uint32_t n)
+{
+    uint32_t nBegin = vParentBegin[n];
+    uint32_t nCount = vParentCount[n];
+    vParentCount[n] = 0;
+    nDeadParentEdges += nCount;
+
+    for (uint32_t i = 0; i < nCount; i++)
+    {
+        uint32_t nParent = vParentEdges[nBegin + i];
+        RemoveChild(nParent, n);
+        vNodeRefs[nParent]--;
+        // Parent may become a tip again if it has no other children
+        if (IsPresent(nParent) && vChildHead[nParent] == DAG_NO_NODE)
+            setDAGTips.insert(vNodeHash[nParent]);
+        ReleaseNodeIfUnused(nParent);
+    }
+}
+
+void CDAGManager::ReleaseNodeIfUnused(uint32_t n)
+{
+    if (IsPresent(n) || vNodeRefs[n] > 0 || vChildHead[n] != DAG_NO_NODE)
+        return;
+    if (mapNodeOrdinal.erase(vNodeHash[n]) == 0)
+        return; // already released
+    nDeadNodes++;
 }
 
-void CDAGManager::RebuildPendingChildIndex()
+void CDAGManager::ClearDAGStore()
 {
-    mapPendingChildrenByParent.clear();
-    for (auto& pair : mapDAGData)
-        pair.second.vDAGChildren.clear();
+    mapNodeOrdinal.clear();
+    vNodeHash.clear();
+    vNodeIndex.clear();
+    vNodeFlags.clear();
+    vNodeScore.clear();
+    vNodeOrder.clear();
+    vNodeInferredK.clear();
+    vNodeRefs.clear();
+    vParentBegin.clear();
+    vParentCount.clear();
+    vParentEdges.clear();
+    vChildHead.clear();
+    vChildTail.clear();
+    vChildEdgeNode.clear();
+    vChildEdgeNext.clear();
+    nFreeChildEdge = DAG_NO_NODE;
+    nPresentNodes = 0;
+    nDeadNodes = 0;
+    nDeadParentEdges = 0;
+    setDAGTips.clear();
+    mapBlueSetCache.clear();
+    ClearReachIndex(0);
+}
 
-    for (auto& pair : mapDAGData)
+void CDAGManager::CompactDAGStoreIfSparse()
+{
+    // Released ordinals and detached parent rows are only reclaimed here, so
+    // reorgs and pruning never shift ordinals in the middle of an operation.
+    static const int DAG_COMPACT_MIN_DEAD = 1024;
+    if (!((nDeadNodes > DAG_COMPACT_MIN_DEAD && nDeadNodes * 4 > (int)vNodeHash.size()) ||
+          (nDeadParentEdges > (size_t)DAG_COMPACT_MIN_DEAD && nDeadParentEdges * 4 > vParentEdges.size())))
+        return;
+
+    std::vector<uint32_t> vRemap(vNodeHash.size(), DAG_NO_NODE);
+    uint32_t nLive = 0;
+    for (uint32_t n = 0; n < vNodeHash.size(); n++)
+    {
+        std::map<uint256, uint32_t>::const_iterator it = mapNodeOrdinal.find(vNodeHash[n]);
+        if (it != mapNodeOrdinal.end() && it->second == n)
+            vRemap[n] = nLive++;
+    }
+
+    std::vector<uint256> vHashNew(nLive), vScoreNew(nLive);
+    std::vector<CBlockIndex*> vIndexNew(nLive);
+    std::vector<unsigned char> vFlagsNew(nLive);
+    std::vector<int> vOrderNew(nLive), vInferredKNew(nLive);
+    std::vector<uint32_t> vRefsNew(nLive), vParentBeginNew(nLive), vParentCountNew(nLive);
+    std::vector<uint32_t> vParentEdgesNew;
+    vParentEdgesNew.reserve(vParentEdges.size() - nDeadParentEdges);
+    std::vector<uint32_t> vChildHeadNew(nLive, DAG_NO_NODE), vChildTailNew(nLive, DAG_NO_NODE);
+    std::vector<uint32_t> vChildEdgeNodeNew, vChildEdgeNextNew;
+
+    for (uint32_t n = 0; n < vNodeHash.size(); n++)
     {
-        for (const uint256& hashParent : pair.second.vDAGParents)
+        uint32_t m = vRemap[n];
+        if (m == DAG_NO_NODE)
+            continue;
+        vHashNew[m] = vNodeHash[n];
+        vIndexNew[m] = vNodeIndex[n];
+        vFlagsNew[m] = vNodeFlags[n];
+        vScoreNew[m] = vNodeScore[n];
+        vOrderNew[m] = vNodeOrder[n];
+        vInferredKNew[m] = vNodeInferredK[n];
+        vRefsNew[m] = vNodeRefs[n];
+        vParentBeginNew[m] = (uint32_t)vParentEdgesNew.size();
+        vParentCountNew[m] = vParentCount[n];
+        for (uint32_t i = 0; i < vParentCount[n]; i++)
+            vParentEdgesNew.push_back(vRemap[vParentEdges[vParentBegin[n] + i]]);
+        // Lay each child run out contiguously, preserving its order.
+        for (uint32_t e = vChildHead[n]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
         {
-            auto pit = mapDAGData.find(hashParent);
-            if (pit != mapDAGData.end())
-                AddChildNoDuplicate(pit->second.vDAGChildren, pair.first);
+            uint32_t eNew = (uint32_t)vChildEdgeNodeNew.size();
+            vChildEdgeNodeNew.push_back(vRemap[vChildEdgeNode[e]]);
+            vChildEdgeNextNew.push_back(DAG_NO_NODE);
+            if (vChildTailNew[m] == DAG_NO_NODE)
+                vChildHeadNew[m] = eNew;
             else
-                mapPendingChildrenByParent[hashParent].insert(pair.first);
+                vChildEdgeNextNew[vChildTailNew[m]] = eNew;
+            vChildTailNew[m] = eNew;
         }
     }
 
-    setDAGTips.clear();
-    for (const auto& pair : mapDAGData)
+    for (std::map<uint256, uint32_t>::iterator it = mapNodeOrdinal.begin(); it != mapNodeOrdinal.end(); ++it)
+        it->second = vRemap[it->second];
+
+    for (std::map<uint256, std::vector<uint32_t>>::iterator it = mapBlueSetCache.begin(); it != mapBlueSetCache.end(); ++it)
     {
-        if (pair.second.vDAGChildren.empty())
-            setDAGTips.insert(pair.first);
+        std::vector<uint32_t> vBlue;
+        for (uint32_t n : it->second)
+            if (vRemap[n] != DAG_NO_NODE)
+                vBlue.push_back(vRemap[n]);
+        it->second.swap(vBlue);
     }
+
+    if (fDebug)
+        printf("CompactDAGStoreIfSparse: %u -> %u nodes, %u -> %u parent edges\n",
+               (unsigned int)vNodeHash.size(), nLive,
+               (unsigned int)vParentEdges.size(), (unsigned int)vParentEdgesNew.size());
+
+    vNodeHash.swap(vHashNew);
+    vNodeIndex.swap(vIndexNew);
+    vNodeFlags.swap(vFlagsNew);
+    vNodeScore.swap(vScoreNew);
+    vNodeOrder.swap(vOrderNew);
+    vNodeInferredK.swap(vInferredKNew);
+    vNodeRefs.swap(vRefsNew);
+    vParentBegin.swap(vParentBeginNew);
+    vParentCount.swap(vParentCountNew);
+    vParentEdges.swap(vParentEdgesNew);
+    vChildHead.swap(vChildHeadNew);
+    vChildTail.swap(vChildTailNew);
+    vChildEdgeNode.swap(vChildEdgeNodeNew);
+    vChildEdgeNext.swap(vChildEdgeNextNew);
+    nFreeChildEdge = DAG_NO_NODE;
+    nDeadNodes = 0;
+    nDeadParentEdges = 0;
+    ClearReachIndex(nLive);
+}
+
+void CDAGManager::GetNodeData(uint32_t n, CBlockDAGData& dataOut) const
+{
+    dataOut.vDAGParents.clear();
+    dataOut.vDAGChildren.clear();
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
+        dataOut.vDAGParents.push_back(vNodeHash[vParentEdges[vParentBegin[n] + i]]);
+    for (uint32_t e = vChildHead[n]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
+        dataOut.vDAGChildren.push_back(vNodeHash[vChildEdgeNode[e]]);
+    dataOut.fBlue = IsBlue(n);
+    dataOut.nDAGScore = vNodeScore[n];
+    dataOut.nDAGOrder = vNodeOrder[n];
+    dataOut.nInferredK = vNodeInferredK[n];
+}
+
+size_t CDAGManager::GetDAGMemoryUsage() const
+{
+    LOCK(cs_dag);
+    // std::map nodes carry roughly four pointers of bookkeeping besides the pair.
+    size_t nMapEntry = sizeof(std::pair<const uint256, uint32_t>) + 4 * sizeof(void*);
+    return mapNodeOrdinal.size() * nMapEntry +
+           vNodeHash.capacity() * sizeof(uint256) +
+           vNodeIndex.capacity() * sizeof(CBlockIndex*) +
+           vNodeFlags.capacity() +
+           vNodeScore.capacity() * sizeof(uint256) +
+           (vNodeOrder.capacity() + vNodeInferredK.capacity()) * sizeof(int) +
+           (vNodeRefs.capacity() + vParentBegin.capacity() + vParentCount.capacity() +
+            vParentEdges.capacity() + vChildHead.capacity() + vChildTail.capacity() +
+            vChildEdgeNode.capacity() + vChildEdgeNext.capacity() + nCoverEntries + vWalkSlot.capacity() +
+            vWalkSlotNode.capacity() + vWalkSlotSize.capacity() + vWalkPool.capacity()) * sizeof(uint32_t) +
+           (vReachLo.capacity() + vReachHi.capacity() + vReachNext.capacity()) * sizeof(uint64_t) +
+           vCoverSet.capacity() * sizeof(std::vector<uint32_t>);
+}
+
+
+// ---------------------------------------------------------------------------
+// CDAGManager: Initialization
+// ---------------------------------------------------------------------------
+
+void CDAGManager::InvalidateBlueSetCacheForBlock(const uint256& hashBlock) const
+{
+    mapBlueSetCache.erase(hashBlock);
 }
 
 bool CDAGManager::InitBlockDAGData(CBlockIndex* pindex, const std::vector<uint256>& vParents)
@@ -138,44 +537,42 @@ bool CDAGManager::InitBlockDAGData(CBlockIndex* pindex, const std::vector<uint25
 
     uint256 hash = pindex->GetBlockHash();
 
-    CBlockDAGData& data = mapDAGData[hash];
-    data.vDAGParents = vParents;
-    data.fBlue = true; // default, recolored by ColorBlock/ColorBlockDAGKnight
-    data.nDAGScore = 0;
-    data.nDAGOrder = -1;
-    data.nInferredK = -1;
-
-    InvalidateBlueSetCacheForBlock(hash);
-
-    // Register as child of each parent
-    for (const uint256& hashParent : vParents)
+    uint32_t n = GetOrCreateNode(hash);
+    vNodeIndex[n] = pindex;
+    if (!IsPresent(n))
     {
-        auto pit = mapDAGData.find(hashParent);
-        if (pit != mapDAGData.end())
-        {
-            AddChildNoDuplicate(pit->second.vDAGChildren, hash);
-            InvalidateBlueSetCacheForBlock(hashParent);
-        }
+        vNodeFlags[n] |= DAGNODE_PRESENT;
+        nPresentNodes++;
+        SetNodeParents(n, vParents);
+        // A new tip extends the reachability index in place; a parent that
+        // arrives after its children changes their pasts.
+        if (vChildHead[n] == DAG_NO_NODE)
+            AddReachNode(n);
         else
-        {
-            mapPendingChildrenByParent[hashParent].insert(hash);
-        }
+            fReachDirty = true;
     }
-
-    // Attach children that arrived earlier while this parent was missing.
-    auto pendingIt = mapPendingChildrenByParent.find(hash);
-    if (pendingIt != mapPendingChildrenByParent.end())
+    else if (!SameNodeParents(n, vParents))
     {
-        for (const uint256& hashChild : pendingIt->second)
-        {
-            AddChildNoDuplicate(data.vDAGChildren, hashChild);
-            InvalidateBlueSetCacheForBlock(hashChild);
-        }
-        mapPendingChildrenByParent.erase(pendingIt);
+        DetachNodeParents(n);
+        SetNodeParents(n, vParents);
+        fReachDirty = true;
     }
+    SetBlue(n, true); // default, recolored by ColorBlock/ColorBlockDAGKnight
+    vNodeScore[n] = 0;
+    vNodeOrder[n] = -1;
+    vNodeInferredK[n] = -1;
+
+    InvalidateBlueSetCacheForBlock(hash);
+
+    // Children that arrived earlier while this parent was missing are already
+    // linked to its ordinal; only their cached blue sets need dropping.
+    for (const uint256& hashParent : vParents)
+        InvalidateBlueSetCacheForBlock(hashParent);
+    for (uint32_t e = vChildHead[n]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
+        InvalidateBlueSetCacheForBlock(vNodeHash[vChildEdgeNode[e]]);
 
     // Update DAG tips: this block is a tip only if no earlier child referenced it.
-    if (data.vDAGChildren.empty())
+    if (vChildHead[n] == DAG_NO_NODE)
         setDAGTips.insert(hash);
     else
         setDAGTips.erase(hash);
@@ -218,24 +615,22 @@ CBlockIndex* CDAGManager::SelectBestDAGTip() const
 
     for (const uint256& hashTip : setDAGTips)
     {
-        auto it = mapDAGData.find(hashTip);
-        if (it == mapDAGData.end())
+        uint32_t n = FindPresentNode(hashTip);
+        if (n == DAG_NO_NODE)
             continue;
 
-        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(hashTip);
-        if (mi == mapBlockIndex.end())
+        CBlockIndex* pindex = vNodeIndex[n];
+        if (!pindex)
             continue;
-
-        CBlockIndex* pindex = mi->second;
         if (pindex->nHeight >= FORK_HEIGHT_DAG && pindex->IsProofOfStake())
             continue;
 
         bool fBetter = false;
         if (!pBest)
             fBetter = true;
-        else if (it->second.nDAGScore > nBestScore)
+        else if (vNodeScore[n] > nBestScore)
             fBetter = true;
-        else if (it->second.nDAGScore == nBestScore)
+        else if (vNodeScore[n] == nBestScore)
         {
             if (pindex->nChainTrust != pBest->nChainTrust)
                 fBetter = pindex->nChainTrust > pBest->nChainTrust;
@@ -247,7 +642,7 @@ CBlockIndex* CDAGManager::SelectBestDAGTip() const
 
         if (fBetter)
         {
-            nBestScore = it->second.nDAGScore;
+            nBestScore = vNodeScore[n];
             pBest = pindex;
         }
     }
@@ -269,6 +664,18 @@ CBlockIndex* CDAGManager::SelectBestDAGTip() const
 // CDAGManager: GHOSTDAG Blue-Set Coloring (pre-DAGKNIGHT)
 // ---------------------------------------------------------------------------
 
+uint256 CDAGManager::GetParentScore(uint32_t nParent) const
+{
+    if (IsPresent(nParent))
+        return vNodeScore[nParent];
+
+    // Pre-DAG parent: use accumulated chain trust as base score
+    CBlockIndex* pindexParent = GetNodeIndex(nParent);
+    if (pindexParent && !(pindexParent->nHeight >= FORK_HEIGHT_DAG && pindexParent->IsProofOfStake()))
+        return pindexParent->nChainTrust;
+    return 0;
+}
+
 void CDAGManager::ColorBlock(CBlockIndex* pindex)
 {
     LOCK(cs_dag);
@@ -279,48 +686,36 @@ void CDAGManager::ColorBlock(CBlockIndex* pindex)
         return;
 
     uint256 hash = pindex->GetBlockHash();
-    auto it = mapDAGData.find(hash);
-    if (it == mapDAGData.end())
+    uint32_t n = FindPresentNode(hash);
+    if (n == DAG_NO_NODE)
         return;
 
-    CBlockDAGData& data = it->second;
-    const std::vector<uint256>& vParents = data.vDAGParents;
-
-    if (vParents.empty())
+    if (vParentCount[n] == 0)
     {
         // Genesis or pre-DAG block: always blue
-        data.fBlue = true;
-        data.nDAGScore = pindex->GetBlockTrust();
+        SetBlue(n, true);
+        vNodeScore[n] = pindex->GetBlockTrust();
         return;
     }
 
     // Find selected parent = parent with highest DAG score
     // Pre-DAG parents use their nChainTrust as effective DAG score
+    uint32_t nSelectedParent = DAG_NO_NODE;
     uint256 hashSelectedParent;
     uint256 nBestParentScore = 0;
 
-    for (const uint256& hashParent : vParents)
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
     {
-        uint256 nParentScore = 0;
-        auto pit = mapDAGData.find(hashParent);
-        if (pit != mapDAGData.end())
-        {
-            nParentScore = pit->second.nDAGScore;
-        }
-        else
-        {
-            // Pre-DAG parent: use accumulated chain trust as base score
-            std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(hashParent);
-            if (mi != mapBlockIndex.end() &&
-                !(mi->second->nHeight >= FORK_HEIGHT_DAG && mi->second->IsProofOfStake()))
-                nParentScore = mi->second->nChainTrust;
-        }
+        uint32_t nParent = vParentEdges[vParentBegin[n] + i];
+        const uint256& hashParent = vNodeHash[nParent];
+        uint256 nParentScore = GetParentScore(nParent);
 
         if (nParentScore > nBestParentScore ||
             (nParentScore == nBestParentScore && (hashSelectedParent == 0 || hashParent < hashSelectedParent)))
         {
             nBestParentScore = nParentScore;
             hashSelectedParent = hashParent;
+            nSelectedParent = nParent;
         }
     }
 
@@ -328,82 +723,79 @@ void CDAGManager::ColorBlock(CBlockIndex* pindex)
     {
         // Fallback: use parent's chain trust + this block's trust
         if (pindex->pprev)
-            data.nDAGScore = pindex->pprev->nChainTrust + pindex->GetBlockTrust();
+            vNodeScore[n] = pindex->pprev->nChainTrust + pindex->GetBlockTrust();
         else
-            data.nDAGScore = pindex->GetBlockTrust();
-        data.fBlue = true;
+            vNodeScore[n] = pindex->GetBlockTrust();
+        SetBlue(n, true);
         return;
     }
 
-    // Inherit blue set from selected parent
-    std::set<uint256> blueSet = GetBlueSetCached(hashSelectedParent);
-    // Cache selected parent's blue set before merge modifications (avoid redundant BFS)
-    std::set<uint256> selectedParentBlue = blueSet;
+    // Inherit blue set from selected parent. Entries at or past
+    // nSelectedParentBlue are merge blocks made blue here.
+    std::vector<uint32_t> vBlue;
+    GetBlueSetCached(nSelectedParent, vBlue);
+    size_t nSelectedParentBlue = vBlue.size();
+    CDAGVisitSet inBlue(*this);
+    for (uint32_t nBlue : vBlue)
+        inBlue.Insert(nBlue);
 
     // For each merge parent, try to add its blue blocks
-    for (const uint256& hashParent : vParents)
+    std::vector<uint32_t> vMergeBlue;
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
     {
-        if (hashParent == hashSelectedParent)
+        uint32_t nParent = vParentEdges[vParentBegin[n] + i];
+        if (vNodeHash[nParent] == hashSelectedParent || !IsPresent(nParent))
             continue;
 
-        auto pit = mapDAGData.find(hashParent);
-        if (pit == mapDAGData.end())
-            continue;
-
-        // Get blue blocks reachable from this merge parent
-        std::set<uint256> mergeBlue = GetBlueSetCached(hashParent);
+        // Get blue blocks reachable from this merge parent (hash order)
+        GetBlueSetCached(nParent, vMergeBlue);
 
-        for (const uint256& hashCandidate : mergeBlue)
+        for (uint32_t nCandidate : vMergeBlue)
         {
-            if (blueSet.count(hashCandidate))
+            if (inBlue.Contains(nCandidate))
                 continue; // already in blue set
 
             // Check anticone size: |anticone(X) ∩ blue_set| <= GHOSTDAG_K
-            int nAnticone = AnticoneSize(hashCandidate, blueSet);
+            int nAnticone = AnticoneSize(nCandidate, vBlue);
             if (nAnticone <= GHOSTDAG_K)
             {
-                blueSet.insert(hashCandidate);
+                vBlue.push_back(nCandidate);
+                inBlue.Insert(nCandidate);
                 // Mark block as blue
-                auto cit = mapDAGData.find(hashCandidate);
-                if (cit != mapDAGData.end())
-                    cit->second.fBlue = true;
+                if (IsPresent(nCandidate))
+                    SetBlue(nCandidate, true);
             }
             else
             {
                 // Mark as red
-                auto cit = mapDAGData.find(hashCandidate);
-                if (cit != mapDAGData.end())
-                    cit->second.fBlue = false;
+                if (IsPresent(nCandidate))
+                    SetBlue(nCandidate, false);
             }
         }
     }
 
     // This block itself is always blue
-    data.fBlue = true;
-    blueSet.insert(hash);
+    SetBlue(n, true);
 
     // Compute DAG score incrementally:
     // score = selected_parent_score + this_block_trust
     //       + trust of newly-blue merge blocks (not already in selected parent's blue set)
     uint256 nScore = nBestParentScore + pindex->GetBlockTrust();
 
-    // Add trust from newly-blue merge parent blocks (using cached selectedParentBlue)
-    for (const uint256& hashBlue : blueSet)
+    for (size_t i = nSelectedParentBlue; i < vBlue.size(); i++)
     {
-        if (hashBlue == hash)
+        if (vBlue[i] == n)
             continue; // already counted above
-        if (selectedParentBlue.count(hashBlue))
-            continue; // already in selected parent's score
 
-        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(hashBlue);
-        if (mi != mapBlockIndex.end())
+        CBlockIndex* pindexBlue = GetNodeIndex(vBlue[i]);
+        if (pindexBlue)
         {
-            if (mi->second->nHeight >= FORK_HEIGHT_DAG && mi->second->IsProofOfStake())
+            if (pindexBlue->nHeight >= FORK_HEIGHT_DAG && pindexBlue->IsProofOfStake())
                 continue;
-            nScore = nScore + mi->second->GetBlockTrust();
+            nScore = nScore + pindexBlue->GetBlockTrust();
         }
     }
-    data.nDAGScore = nScore;
+    vNodeScore[n] = nScore;
 }
 
 
@@ -416,82 +808,108 @@ std::vector<uint256> CDAGManager::GetDAGLinearOrder(const uint256& hashTip, int
     LOCK(cs_dag);
 
     std::vector<uint256> vOrder;
-    std::set<uint256> visited;
+    uint32_t nTip = FindNode(hashTip);
+    if (nTip == DAG_NO_NODE)
+    {
+        // Unknown tip: its selected-parent chain is just itself
+        if (hashTip != 0)
+            vOrder.push_back(hashTip);
+        return vOrder;
+    }
+
+    std::vector<uint32_t> vOrderNodes;
+    GetDAGLinearOrderNodes(nTip, nMaxBlocks, vOrderNodes);
+    vOrder.reserve(vOrderNodes.size());
+    for (uint32_t n : vOrderNodes)
+        vOrder.push_back(vNodeHash[n]);
+    return vOrder;
+}
+
+void CDAGManager::GetDAGLinearOrderNodes(uint32_t nTip, int nMaxBlocks, std::vector<uint32_t>& vOrder) const
+{
+    // No lock needed — caller should hold cs_dag
+    vOrder.clear();
 
     // Follow selected-parent chain from tip to genesis
-    // Bounded by mapDAGData size + cycle detection for safety
-    std::vector<uint256> selectedChain;
-    std::set<uint256> chainVisited;
-    uint256 hashCurrent = hashTip;
-    int nMaxChainLen = (int)mapDAGData.size() + 1;
+    // Bounded by the DAG entry count + cycle detection for safety
+    std::vector<uint32_t> vSelectedChain;
+    int nMaxChainLen = nPresentNodes + 1;
 
     // If caller requests limited output, limit chain walk depth too
     if (nMaxBlocks > 0 && nMaxBlocks < nMaxChainLen)
         nMaxChainLen = nMaxBlocks;
 
-    while (hashCurrent != 0 && nMaxChainLen > 0)
     {
-        if (!chainVisited.insert(hashCurrent).second)
-            break; // cycle detected — stop
-        selectedChain.push_back(hashCurrent);
-        hashCurrent = GetSelectedParent(hashCurrent);
-        nMaxChainLen--;
+        CDAGVisitSet chainVisited(*this);
+        uint32_t nCurrent = vNodeHash[nTip] != 0 ? nTip : DAG_NO_NODE;
+        while (nCurrent != DAG_NO_NODE && nMaxChainLen > 0)
+        {
+            if (!chainVisited.Insert(nCurrent))
+                break; // cycle detected — stop
+            vSelectedChain.push_back(nCurrent);
+            nCurrent = GetSelectedParentNode(nCurrent);
+            nMaxChainLen--;
+        }
     }
 
     // Reverse to go genesis->tip
-    std::reverse(selectedChain.begin(), selectedChain.end());
+    std::reverse(vSelectedChain.begin(), vSelectedChain.end());
+
+    CDAGVisitSet visited(*this);
+    std::vector<uint32_t> vQueue;
+    std::vector<uint32_t> vBlueInsert;
+    std::vector<uint32_t> vRedInsert;
+    CompareDAGNodeHash byHash(vNodeHash);
 
     // At each step on the selected chain, insert newly-visible blocks
-    for (const uint256& hashChainBlock : selectedChain)
+    for (uint32_t nChainBlock : vSelectedChain)
     {
-        if (!visited.insert(hashChainBlock).second)
+        if (!visited.Insert(nChainBlock))
             continue;
 
-        auto it = mapDAGData.find(hashChainBlock);
-        if (it == mapDAGData.end())
+        if (!IsPresent(nChainBlock))
         {
-            vOrder.push_back(hashChainBlock);
+            vOrder.push_back(nChainBlock);
             continue;
         }
 
         // Collect merge parents' blocks not yet visited
         // Insert blue blocks first (topological), then red blocks
-        std::vector<uint256> vBlueInsert;
-        std::vector<uint256> vRedInsert;
+        vBlueInsert.clear();
+        vRedInsert.clear();
+        vQueue.clear();
 
-        std::queue<uint256> queue;
-        for (const uint256& hashParent : it->second.vDAGParents)
+        uint32_t nSelectedParent = GetSelectedParentNode(nChainBlock);
+        for (uint32_t i = 0; i < vParentCount[nChainBlock]; i++)
         {
-            if (hashParent != GetSelectedParent(hashChainBlock))
-                queue.push(hashParent);
+            uint32_t nParent = vParentEdges[vParentBegin[nChainBlock] + i];
+            if (nParent != nSelectedParent)
+                vQueue.push_back(nParent);
         }
 
-        std::set<uint256> queueVisited;
-        while (!queue.empty())
+        CDAGVisitSet queueVisited(*this);
+        for (size_t q = 0; q < vQueue.size(); q++)
         {
-            uint256 h = queue.front();
-            queue.pop();
+            uint32_t h = vQueue[q];
 
-            if (!queueVisited.insert(h).second)
+            if (!queueVisited.Insert(h))
                 continue;
-            if (visited.count(h))
+            if (!visited.Insert(h))
                 continue;
 
-            visited.insert(h);
-
-            auto dit = mapDAGData.find(h);
-            if (dit != mapDAGData.end())
+            if (IsPresent(h))
             {
-                if (dit->second.fBlue)
+                if (IsBlue(h))
                     vBlueInsert.push_back(h);
                 else
                     vRedInsert.push_back(h);
 
                 // Continue BFS through parents
-                for (const uint256& hp : dit->second.vDAGParents)
+                for (uint32_t i = 0; i < vParentCount[h]; i++)
                 {
-                    if (!visited.count(hp) && !queueVisited.count(hp))
-                        queue.push(hp);
+                    uint32_t hp = vParentEdges[vParentBegin[h] + i];
+                    if (!visited.Contains(hp) && !queueVisited.Contains(hp))
+                        vQueue.push_back(hp);
                 }
             }
             else
@@ -501,18 +919,14 @@ std::vector<uint256> CDAGManager::GetDAGLinearOrder(const uint256& hashTip, int
         }
 
         // Sort by hash for determinism within each color group
-        std::sort(vBlueInsert.begin(), vBlueInsert.end());
-        std::sort(vRedInsert.begin(), vRedInsert.end());
+        std::sort(vBlueInsert.begin(), vBlueInsert.end(), byHash);
+        std::sort(vRedInsert.begin(), vRedInsert.end(), byHash);
 
         // Insert: blue first, then red, then this chain block
-        for (const uint256& h : vBlueInsert)
-            vOrder.push_back(h);
-        for (const uint256& h : vRedInsert)
-            vOrder.push_back(h);
-        vOrder.push_back(hashChainBlock);
+        vOrder.insert(vOrder.end(), vBlueInsert.begin(), vBlueInsert.end());
+        vOrder.insert(vOrder.end(), vRedInsert.begin(), vRedInsert.end());
+        vOrder.push_back(nChainBlock);
     }
-
-    return vOrder;
 }
 
 
@@ -529,10 +943,9 @@ uint256 CDAGManager::ComputeDAGScore(CBlockIndex* pindex)
     if (pindex->nHeight >= FORK_HEIGHT_DAG && pindex->IsProofOfStake())
         return 0;
 
-    uint256 hash = pindex->GetBlockHash();
-    auto it = mapDAGData.find(hash);
-    if (it != mapDAGData.end())
-        return it->second.nDAGScore;
+    uint32_t n = FindPresentNode(pindex->GetBlockHash());
+    if (n != DAG_NO_NODE)
+        return vNodeScore[n];
 
     // Pre-DAG block: use nChainTrust
     return pindex->nChainTrust;
@@ -545,42 +958,451 @@ uint256 CDAGManager::ComputeDAGScore(CBlockIndex* pindex)
 
 uint256 CDAGManager::GetSelectedParent(const uint256& hashBlock) const
 {
-    // No lock needed — caller should hold cs_dag
-    auto it = mapDAGData.find(hashBlock);
-    if (it == mapDAGData.end() || it->second.vDAGParents.empty())
+    LOCK(cs_dag);
+
+    uint32_t n = FindPresentNode(hashBlock);
+    if (n == DAG_NO_NODE)
         return 0;
+    uint32_t nSelected = GetSelectedParentNode(n);
+    return nSelected == DAG_NO_NODE ? uint256(0) : vNodeHash[nSelected];
+}
+
+uint32_t CDAGManager::GetSelectedParentNode(uint32_t n) const
+{
+    // No lock needed — caller should hold cs_dag
+    if (!IsPresent(n) || vParentCount[n] == 0)
+        return DAG_NO_NODE;
 
     // Selected parent = parent with highest DAG score
     // Pre-DAG parents use nChainTrust as effective score
-    uint256 hashBest;
+    uint32_t nBest = DAG_NO_NODE;
     uint256 nBestScore = 0;
 
-    for (const uint256& hashParent : it->second.vDAGParents)
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
     {
-        uint256 nParentScore = 0;
-        auto pit = mapDAGData.find(hashParent);
-        if (pit != mapDAGData.end())
+        uint32_t nParent = vParentEdges[vParentBegin[n] + i];
+        uint256 nParentScore = GetParentScore(nParent);
+
+        if (nParentScore > nBestScore ||
+            (nParentScore == nBestScore &&
+             (nBest == DAG_NO_NODE || vNodeHash[nBest] == 0 || vNodeHash[nParent] < vNodeHash[nBest])))
+        {
+            nBestScore = nParentScore;
+            nBest = nParent;
+        }
+    }
+
+    // A zero hash never names a block; callers treat it as "no parent".
+    if (nBest != DAG_NO_NODE && vNodeHash[nBest] == 0)
+        return DAG_NO_NODE;
+    return nBest;
+}
+
+
+// ---------------------------------------------------------------------------
+// CDAGManager: Reachability Index
+// ---------------------------------------------------------------------------
+
+void CDAGManager::ClearReachIndex(size_t nNodes) const
+{
+    vReachLo.assign(nNodes, 0);
+    vReachHi.assign(nNodes, 0);
+    vReachNext.assign(nNodes, 0);
+    nReachNextRoot = 1;
+    vCoverSet.clear();
+    vCoverSet.resize(nNodes);
+    nCoverEntries = 0;
+    fReachDirty = true;
+    vWalkSlot.assign(nNodes, DAG_NO_NODE);
+    vWalkSlotNode.clear();
+    vWalkSlotSize.clear();
+    vWalkPool.clear();
+    nNextWalkSlot = 0;
+}
+
+void CDAGManager::UpdateReachIndex() const
+{
+    // No lock needed — caller should hold cs_dag
+    if (!fReachDirty)
+        return;
+
+    int64_t nStart = GetTimeMicros();
+    ClearReachIndex(vNodeHash.size());
+    fReachDirty = false;
+    fReachHeightsOrdered = true;
+    RelabelReachIndex();
+
+    // Add present blocks parents-first, exactly as if each had arrived as a
+    // new tip. Depth-first over parent rows; 1 = on the stack, 2 = added.
+    std::vector<unsigned char> vState(vNodeHash.size(), 0);
+    std::vector<std::pair<uint32_t, uint32_t> > vStack;
+    int nIndexed = 0;
+    for (uint32_t nRoot = 0; nRoot < vNodeHash.size(); nRoot++)
+    {
+        if (!IsPresent(nRoot) || vState[nRoot] != 0)
+            continue;
+        vState[nRoot] = 1;
+        vStack.push_back(std::make_pair(nRoot, 0U));
+        while (!vStack.empty())
         {
-            nParentScore = pit->second.nDAGScore;
+            uint32_t h = vStack.back().first;
+            if (vStack.back().second < vParentCount[h])
+            {
+                uint32_t hp = vParentEdges[vParentBegin[h] + vStack.back().second++];
+                if (IsPresent(hp) && vState[hp] == 0)
+                {
+                    vState[hp] = 1;
+                    vStack.push_back(std::make_pair(hp, 0U));
+                }
+                continue;
+            }
+            vStack.pop_back();
+            vState[h] = 2;
+            AddReachNode(h);
+            nIndexed++;
         }
+    }
+
+    if (fDebug)
+        printf("UpdateReachIndex: indexed %d DAG blocks, %u covering entries in %" PRId64"us\n",
+               nIndexed, (unsigned int)nCoverEntries, GetTimeMicros() - nStart);
+}
+
+void CDAGManager::RelabelReachIndex() const
+{
+    // Gives every present block, and every absent block some present block
+    // names as its primary parent, a fresh interval. Each block's interval is
+    // proportional to its subtree with one subtree's worth left free, so a
+    // chain of n blocks leaves its tip about 2^63 / n slots to grow into.
+    size_t nNodes = vNodeHash.size();
+    std::vector<uint32_t> vKidBegin(nNodes + 1, 0);
+    std::vector<unsigned char> vLabelled(nNodes, 0);
+    for (uint32_t n = 0; n < nNodes; n++)
+    {
+        if (!IsPresent(n))
+            continue;
+        vLabelled[n] = 1;
+        if (vParentCount[n] > 0)
+        {
+            uint32_t nPrimary = vParentEdges[vParentBegin[n]];
+            vLabelled[nPrimary] = 1;
+            vKidBegin[nPrimary + 1]++;
+        }
+    }
+    for (size_t n = 0; n < nNodes; n++)
+        vKidBegin[n + 1] += vKidBegin[n];
+    std::vector<uint32_t> vKids(vKidBegin[nNodes]);
+    std::vector<uint32_t> vKidFill(vKidBegin.begin(), vKidBegin.end() - 1);
+    std::vector<uint32_t> vRoots;
+    for (uint32_t n = 0; n < nNodes; n++)
+    {
+        if (!vLabelled[n])
+            continue;
+        if (IsPresent(n) && vParentCount[n] > 0)
+            vKids[vKidFill[vParentEdges[vParentBegin[n]]]++] = n;
         else
+            vRoots.push_back(n);
+    }
+
+    // Preorder, then subtree sizes bottom-up
+    std::vector<uint32_t> vPreorder;
+    std::vector<uint32_t> vStack(vRoots.rbegin(), vRoots.rend());
+    while (!vStack.empty())
+    {
+        uint32_t n = vStack.back();
+        vStack.pop_back();
+        vPreorder.push_back(n);
+        for (uint32_t i = vKidBegin[n + 1]; i > vKidBegin[n]; i--)
+            vStack.push_back(vKids[i - 1]);
+    }
+    std::vector<uint64_t> vSize(nNodes, 0);
+    for (size_t i = vPreorder.size(); i > 0; i--)
+    {
+        uint32_t n = vPreorder[i - 1];
+        vSize[n]++;
+        if (IsPresent(n) && vParentCount[n] > 0)
+            vSize[vParentEdges[vParentBegin[n]]] += vSize[n];
+    }
+
+    vReachLo.assign(nNodes, 0);
+    vReachHi.assign(nNodes, 0);
+    vReachNext.assign(nNodes, 0);
+    uint64_t nTotal = 1;
+    for (uint32_t n : vRoots)
+        nTotal += vSize[n];
+    uint64_t nQuota = (nReachIntervalEnd - 1) / nTotal;
+    nReachNextRoot = 1;
+    for (uint32_t n : vRoots)
+    {
+        vReachLo[n] = nReachNextRoot;
+        vReachHi[n] = nReachNextRoot + nQuota * vSize[n] - 1;
+        nReachNextRoot = vReachHi[n] + 1;
+    }
+    for (uint32_t n : vPreorder)
+    {
+        vReachNext[n] = vReachLo[n] + 1;
+        nQuota = (vReachHi[n] - vReachLo[n]) / vSize[n];
+        for (uint32_t i = vKidBegin[n]; i < vKidBegin[n + 1]; i++)
         {
-            // Pre-DAG parent: use chain trust
-            std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(hashParent);
-            if (mi != mapBlockIndex.end() &&
-                !(mi->second->nHeight >= FORK_HEIGHT_DAG && mi->second->IsProofOfStake()))
-                nParentScore = mi->second->nChainTrust;
+            uint32_t nKid = vKids[i];
+            vReachLo[nKid] = vReachNext[n];
+            vReachHi[nKid] = vReachNext[n] + nQuota * vSize[nKid] - 1;
+            vReachNext[n] = vReachHi[nKid] + 1;
         }
+    }
 
-        if (nParentScore > nBestScore ||
-            (nParentScore == nBestScore && (hashBest == 0 || hashParent < hashBest)))
+    for (std::vector<uint32_t>& vCover : vCoverSet)
+        std::sort(vCover.begin(), vCover.end(), CompareReachLo(vReachLo));
+    nReachRelabels++;
+}
+
+bool CDAGManager::AllocReachInterval(uint32_t n, uint64_t& nNext, uint64_t nEnd) const
+{
+    if (nNext >= nEnd)
+        return false;
+    uint64_t nFree = nEnd - nNext;
+    vReachLo[n] = nNext;
+    vReachHi[n] = nNext + (nFree - nFree / REACH_SIBLING_SHARE) - 1;
+    vReachNext[n] = nNext + 1;
+    nNext = vReachHi[n] + 1;
+    return true;
+}
+
+bool CDAGManager::LabelReachNode(uint32_t n) const
+{
+    if (vReachHi[n] != 0)
+        return true;
+    if (vParentCount[n] == 0)
+        return AllocReachInterval(n, nReachNextRoot, nReachIntervalEnd);
+
+    uint32_t nPrimary = vParentEdges[vParentBegin[n]];
+    if (vReachHi[nPrimary] == 0 && !AllocReachInterval(nPrimary, nReachNextRoot, nReachIntervalEnd))
+        return false;
+    return AllocReachInterval(n, vReachNext[nPrimary], vReachHi[nPrimary] + 1);
+}
+
+void CDAGManager::GetMergeSet(uint32_t n, std::vector<uint32_t>& vMergeSet) const
+{
+    // Blocks in past(n) that are neither its primary parent nor in that
+    // parent's past: everything n's merge parents bring in.
+    vMergeSet.clear();
+    uint32_t nPrimary = vParentEdges[vParentBegin[n]];
+
+    CDAGVisitSet visited(*this);
+    std::vector<uint32_t> vQueue;
+    for (uint32_t i = 1; i < vParentCount[n]; i++)
+        vQueue.push_back(vParentEdges[vParentBegin[n] + i]);
+
+    for (size_t q = 0; q < vQueue.size(); q++)
+    {
+        uint32_t h = vQueue[q];
+        if (!visited.Insert(h))
+            continue;
+        if (h == nPrimary || IsInPast(h, nPrimary))
+            continue;
+        vMergeSet.push_back(h);
+        if (IsPresent(h))
         {
-            nBestScore = nParentScore;
-            hashBest = hashParent;
+            for (uint32_t i = 0; i < vParentCount[h]; i++)
+            {
+                uint32_t hp = vParentEdges[vParentBegin[h] + i];
+                if (!visited.Contains(hp))
+                    vQueue.push_back(hp);
+            }
+        }
+    }
+}
+
+void CDAGManager::AddReachNode(uint32_t n) const
+{
+    // Caller guarantees n has no present descendants.
+    if (fReachDirty)
+        return;
+    if (!vNodeIndex[n])
+        fReachHeightsOrdered = false;
+    if (!LabelReachNode(n))
+        RelabelReachIndex();
+    if (vParentCount[n] == 0)
+        return;
+
+    // The height shortcuts in IsInBoundedPast need heights to fall along
+    // every edge, which AcceptBlock enforces for valid blocks.
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
+    {
+        uint32_t nParent = vParentEdges[vParentBegin[n] + i];
+        if (IsPresent(nParent) && vNodeIndex[n] &&
+            (!vNodeIndex[nParent] || vNodeIndex[nParent]->nHeight >= vNodeIndex[n]->nHeight))
+            fReachHeightsOrdered = false;
+    }
+
+    // Entries stay pairwise unrelated in the forest: n is a tip, so no entry
+    // is below it, and n is skipped when it is below one already.
+    std::vector<uint32_t> vMergeSet;
+    GetMergeSet(n, vMergeSet);
+    for (uint32_t nMerged : vMergeSet)
+    {
+        std::vector<uint32_t>& vCover = vCoverSet[nMerged];
+        std::vector<uint32_t>::iterator it = std::upper_bound(vCover.begin(), vCover.end(), n, CompareReachLo(vReachLo));
+        if (it != vCover.begin() && IsForestAncestorOrSelf(*(it - 1), n))
+            continue;
+        vCover.insert(it, n);
+        nCoverEntries++;
+    }
+}
+
+void CDAGManager::RemoveReachNode(uint32_t n)
+{
+    if (fReachDirty)
+        return;
+
+    // Only a tip can be taken out in place: nothing was indexed through it.
+    if (vChildHead[n] != DAG_NO_NODE)
+    {
+        fReachDirty = true;
+        return;
+    }
+
+    if (vParentCount[n] > 0)
+    {
+        std::vector<uint32_t> vMergeSet;
+        GetMergeSet(n, vMergeSet);
+        for (uint32_t nMerged : vMergeSet)
+        {
+            std::vector<uint32_t>& vCover = vCoverSet[nMerged];
+            std::vector<uint32_t>::iterator it = std::lower_bound(vCover.begin(), vCover.end(), n, CompareReachLo(vReachLo));
+            if (it != vCover.end() && *it == n)
+            {
+                vCover.erase(it);
+                nCoverEntries--;
+            }
         }
+
+    }
+
+    // Hand the interval back if it was the last one carved out
+    if (vReachHi[n] != 0)
+    {
+        uint64_t& nNext = vParentCount[n] > 0 ? vReachNext[vParentEdges[vParentBegin[n]]] : nReachNextRoot;
+        if (nNext == vReachHi[n] + 1)
+            nNext = vReachLo[n];
+    }
+
+    vReachLo[n] = 0;
+    vReachHi[n] = 0;
+    vReachNext[n] = 0;
+    if (vWalkSlot[n] != DAG_NO_NODE)
+    {
+        vWalkSlotNode[vWalkSlot[n]] = DAG_NO_NODE;
+        vWalkSlot[n] = DAG_NO_NODE;
     }
+}
+
+bool CDAGManager::IsInPast(uint32_t nAncestor, uint32_t n) const
+{
+    // No lock needed — caller should hold cs_dag and have updated the index.
+    // Past is what the parent walks see: only present blocks are expanded.
+    if (nAncestor == n || !IsPresent(n))
+        return false;
+    if (fReachHeightsOrdered && IsPresent(nAncestor) && vNodeIndex[nAncestor]->nHeight >= vNodeIndex[n]->nHeight)
+        return false;
+    if (IsForestAncestorOrSelf(nAncestor, n))
+        return true;
 
-    return hashBest;
+    // The only entry n can be below is the last one starting at or before it
+    const std::vector<uint32_t>& vCover = vCoverSet[nAncestor];
+    std::vector<uint32_t>::const_iterator it = std::upper_bound(vCover.begin(), vCover.end(), n, CompareReachLo(vReachLo));
+    return it != vCover.begin() && IsForestAncestorOrSelf(*(it - 1), n);
+}
+
+bool CDAGManager::IsInBoundedPast(uint32_t nAncestor, uint32_t n, int nMaxDepth) const
+{
+    // Answers "would MarkPastSet(n, nMaxDepth) mark nAncestor" without the
+    // walk. Requires fReachHeightsOrdered and a present n with a block index.
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
+        if (vParentEdges[vParentBegin[n] + i] == nAncestor)
+            return true;
+
+    // Heights fall along every edge, so everything between n and a present
+    // ancestor within nMaxDepth + 1 heights is within reach of the walk.
+    int nHeight = vNodeIndex[n]->nHeight;
+    if (IsPresent(nAncestor) && nHeight - vNodeIndex[nAncestor]->nHeight <= nMaxDepth + 1)
+        return IsInPast(nAncestor, n);
+
+    // Otherwise it is marked iff one of its children was expanded: a present
+    // ancestor of n within nMaxDepth heights.
+    for (uint32_t e = vChildHead[nAncestor]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
+    {
+        uint32_t nChild = vChildEdgeNode[e];
+        if (nHeight - vNodeIndex[nChild]->nHeight <= nMaxDepth && IsInPast(nChild, n))
+            return true;
+    }
+    return false;
+}
+
+void CDAGManager::SetReachIntervalEndForTests(uint64_t nEnd)
+{
+    LOCK(cs_dag);
+    nReachIntervalEnd = nEnd;
+    fReachDirty = true;
+}
+
+uint64_t CDAGManager::GetReachRelabelCountForTests() const
+{
+    LOCK(cs_dag);
+    return nReachRelabels;
+}
+
+bool CDAGManager::IsInPastForTests(const uint256& hashAncestor, const uint256& hash) const
+{
+    LOCK(cs_dag);
+    uint32_t nAncestor = FindNode(hashAncestor);
+    uint32_t n = FindNode(hash);
+    if (nAncestor == DAG_NO_NODE || n == DAG_NO_NODE)
+        return false;
+    UpdateReachIndex();
+    return IsInPast(nAncestor, n);
+}
+
+bool CDAGManager::IsInBoundedPastForTests(const uint256& hashAncestor, const uint256& hash, int nMaxDepth) const
+{
+    LOCK(cs_dag);
+    uint32_t nAncestor = FindNode(hashAncestor);
+    uint32_t n = FindPresentNode(hash);
+    if (nAncestor == DAG_NO_NODE || n == DAG_NO_NODE)
+        return false;
+    UpdateReachIndex();
+    return IsInBoundedPast(nAncestor, n, nMaxDepth);
+}
+
+int CDAGManager::AnticoneSizeForTests(const uint256& hash, const std::vector<uint256>& vBlue, bool fWalk) const
+{
+    LOCK(cs_dag);
+    uint32_t n = FindNode(hash);
+    if (n == DAG_NO_NODE)
+        return 0;
+    std::vector<uint32_t> vBlueNodes;
+    for (const uint256& hashBlue : vBlue)
+    {
+        uint32_t nBlue = FindNode(hashBlue);
+        if (nBlue != DAG_NO_NODE)
+            vBlueNodes.push_back(nBlue);
+    }
+    UpdateReachIndex();
+    return fWalk ? AnticoneSizeByWalk(n, vBlueNodes) : AnticoneSize(n, vBlueNodes);
+}
+
+void CDAGManager::GetPastSetForTests(const uint256& hash, int nMaxDepth, std::set<uint256>& setPast) const
+{
+    LOCK(cs_dag);
+    setPast.clear();
+    uint32_t n = FindNode(hash);
+    if (n == DAG_NO_NODE)
+        return;
+    CDAGVisitSet past(*this);
+    MarkPastSet(n, nMaxDepth, past);
+    for (uint32_t h = 0; h < vNodeHash.size(); h++)
+        if (past.Contains(h))
+            setPast.insert(vNodeHash[h]);
 }
 
 
@@ -588,64 +1410,68 @@ uint256 CDAGManager::GetSelectedParent(const uint256& hashBlock) const
 // CDAGManager: Blue Set and Anticone helpers
 // ---------------------------------------------------------------------------
 
-std::set<uint256> CDAGManager::GetBlueSet(const uint256& hashBlock) const
+void CDAGManager::GetBlueSet(uint32_t n, std::vector<uint32_t>& vBlueOut) const
 {
     // No lock needed — caller should hold cs_dag
     // Bounded by DAG_MERGE_DEPTH * 4 to prevent DoS from deep BFS traversals
     static const int BLUESET_MAX_VISITED = DAG_MERGE_DEPTH * 4; // 256
 
-    std::set<uint256> blueSet;
-    std::set<uint256> visited;
-    std::queue<uint256> queue;
-    queue.push(hashBlock);
+    vBlueOut.clear();
+    CDAGVisitSet visited(*this);
+    int nVisited = 0;
+    std::vector<uint32_t> vQueue;
+    vQueue.push_back(n);
 
-    while (!queue.empty())
+    for (size_t q = 0; q < vQueue.size(); q++)
     {
-        uint256 h = queue.front();
-        queue.pop();
+        uint32_t h = vQueue[q];
 
-        if (!visited.insert(h).second)
+        if (!visited.Insert(h))
             continue;
+        nVisited++;
 
-        auto it = mapDAGData.find(h);
-        if (it == mapDAGData.end())
+        if (!IsPresent(h))
         {
             // Deterministic boundary: any missing block at/above FORK_HEIGHT_DAG is a
             // pruned DAG block (stop BFS). Below FORK_HEIGHT_DAG is a genuine pre-DAG
             // block (add to blue set). This is deterministic regardless of local pruning state.
-            std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(h);
-            if (mi != mapBlockIndex.end() && mi->second->nHeight >= FORK_HEIGHT_DAG)
+            CBlockIndex* pindexMissing = GetNodeIndex(h);
+            if (pindexMissing && pindexMissing->nHeight >= FORK_HEIGHT_DAG)
                 continue; // pruned DAG-era block — BFS boundary
-            blueSet.insert(h); // genuine pre-DAG block
+            vBlueOut.push_back(h); // genuine pre-DAG block
             continue;
         }
 
-        if (it->second.fBlue)
-            blueSet.insert(h);
+        if (IsBlue(h))
+            vBlueOut.push_back(h);
 
         // Bounded BFS to prevent DoS
-        if ((int)visited.size() >= BLUESET_MAX_VISITED)
+        if (nVisited >= BLUESET_MAX_VISITED)
             break;
 
-        for (const uint256& hp : it->second.vDAGParents)
+        for (uint32_t i = 0; i < vParentCount[h]; i++)
         {
-            if (!visited.count(hp))
-                queue.push(hp);
+            uint32_t hp = vParentEdges[vParentBegin[h] + i];
+            if (!visited.Contains(hp))
+                vQueue.push_back(hp);
         }
     }
 
-    return blueSet;
+    SortDAGNodesByHash(vBlueOut, vNodeHash);
 }
 
-std::set<uint256> CDAGManager::GetBlueSetCached(const uint256& hashBlock) const
+void CDAGManager::GetBlueSetCached(uint32_t n, std::vector<uint32_t>& vBlueOut) const
 {
     // Check cache first
-    auto cit = mapBlueSetCache.find(hashBlock);
+    auto cit = mapBlueSetCache.find(vNodeHash[n]);
     if (cit != mapBlueSetCache.end())
-        return cit->second;
+    {
+        vBlueOut = cit->second;
+        return;
+    }
 
     // Compute and cache
-    std::set<uint256> blueSet = GetBlueSet(hashBlock);
+    GetBlueSet(n, vBlueOut);
 
     // Evict oldest if cache full (simple eviction: clear half)
     if ((int)mapBlueSetCache.size() >= BLUESET_CACHE_MAX)
@@ -659,134 +1485,148 @@ std::set<uint256> CDAGManager::GetBlueSetCached(const uint256& hashBlock) const
         }
     }
 
-    mapBlueSetCache[hashBlock] = blueSet;
-    return blueSet;
+    mapBlueSetCache[vNodeHash[n]] = vBlueOut;
 }
 
-int CDAGManager::AnticoneSize(const uint256& hashBlock, const std::set<uint256>& blueSet) const
+int CDAGManager::AnticoneSize(uint32_t n, const std::vector<uint32_t>& vBlue) const
 {
     // Anticone of X w.r.t. blue set: blocks in blueSet that are neither
-    // ancestors nor descendants of X.
+    // ancestors nor descendants of X. Both sides are bounded: past(X) is what
+    // MarkPastSet(X, DAG_MERGE_DEPTH * 2) marks, and a blue block counts as a
+    // descendant only if X is among the first ANTICONE_WALK_STEPS blocks of a
+    // parent walk from it.
 
-    auto itX = mapDAGData.find(hashBlock);
-    if (itX == mapDAGData.end())
+    if (!IsPresent(n))
         return 0;
 
-    // Get X's past set (ancestors) — computed once
-    std::set<uint256> pastX = GetPastSet(hashBlock, DAG_MERGE_DEPTH * 2);
+    UpdateReachIndex();
+    if (!fReachHeightsOrdered)
+        return AnticoneSizeByWalk(n, vBlue); // heights AcceptBlock would never accept
 
-    // Get X's future set by checking which blueSet blocks have X in their past
-    // Build a combined future set for efficiency: collect all blocks that have X as ancestor
-    std::set<uint256> futureX;
-    for (const uint256& hashBlue : blueSet)
+    int nAnticone = 0;
+    for (uint32_t nBlue : vBlue)
     {
-        if (hashBlue == hashBlock || pastX.count(hashBlue))
+        if (nBlue == n || IsInBoundedPast(nBlue, n, DAG_MERGE_DEPTH * 2))
             continue;
+        if (!IsPresent(nBlue) || !IsInPast(n, nBlue) || !IsAncestorWithinWalk(n, nBlue))
+            nAnticone++;
+    }
 
-        // Check if hashBlue has hashBlock in its past (i.e., X is ancestor of hashBlue)
-        // Use bounded BFS from hashBlue back through parents
-        std::set<uint256> visited;
-        std::queue<uint256> q;
-        auto bit = mapDAGData.find(hashBlue);
-        if (bit == mapDAGData.end())
-            continue;
+    return nAnticone;
+}
 
-        bool fFound = false;
-        for (const uint256& hp : bit->second.vDAGParents)
-            q.push(hp);
+int CDAGManager::AnticoneSizeByWalk(uint32_t n, const std::vector<uint32_t>& vBlue) const
+{
+    // What AnticoneSize answers, straight from the bounded parent walks
+    int nAnticone = 0;
+    CDAGVisitSet pastX(*this);
+    MarkPastSet(n, DAG_MERGE_DEPTH * 2, pastX);
+    for (uint32_t nBlue : vBlue)
+    {
+        if (nBlue == n || pastX.Contains(nBlue))
+            continue;
+        if (!IsPresent(nBlue) || !IsAncestorWithinWalk(n, nBlue))
+            nAnticone++;
+    }
+    return nAnticone;
+}
 
-        int nSteps = 0;
-        while (!q.empty() && nSteps < DAG_MERGE_DEPTH * 2)
+bool CDAGManager::IsAncestorWithinWalk(uint32_t nAncestor, uint32_t n) const
+{
+    // n must be present. The walk is a BFS back through parents that stops
+    // after ANTICONE_WALK_STEPS distinct blocks.
+    uint32_t nSlot = vWalkSlot[n];
+    if (nSlot == DAG_NO_NODE)
+    {
+        nSlot = nNextWalkSlot;
+        nNextWalkSlot = (nNextWalkSlot + 1) % ANTICONE_WALK_SLOTS;
+        if (nSlot < vWalkSlotNode.size())
+        {
+            if (vWalkSlotNode[nSlot] != DAG_NO_NODE)
+                vWalkSlot[vWalkSlotNode[nSlot]] = DAG_NO_NODE;
+        }
+        else
+        {
+            vWalkSlotNode.push_back(DAG_NO_NODE);
+            vWalkSlotSize.push_back(0);
+            vWalkPool.resize(vWalkPool.size() + ANTICONE_WALK_STEPS);
+        }
+        vWalkSlotNode[nSlot] = n;
+        vWalkSlot[n] = nSlot;
+
+        uint32_t* pWalk = &vWalkPool[nSlot * ANTICONE_WALK_STEPS];
+        uint32_t nSize = 0;
+        CDAGVisitSet visited(*this);
+        std::vector<uint32_t> vQueue;
+        for (uint32_t i = 0; i < vParentCount[n]; i++)
+            vQueue.push_back(vParentEdges[vParentBegin[n] + i]);
+        for (size_t q = 0; q < vQueue.size() && (int)nSize < ANTICONE_WALK_STEPS; q++)
         {
-            uint256 h = q.front();
-            q.pop();
-            if (!visited.insert(h).second)
+            uint32_t h = vQueue[q];
+            if (!visited.Insert(h))
                 continue;
-            if (h == hashBlock)
+            pWalk[nSize++] = h;
+            if (IsPresent(h))
             {
-                fFound = true;
-                break;
-            }
-            auto pit = mapDAGData.find(h);
-            if (pit != mapDAGData.end())
-            {
-                for (const uint256& hp : pit->second.vDAGParents)
+                for (uint32_t i = 0; i < vParentCount[h]; i++)
                 {
-                    if (!visited.count(hp))
-                        q.push(hp);
+                    uint32_t hp = vParentEdges[vParentBegin[h] + i];
+                    if (!visited.Contains(hp))
+                        vQueue.push_back(hp);
                 }
             }
-            nSteps++;
         }
-
-        if (fFound)
-            futureX.insert(hashBlue);
-    }
-
-    // Anticone = blueSet - {X} - past(X) - future(X)
-    int nAnticone = 0;
-    for (const uint256& hashBlue : blueSet)
-    {
-        if (hashBlue == hashBlock)
-            continue;
-        if (pastX.count(hashBlue))
-            continue;
-        if (futureX.count(hashBlue))
-            continue;
-        nAnticone++;
+        std::sort(pWalk, pWalk + nSize);
+        vWalkSlotSize[nSlot] = nSize;
     }
 
-    return nAnticone;
+    const uint32_t* pWalk = &vWalkPool[nSlot * ANTICONE_WALK_STEPS];
+    return std::binary_search(pWalk, pWalk + vWalkSlotSize[nSlot], nAncestor);
 }
 
-std::set<uint256> CDAGManager::GetPastSet(const uint256& hashBlock, int nMaxDepth) const
+int CDAGManager::MarkPastSet(uint32_t n, int nMaxDepth, CDAGVisitSet& past) const
 {
     // No lock needed — caller should hold cs_dag
     // Uses height-based depth (not BFS step count) for deterministic traversal
-    std::set<uint256> past;
-    std::queue<uint256> queue;
-
-    auto it = mapDAGData.find(hashBlock);
-    if (it == mapDAGData.end())
-        return past;
+    if (!IsPresent(n))
+        return 0;
 
     // Get starting block height for depth comparison
-    int nStartHeight = -1;
-    std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(hashBlock);
-    if (mi != mapBlockIndex.end())
-        nStartHeight = mi->second->nHeight;
+    int nStartHeight = vNodeIndex[n] ? vNodeIndex[n]->nHeight : -1;
 
-    for (const uint256& hp : it->second.vDAGParents)
-        queue.push(hp);
+    int nCount = 0;
+    std::vector<uint32_t> vQueue;
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
+        vQueue.push_back(vParentEdges[vParentBegin[n] + i]);
 
-    while (!queue.empty())
+    for (size_t q = 0; q < vQueue.size(); q++)
     {
-        uint256 h = queue.front();
-        queue.pop();
+        uint32_t h = vQueue[q];
 
-        if (!past.insert(h).second)
+        if (!past.Insert(h))
             continue;
+        nCount++;
 
         // Height-based depth check: stop when block is too far below start
         if (nStartHeight >= 0)
         {
-            std::map<uint256, CBlockIndex*>::iterator mh = mapBlockIndex.find(h);
-            if (mh != mapBlockIndex.end() && nStartHeight - mh->second->nHeight > nMaxDepth)
+            CBlockIndex* pindexPast = GetNodeIndex(h);
+            if (pindexPast && nStartHeight - pindexPast->nHeight > nMaxDepth)
                 continue; // don't expand parents beyond depth limit
         }
 
-        auto pit = mapDAGData.find(h);
-        if (pit != mapDAGData.end())
+        if (IsPresent(h))
         {
-            for (const uint256& hp : pit->second.vDAGParents)
+            for (uint32_t i = 0; i < vParentCount[h]; i++)
             {
-                if (!past.count(hp))
-                    queue.push(hp);
+                uint32_t hp = vParentEdges[vParentBegin[h] + i];
+                if (!past.Contains(hp))
+                    vQueue.push_back(hp);
             }
         }
     }
 
-    return past;
+    return nCount;
 }
 
 
@@ -799,21 +1639,21 @@ std::set<uint256> CDAGManager::GetDAGSiblingBlocks(const uint256& hashBlock) con
     LOCK(cs_dag);
 
     std::set<uint256> siblings;
-    auto it = mapDAGData.find(hashBlock);
-    if (it == mapDAGData.end())
+    uint32_t n = FindPresentNode(hashBlock);
+    if (n == DAG_NO_NODE)
         return siblings;
 
     // Siblings = other children of our parents
-    for (const uint256& hashParent : it->second.vDAGParents)
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
     {
-        auto pit = mapDAGData.find(hashParent);
-        if (pit == mapDAGData.end())
+        uint32_t nParent = vParentEdges[vParentBegin[n] + i];
+        if (!IsPresent(nParent))
             continue;
 
-        for (const uint256& hashChild : pit->second.vDAGChildren)
+        for (uint32_t e = vChildHead[nParent]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
         {
-            if (hashChild != hashBlock)
-                siblings.insert(hashChild);
+            if (vChildEdgeNode[e] != n)
+                siblings.insert(vNodeHash[vChildEdgeNode[e]]);
         }
     }
 
@@ -823,16 +1663,16 @@ std::set<uint256> CDAGManager::GetDAGSiblingBlocks(const uint256& hashBlock) con
 bool CDAGManager::HasDAGData(const uint256& hash) const
 {
     LOCK(cs_dag);
-    return mapDAGData.count(hash) > 0;
+    return FindPresentNode(hash) != DAG_NO_NODE;
 }
 
 bool CDAGManager::GetDAGData(const uint256& hash, CBlockDAGData& dataOut) const
 {
     LOCK(cs_dag);
-    auto it = mapDAGData.find(hash);
-    if (it == mapDAGData.end())
+    uint32_t n = FindPresentNode(hash);
+    if (n == DAG_NO_NODE)
         return false;
-    dataOut = it->second;
+    GetNodeData(n, dataOut);
     return true;
 }
 
@@ -841,44 +1681,32 @@ void CDAGManager::RemoveBlockDAGData(const uint256& hashBlock)
 {
     LOCK(cs_dag);
 
-    auto it = mapDAGData.find(hashBlock);
-    if (it == mapDAGData.end())
+    uint32_t n = FindPresentNode(hashBlock);
+    if (n == DAG_NO_NODE)
         return;
 
+    RemoveReachNode(n);
+
     // Remove this block from its parents' child lists
-    for (const uint256& hashParent : it->second.vDAGParents)
-    {
-        auto pit = mapDAGData.find(hashParent);
-        if (pit != mapDAGData.end())
-        {
-            auto& children = pit->second.vDAGChildren;
-            children.erase(std::remove(children.begin(), children.end(), hashBlock), children.end());
-            // Parent may become a tip again if it has no other children
-            if (children.empty())
-                setDAGTips.insert(hashParent);
-        }
-        else
-        {
-            auto pendingIt = mapPendingChildrenByParent.find(hashParent);
-            if (pendingIt != mapPendingChildrenByParent.end())
-            {
-                pendingIt->second.erase(hashBlock);
-                if (pendingIt->second.empty())
-                    mapPendingChildrenByParent.erase(pendingIt);
-            }
-        }
-    }
+    DetachNodeParents(n);
 
-    for (const uint256& hashChild : it->second.vDAGChildren)
-    {
-        mapPendingChildrenByParent[hashBlock].insert(hashChild);
-        InvalidateBlueSetCacheForBlock(hashChild);
-    }
+    // Its children keep naming it, so it stays as a placeholder holding them
+    // as pending children until it is re-added.
+    for (uint32_t e = vChildHead[n]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
+        InvalidateBlueSetCacheForBlock(vNodeHash[vChildEdgeNode[e]]);
 
     // Remove from tips and data
+    vNodeFlags[n] = 0;
+    vNodeIndex[n] = NULL;
+    vNodeScore[n] = 0;
+    vNodeOrder[n] = -1;
+    vNodeInferredK[n] = -1;
+    nPresentNodes--;
     setDAGTips.erase(hashBlock);
-    mapDAGData.erase(it);
     InvalidateBlueSetCacheForBlock(hashBlock);
+    ReleaseNodeIfUnused(n);
+
+    CompactDAGStoreIfSparse();
 }
 
 
@@ -890,29 +1718,51 @@ bool CDAGManager::WriteDAGLinks(CTxDB& txdb, const uint256& hash)
 {
     LOCK(cs_dag);
 
-    auto it = mapDAGData.find(hash);
-    if (it == mapDAGData.end())
+    uint32_t n = FindPresentNode(hash);
+    if (n == DAG_NO_NODE)
         return false;
 
-    return txdb.WriteDAGLinks(hash, it->second);
+    CBlockDAGData data;
+    GetNodeData(n, data);
+    return txdb.WriteDAGLinks(hash, data);
 }
 
 bool CDAGManager::LoadDAGLinks(CTxDB& txdb)
 {
     LOCK(cs_dag);
 
-    mapDAGData.clear();
-    setDAGTips.clear();
-    mapPendingChildrenByParent.clear();
+    ClearDAGStore();
 
     // Load DAG links using efficient LevelDB prefix iteration
-    txdb.IterateDAGLinks(mapDAGData);
+    std::map<uint256, CBlockDAGData> mapLoaded;
+    txdb.IterateDAGLinks(mapLoaded);
 
-    RebuildPendingChildIndex();
+    // Children are rebuilt from parent links; persisted child lists are advisory.
+    for (const auto& pair : mapLoaded)
+    {
+        uint32_t n = GetOrCreateNode(pair.first);
+        vNodeFlags[n] = DAGNODE_PRESENT | (pair.second.fBlue ? DAGNODE_BLUE : 0);
+        nPresentNodes++;
+        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(pair.first);
+        vNodeIndex[n] = mi == mapBlockIndex.end() ? NULL : mi->second;
+        vNodeScore[n] = pair.second.nDAGScore;
+        vNodeOrder[n] = pair.second.nDAGOrder;
+        vNodeInferredK[n] = pair.second.nInferredK;
+        SetNodeParents(n, pair.second.vDAGParents);
+    }
 
-    if (!mapDAGData.empty())
-        printf("LoadDAGLinks: loaded %d DAG entries, %d tips, %d pending parent links\n",
-               (int)mapDAGData.size(), (int)setDAGTips.size(), (int)mapPendingChildrenByParent.size());
+    int nPendingParents = 0;
+    for (uint32_t n = 0; n < vNodeHash.size(); n++)
+    {
+        if (!IsPresent(n))
+            nPendingParents++;
+        else if (vChildHead[n] == DAG_NO_NODE)
+            setDAGTips.insert(vNodeHash[n]);
+    }
+
+    if (nPresentNodes > 0)
+        printf("LoadDAGLinks: loaded %d DAG entries, %d tips, %d pending parent links, %" PRIszu" bytes\n",
+               nPresentNodes, (int)setDAGTips.size(), nPendingParents, GetDAGMemoryUsage());
 
     return true;
 }
@@ -956,10 +1806,8 @@ size_t CDAGManager::GetLoadedEpochStateCount() const
 // CDAGManager: Rebuild Ordering
 // ---------------------------------------------------------------------------
 
-void CDAGManager::RebuildDAGOrder()
+int CDAGManager::RecolorAndOrder(int nAboveHeight)
 {
-    LOCK(cs_dag);
-
     // Clear blue set cache to avoid stale entries during rebuild
     mapBlueSetCache.clear();
 
@@ -967,42 +1815,53 @@ void CDAGManager::RebuildDAGOrder()
     // Process blocks in height order
     std::vector<std::pair<int, uint256>> vByHeight;
 
-    for (const auto& pair : mapDAGData)
+    for (uint32_t n = 0; n < vNodeHash.size(); n++)
     {
-        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(pair.first);
-        if (mi != mapBlockIndex.end())
-            vByHeight.push_back(std::make_pair(mi->second->nHeight, pair.first));
+        if (IsPresent(n) && vNodeIndex[n] && vNodeIndex[n]->nHeight > nAboveHeight)
+            vByHeight.push_back(std::make_pair(vNodeIndex[n]->nHeight, vNodeHash[n]));
     }
 
     std::sort(vByHeight.begin(), vByHeight.end());
 
     for (const auto& pair : vByHeight)
     {
-        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(pair.second);
-        if (mi != mapBlockIndex.end())
-        {
-            // Fork-gate between GHOSTDAG and DAGKNIGHT coloring
-            if (mi->second->nHeight >= FORK_HEIGHT_DAGKNIGHT)
-                ColorBlockDAGKnight(mi->second);
-            else
-                ColorBlock(mi->second);
-        }
+        CBlockIndex* pindex = vNodeIndex[FindNode(pair.second)];
+        // Fork-gate between GHOSTDAG and DAGKNIGHT coloring
+        if (pindex->nHeight >= FORK_HEIGHT_DAGKNIGHT)
+            ColorBlockDAGKnight(pindex);
+        else
+            ColorBlock(pindex);
     }
 
     // Assign linear ordering from best tip
     CBlockIndex* pBestTip = SelectBestDAGTip();
     if (pBestTip && pBestTip->phashBlock)
     {
-        std::vector<uint256> vOrder = GetDAGLinearOrder(pBestTip->GetBlockHash());
-        for (int i = 0; i < (int)vOrder.size(); i++)
+        uint32_t nTip = FindNode(pBestTip->GetBlockHash());
+        if (nTip != DAG_NO_NODE)
         {
-            auto it = mapDAGData.find(vOrder[i]);
-            if (it != mapDAGData.end())
-                it->second.nDAGOrder = i;
+            std::vector<uint32_t> vOrder;
+            GetDAGLinearOrderNodes(nTip, 0, vOrder);
+            for (int i = 0; i < (int)vOrder.size(); i++)
+            {
+                if (IsPresent(vOrder[i]))
+                    vNodeOrder[vOrder[i]] = i;
+            }
         }
     }
 
-    printf("RebuildDAGOrder: recolored and ordered %d DAG blocks\n", (int)vByHeight.size());
+    return (int)vByHeight.size();
+}
+
+void CDAGManager::RebuildDAGOrder()
+{
+    LOCK(cs_dag);
+
+    int64_t nStart = GetTimeMicros();
+    int nColored = RecolorAndOrder(std::numeric_limits<int>::min());
+
+    printf("RebuildDAGOrder: recolored and ordered %d DAG blocks in %" PRId64"ms\n",
+           nColored, (GetTimeMicros() - nStart) / 1000);
 }
 
 
@@ -1014,48 +1873,10 @@ void CDAGManager::RebuildDAGOrderIncremental(int nCleanHeight)
 {
     LOCK(cs_dag);
 
-    // Clear blue set cache to avoid stale entries during rebuild
-    mapBlueSetCache.clear();
-
-    std::vector<std::pair<int, uint256>> vByHeight;
-
-    for (const auto& pair : mapDAGData)
-    {
-        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(pair.first);
-        if (mi != mapBlockIndex.end() && mi->second->nHeight > nCleanHeight)
-            vByHeight.push_back(std::make_pair(mi->second->nHeight, pair.first));
-    }
-
-    std::sort(vByHeight.begin(), vByHeight.end());
-
-    for (const auto& pair : vByHeight)
-    {
-        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(pair.second);
-        if (mi != mapBlockIndex.end())
-        {
-            // Fork-gate between GHOSTDAG and DAGKNIGHT coloring
-            if (mi->second->nHeight >= FORK_HEIGHT_DAGKNIGHT)
-                ColorBlockDAGKnight(mi->second);
-            else
-                ColorBlock(mi->second);
-        }
-    }
-
-    // Assign linear ordering from best tip
-    CBlockIndex* pBestTip = SelectBestDAGTip();
-    if (pBestTip && pBestTip->phashBlock)
-    {
-        std::vector<uint256> vOrder = GetDAGLinearOrder(pBestTip->GetBlockHash());
-        for (int i = 0; i < (int)vOrder.size(); i++)
-        {
-            auto it = mapDAGData.find(vOrder[i]);
-            if (it != mapDAGData.end())
-                it->second.nDAGOrder = i;
-        }
-    }
+    int nColored = RecolorAndOrder(nCleanHeight);
 
     printf("RebuildDAGOrderIncremental: recolored %d blocks above height %d\n",
-           (int)vByHeight.size(), nCleanHeight);
+           nColored, nCleanHeight);
 }
 
 
@@ -1072,20 +1893,19 @@ bool CDAGManager::PruneDAGData(CTxDB& txdb, int nHeight)
         return true; // nothing to prune
 
     int nPruned = 0;
-    std::vector<uint256> vToErase;
+    std::vector<uint32_t> vToErase;
 
-    for (const auto& pair : mapDAGData)
+    for (uint32_t n = 0; n < vNodeHash.size(); n++)
     {
-        // Don't prune epoch boundary blocks
-        if (setEpochBoundaryBlocks.count(pair.first))
+        if (!IsPresent(n) || !vNodeIndex[n])
             continue;
 
-        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(pair.first);
-        if (mi == mapBlockIndex.end())
+        // Don't prune epoch boundary blocks
+        if (setEpochBoundaryBlocks.count(vNodeHash[n]))
             continue;
 
-        if (mi->second->nHeight < nPruneBelow)
-            vToErase.push_back(pair.first);
+        if (vNodeIndex[n]->nHeight < nPruneBelow)
+            vToErase.push_back(n);
     }
 
     if (vToErase.empty())
@@ -1095,8 +1915,8 @@ bool CDAGManager::PruneDAGData(CTxDB& txdb, int nHeight)
     if (!txdb.TxnBegin())
         return false;
 
-    for (const uint256& hash : vToErase)
-        txdb.EraseDAGLinks(hash);
+    for (uint32_t n : vToErase)
+        txdb.EraseDAGLinks(vNodeHash[n]);
 
     // Persist prune height so GetBlueSet boundary check survives restart
     txdb.WriteDAGCleanHeight(nPruneBelow);
@@ -1104,43 +1924,32 @@ bool CDAGManager::PruneDAGData(CTxDB& txdb, int nHeight)
     if (!txdb.TxnCommit())
         return false;
 
-    // Erase from memory only after LevelDB commit succeeds
-    for (const uint256& hash : vToErase)
+    // Erase from memory only after LevelDB commit succeeds. A pruned block
+    // stays referenced by its children's parent rows, so its ordinal lives on
+    // as a placeholder (the GetBlueSet boundary) until they are pruned too.
+    // That ends the walks through it, so the reachability index is rebuilt.
+    fReachDirty = true;
+    for (uint32_t n : vToErase)
     {
-        auto dit = mapDAGData.find(hash);
-        if (dit != mapDAGData.end())
-        {
-            for (const uint256& hashParent : dit->second.vDAGParents)
-            {
-                auto pit = mapDAGData.find(hashParent);
-                if (pit != mapDAGData.end())
-                {
-                    auto& children = pit->second.vDAGChildren;
-                    children.erase(std::remove(children.begin(), children.end(), hash), children.end());
-                    if (children.empty())
-                        setDAGTips.insert(hashParent);
-                }
-                auto pendingIt = mapPendingChildrenByParent.find(hashParent);
-                if (pendingIt != mapPendingChildrenByParent.end())
-                {
-                    pendingIt->second.erase(hash);
-                    if (pendingIt->second.empty())
-                        mapPendingChildrenByParent.erase(pendingIt);
-                }
-            }
-            mapDAGData.erase(dit);
-        }
-        mapPendingChildrenByParent.erase(hash);
+        uint256 hash = vNodeHash[n];
+        DetachNodeParents(n);
+        ClearChildren(n);
+        vNodeFlags[n] = 0;
+        vNodeIndex[n] = NULL;
+        nPresentNodes--;
         setDAGTips.erase(hash);
         InvalidateBlueSetCacheForBlock(hash);
+        ReleaseNodeIfUnused(n);
         nPruned++;
     }
 
     nPrunedBelowHeight = nPruneBelow;
 
+    CompactDAGStoreIfSparse();
+
     if (nPruned > 0)
-        printf("PruneDAGData: pruned %d entries below height %d (%d remaining)\n",
-               nPruned, nPruneBelow, (int)mapDAGData.size());
+        printf("PruneDAGData: pruned %d entries below height %d (%d remaining, %" PRIszu" bytes)\n",
+               nPruned, nPruneBelow, nPresentNodes, GetDAGMemoryUsage());
 
     return true;
 }
@@ -1232,7 +2041,7 @@ bool CDAGManager::ComputeEpochState(int nEpoch, int nEpochInterval, const CBlock
     if (fDeterministicAnchor)
     {
         // Canonical accounting: block-count + blue-trust over EXACTLY the anchor-ordered set
-        // (state.vBlockHashes built above). The legacy mapDAGData sweep folds in every locally-seen
+        // (state.vBlockHashes built above). The legacy DAG-store sweep folds in every locally-seen
         // side-branch block in the height range and appends by a live-tip-derived nDAGOrder sort --
         // both node-local -- which would reintroduce the divergence this fork removes.
         for (const uint256& hashBlock : state.vBlockHashes)
@@ -1241,8 +2050,8 @@ bool CDAGManager::ComputeEpochState(int nEpoch, int nEpochInterval, const CBlock
             if (mi == mapBlockIndex.end())
                 continue;
             state.nBlockCount++;
-            auto dit = mapDAGData.find(hashBlock);
-            if (dit != mapDAGData.end() && dit->second.fBlue)
+            uint32_t nBlock = FindPresentNode(hashBlock);
+            if (nBlock != DAG_NO_NODE && IsBlue(nBlock))
                 state.nTotalTrust = state.nTotalTrust + mi->second->GetBlockTrust();
         }
     }
@@ -1251,23 +2060,23 @@ bool CDAGManager::ComputeEpochState(int nEpoch, int nEpochInterval, const CBlock
         // Include any DAG-era blocks missing from the selected order using stored
         // DAG order as deterministic fallback.
         std::vector<std::pair<int, uint256>> vEpochBlocks;
-        for (const auto& pair : mapDAGData)
+        for (uint32_t n = 0; n < vNodeHash.size(); n++)
         {
-            std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(pair.first);
-            if (mi == mapBlockIndex.end())
+            CBlockIndex* pindexBlock = IsPresent(n) ? vNodeIndex[n] : NULL;
+            if (!pindexBlock)
                 continue;
 
-            int nBlockHeight = mi->second->nHeight;
+            int nBlockHeight = pindexBlock->nHeight;
             if (nBlockHeight >= state.nHeightStart && nBlockHeight <= state.nHeightEnd)
             {
-                if (mi->second->nHeight >= FORK_HEIGHT_DAG && mi->second->IsProofOfStake())
+                if (pindexBlock->nHeight >= FORK_HEIGHT_DAG && pindexBlock->IsProofOfStake())
                     continue;
-                if (!setOrdered.count(pair.first))
-                    vEpochBlocks.push_back(std::make_pair(pair.second.nDAGOrder, pair.first));
+                if (!setOrdered.count(vNodeHash[n]))
+                    vEpochBlocks.push_back(std::make_pair(vNodeOrder[n], vNodeHash[n]));
                 state.nBlockCount++;
 
-                if (pair.second.fBlue)
-                    state.nTotalTrust = state.nTotalTrust + mi->second->GetBlockTrust();
+                if (IsBlue(n))
+                    state.nTotalTrust = state.nTotalTrust + pindexBlock->GetBlockTrust();
             }
         }
 
@@ -1524,7 +2333,7 @@ bool CDAGManager::GetLastFinalizedEpochState(CEpochState& stateOut) const
 int CDAGManager::GetDAGEntryCount() const
 {
     LOCK(cs_dag);
-    return (int)mapDAGData.size();
+    return nPresentNodes;
 }
 
 int CDAGManager::GetPrunedBelowHeight() const
@@ -1544,23 +2353,23 @@ void CDAGManager::SetPrunedBelowHeight(int nHeight)
 // CDAGManager: DAGKNIGHT Adaptive Ordering
 // ---------------------------------------------------------------------------
 
-int CDAGManager::InferLocalK(const uint256& hashBlock) const
+int CDAGManager::InferLocalK(uint32_t n) const
 {
     // No lock — caller holds cs_dag
     // Determinism: use each ancestor's already-stored nInferredK (computed at
     // their own coloring time) rather than recomputing against a stale blue set.
     // For the current block, compute its own anticone against its selected parent.
-    auto it = mapDAGData.find(hashBlock);
-    if (it == mapDAGData.end())
+    if (!IsPresent(n))
         return 0;
 
-    uint256 hashSelectedParent = GetSelectedParent(hashBlock);
-    if (hashSelectedParent == 0)
+    uint32_t nSelectedParent = GetSelectedParentNode(n);
+    if (nSelectedParent == DAG_NO_NODE)
         return 0;
 
     // Compute this block's anticone against its own selected parent's blue set
-    std::set<uint256> blueSet = GetBlueSetCached(hashSelectedParent);
-    int nAnticone = AnticoneSize(hashBlock, blueSet);
+    std::vector<uint32_t> vBlue;
+    GetBlueSetCached(nSelectedParent, vBlue);
+    int nAnticone = AnticoneSize(n, vBlue);
 
     // Clamp seed to ceiling to prevent single outlier from dominating EMA
     int nSeedAnticone = std::min(nAnticone, DAGKNIGHT_K_CEILING);
@@ -1569,24 +2378,23 @@ int CDAGManager::InferLocalK(const uint256& hashBlock) const
     // computed at coloring time before any pruning occurred)
     // Use EMA smoothing for stable k estimation
     int nEMAk = nSeedAnticone * 256; // fixed-point (*256), clamped seed
-    uint256 hashWalk = hashSelectedParent;
+    uint32_t nWalk = nSelectedParent;
     int nSamples = 0;
 
-    while (nSamples < DAGKNIGHT_K_SAMPLE_DEPTH && hashWalk != 0)
+    while (nSamples < DAGKNIGHT_K_SAMPLE_DEPTH && nWalk != DAG_NO_NODE)
     {
-        auto wit = mapDAGData.find(hashWalk);
-        if (wit == mapDAGData.end())
+        if (!IsPresent(nWalk))
             break;
 
-        if (wit->second.nInferredK >= 0)
+        if (vNodeInferredK[nWalk] >= 0)
         {
             // EMA: k_new = alpha * sample + (1 - alpha) * k_old
-            nEMAk = (DAGKNIGHT_K_EMA_ALPHA * wit->second.nInferredK * 256
+            nEMAk = (DAGKNIGHT_K_EMA_ALPHA * vNodeInferredK[nWalk] * 256
                      + (256 - DAGKNIGHT_K_EMA_ALPHA) * nEMAk) / 256;
 
         }
 
-        hashWalk = GetSelectedParent(hashWalk);
+        nWalk = GetSelectedParentNode(nWalk);
         nSamples++;
     }
 
@@ -1602,65 +2410,52 @@ int CDAGManager::InferLocalK(const uint256& hashBlock) const
     return nResult;
 }
 
-int CDAGManager::SupportingMass(const uint256& hashA, const uint256& hashB) const
+int CDAGManager::SupportingMass(uint32_t nA, uint32_t nB) const
 {
     // supporting_mass(A>B) = |{C : A in past(C) AND B not in past(C)}|
     // Bounded by both step count and visited set size to prevent DoS
     static const int SM_MAX_VISITED = 2048;
     int nBound = DAGKNIGHT_MAX_ANTICONE_WINDOW * 2;
 
-    std::set<uint256> futureA;
-    std::set<uint256> futureB;
+    CDAGVisitSet futureA(*this);
+    CDAGVisitSet futureB(*this);
+    std::vector<uint32_t> vFutureA;
 
-    // BFS forward from A through children
-    std::queue<uint256> qA;
-    qA.push(hashA);
-    int nSteps = 0;
-    while (!qA.empty() && nSteps < nBound && (int)futureA.size() < SM_MAX_VISITED)
+    // BFS forward from A (then B) through children; the queue is the unpopped
+    // tail of vQueue, so its size cap matches a FIFO of pending entries.
+    for (int nPass = 0; nPass < 2; nPass++)
     {
-        uint256 h = qA.front();
-        qA.pop();
-        if (!futureA.insert(h).second)
-            continue;
-        auto it = mapDAGData.find(h);
-        if (it != mapDAGData.end())
-        {
-            for (const uint256& hc : it->second.vDAGChildren)
-            {
-                if (!futureA.count(hc) && (int)qA.size() < SM_MAX_VISITED)
-                    qA.push(hc);
-            }
-        }
-        nSteps++;
-    }
-
-    // BFS forward from B through children
-    std::queue<uint256> qB;
-    qB.push(hashB);
-    nSteps = 0;
-    while (!qB.empty() && nSteps < nBound && (int)futureB.size() < SM_MAX_VISITED)
-    {
-        uint256 h = qB.front();
-        qB.pop();
-        if (!futureB.insert(h).second)
-            continue;
-        auto it = mapDAGData.find(h);
-        if (it != mapDAGData.end())
+        CDAGVisitSet& future = nPass == 0 ? futureA : futureB;
+        int nFutureSize = 0;
+        std::vector<uint32_t> vQueue(1, nPass == 0 ? nA : nB);
+        size_t q = 0;
+        int nSteps = 0;
+        while (q < vQueue.size() && nSteps < nBound && nFutureSize < SM_MAX_VISITED)
         {
-            for (const uint256& hc : it->second.vDAGChildren)
+            uint32_t h = vQueue[q++];
+            if (!future.Insert(h))
+                continue;
+            nFutureSize++;
+            if (nPass == 0)
+                vFutureA.push_back(h);
+            if (IsPresent(h))
             {
-                if (!futureB.count(hc) && (int)qB.size() < SM_MAX_VISITED)
-                    qB.push(hc);
+                for (uint32_t e = vChildHead[h]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
+                {
+                    uint32_t hc = vChildEdgeNode[e];
+                    if (!future.Contains(hc) && (int)(vQueue.size() - q) < SM_MAX_VISITED)
+                        vQueue.push_back(hc);
+                }
             }
+            nSteps++;
         }
-        nSteps++;
     }
 
     // Count blocks in future(A) not in future(B)
     int nSupport = 0;
-    for (const uint256& h : futureA)
+    for (uint32_t h : vFutureA)
     {
-        if (h != hashA && !futureB.count(h))
+        if (h != nA && !futureB.Contains(h))
             nSupport++;
     }
 
@@ -1678,24 +2473,39 @@ int CDAGManager::CompareBlockOrder(const uint256& hashA, const uint256& hashB,
         return 0;
     }
 
+    uint32_t nA = FindNode(hashA);
+    uint32_t nB = FindNode(hashB);
+    if (nA == DAG_NO_NODE || nB == DAG_NO_NODE)
+    {
+        // Unknown blocks have no past, future or supporting mass
+        nConfidence = 0;
+        return (hashA < hashB) ? -1 : 1;
+    }
+
     // Check topological ordering: is A ancestor of B or vice versa?
-    std::set<uint256> pastB = GetPastSet(hashB, DAGKNIGHT_MAX_ANTICONE_WINDOW);
-    if (pastB.count(hashA))
     {
-        nConfidence = (int)pastB.size();
-        return -1; // A precedes B
+        CDAGVisitSet pastB(*this);
+        int nPastB = MarkPastSet(nB, DAGKNIGHT_MAX_ANTICONE_WINDOW, pastB);
+        if (pastB.Contains(nA))
+        {
+            nConfidence = nPastB;
+            return -1; // A precedes B
+        }
     }
 
-    std::set<uint256> pastA = GetPastSet(hashA, DAGKNIGHT_MAX_ANTICONE_WINDOW);
-    if (pastA.count(hashB))
     {
-        nConfidence = (int)pastA.size();
-        return 1; // B precedes A
+        CDAGVisitSet pastA(*this);
+        int nPastA = MarkPastSet(nA, DAGKNIGHT_MAX_ANTICONE_WINDOW, pastA);
+        if (pastA.Contains(nB))
+        {
+            nConfidence = nPastA;
+            return 1; // B precedes A
+        }
     }
 
     // Blocks in each other's anticone — use supporting mass
-    int nSupportAB = SupportingMass(hashA, hashB);
-    int nSupportBA = SupportingMass(hashB, hashA);
+    int nSupportAB = SupportingMass(nA, nB);
+    int nSupportBA = SupportingMass(nB, nA);
 
     nConfidence = abs(nSupportAB - nSupportBA);
 
@@ -1719,161 +2529,148 @@ void CDAGManager::ColorBlockDAGKnight(CBlockIndex* pindex)
         return;
 
     uint256 hash = pindex->GetBlockHash();
-    auto it = mapDAGData.find(hash);
-    if (it == mapDAGData.end())
+    uint32_t n = FindPresentNode(hash);
+    if (n == DAG_NO_NODE)
         return;
 
-    CBlockDAGData& data = it->second;
-    const std::vector<uint256>& vParents = data.vDAGParents;
-
-    if (vParents.empty())
+    if (vParentCount[n] == 0)
     {
-        data.fBlue = true;
-        data.nDAGScore = pindex->GetBlockTrust();
-        data.nInferredK = 0;
+        SetBlue(n, true);
+        vNodeScore[n] = pindex->GetBlockTrust();
+        vNodeInferredK[n] = 0;
         return;
     }
 
+    uint32_t nSelectedParent = DAG_NO_NODE;
     uint256 hashSelectedParent;
     uint256 nBestParentScore = 0;
+    const uint256& hashPrimary = vNodeHash[vParentEdges[vParentBegin[n]]];
 
-    for (const uint256& hashParent : vParents)
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
     {
-        uint256 nParentScore = 0;
-        auto pit = mapDAGData.find(hashParent);
-        if (pit != mapDAGData.end())
-            nParentScore = pit->second.nDAGScore;
-        else
-        {
-            std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(hashParent);
-            if (mi != mapBlockIndex.end() &&
-                !(mi->second->nHeight >= FORK_HEIGHT_DAG && mi->second->IsProofOfStake()))
-                nParentScore = mi->second->nChainTrust;
-        }
+        uint32_t nParent = vParentEdges[vParentBegin[n] + i];
+        const uint256& hashParent = vNodeHash[nParent];
+        uint256 nParentScore = GetParentScore(nParent);
 
-        bool fIsPrimary = (hashParent == vParents[0]);
+        bool fIsPrimary = (hashParent == hashPrimary);
         if (nParentScore > nBestParentScore ||
             (nParentScore == nBestParentScore && (hashSelectedParent == 0 ||
              (fIsPrimary ? true : hashParent < hashSelectedParent))))
         {
             nBestParentScore = nParentScore;
             hashSelectedParent = hashParent;
+            nSelectedParent = nParent;
         }
     }
 
     if (hashSelectedParent == 0)
     {
         if (pindex->pprev)
-            data.nDAGScore = pindex->pprev->nChainTrust + pindex->GetBlockTrust();
+            vNodeScore[n] = pindex->pprev->nChainTrust + pindex->GetBlockTrust();
         else
-            data.nDAGScore = pindex->GetBlockTrust();
-        data.fBlue = true;
-        data.nInferredK = 0;
+            vNodeScore[n] = pindex->GetBlockTrust();
+        SetBlue(n, true);
+        vNodeInferredK[n] = 0;
         return;
     }
 
     // DAGKNIGHT: Infer local k from DAG structure
-    int nLocalK = InferLocalK(hash);
+    int nLocalK = InferLocalK(n);
     if (nLocalK < DAGKNIGHT_K_FLOOR)
     {
         printf("ColorBlockDAGKnight: inferred k %d below floor %d for %s, clamping\n",
                nLocalK, DAGKNIGHT_K_FLOOR, hash.ToString().substr(0,20).c_str());
         nLocalK = DAGKNIGHT_K_FLOOR;
     }
-    data.nInferredK = nLocalK;
+    vNodeInferredK[n] = nLocalK;
 
     // Inherit blue set from selected parent
-    std::set<uint256> blueSet = GetBlueSet(hashSelectedParent);
-    std::set<uint256> selectedParentBlue = blueSet;
+    std::vector<uint32_t> vBlue;
+    GetBlueSet(nSelectedParent, vBlue);
+    size_t nSelectedParentBlue = vBlue.size();
+    CDAGVisitSet inBlue(*this);
+    for (uint32_t nBlue : vBlue)
+        inBlue.Insert(nBlue);
 
     // Merge parents' blue blocks using adaptive k
-    for (const uint256& hashParent : vParents)
+    std::vector<uint32_t> vMergeBlue;
+    for (uint32_t i = 0; i < vParentCount[n]; i++)
     {
-        if (hashParent == hashSelectedParent)
+        uint32_t nParent = vParentEdges[vParentBegin[n] + i];
+        if (vNodeHash[nParent] == hashSelectedParent || !IsPresent(nParent))
             continue;
 
-        auto pit = mapDAGData.find(hashParent);
-        if (pit == mapDAGData.end())
-            continue;
-
-        std::set<uint256> mergeBlue = GetBlueSet(hashParent);
+        GetBlueSet(nParent, vMergeBlue);
 
-        for (const uint256& hashCandidate : mergeBlue)
+        for (uint32_t nCandidate : vMergeBlue)
         {
-            if (blueSet.count(hashCandidate))
+            if (inBlue.Contains(nCandidate))
                 continue;
 
             // DAGKNIGHT: Use inferred k instead of fixed GHOSTDAG_K
-            int nAnticone = AnticoneSize(hashCandidate, blueSet);
+            int nAnticone = AnticoneSize(nCandidate, vBlue);
             if (nAnticone <= nLocalK)
             {
-                blueSet.insert(hashCandidate);
-                auto cit = mapDAGData.find(hashCandidate);
-                if (cit != mapDAGData.end())
-                    cit->second.fBlue = true;
+                vBlue.push_back(nCandidate);
+                inBlue.Insert(nCandidate);
+                if (IsPresent(nCandidate))
+                    SetBlue(nCandidate, true);
             }
             else
             {
-                auto cit = mapDAGData.find(hashCandidate);
-                if (cit != mapDAGData.end())
-                    cit->second.fBlue = false;
+                if (IsPresent(nCandidate))
+                    SetBlue(nCandidate, false);
             }
         }
     }
 
     // This block is always blue
-    data.fBlue = true;
-    blueSet.insert(hash);
+    SetBlue(n, true);
 
     // Compute score: selected parent score + this block trust + newly-blue merge blocks
     uint256 nScore = nBestParentScore + pindex->GetBlockTrust();
-    for (const uint256& hashBlue : blueSet)
+    for (size_t i = nSelectedParentBlue; i < vBlue.size(); i++)
     {
-        if (hashBlue == hash)
-            continue;
-        if (selectedParentBlue.count(hashBlue))
+        if (vBlue[i] == n)
             continue;
-        std::map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(hashBlue);
-        if (mi != mapBlockIndex.end() &&
-            !(mi->second->nHeight >= FORK_HEIGHT_DAG && mi->second->IsProofOfStake()))
-            nScore = nScore + mi->second->GetBlockTrust();
+        CBlockIndex* pindexBlue = GetNodeIndex(vBlue[i]);
+        if (pindexBlue &&
+            !(pindexBlue->nHeight >= FORK_HEIGHT_DAG && pindexBlue->IsProofOfStake()))
+            nScore = nScore + pindexBlue->GetBlockTrust();
     }
-    data.nDAGScore = nScore;
+    vNodeScore[n] = nScore;
 }
 
 int CDAGManager::GetOrderConfidence(const uint256& hashBlock) const
 {
     LOCK(cs_dag);
 
-    auto it = mapDAGData.find(hashBlock);
-    if (it == mapDAGData.end())
+    uint32_t n = FindPresentNode(hashBlock);
+    if (n == DAG_NO_NODE)
         return 0;
 
     // Count blue descendants as confidence measure
     int nConfidence = 0;
-    std::set<uint256> visited;
-    std::queue<uint256> queue;
-    queue.push(hashBlock);
+    CDAGVisitSet visited(*this);
+    std::vector<uint32_t> vQueue(1, n);
     int nDepth = 0;
 
-    while (!queue.empty() && nDepth < DAGKNIGHT_MAX_ANTICONE_WINDOW)
+    for (size_t q = 0; q < vQueue.size() && nDepth < DAGKNIGHT_MAX_ANTICONE_WINDOW; q++)
     {
-        uint256 h = queue.front();
-        queue.pop();
-        if (!visited.insert(h).second)
+        uint32_t h = vQueue[q];
+        if (!visited.Insert(h))
             continue;
 
-        auto dit = mapDAGData.find(h);
-        if (dit == mapDAGData.end())
+        if (!IsPresent(h))
             continue;
 
-        if (dit->second.fBlue && h != hashBlock)
+        if (IsBlue(h) && h != n)
             nConfidence++;
 
-        for (const uint256& hc : dit->second.vDAGChildren)
+        for (uint32_t e = vChildHead[h]; e != DAG_NO_NODE; e = vChildEdgeNext[e])
         {
-            if (!visited.count(hc))
-                queue.push(hc);
+            if (!visited.Contains(vChildEdgeNode[e]))
+                vQueue.push_back(vChildEdgeNode[e]);
         }
         nDepth++;
     }
@@ -11,6 +11,7 @@
 #include "script.h"
 #include "curvetree.h"
 
+#include <deque>
 #include <vector>
 #include <map>
 #include <set>
@@ -18,6 +19,7 @@
 
 class CBlockIndex;
 class CTxDB;
+class CDAGVisitSet;
 
 // ---------------------------------------------------------------------------
 // Constants
@@ -181,7 +183,10 @@ class CDAGManager
 public:
     mutable CCriticalSection cs_dag;
 
-    CDAGManager() : nPrunedBelowHeight(-1) {}
+    CDAGManager() : nFreeChildEdge(DAG_NO_NODE), nPresentNodes(0), nDeadNodes(0), nDeadParentEdges(0),
+                    nPrunedBelowHeight(-1), nVisitDepth(0), nReachIntervalEnd(REACH_INTERVAL_END),
+                    nReachNextRoot(1), nCoverEntries(0), nReachRelabels(0),
+                    fReachDirty(true), fReachHeightsOrdered(true), nNextWalkSlot(0) {}
 
     /** Initialize DAG data for a newly accepted block.
      *  Must be called under cs_main. Sets parents, registers children, updates tips. */
@@ -262,6 +267,9 @@ public:
     /** Get the number of in-memory DAG entries. */
     int GetDAGEntryCount() const;
 
+    /** Approximate heap bytes held by the DAG store (columns, adjacency, hash index). */
+    size_t GetDAGMemoryUsage() const;
+
     /** Get the lowest height of pruned data (-1 if no pruning). */
     int GetPrunedBelowHeight() const;
 
@@ -284,41 +292,168 @@ public:
     /** Remove DAG data for a block (used during reorg). */
     void RemoveBlockDAGData(const uint256& hashBlock);
 
+    /** Tests only: shrink the reachability interval space (rebuilding the
+     *  index) so a small DAG runs out of room and has to be relabelled. */
+    void SetReachIntervalEndForTests(uint64_t nEnd);
+    /** Tests only: times every reachability interval has been reassigned. */
+    uint64_t GetReachRelabelCountForTests() const;
+    /** Tests only: the reachability index answers, by block hash, and the
+     *  MarkPastSet / parent walk answers they stand in for. The bounded
+     *  query needs heights falling along every edge. */
+    bool IsInPastForTests(const uint256& hashAncestor, const uint256& hash) const;
+    bool IsInBoundedPastForTests(const uint256& hashAncestor, const uint256& hash, int nMaxDepth) const;
+    int AnticoneSizeForTests(const uint256& hash, const std::vector<uint256>& vBlue, bool fWalk) const;
+    void GetPastSetForTests(const uint256& hash, int nMaxDepth, std::set<uint256>& setPast) const;
+
 private:
-    std::map<uint256, CBlockDAGData> mapDAGData;
+    friend class CDAGVisitSet;
+
+    static const uint32_t DAG_NO_NODE = 0xFFFFFFFF;
+    static const unsigned char DAGNODE_PRESENT = 0x01;   // block has DAG data (not just referenced)
+    static const unsigned char DAGNODE_BLUE = 0x02;
+
+    // Dense DAG store. Every hash the DAG knows -- its own blocks plus any parent
+    // they name that has no DAG data yet (pending or pre-DAG) -- has a 32-bit
+    // ordinal. Per-block fields are parallel columns indexed by ordinal, parents
+    // are CSR rows in one flat array, and children are linked runs in a flat edge
+    // pool. mapNodeOrdinal is only consulted at the public API boundary.
+    std::map<uint256, uint32_t> mapNodeOrdinal;
+    std::vector<uint256> vNodeHash;
+    std::vector<CBlockIndex*> vNodeIndex;        // NULL unless present
+    std::vector<unsigned char> vNodeFlags;
+    std::vector<uint256> vNodeScore;
+    std::vector<int> vNodeOrder;
+    std::vector<int> vNodeInferredK;
+    std::vector<uint32_t> vNodeRefs;             // parent-row entries naming this node
+    std::vector<uint32_t> vParentBegin;
+    std::vector<uint32_t> vParentCount;
+    std::vector<uint32_t> vParentEdges;
+    std::vector<uint32_t> vChildHead;
+    std::vector<uint32_t> vChildTail;
+    std::vector<uint32_t> vChildEdgeNode;
+    std::vector<uint32_t> vChildEdgeNext;
+    uint32_t nFreeChildEdge;
+    int nPresentNodes;
+    int nDeadNodes;
+    size_t nDeadParentEdges;
+
     std::set<uint256> setDAGTips;
-    std::map<uint256, std::set<uint256>> mapPendingChildrenByParent;
     std::map<int, CEpochState> mapEpochState;
     std::map<int, CCurveTree> mapEpochCurveTrees;
     std::set<uint256> setEpochBoundaryBlocks;
     int nPrunedBelowHeight;
 
-    // Performance: LRU cache for blue sets (avoids recomputing expensive BFS)
-    mutable std::map<uint256, std::set<uint256>> mapBlueSetCache;
+    // Performance: LRU cache for blue sets (avoids recomputing expensive BFS).
+    // Values are ordinals sorted by block hash.
+    mutable std::map<uint256, std::vector<uint32_t>> mapBlueSetCache;
     static const int BLUESET_CACHE_MAX = 128;
 
-    /** Internal: get blue set with caching */
-    std::set<uint256> GetBlueSetCached(const uint256& hashBlock) const;
+    // Traversal scratch: generation-stamped visited marks, one array per
+    // nesting level, so the BFS helpers never allocate a set.
+    mutable std::deque<std::vector<uint32_t>> dequeVisitMarks;
+    mutable std::vector<uint32_t> vVisitGeneration;
+    mutable size_t nVisitDepth;
+
+    // Reachability index. The primary-parent edges form a spanning forest,
+    // labelled with nested intervals: B is below A in the forest iff
+    // vReachLo[B] lies in [vReachLo[A], vReachHi[A]]. A block takes the first
+    // slot of its interval and hands the rest out to its forest children from
+    // vReachNext on; when a range runs out, every interval is reassigned in
+    // proportion to subtree size. Each block also keeps a future covering
+    // set: the blocks that merged it through a merge parent, minus any
+    // already below another entry in the forest, sorted by vReachLo. Those
+    // intervals are disjoint, so A is in past(B) iff A is a forest ancestor
+    // of B or a binary search of A's covering set finds an entry B is below.
+    // Appending a tip updates it incrementally; any other structural change
+    // marks it dirty and it is rebuilt on next use.
+    static const uint64_t REACH_INTERVAL_END = (uint64_t)1 << 63;
+    uint64_t nReachIntervalEnd;                   // intervals lie in [1, nReachIntervalEnd)
+    mutable std::vector<uint64_t> vReachLo;
+    mutable std::vector<uint64_t> vReachHi;       // 0 = no interval
+    mutable std::vector<uint64_t> vReachNext;
+    mutable uint64_t nReachNextRoot;
+    mutable std::vector<std::vector<uint32_t> > vCoverSet;
+    mutable size_t nCoverEntries;
+    mutable uint64_t nReachRelabels;
+    mutable bool fReachDirty;
+    mutable bool fReachHeightsOrdered;        // every parent sits below its child
+
+    // The first ANTICONE_WALK_STEPS blocks of a bounded parent walk from a
+    // block, sorted, for the most recently walked blocks. They depend only on
+    // the block's past, so they stay valid until the index is next rebuilt.
+    static const int ANTICONE_WALK_STEPS = DAG_MERGE_DEPTH * 2;
+    static const uint32_t ANTICONE_WALK_SLOTS = 4096;
+    mutable std::vector<uint32_t> vWalkSlot;
+    mutable std::vector<uint32_t> vWalkSlotNode;
+    mutable std::vector<uint32_t> vWalkSlotSize;
+    mutable std::vector<uint32_t> vWalkPool;
+    mutable uint32_t nNextWalkSlot;
+
+    /** Internal: ordinal storage maintenance. */
+    uint32_t FindNode(const uint256& hash) const;
+    uint32_t FindPresentNode(const uint256& hash) const;
+    uint32_t GetOrCreateNode(const uint256& hash);
+    bool IsPresent(uint32_t n) const { return (vNodeFlags[n] & DAGNODE_PRESENT) != 0; }
+    bool IsBlue(uint32_t n) const { return (vNodeFlags[n] & DAGNODE_BLUE) != 0; }
+    void SetBlue(uint32_t n, bool fBlue);
+    CBlockIndex* GetNodeIndex(uint32_t n) const;
+    void SetNodeParents(uint32_t n, const std::vector<uint256>& vParents);
+    bool SameNodeParents(uint32_t n, const std::vector<uint256>& vParents) const;
+    void DetachNodeParents(uint32_t n);
+    void AddChildNoDuplicate(uint32_t nParent, uint32_t nChild);
+    void RemoveChild(uint32_t nParent, uint32_t nChild);
+    void ClearChildren(uint32_t n);
+    void ReleaseNodeIfUnused(uint32_t n);
+    void CompactDAGStoreIfSparse();
+    void ClearDAGStore();
+    void GetNodeData(uint32_t n, CBlockDAGData& dataOut) const;
+
+    /** Internal: selected parent ordinal (DAG_NO_NODE if none). */
+    uint32_t GetSelectedParentNode(uint32_t n) const;
+    uint256 GetParentScore(uint32_t nParent) const;
 
-    /** Internal: child/pending-child and cache maintenance helpers. */
-    void AddChildNoDuplicate(std::vector<uint256>& vChildren, const uint256& hashChild) const;
+    /** Internal: get blue set with caching */
+    void GetBlueSetCached(uint32_t n, std::vector<uint32_t>& vBlueOut) const;
     void InvalidateBlueSetCacheForBlock(const uint256& hashBlock) const;
-    void RebuildPendingChildIndex();
 
     /** DAGKNIGHT: Infer local k from DAG neighborhood. */
-    int InferLocalK(const uint256& hashBlock) const;
+    int InferLocalK(uint32_t n) const;
 
     /** DAGKNIGHT: Compute supporting mass of A over B (blocks seeing A but not B). */
-    int SupportingMass(const uint256& hashA, const uint256& hashB) const;
+    int SupportingMass(uint32_t nA, uint32_t nB) const;
+
+    /** Internal: reachability index maintenance and queries. */
+    void ClearReachIndex(size_t nNodes) const;
+    void UpdateReachIndex() const;
+    void RelabelReachIndex() const;
+    bool AllocReachInterval(uint32_t n, uint64_t& nNext, uint64_t nEnd) const;
+    bool LabelReachNode(uint32_t n) const;
+    void AddReachNode(uint32_t n) const;
+    void RemoveReachNode(uint32_t n);
+    void GetMergeSet(uint32_t n, std::vector<uint32_t>& vMergeSet) const;
+    bool IsForestAncestorOrSelf(uint32_t nAncestor, uint32_t n) const
+    {
+        return vReachHi[nAncestor] != 0 && vReachLo[nAncestor] <= vReachLo[n] && vReachLo[n] <= vReachHi[nAncestor];
+    }
+    bool IsInPast(uint32_t nAncestor, uint32_t n) const;
+    bool IsInBoundedPast(uint32_t nAncestor, uint32_t n, int nMaxDepth) const;
 
     /** Internal: get anticone of block X relative to a blue set */
-    int AnticoneSize(const uint256& hashBlock, const std::set<uint256>& blueSet) const;
+    int AnticoneSize(uint32_t n, const std::vector<uint32_t>& vBlue) const;
+    int AnticoneSizeByWalk(uint32_t n, const std::vector<uint32_t>& vBlue) const;
+    bool IsAncestorWithinWalk(uint32_t nAncestor, uint32_t n) const;
+
+    /** Internal: collect blue set reachable from a block, sorted by hash */
+    void GetBlueSet(uint32_t n, std::vector<uint32_t>& vBlueOut) const;
+
+    /** Internal: mark all blocks reachable from a block (bounded by depth); returns the count */
+    int MarkPastSet(uint32_t n, int nMaxDepth, CDAGVisitSet& past) const;
 
-    /** Internal: collect blue set reachable from a block */
-    std::set<uint256> GetBlueSet(const uint256& hashBlock) const;
+    /** Internal: linear order from a known tip, as ordinals. */
+    void GetDAGLinearOrderNodes(uint32_t nTip, int nMaxBlocks, std::vector<uint32_t>& vOrder) const;
 
-    /** Internal: get all blocks reachable from a hash (bounded by depth) */
-    std::set<uint256> GetPastSet(const uint256& hashBlock, int nMaxDepth) const;
+    /** Internal: shared body of RebuildDAGOrder/RebuildDAGOrderIncremental. */
+    int RecolorAndOrder(int nAboveHeight);
 };
 
 
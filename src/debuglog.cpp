@@ -0,0 +1,395 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "debuglog.h"
+#include "util.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/** One logging thread's queue. Only the owning thread moves nHead and
+ * touches the line assembly fields; only the writer moves nTail. */
+class CDebugLogRing
+{
+public:
+    char vch[DEBUG_LOG_RING_BYTES];
+    std::atomic<uint64_t> nHead;
+    std::atomic<uint64_t> nTail;
+    std::atomic<uint64_t> nDropped;
+    std::atomic<uint64_t> nFullWaits;
+    std::atomic<bool> fClosed;
+
+    std::string strLine;        // text since the last newline
+    bool fStartedNewLine;
+    bool fDropping;             // the last line did not fit
+    int64_t nTimeCached;
+    std::string strTimeCached;
+
+    CDebugLogRing() : nHead(0), nTail(0), nDropped(0), nFullWaits(0), fClosed(false),
+                      fStartedNewLine(true), fDropping(false), nTimeCached(0) {}
+
+    bool HasRoom(size_t nSize) const
+    {
+        return nSize <= DEBUG_LOG_RING_BYTES - (nHead.load(std::memory_order_relaxed) -
+                                                nTail.load(std::memory_order_acquire));
+    }
+
+    void Push(const std::string& str)
+    {
+        if (!HasRoom(str.size()))
+        {
+            nDropped.fetch_add(1, std::memory_order_relaxed);
+            fDropping = true;
+            return;
+        }
+        fDropping = false;
+        uint64_t nWritten = nHead.load(std::memory_order_relaxed);
+        size_t nPos = nWritten % DEBUG_LOG_RING_BYTES;
+        size_t nFirst = std::min(str.size(), DEBUG_LOG_RING_BYTES - nPos);
+        memcpy(vch + nPos, str.data(), nFirst);
+        memcpy(vch, str.data() + nFirst, str.size() - nFirst);
+        nHead.store(nWritten + str.size(), std::memory_order_release);
+    }
+
+    size_t Used() const
+    {
+        return nHead.load(std::memory_order_relaxed) - nTail.load(std::memory_order_relaxed);
+    }
+};
+
+CDebugLogWriter::CDebugLogWriter() : ptrRing(&CDebugLogWriter::ReleaseRing)
+{
+    fRunning = false;
+    fStopping = false;
+    nProducers = 0;
+    for (unsigned int i = 0; i < DEBUG_LOG_MAX_RINGS; i++)
+        vRing[i] = NULL;
+    file = NULL;
+    fTimestamps = false;
+    pthread = NULL;
+    nLines = nBytes = nWrites = 0;
+    nDroppedReported = 0;
+    nDroppedExited = 0;
+    nFullWaitsExited = 0;
+}
+
+CDebugLogWriter::~CDebugLogWriter()
+{
+    Stop();
+    ptrRing.reset();
+
+    // Rings of threads still running are left to them: their exit marks the
+    // ring closed and must not touch freed memory
+    for (unsigned int i = 0; i < DEBUG_LOG_MAX_RINGS; i++)
+    {
+        CDebugLogRing* pring = vRing[i].load();
+        if (pring && pring->fClosed.load())
+            delete pring;
+    }
+}
+
+void CDebugLogWriter::ReleaseRing(CDebugLogRing* pring)
+{
+    // Thread exit: hand over any unfinished line, then let the writer free it
+    if (!pring->strLine.empty())
+        pring->Push(pring->strLine + "\n");
+    pring->fClosed.store(true, std::memory_order_release);
+}
+
+bool CDebugLogWriter::Start(FILE* fileIn, const std::string& strPathIn, bool fTimestampsIn)
+{
+    if (fRunning.load() || pthread || !fileIn)
+        return false;
+    file = fileIn;
+    strPath = strPathIn;
+    fTimestamps = fTimestampsIn;
+    fStopping = false;
+    try
+    {
+        pthread = new boost::thread(boost::bind(&CDebugLogWriter::ThreadWrite, this));
+    }
+    catch (boost::thread_resource_error&)
+    {
+        return false;
+    }
+    fRunning.store(true, std::memory_order_release);
+    return true;
+}
+
+void CDebugLogWriter::Stop()
+{
+    if (!fRunning.exchange(false))
+        return;
+
+    // Let appends that saw the writer running finish, so the last drain has them
+    while (nProducers.load() > 0)
+        boost::this_thread::yield();
+
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        fStopping = true;
+    }
+    cond.notify_all();
+    pthread->join();
+    delete pthread;
+    pthread = NULL;
+    fflush(file);
+}
+
+void CDebugLogWriter::PushLine(CDebugLogRing* pring, const std::string& str)
+{
+    // A full ring wakes the writer and waits a little for it, once: while
+    // the writer cannot keep up, lines are dropped without waiting
+    if (!pring->fDropping && !pring->HasRoom(str.size()))
+    {
+        int64_t nDeadline = GetTimeMillis() + DEBUG_LOG_FULL_WAIT_MS;
+        pring->nFullWaits.fetch_add(1, std::memory_order_relaxed);
+        cond.notify_one();
+        while (!pring->HasRoom(str.size()) && GetTimeMillis() < nDeadline)
+            boost::this_thread::yield();
+    }
+    pring->Push(str);
+}
+
+CDebugLogRing* CDebugLogWriter::GetRing()
+{
+    CDebugLogRing* pring = ptrRing.get();
+    if (pring)
+        return pring;
+
+    pring = new CDebugLogRing();
+    for (unsigned int i = 0; i < DEBUG_LOG_MAX_RINGS; i++)
+    {
+        CDebugLogRing* pempty = NULL;
+        if (vRing[i].compare_exchange_strong(pempty, pring))
+        {
+            ptrRing.reset(pring);
+            return pring;
+        }
+    }
+    delete pring;
+    return NULL;
+}
+
+bool CDebugLogWriter::Append(const std::string& str)
+{
+    if (!fRunning.load(std::memory_order_acquire))
+        return false;
+    nProducers.fetch_add(1);
+    if (!fRunning.load())
+    {
+        nProducers.fetch_sub(1);
+        return false;
+    }
+    CDebugLogRing* pring = GetRing();
+    if (!pring)
+    {
+        nProducers.fetch_sub(1);
+        return false;
+    }
+
+    // Only whole lines go to the ring, so lines of different threads never mix
+    size_t nPos = 0;
+    while (nPos < str.size())
+    {
+        if (pring->fStartedNewLine && fTimestamps)
+        {
+            int64_t nNow = GetTime();
+            if (nNow != pring->nTimeCached)
+            {
+                pring->nTimeCached = nNow;
+                pring->strTimeCached = DateTimeStrFormat("%Y-%m-%d %H:%M:%S", nNow) + " ";
+            }
+            pring->strLine += pring->strTimeCached;
+        }
+        size_t nEnd = str.find('\n', nPos);
+        if (nEnd == std::string::npos)
+        {
+            pring->strLine.append(str, nPos, std::string::npos);
+            pring->fStartedNewLine = false;
+            break;
+        }
+        pring->strLine.append(str, nPos, nEnd + 1 - nPos);
+        pring->fStartedNewLine = true;
+        PushLine(pring, pring->strLine);
+        pring->strLine.clear();
+        nPos = nEnd + 1;
+    }
+    if (pring->strLine.size() >= DEBUG_LOG_RING_BYTES / 4)
+    {
+        PushLine(pring, pring->strLine);
+        pring->strLine.clear();
+    }
+
+    bool fWake = pring->Used() >= DEBUG_LOG_RING_BYTES / 2;
+    nProducers.fetch_sub(1);
+    if (fWake)
+        cond.notify_one();
+    return true;
+}
+
+uint64_t CDebugLogWriter::Drain(std::string& strBatch)
+{
+    uint64_t nLinesDrained = 0;
+    for (unsigned int i = 0; i < DEBUG_LOG_MAX_RINGS; i++)
+    {
+        CDebugLogRing* pring = vRing[i].load(std::memory_order_acquire);
+        if (!pring)
+            continue;
+        bool fClosed = pring->fClosed.load(std::memory_order_acquire);
+        uint64_t nWritten = pring->nHead.load(std::memory_order_acquire);
+        uint64_t nRead = pring->nTail.load(std::memory_order_relaxed);
+        if (nWritten != nRead)
+        {
+            size_t nPos = nRead % DEBUG_LOG_RING_BYTES;
+            size_t nSize = nWritten - nRead;
+            size_t nFirst = std::min(nSize, DEBUG_LOG_RING_BYTES - nPos);
+            size_t nStart = strBatch.size();
+            strBatch.append(pring->vch + nPos, nFirst);
+            strBatch.append(pring->vch, nSize - nFirst);
+            nLinesDrained += std::count(strBatch.begin() + nStart, strBatch.end(), '\n');
+            pring->nTail.store(nWritten, std::memory_order_release);
+        }
+        if (fClosed)
+        {
+            {
+                boost::lock_guard<boost::mutex> lock(mutex);
+                vRing[i].store(NULL);
+                nDroppedExited += pring->nDropped.load();
+                nFullWaitsExited += pring->nFullWaits.load();
+            }
+            delete pring;
+        }
+    }
+    return nLinesDrained;
+}
+
+void CDebugLogWriter::ThreadWrite()
+{
+    RenameThread("innova-debuglog");
+
+    std::string strBatch;
+    while (true)
+    {
+        bool fStop = fStopping.load();
+        strBatch.clear();
+        uint64_t nLinesDrained = Drain(strBatch);
+
+        uint64_t nDropped = GetStats().nDropped;
+        if (nDropped != nDroppedReported)
+        {
+            if (fTimestamps)
+                strBatch += DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()) + " ";
+            strBatch += strprintf("debug.log: %llu lines dropped, log buffer full\n",
+                                  (unsigned long long)(nDropped - nDroppedReported));
+            nDroppedReported = nDropped;
+        }
+
+        // reopen the log file, if requested
+        if (fReopenDebugLog)
+        {
+            fReopenDebugLog = false;
+            if (freopen(strPath.c_str(), "a", file) != NULL)
+                setbuf(file, NULL); // unbuffered
+        }
+
+        if (!strBatch.empty())
+        {
+            // The file is unbuffered: one fwrite is one write
+            fwrite(strBatch.data(), 1, strBatch.size(), file);
+            boost::lock_guard<boost::mutex> lock(mutex);
+            nLines += nLinesDrained;
+            nBytes += strBatch.size();
+            nWrites++;
+        }
+
+        if (fStop)
+            break;
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (!fStopping.load())
+            cond.timed_wait(lock, boost::posix_time::milliseconds(DEBUG_LOG_FLUSH_MS));
+    }
+}
+
+void CDebugLogWriter::FlushForCrash()
+{
+    if (!file)
+        return;
+    int fd = fileno(file);
+    for (unsigned int i = 0; i < DEBUG_LOG_MAX_RINGS; i++)
+    {
+        CDebugLogRing* pring = vRing[i].load();
+        if (!pring)
+            continue;
+        uint64_t nWritten = pring->nHead.load();
+        uint64_t nRead = pring->nTail.load();
+        if (nWritten == nRead)
+            continue;
+        size_t nPos = nRead % DEBUG_LOG_RING_BYTES;
+        size_t nSize = nWritten - nRead;
+        size_t nFirst = std::min(nSize, DEBUG_LOG_RING_BYTES - nPos);
+        if (write(fd, pring->vch + nPos, nFirst) < 0 ||
+            write(fd, pring->vch, nSize - nFirst) < 0)
+            return;
+        pring->nTail.store(nWritten);
+    }
+}
+
+CDebugLogStats CDebugLogWriter::GetStats() const
+{
+    // Rings are only freed under the lock
+    boost::lock_guard<boost::mutex> lock(mutex);
+    CDebugLogStats stats;
+    stats.nLines = nLines;
+    stats.nBytes = nBytes;
+    stats.nWrites = nWrites;
+    stats.nDropped = nDroppedExited;
+    stats.nFullWaits = nFullWaitsExited;
+    for (unsigned int i = 0; i < DEBUG_LOG_MAX_RINGS; i++)
+    {
+        CDebugLogRing* pring = vRing[i].load();
+        if (pring)
+        {
+            stats.nDropped += pring->nDropped.load();
+            stats.nFullWaits += pring->nFullWaits.load();
+        }
+    }
+    return stats;
+}
+
+bool CLogRateLimiter::Admit(uint64_t nKey, const char* pszKey, unsigned int nLimit, int64_t nNow,
+                            uint32_t& nSuppressed, const char*& pszName)
+{
+    nSuppressed = 0;
+    CSlot& slot = vSlot[((nKey * 0x9e3779b97f4a7c15ULL) >> 32) % LOG_RATE_SLOTS];
+
+    const char* pszOwner = slot.pszKey.load(std::memory_order_relaxed);
+    if (pszOwner == NULL)
+    {
+        slot.pszKey.compare_exchange_strong(pszOwner, pszKey);
+        pszOwner = slot.pszKey.load();
+    }
+
+    // The first line of a new second resets the count and reports what the
+    // last second held back
+    int64_t nSecond = slot.nSecond.load(std::memory_order_relaxed);
+    if (nSecond != nNow && slot.nSecond.compare_exchange_strong(nSecond, nNow))
+    {
+        slot.nCount.store(0);
+        nSuppressed = slot.nSuppressed.exchange(0);
+        pszName = pszOwner;
+    }
+
+    if (slot.nCount.fetch_add(1, std::memory_order_relaxed) < nLimit)
+        return true;
+    slot.nSuppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
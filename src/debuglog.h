@@ -0,0 +1,125 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_DEBUGLOG_H
+#define INNOVA_DEBUGLOG_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#include <boost/thread.hpp>
+
+/** Bytes of queued log text each logging thread may hold */
+static const size_t DEBUG_LOG_RING_BYTES = 64 * 1024;
+/** Threads with a ring of their own; any others write synchronously */
+static const unsigned int DEBUG_LOG_MAX_RINGS = 256;
+/** Longest the writer thread waits before draining the rings */
+static const int DEBUG_LOG_FLUSH_MS = 50;
+/** Longest a thread with a full ring waits for the writer before dropping */
+static const int DEBUG_LOG_FULL_WAIT_MS = 20;
+/** Sources the rate limiter tells apart; more share slots */
+static const unsigned int LOG_RATE_SLOTS = 512;
+
+struct CDebugLogStats
+{
+    uint64_t nLines;        // lines taken from the rings
+    uint64_t nBytes;
+    uint64_t nWrites;       // batches handed to the file
+    uint64_t nDropped;      // lines lost to a full ring
+    uint64_t nFullWaits;    // appends that waited for room in a full ring
+};
+
+class CDebugLogRing;
+
+/** Background writer for debug.log.
+ *
+ * Each logging thread appends whole lines to a ring of its own with no lock:
+ * one producer, one consumer, two counters. The writer thread drains every
+ * ring into one buffer and hands it to the file in a single write, then
+ * waits up to DEBUG_LOG_FLUSH_MS. A thread whose ring is full wakes the
+ * writer and waits up to DEBUG_LOG_FULL_WAIT_MS; if the writer still cannot
+ * keep up the line is dropped and counted, and later lines are dropped
+ * without waiting until one fits again. Memory stays bounded, the caller
+ * is never held up for long, and the writer notes the count in the log.
+ * Lines from different threads keep their order per thread only.
+ */
+class CDebugLogWriter
+{
+public:
+    CDebugLogWriter();
+    ~CDebugLogWriter();
+
+    /** Start writing to file, reopened at strPath when fReopenDebugLog is set */
+    bool Start(FILE* file, const std::string& strPath, bool fTimestamps);
+    /** Drain every ring, write it out and stop the writer thread */
+    void Stop();
+    bool IsRunning() const { return fRunning.load(std::memory_order_acquire); }
+
+    /** Queue text from the calling thread. Returns false if the caller must
+     * write it itself: the writer is stopped or the thread got no ring. */
+    bool Append(const std::string& str);
+
+    /** Write whatever the rings hold straight to the file descriptor. Only
+     * uses write(2), for the fatal signal handlers. */
+    void FlushForCrash();
+
+    CDebugLogStats GetStats() const;
+
+private:
+    std::atomic<bool> fRunning;
+    std::atomic<bool> fStopping;
+    std::atomic<int> nProducers;
+    std::atomic<CDebugLogRing*> vRing[DEBUG_LOG_MAX_RINGS];
+    boost::thread_specific_ptr<CDebugLogRing> ptrRing;
+
+    FILE* file;
+    std::string strPath;
+    bool fTimestamps;
+    boost::thread* pthread;
+    mutable boost::mutex mutex;
+    boost::condition_variable cond;
+
+    uint64_t nLines;
+    uint64_t nBytes;
+    uint64_t nWrites;
+    uint64_t nDroppedReported;
+    uint64_t nDroppedExited;
+    uint64_t nFullWaitsExited;
+
+    CDebugLogRing* GetRing();
+    void PushLine(CDebugLogRing* pring, const std::string& str);
+    uint64_t Drain(std::string& strBatch);
+    void ThreadWrite();
+
+    static void ReleaseRing(CDebugLogRing* pring);
+
+    CDebugLogWriter(const CDebugLogWriter&);
+    CDebugLogWriter& operator=(const CDebugLogWriter&);
+};
+
+/** Fixed table of per-second line counts with no lock. Sources that hash to
+ * the same slot share its budget. Zero-initialized, so a static instance is
+ * usable before and after global constructors and destructors run. */
+class CLogRateLimiter
+{
+public:
+    /** Whether a line from the source may be logged now. When the source's
+     * previous second ended with lines held back, nSuppressed is set to how
+     * many and pszName to the source that claimed the slot. */
+    bool Admit(uint64_t nKey, const char* pszKey, unsigned int nLimit, int64_t nNow,
+               uint32_t& nSuppressed, const char*& pszName);
+
+private:
+    struct CSlot
+    {
+        std::atomic<const char*> pszKey;
+        std::atomic<int64_t> nSecond;
+        std::atomic<uint32_t> nCount;
+        std::atomic<uint32_t> nSuppressed;
+    };
+    CSlot vSlot[LOG_RATE_SLOTS];
+};
+
+#endif
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "finality.h"
+#include "finalityverify.h"
 #include "main.h"
 #include "init.h"
 #include "wallet.h"
@@ -5599,17 +5600,12 @@ bool ProcessMessageFinality(CNode* pfrom, const std::string& strCommand, CDataSt
             return false;
         }
 
-        if (g_finalityTracker.AddVote(vote))
-        {
-            LOCK(cs_vNodes);
-            for (CNode* pnode : vNodes)
-            {
-                if (pnode == pfrom)
-                    continue;
-                pnode->PushMessage("fvote", vote);
-            }
-        }
+        // Private votes carry the expensive FCMP and NullStake kernel proofs;
+        // hand them to the verification workers instead of stalling this thread.
+        if (vote.IsPrivate() && g_finalityVerifyQueue.Push(vote, pfrom->GetId()))
+            return true;
 
+        AcceptRelayedFinalityVote(vote, pfrom->GetId());
         return true;
     }
     else if (strCommand == "ftshare")
@@ -5629,20 +5625,11 @@ bool ProcessMessageFinality(CNode* pfrom, const std::string& strCommand, CDataSt
         if (share.nEpoch > nCurrentEpoch + 2)
             return false;
 
-        if (g_finalityTracker.AddTallyShare(share))
-        {
-            CTxDB txdb("r+");
-            txdb.WriteFinalityTallyShare(share.GetHash(), share);
-
-            LOCK(cs_vNodes);
-            for (CNode* pnode : vNodes)
-            {
-                if (pnode == pfrom)
-                    continue;
-                pnode->PushMessage("ftshare", share);
-            }
-        }
+        // A share whose vote is still being verified would not resolve yet.
+        if (g_finalityVerifyQueue.DeferTallyShare(share, pfrom->GetId()))
+            return true;
 
+        AcceptRelayedFinalityTallyShare(share, pfrom->GetId());
         return true;
     }
     else if (strCommand == "ftpart")
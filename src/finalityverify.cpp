@@ -0,0 +1,381 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#include "finalityverify.h"
+
+#include "dag.h"
+#include "main.h"
+#include "txdb.h"
+#include "util.h"
+#include "zkproof.h"
+
+#include <boost/thread/locks.hpp>
+
+using namespace std;
+
+CFinalityVerifyQueue g_finalityVerifyQueue;
+
+namespace {
+
+// Finalized curve-tree root the queued votes are anchored to. Rebuilding the
+// snapshot is the costliest non-proof step of a private vote check, so the
+// workers share the last one they loaded.
+CCriticalSection cs_verifyRoot;
+int nVerifyRootEpoch = -1;
+uint256 hashVerifyRoot;
+CCurveTreeNode verifyRoot;
+
+bool GetFinalizedVerifyRoot(const CEpochState& state, CCurveTreeNode& rootOut)
+{
+    {
+        LOCK(cs_verifyRoot);
+        if (nVerifyRootEpoch == state.nEpoch && hashVerifyRoot == state.hashCurveRoot)
+        {
+            rootOut = verifyRoot;
+            return true;
+        }
+    }
+
+    CTxDB txdb("r");
+    CCurveTree tree;
+    if (!txdb.ReadCurveTreeAtEpoch(state.nEpoch, tree))
+        return false;
+    if (!tree.IsEmpty())
+        tree.RebuildParentNodes();
+    if (tree.GetRoot() != state.hashCurveRoot)
+        return false;
+    rootOut = tree.GetRootNode();
+
+    LOCK(cs_verifyRoot);
+    nVerifyRootEpoch = state.nEpoch;
+    hashVerifyRoot = state.hashCurveRoot;
+    verifyRoot = rootOut;
+    return true;
+}
+
+// Per-vote context resolved under cs_main before the proofs are checked.
+struct CVoteProofContext
+{
+    bool fUsable;
+    unsigned int nBits;
+    int nEpochHeight;
+    CPedersenCommitment membershipLeaf;
+};
+
+} // namespace
+
+CFinalityVerifyQueue::CFinalityVerifyQueue() : nThreads(0), fQuit(false)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool CFinalityVerifyQueue::Push(const CFinalityVote& vote, NodeId nFrom)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (nThreads == 0 || fQuit)
+        return false;
+
+    CVerifyJob job;
+    job.hashVote = vote.GetHash();
+    if (setQueuedVotes.count(job.hashVote))
+    {
+        stats.nDuplicates++;
+        return true;
+    }
+    if (queue.size() >= MAX_FINALITY_VERIFY_QUEUE)
+    {
+        stats.nOverflows++;
+        return false;
+    }
+
+    job.vote = vote;
+    job.nFrom = nFrom;
+    job.nTimeQueued = GetTimeMicros();
+    queue.push_back(job);
+    setQueuedVotes.insert(job.hashVote);
+    setQueuedNullifiers.insert(vote.nullifier);
+    stats.nQueued++;
+    stats.nPeakQueueDepth = std::max(stats.nPeakQueueDepth, (unsigned int)queue.size());
+    condWorker.notify_one();
+    return true;
+}
+
+bool CFinalityVerifyQueue::DeferTallyShare(const CFinalityTallyShare& share, NodeId nFrom)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (!setQueuedNullifiers.count(share.voteNullifier))
+        return false;
+    if (mapDeferredShares.size() >= MAX_FINALITY_VERIFY_QUEUE)
+        return false;
+    mapDeferredShares.insert(make_pair(share.voteNullifier, make_pair(share, nFrom)));
+    return true;
+}
+
+void CFinalityVerifyQueue::Thread()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        stats.nRunning++;
+    }
+    while (true)
+    {
+        vector<CVerifyJob> vBatch;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty() && !fQuit)
+                condWorker.wait(lock);
+            if (fQuit)
+            {
+                stats.nRunning--;
+                return;
+            }
+
+            // Split the backlog evenly over the workers so a boundary burst
+            // keeps them all busy, but batch enough to make the combined FCMP
+            // check worthwhile.
+            unsigned int nTake = std::max(1U, std::min(FINALITY_VERIFY_BATCH_SIZE,
+                                                       (unsigned int)queue.size() / (unsigned int)nThreads));
+            for (unsigned int i = 0; i < nTake; i++)
+            {
+                vBatch.push_back(queue.front());
+                queue.pop_front();
+            }
+            stats.nInFlight += vBatch.size();
+            stats.nBatches++;
+        }
+        ProcessBatch(vBatch);
+    }
+}
+
+void CFinalityVerifyQueue::ProcessBatch(vector<CVerifyJob>& vBatch)
+{
+    int64_t nStart = GetTimeMicros();
+
+    // Resolve the epoch blocks and the finalized anchor. This mirrors the
+    // relay-time (nContextHeight < 0) branch of CFinalityTracker::CheckVote so
+    // the proofs below are verified with the very arguments CheckVote will
+    // use; a mismatch costs a cache miss, never a wrong verdict.
+    vector<CVoteProofContext> vContext(vBatch.size());
+    CEpochState finalizedState;
+    bool fHaveFinalized = false;
+    {
+        LOCK(cs_main);
+        for (unsigned int i = 0; i < vBatch.size(); i++)
+        {
+            const CFinalityVote& vote = vBatch[i].vote;
+            CVoteProofContext& ctx = vContext[i];
+            ctx.fUsable = false;
+            map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(vote.hashBlock);
+            if (mi == mapBlockIndex.end() || mi->second->nHeight != vote.nHeight)
+                continue;
+            if (vote.privateProof.hashEpochBlock != vote.hashBlock ||
+                vote.privateProof.nEpoch != vote.nEpoch ||
+                vote.privateProof.nullifier != vote.nullifier ||
+                !vote.privateProof.IsValidBasic())
+                continue;
+            ctx.nBits = mi->second->nBits;
+            ctx.nEpochHeight = mi->second->nHeight;
+            ctx.fUsable = true;
+        }
+        fHaveFinalized = g_dagManager.GetLastFinalizedEpochState(finalizedState);
+    }
+
+    CCurveTreeNode root;
+    if (!fHaveFinalized || !GetFinalizedVerifyRoot(finalizedState, root))
+        fHaveFinalized = false;
+
+    vector<CFCMPProof> vFCMP;
+    vector<CPedersenCommitment> vLeaves;
+    for (unsigned int i = 0; i < vBatch.size(); i++)
+    {
+        const CPrivateFinalityVoteProof& proof = vBatch[i].vote.privateProof;
+        CVoteProofContext& ctx = vContext[i];
+        if (!ctx.fUsable)
+            continue;
+        ctx.membershipLeaf = proof.stakeWeightCommitment;
+        if (vBatch[i].vote.nProofMode == FINALITY_PROOF_NULLSTAKE_V3_COLD &&
+            !NullStakeMofNReconstructLeaf(proof.stakeWeightCommitment,
+                                          proof.nullStakeV3Proof.delegationHash,
+                                          ctx.membershipLeaf))
+        {
+            ctx.fUsable = false;
+            continue;
+        }
+        if (fHaveFinalized &&
+            proof.hashCurveRoot == finalizedState.hashCurveRoot &&
+            proof.hashNullifierRoot == finalizedState.hashNullifierRoot)
+        {
+            vFCMP.push_back(proof.fcmpProof);
+            vLeaves.push_back(ctx.membershipLeaf);
+        }
+    }
+
+    // Successful FCMP proofs are stored in the verify cache by the batch
+    // verifier. If any proof in the batch is bad the rest are left to the
+    // serial verifier inside CheckVote.
+    if (!vFCMP.empty() && BatchVerifyFCMPProofs(root, vFCMP, vLeaves))
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        stats.nFCMPBatched += vFCMP.size();
+    }
+
+    for (unsigned int i = 0; i < vBatch.size(); i++)
+    {
+        const CFinalityVote& vote = vBatch[i].vote;
+        const CPrivateFinalityVoteProof& proof = vote.privateProof;
+        const CVoteProofContext& ctx = vContext[i];
+        if (!ctx.fUsable)
+            continue;
+
+        bool fKernelOk = true;
+        if (vote.nProofMode == FINALITY_PROOF_NULLSTAKE_V2)
+            fKernelOk = VerifyNullStakeKernelProofV2(proof.nullStakeV2Proof, proof.stakeWeightCommitment, ctx.nBits);
+        else if (vote.nProofMode == FINALITY_PROOF_NULLSTAKE_V3_COLD)
+            fKernelOk = VerifyNullStakeKernelProofV3(proof.nullStakeV3Proof, ctx.membershipLeaf, ctx.nBits);
+
+        if (fKernelOk && ctx.nEpochHeight >= FORK_HEIGHT_NULLIFIER_BINDING &&
+            proof.vchNullifierPoint.size() == NULLIFIER_POINT_SIZE &&
+            proof.vchNullifierBindingProof.size() == NULLIFIER_BINDING_PROOF_SIZE)
+        {
+            VerifyNullifierBindingProof(proof.stakeWeightCommitment, proof.vchNullifierPoint,
+                                        FinalityNullifierBindContext(vote.nEpoch, vote.hashBlock),
+                                        proof.vchNullifierBindingProof);
+        }
+    }
+
+    int64_t nVerified = GetTimeMicros();
+
+    // Every proof that passed is now cached; AddVote re-runs the contextual
+    // checks and admits the vote to the pending set.
+    for (unsigned int i = 0; i < vBatch.size(); i++)
+    {
+        const CVerifyJob& job = vBatch[i];
+        bool fAccepted = AcceptRelayedFinalityVote(job.vote, job.nFrom);
+
+        vector<pair<CFinalityTallyShare, NodeId> > vShares;
+        int64_t nLatency = GetTimeMicros() - job.nTimeQueued;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            setQueuedVotes.erase(job.hashVote);
+            setQueuedNullifiers.erase(setQueuedNullifiers.find(job.vote.nullifier));
+            if (!setQueuedNullifiers.count(job.vote.nullifier))
+            {
+                multimap<uint256, pair<CFinalityTallyShare, NodeId> >::iterator it =
+                    mapDeferredShares.lower_bound(job.vote.nullifier);
+                while (it != mapDeferredShares.end() && it->first == job.vote.nullifier)
+                {
+                    vShares.push_back(it->second);
+                    mapDeferredShares.erase(it++);
+                }
+            }
+            stats.nInFlight--;
+            if (fAccepted)
+                stats.nAccepted++;
+            else
+                stats.nRejected++;
+            stats.nLastLatencyUs = nLatency;
+            stats.nMaxLatencyUs = std::max(stats.nMaxLatencyUs, nLatency);
+            stats.nTotalLatencyUs += nLatency;
+        }
+
+        for (unsigned int j = 0; j < vShares.size(); j++)
+            AcceptRelayedFinalityTallyShare(vShares[j].first, vShares[j].second);
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        stats.nTotalVerifyUs += nVerified - nStart;
+    }
+
+    if (fDebug)
+        printf("FinalityVerify: batch of %u votes, %u FCMP batched, proofs %.2fms, total %.2fms\n",
+               (unsigned int)vBatch.size(), (unsigned int)vFCMP.size(),
+               (nVerified - nStart) * 0.001, (GetTimeMicros() - nStart) * 0.001);
+}
+
+bool AcceptRelayedFinalityVote(const CFinalityVote& vote, NodeId nFrom)
+{
+    if (!g_finalityTracker.AddVote(vote))
+        return false;
+
+    LOCK(cs_vNodes);
+    BOOST_FOREACH(CNode* pnode, vNodes)
+    {
+        if (pnode->GetId() == nFrom)
+            continue;
+        pnode->PushMessage("fvote", vote);
+    }
+    return true;
+}
+
+bool AcceptRelayedFinalityTallyShare(const CFinalityTallyShare& share, NodeId nFrom)
+{
+    if (!g_finalityTracker.AddTallyShare(share))
+        return false;
+
+    CTxDB txdb("r+");
+    txdb.WriteFinalityTallyShare(share.GetHash(), share);
+
+    LOCK(cs_vNodes);
+    BOOST_FOREACH(CNode* pnode, vNodes)
+    {
+        if (pnode->GetId() == nFrom)
+            continue;
+        pnode->PushMessage("ftshare", share);
+    }
+    return true;
+}
+
+void CFinalityVerifyQueue::Start(int nThreadsIn)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nThreads = nThreadsIn;
+    }
+    for (int i = 0; i < nThreadsIn; i++)
+        NewThread(ThreadFinalityVerify, this);
+}
+
+void CFinalityVerifyQueue::Interrupt()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fQuit = true;
+    for (unsigned int i = 0; i < queue.size(); i++)
+    {
+        setQueuedVotes.erase(queue[i].hashVote);
+        setQueuedNullifiers.erase(setQueuedNullifiers.find(queue[i].vote.nullifier));
+    }
+    queue.clear();
+
+    // Shares for a vote in flight are still handed on when it is done
+    multimap<uint256, pair<CFinalityTallyShare, NodeId> >::iterator it = mapDeferredShares.begin();
+    while (it != mapDeferredShares.end())
+    {
+        if (setQueuedNullifiers.count(it->first))
+            ++it;
+        else
+            mapDeferredShares.erase(it++);
+    }
+    condWorker.notify_all();
+}
+
+bool CFinalityVerifyQueue::IsRunning() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return nThreads > 0 && !fQuit;
+}
+
+void CFinalityVerifyQueue::GetStats(CFinalityVerifyStats& statsOut) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    statsOut = stats;
+    statsOut.nQueueDepth = queue.size();
+    statsOut.nDeferredShares = mapDeferredShares.size();
+    statsOut.nThreads = nThreads;
+}
+
+void ThreadFinalityVerify(void* parg)
+{
+    RenameThread("innova-finverify");
+    ((CFinalityVerifyQueue*)parg)->Thread();
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_FINALITYVERIFY_H
+#define INNOVA_FINALITYVERIFY_H
+
+#include "finality.h"
+#include "net.h"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+// Background verification of relayed private finality votes.
+//
+// A private vote carries an FCMP membership proof and a NullStake V2/V3 kernel
+// proof; verifying them on the message thread stalls every peer at each epoch
+// boundary. Relayed private votes are queued here instead. Worker threads take
+// them in batches, settle the FCMP proofs of a batch with one combined IPA
+// check, verify the kernel and nullifier-binding proofs outside cs_main, then
+// hand each vote to CFinalityTracker::AddVote. By then every successful proof
+// is in the verify-once cache (verifycache.h), so AddVote -- and ConnectBlock
+// when the vote is mined -- only re-runs the cheap contextual checks.
+//
+// The pre-verification never decides anything: it only fills the cache, whose
+// keys are the exact verifier arguments. A vote that fails, or whose context
+// changed while it was queued, is simply verified again in full by AddVote.
+
+static const int MAX_FINALITY_VERIFY_THREADS = 16;
+static const int DEFAULT_FINALITY_VERIFY_THREADS = 4;
+// Votes beyond this many are verified inline on the message thread, as before.
+static const unsigned int MAX_FINALITY_VERIFY_QUEUE = 4096;
+static const unsigned int FINALITY_VERIFY_BATCH_SIZE = 16;
+
+struct CFinalityVerifyStats
+{
+    unsigned int nQueueDepth;      // votes waiting for a worker
+    unsigned int nInFlight;        // votes taken by a worker and not yet done
+    unsigned int nPeakQueueDepth;
+    unsigned int nDeferredShares;  // tally shares waiting for their vote
+    int nThreads;
+    int nRunning;                  // workers inside Thread()
+    uint64_t nQueued;
+    uint64_t nDuplicates;          // same vote already queued from another peer
+    uint64_t nOverflows;           // queue full: verified inline instead
+    uint64_t nAccepted;
+    uint64_t nRejected;
+    uint64_t nBatches;
+    uint64_t nFCMPBatched;         // FCMP proofs settled by a combined check
+    int64_t nLastLatencyUs;        // enqueue -> AddVote done
+    int64_t nMaxLatencyUs;
+    int64_t nTotalLatencyUs;
+    int64_t nTotalVerifyUs;        // time spent in workers' proof checks
+};
+
+class CFinalityVerifyQueue
+{
+public:
+    CFinalityVerifyQueue();
+
+    /** Queue a relayed private vote. Returns false if the service is not
+     *  running or the queue is full; the caller then verifies inline. */
+    bool Push(const CFinalityVote& vote, NodeId nFrom);
+
+    /** Hold a tally share whose vote is still queued, so it is accepted
+     *  after the vote rather than rejected as unresolvable. Returns false if
+     *  its vote is not queued. */
+    bool DeferTallyShare(const CFinalityTallyShare& share, NodeId nFrom);
+
+    /** Worker loop; returns once Interrupt() has been called. */
+    void Thread();
+
+    void Start(int nThreadsIn);
+    /** Refuse new votes and let the workers exit once their batches are
+     *  done. Votes still queued, and the shares waiting on them, are
+     *  dropped. */
+    void Interrupt();
+    bool IsRunning() const;
+
+    void GetStats(CFinalityVerifyStats& stats) const;
+
+private:
+    struct CVerifyJob
+    {
+        CFinalityVote vote;
+        uint256 hashVote;
+        NodeId nFrom;
+        int64_t nTimeQueued;
+    };
+
+    mutable boost::mutex mutex;
+    boost::condition_variable condWorker;
+    std::deque<CVerifyJob> queue;
+    std::set<uint256> setQueuedVotes;
+    std::multiset<uint256> setQueuedNullifiers;    // queued or in flight
+    std::multimap<uint256, std::pair<CFinalityTallyShare, NodeId> > mapDeferredShares;
+    int nThreads;
+    bool fQuit;
+    CFinalityVerifyStats stats;
+
+    void ProcessBatch(std::vector<CVerifyJob>& vBatch);
+};
+
+extern CFinalityVerifyQueue g_finalityVerifyQueue;
+
+/** Add a relayed vote to the tracker and pass it on to every peer but nFrom. */
+bool AcceptRelayedFinalityVote(const CFinalityVote& vote, NodeId nFrom);
+
+/** Add a relayed tally share, persist it and pass it on to every peer but nFrom. */
+bool AcceptRelayedFinalityTallyShare(const CFinalityTallyShare& share, NodeId nFrom);
+
+/** -finalityverifythreads worker thread entry point; parg is the queue. */
+void ThreadFinalityVerify(void* parg);
+
+#endif // INNOVA_FINALITYVERIFY_H
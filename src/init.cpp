@@ -8,6 +8,7 @@
 #include "init.h"
 #include "main.h"
 #include "txdb.h"
+#include "txcache.h"
 #include "walletdb.h"
 #include "innovarpc.h"
 #include "net.h"
@@ -25,8 +26,11 @@
 #include "idns.h"
 #include "bootstrap.h"
 #include "zkproof.h"
+#include "msm.h"
+#include "blockimport.h"
 #include "dandelion.h"
 #include "finality.h"
+#include "finalityverify.h"
 #include "dag.h"
 
 #ifdef USE_NATIVETOR
@@ -130,6 +134,9 @@ void Shutdown(void* parg)
         fShutdown = true;
 
         CZKContext::Shutdown();
+        InterruptScriptCheck();
+        g_finalityVerifyQueue.Interrupt();
+        InterruptRPCWorkers();
 
         if (fHybridSPV && pwalletMain)
         {
@@ -166,6 +173,7 @@ void Shutdown(void* parg)
         NewThread(ExitTimeout, NULL);
         MilliSleep(50);
         printf("Innova exited\n\n");
+        StopDebugLogWriter();
         fExit = true;
 #ifndef QT_GUI
         // ensure non-UI client gets exited here, but let Bitcoin-Qt reach 'return 0;' in bitcoin.cpp
@@ -510,8 +518,10 @@ std::string HelpMessage()
         "  -pid=<file>            " + _("Specify pid file (default: innovad.pid)") + "\n" +
         "  -datadir=<dir>         " + _("Specify data directory") + "\n" +
         "  -wallet=<dir>          " + _("Specify wallet file (within data directory)") + "\n" +
-        "  -dbcache=<n>           " + _("Set database cache size in megabytes (default: 300)") + "\n" +
+        "  -dbcache=<n>           " + _("Set database cache size in megabytes, a quarter of it for decoded transactions (default: 300)") + "\n" +
         "  -dblogsize=<n>         " + _("Set database disk log size in megabytes (default: 100)") + "\n" +
+        "  -par=<n>               " + strprintf(_("Set the number of script verification threads (up to %d, 0 = auto, <0 = leave that many cores free, default: 0)"), MAX_SCRIPTCHECK_THREADS) + "\n" +
+        "  -msmthreads=<n>        " + strprintf(_("Threads one large proof verification may use (up to %d, 0 = auto, <0 = leave that many cores free, default: 1)"), MAX_MSM_THREADS) + "\n" +
         "  -timeout=<n>           " + _("Specify connection timeout in milliseconds (default: 5000)") + "\n" +
         "  -proxy=<ip:port>       " + _("Connect through socks proxy") + "\n" +
         "  -socks=<n>             " + _("Select the version of socks proxy to use (4-5, default: 5)") + "\n" +
@@ -538,6 +548,7 @@ std::string HelpMessage()
         "  -finalitytallypubkey=<key> " + _("Advertise a finality tally committee public key") + "\n" +
         "  -finalitytallyprivkey=<key> " + _("Enable local finality tally share handling with a private key") + "\n" +
         "  -finalitytallythreshold=<m-of-n> " + _("Finality tally committee threshold descriptor") + "\n" +
+        "  -finalityverifythreads=<n> " + strprintf(_("Number of threads verifying relayed private finality votes (up to %d, 0 = verify on the message thread, default: %d)"), MAX_FINALITY_VERIFY_THREADS, DEFAULT_FINALITY_VERIFY_THREADS) + "\n" +
 
         "\n" + _("SPV (Light Client) options:") + "\n" +
         "  -spv                   " + _("Run in SPV mode (light client, headers only)") + "\n" +
@@ -557,6 +568,7 @@ std::string HelpMessage()
         "  -softbantime=<n>       " + _("Number of seconds to keep soft banned peers from reconnecting (default: 3600)") + "\n" +
         "  -maxreceivebuffer=<n>  " + _("Maximum per-connection receive soft buffer, <n>*1000 bytes (default: 50000)") + "\n" +
         "  -maxsendbuffer=<n>     " + _("Maximum per-connection send buffer, <n>*1000 bytes (default: 10000)") + "\n" +
+        "  -rawblockcache=<n>     " + _("Keep recently served blocks for getdata in memory, <n> megabytes (default: 16)") + "\n" +
 #ifdef USE_UPNP
 #if USE_UPNP
         "  -upnp                  " + _("Use UPnP to map the listening port (default: 1 when listening)") + "\n" +
@@ -579,6 +591,8 @@ std::string HelpMessage()
         "  -debugnet              " + _("Output extra network debugging information") + "\n" +
         "  -debugchain            " + _("Output extra blockchain debugging information") + "\n" +
         "  -logtimestamps         " + _("Prepend debug output with timestamp") + "\n" +
+        "  -logasync              " + _("Write debug.log from a background thread (default: 1)") + "\n" +
+        "  -lograte=<n>           " + _("Log at most <n> lines per second from one call site or -debug category (default: 0, no limit)") + "\n" +
         "  -shrinkdebugfile       " + _("Shrink debug.log file on client startup (default: 1 when no -debug)") + "\n" +
         "  -printtoconsole        " + _("Send trace/debug info to console instead of debug.log file") + "\n" +
 #ifdef WIN32
@@ -588,6 +602,9 @@ std::string HelpMessage()
         "  -rpcpassword=<pw>      " + _("Password for JSON-RPC connections") + "\n" +
         "  -rpcport=<port>        " + _("Listen for JSON-RPC connections on <port> (default: 14531 or testnet: 15531)") + "\n" +
         "  -rpcallowip=<ip>       " + _("Allow JSON-RPC connections from specified IP address") + "\n" +
+        "  -rpcthreads=<n>        " + _("Number of threads to service RPC calls (default: 4)") + "\n" +
+        "  -rpcworkqueue=<n>      " + _("Connections that may wait for an RPC thread before new ones are refused (default: 16)") + "\n" +
+        "  -rpcservertimeout=<n>  " + _("Seconds an RPC thread waits for a request on an idle connection (default: 30)") + "\n" +
         "  -rpcconnect=<ip>       " + _("Send commands to node running on <ip> (default: 127.0.0.1)") + "\n" +
         "  -disablerpchelp        " + _("Disable full RPC command listing in help (security)") + "\n" +
         "  -blocknotify=<cmd>     " + _("Execute command when the best block changes (%s in cmd is replaced by block hash)") + "\n" +
@@ -601,10 +618,15 @@ std::string HelpMessage()
         "  -zapwallettxes         " + _("Clear list of wallet transactions (diagnostic tool; implies -rescan)") + "\n" +
         "  -salvagewallet         " + _("Attempt to recover private keys from a corrupt wallet.dat") + "\n" +
         "  -checkblocks=<n>       " + _("How many blocks to check at startup (default: 2500, 0 = all)") + "\n" +
+        "  -blockindexsnapshot    " + _("Save the block index at shutdown and load it from there at the next start (default: 1)") + "\n" +
         "  -checklevel=<n>        " + _("How thorough the block verification is (0-6, default: 1)") + "\n" +
         "  -loadblock=<file>      " + _("Imports blocks from external blk000?.dat file") + "\n" +
         "  -replayblocks=<dir>    " + _("Replay every blkNNNN.dat in <dir> through full validation (implies -fullreplayverify), then exit") + "\n" +
+        "  -importthreads=<n>     " + strprintf(_("Threads deserializing blocks for -loadblock, -replayblocks and bootstrap.dat (up to %d, 0 = auto, <0 = leave that many cores free, default: 0)"), IMPORT_MAX_THREADS) + "\n" +
         "  -fullreplayverify      " + _("Force full ECDSA verification of all historic blocks (no checkpoint signature skip)") + "\n" +
+        "  -addrindex             " + _("Maintain an index of transactions by address, for searchrawtransactions and getaddresssummary (default: 0)") + "\n" +
+        "  -reindexaddr           " + _("Rebuild the address index from the block chain on startup (implies -addrindex)") + "\n" +
+        "  -addrindexthreads=<n>  " + strprintf(_("Threads reading blocks for -reindexaddr (up to %d, 0 = auto, <0 = leave that many cores free, default: 0)"), ADDRINDEX_MAX_THREADS) + "\n" +
         "  -acceptepochstate      " + _("Grandfather pre-marker epoch-state records as deterministic (only if they were written by a deterministic-anchor build; otherwise resync)") + "\n" +
 
         "\n" + _("Block creation options:") + "\n" +
@@ -613,7 +635,8 @@ std::string HelpMessage()
         "  -blockprioritysize=<n> "   + _("Set maximum size of high-priority/low-fee transactions in bytes (default: 27000)") + "\n" +
         "  -maxorphantx=<n>       "   + strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS) + "\n" +
         "  -maxorphanblocks=<n>   "   + strprintf(_("Keep at most <n> unconnectable blocks in memory (default: %u)"), DEFAULT_MAX_ORPHAN_BLOCKS) + "\n" +
-        "  -maxmempool=<n>        "   + strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE) + "\n" +
+        "  -maxmempool=<n>        "   + strprintf(_("Keep the transaction memory pool below <n> megabytes, evicting the lowest fee rate first (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE) + "\n" +
+        "  -limitancestorcount=<n> "  + strprintf(_("Refuse transactions with more than <n> unconfirmed ancestors, themselves included (default: %u)"), DEFAULT_ANCESTOR_LIMIT) + "\n" +
 
         "\n" + _("SSL options: (see the Bitcoin Wiki for SSL setup instructions)") + "\n" +
         "  -rpcssl                                  " + _("Use OpenSSL (https) for JSON-RPC connections") + "\n" +
@@ -708,7 +731,30 @@ bool AppInit2()
     // ********************************************************* Step 2: parameter interactions
 
     nNodeLifespan = GetArg("-addrlifespan", 7);
+
+    // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
+    nScriptCheckThreads = GetArg("-par", 0);
+    if (nScriptCheckThreads <= 0)
+        nScriptCheckThreads += boost::thread::hardware_concurrency();
+    if (nScriptCheckThreads <= 1)
+        nScriptCheckThreads = 0;
+    else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
+        nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
+
+    // Proofs are usually checked on the script threads already, so splitting
+    // one multiplication further is opt-in
+    int nMSMThreadsArg = GetArg("-msmthreads", 1);
+    if (nMSMThreadsArg <= 0)
+        nMSMThreadsArg += boost::thread::hardware_concurrency();
+    nMSMThreads = std::max(1, std::min((int)MAX_MSM_THREADS, nMSMThreadsArg));
+
+    int nImportThreadsArg = GetArg("-importthreads", 0);
+    if (nImportThreadsArg <= 0)
+        nImportThreadsArg += boost::thread::hardware_concurrency();
+    nImportThreads = std::max(1, std::min((int)IMPORT_MAX_THREADS, nImportThreadsArg));
+
     fUseFastIndex = GetBoolArg("-fastindex", true);
+    fAddrIndex = GetBoolArg("-addrindex", false) || GetBoolArg("-reindexaddr", false);
     nMinStakeInterval = std::max((int64_t)0, std::min((int64_t)600, GetArg("-minstakeinterval", 30)));
     nMinerSleep = std::max((int64_t)100, std::min((int64_t)60000, GetArg("-minersleep", 5000)));
 
@@ -969,6 +1015,7 @@ bool AppInit2()
     fPrintToConsole = GetBoolArg("-printtoconsole");
     fPrintToDebugger = GetBoolArg("-printtodebugger");
     fLogTimestamps = GetBoolArg("-logtimestamps");
+    nLogRateLimit = std::max(0, (int)GetArg("-lograte", 0));
 
     if (mapArgs.count("-timeout"))
     {
@@ -1020,6 +1067,8 @@ bool AppInit2()
     hooks = InitHook(); //Initialized Innova Name Hooks
     if (GetBoolArg("-shrinkdebugfile", !fDebug))
         ShrinkDebugFile();
+    if (GetBoolArg("-logasync", true))
+        StartDebugLogWriter();
     printf("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
     printf("Innova version %s (%s)\n", FormatFullVersion().c_str(), CLIENT_DATE.c_str());
 #if (OPENSSL_VERSION_NUMBER < 0x10100000L) //WIP OpenSSL 1.0.x only, OpenSSL 1.1 not supported yet
@@ -1067,6 +1116,13 @@ bool AppInit2()
         return InitError("initialiseRingSigs() failed.");
 
 
+    if (nScriptCheckThreads)
+    {
+        printf("Using %d threads for script verification\n", nScriptCheckThreads);
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            NewThread(ThreadScriptCheck, NULL);
+    }
+
     // ********************************************************* Step 5: verify database integrity
 
     uiInterface.InitMessage(_("Verifying database integrity..."));
@@ -1105,6 +1161,7 @@ bool AppInit2()
     // ********************************************************* Step 6: network initialization
 
     nBloomFilterElements = GetArg("-bloomfilterelements", 1536);
+    g_rawBlockCache.SetMaxSize((uint64_t)std::max((int64_t)0, GetArg("-rawblockcache", 16)) * 1048576);
 
     int nSocksVersion = GetArg("-socks", 5);
 
@@ -1813,6 +1870,16 @@ bool AppInit2()
 
     NewThread(ThreadNullSend, NULL);
 
+    {
+        int nFinalityVerifyThreads = std::max(0, std::min(MAX_FINALITY_VERIFY_THREADS,
+                                                          (int)GetArg("-finalityverifythreads", DEFAULT_FINALITY_VERIFY_THREADS)));
+        if (nFinalityVerifyThreads)
+        {
+            printf("Using %d threads for finality vote verification\n", nFinalityVerifyThreads);
+            g_finalityVerifyQueue.Start(nFinalityVerifyThreads);
+        }
+    }
+
     if (!GetBoolArg("-nofinalityvoting", false))
         NewThread(ThreadFinalityVoter, NULL);
 
@@ -1902,21 +1969,11 @@ bool AppInit2()
     if(GetBoolArg("-reindexaddr", false))
     {
         uiInterface.InitMessage(_("Rebuilding address index..."));
-        nStart = GetTimeMillis();
-        CBlockIndex *pblockAddrIndex = pindexBest;
-    CTxDB txdbAddr("rw");
-    while(pblockAddrIndex)
-    {
-        uiInterface.InitMessage(strprintf("Rebuilding address index, Block %i", pblockAddrIndex->nHeight));
-        bool ReadFromDisk(const CBlockIndex* pindex, bool fReadTransactions=true);
-        CBlock pblockAddr;
-        if(pblockAddr.ReadFromDisk(pblockAddrIndex, true))
-            pblockAddr.RebuildAddressIndex(txdbAddr);
-        pblockAddrIndex = pblockAddrIndex->pprev;
-    }
-
-    printf("Rebuilt address index of %i blocks in %" PRId64"ms\n",
-           pblockAddrIndex->nHeight, GetTimeMillis() - nStart);
+        int nAddrIndexThreads = GetArg("-addrindexthreads", 0);
+        if (nAddrIndexThreads <= 0)
+            nAddrIndexThreads += boost::thread::hardware_concurrency();
+        if (!RebuildAddressIndex(std::max(nAddrIndexThreads, 1)))
+            return InitError(_("Failed to rebuild the address index"));
     }
 
     //// debug print
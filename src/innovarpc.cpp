@@ -10,6 +10,7 @@
 #include "base58.h"
 #include "innovarpc.h"
 #include "db.h"
+#include "rpcqueue.h"
 
 #undef printf
 #include <boost/asio.hpp>
@@ -28,6 +29,10 @@
 #include <deque>
 #include <limits>
 
+#ifndef WIN32
+#include <poll.h>
+#endif
+
 #if BOOST_VERSION >= 107300
 #include <boost/bind/bind.hpp>
 using boost::placeholders::_1;
@@ -50,7 +55,7 @@ static std::string strRPCUserColonPass;
 
 const Object emptyobj;
 
-void ThreadRPCServer3(void* parg);
+void ThreadRPCWorker(void* parg);
 
 static inline unsigned short GetDefaultRPCPort()
 {
@@ -293,9 +298,11 @@ static const CRPCCommand vRPCCommands[] =
     { "getaddednodeinfo",       &getaddednodeinfo,       true,   true },
     { "ping",                   &ping,                   true,   true },
     { "getnettotals",           &getnettotals,           true,   true },
+    { "getmsglatency",          &getmsglatency,          true,   true },
+    { "getrpcinfo",             &getrpcinfo,             true,   true },
     { "disconnectnode",         &disconnectnode,         true,   true },
     { "getnetworkinfo",         &getnetworkinfo,         true,   true },
-    { "gethashespersec",        &gethashespersec,        true,   false },
+    { "gethashespersec",        &gethashespersec,        true,   true },
     { "addnode",                &addnode,                true,   true },
     { "setban",                 &setban,                 true,   true },
     { "listbanned",             &listbanned,             true,   true },
@@ -335,7 +342,7 @@ static const CRPCCommand vRPCCommands[] =
     { "sendmany",               &sendmany,               false,  false },
     { "addmultisigaddress",     &addmultisigaddress,     false,  false },
     { "addredeemscript",        &addredeemscript,        false,  false },
-    { "getrawmempool",          &getrawmempool,          true,   false },
+    { "getrawmempool",          &getrawmempool,          true,   true },
     { "getblock",               &getblock,               false,  false },
 	{ "getblockheader",         &getblockheader,         false,  false },
     { "setbestblockbyheight",   &setbestblockbyheight,   false,  false },
@@ -349,7 +356,7 @@ static const CRPCCommand vRPCCommands[] =
     { "listaddressgroupings",   &listaddressgroupings,   false,  false },
 	{ "listaddressgroups",      &listaddressgroups,      false,  false },
     { "signmessage",            &signmessage,            false,  false },
-    { "verifymessage",          &verifymessage,          false,  false },
+    { "verifymessage",          &verifymessage,          false,  true },
     { "getwork",                &getwork,                true,   false },
     { "getworkex",              &getworkex,              true,   false },
     { "listaccounts",           &listaccounts,           false,  false },
@@ -367,12 +374,13 @@ static const CRPCCommand vRPCCommands[] =
     { "listunspent",            &listunspent,            false,  false },
     { "getrawtransaction",      &getrawtransaction,      false,  false },
     { "createrawtransaction",   &createrawtransaction,   false,  false },
-    { "decoderawtransaction",   &decoderawtransaction,   false,  false },
+    { "decoderawtransaction",   &decoderawtransaction,   false,  true },
     { "createmultisig",         &createmultisig,         false,  false },
-    { "decodescript",           &decodescript,           false,  false },
+    { "decodescript",           &decodescript,           false,  true },
     { "signrawtransaction",     &signrawtransaction,     false,  false },
     { "sendrawtransaction",     &sendrawtransaction,     false,  false },
     { "searchrawtransactions",  &searchrawtransactions,  false,  false },
+    { "getaddresssummary",      &getaddresssummary,      false,  false },
     { "getcheckpoint",          &getcheckpoint,          true,   false },
     { "reservebalance",         &reservebalance,         false,  true},
     { "checkwallet",            &checkwallet,            false,  true},
@@ -605,6 +613,7 @@ static string HTTPReply(int nStatus, const string& strMsg, bool keepalive)
     else if (nStatus == HTTP_FORBIDDEN) cStatus = "Forbidden";
     else if (nStatus == HTTP_NOT_FOUND) cStatus = "Not Found";
     else if (nStatus == HTTP_INTERNAL_SERVER_ERROR) cStatus = "Internal Server Error";
+    else if (nStatus == HTTP_SERVICE_UNAVAILABLE) cStatus = "Service Unavailable";
     else cStatus = "";
     return strprintf(
             "HTTP/1.1 %d %s\r\n"
@@ -896,6 +905,9 @@ public:
     virtual std::iostream& stream() = 0;
     virtual std::string peer_address_to_string() const = 0;
     virtual void close() = 0;
+
+    // Wait up to nTimeoutMs for the start of another request
+    virtual bool WaitForData(int nTimeoutMs) = 0;
 };
 
 template <typename Protocol>
@@ -907,6 +919,7 @@ public:
             ssl::context &context,
             bool fUseSSL) :
         sslStream(io_service, context),
+        fSSL(fUseSSL),
         _d(sslStream, fUseSSL),
         _stream(_d)
     {
@@ -927,14 +940,51 @@ public:
         _stream.close();
     }
 
+    virtual bool WaitForData(int nTimeoutMs)
+    {
+        // Encrypted bytes may sit in the SSL layer's buffers where the
+        // socket can't show them, so SSL connections just block in the read
+        if (fSSL || _stream.rdbuf()->in_avail() > 0)
+            return true;
+        SOCKET hSocket = sslStream.lowest_layer().native_handle();
+#ifdef WIN32
+        fd_set fdsetRecv;
+        FD_ZERO(&fdsetRecv);
+        FD_SET(hSocket, &fdsetRecv);
+        struct timeval timeout;
+        timeout.tv_sec = nTimeoutMs / 1000;
+        timeout.tv_usec = (nTimeoutMs % 1000) * 1000;
+        return select(hSocket + 1, &fdsetRecv, NULL, NULL, &timeout) != 0;
+#else
+        struct pollfd pfd;
+        pfd.fd = hSocket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        return poll(&pfd, 1, nTimeoutMs) != 0;
+#endif
+    }
+
     typename Protocol::endpoint peer;
     asio::ssl::stream<typename Protocol::socket> sslStream;
 
 private:
+    bool fSSL;
     SSLIOStreamDevice<Protocol> _d;
     iostreams::stream< SSLIOStreamDevice<Protocol> > _stream;
 };
 
+// Accepted connections wait here for one of the -rpcthreads workers
+static CRPCWorkQueue* pRPCWorkQueue = NULL;
+
+static void ServeRPCConnection(AcceptedConnection* conn, int64_t nQueued);
+static void RecordRPCQueueWait(int64_t nMicros);
+
+void InterruptRPCWorkers()
+{
+    if (pRPCWorkQueue)
+        pRPCWorkQueue->Interrupt();
+}
+
 void ThreadRPCServer(void* parg)
 {
     // Make this thread recognisable as the RPC listener
@@ -1053,9 +1103,12 @@ static void RPCAcceptHandler(boost::shared_ptr< basic_socket_acceptor<Protocol,
         delete conn;
     }
 
-    // start HTTP client thread
-    else if (!NewThread(ThreadRPCServer3, conn)) {
-        printf("Failed to create RPC server client thread\n");
+    // hand the connection to the worker pool
+    else if (!pRPCWorkQueue->Enqueue(boost::bind(&ServeRPCConnection, conn, GetTimeMicros()))) {
+        printf("RPC work queue depth exceeded, rejecting connection from %s\n", conn->peer_address_to_string().c_str());
+        // As above, no reply that would need an SSL handshake on this thread
+        if (!fUseSSL)
+            conn->stream() << HTTPReply(HTTP_SERVICE_UNAVAILABLE, "", false) << std::flush;
         delete conn;
     }
 
@@ -1096,6 +1149,8 @@ void ThreadRPCServer2(void* parg)
     }
 
     const bool fUseSSL = GetBoolArg("-rpcssl");
+    if (!pRPCWorkQueue)
+        pRPCWorkQueue = new CRPCWorkQueue(GetArg("-rpcworkqueue", DEFAULT_RPC_WORK_QUEUE));
 
     ioContext io_service;
 #if defined BOOST_VERSION && BOOST_VERSION >= 106600
@@ -1194,11 +1249,18 @@ void ThreadRPCServer2(void* parg)
         return;
     }
 
+    int nThreads = std::max((int)GetArg("-rpcthreads", DEFAULT_RPC_THREADS), 1);
+    for (int i = 0; i < nThreads; i++)
+        if (!NewThread(ThreadRPCWorker, pRPCWorkQueue))
+            printf("Failed to create RPC worker thread\n");
+    printf("ThreadRPCServer: %d worker threads, work queue depth %d\n", nThreads, pRPCWorkQueue->GetStats().nMaxDepth);
+
     vnThreadsRunning[THREAD_RPCLISTENER]--;
     while (!fShutdown)
         io_service.run_one();
     vnThreadsRunning[THREAD_RPCLISTENER]++;
     StopRequests();
+    pRPCWorkQueue->Interrupt();
 }
 
 class JSONRequest
@@ -1266,41 +1328,82 @@ static Object JSONRPCExecOne(const Value& req)
     return rpc_result;
 }
 
+static void JSONRPCExecBatchEntry(const Array& vReq, vector<Value>& vRet, unsigned int reqIdx)
+{
+    vRet[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+}
+
 static string JSONRPCExecBatch(const Array& vReq)
 {
-    Array ret;
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    // Entries run on idle workers in parallel; locked commands still take
+    // turns on cs_main, but unlocked ones and JSON work overlap
+    vector<Value> vRet(vReq.size());
+    if (pRPCWorkQueue && vReq.size() > 1)
+        pRPCWorkQueue->ParallelFor(vReq.size(), boost::bind(&JSONRPCExecBatchEntry, boost::cref(vReq), boost::ref(vRet), _1));
+    else
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            JSONRPCExecBatchEntry(vReq, vRet, reqIdx);
 
+    Array ret(vRet.begin(), vRet.end());
     return write_string(Value(ret), false) + "\n";
 }
 
 static CCriticalSection cs_THREAD_RPCHANDLER;
 
-void ThreadRPCServer3(void* parg)
+void ThreadRPCWorker(void* parg)
 {
-    // Make this thread recognisable as the RPC handler
+    // Make this thread recognisable as an RPC handler
     RenameThread("innova-rpchand");
 
     {
         LOCK(cs_THREAD_RPCHANDLER);
         vnThreadsRunning[THREAD_RPCHANDLER]++;
     }
-    AcceptedConnection *conn = (AcceptedConnection *) parg;
+    try
+    {
+        ((CRPCWorkQueue*)parg)->Run();
+    }
+    catch (std::exception& e) {
+        PrintExceptionContinue(&e, "ThreadRPCWorker()");
+    } catch (...) {
+        PrintExceptionContinue(NULL, "ThreadRPCWorker()");
+    }
+    {
+        LOCK(cs_THREAD_RPCHANDLER);
+        vnThreadsRunning[THREAD_RPCHANDLER]--;
+    }
+}
 
+// A worker waits at most -rpcservertimeout seconds for a client to send a
+// request. Between requests on a keep-alive connection it also gives the
+// client up as soon as another connection is waiting for a worker.
+static bool WaitForRequest(AcceptedConnection* conn, bool fKeepAlive)
+{
+    int64_t nTimeout = GetArg("-rpcservertimeout", DEFAULT_RPC_SERVER_TIMEOUT) * 1000;
+    int64_t nStart = GetTimeMillis();
+    while (!fShutdown)
+    {
+        if (conn->WaitForData(100))
+            return true;
+        if ((fKeepAlive && pRPCWorkQueue->Depth() > 0) || GetTimeMillis() - nStart >= nTimeout)
+            return false;
+    }
+    return false;
+}
+
+static void ServeRPCConnection2(AcceptedConnection* conn)
+{
     bool fRun = true;
+    bool fFirst = true;
     while (true)
     {
-        if (fShutdown || !fRun)
+        if (fShutdown || !fRun || !WaitForRequest(conn, !fFirst))
         {
             conn->close();
             delete conn;
-            {
-                LOCK(cs_THREAD_RPCHANDLER);
-                --vnThreadsRunning[THREAD_RPCHANDLER];
-            }
             return;
         }
+        fFirst = false;
         map<string, string> mapHeaders;
         string strRequest;
 
@@ -1404,7 +1507,9 @@ void ThreadRPCServer3(void* parg)
             }
         }
 
-        if (mapHeaders["connection"] == "close")
+        // Don't hold a worker for this client's next request while
+        // others are queued
+        if (mapHeaders["connection"] == "close" || pRPCWorkQueue->Depth() > 0)
             fRun = false;
 
         JSONRequest jreq;
@@ -1447,10 +1552,127 @@ void ThreadRPCServer3(void* parg)
     }
 
     delete conn;
+}
+
+// Runs on a worker; the worker must survive whatever the connection throws
+static void ServeRPCConnection(AcceptedConnection* conn, int64_t nQueued)
+{
+    RecordRPCQueueWait(GetTimeMicros() - nQueued);
+    try
     {
-        LOCK(cs_THREAD_RPCHANDLER);
-        vnThreadsRunning[THREAD_RPCHANDLER]--;
+        ServeRPCConnection2(conn);
+    }
+    catch (std::exception& e) {
+        PrintExceptionContinue(&e, "ServeRPCConnection()");
+        delete conn;
+    } catch (...) {
+        PrintExceptionContinue(NULL, "ServeRPCConnection()");
+        delete conn;
+    }
+}
+
+struct CRPCMethodStats
+{
+    uint64_t nCalls;
+    uint64_t nErrors;
+    int64_t nTotal;
+    int64_t nMax;
+    int64_t nLockWaitTotal;
+
+    CRPCMethodStats() : nCalls(0), nErrors(0), nTotal(0), nMax(0), nLockWaitTotal(0) {}
+};
+
+// Keyed by table entries only, so the map can't grow past the command table
+static CCriticalSection cs_rpcStats;
+static map<string, CRPCMethodStats> mapRPCMethodStats;
+static uint64_t nRPCConnections = 0;
+static int64_t nRPCQueueWaitTotal = 0;
+static int64_t nRPCQueueWaitMax = 0;
+
+static void RecordRPCQueueWait(int64_t nMicros)
+{
+    LOCK(cs_rpcStats);
+    nRPCConnections++;
+    nRPCQueueWaitTotal += nMicros;
+    nRPCQueueWaitMax = std::max(nRPCQueueWaitMax, nMicros);
+}
+
+// Records one CRPCTable::execute() call, however it exits
+class CRPCCallTimer
+{
+public:
+    const std::string& strName;
+    int64_t nStart;
+    int64_t nLockWait;
+    bool fError;
+
+    explicit CRPCCallTimer(const std::string& strNameIn) :
+        strName(strNameIn), nStart(GetTimeMicros()), nLockWait(0), fError(true) {}
+
+    ~CRPCCallTimer()
+    {
+        int64_t nElapsed = GetTimeMicros() - nStart;
+        LOCK(cs_rpcStats);
+        CRPCMethodStats& stats = mapRPCMethodStats[strName];
+        stats.nCalls++;
+        stats.nErrors += fError;
+        stats.nTotal += nElapsed;
+        stats.nMax = std::max(stats.nMax, nElapsed);
+        stats.nLockWaitTotal += nLockWait;
+    }
+};
+
+Value getrpcinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getrpcinfo [reset]\n"
+            "Returns the RPC worker pool state and per-method call statistics since startup\n"
+            "or the last reset. \"queue_wait\" is the time an accepted connection waited for a\n"
+            "worker, \"lock_wait\" the time a call waited for cs_main and the wallet lock.\n"
+            "If [reset] is true the counters are cleared.");
+
+    bool fReset = params.size() > 0 && params[0].get_bool();
+
+    Object ret;
+    if (pRPCWorkQueue)
+    {
+        CRPCWorkQueue::Stats queue = pRPCWorkQueue->GetStats(fReset);
+        ret.push_back(Pair("threads", queue.nThreads));
+        ret.push_back(Pair("idle", queue.nIdle));
+        ret.push_back(Pair("queue_depth", queue.nDepth));
+        ret.push_back(Pair("queue_limit", queue.nMaxDepth));
+        ret.push_back(Pair("queue_peak", queue.nPeakDepth));
+        ret.push_back(Pair("rejected", queue.nRejected));
+    }
+
+    LOCK(cs_rpcStats);
+    ret.push_back(Pair("connections", (boost::uint64_t)nRPCConnections));
+    ret.push_back(Pair("queue_wait_avg_us", nRPCConnections ? nRPCQueueWaitTotal / (int64_t)nRPCConnections : 0));
+    ret.push_back(Pair("queue_wait_max_us", nRPCQueueWaitMax));
+
+    Object methods;
+    for (map<string, CRPCMethodStats>::const_iterator it = mapRPCMethodStats.begin(); it != mapRPCMethodStats.end(); ++it)
+    {
+        const CRPCMethodStats& stats = it->second;
+        Object obj;
+        obj.push_back(Pair("calls", (boost::uint64_t)stats.nCalls));
+        obj.push_back(Pair("errors", (boost::uint64_t)stats.nErrors));
+        obj.push_back(Pair("avg_us", stats.nCalls ? stats.nTotal / (int64_t)stats.nCalls : 0));
+        obj.push_back(Pair("max_us", stats.nMax));
+        obj.push_back(Pair("lock_wait_avg_us", stats.nCalls ? stats.nLockWaitTotal / (int64_t)stats.nCalls : 0));
+        methods.push_back(Pair(it->first, obj));
+    }
+    ret.push_back(Pair("methods", methods));
+
+    if (fReset)
+    {
+        mapRPCMethodStats.clear();
+        nRPCConnections = 0;
+        nRPCQueueWaitTotal = 0;
+        nRPCQueueWaitMax = 0;
     }
+    return ret;
 }
 
 json_spirit::Value CRPCTable::execute(const std::string &strMethod, const json_spirit::Array &params) const
@@ -1466,6 +1688,7 @@ json_spirit::Value CRPCTable::execute(const std::string &strMethod, const json_s
         !pcmd->okSafeMode)
         throw JSONRPCError(RPC_FORBIDDEN_BY_SAFE_MODE, string("Safe mode: ") + strWarning);
 
+    CRPCCallTimer timer(pcmd->name);
     try
     {
         // Execute
@@ -1475,9 +1698,11 @@ json_spirit::Value CRPCTable::execute(const std::string &strMethod, const json_s
                 result = pcmd->actor(params, false);
             else {
                 LOCK2(cs_main, pwalletMain->cs_wallet);
+                timer.nLockWait = GetTimeMicros() - timer.nStart;
                 result = pcmd->actor(params, false);
             }
         }
+        timer.fError = false;
         return result;
     }
     catch (std::exception& e)
@@ -1681,6 +1906,8 @@ Array RPCConvertValues(const std::string &strMethod, const std::vector<std::stri
 
     if (strMethod == "setban"                 && n > 2) ConvertTo<int64_t>(params[2]);
     if (strMethod == "setban"                 && n == 4) ConvertTo<bool>(params[3]);
+    if (strMethod == "getmsglatency"          && n > 0) ConvertTo<bool>(params[0]);
+    if (strMethod == "getrpcinfo"             && n > 0) ConvertTo<bool>(params[0]);
 
     if (strMethod == "sendinntoanon"         	  && n > 1) ConvertTo<double>(params[1]);
     if (strMethod == "sendanontoanon"         && n > 1) ConvertTo<double>(params[1]);
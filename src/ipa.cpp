@@ -6,6 +6,7 @@
 #include "ipa.h"
 #include "ed25519_zk.h"
 #include "hash.h"
+#include "msm.h"
 #include "util.h"
 
 #include <openssl/ec.h>
@@ -944,6 +945,273 @@ bool VerifyIPAProof(const std::vector<unsigned char>& P,
 
 
 
+// The fixed base table for a generator set, named by a hash of its bytes so a
+// set built under any domain finds its table again without parsing 2n+1
+// points on every batch.
+static const CMSMFixedBase* GetIPAFixedBase(const CIPAGenerators& gens)
+{
+    std::vector<std::vector<unsigned char> > vBaseBytes;
+    std::vector<unsigned char> vchAll;
+    vBaseBytes.reserve(2 * gens.vG.size() + 1);
+    for (size_t i = 0; i < gens.vG.size() && i < gens.vH.size(); i++)
+    {
+        vBaseBytes.push_back(gens.vG[i]);
+        vBaseBytes.push_back(gens.vH[i]);
+    }
+    vBaseBytes.push_back(gens.vchU);
+    for (size_t i = 0; i < vBaseBytes.size(); i++)
+        vchAll.insert(vchAll.end(), vBaseBytes[i].begin(), vBaseBytes[i].end());
+
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(vchAll.data(), vchAll.size(), hash);
+    return GetMSMFixedBase("ipa." + HexStr(hash, hash + sizeof(hash)), vBaseBytes);
+}
+
+static bool IPAParseNonInfinityPoint(const EC_GROUP* group, const std::vector<unsigned char>& vch,
+                                     EC_POINT* point, BN_CTX* ctx)
+{
+    if (vch.size() != IPA_SECP256K1_POINT)
+        return false;
+    if (EC_POINT_oct2point(group, point, vch.data(), vch.size(), ctx) != 1)
+        return false;
+    if (EC_POINT_is_on_curve(group, point, ctx) != 1)
+        return false;
+    return !EC_POINT_is_at_infinity(group, point);
+}
+
+bool PrepareIPAProofCheck(const std::vector<unsigned char>& P,
+                          const CIPAGenerators& gens,
+                          CIPATranscript& transcript,
+                          const CIPAProof& proof,
+                          CIPADeferredCheck& checkOut)
+{
+    if (proof.IsNull())
+        return false;
+    if (gens.curveType != IPA_CURVE_SECP256K1)
+        return false;
+
+    int logN = proof.GetNumRounds();
+    if (logN > 30 || (1 << logN) != gens.nLength)
+        return false;
+    if (proof.vchAFinal.size() != IPA_SCALAR_SIZE || proof.vchBFinal.size() != IPA_SCALAR_SIZE)
+        return false;
+
+    CIPAECGroupGuard group;
+    CIPABNCtxGuard ctx;
+    if (!group.group || !ctx.ctx) return false;
+
+    // VerifyIPAProof rejects these while building its terms: L and R must be
+    // valid non-infinity points, and a zero a or b makes a*G or b*H the
+    // point at infinity, which its byte-level point addition cannot parse.
+    CIPAECPointGuard pt(group);
+    if (EC_POINT_oct2point(group, pt, P.data(), P.size(), ctx) != 1)
+        return false;
+    for (int round = 0; round < logN; round++)
+    {
+        if (!IPAParseNonInfinityPoint(group, proof.vL[round], pt, ctx) ||
+            !IPAParseNonInfinityPoint(group, proof.vR[round], pt, ctx))
+            return false;
+    }
+    CIPABNGuard order, bnA, bnB;
+    EC_GROUP_get_order(group, order, ctx);
+    BN_bin2bn(proof.vchAFinal.data(), IPA_SCALAR_SIZE, bnA);
+    BN_bin2bn(proof.vchBFinal.data(), IPA_SCALAR_SIZE, bnB);
+    BN_mod(bnA, bnA, order, ctx);
+    BN_mod(bnB, bnB, order, ctx);
+    if (BN_is_zero(bnA) || BN_is_zero(bnB))
+        return false;
+
+    checkOut.vChallenges.resize(logN);
+    checkOut.vChallengeInvs.resize(logN);
+    for (int round = 0; round < logN; round++)
+    {
+        transcript.AppendPoint(proof.vL[round]);
+        transcript.AppendPoint(proof.vR[round]);
+
+        if (!transcript.GetChallengeAndUpdate(checkOut.vChallenges[round], gens.curveType))
+            return false;
+        if (!IPAScalarInv(checkOut.vChallenges[round], checkOut.vChallengeInvs[round], gens.curveType))
+            return false;
+    }
+
+    checkOut.vchP = P;
+    checkOut.vL = proof.vL;
+    checkOut.vR = proof.vR;
+    checkOut.vchAFinal = proof.vchAFinal;
+    checkOut.vchBFinal = proof.vchBFinal;
+    return true;
+}
+
+bool VerifyIPAProofBatch(const CIPAGenerators& gens,
+                         const std::vector<CIPADeferredCheck>& vChecks)
+{
+    if (vChecks.empty())
+        return true;
+    if (gens.curveType != IPA_CURVE_SECP256K1 || gens.IsNull())
+        return false;
+
+    const int n = gens.nLength;
+
+    CIPAECGroupGuard group;
+    CIPABNCtxGuard ctx;
+    if (!group.group || !ctx.ctx) return false;
+
+    CIPABNGuard order;
+    EC_GROUP_get_order(group, order, ctx);
+
+    // Each proof k contributes, scaled by a random nonzero weight w_k,
+    //   P + sum(u_j^2*L_j + u_j^-2*R_j) - sum(a*s_i*G_i + b*s_i^-1*H_i) - a*b*U
+    // where s_i = prod_j (bit j of i set ? u_j : u_j^-1), the same scalars
+    // VerifyIPAProof builds gFinal and hFinal from. The coefficients on the
+    // shared generators are summed across proofs.
+    std::vector<EC_POINT*> vPoints;
+    std::vector<BIGNUM*> vScalars;
+    std::vector<BIGNUM*> vGCoeff(n), vHCoeff(n);
+    for (int i = 0; i < n; i++)
+    {
+        vGCoeff[i] = BN_new(); BN_zero(vGCoeff[i]);
+        vHCoeff[i] = BN_new(); BN_zero(vHCoeff[i]);
+    }
+    BIGNUM* uCoeff = BN_new();
+    BN_zero(uCoeff);
+
+    bool fOk = true;
+    CIPABNGuard w, tmp, a, b, sG, sH;
+    std::vector<BIGNUM*> vU, vUInv;
+    for (size_t k = 0; k < vChecks.size() && fOk; k++)
+    {
+        const CIPADeferredCheck& check = vChecks[k];
+        int logN = (int)check.vChallenges.size();
+        if ((1 << logN) != n || check.vL.size() != (size_t)logN || check.vR.size() != (size_t)logN ||
+            check.vChallengeInvs.size() != (size_t)logN)
+        {
+            fOk = false;
+            break;
+        }
+
+        do { BN_rand_range(w, order); } while (BN_is_zero(w));
+
+        EC_POINT* ptP = EC_POINT_new(group);
+        vPoints.push_back(ptP);
+        vScalars.push_back(BN_dup(w));
+        if (EC_POINT_oct2point(group, ptP, check.vchP.data(), check.vchP.size(), ctx) != 1)
+        {
+            fOk = false;
+            break;
+        }
+
+        for (int j = 0; j < logN && fOk; j++)
+        {
+            vU.push_back(BN_bin2bn(check.vChallenges[j].data(), IPA_SCALAR_SIZE, NULL));
+            vUInv.push_back(BN_bin2bn(check.vChallengeInvs[j].data(), IPA_SCALAR_SIZE, NULL));
+
+            EC_POINT* ptL = EC_POINT_new(group);
+            EC_POINT* ptR = EC_POINT_new(group);
+            vPoints.push_back(ptL);
+            vPoints.push_back(ptR);
+            BIGNUM* sL = BN_new();
+            BIGNUM* sR = BN_new();
+            vScalars.push_back(sL);
+            vScalars.push_back(sR);
+            fOk = IPAParseNonInfinityPoint(group, check.vL[j], ptL, ctx) &&
+                  IPAParseNonInfinityPoint(group, check.vR[j], ptR, ctx);
+            BN_mod_sqr(sL, vU[j], order, ctx);
+            BN_mod_mul(sL, sL, w, order, ctx);
+            BN_mod_sqr(sR, vUInv[j], order, ctx);
+            BN_mod_mul(sR, sR, w, order, ctx);
+        }
+        if (!fOk)
+            break;
+
+        BN_bin2bn(check.vchAFinal.data(), IPA_SCALAR_SIZE, a);
+        BN_bin2bn(check.vchBFinal.data(), IPA_SCALAR_SIZE, b);
+        BN_mod(a, a, order, ctx);
+        BN_mod(b, b, order, ctx);
+
+        BN_mod_mul(tmp, a, b, order, ctx);
+        BN_mod_mul(tmp, tmp, w, order, ctx);
+        BN_mod_sub(uCoeff, uCoeff, tmp, order, ctx);
+
+        for (int i = 0; i < n; i++)
+        {
+            BN_one(sG);
+            BN_one(sH);
+            for (int j = 0; j < logN; j++)
+            {
+                if ((i >> (logN - 1 - j)) & 1)
+                {
+                    BN_mod_mul(sG, sG, vU[j], order, ctx);
+                    BN_mod_mul(sH, sH, vUInv[j], order, ctx);
+                }
+                else
+                {
+                    BN_mod_mul(sG, sG, vUInv[j], order, ctx);
+                    BN_mod_mul(sH, sH, vU[j], order, ctx);
+                }
+            }
+            BN_mod_mul(tmp, sG, a, order, ctx);
+            BN_mod_mul(tmp, tmp, w, order, ctx);
+            BN_mod_sub(vGCoeff[i], vGCoeff[i], tmp, order, ctx);
+            BN_mod_mul(tmp, sH, b, order, ctx);
+            BN_mod_mul(tmp, tmp, w, order, ctx);
+            BN_mod_sub(vHCoeff[i], vHCoeff[i], tmp, order, ctx);
+        }
+
+        for (size_t j = 0; j < vU.size(); j++)
+        {
+            BN_free(vU[j]);
+            BN_free(vUInv[j]);
+        }
+        vU.clear();
+        vUInv.clear();
+    }
+
+    // The proof points go through the variable multiplication and the
+    // generators through their precomputed table, in G_0, H_0, G_1, ... U order
+    const CMSMFixedBase* pGens = NULL;
+    if (fOk)
+    {
+        pGens = GetIPAFixedBase(gens);
+        fOk = pGens && pGens->size() == 2 * (size_t)n + 1;
+    }
+    if (fOk)
+    {
+        std::vector<BIGNUM*> vGenScalars;
+        vGenScalars.reserve(2 * n + 1);
+        for (int i = 0; i < n; i++)
+        {
+            vGenScalars.push_back(vGCoeff[i]);
+            vGenScalars.push_back(vHCoeff[i]);
+        }
+        vGenScalars.push_back(uCoeff);
+
+        CIPAECPointGuard result(group), genSum(group);
+        fOk = MultiScalarMul(group, ctx, vPoints, vScalars, result, nMSMThreads) &&
+              pGens->Mul(group, ctx, vGenScalars, genSum, nMSMThreads) &&
+              EC_POINT_add(group, result, result, genSum, ctx) == 1 &&
+              EC_POINT_is_at_infinity(group, result) == 1;
+    }
+
+    for (size_t j = 0; j < vU.size(); j++)
+    {
+        BN_free(vU[j]);
+        BN_free(vUInv[j]);
+    }
+    for (size_t i = 0; i < vPoints.size(); i++)
+        EC_POINT_free(vPoints[i]);
+    for (size_t i = 0; i < vScalars.size(); i++)
+        BN_free(vScalars[i]);
+    for (int i = 0; i < n; i++)
+    {
+        BN_free(vGCoeff[i]);
+        BN_free(vHCoeff[i]);
+    }
+    BN_free(uCoeff);
+
+    return fOk;
+}
+
+
 static const char* PATH_IPA_DOMAIN = "Innova_FCMP_PathIPA_v5";
 
 static bool CommitToPositionBits(uint64_t nPosition,
@@ -1272,6 +1540,79 @@ bool VerifyFCMPProofV5(const std::vector<unsigned char>& vchRoot,
 }
 
 
+bool PrepareFCMPProofV5Check(const std::vector<unsigned char>& vchRoot,
+                             const std::vector<unsigned char>& vchLeafCommit,
+                             const std::vector<unsigned char>& proof,
+                             CIPADeferredCheck& checkOut,
+                             int& nGensLengthOut)
+{
+    if (proof.size() < 4)
+        return false;
+
+    CPathIPAProof pathProof;
+    std::vector<unsigned char> leafCommit;
+    try
+    {
+        CDataStream ss(proof, SER_NETWORK, PROTOCOL_VERSION);
+
+        uint32_t version;
+        ss >> version;
+        if (version != FCMP_PROOF_VERSION_IPA)
+            return false;
+
+        ss >> pathProof.nVersion;
+        ss >> pathProof.nDepth;
+        ss >> pathProof.vchPositionCommit;
+        ss >> pathProof.vchPathCommit;
+        ss >> pathProof.vchInnerProduct;
+        ss >> pathProof.vchSiblingCommit;
+        ss >> pathProof.ipaProof;
+        ss >> leafCommit;
+    }
+    catch (std::exception& e)
+    {
+        // Leave truncated proofs to VerifyFCMPProofV5.
+        return false;
+    }
+
+    if (!vchLeafCommit.empty() && leafCommit != vchLeafCommit)
+        return false;
+
+    // The checks of VerifyPathIPAProof ahead of its VerifyIPAProof call.
+    if (pathProof.nVersion != PATH_IPA_VERSION)
+        return false;
+    if (pathProof.nDepth <= 0 || pathProof.nDepth > 64)
+        return false;
+    if (pathProof.ipaProof.IsNull())
+        return false;
+
+    int n = 1;
+    while (n < pathProof.nDepth) n *= 2;
+
+    CIPAGenerators gens;
+    if (!GenerateIPAGenerators(PATH_IPA_DOMAIN, n, IPA_CURVE_SECP256K1, gens))
+        return false;
+
+    CIPATranscript transcript;
+    transcript.AppendBytes((const unsigned char*)"PathIPAProof_v5", 15);
+    transcript.AppendPoint(pathProof.vchPositionCommit);
+    transcript.AppendPoint(pathProof.vchPathCommit);
+
+    if (!PrepareIPAProofCheck(pathProof.vchPathCommit, gens, transcript, pathProof.ipaProof, checkOut))
+        return false;
+
+    nGensLengthOut = n;
+    return true;
+}
+
+bool VerifyFCMPProofV5Batch(int nGensLength, const std::vector<CIPADeferredCheck>& vChecks)
+{
+    CIPAGenerators gens;
+    if (!GenerateIPAGenerators(PATH_IPA_DOMAIN, nGensLength, IPA_CURVE_SECP256K1, gens))
+        return false;
+    return VerifyIPAProofBatch(gens, vChecks);
+}
+
 
 
 size_t CCrossCurveFCMPProof::GetProofSize() const
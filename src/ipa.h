@@ -161,6 +161,36 @@ bool VerifyIPAProof(const std::vector<unsigned char>& P,
                     const CIPAProof& proof);
 
 
+// The final multi-exponentiation check of one secp256k1 IPA proof, with the
+// transcript already replayed. VerifyIPAProofBatch folds many of these, made
+// against the same generators, into one randomized combined check.
+class CIPADeferredCheck
+{
+public:
+    std::vector<unsigned char> vchP;
+    std::vector<std::vector<unsigned char>> vL;
+    std::vector<std::vector<unsigned char>> vR;
+    std::vector<std::vector<unsigned char>> vChallenges;
+    std::vector<std::vector<unsigned char>> vChallengeInvs;
+    std::vector<unsigned char> vchAFinal;
+    std::vector<unsigned char> vchBFinal;
+};
+
+// Run every check VerifyIPAProof makes ahead of its final MSM and capture the
+// rest in checkOut. Returns false if the proof fails early or cannot be
+// batched; VerifyIPAProof is then the one to decide it.
+bool PrepareIPAProofCheck(const std::vector<unsigned char>& P,
+                          const CIPAGenerators& gens,
+                          CIPATranscript& transcript,
+                          const CIPAProof& proof,
+                          CIPADeferredCheck& checkOut);
+
+// True (with overwhelming probability) only if every deferred check would
+// pass on its own.
+bool VerifyIPAProofBatch(const CIPAGenerators& gens,
+                         const std::vector<CIPADeferredCheck>& vChecks);
+
+
 
 bool IPAInnerProduct(const std::vector<std::vector<unsigned char>>& a,
                      const std::vector<std::vector<unsigned char>>& b,
@@ -256,6 +286,18 @@ bool VerifyFCMPProofV5(const std::vector<unsigned char>& vchRoot,
                         const std::vector<unsigned char>& vchLeafCommit,
                         const std::vector<unsigned char>& proof);
 
+// Parse and pre-check a V5 proof as VerifyFCMPProofV5 does, deferring its IPA
+// check. nGensLengthOut is the generator length the check must be batched
+// with. False means VerifyFCMPProofV5 must decide the proof on its own.
+bool PrepareFCMPProofV5Check(const std::vector<unsigned char>& vchRoot,
+                             const std::vector<unsigned char>& vchLeafCommit,
+                             const std::vector<unsigned char>& proof,
+                             CIPADeferredCheck& checkOut,
+                             int& nGensLengthOut);
+
+// Verify deferred V5 checks that share a generator length in one batch.
+bool VerifyFCMPProofV5Batch(int nGensLength, const std::vector<CIPADeferredCheck>& vChecks);
+
 
 
 
@@ -15,6 +15,11 @@
 #include "key.h"
 #include "hash.h"
 
+#ifdef USE_SECP256K1
+#include <secp256k1.h>
+#include <secp256k1_recovery.h>
+#endif
+
 // Order of secp256k1's generator minus 1.
 const unsigned char vchMaxModOrder[32] = {
         0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
@@ -33,6 +38,48 @@ const unsigned char vchMaxModHalfOrder[32] = {
 
 const unsigned char vchZero[0] = {};
 
+#ifdef USE_SECP256K1
+static secp256k1_context* CreateSecp256k1Context()
+{
+    secp256k1_context* ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    if (ctx == NULL)
+        return NULL;
+    // Blinding for the signing code against side channels.
+    unsigned char seed[32];
+    if (RAND_bytes(seed, sizeof(seed)) == 1 && !secp256k1_context_randomize(ctx, seed))
+    {
+        secp256k1_context_destroy(ctx);
+        ctx = NULL;
+    }
+    OPENSSL_cleanse(seed, sizeof(seed));
+    return ctx;
+}
+
+// Signing and verifying only read the context, so one serves every thread.
+static secp256k1_context* GetSecp256k1Context()
+{
+    static secp256k1_context* ctx = CreateSecp256k1Context();
+    return ctx;
+}
+
+static bool RecoverCompactSecp256k1(const uint256 &hash, const std::vector<unsigned char>& vchSig, bool fCompressed, CPubKey &pubkeyOut)
+{
+    secp256k1_context* ctx = GetSecp256k1Context();
+    int recid = (vchSig[0] - 27) & 3;
+    secp256k1_ecdsa_recoverable_signature sig;
+    if (!secp256k1_ecdsa_recoverable_signature_parse_compact(ctx, &sig, &vchSig[1], recid))
+        return false;
+    secp256k1_pubkey pubkey;
+    if (!secp256k1_ecdsa_recover(ctx, &pubkey, &sig, hash.begin()))
+        return false;
+    unsigned char pub[65];
+    size_t nPubLen = sizeof(pub);
+    secp256k1_ec_pubkey_serialize(ctx, pub, &nPubLen, &pubkey, fCompressed ? SECP256K1_EC_COMPRESSED : SECP256K1_EC_UNCOMPRESSED);
+    pubkeyOut.Set(pub, pub + nPubLen);
+    return true;
+}
+#endif
+
 
 // Generate a private key from just the secret parameter
 int EC_KEY_regenerate_key(EC_KEY *eckey, BIGNUM *priv_key)
@@ -77,10 +124,59 @@ bool ECC_InitSanityCheck() {
         return false;
     EC_KEY_free(pkey);
 
+#ifdef USE_SECP256K1
+    if (GetSecp256k1Context() == NULL)
+        return false;
+#endif
+
     // TODO Is there more EC functionality that could be missing?
     return true;
 }
 
+bool ParseDERSignature(const unsigned char* pch, size_t nLen, unsigned char vchRS[64])
+{
+    // Signatures are at most 72 bytes, so every length here has the short
+    // form. A long form is either not minimal, which the round trip in
+    // ECDSA_verify() rejects, or encloses an integer longer than 33 bytes,
+    // which cannot be below the order.
+    if (nLen < 8 || pch[0] != 0x30 || pch[1] >= 0x80 || pch[1] != nLen - 2)
+        return false;
+    size_t nPos = 2;
+    for (int i = 0; i < 2; i++)
+    {
+        if (nPos + 2 > nLen || pch[nPos] != 0x02)
+            return false;
+        size_t nIntLen = pch[nPos + 1];
+        nPos += 2;
+        if (nIntLen == 0 || nIntLen >= 0x80 || nPos + nIntLen > nLen)
+            return false;
+        const unsigned char* pInt = &pch[nPos];
+        nPos += nIntLen;
+
+        // Negative
+        if (pInt[0] & 0x80)
+            return false;
+        // Needless leading zero
+        if (nIntLen > 1 && pInt[0] == 0 && !(pInt[1] & 0x80))
+            return false;
+        while (nIntLen > 0 && pInt[0] == 0)
+        {
+            pInt++;
+            nIntLen--;
+        }
+        if (nIntLen > 32)
+            return false;
+
+        unsigned char* pOut = &vchRS[32 * i];
+        memset(pOut, 0, 32 - nIntLen);
+        if (nIntLen)
+            memcpy(pOut + 32 - nIntLen, pInt, nIntLen);
+        if (!CKey::CheckSignatureElement(pOut, 32, false))
+            return false;
+    }
+    return nPos == nLen;
+}
+
 // Perform ECDSA key recovery (see SEC1 4.1.6) for curves over (mod p)-fields
 // recid selects which key is recovered
 // if check is non-zero, additional checks are performed
@@ -367,9 +463,20 @@ CPubKey CKey::GetPubKey() const
     if (!fValid)
         throw key_error("CKey::GetPubKey: key is not valid");
     CPubKey pubkey;
+#ifdef USE_SECP256K1
+    secp256k1_context* ctx = GetSecp256k1Context();
+    secp256k1_pubkey pub;
+    if (!secp256k1_ec_pubkey_create(ctx, &pub, vch))
+        throw key_error("CKey::GetPubKey: secp256k1_ec_pubkey_create failed");
+    unsigned char c[65];
+    size_t nSize = sizeof(c);
+    secp256k1_ec_pubkey_serialize(ctx, c, &nSize, &pub, fCompressed ? SECP256K1_EC_COMPRESSED : SECP256K1_EC_UNCOMPRESSED);
+    pubkey.Set(&c[0], &c[nSize]);
+#else
     CECKey key;
     key.SetSecretBytes(vch);
     key.GetPubKey(pubkey, fCompressed);
+#endif
     return pubkey;
 }
 
@@ -378,9 +485,22 @@ bool CKey::Sign(uint256 hash, std::vector<unsigned char>& vchSig) const
 {
     if (!fValid)
         return false;
+#ifdef USE_SECP256K1
+    // RFC 6979 nonce; libsecp256k1 always produces low S, as CECKey::Sign() does.
+    secp256k1_context* ctx = GetSecp256k1Context();
+    secp256k1_ecdsa_signature sig;
+    if (!secp256k1_ecdsa_sign(ctx, &sig, hash.begin(), vch, secp256k1_nonce_function_rfc6979, NULL))
+        return false;
+    vchSig.resize(72);
+    size_t nSigLen = vchSig.size();
+    secp256k1_ecdsa_signature_serialize_der(ctx, &vchSig[0], &nSigLen, &sig);
+    vchSig.resize(nSigLen);
+    return true;
+#else
     CECKey key;
     key.SetSecretBytes(vch);
     return key.Sign(hash, vchSig);
+#endif
 }
 
 // Create a compact signature (65 bytes), which allows reconstructing the used public key.
@@ -394,10 +514,18 @@ bool CKey::SignCompact(const uint256 &hash, std::vector<unsigned char>& vchSig)
         return false;
     vchSig.resize(65);
     int rec = -1;
+#ifdef USE_SECP256K1
+    secp256k1_context* ctx = GetSecp256k1Context();
+    secp256k1_ecdsa_recoverable_signature sig;
+    if (!secp256k1_ecdsa_sign_recoverable(ctx, &sig, hash.begin(), vch, secp256k1_nonce_function_rfc6979, NULL))
+        return false;
+    secp256k1_ecdsa_recoverable_signature_serialize_compact(ctx, &vchSig[1], &rec, &sig);
+#else
     CECKey key;
     key.SetSecretBytes(vch);
     if (!key.SignCompact(hash, &vchSig[1], rec))
         return false;
+#endif
     if (rec == -1)
         return false;
     vchSig[0] = 27 + rec + (fCompressed ? 4 : 0);
@@ -490,24 +618,44 @@ bool CKey::ReserealizeSignature(std::vector<unsigned char>& vchSig) {
 bool CPubKey::Verify(const uint256 &hash, const std::vector<unsigned char>& vchSig) const {
     if (!IsValid())
         return false;
+#ifdef USE_SECP256K1
+    secp256k1_context* ctx = GetSecp256k1Context();
+    secp256k1_pubkey pubkey;
+    if (!secp256k1_ec_pubkey_parse(ctx, &pubkey, begin(), size()))
+        return false;
+    unsigned char vchRS[64];
+    if (vchSig.empty() || !ParseDERSignature(&vchSig[0], vchSig.size(), vchRS))
+        return false;
+    secp256k1_ecdsa_signature sig;
+    if (!secp256k1_ecdsa_signature_parse_compact(ctx, &sig, vchRS))
+        return false;
+    // OpenSSL accepts either S; libsecp256k1 only verifies the low one.
+    secp256k1_ecdsa_signature_normalize(ctx, &sig, &sig);
+    return secp256k1_ecdsa_verify(ctx, &sig, hash.begin(), &pubkey) == 1;
+#else
     CECKey key;
     if (!key.SetPubKey(*this))
         return false;
     if (!key.Verify(hash, vchSig))
         return false;
     return true;
+#endif
 }
 
 bool CPubKey::RecoverCompact(const uint256 &hash, const std::vector<unsigned char>& vchSig) {
     if (vchSig.size() != 65)
         return false;
-    int recid = (vchSig[0] - 27) & 3;
     bool fComp = (vchSig[0] - 27) & 4;
+#ifdef USE_SECP256K1
+    return RecoverCompactSecp256k1(hash, vchSig, fComp, *this);
+#else
+    int recid = (vchSig[0] - 27) & 3;
     CECKey key;
     if (!key.Recover(hash, &vchSig[1], recid))
         return false;
     key.GetPubKey(*this, fComp);
     return true;
+#endif
 }
 
 bool CPubKey::VerifyCompact(const uint256 &hash, const std::vector<unsigned char>& vchSig) const {
@@ -515,12 +663,17 @@ bool CPubKey::VerifyCompact(const uint256 &hash, const std::vector<unsigned char
         return false;
     if (vchSig.size() != 65)
         return false;
-    int recid = (vchSig[0] - 27) & 3;
     CPubKey pubkeyRec;
+#ifdef USE_SECP256K1
+    if (!RecoverCompactSecp256k1(hash, vchSig, IsCompressed(), pubkeyRec))
+        return false;
+#else
+    int recid = (vchSig[0] - 27) & 3;
     CECKey key;
     if (!key.Recover(hash, &vchSig[1], recid))
         return false;
     key.GetPubKey(pubkeyRec, IsCompressed());
+#endif
     if (*this != pubkeyRec)
         return false;
     return true;
@@ -540,10 +693,14 @@ bool CPubKey::Decompress() {
     if (!IsValid())
         return false;
 #ifdef USE_SECP256K1
-    int clen = size();
-    int ret = secp256k1_ec_pubkey_decompress(instance_of_csecp256k1.ctx, (unsigned char*)begin(), &clen);
-    assert(ret);
-    assert(clen == (int)size());
+    secp256k1_context* ctx = GetSecp256k1Context();
+    secp256k1_pubkey pubkey;
+    if (!secp256k1_ec_pubkey_parse(ctx, &pubkey, begin(), size()))
+        return false;
+    unsigned char pub[65];
+    size_t nPubLen = sizeof(pub);
+    secp256k1_ec_pubkey_serialize(ctx, pub, &nPubLen, &pubkey, SECP256K1_EC_UNCOMPRESSED);
+    Set(pub, pub + nPubLen);
 #else
     CECKey key;
     if (!key.SetPubKey(*this))
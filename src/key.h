@@ -418,6 +418,12 @@ struct CExtKey {
 /** Check that required EC support is available at runtime */
 bool ECC_InitSanityCheck(void);
 
+/** Decode a DER ECDSA signature into big-endian r and s (32 bytes each).
+ *  Accepts exactly the signatures CECKey::Verify() can accept: those that
+ *  d2i_ECDSA_SIG() reads back to the same bytes, with r and s in [1, n-1].
+ *  The libsecp256k1 path relies on this to keep OpenSSL's consensus rules. */
+bool ParseDERSignature(const unsigned char* pch, size_t nLen, unsigned char vchRS[64]);
+
 bool TweakSecret(unsigned char vchSecretOut[32], const unsigned char vchSecretIn[32], const unsigned char vchTweak[32]);
 
 #endif
@@ -4,6 +4,7 @@
 
 #include "lelantus.h"
 #include "hash.h"
+#include "msm.h"
 #include "util.h"
 
 #include <openssl/ec.h>
@@ -13,6 +14,7 @@
 #include <openssl/obj_mac.h>
 #include <string.h>
 #include <algorithm>
+#include <set>
 
 int CAnonymitySet::FindIndex(const CPedersenCommitment& commit) const
 {
@@ -25,12 +27,13 @@ int CAnonymitySet::FindIndex(const CPedersenCommitment& commit) const
 }
 
 bool BuildAnonymitySet(const CPedersenCommitment& realCommit,
-                        const std::vector<CPedersenCommitment>& vAllCommitments,
+                        int64_t nRealPoolIdx,
+                        const CCommitmentPoolSnapshot& vPool,
                         const uint256& blockHashSeed,
                         int nBlockHeight,
                         CAnonymitySet& setOut)
 {
-    if (vAllCommitments.empty())
+    if (vPool.empty())
         return false;
 
     setOut.blockHashSeed = blockHashSeed;
@@ -39,15 +42,15 @@ bool BuildAnonymitySet(const CPedersenCommitment& realCommit,
 
     int nSetSize = LELANTUS_SET_SIZE;
 
-    if ((int)vAllCommitments.size() < nSetSize)
+    if ((int)vPool.size() < nSetSize)
     {
-        if ((int)vAllCommitments.size() < LELANTUS_MIN_SET_SIZE)
+        if ((int)vPool.size() < LELANTUS_MIN_SET_SIZE)
         {
             printf("BuildAnonymitySet: not enough commitments (%d < %d)\n",
-                   (int)vAllCommitments.size(), LELANTUS_MIN_SET_SIZE);
+                   (int)vPool.size(), LELANTUS_MIN_SET_SIZE);
             return false;
         }
-        nSetSize = (int)vAllCommitments.size();
+        nSetSize = (int)vPool.size();
     }
 
     {
@@ -57,22 +60,12 @@ bool BuildAnonymitySet(const CPedersenCommitment& realCommit,
         nSetSize = pow2;
     }
 
-    int nRealPoolIdx = -1;
-    for (int i = 0; i < (int)vAllCommitments.size(); i++)
-    {
-        if (vAllCommitments[i] == realCommit)
-        {
-            nRealPoolIdx = i;
-            break;
-        }
-    }
-
     if (fDebug)
         printf("BuildAnonymitySet: nSetSize=%d (from pool=%d), selecting %d decoys\n",
-               nSetSize, (int)vAllCommitments.size(), nSetSize - 1);
+               nSetSize, (int)vPool.size(), nSetSize - 1);
 
     std::vector<int> vDecoyIndices;
-    if (!SelectDecoys(vAllCommitments, nSetSize - 1, blockHashSeed, vDecoyIndices, nRealPoolIdx))
+    if (!SelectDecoys(vPool.size(), nSetSize - 1, blockHashSeed, vDecoyIndices, (int)nRealPoolIdx))
     {
         printf("BuildAnonymitySet: SelectDecoys FAILED\n");
         return false;
@@ -96,7 +89,7 @@ bool BuildAnonymitySet(const CPedersenCommitment& realCommit,
         }
         else if (decoyIdx < (int)vDecoyIndices.size())
         {
-            setOut.vCommitments.push_back(vAllCommitments[vDecoyIndices[decoyIdx]]);
+            setOut.vCommitments.push_back(vPool[vDecoyIndices[decoyIdx]]);
             decoyIdx++;
         }
     }
@@ -106,13 +99,13 @@ bool BuildAnonymitySet(const CPedersenCommitment& realCommit,
     return setOut.vCommitments.size() >= LELANTUS_MIN_SET_SIZE;
 }
 
-bool SelectDecoys(const std::vector<CPedersenCommitment>& vPool,
+bool SelectDecoys(uint64_t nPoolSize,
                    int nCount,
                    const uint256& seed,
                    std::vector<int>& vIndicesOut,
                    int nExcludeIdx)
 {
-    if (vPool.empty() || nCount <= 0)
+    if (nPoolSize == 0 || nCount <= 0)
         return false;
 
     vIndicesOut.clear();
@@ -128,10 +121,12 @@ bool SelectDecoys(const std::vector<CPedersenCommitment>& vPool,
     }
     seedMixer.write((const char*)vchRand, 32);
     uint256 current = seedMixer.GetHash();
-    std::vector<bool> vUsed(vPool.size(), false);
+    // Only the picked positions are tracked, so the cost follows nCount, not
+    // the pool size.
+    std::set<int> setUsed;
 
-    if (nExcludeIdx >= 0 && nExcludeIdx < (int)vPool.size())
-        vUsed[nExcludeIdx] = true;
+    if (nExcludeIdx >= 0 && nExcludeIdx < (int)nPoolSize)
+        setUsed.insert(nExcludeIdx);
 
     int nSelected = 0;
 
@@ -145,11 +140,10 @@ bool SelectDecoys(const std::vector<CPedersenCommitment>& vPool,
 
         unsigned int idxVal;
         memcpy(&idxVal, current.begin(), sizeof(idxVal));
-        int idx = idxVal % (int)vPool.size();
+        int idx = idxVal % (int)nPoolSize;
 
-        if (!vUsed[idx])
+        if (setUsed.insert(idx).second)
         {
-            vUsed[idx] = true;
             vIndicesOut.push_back(idx);
             nSelected++;
         }
@@ -770,10 +764,14 @@ bool VerifyLelantusProof(const CAnonymitySet& anonSet,
         }
     }
 
+    // sum(p_i*C_i) + zV*G - x^n*Cv - sum(x^k*D_k) is the identity, evaluated
+    // as one multiplication over the whole anonymity set
     if (fValid)
     {
-        CLelECPointGuard sumPC(group);
-        EC_POINT_set_to_infinity(group, sumPC);
+        std::vector<EC_POINT*> vPoints;
+        std::vector<BIGNUM*> vScalars;
+        vPoints.reserve(N + n + 2);
+        vScalars.reserve(N + n + 2);
 
         for (int i = 0; i < (int)N; i++)
         {
@@ -791,64 +789,49 @@ bool VerifyLelantusProof(const CAnonymitySet& anonSet,
                 BN_free(factor);
             }
 
-            if (!BN_is_zero(pi))
+            // Members that do not parse add nothing, as before
+            EC_POINT* Ci = EC_POINT_new(group);
+            if (!BN_is_zero(pi) && LelBytesToPoint(group, anonSet.At(i).vchCommitment, Ci, ctx))
             {
-                CLelECPointGuard Ci(group), piCi(group);
-                if (LelBytesToPoint(group, anonSet.At(i).vchCommitment, Ci, ctx))
-                {
-                    EC_POINT_mul(group, piCi, NULL, Ci, pi, ctx);
-                    EC_POINT_add(group, sumPC, sumPC, piCi, ctx);
-                }
+                vPoints.push_back(Ci);
+                vScalars.push_back(pi);
+            }
+            else
+            {
+                EC_POINT_free(Ci);
+                BN_free(pi);
             }
-
-            BN_free(pi);
-        }
-
-        CLelECPointGuard lhs(group);
-        {
-            CLelECPointGuard zVG(group);
-            EC_POINT_mul(group, zVG, NULL, G, zV, ctx);
-            EC_POINT_add(group, lhs, sumPC, zVG, ctx);
         }
 
-        CLelECPointGuard rhs(group);
-        EC_POINT_set_to_infinity(group, rhs);
+        vPoints.push_back(EC_POINT_dup(G, group));
+        vScalars.push_back(BN_dup(zV));
 
+        BIGNUM* xPow = BN_new();
+        BN_one(xPow);
+        for (uint32_t k = 0; k < n; k++)
         {
-            BIGNUM* xn = BN_new();
-            BN_one(xn);
-            for (uint32_t j = 0; j < n; j++)
-                BN_mod_mul(xn, xn, x, order, ctx);
-
-            CLelECPointGuard cvPt(group);
-            if (!LelBytesToPoint(group, spendCv.vchCommitment, cvPt, ctx))
-            {
-                BN_free(xn);
-                fValid = false;
-            }
-            else
-            {
-                CLelECPointGuard xnCv(group);
-                EC_POINT_mul(group, xnCv, NULL, cvPt, xn, ctx);
-                EC_POINT_add(group, rhs, rhs, xnCv, ctx);
-                BN_free(xn);
-            }
+            vPoints.push_back(EC_POINT_dup(vD[k], group));
+            BIGNUM* negXk = BN_new();
+            BN_mod_sub(negXk, order, xPow, order, ctx);
+            vScalars.push_back(negXk);
+            BN_mod_mul(xPow, xPow, x, order, ctx);
         }
 
+        // xPow is now x^n
+        EC_POINT* cvPt = EC_POINT_new(group);
+        vPoints.push_back(cvPt);
+        BIGNUM* negXn = BN_new();
+        BN_mod_sub(negXn, order, xPow, order, ctx);
+        vScalars.push_back(negXn);
+        BN_free(xPow);
+        if (!LelBytesToPoint(group, spendCv.vchCommitment, cvPt, ctx))
+            fValid = false;
+
         if (fValid)
         {
-            BIGNUM* xPow = BN_new();
-            BN_one(xPow);
-            for (uint32_t k = 0; k < n; k++)
-            {
-                CLelECPointGuard xkDk(group);
-                EC_POINT_mul(group, xkDk, NULL, vD[k], xPow, ctx);
-                EC_POINT_add(group, rhs, rhs, xkDk, ctx);
-                BN_mod_mul(xPow, xPow, x, order, ctx);
-            }
-            BN_free(xPow);
-
-            if (EC_POINT_cmp(group, lhs, rhs, ctx) != 0)
+            CLelECPointGuard result(group);
+            if (!MultiScalarMul(group, ctx, vPoints, vScalars, result, nMSMThreads) ||
+                EC_POINT_is_at_infinity(group, result) != 1)
             {
                 printf("VerifyLelantus: product commitment check FAILED\n");
                 fValid = false;
@@ -859,6 +842,11 @@ bool VerifyLelantusProof(const CAnonymitySet& anonSet,
                     printf("VerifyLelantus: product commitment check PASSED\n");
             }
         }
+
+        for (size_t i = 0; i < vPoints.size(); i++)
+            EC_POINT_free(vPoints[i]);
+        for (size_t i = 0; i < vScalars.size(); i++)
+            BN_free(vScalars[i]);
     }
 
     cleanupProof();
@@ -8,6 +8,7 @@
 #include "uint256.h"
 #include "serialize.h"
 #include "zkproof.h"
+#include "shieldedpool.h"
 
 #include <vector>
 #include <stdint.h>
@@ -94,13 +95,16 @@ public:
 };
 
 
+// nRealPoolIdx is realCommit's position in vPool (CCommitmentPool::FindIndex),
+// or -1 if it is not in the pool; that position is never picked as a decoy.
 bool BuildAnonymitySet(const CPedersenCommitment& realCommit,
-                        const std::vector<CPedersenCommitment>& vAllCommitments,
+                        int64_t nRealPoolIdx,
+                        const CCommitmentPoolSnapshot& vPool,
                         const uint256& blockHashSeed,
                         int nBlockHeight,
                         CAnonymitySet& setOut);
 
-bool SelectDecoys(const std::vector<CPedersenCommitment>& vPool,
+bool SelectDecoys(uint64_t nPoolSize,
                    int nCount,
                    const uint256& seed,
                    std::vector<int>& vIndicesOut,
@@ -26,6 +26,9 @@
 #include "curvetree.h"
 #include "finality.h"
 #include "dag.h"
+#include "checkqueue.h"
+#include "txcache.h"
+#include "blockimport.h"
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -202,6 +205,9 @@ bool fImporting = false;
 bool fReindex = false;
 bool fFullReplayVerify = false;
 bool fAddrIndex = false;
+int nScriptCheckThreads = 0;
+std::atomic<uint64_t> nTxHashCacheHits(0);
+std::atomic<uint64_t> nBlockHashCacheHits(0);
 
 bool fSPVMode = false;
 bool fSPVHeadersOnly = false;
@@ -243,6 +249,8 @@ int64_t nMinimumInputValue = 0;
 
 unsigned int nCoinCacheSize = 5000;
 
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
 extern enum Checkpoints::CPMode CheckpointsMode;
 
 std::set<uint256> setValidatedTx;
@@ -406,6 +414,10 @@ bool Finalise()
 
     finaliseRingSigs();
 
+#ifdef USE_LEVELDB
+    if (GetBoolArg("-blockindexsnapshot", true))
+        CTxDB().WriteBlockIndexSnapshot();
+#endif
     CTxDB().Close();
 
 
@@ -1286,10 +1298,6 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
     if (pfMissingInputs)
         *pfMissingInputs = false;
 
-    size_t nMaxMempoolSize = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-    if (GetTotalMemoryUsage() >= nMaxMempoolSize)
-        return error("CTxMemPool::accept() : mempool full (%" PRIu64" bytes)", (uint64_t)nMaxMempoolSize);
-
     if (!tx.CheckTransaction())
         return error("CTxMemPool::accept() : CheckTransaction failed");
 
@@ -1350,12 +1358,15 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
         }
     }
 
+    int64_t nFees = 0;
+    unsigned int nSize = 0;
+    double dPriority = 0;
+    int64_t nInChainInputValue = 0;
     {
         MapPrevTx mapInputs;
         //map<uint256, CTxIndex> mapUnused;
 		std::map<uint256, CTxIndex> mapUnused;
         bool fInvalid = false;
-        int64_t nFees;
         if (!tx.FetchInputs(txdb, mapUnused, false, false, mapInputs, fInvalid))
         {
             if (fInvalid)
@@ -1497,6 +1508,9 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
                             return error("CTxMemPool::accept() : %s", strFCMPError.c_str());
                     }
 
+                    // All of the tx's range proofs are verified as one batch after the output loop.
+                    CRangeProofBatch rangeProofs;
+
                     for (size_t i = 0; i < tx.vShieldedSpend.size(); i++)
                     {
                         // B2-e Phase 3c.4: an owner reclaim (2007) spends a 3-generator cv3 leaf; its value proofs
@@ -1510,8 +1524,8 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
 
                         if (fHideAmount)
                         {
-                            if (!VerifyBulletproofRangeProof(cvSpendValue, tx.vShieldedSpend[i].rangeProof))
-                                return error("CTxMemPool::accept() : shielded spend %d range proof failed", (int)i);
+                            rangeProofs.Add(cvSpendValue, tx.vShieldedSpend[i].rangeProof, 0,
+                                            strprintf("shielded spend %d", (int)i));
                         }
                         else
                         {
@@ -1608,8 +1622,8 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
                             continue;   // value bound by range-over-Vv + the (G,J) link (CheckMofNMintOutput)
                         if (fHideAmount)
                         {
-                            if (!VerifyBulletproofRangeProof(tx.vShieldedOutput[i].cv, tx.vShieldedOutput[i].rangeProof))
-                                return error("CTxMemPool::accept() : shielded output %d range proof failed", (int)i);
+                            rangeProofs.Add(tx.vShieldedOutput[i].cv, tx.vShieldedOutput[i].rangeProof, 0,
+                                            strprintf("shielded output %d", (int)i));
                         }
                         else
                         {
@@ -1620,6 +1634,13 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
                         }
                     }
 
+                    if (!rangeProofs.IsEmpty())
+                    {
+                        size_t nBadProof = 0;
+                        if (!rangeProofs.Verify(nBadProof))
+                            return error("CTxMemPool::accept() : %s range proof failed", rangeProofs.vDescription[nBadProof].c_str());
+                    }
+
                     if (!fHideAmount)
                     {
                         int64_t nPlainIn = 0, nPlainOut = 0;
@@ -1665,7 +1686,7 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
             // you should add code here to check that the transaction does a
             // reasonable number of ECDSA signature verifications.
 
-            unsigned int nSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+            nSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
             // Don't accept it if it can't get into a block
 
             int64_t txMinFee = tx.GetMinFee(1000, feeMode, nSize);
@@ -1709,8 +1730,42 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
             {
                 return error("CTxMemPool::accept() : ConnectInputs failed %s", hash.ToString().substr(0,10).c_str());
             };
+
+            // Coin-age priority of the confirmed inputs, kept with the entry so
+            // block assembly doesn't have to read every input back from disk.
+            // Inputs from other pool transactions (pos 1,1,1) count from when
+            // they confirm, as before.
+            for (const CTxIn& txin : tx.vin)
+            {
+                if (tx.nVersion == ANON_TXN_VERSION && txin.IsAnonInput())
+                    continue;
+                MapPrevTx::const_iterator mi = mapInputs.find(txin.prevout.hash);
+                if (mi == mapInputs.end() || mi->second.first.pos == CDiskTxPos(1,1,1))
+                    continue;
+                int64_t nValueIn = mi->second.second.vout[txin.prevout.n].nValue;
+                dPriority += (double)nValueIn * mi->second.first.GetDepthInMainChain();
+                nInChainInputValue += nValueIn;
+            }
+            dPriority /= nSize;
         };
 
+    CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, nBestHeight, nInChainInputValue);
+    size_t nMaxMempoolSize = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    {
+        LOCK(cs);
+        std::set<uint256> setAncestors;
+        CalculateAncestors(tx, setAncestors);
+        if (setAncestors.size() + 1 > (size_t)GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT))
+            return error("CTxMemPool::accept() : tx %s has too many unconfirmed ancestors (%" PRIszu")",
+                         hash.ToString().substr(0,10).c_str(), setAncestors.size());
+
+        // A full pool only takes a tx that pays better than what it would evict
+        if (nTotalUsage + entry.nUsage > nMaxMempoolSize && !isNameTx &&
+            (double)nFees / nSize <= GetMinFeeRate())
+            return error("CTxMemPool::accept() : mempool full (%" PRIu64" bytes), fee rate %.3f too low",
+                         (uint64_t)nMaxMempoolSize, (double)nFees / nSize);
+    }
+
     // Do not write to memory if read only mode.
     if(!fOnlyCheckWithoutAdding)
     {
@@ -1721,7 +1776,7 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
                 printf("CTxMemPool::accept() : replacing tx %s with new version\n", ptxOld->GetHash().ToString().c_str());
                 remove(*ptxOld);
             }
-            addUnchecked(hash, tx);
+            addUnchecked(hash, tx, entry);
 
             if (tx.IsShielded())
             {
@@ -1736,6 +1791,11 @@ bool CTxMemPool::accept(CTxDB& txdb, CTransaction &tx, bool fCheckInputs,
 
             //Add the TX to our Pending Names in Name DB
             hooks->AddToPendingNames(tx);
+
+            TrimToSize(nMaxMempoolSize);
+            if (!mapTx.count(hash))
+                return error("CTxMemPool::accept() : mempool full (%" PRIu64" bytes), tx %s evicted",
+                             (uint64_t)nMaxMempoolSize, hash.ToString().substr(0,10).c_str());
         }
 
         ///// are we sure this is ok when loading transactions or restoring block txes
@@ -1917,19 +1977,213 @@ void CTxMemPool::AddTransactionsUpdated(unsigned int n)
     nTransactionsUpdated += n;
 }
 
+CTxMemPoolEntry::CTxMemPoolEntry()
+{
+    nFee = 0;
+    nTxSize = 0;
+    nUsage = 0;
+    nTime = 0;
+    dEntryPriority = 0;
+    nEntryHeight = 0;
+    nInChainInputValue = 0;
+    nAncestorFee = 0;
+    nAncestorSize = 0;
+    nAncestorCount = 0;
+    nDescendantFee = 0;
+    nDescendantSize = 0;
+    nDescendantCount = 0;
+}
+
+CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& tx, int64_t nFeeIn, int64_t nTimeIn,
+                                 double dEntryPriorityIn, int nEntryHeightIn, int64_t nInChainInputValueIn)
+{
+    nFee = nFeeIn;
+    nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+    nTime = nTimeIn;
+    dEntryPriority = dEntryPriorityIn;
+    nEntryHeight = nEntryHeightIn;
+    nInChainInputValue = nInChainInputValueIn;
+    nAncestorFee = nFee;
+    nAncestorSize = nTxSize;
+    nAncestorCount = 1;
+    nDescendantFee = nFee;
+    nDescendantSize = nTxSize;
+    nDescendantCount = 1;
+
+    // Rough heap footprint: the serialized bytes stand in for scripts and
+    // proofs, plus the fixed-size parts of the tx, its mapTx/mapEntry nodes
+    // and a mapNextTx node per input
+    nUsage = nTxSize + sizeof(CTransaction) + sizeof(CTxMemPoolEntry) + 4 * 32
+           + tx.vin.size() * (sizeof(CTxIn) + sizeof(COutPoint) + sizeof(CInPoint) + 32)
+           + tx.vout.size() * sizeof(CTxOut);
+}
+
 bool CTxMemPool::addUnchecked(const uint256& hash, CTransaction &tx)
+{
+    // Nothing known about its inputs: no fee, no priority
+    return addUnchecked(hash, tx, CTxMemPoolEntry(tx, 0, GetTime(), 0, nBestHeight, 0));
+}
+
+bool CTxMemPool::addUnchecked(const uint256& hash, CTransaction &tx, const CTxMemPoolEntry& entryIn)
 {
     // Add to memory pool without checking anything.  Don't call this directly,
     // call CTxMemPool::accept to properly check the transaction first.
     {
+        if (mapTx.count(hash))
+            RemoveEntry(hash);
+
+        CTxMemPoolEntry entry(entryIn);
+        std::set<uint256> setAncestors;
+        CalculateAncestors(tx, setAncestors);
+        entry.nAncestorFee = entry.nFee;
+        entry.nAncestorSize = entry.nTxSize;
+        entry.nAncestorCount = 1 + setAncestors.size();
+        entry.nDescendantFee = entry.nFee;
+        entry.nDescendantSize = entry.nTxSize;
+        entry.nDescendantCount = 1;
+        for (const uint256& hashAncestor : setAncestors)
+        {
+            std::map<uint256, CTxMemPoolEntry>::iterator itAncestor = mapEntry.find(hashAncestor);
+            entry.nAncestorFee += itAncestor->second.nFee;
+            entry.nAncestorSize += itAncestor->second.nTxSize;
+            UpdateDescendantScore(itAncestor, entry.nFee, entry.nTxSize, 1);
+        }
+
         mapTx[hash] = tx;
         for (unsigned int i = 0; i < tx.vin.size(); i++)
             mapNextTx[tx.vin[i].prevout] = CInPoint(&mapTx[hash], i);
+        mapEntry[hash] = entry;
+        setByAncestorFeeRate.insert(CTxMemPoolFeeKey(entry.GetAncestorFeeRate(), hash));
+        setByDescendantScore.insert(CTxMemPoolFeeKey(entry.GetDescendantScore(), hash));
+        nTotalUsage += entry.nUsage;
         nTransactionsUpdated++;
     }
     return true;
 }
 
+void CTxMemPool::CalculateAncestors(const CTransaction& tx, std::set<uint256>& setAncestors) const
+{
+    std::vector<const CTransaction*> vWork(1, &tx);
+    while (!vWork.empty())
+    {
+        const CTransaction* ptx = vWork.back();
+        vWork.pop_back();
+        for (const CTxIn& txin : ptx->vin)
+        {
+            std::map<uint256, CTransaction>::const_iterator mi = mapTx.find(txin.prevout.hash);
+            if (mi != mapTx.end() && setAncestors.insert(mi->first).second)
+                vWork.push_back(&mi->second);
+        }
+    }
+}
+
+void CTxMemPool::CalculateDescendants(const uint256& hash, std::set<uint256>& setDescendants) const
+{
+    std::vector<uint256> vWork(1, hash);
+    while (!vWork.empty())
+    {
+        uint256 hashParent = vWork.back();
+        vWork.pop_back();
+        std::map<COutPoint, CInPoint>::const_iterator it = mapNextTx.lower_bound(COutPoint(hashParent, 0));
+        for (; it != mapNextTx.end() && it->first.hash == hashParent; ++it)
+        {
+            uint256 hashChild = it->second.ptx->GetHash();
+            if (setDescendants.insert(hashChild).second)
+                vWork.push_back(hashChild);
+        }
+    }
+}
+
+void CTxMemPool::UpdateAncestorFeeRate(std::map<uint256, CTxMemPoolEntry>::iterator it,
+                                       int64_t nFeeDelta, int64_t nSizeDelta, int nCountDelta)
+{
+    CTxMemPoolEntry& entry = it->second;
+    setByAncestorFeeRate.erase(CTxMemPoolFeeKey(entry.GetAncestorFeeRate(), it->first));
+    entry.nAncestorFee += nFeeDelta;
+    entry.nAncestorSize += nSizeDelta;
+    entry.nAncestorCount += nCountDelta;
+    setByAncestorFeeRate.insert(CTxMemPoolFeeKey(entry.GetAncestorFeeRate(), it->first));
+}
+
+void CTxMemPool::UpdateDescendantScore(std::map<uint256, CTxMemPoolEntry>::iterator it,
+                                       int64_t nFeeDelta, int64_t nSizeDelta, int nCountDelta)
+{
+    CTxMemPoolEntry& entry = it->second;
+    setByDescendantScore.erase(CTxMemPoolFeeKey(entry.GetDescendantScore(), it->first));
+    entry.nDescendantFee += nFeeDelta;
+    entry.nDescendantSize += nSizeDelta;
+    entry.nDescendantCount += nCountDelta;
+    setByDescendantScore.insert(CTxMemPoolFeeKey(entry.GetDescendantScore(), it->first));
+}
+
+// Drop the cached data for hash and take it out of its descendants'
+// ancestor totals and its ancestors' descendant totals; the caller erases
+// it from mapTx and mapNextTx. Descendants left behind (a parent mined on
+// its own) stay counted in the ancestors, which are normally mined with it.
+void CTxMemPool::RemoveEntry(const uint256& hash)
+{
+    std::map<uint256, CTxMemPoolEntry>::iterator it = mapEntry.find(hash);
+    if (it == mapEntry.end())
+        return;
+
+    const CTxMemPoolEntry& entry = it->second;
+    std::set<uint256> setDescendants;
+    CalculateDescendants(hash, setDescendants);
+    for (const uint256& hashDescendant : setDescendants)
+    {
+        std::map<uint256, CTxMemPoolEntry>::iterator itDescendant = mapEntry.find(hashDescendant);
+        if (itDescendant != mapEntry.end())
+            UpdateAncestorFeeRate(itDescendant, -entry.nFee, -(int64_t)entry.nTxSize, -1);
+    }
+
+    std::map<uint256, CTransaction>::const_iterator mi = mapTx.find(hash);
+    if (mi != mapTx.end())
+    {
+        std::set<uint256> setAncestors;
+        CalculateAncestors(mi->second, setAncestors);
+        for (const uint256& hashAncestor : setAncestors)
+        {
+            std::map<uint256, CTxMemPoolEntry>::iterator itAncestor = mapEntry.find(hashAncestor);
+            if (itAncestor != mapEntry.end())
+                UpdateDescendantScore(itAncestor, -entry.nFee, -(int64_t)entry.nTxSize, -1);
+        }
+    }
+
+    setByAncestorFeeRate.erase(CTxMemPoolFeeKey(entry.GetAncestorFeeRate(), hash));
+    setByDescendantScore.erase(CTxMemPoolFeeKey(entry.GetDescendantScore(), hash));
+    nTotalUsage -= entry.nUsage;
+    mapEntry.erase(it);
+}
+
+void CTxMemPool::TrimToSize(size_t nSizeLimit, std::vector<uint256>* pvRemoved)
+{
+    LOCK(cs);
+    int nEvicted = 0;
+    while (nTotalUsage > nSizeLimit && !setByDescendantScore.empty())
+    {
+        uint256 hash = setByDescendantScore.rbegin()->hash;
+        std::set<uint256> setRemove;
+        CalculateDescendants(hash, setRemove);
+        setRemove.insert(hash);
+
+        CTransaction tx = mapTx[hash];
+        remove(tx, true);
+        nEvicted += setRemove.size();
+        if (pvRemoved)
+            pvRemoved->insert(pvRemoved->end(), setRemove.begin(), setRemove.end());
+    }
+    if (nEvicted > 0 && fDebug)
+        printf("CTxMemPool::TrimToSize() : evicted %d txs, %" PRIszu" bytes in use\n", nEvicted, nTotalUsage);
+}
+
+double CTxMemPool::GetMinFeeRate() const
+{
+    LOCK(cs);
+    if (setByDescendantScore.empty())
+        return 0;
+    return setByDescendantScore.rbegin()->dFeeRate;
+}
+
 
 bool CTxMemPool::remove(const CTransaction &tx, bool fRecursive)
 {
@@ -1948,9 +2202,9 @@ bool CTxMemPool::remove(const CTransaction &tx, bool fRecursive)
                         remove(*it->second.ptx, true);
                 };
             };
+            RemoveEntry(hash);
             for (const CTxIn& txin : tx.vin)
                 mapNextTx.erase(txin.prevout);
-            mapTx.erase(hash);
 
             if (tx.nVersion == ANON_TXN_VERSION)
             {
@@ -1977,6 +2231,9 @@ bool CTxMemPool::remove(const CTransaction &tx, bool fRecursive)
                 }
             };
 
+            // tx may live in mapTx itself (recursive removal passes
+            // mapNextTx's pointer), so erase it last
+            mapTx.erase(hash);
             nTransactionsUpdated++;
         };
     }
@@ -2068,6 +2325,7 @@ void CTxMemPool::RemoveDAGConflicts(const uint256& hashBlock)
             for (const CShieldedSpendDescription& spend : txCopy.vShieldedSpend)
                 mapShieldedNullifier.erase(spend.nullifier);
 
+            RemoveEntry(txHash);
             mapTx.erase(txHash);
             nRemoved++;
             ++nTransactionsUpdated;
@@ -2084,6 +2342,10 @@ void CTxMemPool::clear()
     LOCK(cs);
     mapTx.clear();
     mapNextTx.clear();
+    mapEntry.clear();
+    setByAncestorFeeRate.clear();
+    setByDescendantScore.clear();
+    nTotalUsage = 0;
     mapKeyImage.clear();
     mapShieldedNullifier.clear();
     setDAGSeenTxids.clear();
@@ -2336,6 +2598,39 @@ bool CBlock::ReadFromDisk(const CBlockIndex* pindex, bool fReadTransactions)
     return true;
 }
 
+bool ReadRawBlockFromDisk(const CBlockIndex* pindex, std::vector<char>& vchBlock)
+{
+    // WriteToDisk() puts the message start and size in front of the block
+    if (pindex->nBlockPos < sizeof(pchMessageStart) + sizeof(unsigned int))
+        return error("ReadRawBlockFromDisk() : bad block position");
+    CAutoFile filein = CAutoFile(OpenBlockFile(pindex->nFile, pindex->nBlockPos - sizeof(pchMessageStart) - sizeof(unsigned int), "rb"), SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return error("ReadRawBlockFromDisk() : OpenBlockFile failed");
+
+    unsigned char pchMessageStartDisk[sizeof(pchMessageStart)];
+    unsigned int nSize = 0;
+    try {
+        filein >> FLATDATA(pchMessageStartDisk) >> nSize;
+        if (memcmp(pchMessageStartDisk, pchMessageStart, sizeof(pchMessageStart)) != 0)
+            return error("ReadRawBlockFromDisk() : bad message start");
+        // The indexed size doubles as a check that the disk and wire encodings agree
+        if (nSize < 80 || nSize > MAX_SIZE || (pindex->nSize != 0 && nSize != pindex->nSize))
+            return error("ReadRawBlockFromDisk() : bad block size %u", nSize);
+        vchBlock.resize(nSize);
+        filein.read(&vchBlock[0], nSize);
+    }
+    catch (std::exception &e) {
+        return error("%s() : I/O error", __PRETTY_FUNCTION__);
+    }
+
+    // Guard against a stale position: the header must be the indexed one
+    CDataStream ssHeader(SER_NETWORK | SER_BLOCKHEADERONLY, PROTOCOL_VERSION);
+    ssHeader << pindex->GetBlockHeader();
+    if (memcmp(&ssHeader[0], &vchBlock[0], ssHeader.size()) != 0)
+        return error("ReadRawBlockFromDisk() : header doesn't match index");
+    return true;
+}
+
 uint256 static GetOrphanRoot(const CBlock* pblock)
 {
     // Work back to the first block in the orphan chain
@@ -3273,6 +3568,7 @@ void static InvalidChainFound(CBlockIndex* pindexNew)
 void CBlock::UpdateTime(const CBlockIndex* pindexPrev)
 {
     nTime = max(GetBlockTime(), GetAdjustedTime());
+    ClearHashCache();
 }
 
 
@@ -3403,7 +3699,7 @@ bool CTransaction::FetchInputs(CTxDB& txdb, const map<uint256, CTxIndex>& mapTes
         else
         {
             // Get prev tx from disk
-            if (!txPrev.ReadFromDisk(txindex.pos))
+            if (!txdb.ReadTxAtPos(prevout.hash, txindex.pos, txPrev))
                 return error("FetchInputs() : %s ReadFromDisk prev tx %s failed", GetHash().ToString().substr(0,10).c_str(),  prevout.hash.ToString().substr(0,10).c_str());
         }
     }
@@ -3665,9 +3961,82 @@ unsigned int CTransaction::GetP2SHSigOpCount(const MapPrevTx& inputs) const
     return nSigOps;
 }
 
+bool CScriptCheckFailure::FailedBefore(unsigned int nTxIn, unsigned int nInIn) const
+{
+    LOCK(cs);
+    return fFailed && (nTx < nTxIn || (nTx == nTxIn && nIn < nInIn));
+}
+
+void CScriptCheckFailure::Record(unsigned int nTxIn, unsigned int nInIn, int nDoSIn)
+{
+    LOCK(cs);
+    if (fFailed && (nTx < nTxIn || (nTx == nTxIn && nIn < nInIn)))
+        return;
+    fFailed = true;
+    nTx = nTxIn;
+    nIn = nInIn;
+    nDoS = nDoSIn;
+}
+
+bool CScriptCheckFailure::Get(unsigned int& nTxOut, unsigned int& nInOut, int& nDoSOut) const
+{
+    LOCK(cs);
+    if (!fFailed)
+        return false;
+    nTxOut = nTx;
+    nInOut = nIn;
+    nDoSOut = nDoS;
+    return true;
+}
+
+CScriptCheck::CScriptCheck(const CTransaction& txFrom, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, int nHashTypeIn,
+                           unsigned int nTxIn, CScriptCheckFailure* pfailureIn)
+    : scriptPubKey(txFrom.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey),
+      ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), nHashType(nHashTypeIn),
+      fPrevHashOk(txToIn.vin[nInIn].prevout.hash == txFrom.GetHash()),
+      nTx(nTxIn), pfailure(pfailureIn)
+{
+}
+
+bool CScriptCheck::operator()() const
+{
+    // An earlier failure in block order already decides both the verdict and
+    // which transaction is charged; nothing left to learn from this input.
+    if (pfailure && pfailure->FailedBefore(nTx, nIn))
+        return false;
+
+    const CScript& scriptSig = ptxTo->vin[nIn].scriptSig;
+    if (fPrevHashOk && VerifyScript(scriptSig, scriptPubKey, *ptxTo, nIn, nFlags, nHashType))
+        return true;
+
+    if (pfailure)
+    {
+        // Same split as ConnectInputs: failing only a non-mandatory flag is
+        // rejected without a DoS score.
+        int nDoSFail = 100;
+        if (fPrevHashOk && (nFlags & STANDARD_NOT_MANDATORY_VERIFY_FLAGS) &&
+            VerifyScript(scriptSig, scriptPubKey, *ptxTo, nIn, nFlags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, nHashType))
+            nDoSFail = 0;
+        pfailure->Record(nTx, nIn, nDoSFail);
+    }
+    return false;
+}
+
+void ThreadScriptCheck(void* parg)
+{
+    RenameThread("innova-scriptch");
+    scriptcheckqueue.Thread();
+}
+
+void InterruptScriptCheck()
+{
+    scriptcheckqueue.Interrupt();
+}
+
 bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTxIndex>& mapTestPool, const CDiskTxPos& posThisTx,
     const CBlockIndex* pindexBlock, bool fBlock, bool fMiner, unsigned int flags, bool fValidateSig, bool fSkipFCMP,
-    bool fValidatedCoinstake)
+    bool fValidatedCoinstake, std::vector<CScriptCheck>* pvChecks, unsigned int nTxInBlock, CScriptCheckFailure* pfailure,
+    CRangeProofBatch* pRangeProofs)
 {
     // Take over previous transactions' spent pointers
     // fBlock is true when this is called from AcceptBlock when a new best-block is added to the blockchain
@@ -3747,8 +4116,12 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
             // -replayblocks to re-validate mainnet history end to end, not just to the checkpoint).
             if (!(fBlock && !fFullReplayVerify && (nBestHeight < Checkpoints::GetTotalBlocksEstimate())))
             {
+                // Defer to the script check queue; ConnectBlock waits on it
+                // before anything in mapTestPool is committed.
+                if (pvChecks)
+                    pvChecks->push_back(CScriptCheck(txPrev, *this, i, flags, 0, nTxInBlock, pfailure));
                 // Verify signature
-                if (!VerifySignature(txPrev, *this, i, flags, 0))
+                else if (!VerifySignature(txPrev, *this, i, flags, 0))
                 {
                     if (flags & STANDARD_NOT_MANDATORY_VERIFY_FLAGS) {
                     // Check whether the failure was caused by a
@@ -3869,6 +4242,12 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
 
                 int nBlockHeight = pindexBlock ? pindexBlock->nHeight : nBestHeight;
 
+                // Range proofs are the bulk of the per-spend/per-output cost, so they are
+                // collected and verified as one batch after the loops below: into the
+                // caller's block-wide batch when ConnectBlock passes one, else per tx.
+                CRangeProofBatch rangeProofsTx;
+                CRangeProofBatch& rangeProofs = pRangeProofs ? *pRangeProofs : rangeProofsTx;
+
                 // Post-fork enforcement: after FCMP fork, reject old tx versions with shielded spends
                 if (nBlockHeight >= FORK_HEIGHT_FCMP_VALIDATION && !vShieldedSpend.empty()
                     && nVersion < SHIELDED_TX_VERSION_FCMP)
@@ -3948,8 +4327,8 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
 
                     if (fHideAmount)
                     {
-                        if (!VerifyBulletproofRangeProof(cvSpendValue, vShieldedSpend[i].rangeProof))
-                            return DoS(100, error("ConnectInputs() : shielded spend %d range proof failed", (int)i));
+                        rangeProofs.Add(cvSpendValue, vShieldedSpend[i].rangeProof, nTxInBlock,
+                                        strprintf("shielded spend %d", (int)i));
                     }
                     else
                     {
@@ -4057,15 +4436,15 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
                         CPedersenCommitment cvOutValue;
                         if (!NullStakeMofNDeriveValueCommitment(vShieldedOutput[i].cv, nullstakeProofV3.delegationHash, cvOutValue))
                             return DoS(100, error("ConnectInputs() : M-of-N coinstake output %d cv_plain derivation failed", (int)i));
-                        if (!VerifyBulletproofRangeProof(cvOutValue, vShieldedOutput[i].rangeProof))
-                            return DoS(100, error("ConnectInputs() : M-of-N coinstake output %d continuity range proof failed", (int)i));
+                        rangeProofs.Add(cvOutValue, vShieldedOutput[i].rangeProof, nTxInBlock,
+                                        strprintf("M-of-N coinstake output %d continuity", (int)i));
                         continue;
                     }
 
                     if (fHideAmount)
                     {
-                        if (!VerifyBulletproofRangeProof(vShieldedOutput[i].cv, vShieldedOutput[i].rangeProof))
-                            return DoS(100, error("ConnectInputs() : shielded output %d range proof failed", (int)i));
+                        rangeProofs.Add(vShieldedOutput[i].cv, vShieldedOutput[i].rangeProof, nTxInBlock,
+                                        strprintf("shielded output %d", (int)i));
                     }
                     else
                     {
@@ -4075,6 +4454,13 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
                             return DoS(100, error("ConnectInputs() : DSP output %d commitment opening proof failed", (int)i));
                     }
                 }
+
+                if (!pRangeProofs && !rangeProofsTx.IsEmpty())
+                {
+                    size_t nBadProof = 0;
+                    if (!rangeProofsTx.Verify(nBadProof))
+                        return DoS(100, error("ConnectInputs() : %s range proof failed", rangeProofsTx.vDescription[nBadProof].c_str()));
+                }
                 // 3c.2: an M-of-N cold-stake coinstake must keep ALL value inside D-bound shielded outputs --
                 // no value-bearing transparent vout (only the empty coinstake marker vout[0] is permitted),
                 // so neither principal nor the minted reward can be skimmed to a transparent output.
@@ -4153,11 +4539,23 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
     return true;
 }
 
+static bool UpdateAddrIndex(CTxDB& txdb, const std::vector<CAddrIndexEntry>& vEntries, bool fConnect);
+
 bool CBlock::DisconnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fWriteNames)
 {
     std::set<uint256> setDAGSkippedTxs = GetDAGSkippedTxsForBlock(*this, pindex);
     CBlock activeBlock = GetDAGActiveBlock(*this, setDAGSkippedTxs);
 
+    // Address entries are worked out again, while the spent outputs they
+    // came from are still indexed
+    if (fAddrIndex)
+    {
+        std::vector<CAddrIndexEntry> vAddrEntries;
+        if (!GetAddrIndexEntries(txdb, pindex->nHeight, setDAGSkippedTxs, vAddrEntries) ||
+            !UpdateAddrIndex(txdb, vAddrEntries, false))
+            return error("DisconnectBlock() : address index update failed");
+    }
+
     // Disconnect in reverse order
     for (int i = vtx.size()-1; i >= 0; i--)
     {
@@ -4328,77 +4726,256 @@ bool static BuildAddrIndex(const CScript &script, std::vector<uint160>& addrIds)
     }
 }
 
-bool FindTransactionsByDestination(const CTxDestination &dest, std::vector<uint256> &vtxhash) {
-    uint160 addrid = 0;
+static uint160 GetAddrId(const CTxDestination &dest)
+{
     const CKeyID *pkeyid = boost::get<CKeyID>(&dest);
     if (pkeyid)
-        addrid = static_cast<uint160>(*pkeyid);
-    if (!addrid) {
-        const CScriptID *pscriptid = boost::get<CScriptID>(&dest);
-        if (pscriptid)
-            addrid = static_cast<uint160>(*pscriptid);
-    }
+        return static_cast<uint160>(*pkeyid);
+    const CScriptID *pscriptid = boost::get<CScriptID>(&dest);
+    if (pscriptid)
+        return static_cast<uint160>(*pscriptid);
+    return 0;
+}
+
+bool GetAddressSummary(const CTxDestination &dest, CAddrSummary &summary)
+{
+    uint160 addrid = GetAddrId(dest);
+    if (!addrid)
+        return false;
+
+    summary = CAddrSummary();
+    CTxDB txdb("r");
+    txdb.ReadAddrSummary(addrid, summary);
+    return true;
+}
+
+bool FindTransactionsByDestination(const CTxDestination &dest, std::vector<uint256> &vtxhash, int nSkip, int nCount, unsigned int &nTotal)
+{
+    vtxhash.clear();
+    nTotal = 0;
+    uint160 addrid = GetAddrId(dest);
     if (!addrid)
     {
         printf("FindTransactionsByDestination(): Couldn't parse dest into addrid\n");
         return false;
     }
+    if (nCount < 0)
+        nCount = 0;
 
+    // The summary's count and the page come from the same tip
     LOCK(cs_main);
     CTxDB txdb("r");
-    if(!txdb.ReadAddrIndex(addrid, vtxhash))
+    CAddrSummary summary;
+    txdb.ReadAddrSummary(addrid, summary);
+
+    // History written by older versions is one vector per address: page
+    // through it in memory, followed by anything indexed since.
+    std::vector<uint256> vLegacy;
+    if (txdb.ReadLegacyAddrIndex(addrid, vLegacy))
+    {
+        std::vector<CAddrIndexEntry> vEntries;
+        if (!txdb.ReadAddrIndex(addrid, vEntries))
+            return false;
+        std::set<uint256> setLegacy(vLegacy.begin(), vLegacy.end());
+        for (const CAddrIndexEntry& entry : vEntries)
+            if (!setLegacy.count(entry.first.hashTx))
+                vLegacy.push_back(entry.first.hashTx);
+
+        nTotal = vLegacy.size();
+        if (nSkip < 0)
+            nSkip = std::max(0, nSkip + (int)nTotal);
+        for (unsigned int i = nSkip; i < vLegacy.size() && vtxhash.size() < (unsigned int)nCount; i++)
+            vtxhash.push_back(vLegacy[i]);
+        return true;
+    }
+
+    // A negative skip counts back from the newest entry
+    nTotal = summary.nTxCount;
+    if (nSkip < 0)
+        nSkip = std::max(0, nSkip + (int)nTotal);
+
+    std::vector<CAddrIndexEntry> vEntries;
+    if (!txdb.ReadAddrIndex(addrid, vEntries, nSkip, nCount))
     {
-	printf("FindTransactionsByDestination(): txdb.ReadAddrIndex failed\n");
-	return false;
+        printf("FindTransactionsByDestination(): txdb.ReadAddrIndex failed\n");
+        return false;
     }
+    for (const CAddrIndexEntry& entry : vEntries)
+        vtxhash.push_back(entry.first.hashTx);
     return true;
 }
 
-void CBlock::RebuildAddressIndex(CTxDB& txdb)
+// The address index entries of this block's transactions: for each address
+// a transaction pays or spends, one entry with the amounts involved.
+bool CBlock::GetAddrIndexEntries(CTxDB& txdb, int nHeight, const std::set<uint256>& setSkippedTxs,
+                                 std::vector<CAddrIndexEntry>& vEntries)
 {
     for (CTransaction& tx : vtx)
     {
         uint256 hashTx = tx.GetHash();
-	// inputs
-	if(!tx.IsCoinBase())
-	{
+        if (setSkippedTxs.count(hashTx))
+            continue;
+
+        std::map<uint160, CAddrIndexDelta> mapDelta;
+        if (!tx.IsCoinBase())
+        {
             MapPrevTx mapInputs;
-	    map<uint256, CTxIndex> mapQueuedChangesT;
-	    bool fInvalid;
+            map<uint256, CTxIndex> mapQueuedChangesT;
+            bool fInvalid;
             if (!tx.FetchInputs(txdb, mapQueuedChangesT, true, false, mapInputs, fInvalid))
-                return;
+                return false;
 
-	    MapPrevTx::const_iterator mi;
-	    for(MapPrevTx::const_iterator mi = mapInputs.begin(); mi != mapInputs.end(); ++mi)
-	    {
-		    for (const CTxOut &atxout : (*mi).second.second.vout)
-		    {
-			std::vector<uint160> addrIds;
-			if(BuildAddrIndex(atxout.scriptPubKey, addrIds))
-			{
-                    for (uint160 addrId : addrIds)
-		            {
-			            if(!txdb.WriteAddrIndex(addrId, hashTx))
-				            printf("RebuildAddressIndex(): txins WriteAddrIndex failed addrId: %s txhash: %s\n", addrId.ToString().c_str(), hashTx.ToString().c_str());
-                    }
-			}
-		    }
-	    }
+            for (const CTxIn& txin : tx.vin)
+            {
+                if (tx.nVersion == ANON_TXN_VERSION && txin.IsAnonInput())
+                    continue;
+                const CTxOut& txoutPrev = mapInputs[txin.prevout.hash].second.vout[txin.prevout.n];
+                std::vector<uint160> addrIds;
+                if (txoutPrev.IsEmpty() || !BuildAddrIndex(txoutPrev.scriptPubKey, addrIds))
+                    continue;
+                for (const uint160& addrId : std::set<uint160>(addrIds.begin(), addrIds.end()))
+                {
+                    CAddrIndexDelta& delta = mapDelta[addrId];
+                    delta.nSent += txoutPrev.nValue;
+                    delta.nSpent++;
+                }
+            }
+        }
+
+        for (const CTxOut& txout : tx.vout)
+        {
+            // Coinstake markers and proof-of-stake coinbases pay nobody
+            std::vector<uint160> addrIds;
+            if (txout.IsEmpty() || !BuildAddrIndex(txout.scriptPubKey, addrIds))
+                continue;
+            for (const uint160& addrId : std::set<uint160>(addrIds.begin(), addrIds.end()))
+            {
+                CAddrIndexDelta& delta = mapDelta[addrId];
+                delta.nReceived += txout.nValue;
+                delta.nOutputs++;
+            }
+        }
+
+        for (std::map<uint160, CAddrIndexDelta>::const_iterator mi = mapDelta.begin(); mi != mapDelta.end(); ++mi)
+            vEntries.push_back(make_pair(CAddrIndexKey(mi->first, nHeight, hashTx), mi->second));
+    }
+    return true;
+}
+
+// Write (fConnect) or erase address index entries and move the summaries of
+// the addresses they touch.  Summaries are all read before anything is
+// written, while the caller's batch is at its smallest.
+static bool UpdateAddrIndex(CTxDB& txdb, const std::vector<CAddrIndexEntry>& vEntries, bool fConnect)
+{
+    std::map<uint160, std::pair<CAddrIndexDelta, unsigned int> > mapTotal;
+    for (const CAddrIndexEntry& entry : vEntries)
+    {
+        std::pair<CAddrIndexDelta, unsigned int>& total = mapTotal[entry.first.addrId];
+        total.first += entry.second;
+        total.second++;
+    }
+
+    std::vector<std::pair<uint160, CAddrSummary> > vSummary;
+    vSummary.reserve(mapTotal.size());
+    for (std::map<uint160, std::pair<CAddrIndexDelta, unsigned int> >::const_iterator mi = mapTotal.begin(); mi != mapTotal.end(); ++mi)
+    {
+        CAddrSummary summary;
+        txdb.ReadAddrSummary(mi->first, summary);
+        summary.Apply(mi->second.first, mi->second.second, fConnect);
+        vSummary.push_back(make_pair(mi->first, summary));
+    }
+
+    for (const CAddrIndexEntry& entry : vEntries)
+        if (!(fConnect ? txdb.WriteAddrIndex(entry) : txdb.EraseAddrIndex(entry.first)))
+            return error("UpdateAddrIndex() : %s entry failed for %s", fConnect ? "write" : "erase",
+                         entry.first.hashTx.ToString().c_str());
+
+    for (const std::pair<uint160, CAddrSummary>& item : vSummary)
+        if (!(item.second.IsNull() ? txdb.EraseAddrSummary(item.first) : txdb.WriteAddrSummary(item.first, item.second)))
+            return error("UpdateAddrIndex() : summary update failed for %s", item.first.ToString().c_str());
+    return true;
+}
+
+bool CBlock::RebuildAddressIndex(CTxDB& txdb, int nHeight)
+{
+    std::vector<CAddrIndexEntry> vEntries;
+    if (!GetAddrIndexEntries(txdb, nHeight, std::set<uint256>(), vEntries))
+        return false;
+    return UpdateAddrIndex(txdb, vEntries, true);
+}
+
+bool RebuildAddressIndex(unsigned int nThreads)
+{
+    int64_t nStart = GetTimeMillis();
+    CTxDB txdb("r+");
+    if (!txdb.EraseAddrIndexAll())
+        return error("RebuildAddressIndex() : failed to clear the old index");
+
+    std::vector<CBlockIndex*> vChain;
+    {
+        LOCK(cs_main);
+        for (CBlockIndex* pindex = pindexGenesisBlock; pindex; pindex = pindex->pnext)
+            vChain.push_back(pindex);
+    }
+    nThreads = std::max(1U, std::min(nThreads, (unsigned int)ADDRINDEX_MAX_THREADS));
+
+    // Workers read blocks and look up spent outputs, the slow part; each
+    // chunk of blocks then goes to disk as a single batch, in chain order.
+    uint64_t nEntries = 0;
+    unsigned int nFailed = 0;
+    for (unsigned int nBegin = 0; nBegin < vChain.size(); nBegin += ADDRINDEX_REBUILD_CHUNK)
+    {
+        if (fShutdown)
+            return false;
+        unsigned int nEnd = std::min((unsigned int)vChain.size(), nBegin + ADDRINDEX_REBUILD_CHUNK);
+        uiInterface.InitMessage(strprintf(_("Rebuilding address index, block %d of %d"),
+                                          vChain[nBegin]->nHeight, vChain.back()->nHeight));
+
+        std::vector<std::vector<CAddrIndexEntry> > vBlockEntries(nEnd - nBegin);
+        std::vector<char> vOk(nEnd - nBegin, 1);
+        std::atomic<unsigned int> nNext(nBegin);
+        auto worker = [&]()
+        {
+            CTxDB txdbRead("r");
+            for (unsigned int i = nNext++; i < nEnd; i = nNext++)
+            {
+                CBlock block;
+                if (!block.ReadFromDisk(vChain[i], true) ||
+                    !block.GetAddrIndexEntries(txdbRead, vChain[i]->nHeight,
+                                               GetDAGSkippedTxsForBlock(block, vChain[i]), vBlockEntries[i - nBegin]))
+                    vOk[i - nBegin] = 0;
+            }
+        };
+        boost::thread_group threads;
+        for (unsigned int i = 1; i < nThreads; i++)
+            threads.create_thread(worker);
+        worker();
+        threads.join_all();
 
+        std::vector<CAddrIndexEntry> vEntries;
+        for (unsigned int i = 0; i < vBlockEntries.size(); i++)
+        {
+            if (!vOk[i])
+            {
+                printf("RebuildAddressIndex() : skipped block %d\n", vChain[nBegin + i]->nHeight);
+                nFailed++;
+                continue;
+            }
+            vEntries.insert(vEntries.end(), vBlockEntries[i].begin(), vBlockEntries[i].end());
         }
-	// outputs
-	for (const CTxOut &atxout : tx.vout) {
-	    std::vector<uint160> addrIds;
-        if(BuildAddrIndex(atxout.scriptPubKey, addrIds))
-	    {
-		for (uint160 addrId : addrIds)
-		{
-		    if(!txdb.WriteAddrIndex(addrId, hashTx))
-		        printf("RebuildAddressIndex(): txouts WriteAddrIndex failed addrId: %s txhash: %s\n", addrId.ToString().c_str(), hashTx.ToString().c_str());
+
+        txdb.TxnBegin();
+        if (!UpdateAddrIndex(txdb, vEntries, true) || !txdb.TxnCommit())
+        {
+            txdb.TxnAbort();
+            return error("RebuildAddressIndex() : write failed at block %d", vChain[nBegin]->nHeight);
         }
-	    }
-	}
+        nEntries += vEntries.size();
     }
+
+    printf("Rebuilt address index of %" PRIszu" blocks (%u skipped), %" PRIu64" entries, %u threads in %" PRId64"ms\n",
+           vChain.size(), nFailed, nEntries, nThreads, GetTimeMillis() - nStart);
+    return true;
 }
 
 static int64_t nTimeVerify = 0;
@@ -4597,6 +5174,43 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck, boo
     unsigned int nPrivateStakeValidateCount = 0;
     unsigned int nAnonValidateCount = 0;
 
+    // Script checks are fanned out to the -par workers while the loop below
+    // carries on with the cheap checks, and joined before mapQueuedChanges is
+    // committed. Serial when -par leaves no workers.
+    CScriptCheckFailure scriptFailure;
+    CCheckQueueControl<CScriptCheck> control(nScriptCheckThreads ? &scriptcheckqueue : NULL);
+    unsigned int nScriptChecks = 0;
+
+    // Range proofs of every shielded tx in the block are likewise deferred and
+    // verified as a single batch next to the script join.
+    CRangeProofBatch rangeProofs;
+
+    // If the loop bails out after checks were deferred, a script or range
+    // proof failure earlier in block order is where the serial path would have
+    // stopped, and that path charges the transaction rather than the block.
+    // Undo whatever the later failure charged the block so peers are scored
+    // identically. A bailout that charged the block nothing has nothing to
+    // undo and skips the batch; control's destructor still joins the workers.
+    struct CDeferredCheckBailout
+    {
+        CCheckQueueControl<CScriptCheck>& control;
+        const CRangeProofBatch& rangeProofs;
+        int& nDoSBlock;
+        int nDoSSaved;
+        bool fDone;
+
+        CDeferredCheckBailout(CCheckQueueControl<CScriptCheck>& controlIn, const CRangeProofBatch& rangeProofsIn, int& nDoSIn)
+            : control(controlIn), rangeProofs(rangeProofsIn), nDoSBlock(nDoSIn), nDoSSaved(nDoSIn), fDone(false) {}
+        ~CDeferredCheckBailout()
+        {
+            if (fDone || nDoSBlock == nDoSSaved)
+                return;
+            size_t nBadProof = 0;
+            if (!control.Wait() || (!rangeProofs.IsEmpty() && !rangeProofs.Verify(nBadProof)))
+                nDoSBlock = nDoSSaved;
+        }
+    } deferredBailout(control, rangeProofs, nDoS);
+
     for (CTransaction& tx : vtx)
     {
         //const CTransaction &tx = vtx[i];
@@ -4641,7 +5255,11 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck, boo
 
         CDiskTxPos posThisTx(pindex->nFile, pindex->nBlockPos, nTxPos);
         if (!fJustCheck)
+        {
             nTxPos += nTxSize;
+            // Later transactions, in this block or the next few, spend it.
+            g_txCache.PutTx(hashTx, posThisTx, tx);
+        }
 
         MapPrevTx mapInputs;
         if (tx.IsCoinBase())
@@ -4734,8 +5352,12 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck, boo
             // block. A coinstake-shaped tx anywhere else gets full ordinary-tx
             // validation.
             bool fValidatedCoinstake = IsProofOfStake() && (&tx == &vtx[1]);
-            if (!tx.ConnectInputs(txdb, mapInputs, mapQueuedChanges, posThisTx, pindex, true, false, flags, true, fFCMPBatchVerified, fValidatedCoinstake))
+            std::vector<CScriptCheck> vChecks;
+            if (!tx.ConnectInputs(txdb, mapInputs, mapQueuedChanges, posThisTx, pindex, true, false, flags, true, fFCMPBatchVerified, fValidatedCoinstake,
+                                  control.IsActive() ? &vChecks : NULL, (unsigned int)(&tx - &vtx[0]), &scriptFailure, &rangeProofs))
                 return false;
+            nScriptChecks += vChecks.size();
+            control.Add(vChecks);
 
             int64_t nTxValidateMicros = GetTimeMicros() - nTxValidateStart;
             if (tx.IsCoinStake() && (tx.nVersion == SHIELDED_TX_VERSION_NULLSTAKE ||
@@ -4772,10 +5394,36 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck, boo
     //int64_t nTime1 = GetTimeMicros(); nTimeConnect += nTime1 - nTimeStart;
     //LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs-1), nTimeConnect * 0.000001);
 
-    // if (!control.Wait())
-    //     return state.DoS(100, false);
-    // int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart;
-    // LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs-1), nTimeVerify * 0.000001);
+    int64_t nScriptWaitStart = GetTimeMicros();
+    deferredBailout.fDone = true;
+    bool fScriptsOk = control.Wait();
+    int64_t nScriptWaitMicros = GetTimeMicros() - nScriptWaitStart;
+
+    int64_t nRangeProofStart = GetTimeMicros();
+    size_t nBadProof = 0;
+    bool fRangeProofsOk = rangeProofs.IsEmpty() || rangeProofs.Verify(nBadProof);
+    int64_t nRangeProofMicros = GetTimeMicros() - nRangeProofStart;
+
+    if (!fScriptsOk || !fRangeProofsOk)
+    {
+        // Charge whichever failure the serial path would have hit first:
+        // scripts run before the shielded checks within a transaction.
+        unsigned int nFailTx = 0, nFailIn = 0;
+        int nFailDoS = 100;
+        if (!fScriptsOk)
+            scriptFailure.Get(nFailTx, nFailIn, nFailDoS);
+        if (!fRangeProofsOk && (fScriptsOk || rangeProofs.vTx[nBadProof] < nFailTx))
+        {
+            const CTransaction& txFail = vtx[rangeProofs.vTx[nBadProof]];
+            return txFail.DoS(100, error("ConnectInputs() : %s range proof failed", rangeProofs.vDescription[nBadProof].c_str()));
+        }
+
+        // Charge the earliest failing input exactly as ConnectInputs does inline.
+        const CTransaction& txFail = vtx[nFailTx];
+        if (nFailDoS == 0)
+            return error("ConnectInputs() : %s non-mandatory VerifySignature failed", txFail.GetHash().ToString().c_str());
+        return txFail.DoS(100, error("ConnectInputs() : %s VerifySignature failed", txFail.GetHash().ToString().substr(0,10).c_str()));
+    }
 
 
     int64_t nFinalityRewardOut = 0;
@@ -5615,10 +6263,15 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck, boo
         bool fMutableCurveTree = (pindex->nHeight >= FORK_HEIGHT_FCMP &&
                                   pindex->nHeight < FORK_HEIGHT_EPOCH_ROOT_FCMP);
         if (fMutableCurveTree && pindex->pprev)
+        {
             txdb.ReadCurveTree(curveTree); // OK if not found (empty)
+            // Only a tree last written by an older version has anything to redo.
+            if (!curveTree.IsEmpty())
+                curveTree.RebuildParentNodes();
+        }
 
         if (fMutableCurveTree)
-            txdb.WriteCurveTreeAtBlock(pindex->GetBlockHash(), curveTree);
+            txdb.WriteCurveTreeAtBlock(pindex->GetBlockHash(), curveTree, pindex->nHeight);
 
         // Seed genesis commitments at the fork activation block
         // These provide the initial Lelantus anonymity set (16 unspendable decoys)
@@ -5759,12 +6412,13 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck, boo
     if (fJustCheck)
     {
         if (fDebug && GetBoolArg("-showtimers", false))
-            printf("ConnectBlock: height=%d justcheck total=%" PRId64"ms check=%" PRId64"ms tx_transparent=%u/%" PRId64"us tx_shielded=%u/%" PRId64"us tx_anon=%u/%" PRId64"us tx_privstake=%u/%" PRId64"us\n",
+            printf("ConnectBlock: height=%d justcheck total=%" PRId64"ms check=%" PRId64"ms tx_transparent=%u/%" PRId64"us tx_shielded=%u/%" PRId64"us tx_anon=%u/%" PRId64"us tx_privstake=%u/%" PRId64"us scripts=%u/%" PRId64"us-wait rangeproofs=%u/%" PRId64"us\n",
                    pindex->nHeight, GetTimeMillis() - nConnectBlockStart, nConnectCheckMs,
                    nTransparentValidateCount, nTransparentValidateMicros,
                    nShieldedValidateCount, nShieldedValidateMicros,
                    nAnonValidateCount, nAnonValidateMicros,
-                   nPrivateStakeValidateCount, nPrivateStakeValidateMicros);
+                   nPrivateStakeValidateCount, nPrivateStakeValidateMicros,
+                   nScriptChecks, nScriptWaitMicros, (unsigned int)rangeProofs.Size(), nRangeProofMicros);
         return true;
     }
 
@@ -5774,55 +6428,13 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck, boo
         if (!txdb.UpdateTxIndex((*mi).first, (*mi).second))
             return error("ConnectBlock() : UpdateTxIndex failed");
     }
-    if(GetBoolArg("-addrindex", false))
+    if (fAddrIndex)
     {
-        // Write Address Index
-        for (CTransaction& tx : vtx)
-        {
-            uint256 hashTx = tx.GetHash();
-            if (setDAGSkippedTxs.count(hashTx))
-                continue;
-        // inputs
-        if(!tx.IsCoinBase())
-        {
-                MapPrevTx mapInputs;
-            map<uint256, CTxIndex> mapQueuedChangesT;
-            bool fInvalid;
-                if (!tx.FetchInputs(txdb, mapQueuedChangesT, true, false, mapInputs, fInvalid))
-                    return false;
-
-            MapPrevTx::const_iterator mi;
-            for(MapPrevTx::const_iterator mi = mapInputs.begin(); mi != mapInputs.end(); ++mi)
-            {
-                for (const CTxOut &atxout : (*mi).second.second.vout)
-                {
-                std::vector<uint160> addrIds;
-                if(BuildAddrIndex(atxout.scriptPubKey, addrIds))
-                {
-                        for (uint160 addrId : addrIds)
-                        {
-                        if(!txdb.WriteAddrIndex(addrId, hashTx))
-                            printf("ConnectBlock(): txins WriteAddrIndex failed addrId: %s txhash: %s\n", addrId.ToString().c_str(), hashTx.ToString().c_str());
-                        }
-                }
-                }
-            }
-
-            }
-
-        // outputs
-        for (const CTxOut &atxout : tx.vout) {
-            std::vector<uint160> addrIds;
-                if(BuildAddrIndex(atxout.scriptPubKey, addrIds))
-            {
-            for (uint160 addrId : addrIds)
-            {
-                if(!txdb.WriteAddrIndex(addrId, hashTx))
-                    printf("ConnectBlock(): txouts WriteAddrIndex failed addrId: %s txhash: %s\n", addrId.ToString().c_str(), hashTx.ToString().c_str());
-                    }
-            }
-        }
-        }
+        std::vector<CAddrIndexEntry> vAddrEntries;
+        if (!GetAddrIndexEntries(txdb, pindex->nHeight, setDAGSkippedTxs, vAddrEntries))
+            return false;
+        if (!UpdateAddrIndex(txdb, vAddrEntries, true))
+            return error("ConnectBlock() : UpdateAddrIndex failed");
     }
 
     // Update block index on disk without changing it in memory.
@@ -5853,12 +6465,13 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck, boo
     uiInterface.NotifyRanksUpdated();
 
     if (fDebug && GetBoolArg("-showtimers", false))
-        printf("ConnectBlock: height=%d total=%" PRId64"ms check=%" PRId64"ms tx_transparent=%u/%" PRId64"us tx_shielded=%u/%" PRId64"us tx_anon=%u/%" PRId64"us tx_privstake=%u/%" PRId64"us\n",
+        printf("ConnectBlock: height=%d total=%" PRId64"ms check=%" PRId64"ms tx_transparent=%u/%" PRId64"us tx_shielded=%u/%" PRId64"us tx_anon=%u/%" PRId64"us tx_privstake=%u/%" PRId64"us scripts=%u/%" PRId64"us-wait rangeproofs=%u/%" PRId64"us\n",
                pindex->nHeight, GetTimeMillis() - nConnectBlockStart, nConnectCheckMs,
                nTransparentValidateCount, nTransparentValidateMicros,
                nShieldedValidateCount, nShieldedValidateMicros,
                nAnonValidateCount, nAnonValidateMicros,
-               nPrivateStakeValidateCount, nPrivateStakeValidateMicros);
+               nPrivateStakeValidateCount, nPrivateStakeValidateMicros,
+               nScriptChecks, nScriptWaitMicros, (unsigned int)rangeProofs.Size(), nRangeProofMicros);
 
     return true;
 }
@@ -7092,6 +7705,8 @@ bool CBlock::AcceptBlock()
             header.nNonce = nNonce;
             PushBlockAnnouncement(pnode, header, false);
         }
+        // Flush the announcements now rather than on the handler's next tick.
+        WakeMessageHandler();
     }
 
     // ppcoin: check pending sync-checkpoint
@@ -7930,75 +8545,77 @@ void PrintBlockTree()
     }
 }
 
+// Where an import spends its time: a reader that often finds the queue full
+// is waiting on validation; a validator that often waits for the next block
+// is held up by the reader or the parse threads.
+static void PrintBlockImportStats(const CBlockImportStats& stats, int nValidated, int64_t nValidateMicros)
+{
+    printf("LoadExternalBlockFile: read %.1fMB at %.1fMB/s (%.1fs waiting for queue room), "
+           "parsed %" PRIu64" blocks at %.0f/s per thread on %u threads, "
+           "validated %d at %.0f/s (%.1fs waiting for the next block), %u rescans\n",
+           stats.nBytesRead / 1048576.0, stats.nBytesRead / 1.048576 / std::max(stats.nReadMicros, (int64_t)1),
+           stats.nReadStallMicros / 1e6,
+           stats.nParsed, stats.nParsed * 1e6 / std::max(stats.nParseMicros, (int64_t)1), stats.nParseThreads,
+           nValidated, nValidated * 1e6 / std::max(nValidateMicros, (int64_t)1),
+           stats.nNextStallMicros / 1e6, stats.nRestarts);
+}
+
 bool LoadExternalBlockFile(FILE* fileIn)
 {
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
     int nFailed = 0;
-    {
-        LOCK(cs_main);
-        CAutoFile blkdat(fileIn, SER_DISK, CLIENT_VERSION);
-        unsigned int nPos = 0;
-        while (nPos != (unsigned int)-1 && blkdat.good() && !fRequestShutdown)
-        {
-            unsigned char pchData[65536];
-            do {
-                fseek(blkdat, nPos, SEEK_SET);
-                int nRead = fread(pchData, 1, sizeof(pchData), blkdat);
-                if (nRead <= 8)
-                {
-                    nPos = (unsigned int)-1;
-                    break;
-                }
-                void* nFind = memchr(pchData, pchMessageStart[0], nRead+1-sizeof(pchMessageStart));
-                if (nFind)
-                {
-                    if (memcmp(nFind, pchMessageStart, sizeof(pchMessageStart))==0)
-                    {
-                        nPos += ((unsigned char*)nFind - pchData) + sizeof(pchMessageStart);
-                        break;
-                    }
-                    nPos += ((unsigned char*)nFind - pchData) + 1;
-                }
-                else
-                    nPos += sizeof(pchData) - sizeof(pchMessageStart) + 1;
-            } while(!fRequestShutdown);
-            if (nPos == (unsigned int)-1)
-                break;
-            // Process each frame inside its own try, and ALWAYS advance nPos past a
-            // rejected/corrupt frame, so one bad frame can neither abort the rest of
-            // the file nor make the scanner re-walk block content as if it were magic.
-            try {
-                fseek(blkdat, nPos, SEEK_SET);
-                unsigned int nSize = 0;
-                blkdat >> nSize;
-                if (nSize == 0 || nSize > ADAPTIVE_BLOCK_CEILING)
-                {
-                    nPos += 4;          // bogus size: skip the field and resync on the next magic
-                    nFailed++;
-                    continue;
-                }
-                CBlock block;
-                blkdat >> block;
-                nPos += 4 + nSize;      // advance regardless of accept/reject
-                if (ProcessBlock(NULL, &block))
-                    nLoaded++;
-                else
-                    nFailed++;
+    int64_t nValidateMicros = 0;
+    uint64_t nTxHashHitsStart = nTxHashCacheHits.load();
+    uint64_t nBlockHashHitsStart = nBlockHashCacheHits.load();
+
+    // The importer reads and deserializes ahead on threads of its own; blocks
+    // are validated here one at a time, in file order. Every frame, good or
+    // not, moves the scan past itself, so one bad frame can neither abort the
+    // rest of the file nor make the scanner re-walk block content as magic.
+    CBlockImporter importer(fileIn, nImportThreads);
+    while (!fRequestShutdown)
+    {
+        unique_ptr<CImportedBlock> pframe = importer.Next();
+        if (!pframe)
+            break;
+        if (pframe->fBadSize)
+            nFailed++;
+        else if (!pframe->fParsed)
+        {
+            printf("%s() : frame near pos %u skipped: %s\n", __PRETTY_FUNCTION__, pframe->nPos, pframe->strError.c_str());
+            nFailed++;
+        }
+        else
+        {
+            int64_t nValidateStart = GetTimeMicros();
+            bool fAccepted;
+            {
+                LOCK(cs_main);
+                fAccepted = ProcessBlock(NULL, &pframe->block);
             }
-            catch (std::exception &e) {
-                printf("%s() : frame near pos %u skipped: %s\n", __PRETTY_FUNCTION__, nPos, e.what());
-                nPos += 4;              // resync past the bad frame
+            nValidateMicros += GetTimeMicros() - nValidateStart;
+            if (fAccepted)
+                nLoaded++;
+            else
                 nFailed++;
-            }
-            if (((nLoaded + nFailed) % 10000) == 0 && (nLoaded + nFailed) > 0)
-                printf("LoadExternalBlockFile: %d loaded, %d failed (%" PRId64"ms)\n",
-                       nLoaded, nFailed, GetTimeMillis() - nStart);
+        }
+        if (((nLoaded + nFailed) % 10000) == 0)
+        {
+            printf("LoadExternalBlockFile: %d loaded, %d failed (%" PRId64"ms)\n",
+                   nLoaded, nFailed, GetTimeMillis() - nStart);
+            PrintBlockImportStats(importer.GetStats(), nLoaded + nFailed, nValidateMicros);
         }
     }
+    importer.Stop();
+    fclose(fileIn);
+
     printf("Loaded %i blocks (%i failed) from external file in %" PRId64"ms\n",
            nLoaded, nFailed, GetTimeMillis() - nStart);
+    PrintBlockImportStats(importer.GetStats(), nLoaded + nFailed, nValidateMicros);
+    printf("LoadExternalBlockFile: hash cache avoided %" PRIu64" tx and %" PRIu64" block hash computations\n",
+           nTxHashCacheHits.load() - nTxHashHitsStart, nBlockHashCacheHits.load() - nBlockHashHitsStart);
     return nLoaded > 0;
 }
 
@@ -8136,11 +8753,39 @@ void static ProcessGetData(CNode* pfrom)
                 if (mi != mapBlockIndex.end())
                 {
                     send = true;
-                    CBlock block;
-                    block.ReadFromDisk((*mi).second);
+                    CBlockIndex* pindex = (*mi).second;
 
-                    if (inv.type == MSG_FILTERED_BLOCK)
+                    if (inv.type == MSG_BLOCK)
                     {
+                        // Serve the bytes as stored; block files are append-only, so
+                        // the read needs no cs_main.
+                        CRawBlockCache::BlockData pblock = g_rawBlockCache.Get(inv.hash);
+                        if (!pblock)
+                        {
+                            std::shared_ptr<std::vector<char> > pread(new std::vector<char>());
+                            LEAVE_CRITICAL_SECTION(cs_main);
+                            bool fRead = ReadRawBlockFromDisk(pindex, *pread);
+                            ENTER_CRITICAL_SECTION(cs_main);
+                            if (fRead)
+                            {
+                                pblock = pread;
+                                g_rawBlockCache.Put(inv.hash, pblock);
+                            }
+                        }
+                        if (pblock)
+                            pfrom->PushMessageRaw("block", &(*pblock)[0], pblock->size());
+                        else
+                        {
+                            CBlock block;
+                            block.ReadFromDisk(pindex);
+                            pfrom->PushMessage("block", block);
+                        }
+                    }
+                    else
+                    {
+                        CBlock block;
+                        block.ReadFromDisk(pindex);
+
                         LOCK(pfrom->cs_filter);
                         if (pfrom->pfilter)
                         {
@@ -8152,10 +8797,6 @@ void static ProcessGetData(CNode* pfrom)
                                     pfrom->PushMessage("tx", block.vtx[pair.first]);
                         }
                     }
-                    else
-                    {
-                        pfrom->PushMessage("block", block);
-                    }
 
                     // Trigger them to send a getblocks request for the next batch of inventory
                     if (inv.hash == pfrom->hashContinue)
@@ -9590,6 +10231,7 @@ bool ProcessMessages(CNode* pfrom)
 
         // Process message
         bool fRet = false;
+        int64_t nProcessStart = GetTimeMicros();
         try
         {
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
@@ -9629,6 +10271,9 @@ bool ProcessMessages(CNode* pfrom)
             PrintExceptionContinue(NULL, "ProcessMessages()");
         }
 
+        int64_t nProcessEnd = GetTimeMicros();
+        RecordMessageLatency(strCommand, nProcessStart - msg.nTime, nProcessEnd - nProcessStart);
+
         if (!fRet)
             printf("ProcessMessage(%s, %u bytes) FAILED\n", strCommand.c_str(), nMessageSize);
 
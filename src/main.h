@@ -17,6 +17,7 @@
 #include "shielded.h"
 #include "nullstake.h"
 
+#include <atomic>
 #include <list>
 #include <vector>
 
@@ -102,6 +103,8 @@ static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100; // Was 10k
 static const unsigned int DEFAULT_MAX_ORPHAN_BLOCKS = 2500; // Increased for faster parallel sync
 /** Default for -maxmempool, maximum mempool size in MB */
 static const unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300; // 300MB default
+/** Default for -limitancestorcount, most in-pool ancestors (itself included) a mempool tx may have */
+static const unsigned int DEFAULT_ANCESTOR_LIMIT = 100;
 static const unsigned int MAX_INV_SZ = 50000;
 static const unsigned int INV_RATE_LIMIT_WINDOW = 60;    // Time window in seconds
 static const unsigned int INV_RATE_LIMIT_ITEMS = 2000;   // Max inv items per window (generous for sync)
@@ -576,6 +579,11 @@ extern bool fUseFastIndex;
 extern bool fImporting;
 extern bool fReindex;
 extern bool fFullReplayVerify;
+extern bool fAddrIndex;
+extern int nScriptCheckThreads;
+/** GetHash() calls answered from a memoized hash instead of rehashing. */
+extern std::atomic<uint64_t> nTxHashCacheHits;
+extern std::atomic<uint64_t> nBlockHashCacheHits;
 extern unsigned int nDerivationMethodIndex;
 extern unsigned int nCoinCacheSize;
 
@@ -604,10 +612,18 @@ extern int64_t nMinTxFee;
 // Minimum disk space required - used in CheckDiskSpace()
 // static const uint64_t nMinDiskSpace = 13958643712; // 13 GB Minimum (revert for production - Innova chain is ~11.5-12.5GB)
 static const uint64_t nMinDiskSpace = 524288000; // 500 MB Minimum (temporary for regtest/testing)
+/** Maximum number of script-checking threads allowed (-par) */
+static const int MAX_SCRIPTCHECK_THREADS = 16;
+/** Maximum number of threads reading blocks for -reindexaddr (-addrindexthreads) */
+static const int ADDRINDEX_MAX_THREADS = 16;
+/** Blocks whose address index entries -reindexaddr writes as one batch */
+static const unsigned int ADDRINDEX_REBUILD_CHUNK = 1000;
 
 class CReserveKey;
 class CTxDB;
 class CTxIndex;
+class CScriptCheck;
+class CScriptCheckFailure;
 class CIncrementalMerkleTree;
 class CCurveTree;
 
@@ -620,6 +636,8 @@ void SyncWithWallets(const CTransaction& tx, const CBlock* pblock = NULL, bool f
 bool ProcessBlock(CNode* pfrom, CBlock* pblock);
 bool CheckDiskSpace(uint64_t nAdditionalBytes=0);
 FILE* OpenBlockFile(unsigned int nFile, unsigned int nBlockPos, const char* pszMode="rb");
+/** Read a block's serialized bytes from its blk*.dat file without decoding it. */
+bool ReadRawBlockFromDisk(const CBlockIndex* pindex, std::vector<char>& vchBlock);
 FILE* AppendBlockFile(unsigned int& nFileRet);
 bool LoadBlockIndex(bool fAllowNew=true);
 void PrintBlockTree();
@@ -653,7 +671,13 @@ void ResendWalletTransactions(bool fForce = false);
 
 bool Finalise();
 
-bool FindTransactionsByDestination(const CTxDestination &dest, std::vector<uint256> &vtxhash);
+class CAddrSummary;
+/** Page [nSkip, nSkip + nCount) of an address's transactions, oldest first; a
+ * negative nSkip counts from the newest.  nTotal is the full history length. */
+bool FindTransactionsByDestination(const CTxDestination &dest, std::vector<uint256> &vtxhash, int nSkip, int nCount, unsigned int &nTotal);
+bool GetAddressSummary(const CTxDestination &dest, CAddrSummary &summary);
+/** Drop the address index and build it again from the main chain (-reindexaddr) */
+bool RebuildAddressIndex(unsigned int nThreads);
 
 
 int GetInputAge(CTxIn& vin, CBlockIndex* pindex);
@@ -727,6 +751,58 @@ public:
 
 typedef std::map<uint256, std::pair<CTxIndex, CTransaction> > MapPrevTx;
 
+/** Memo of an object's hash, filled by the first GetHash() after Allow().
+ * The first thread to finish hashing stores the value and threads that race
+ * it use their own, so a reader never sees a half written hash. Copies take
+ * the memo with them.
+ */
+class CHashMemo
+{
+public:
+    CHashMemo() : nState(DISABLED) {}
+    CHashMemo(const CHashMemo& other) : nState(DISABLED) { *this = other; }
+
+    CHashMemo& operator=(const CHashMemo& other)
+    {
+        int nOther = other.nState.load(std::memory_order_acquire);
+        if (nOther == READY)
+            hash = other.hash;
+        else if (nOther == FILLING)
+            nOther = EMPTY;
+        nState.store(nOther, std::memory_order_release);
+        return *this;
+    }
+
+    /** Memoize from the next GetHash() on, dropping any value held */
+    void Allow() { nState.store(EMPTY, std::memory_order_release); }
+    /** Drop the value and stop memoizing until Allow() */
+    void Disable() { nState.store(DISABLED, std::memory_order_release); }
+    bool IsSet() const { return nState.load(std::memory_order_acquire) == READY; }
+
+    bool Get(uint256& hashOut) const
+    {
+        if (nState.load(std::memory_order_acquire) != READY)
+            return false;
+        hashOut = hash;
+        return true;
+    }
+
+    void Set(const uint256& hashIn) const
+    {
+        int nExpected = EMPTY;
+        if (nState.compare_exchange_strong(nExpected, FILLING, std::memory_order_acq_rel))
+        {
+            hash = hashIn;
+            nState.store(READY, std::memory_order_release);
+        }
+    }
+
+private:
+    enum { DISABLED, EMPTY, FILLING, READY };
+    mutable std::atomic<int> nState;
+    mutable uint256 hash;
+};
+
 //struct CMutableTransaction;
 /** The basic transaction that is broadcasted on the network and contained in
  * blocks.  A transaction can contain multiple inputs and outputs.
@@ -764,6 +840,12 @@ public:
     mutable int nDoS;
     bool DoS(int nDoSIn, bool fIn) const { nDoS += nDoSIn; return fIn; }
 
+    // memory only: GetHash() memo. Only transactions that were deserialized
+    // (or finalized with UpdateHash()) memoize, on their first GetHash(), so
+    // one still being built is always hashed afresh. Code that mutates a
+    // transaction after either point must call ClearHashCache().
+    CHashMemo hashMemo;
+
     CTransaction()
     {
         SetNull();
@@ -774,6 +856,8 @@ public:
 
     IMPLEMENT_SERIALIZE
     (
+        if (fRead)
+            const_cast<CTransaction*>(this)->hashMemo.Allow();
         READWRITE(this->nVersion);
         nVersion = this->nVersion;
         READWRITE(nTime);
@@ -856,6 +940,7 @@ public:
         nValueBalance = 0;
         nPrivacyMode = PRIVACY_MODE_FULL;
         bindingSig.bindingSig.vchSignature.clear();
+        hashMemo.Disable();
     }
 
     bool IsNull() const
@@ -865,7 +950,27 @@ public:
 
     uint256 GetHash() const
     {
-        return SerializeHash(*this);
+        uint256 hash;
+        if (hashMemo.Get(hash))
+        {
+            nTxHashCacheHits.fetch_add(1, std::memory_order_relaxed);
+            return hash;
+        }
+        hash = SerializeHash(*this);
+        hashMemo.Set(hash);
+        return hash;
+    }
+
+    /** Memoize the hash from the next GetHash() on; call once the
+     * transaction is final. */
+    void UpdateHash()
+    {
+        hashMemo.Allow();
+    }
+
+    void ClearHashCache()
+    {
+        hashMemo.Disable();
     }
 
     // Hash excluding the binding signature, used as sighash for binding sig creation/verification
@@ -1220,12 +1325,18 @@ public:
         @param[in] pindexBlock
         @param[in] fBlock	true if called from ConnectBlock
         @param[in] fMiner	true if called from CreateNewBlock
+        @param[out] pvChecks	if non-NULL, script checks are appended here instead of being run inline
+        @param[in] nTxInBlock	position of this transaction in its block (orders deferred failures)
+        @param[in] pfailure	where deferred checks record their failure
+        @param[out] pRangeProofs	if non-NULL, Bulletproof range proofs are appended here for a block-wide batch instead of being batch-verified per transaction
         @return Returns true if all checks succeed
      */
     bool ConnectInputs(CTxDB& txdb, MapPrevTx inputs,
                        std::map<uint256, CTxIndex>& mapTestPool, const CDiskTxPos& posThisTx,
                        const CBlockIndex* pindexBlock, bool fBlock, bool fMiner, unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS, bool fValidateSig = true, bool fSkipFCMP = false,
-                       bool fValidatedCoinstake = false);
+                       bool fValidatedCoinstake = false, std::vector<CScriptCheck>* pvChecks = NULL,
+                       unsigned int nTxInBlock = 0, CScriptCheckFailure* pfailure = NULL,
+                       CRangeProofBatch* pRangeProofs = NULL);
     bool CheckTransaction() const;
     bool AcceptToMemoryPool(CTxDB& txdb, bool fCheckInputs=true, bool* pfMissingInputs=NULL, bool fOnlyCheckWithoutAdding=false);
     bool GetCoinAge(CTxDB& txdb, uint64_t& nCoinAge) const;  // ppcoin: get transaction coin age
@@ -1233,6 +1344,70 @@ public:
     const CTxOut& GetOutputFor(const CTxIn& input, const MapPrevTx& inputs) const;
 };
 
+/** Earliest failing script check of a block, in (transaction, input) order.
+ *  Parallel checks record here so ConnectBlock can charge the same transaction,
+ *  with the same DoS score, that the serial loop would have stopped at.
+ */
+class CScriptCheckFailure
+{
+private:
+    mutable CCriticalSection cs;
+    bool fFailed;
+    unsigned int nTx;
+    unsigned int nIn;
+    int nDoS;
+
+public:
+    CScriptCheckFailure() : fFailed(false), nTx(0), nIn(0), nDoS(0) {}
+
+    // True if a failure strictly before (nTxIn, nInIn) has been recorded.
+    bool FailedBefore(unsigned int nTxIn, unsigned int nInIn) const;
+    void Record(unsigned int nTxIn, unsigned int nInIn, int nDoSIn);
+    bool Get(unsigned int& nTxOut, unsigned int& nInOut, int& nDoSOut) const;
+};
+
+/** Closure representing one script verification, deferred to the check queue.
+ *  The prevout's scriptPubKey is copied so the check outlives the MapPrevTx it
+ *  was built from; the spending transaction must stay alive until the queue is
+ *  waited on (ConnectBlock's vtx does).
+ */
+class CScriptCheck
+{
+private:
+    CScript scriptPubKey;
+    const CTransaction* ptxTo;
+    unsigned int nIn;
+    unsigned int nFlags;
+    int nHashType;
+    bool fPrevHashOk;
+    unsigned int nTx;
+    CScriptCheckFailure* pfailure;
+
+public:
+    CScriptCheck() : ptxTo(NULL), nIn(0), nFlags(0), nHashType(0), fPrevHashOk(false), nTx(0), pfailure(NULL) {}
+    CScriptCheck(const CTransaction& txFrom, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, int nHashTypeIn,
+                 unsigned int nTxIn, CScriptCheckFailure* pfailureIn);
+
+    bool operator()() const;
+
+    void swap(CScriptCheck& check)
+    {
+        scriptPubKey.swap(check.scriptPubKey);
+        std::swap(ptxTo, check.ptxTo);
+        std::swap(nIn, check.nIn);
+        std::swap(nFlags, check.nFlags);
+        std::swap(nHashType, check.nHashType);
+        std::swap(fPrevHashOk, check.fPrevHashOk);
+        std::swap(nTx, check.nTx);
+        std::swap(pfailure, check.pfailure);
+    }
+};
+
+/** Run script checks from the shared queue until shutdown (one per -par worker). */
+void ThreadScriptCheck(void* parg);
+/** Stop the script check workers once their queue has drained. */
+void InterruptScriptCheck();
+
 
 /** A mutable version of CTransaction. */
 // struct CMutableTransaction
@@ -1395,6 +1570,141 @@ public:
 };
 
 
+/** Position of one transaction in an address's history.  Serialized with the
+ * height big-endian, so an address's entries sort by height and one prefix
+ * scan pages through them in chain order without reading the rest.
+ */
+class CAddrIndexKey
+{
+public:
+    uint160 addrId;
+    int nHeight;
+    uint256 hashTx;
+
+    CAddrIndexKey()
+    {
+        addrId = 0;
+        nHeight = 0;
+        hashTx = 0;
+    }
+
+    CAddrIndexKey(const uint160& addrIdIn, int nHeightIn, const uint256& hashTxIn)
+    {
+        addrId = addrIdIn;
+        nHeight = nHeightIn;
+        hashTx = hashTxIn;
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return sizeof(addrId) + 4 + sizeof(hashTx);
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        unsigned char vchHeight[4] = { (unsigned char)(nHeight >> 24), (unsigned char)(nHeight >> 16),
+                                       (unsigned char)(nHeight >> 8), (unsigned char)nHeight };
+        addrId.Serialize(s, nType, nVersion);
+        s.write((char*)vchHeight, sizeof(vchHeight));
+        hashTx.Serialize(s, nType, nVersion);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        unsigned char vchHeight[4];
+        addrId.Unserialize(s, nType, nVersion);
+        s.read((char*)vchHeight, sizeof(vchHeight));
+        nHeight = (int)(((unsigned int)vchHeight[0] << 24) | ((unsigned int)vchHeight[1] << 16) |
+                        ((unsigned int)vchHeight[2] << 8) | (unsigned int)vchHeight[3]);
+        hashTx.Unserialize(s, nType, nVersion);
+    }
+};
+
+/** What one transaction paid to and spent from one address. */
+class CAddrIndexDelta
+{
+public:
+    int64_t nReceived;
+    int64_t nSent;
+    unsigned int nOutputs;
+    unsigned int nSpent;
+
+    CAddrIndexDelta()
+    {
+        nReceived = 0;
+        nSent = 0;
+        nOutputs = 0;
+        nSpent = 0;
+    }
+
+    IMPLEMENT_SERIALIZE
+    (
+        READWRITE(nReceived);
+        READWRITE(nSent);
+        READWRITE(nOutputs);
+        READWRITE(nSpent);
+    )
+
+    CAddrIndexDelta& operator+=(const CAddrIndexDelta& b)
+    {
+        nReceived += b.nReceived;
+        nSent += b.nSent;
+        nOutputs += b.nOutputs;
+        nSpent += b.nSpent;
+        return *this;
+    }
+};
+
+/** Running totals for one address, moved with every connected and
+ * disconnected block so balance queries never walk the history.
+ */
+class CAddrSummary
+{
+public:
+    unsigned int nTxCount;
+    int64_t nReceived;
+    int64_t nSent;
+    unsigned int nOutputs;
+    unsigned int nSpent;
+
+    CAddrSummary()
+    {
+        nTxCount = 0;
+        nReceived = 0;
+        nSent = 0;
+        nOutputs = 0;
+        nSpent = 0;
+    }
+
+    IMPLEMENT_SERIALIZE
+    (
+        READWRITE(nTxCount);
+        READWRITE(nReceived);
+        READWRITE(nSent);
+        READWRITE(nOutputs);
+        READWRITE(nSpent);
+    )
+
+    void Apply(const CAddrIndexDelta& delta, unsigned int nTx, bool fConnect)
+    {
+        int nSign = fConnect ? 1 : -1;
+        nTxCount += nSign * (int)nTx;
+        nReceived += nSign * delta.nReceived;
+        nSent += nSign * delta.nSent;
+        nOutputs += nSign * (int)delta.nOutputs;
+        nSpent += nSign * (int)delta.nSpent;
+    }
+
+    int64_t GetBalance() const { return nReceived - nSent; }
+    unsigned int GetUnspentCount() const { return nOutputs - nSpent; }
+    bool IsNull() const { return nTxCount == 0; }
+};
+
+typedef std::pair<CAddrIndexKey, CAddrIndexDelta> CAddrIndexEntry;
+
+
 
 /** Validate shielded spends against the FCMP root required at nBlockHeight. */
 bool CheckFCMPSpendRoots(const CTransaction& tx,
@@ -1437,6 +1747,11 @@ public:
     // memory only
     mutable std::vector<uint256> vMerkleTree;
 
+    // memory only: header hash memo, same rules as CTransaction::hashMemo.
+    // The miner and staker mutate freshly built headers, which are never
+    // memoized; UpdateTime() clears it.
+    CHashMemo hashMemo;
+
     // Denial-of-service detection:
     mutable int nDoS;
     bool DoS(int nDoSIn, bool fIn) const { nDoS += nDoSIn; return fIn; }
@@ -1448,6 +1763,8 @@ public:
 
     IMPLEMENT_SERIALIZE
     (
+        if (fRead)
+            const_cast<CBlock*>(this)->hashMemo.Allow();
         READWRITE(this->nVersion);
         nVersion = this->nVersion;
         READWRITE(hashPrevBlock);
@@ -1481,6 +1798,7 @@ public:
         vchBlockSig.clear();
         vMerkleTree.clear();
         nDoS = 0;
+        hashMemo.Disable();
     }
 
     bool IsNull() const
@@ -1495,8 +1813,28 @@ public:
 
     uint256 GetPoWHash() const
     {
-        return Tribus(BEGIN(nVersion), END(nNonce));
-        //return scrypt_blockhash(CVOIDBEGIN(nVersion));
+        uint256 hash;
+        if (hashMemo.Get(hash))
+        {
+            nBlockHashCacheHits.fetch_add(1, std::memory_order_relaxed);
+            return hash;
+        }
+        hash = Tribus(BEGIN(nVersion), END(nNonce));
+        //hash = scrypt_blockhash(CVOIDBEGIN(nVersion));
+        hashMemo.Set(hash);
+        return hash;
+    }
+
+    /** Memoize the header hash from the next GetHash() on; call once the
+     * header is final. */
+    void UpdateHash()
+    {
+        hashMemo.Allow();
+    }
+
+    void ClearHashCache()
+    {
+        hashMemo.Disable();
     }
 
     int64_t GetBlockTime() const
@@ -1691,7 +2029,9 @@ public:
     bool GetCoinAge(uint64_t& nCoinAge) const; // ppcoin: calculate total coin age spent in block
     bool SignBlock(CWallet& keystore, int64_t nFees);
     bool CheckBlockSignature() const;
-	void RebuildAddressIndex(CTxDB& txdb);
+    bool GetAddrIndexEntries(CTxDB& txdb, int nHeight, const std::set<uint256>& setSkippedTxs,
+                             std::vector<CAddrIndexEntry>& vEntries);
+    bool RebuildAddressIndex(CTxDB& txdb, int nHeight);
 
 private:
     bool SetBestChainInner(CTxDB& txdb, CBlockIndex *pindexNew, bool* pfPermanentInvalid = NULL);
@@ -2275,16 +2615,97 @@ public:
     std::string GetRejectReason() const { return strRejectReason; }
 };
 
+/** What the memory pool knows about a transaction beyond its contents:
+  * fee, size and coin-age priority, worked out once when it is accepted,
+  * and the totals over it and every in-pool transaction it spends from
+  * (ancestors, for mining) or that spends from it (descendants, for
+  * eviction), directly or not.
+  */
+class CTxMemPoolEntry
+{
+public:
+    int64_t nFee;
+    unsigned int nTxSize;
+    size_t nUsage;              // estimated memory held by the pool for this tx
+    int64_t nTime;
+    double dEntryPriority;      // sum(value * confirmations) / size at nEntryHeight
+    int nEntryHeight;
+    int64_t nInChainInputValue; // value of the inputs that were already confirmed
+
+    int64_t nAncestorFee;
+    uint64_t nAncestorSize;
+    unsigned int nAncestorCount;
+
+    int64_t nDescendantFee;
+    uint64_t nDescendantSize;
+    unsigned int nDescendantCount;
+
+    CTxMemPoolEntry();
+    CTxMemPoolEntry(const CTransaction& tx, int64_t nFeeIn, int64_t nTimeIn,
+                    double dEntryPriorityIn, int nEntryHeightIn, int64_t nInChainInputValueIn);
+
+    /** Priority at nHeight: confirmed inputs keep ageing while the tx waits */
+    double GetPriority(int nHeight) const
+    {
+        return dEntryPriority + (double)(nHeight - nEntryHeight) * nInChainInputValue / nTxSize;
+    }
+
+    /** Fee per byte of this tx together with its unconfirmed ancestors */
+    double GetAncestorFeeRate() const
+    {
+        return (double)nAncestorFee / nAncestorSize;
+    }
+
+    /** Fee per byte that evicting this tx gives up: its own, or that of the
+      * package with its descendants if they pay more (child pays for parent) */
+    double GetDescendantScore() const
+    {
+        return std::max((double)nFee / nTxSize, (double)nDescendantFee / nDescendantSize);
+    }
+};
+
+/** Key of CTxMemPool::setByAncestorFeeRate and setByDescendantScore: best
+  * fee rate first */
+struct CTxMemPoolFeeKey
+{
+    double dFeeRate;
+    uint256 hash;
+
+    CTxMemPoolFeeKey(double dFeeRateIn, const uint256& hashIn) : dFeeRate(dFeeRateIn), hash(hashIn) {}
+
+    bool operator<(const CTxMemPoolFeeKey& b) const
+    {
+        if (dFeeRate != b.dFeeRate)
+            return dFeeRate > b.dFeeRate;
+        return hash < b.hash;
+    }
+};
+
 class CTxMemPool
 {
 private:
     // CTransaction tx;
     unsigned int nTransactionsUpdated;
+    size_t nTotalUsage;
+
+    void UpdateAncestorFeeRate(std::map<uint256, CTxMemPoolEntry>::iterator it,
+                               int64_t nFeeDelta, int64_t nSizeDelta, int nCountDelta);
+    void UpdateDescendantScore(std::map<uint256, CTxMemPoolEntry>::iterator it,
+                               int64_t nFeeDelta, int64_t nSizeDelta, int nCountDelta);
+    void RemoveEntry(const uint256& hash);
 public:
     mutable CCriticalSection cs;
     std::map<uint256, CTransaction> mapTx;
     std::map<COutPoint, CInPoint> mapNextTx;
 
+    // Cached fee/size data for every tx in mapTx, the order mining picks
+    // them in, and the order eviction drops them in (from the end)
+    std::map<uint256, CTxMemPoolEntry> mapEntry;
+    std::set<CTxMemPoolFeeKey> setByAncestorFeeRate;
+    std::set<CTxMemPoolFeeKey> setByDescendantScore;
+
+    CTxMemPool() : nTransactionsUpdated(0), nTotalUsage(0) {}
+
     std::map<std::vector<uint8_t>, CKeyImageSpent> mapKeyImage;
 
     // Shielded nullifier tracking (prevents double-spend in mempool)
@@ -2293,9 +2714,20 @@ public:
     bool accept(CTxDB& txdb, CTransaction &tx,
                 bool fCheckInputs, bool* pfMissingInputs, bool fOnlyCheckWithoutAdding=false);
     bool addUnchecked(const uint256& hash, CTransaction &tx);
+    bool addUnchecked(const uint256& hash, CTransaction &tx, const CTxMemPoolEntry& entry);
     bool remove(const CTransaction &tx, bool fRecursive = false);
     bool removeConflicts(const CTransaction &tx);
 
+    /** Hashes of the in-pool transactions tx spends from, directly or not */
+    void CalculateAncestors(const CTransaction& tx, std::set<uint256>& setAncestors) const;
+    /** Hashes of the in-pool transactions spending from hash, directly or not */
+    void CalculateDescendants(const uint256& hash, std::set<uint256>& setDescendants) const;
+    /** Evict the lowest descendant score transactions, with their
+      * descendants, until the pool uses no more than nSizeLimit bytes */
+    void TrimToSize(size_t nSizeLimit, std::vector<uint256>* pvRemoved = NULL);
+    /** Lowest descendant score in the pool, in satoshis per byte */
+    double GetMinFeeRate() const;
+
     // DAG-aware mempool coordination
     std::set<uint256> setDAGSeenTxids;
     void RemoveDAGConflicts(const uint256& hashBlock);
@@ -2314,10 +2746,7 @@ public:
     size_t GetTotalMemoryUsage() const
     {
         LOCK(cs);
-        size_t usage = 0;
-        for (std::map<uint256, CTransaction>::const_iterator it = mapTx.begin(); it != mapTx.end(); ++it)
-            usage += ::GetSerializeSize(it->second, SER_NETWORK, PROTOCOL_VERSION);
-        return usage;
+        return nTotalUsage;
     }
 
     bool exists(uint256 hash) const
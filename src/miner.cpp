@@ -10,6 +10,7 @@
 #include "collateralnode.h"
 #include "dag.h"
 #include "finality.h"
+#include "tribus.h"
 
 using namespace std;
 
@@ -70,41 +71,6 @@ void SHA256Transform(void* pstate, void* pinput, const void* pinit)
         ((uint32_t*)pstate)[i] = ctx.h[i];
 }
 
-// Some explaining would be appreciated
-class COrphan
-{
-public:
-    CTransaction* ptx;
-    set<uint256> setDependsOn;
-    double dPriority;
-    double dFeePerKb;
-    int64_t nFee;
-
-    COrphan(CTransaction* ptxIn)
-    {
-        ptx = ptxIn;
-        dPriority = dFeePerKb = 0;
-        nFee = 0;
-    }
-
-    COrphan(double dPriority_, double dFeePerKb_, int64_t nFee_, CTransaction* ptxIn)
-    {
-        dPriority = dPriority_;
-        dFeePerKb = dFeePerKb_;
-        nFee = nFee_;
-        ptx = ptxIn;
-     }
-
-    void print() const
-    {
-        printf("COrphan(hash=%s, dPriority=%.1f, dFeePerKb=%.1f)\n",
-               ptx->GetHash().ToString().substr(0,10).c_str(), dPriority, dFeePerKb);
-        BOOST_FOREACH(uint256 hash, setDependsOn)
-            printf("   setDependsOn %s\n", hash.ToString().substr(0,10).c_str());
-    }
-};
-
-
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 int64_t nLastCoinStakeSearchInterval = 0;
@@ -487,10 +453,6 @@ CBlock* CreateNewBlock(CWallet* pwallet, bool fProofOfStake, int64_t* pFees)
             }
         }
 
-        // Priority order to process transactions
-        list<COrphan> vOrphan; // list memory doesn't move
-        map<uint256, vector<COrphan*> > mapDependers;
-
         // Collect txids and spent inputs from DAG sibling
         // blocks to avoid duplicates and fee accounting drift. ConnectBlock
         // skips transactions whose inputs were already spent by earlier DAG
@@ -537,214 +499,95 @@ CBlock* CreateNewBlock(CWallet* pwallet, bool fProofOfStake, int64_t* pFees)
             }
         }
 
-        // This vector will be sorted into a priority queue:
-        vector<TxPriority> vecPriority;
-        vecPriority.reserve(mempool.mapTx.size());
-        for (map<uint256, CTransaction>::iterator mi = mempool.mapTx.begin(); mi != mempool.mapTx.end(); ++mi)
+        // Collect transactions into block
+        map<uint256, CTxIndex> mapTestPool;
+        uint64_t nBlockSize = 1000;
+        uint64_t nBlockTx = 0;
+        int nBlockSigOps = 100;
+
+        // Transactions come straight from the pool's cached fees, sizes and
+        // priorities and its ancestor fee rate order, so nothing is read back
+        // from disk or sorted here except for what actually goes in.
+        std::set<uint256> setInBlock;
+        std::set<uint256> setFailed;
+
+        // Check tx against the block built so far and append it
+        auto AddToBlock = [&](CTransaction& tx, double dPriority, double dFeePerKb) -> bool
         {
-            CTransaction& tx = (*mi).second;
             if (tx.IsCoinBase() || tx.IsCoinStake() || !tx.IsFinal())
-                continue;
+                return false;
 
             // IDAG: Skip transactions already in DAG sibling blocks
             if (!setDAGSiblingTxids.empty() && setDAGSiblingTxids.count(tx.GetHash()))
-                continue;
+                return false;
             if (TransactionSpendsAnyOutpoint(tx, setDAGSiblingSpentOutpoints))
-                continue;
+                return false;
 
             // Transparent finality votes use existing UTXOs as stake proofs.
             // Consensus rejects blocks that both commit such a vote and spend
             // the proof UTXO, so reserve those outpoints while building the
             // candidate block.
             if (TransactionSpendsAnyOutpoint(tx, setFinalityStakeProofOutpoints))
-                continue;
+                return false;
 
-            COrphan* porphan = NULL;
-            double dPriority = 0;
-            int64_t nTotalIn = 0;
-            bool fMissingInputs = false;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
-            {
-                if (tx.nVersion == ANON_TXN_VERSION
-                    && txin.IsAnonInput()) // anon inputs are verified later in CheckAnonInputs()
-                    continue;
-                // Read prev transaction
-                CTransaction txPrev;
-                CTxIndex txindex;
-                if (!txPrev.ReadFromDisk(txdb, txin.prevout, txindex))
-                {
-                    // This should never happen; all transactions in the memory
-                    // pool should connect to either transactions in the chain
-                    // or other transactions in the memory pool.
-                    if (!mempool.mapTx.count(txin.prevout.hash))
-                    {
-                        printf("ERROR: mempool transaction missing input\n");
-                        fMissingInputs = true;
-                        if (porphan)
-                            vOrphan.pop_back();
-                        break;
-                    }
+            // Size limits
+            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+            if (nBlockSize + nTxSize >= nBlockMaxSize)
+                return false;
 
-                    // Has to wait for dependencies
-                    if (!porphan)
-                    {
-                        // Use list for automatic deletion
-                        vOrphan.push_back(COrphan(&tx));
-                        porphan = &vOrphan.back();
-                    }
-                    mapDependers[txin.prevout.hash].push_back(porphan);
-                    porphan->setDependsOn.insert(txin.prevout.hash);
-                    nTotalIn += mempool.mapTx[txin.prevout.hash].vout[txin.prevout.n].nValue;
-                    continue;
-                }
-                int64_t nValueIn = txPrev.vout[txin.prevout.n].nValue;
-                nTotalIn += nValueIn;
+            // Legacy limits on sigOps:
+            unsigned int nTxSigOps = tx.GetLegacySigOpCount();
+            if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
+                return false;
 
-                int nConf = txindex.GetDepthInMainChain();
-                dPriority += (double)nValueIn * nConf;
-            };
+            // Timestamp limit
+            if (tx.nTime > GetAdjustedTime() || (fProofOfStake && tx.nTime > pblock->vtx[0].nTime))
+                return false;
 
+            // Connecting shouldn't fail due to dependency on other memory pool transactions
+            // because ancestors are always added first
+            map<uint256, CTxIndex> mapTestPoolTmp(mapTestPool);
+            MapPrevTx mapInputs;
+            bool fInvalid;
+            if (!tx.FetchInputs(txdb, mapTestPoolTmp, false, true, mapInputs, fInvalid))
+                return false;
+
+            // The fee that goes into the coinbase is worked out from the
+            // inputs again rather than trusted from the pool entry
+            int64_t nFee = tx.GetValueIn(mapInputs) - tx.GetValueOut();
             if (tx.nVersion == ANON_TXN_VERSION)
             {
                 int64_t nSumAnon;
-                bool fInvalid;
                 if (!tx.CheckAnonInputs(txdb, nSumAnon, fInvalid, false))
                 {
                     if (fInvalid)
                         printf("CreateNewBlock() : CheckAnonInputs found invalid tx %s\n", tx.GetHash().ToString().substr(0,10).c_str());
-                    fMissingInputs = true;
-                    continue;
+                    return false;
                 };
-
-                nTotalIn += nSumAnon;
+                nFee += nSumAnon;
             };
-
-            if (fMissingInputs)
-                continue;
-
-            // Priority is sum(valuein * age) / txsize
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            dPriority /= nTxSize;
-
-            // This is a more accurate fee-per-kilobyte than is used by the client code, because the
-            // client code rounds up the size to the nearest 1K. That's good, because it gives an
-            // incentive to create smaller transactions.
-            int64_t nFee = nTotalIn-tx.GetValueOut();
             if (tx.IsShielded() && tx.nValueBalance != 0)
             {
                 if ((tx.nValueBalance > 0 && nFee > std::numeric_limits<int64_t>::max() - tx.nValueBalance) ||
                     (tx.nValueBalance < 0 && nFee < std::numeric_limits<int64_t>::min() - tx.nValueBalance))
                 {
                     printf("CreateNewBlock: fee overflow with shielded value balance, skipping tx\n");
-                    continue;
+                    return false;
                 }
                 nFee += tx.nValueBalance;
             }
-            double dFeePerKb =  double(nFee) / (double(nTxSize)/1000.0);
-
-            if (porphan)
-            {
-                porphan->dPriority = dPriority;
-                porphan->dFeePerKb = dFeePerKb;
-            }
-            else
-                vecPriority.push_back(TxPriority(dPriority, dFeePerKb, nFee, &(*mi).second));
-        }
-
-        // Collect transactions into block
-        map<uint256, CTxIndex> mapTestPool;
-        uint64_t nBlockSize = 1000;
-        uint64_t nBlockTx = 0;
-        int nBlockSigOps = 100;
-        bool fSortedByFee = (nBlockPrioritySize <= 0);
-
-        TxPriorityCompare comparer(fSortedByFee);
-        std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-
-        while (!vecPriority.empty())
-        {
-            // Take highest priority transaction off the priority queue:
-            double dPriority = vecPriority.front().get<0>();
-            double dFeePerKb = vecPriority.front().get<1>();
-            int64_t nFee = vecPriority.front().get<2>();
-            CTransaction& tx = *(vecPriority.front().get<3>());
-
-            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            vecPriority.pop_back();
-
-            // Size limits
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            if (nBlockSize + nTxSize >= nBlockMaxSize)
-                continue;
-
-            // Legacy limits on sigOps:
-            unsigned int nTxSigOps = tx.GetLegacySigOpCount();
-            if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
-                continue;
-
-            // Timestamp limit
-            if (tx.nTime > GetAdjustedTime() || (fProofOfStake && tx.nTime > pblock->vtx[0].nTime))
-                continue;
 
             // Transaction fee
             int64_t nMinFee = tx.GetMinFee(nBlockSize, GMF_BLOCK); // will get GMF_ANON if tx.nVersion == ANON_TXN_VERSION
-
-            // Skip free transactions if we're past the minimum block size:
-            if (fSortedByFee && (dFeePerKb < nMinTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
-                continue;
-
-            // Prioritize by fee once past the priority size or we run out of high-priority
-            // transactions:
-            if (!fSortedByFee &&
-                ((nBlockSize + nTxSize >= nBlockPrioritySize) || (dPriority < COIN * 144 / 250)))
-            {
-                fSortedByFee = true;
-                comparer = TxPriorityCompare(fSortedByFee);
-                std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            }
-
-            // Connecting shouldn't fail due to dependency on other memory pool transactions
-            // because we're already processing them in order of dependency
-            map<uint256, CTxIndex> mapTestPoolTmp(mapTestPool);
-            MapPrevTx mapInputs;
-            bool fInvalid;
-            if (!tx.FetchInputs(txdb, mapTestPoolTmp, false, true, mapInputs, fInvalid))
-                continue;
-
-            // -- Avoid calling CheckAnonInputs twice, use nFee from vecPriority
-            //int64_t nTxFees = tx.GetValueIn(mapInputs)-tx.GetValueOut();
-            if (nFee == 0) // tx came from COrphan
-            {
-                int64_t nTxFees = tx.GetValueIn(mapInputs)-tx.GetValueOut();
-
-                if (tx.nVersion == ANON_TXN_VERSION)
-                {
-                    int64_t nSumAnon;
-                    bool fInvalid;
-                    if (!tx.CheckAnonInputs(txdb, nSumAnon, fInvalid, false))
-                    {
-                        if (fInvalid)
-                            printf("CreateNewBlock() : CheckAnonInputs found invalid tx %s\n", tx.GetHash().ToString().substr(0,10).c_str());
-                        continue;
-                    };
-
-                    nTxFees += nSumAnon;
-                };
-                if (tx.IsShielded() && tx.nValueBalance != 0)
-                    nTxFees += tx.nValueBalance;
-                nFee = nTxFees;
-            };
-            // TODO: must this be done twice!?
-            // Need to look at COrphan
             if (nFee < nMinFee)
-                continue;
+                return false;
 
             nTxSigOps += tx.GetP2SHSigOpCount(mapInputs);
             if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
-                continue;
+                return false;
 
             if (!tx.ConnectInputs(txdb, mapInputs, mapTestPoolTmp, CDiskTxPos(1,1,1), pindexPrev, false, true, MANDATORY_SCRIPT_VERIFY_FLAGS))
-                continue;
+                return false;
             mapTestPoolTmp[tx.GetHash()] = CTxIndex(CDiskTxPos(1,1,1), tx.vout.size());
             swap(mapTestPool, mapTestPoolTmp);
 
@@ -753,7 +596,6 @@ CBlock* CreateNewBlock(CWallet* pwallet, bool fProofOfStake, int64_t* pFees)
             nBlockSize += nTxSize;
             ++nBlockTx;
             nBlockSigOps += nTxSigOps;
-            //nFees += nTxFees;
             nFees += nFee;
 
             if (fDebug && GetBoolArg("-printpriority"))
@@ -761,24 +603,106 @@ CBlock* CreateNewBlock(CWallet* pwallet, bool fProofOfStake, int64_t* pFees)
                 printf("priority %.1f feeperkb %.1f txid %s\n",
                        dPriority, dFeePerKb, tx.GetHash().ToString().c_str());
             }
+            return true;
+        };
 
-            // Add transactions that depend on this one to the priority queue
-            uint256 hash = tx.GetHash();
-            if (mapDependers.count(hash))
+        // High-priority transactions first, included regardless of the fees
+        // they pay. Only those with every input confirmed qualify; their
+        // priority is the one cached at acceptance, aged to this height.
+        if (nBlockPrioritySize > 0)
+        {
+            vector<TxPriority> vecPriority;
+            for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.mapEntry.begin(); mi != mempool.mapEntry.end(); ++mi)
             {
-                BOOST_FOREACH(COrphan* porphan, mapDependers[hash])
+                const CTxMemPoolEntry& entry = mi->second;
+                if (entry.nAncestorCount > 1)
+                    continue;
+                double dPriority = entry.GetPriority(nHeight);
+                if (dPriority < COIN * 144 / 250)
+                    continue;
+                double dFeePerKb = double(entry.nFee) / (double(entry.nTxSize) / 1000.0);
+                vecPriority.push_back(TxPriority(dPriority, dFeePerKb, entry.nFee, &mempool.mapTx[mi->first]));
+            }
+
+            TxPriorityCompare comparer(false);
+            std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+            while (!vecPriority.empty())
+            {
+                double dPriority = vecPriority.front().get<0>();
+                double dFeePerKb = vecPriority.front().get<1>();
+                CTransaction& tx = *(vecPriority.front().get<3>());
+                std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                vecPriority.pop_back();
+
+                if (nBlockSize + ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION) >= nBlockPrioritySize)
+                    break;
+
+                uint256 hash = tx.GetHash();
+                if (AddToBlock(tx, dPriority, dFeePerKb))
+                    setInBlock.insert(hash);
+                else
+                    setFailed.insert(hash);
+            }
+        }
+
+        // Then by ancestor fee rate: each pick brings along whichever of its
+        // unconfirmed ancestors are not in the block yet, parents first, so a
+        // child paying for its parent gets both in.
+        int nConsecutiveFailed = 0;
+        for (set<CTxMemPoolFeeKey>::const_iterator it = mempool.setByAncestorFeeRate.begin();
+             it != mempool.setByAncestorFeeRate.end(); ++it)
+        {
+            if (setInBlock.count(it->hash) || setFailed.count(it->hash))
+                continue;
+
+            // The rest pay less than the minimum; only free space-filling is left
+            double dFeePerKb = it->dFeeRate * 1000.0;
+            if (dFeePerKb < nMinTxFee && nBlockSize >= nBlockMinSize)
+                break;
+
+            CTransaction& txPick = mempool.mapTx[it->hash];
+            set<uint256> setAncestors;
+            mempool.CalculateAncestors(txPick, setAncestors);
+
+            vector<pair<unsigned int, uint256> > vPackage;
+            bool fFailed = false;
+            BOOST_FOREACH(const uint256& hashAncestor, setAncestors)
+            {
+                if (setInBlock.count(hashAncestor))
+                    continue;
+                if (setFailed.count(hashAncestor))
                 {
-                    if (!porphan->setDependsOn.empty())
-                    {
-                        porphan->setDependsOn.erase(hash);
-                        if (porphan->setDependsOn.empty())
-                        {
-                            vecPriority.push_back(TxPriority(porphan->dPriority, porphan->dFeePerKb, porphan->nFee, porphan->ptx));
-                            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                        }
-                    }
+                    fFailed = true;
+                    break;
+                }
+                vPackage.push_back(make_pair(mempool.mapEntry[hashAncestor].nAncestorCount, hashAncestor));
+            }
+            // Fewer ancestors sorts parents before their children
+            vPackage.push_back(make_pair(mempool.mapEntry[it->hash].nAncestorCount, it->hash));
+            sort(vPackage.begin(), vPackage.end());
+
+            for (unsigned int i = 0; i < vPackage.size() && !fFailed; i++)
+            {
+                const uint256& hash = vPackage[i].second;
+                const CTxMemPoolEntry& entry = mempool.mapEntry[hash];
+                if (AddToBlock(mempool.mapTx[hash], entry.GetPriority(nHeight), dFeePerKb))
+                    setInBlock.insert(hash);
+                else
+                {
+                    setFailed.insert(hash);
+                    fFailed = true;
                 }
             }
+
+            if (!fFailed)
+                nConsecutiveFailed = 0;
+            else
+            {
+                setFailed.insert(it->hash);
+                // Nearly full and nothing has fit for a while
+                if (++nConsecutiveFailed > 1000 && nBlockSize + 4000 > nBlockMaxSize)
+                    break;
+            }
         }
 
         int64_t nFinalityRewardTotal = 0;
@@ -1286,7 +1210,9 @@ static void CPUMinerConsumeAcceptedBlock()
 
 void CPUMiner(CWallet* pwallet)
 {
-    printf("CPUMiner started with %d thread(s)\n", nCPUMinerThreads);
+    printf("CPUMiner started with %d thread(s), tribus kernel %s\n", nCPUMinerThreads, TribusKernelName());
+    if (!TribusSelfTest())
+        printf("CPUMiner: a tribus kernel disagreed with the reference hash and was disabled\n");
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("innova-cpuminer");
 
@@ -1382,36 +1308,48 @@ void CPUMiner(CWallet* pwallet)
 
         int64_t nStart = GetTime();
         uint64_t nHashesDone = 0;
+        uint64_t nNextReport = 500000;
+        uint64_t nNextStaleCheck = 100000;
         bool fBlockFound = false;
+        CTribusMidstate midstate((const unsigned char*)BEGIN(pblock->nVersion));
 
         while (!fShutdown)
         {
-            if ((nHashesDone % 4096) == 0 && !CPUMinerShouldRun())
+            if (!CPUMinerShouldRun())
                 break;
 
-            uint256 hash = pblock->GetPoWHash();
-            if (hash <= hashTarget)
+            // Stop each scan at the nonce wrap, where the timestamp moves on
+            uint32_t nCount = (uint32_t)std::min((uint64_t)4096, (uint64_t)0x100000000ULL - pblock->nNonce);
+            uint32_t nNonceFound, nScanned;
+            uint256 hash;
+            bool fFound = midstate.Scan(pblock->nNonce, nCount, hashTarget, nNonceFound, hash, nScanned);
+            nHashesDone += nScanned;
+            if (fFound)
             {
+                pblock->nNonce = nNonceFound;
                 fBlockFound = true;
                 break;
             }
 
-            nHashesDone++;
-            ++pblock->nNonce;
-
+            pblock->nNonce += nScanned;
             if (pblock->nNonce == 0)
+            {
                 ++pblock->nTime;
+                midstate = CTribusMidstate((const unsigned char*)BEGIN(pblock->nVersion));
+            }
 
-            if ((nHashesDone % 500000) == 0)
+            if (nHashesDone >= nNextReport)
             {
+                nNextReport += 500000;
                 int64_t nElapsed = GetTime() - nStart;
                 if (nElapsed > 0)
                     printf("CPUMiner: %.0f H/s (height %d, %llu hashes)\n",
                            (double)nHashesDone / nElapsed, nHeight, (unsigned long long)nHashesDone);
             }
 
-            if ((nHashesDone % 100000) == 0)
+            if (nHashesDone >= nNextStaleCheck)
             {
+                nNextStaleCheck += 100000;
                 bool fStale = false;
                 {
                     LOCK(cs_main);
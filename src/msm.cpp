@@ -0,0 +1,551 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "msm.h"
+
+#include <openssl/obj_mac.h>
+
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string.h>
+
+using namespace std;
+
+unsigned int nMSMThreads = 1;
+
+namespace
+{
+
+// Signed digits of c bits: W = 256/c + 1 windows cover 257 bits, which is
+// enough for the final carry out of a 256 bit scalar.
+int WindowCount(int c)
+{
+    return 256 / c + 1;
+}
+
+// A scalar reduced mod the group order, as little-endian 64 bit limbs
+struct CMSMScalar
+{
+    uint64_t n[4];
+};
+
+bool ReduceScalar(const BIGNUM* s, const BIGNUM* order, BIGNUM* tmp, BN_CTX* ctx, CMSMScalar& out)
+{
+    unsigned char buf[32];
+    if (BN_nnmod(tmp, s, order, ctx) != 1)
+        return false;
+    int nBytes = BN_num_bytes(tmp);
+    if (nBytes > (int)sizeof(buf))
+        return false;
+    memset(buf, 0, sizeof(buf));
+    if (nBytes > 0 && BN_bn2bin(tmp, buf + sizeof(buf) - nBytes) != nBytes)
+        return false;
+    for (int i = 0; i < 4; i++)
+    {
+        uint64_t v = 0;
+        for (int j = 0; j < 8; j++)
+            v = (v << 8) | buf[(3 - i) * 8 + j];
+        out.n[i] = v;
+    }
+    return true;
+}
+
+bool IsZero(const CMSMScalar& s)
+{
+    return (s.n[0] | s.n[1] | s.n[2] | s.n[3]) == 0;
+}
+
+unsigned int ScalarBits(const CMSMScalar& s, int nPos, int c)
+{
+    if (nPos >= 256)
+        return 0;
+    int nLimb = nPos >> 6;
+    int nShift = nPos & 63;
+    uint64_t v = s.n[nLimb] >> nShift;
+    if (nShift + c > 64 && nLimb < 3)
+        v |= s.n[nLimb + 1] << (64 - nShift);
+    return (unsigned int)(v & ((1ULL << c) - 1));
+}
+
+// Digits in [-2^(c-1), 2^(c-1)], least significant window first
+void SignedDigits(const CMSMScalar& s, int c, int nWindows, int* pDigits)
+{
+    const int nHalf = 1 << (c - 1);
+    int nCarry = 0;
+    for (int w = 0; w < nWindows; w++)
+    {
+        int d = (int)ScalarBits(s, w * c, c) + nCarry;
+        nCarry = d > nHalf ? 1 : 0;
+        pDigits[w] = nCarry ? d - (1 << c) : d;
+    }
+}
+
+// Normalize points to affine form with one shared inversion, in chunks so
+// the temporary products stay small.
+bool MakeAffine(const EC_GROUP* group, vector<EC_POINT*>& vPoints, BN_CTX* ctx)
+{
+    const size_t nChunk = 4096;
+    for (size_t i = 0; i < vPoints.size(); i += nChunk)
+    {
+        size_t n = min(nChunk, vPoints.size() - i);
+        if (EC_POINTs_make_affine(group, n, &vPoints[i], ctx) != 1)
+            return false;
+    }
+    return true;
+}
+
+// One bucket pass: the points of terms [nBegin, nEnd) go into buckets by
+// their digit for window w (negated for negative digits), and the buckets
+// are folded into sum = sum_d d * bucket[d] with the running-sum trick.
+struct CBucketPass
+{
+    const EC_GROUP* group;
+    const vector<const EC_POINT*>* pvPoints;
+    const vector<int>* pvDigits;
+    int nWindows;
+    int nWindowBits;
+
+    bool Run(int w, size_t nBegin, size_t nEnd, EC_POINT* sum, BN_CTX* ctx) const
+    {
+        const int nBuckets = 1 << (nWindowBits - 1);
+        vector<EC_POINT*> vBucket(nBuckets, (EC_POINT*)NULL);
+        vector<char> vUsed(nBuckets, 0);
+        EC_POINT* neg = EC_POINT_new(group);
+        EC_POINT* running = EC_POINT_new(group);
+        bool fOk = neg && running && EC_POINT_set_to_infinity(group, sum) == 1;
+        for (int b = 0; b < nBuckets && fOk; b++)
+            fOk = (vBucket[b] = EC_POINT_new(group)) != NULL;
+
+        for (size_t i = nBegin; i < nEnd && fOk; i++)
+        {
+            int d = (*pvDigits)[i * nWindows + w];
+            if (d == 0)
+                continue;
+            const EC_POINT* point = (*pvPoints)[i];
+            if (d < 0)
+            {
+                fOk = EC_POINT_copy(neg, point) == 1 && EC_POINT_invert(group, neg, ctx) == 1;
+                point = neg;
+                d = -d;
+            }
+            if (!vUsed[d - 1])
+            {
+                fOk = fOk && EC_POINT_copy(vBucket[d - 1], point) == 1;
+                vUsed[d - 1] = 1;
+            }
+            else
+                fOk = fOk && EC_POINT_add(group, vBucket[d - 1], vBucket[d - 1], point, ctx) == 1;
+        }
+
+        // Affine buckets make each running-sum step a mixed addition
+        vector<EC_POINT*> vFilled;
+        for (int b = 0; b < nBuckets; b++)
+            if (vUsed[b])
+                vFilled.push_back(vBucket[b]);
+        fOk = fOk && MakeAffine(group, vFilled, ctx);
+
+        bool fRunning = false;
+        for (int b = nBuckets - 1; b >= 0 && fOk; b--)
+        {
+            if (vUsed[b])
+            {
+                fOk = fRunning ? EC_POINT_add(group, running, running, vBucket[b], ctx) == 1
+                               : EC_POINT_copy(running, vBucket[b]) == 1;
+                fRunning = true;
+            }
+            if (fRunning && fOk)
+                fOk = EC_POINT_add(group, sum, sum, running, ctx) == 1;
+        }
+
+        for (int b = 0; b < nBuckets; b++)
+            if (vBucket[b])
+                EC_POINT_free(vBucket[b]);
+        if (neg)
+            EC_POINT_free(neg);
+        if (running)
+            EC_POINT_free(running);
+        return fOk;
+    }
+};
+
+struct CBucketTask
+{
+    int w;
+    size_t nBegin;
+    size_t nEnd;
+};
+
+// Run the tasks over up to nThreads threads; vSums[k] receives task k's sum
+bool RunBucketTasks(const CBucketPass& pass, const vector<CBucketTask>& vTasks, unsigned int nThreads,
+                    vector<EC_POINT*>& vSums, BN_CTX* ctx)
+{
+    nThreads = max(1U, min(nThreads, (unsigned int)vTasks.size()));
+    vector<char> vOk(nThreads, 1);
+    auto worker = [&](unsigned int t, BN_CTX* ctxThread)
+    {
+        for (size_t k = t; k < vTasks.size() && vOk[t]; k += nThreads)
+            vOk[t] = pass.Run(vTasks[k].w, vTasks[k].nBegin, vTasks[k].nEnd, vSums[k], ctxThread);
+    };
+
+    vector<BN_CTX*> vCtx(nThreads, (BN_CTX*)NULL);
+    boost::thread_group threads;
+    for (unsigned int t = 1; t < nThreads; t++)
+    {
+        vCtx[t] = BN_CTX_new();
+        if (!vCtx[t])
+        {
+            vOk[t] = 0;
+            continue;
+        }
+        threads.create_thread(std::bind(worker, t, vCtx[t]));
+    }
+    worker(0, ctx);
+    threads.join_all();
+    for (unsigned int t = 1; t < nThreads; t++)
+        if (vCtx[t])
+            BN_CTX_free(vCtx[t]);
+    return count(vOk.begin(), vOk.end(), 0) == 0;
+}
+
+void FreePoints(vector<EC_POINT*>& v)
+{
+    for (size_t i = 0; i < v.size(); i++)
+        if (v[i])
+            EC_POINT_free(v[i]);
+    v.clear();
+}
+
+bool NewPoints(const EC_GROUP* group, size_t n, vector<EC_POINT*>& v)
+{
+    v.assign(n, (EC_POINT*)NULL);
+    for (size_t i = 0; i < n; i++)
+        if (!(v[i] = EC_POINT_new(group)))
+            return false;
+    return true;
+}
+
+// Window width for n variable points: W windows of n bucket additions, a
+// fold over 2^(c-1) buckets (two additions each) and c doublings
+int VariableWindowBits(size_t n)
+{
+    int nBest = 2;
+    double dBest = 0;
+    for (int c = 2; c <= 16; c++)
+    {
+        double dCost = (double)WindowCount(c) * ((double)n + (double)(1 << c) + c);
+        if (c == 2 || dCost < dBest)
+        {
+            nBest = c;
+            dBest = dCost;
+        }
+    }
+    return nBest;
+}
+
+}
+
+bool MultiScalarMul(const EC_GROUP* group, BN_CTX* ctx,
+                    const vector<EC_POINT*>& points,
+                    const vector<BIGNUM*>& scalars,
+                    EC_POINT* result, unsigned int nThreads)
+{
+    if (points.size() != scalars.size())
+        return false;
+    if (EC_POINT_set_to_infinity(group, result) != 1)
+        return false;
+
+    // Below this the batch inversions cost more than OpenSSL's interleaved
+    // wNAF multiplication saves
+    if (points.size() < MSM_BUCKET_MIN_TERMS)
+    {
+        if (points.empty())
+            return true;
+        vector<const EC_POINT*> vConstPoint(points.begin(), points.end());
+        vector<const BIGNUM*> vConstScalar(scalars.begin(), scalars.end());
+        return EC_POINTs_mul(group, result, NULL, points.size(), &vConstPoint[0], &vConstScalar[0], ctx) == 1;
+    }
+
+    const BIGNUM* order = EC_GROUP_get0_order(group);
+    BIGNUM* tmp = BN_new();
+    if (!order || !tmp)
+    {
+        if (tmp)
+            BN_free(tmp);
+        return false;
+    }
+
+    // Terms with a zero scalar or the identity point add nothing
+    vector<CMSMScalar> vScalar;
+    vector<EC_POINT*> vPoint;
+    vScalar.reserve(points.size());
+    vPoint.reserve(points.size());
+    bool fOk = true;
+    for (size_t i = 0; i < points.size() && fOk; i++)
+    {
+        CMSMScalar s;
+        fOk = ReduceScalar(scalars[i], order, tmp, ctx, s);
+        if (!fOk || IsZero(s) || EC_POINT_is_at_infinity(group, points[i]))
+            continue;
+        EC_POINT* p = EC_POINT_dup(points[i], group);
+        fOk = p != NULL;
+        if (fOk)
+        {
+            vPoint.push_back(p);
+            vScalar.push_back(s);
+        }
+    }
+    BN_free(tmp);
+    const size_t n = vPoint.size();
+    if (!fOk || n == 0 || !MakeAffine(group, vPoint, ctx))
+    {
+        FreePoints(vPoint);
+        return fOk;
+    }
+
+    const int c = VariableWindowBits(n);
+    const int nWindows = WindowCount(c);
+    vector<int> vDigits(n * nWindows);
+    for (size_t i = 0; i < n; i++)
+        SignedDigits(vScalar[i], c, nWindows, &vDigits[i * nWindows]);
+
+    vector<const EC_POINT*> vConst(vPoint.begin(), vPoint.end());
+    CBucketPass pass;
+    pass.group = group;
+    pass.pvPoints = &vConst;
+    pass.pvDigits = &vDigits;
+    pass.nWindows = nWindows;
+    pass.nWindowBits = c;
+
+    vector<CBucketTask> vTasks(nWindows);
+    for (int w = 0; w < nWindows; w++)
+    {
+        vTasks[w].w = w;
+        vTasks[w].nBegin = 0;
+        vTasks[w].nEnd = n;
+    }
+    vector<EC_POINT*> vSums;
+    fOk = NewPoints(group, nWindows, vSums) &&
+          RunBucketTasks(pass, vTasks, n >= MSM_THREAD_MIN_TERMS ? nThreads : 1, vSums, ctx);
+
+    // result = sum_w 2^(c*w) * windowSum[w], most significant window first
+    for (int w = nWindows - 1; w >= 0 && fOk; w--)
+    {
+        if (w != nWindows - 1)
+            for (int b = 0; b < c && fOk; b++)
+                fOk = EC_POINT_dbl(group, result, result, ctx) == 1;
+        fOk = fOk && EC_POINT_add(group, result, result, vSums[w], ctx) == 1;
+    }
+
+    FreePoints(vSums);
+    FreePoints(vPoint);
+    return fOk;
+}
+
+CMSMFixedBase::CMSMFixedBase()
+{
+    nBases = 0;
+    nWindowBits = 0;
+    nWindows = 1;
+}
+
+CMSMFixedBase::~CMSMFixedBase()
+{
+    FreePoints(vTable);
+}
+
+bool CMSMFixedBase::Init(const EC_GROUP* group, const vector<EC_POINT*>& vBase, BN_CTX* ctx)
+{
+    FreePoints(vTable);
+    nBases = vBase.size();
+
+    // A window width c makes n*W table points to add and 2^c bucket fold
+    // additions; take the cheapest that fits the size cap. With none, or
+    // none cheaper than the variable method, keep just the bases (one
+    // "window") and let Mul run the variable method over them.
+    nWindowBits = 0;
+    nWindows = 1;
+    double dBest = 0;
+    for (int c = 2; c <= 20; c++)
+    {
+        size_t nPoints = nBases * WindowCount(c);
+        double dCost = (double)nPoints + (double)(1 << c);
+        if (nPoints <= MSM_FIXED_BASE_MAX_POINTS && (nWindowBits == 0 || dCost < dBest))
+        {
+            nWindowBits = c;
+            dBest = dCost;
+        }
+    }
+    const int cVariable = VariableWindowBits(nBases);
+    if (nWindowBits && dBest >= (double)WindowCount(cVariable) * ((double)nBases + (double)(1 << cVariable) + cVariable))
+        nWindowBits = 0;
+    if (nWindowBits)
+        nWindows = WindowCount(nWindowBits);
+
+    if (!NewPoints(group, nBases * nWindows, vTable))
+    {
+        FreePoints(vTable);
+        return false;
+    }
+    for (size_t i = 0; i < nBases; i++)
+    {
+        if (EC_POINT_copy(vTable[i * nWindows], vBase[i]) != 1)
+        {
+            FreePoints(vTable);
+            return false;
+        }
+        for (int j = 1; j < nWindows; j++)
+        {
+            EC_POINT* p = vTable[i * nWindows + j];
+            bool fOk = EC_POINT_copy(p, vTable[i * nWindows + j - 1]) == 1;
+            for (int b = 0; b < nWindowBits && fOk; b++)
+                fOk = EC_POINT_dbl(group, p, p, ctx) == 1;
+            if (!fOk)
+            {
+                FreePoints(vTable);
+                return false;
+            }
+        }
+    }
+
+    // The identity cannot be made affine; such bases are skipped in Mul
+    vector<EC_POINT*> vFinite;
+    for (size_t i = 0; i < vTable.size(); i++)
+        if (!EC_POINT_is_at_infinity(group, vTable[i]))
+            vFinite.push_back(vTable[i]);
+    if (!MakeAffine(group, vFinite, ctx))
+    {
+        FreePoints(vTable);
+        return false;
+    }
+    return true;
+}
+
+bool CMSMFixedBase::Init(const EC_GROUP* group, const vector<vector<unsigned char> >& vBaseBytes, BN_CTX* ctx)
+{
+    vector<EC_POINT*> vBase;
+    bool fOk = NewPoints(group, vBaseBytes.size(), vBase);
+    for (size_t i = 0; i < vBaseBytes.size() && fOk; i++)
+        fOk = EC_POINT_oct2point(group, vBase[i], vBaseBytes[i].data(), vBaseBytes[i].size(), ctx) == 1 &&
+              EC_POINT_is_on_curve(group, vBase[i], ctx) == 1;
+    fOk = fOk && Init(group, vBase, ctx);
+    FreePoints(vBase);
+    return fOk;
+}
+
+bool CMSMFixedBase::Mul(const EC_GROUP* group, BN_CTX* ctx, const vector<BIGNUM*>& vScalars,
+                        EC_POINT* result, unsigned int nThreads) const
+{
+    if (vScalars.size() != nBases || vTable.size() != nBases * nWindows)
+        return false;
+
+    if (nWindowBits == 0)
+    {
+        vector<EC_POINT*> vPoint;
+        vector<BIGNUM*> vScalar;
+        for (size_t i = 0; i < nBases; i++)
+        {
+            if (!vScalars[i])
+                continue;
+            vPoint.push_back(vTable[i]);
+            vScalar.push_back(vScalars[i]);
+        }
+        return MultiScalarMul(group, ctx, vPoint, vScalar, result, nThreads);
+    }
+
+    if (EC_POINT_set_to_infinity(group, result) != 1)
+        return false;
+    const BIGNUM* order = EC_GROUP_get0_order(group);
+    BIGNUM* tmp = BN_new();
+    if (!order || !tmp)
+    {
+        if (tmp)
+            BN_free(tmp);
+        return false;
+    }
+
+    // Table point (i, j) carries digit j of scalar i as its only digit
+    vector<const EC_POINT*> vPoint;
+    vector<int> vDigits;
+    vPoint.reserve(vTable.size());
+    vDigits.reserve(vTable.size());
+    vector<int> vScalarDigits(nWindows);
+    bool fOk = true;
+    for (size_t i = 0; i < nBases && fOk; i++)
+    {
+        CMSMScalar s;
+        if (!vScalars[i])
+            continue;
+        fOk = ReduceScalar(vScalars[i], order, tmp, ctx, s);
+        if (!fOk || IsZero(s) || EC_POINT_is_at_infinity(group, vTable[i * nWindows]))
+            continue;
+        SignedDigits(s, nWindowBits, nWindows, &vScalarDigits[0]);
+        for (int j = 0; j < nWindows; j++)
+        {
+            if (vScalarDigits[j] == 0)
+                continue;
+            vPoint.push_back(vTable[i * nWindows + j]);
+            vDigits.push_back(vScalarDigits[j]);
+        }
+    }
+    BN_free(tmp);
+    if (!fOk || vPoint.empty())
+        return fOk;
+
+    CBucketPass pass;
+    pass.group = group;
+    pass.pvPoints = &vPoint;
+    pass.pvDigits = &vDigits;
+    pass.nWindows = 1;
+    pass.nWindowBits = nWindowBits;
+
+    // Threads take contiguous slices of the terms, each with its own buckets
+    unsigned int nTasks = vPoint.size() >= MSM_THREAD_MIN_TERMS ? max(1U, nThreads) : 1;
+    vector<CBucketTask> vTasks(nTasks);
+    for (unsigned int t = 0; t < nTasks; t++)
+    {
+        vTasks[t].w = 0;
+        vTasks[t].nBegin = vPoint.size() * t / nTasks;
+        vTasks[t].nEnd = vPoint.size() * (t + 1) / nTasks;
+    }
+    vector<EC_POINT*> vSums;
+    fOk = NewPoints(group, nTasks, vSums) && RunBucketTasks(pass, vTasks, nTasks, vSums, ctx);
+    for (unsigned int t = 0; t < nTasks && fOk; t++)
+        fOk = EC_POINT_add(group, result, result, vSums[t], ctx) == 1;
+    FreePoints(vSums);
+    return fOk;
+}
+
+namespace
+{
+std::mutex g_msmFixedBaseMutex;
+std::map<std::string, std::shared_ptr<CMSMFixedBase> > g_msmFixedBase;
+}
+
+const CMSMFixedBase* GetMSMFixedBase(const std::string& strName,
+                                     const vector<vector<unsigned char> >& vBaseBytes)
+{
+    // Built under the lock so concurrent verifiers wait for one table rather
+    // than each building their own; only a handful of names ever exist.
+    std::lock_guard<std::mutex> lock(g_msmFixedBaseMutex);
+    std::map<std::string, std::shared_ptr<CMSMFixedBase> >::const_iterator it = g_msmFixedBase.find(strName);
+    if (it != g_msmFixedBase.end())
+        return it->second.get();
+
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    BN_CTX* ctx = BN_CTX_new();
+    std::shared_ptr<CMSMFixedBase> table(new CMSMFixedBase());
+    bool fOk = group && ctx && table->Init(group, vBaseBytes, ctx);
+    if (ctx)
+        BN_CTX_free(ctx);
+    if (group)
+        EC_GROUP_free(group);
+    if (!fOk)
+        return NULL;
+    g_msmFixedBase[strName] = table;
+    return table.get();
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_MSM_H
+#define INNOVA_MSM_H
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+
+#include <string>
+#include <vector>
+
+/** Maximum number of threads one multiplication may use (-msmthreads) */
+static const unsigned int MAX_MSM_THREADS = 16;
+/** Smaller multiplications are left to OpenSSL's interleaved wNAF method */
+static const size_t MSM_BUCKET_MIN_TERMS = 48;
+/** Smaller multiplications are not worth handing to other threads */
+static const size_t MSM_THREAD_MIN_TERMS = 256;
+/** Most precomputed points a fixed base table may hold */
+static const size_t MSM_FIXED_BASE_MAX_POINTS = 1 << 16;
+
+/** Threads the proof verifiers let a large multiplication use */
+extern unsigned int nMSMThreads;
+
+/** Multi-scalar multiplication over secp256k1, shared by every proof verifier:
+ *
+ *   result = sum_i scalars[i] * points[i]
+ *
+ * Pippenger's bucket method with signed window digits. The points are
+ * normalized to affine form in one batch, so every bucket addition is a mixed
+ * addition, and the buckets are normalized the same way before they are
+ * summed. Scalars are read as fixed-width 256 bit values after reduction mod
+ * the group order; points may be the identity. With nThreads > 1 the windows
+ * are split over that many threads. Verification only: not constant time.
+ */
+bool MultiScalarMul(const EC_GROUP* group, BN_CTX* ctx,
+                    const std::vector<EC_POINT*>& points,
+                    const std::vector<BIGNUM*>& scalars,
+                    EC_POINT* result, unsigned int nThreads = 1);
+
+/** A fixed list of base points with the multiples 2^(c*j) * P_i of each one
+ * precomputed in affine form. A multiplication over the bases then needs no
+ * doublings: the digits of every window share one set of buckets. When the
+ * table would be too large only the parsed, normalized bases are kept and
+ * Mul() runs the ordinary bucket method over them.
+ */
+class CMSMFixedBase
+{
+public:
+    CMSMFixedBase();
+    ~CMSMFixedBase();
+
+    bool Init(const EC_GROUP* group, const std::vector<EC_POINT*>& vBase, BN_CTX* ctx);
+    bool Init(const EC_GROUP* group, const std::vector<std::vector<unsigned char> >& vBaseBytes, BN_CTX* ctx);
+
+    size_t size() const { return nBases; }
+    const EC_POINT* GetBase(size_t i) const { return vTable[i * nWindows]; }
+
+    /** result = sum_i vScalars[i] * base i; NULL scalars count as zero */
+    bool Mul(const EC_GROUP* group, BN_CTX* ctx, const std::vector<BIGNUM*>& vScalars,
+             EC_POINT* result, unsigned int nThreads = 1) const;
+
+private:
+    size_t nBases;
+    int nWindowBits;
+    int nWindows;
+    std::vector<EC_POINT*> vTable;
+
+    CMSMFixedBase(const CMSMFixedBase&);
+    CMSMFixedBase& operator=(const CMSMFixedBase&);
+};
+
+/** The table for a base set that never changes, keyed by a name its owner
+ * chooses. It is built from vBaseBytes (compressed points) on first use and
+ * kept for the life of the process; NULL if a base does not parse.
+ */
+const CMSMFixedBase* GetMSMFixedBase(const std::string& strName,
+                                     const std::vector<std::vector<unsigned char> >& vBaseBytes);
+
+#endif
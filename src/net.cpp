@@ -13,6 +13,7 @@
 #include "collateralnode.h"
 #include "dandelion.h"
 #include "shielded.h"
+#include "netpoll.h"
 #include <sys/stat.h>
 #include <algorithm>
 
@@ -510,6 +511,83 @@ uint64_t CNode::nMaxOutboundTotalBytesSentInCycle = 0;
 uint64_t CNode::nMaxOutboundTimeframe = 60*60*24; //1 day
 uint64_t CNode::nMaxOutboundCycleStartTime = 0;
 
+// ThreadMessageHandler sleeps on this between passes; the socket thread and
+// block relay wake it so a completed message is not left waiting out the tick.
+static boost::mutex mutexMessageHandler;
+static boost::condition_variable condMessageHandler;
+static bool fMessageHandlerWake = false;
+
+void WakeMessageHandler()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutexMessageHandler);
+        fMessageHandlerWake = true;
+    }
+    condMessageHandler.notify_one();
+}
+
+bool WaitForMessageHandlerWake(int64_t nMillis)
+{
+    boost::unique_lock<boost::mutex> lock(mutexMessageHandler);
+    if (nMillis > 0)
+        condMessageHandler.timed_wait(lock, boost::get_system_time() + boost::posix_time::milliseconds(nMillis),
+                                      [] { return fMessageHandlerWake || fShutdown; });
+    bool fWoken = fMessageHandlerWake;
+    fMessageHandlerWake = false;
+    return fWoken;
+}
+
+static CCriticalSection cs_mapMessageLatency;
+static map<string, CMessageLatency> mapMessageLatency;
+
+int CMessageLatency::GetBucket(int64_t nMicros)
+{
+    int nBucket = 0;
+    while (nMicros > 0 && nBucket < MESSAGE_LATENCY_BUCKETS - 1)
+    {
+        nMicros >>= 1;
+        nBucket++;
+    }
+    return nBucket;
+}
+
+void CMessageLatency::Add(int64_t nQueueMicros, int64_t nProcessMicros)
+{
+    nQueueMicros = std::max(nQueueMicros, (int64_t)0);
+    nProcessMicros = std::max(nProcessMicros, (int64_t)0);
+    nCount++;
+    nQueueTotal += nQueueMicros;
+    nQueueMax = std::max(nQueueMax, nQueueMicros);
+    nProcessTotal += nProcessMicros;
+    nProcessMax = std::max(nProcessMax, nProcessMicros);
+    vQueue[GetBucket(nQueueMicros)]++;
+    vProcess[GetBucket(nProcessMicros)]++;
+}
+
+void RecordMessageLatency(const string& strCommand, int64_t nQueueMicros, int64_t nProcessMicros)
+{
+    LOCK(cs_mapMessageLatency);
+    map<string, CMessageLatency>::iterator it = mapMessageLatency.find(strCommand);
+    if (it == mapMessageLatency.end())
+    {
+        // Commands are peer-chosen, so cap the number of entries
+        if (mapMessageLatency.size() >= MAX_MESSAGE_LATENCY_COMMANDS)
+            it = mapMessageLatency.insert(make_pair(string("other"), CMessageLatency())).first;
+        else
+            it = mapMessageLatency.insert(make_pair(strCommand, CMessageLatency())).first;
+    }
+    it->second.Add(nQueueMicros, nProcessMicros);
+}
+
+map<string, CMessageLatency> GetMessageLatencyStats(bool fReset)
+{
+    LOCK(cs_mapMessageLatency);
+    map<string, CMessageLatency> mapRet = mapMessageLatency;
+    if (fReset)
+        mapMessageLatency.clear();
+    return mapRet;
+}
+
 CNode* FindNode(const CNetAddr& ip)
 {
     {
@@ -1051,6 +1129,7 @@ uint64_t CNode::GetTotalBytesSent()
 // requires LOCK(cs_vRecvMsg)
 bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
 {
+    bool fComplete = false;
     while (nBytes > 0) {
 
         // get current incomplete message, or create a new one
@@ -1073,10 +1152,15 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
         pch += handled;
         nBytes -= handled;
 
-        if (msg.complete())
+        if (msg.complete()) {
             msg.nTime = GetTimeMicros();
+            fComplete = true;
+        }
     }
 
+    if (fComplete)
+        WakeMessageHandler();
+
     return true;
 }
 
@@ -1137,6 +1221,9 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
+    // Pending getdata is held back while the send buffer is full
+    unsigned int nSendBufferSize = SendBufferSize();
+    bool fSendBufferFull = pnode->nSendSize >= nSendBufferSize;
     std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
@@ -1200,6 +1287,9 @@ void SocketSendData(CNode *pnode)
         }
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+
+    if (fSendBufferFull && pnode->nSendSize < nSendBufferSize)
+        WakeMessageHandler();
 }
 
 static list<CNode*> vNodesDisconnected;
@@ -1362,6 +1452,15 @@ void ThreadSocketHandler2(void* parg)
     list<CNode*> vNodesDisconnected;
     unsigned int nPrevNodeCount = 0;
 
+    CSocketPoller poller;
+    set<void*> setListenData;
+    for (ListenSocket& hListenSocket : vhListenSocket)
+    {
+        poller.Add(hListenSocket.socket, &hListenSocket, true);
+        setListenData.insert(&hListenSocket);
+    }
+    bool fPollPending = false;
+
     while (true)
     {
         //
@@ -1440,73 +1539,74 @@ void ThreadSocketHandler2(void* parg)
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
+        // select() needs the interest set rebuilt every pass. epoll only needs
+        // new sockets registered; their readiness is kept on the node.
+        bool fEdge = poller.IsEdgeTriggered();
         {
             LOCK(cs_vNodes);
             for (CNode* pnode : vNodes)
             {
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
+                if (fEdge)
+                {
+                    if (!pnode->fPollRegistered && poller.Add(pnode->hSocket, pnode))
+                    {
+                        pnode->fPollRegistered = true;
+                        pnode->fPollReadable = true;
+                        pnode->fPollWritable = true;
+                    }
+                    continue;
+                }
+                pnode->fPollReadable = false;
+                pnode->fPollWritable = false;
                 {
                     TRY_LOCK(pnode->cs_vSend, lockSend);
                     if (lockSend) {
                         // do not read, if draining write queue
                         if (!pnode->vSendMsg.empty())
-                            FD_SET(pnode->hSocket, &fdsetSend);
+                            poller.SetInterest(pnode->hSocket, pnode, CSocketPoller::POLL_WRITE | CSocketPoller::POLL_ERR);
                         else
-                            FD_SET(pnode->hSocket, &fdsetRecv);
-                        FD_SET(pnode->hSocket, &fdsetError);
-                        hSocketMax = max(hSocketMax, pnode->hSocket);
-                        have_fds = true;
+                            poller.SetInterest(pnode->hSocket, pnode, CSocketPoller::POLL_READ | CSocketPoller::POLL_ERR);
                     }
                 }
             }
         }
+        if (!fEdge)
+            for (ListenSocket& hListenSocket : vhListenSocket)
+                poller.SetInterest(hListenSocket.socket, &hListenSocket, CSocketPoller::POLL_READ);
 
+        // frequency to poll pnode->vSend; a node left readable because its
+        // lock was busy is retried almost at once
+        vector<pair<void*, int> > vReady;
         vnThreadsRunning[THREAD_SOCKETHANDLER]--;
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        poller.Wait(fPollPending ? 1 : 50, vReady);
         vnThreadsRunning[THREAD_SOCKETHANDLER]++;
         if (fShutdown)
             return;
-        if (nSelect == SOCKET_ERROR)
+        fPollPending = false;
+
+        set<void*> setListenReady;
+        for (unsigned int i = 0; i < vReady.size(); i++)
         {
-            if (have_fds)
+            if (setListenData.count(vReady[i].first))
             {
-                int nErr = WSAGetLastError();
-                printf("socket select error %d\n", nErr);
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
+                setListenReady.insert(vReady[i].first);
+                continue;
             }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec/1000);
+            CNode* pnode = (CNode*)vReady[i].first;
+            if (vReady[i].second & (CSocketPoller::POLL_READ | CSocketPoller::POLL_ERR))
+                pnode->fPollReadable = true;
+            if (vReady[i].second & CSocketPoller::POLL_WRITE)
+                pnode->fPollWritable = true;
         }
 
 
         //
         // Accept new connections
         //
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv)) {
+        for (ListenSocket& hListenSocket : vhListenSocket) {
+            if (hListenSocket.socket != INVALID_SOCKET && setListenReady.count(&hListenSocket)) {
                 AcceptConnection(hListenSocket);
             }
         }
@@ -1532,11 +1632,19 @@ void ThreadSocketHandler2(void* parg)
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
+            // An edge-triggered reader waits for its send queue to drain
+            // first; the write event that empties it brings it back here.
+            if (pnode->fPollReadable && (!fEdge || pnode->nSendSize == 0))
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv)
+                if (!lockRecv)
+                    fPollPending = true;
+                // Level-triggered readiness is good for one recv(); edge-
+                // triggered readiness lasts until recv() comes up short.
+                while (lockRecv && pnode->fPollReadable && pnode->hSocket != INVALID_SOCKET)
                 {
+                    if (!fEdge)
+                        pnode->fPollReadable = false;
                     unsigned int nRecvQueueSize = pnode->GetTotalRecvSize();
                     if (nRecvQueueSize > ReceiveFloodSize()) {
                         int64_t nNow = GetTime();
@@ -1565,6 +1673,8 @@ void ThreadSocketHandler2(void* parg)
                                    nRecvQueueSize, ReceiveFloodSize(), ReceiveFloodHardSize(),
                                    pnode->addr.ToString().c_str());
                         }
+                        // stays readable; retried on the next pass
+                        break;
                     }
                     else {
                         pnode->nRecvFloodHardStart = 0;
@@ -1580,6 +1690,9 @@ void ThreadSocketHandler2(void* parg)
                             pnode->nLastRecv = GetTime();
                             pnode->nRecvBytes += nBytes;
                             pnode->RecordBytesRecv(nBytes);
+                            // a short read drained the socket; more data raises a new edge
+                            if (nBytes < (int)sizeof(pchBuf))
+                                pnode->fPollReadable = false;
                         }
                         else if (nBytes == 0)
                         {
@@ -1587,6 +1700,7 @@ void ThreadSocketHandler2(void* parg)
                             if (!pnode->fDisconnect)
                                 printf("DEBUG-DISCONNECT socket-closed-by-peer peer=%s\n", pnode->addr.ToString().c_str());
                             pnode->CloseSocketDisconnect("socket-closed-by-peer");
+                            pnode->fPollReadable = false;
                         }
                         else if (nBytes < 0)
                         {
@@ -1598,17 +1712,8 @@ void ThreadSocketHandler2(void* parg)
                                     printf("DEBUG-DISCONNECT recv-error %d peer=%s\n", nErr, pnode->addr.ToString().c_str());
                                 pnode->CloseSocketDisconnect("recv-error");
                             }
-                        }
-                        else if (nBytes > 500000) // 500,000 Bytes
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    printf("DEBUG-DISCONNECT output-too-large %d peer=%s\n", nErr, pnode->addr.ToString().c_str());
-                                pnode->CloseSocketDisconnect("output-too-large");
-                            }
+                            if (nErr != WSAEINTR)
+                                pnode->fPollReadable = false;
                         }
                     }
                 }
@@ -1619,11 +1724,21 @@ void ThreadSocketHandler2(void* parg)
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend))
+            if (pnode->fPollWritable)
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
-                if (lockSend)
+                if (lockSend && !pnode->vSendMsg.empty())
+                {
                     SocketSendData(pnode);
+                    // a queue left behind means send() would block; wait for
+                    // the next write edge
+                    if (fEdge)
+                    {
+                        pnode->fPollWritable = pnode->vSendMsg.empty();
+                        if (pnode->vSendMsg.empty() && pnode->fPollReadable)
+                            fPollPending = true;
+                    }
+                }
             }
 
             //
@@ -2584,12 +2699,13 @@ void ThreadMessageHandler2(void* parg)
                 pnode->Release();
         }
 
-        // Wait and allow messages to bunch up.
+        // Wait until woken by a completed message, freed send buffer space or
+        // a block to announce. The 100ms timeout still drives the periodic
+        // work in SendMessages (trickle, pings, getdata retries).
         // Reduce vnThreadsRunning so StopNode has permission to exit while
         // we're sleeping, but we must always check fShutdown after doing this.
         vnThreadsRunning[THREAD_MESSAGEHANDLER]--;
-        if (fSleep)
-            MilliSleep(100);
+        WaitForMessageHandlerWake(fSleep ? 100 : 0);
         if (fRequestShutdown)
             StartShutdown();
         vnThreadsRunning[THREAD_MESSAGEHANDLER]++;
@@ -2944,6 +3060,7 @@ bool StopNode()
 {
     printf("StopNode()\n");
     fShutdown = true;
+    WakeMessageHandler();
     mempool.AddTransactionsUpdated(1);
     int64_t nStart = GetTime();
     if (semOutbound)
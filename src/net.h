@@ -67,6 +67,41 @@ void StartTor(void* parg);
 void StartNode(void* parg);
 bool StopNode();
 void SocketSendData(CNode *pnode);
+void WakeMessageHandler();
+/** Wait up to nMillis for WakeMessageHandler() or shutdown, returning at once
+ *  if a wake is already pending. Consumes the wake; true if there was one. */
+bool WaitForMessageHandlerWake(int64_t nMillis);
+
+/** Number of power-of-two microsecond buckets in a message latency histogram. */
+static const int MESSAGE_LATENCY_BUCKETS = 24;
+/** Distinct commands tracked before the rest are folded into "other". */
+static const unsigned int MAX_MESSAGE_LATENCY_COMMANDS = 64;
+
+/** Processing latency of one message command. Bucket 0 counts zero-microsecond
+ *  samples and bucket i > 0 counts samples in [2^(i-1), 2^i) us; the last
+ *  bucket is open-ended. Queue time runs from CNetMessage::nTime to the start
+ *  of ProcessMessage(), process time covers ProcessMessage() itself. */
+struct CMessageLatency
+{
+    uint64_t nCount;
+    int64_t nQueueTotal;
+    int64_t nQueueMax;
+    int64_t nProcessTotal;
+    int64_t nProcessMax;
+    uint64_t vQueue[MESSAGE_LATENCY_BUCKETS];
+    uint64_t vProcess[MESSAGE_LATENCY_BUCKETS];
+
+    CMessageLatency()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    static int GetBucket(int64_t nMicros);
+    void Add(int64_t nQueueMicros, int64_t nProcessMicros);
+};
+
+void RecordMessageLatency(const std::string& strCommand, int64_t nQueueMicros, int64_t nProcessMicros);
+std::map<std::string, CMessageLatency> GetMessageLatencyStats(bool fReset = false);
 
 // Signals for message handling
 struct CNodeSignals
@@ -447,6 +482,10 @@ public:
     int64_t nLastBlockCatchupTime;
     int64_t nRecvFloodHardStart;
     int64_t nLastRecvFloodLog;
+    // Socket readiness, owned by ThreadSocketHandler (see CSocketPoller)
+    bool fPollRegistered;
+    bool fPollReadable;
+    bool fPollWritable;
 
     int nBlocksReceivedInBatch;
     int nExpectedBatchSize;
@@ -526,6 +565,9 @@ public:
         nLastBlockCatchupTime = 0;
         nRecvFloodHardStart = 0;
         nLastRecvFloodLog = 0;
+        fPollRegistered = false;
+        fPollReadable = false;
+        fPollWritable = false;
         nBlocksReceivedInBatch = 0;
         nExpectedBatchSize = 0;
         fPrefetchSent = false;
@@ -791,6 +833,22 @@ public:
         }
     }
 
+    /** Send an already serialized payload, e.g. a block as stored on disk. */
+    void PushMessageRaw(const char* pszCommand, const char* pch, size_t nSize)
+    {
+        try
+        {
+            BeginMessage(pszCommand);
+            ssSend.write(pch, nSize);
+            EndMessage();
+        }
+        catch (...)
+        {
+            AbortMessage();
+            throw;
+        }
+    }
+
     template<typename T1>
     void PushMessage(const char* pszCommand, const T1& a1)
     {
@@ -0,0 +1,169 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netpoll.h"
+#include "util.h"
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+using namespace std;
+
+// Events fetched per epoll_wait(); anything beyond stays queued in the kernel.
+static const int MAX_EPOLL_EVENTS = 256;
+
+bool CSocketPoller::HaveEdgeTriggered()
+{
+#ifdef USE_EPOLL
+    return true;
+#else
+    return false;
+#endif
+}
+
+CSocketPoller::CSocketPoller(bool fEdgeTriggeredIn) : fEdgeTriggered(false), hEpoll(-1)
+{
+#ifdef USE_EPOLL
+    if (fEdgeTriggeredIn)
+    {
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (hEpoll < 0)
+            printf("CSocketPoller : epoll_create1 failed (%d), falling back to select()\n", WSAGetLastError());
+        fEdgeTriggered = hEpoll >= 0;
+    }
+#endif
+}
+
+CSocketPoller::~CSocketPoller()
+{
+#ifdef USE_EPOLL
+    if (hEpoll >= 0)
+        close(hEpoll);
+#endif
+}
+
+bool CSocketPoller::Add(SOCKET hSocket, void* pData, bool fListen)
+{
+#ifdef USE_EPOLL
+    if (fEdgeTriggered)
+    {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = fListen ? EPOLLIN : (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+        ev.data.ptr = pData;
+        if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hSocket, &ev) != 0)
+        {
+            printf("CSocketPoller::Add : epoll_ctl failed for socket %d (%d)\n", (int)hSocket, WSAGetLastError());
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+void CSocketPoller::SetInterest(SOCKET hSocket, void* pData, int nEvents)
+{
+    if (fEdgeTriggered)
+        return;
+    CInterest interest;
+    interest.hSocket = hSocket;
+    interest.pData = pData;
+    interest.nEvents = nEvents;
+    vInterest.push_back(interest);
+}
+
+int CSocketPoller::Wait(int nTimeoutMs, vector<pair<void*, int> >& vReady)
+{
+    vReady.clear();
+
+#ifdef USE_EPOLL
+    if (fEdgeTriggered)
+    {
+        struct epoll_event vEvents[MAX_EPOLL_EVENTS];
+        int nReady = epoll_wait(hEpoll, vEvents, MAX_EPOLL_EVENTS, nTimeoutMs);
+        if (nReady < 0)
+        {
+            if (WSAGetLastError() == WSAEINTR)
+                return 0;
+            printf("socket epoll_wait error %d\n", WSAGetLastError());
+            MilliSleep(nTimeoutMs);
+            return -1;
+        }
+        vReady.reserve(nReady);
+        for (int i = 0; i < nReady; i++)
+        {
+            int nEvents = 0;
+            if (vEvents[i].events & (EPOLLIN | EPOLLRDHUP))
+                nEvents |= POLL_READ;
+            if (vEvents[i].events & EPOLLOUT)
+                nEvents |= POLL_WRITE;
+            if (vEvents[i].events & (EPOLLERR | EPOLLHUP))
+                nEvents |= POLL_ERR;
+            void* pData = vEvents[i].data.ptr;
+            vReady.push_back(make_pair(pData, nEvents));
+        }
+        return nReady;
+    }
+#endif
+
+    struct timeval timeout;
+    timeout.tv_sec  = nTimeoutMs / 1000;
+    timeout.tv_usec = (nTimeoutMs % 1000) * 1000;
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    for (unsigned int i = 0; i < vInterest.size(); i++)
+    {
+        const CInterest& interest = vInterest[i];
+        if (interest.nEvents & POLL_READ)
+            FD_SET(interest.hSocket, &fdsetRecv);
+        if (interest.nEvents & POLL_WRITE)
+            FD_SET(interest.hSocket, &fdsetSend);
+        if (interest.nEvents & POLL_ERR)
+            FD_SET(interest.hSocket, &fdsetError);
+        hSocketMax = max(hSocketMax, interest.hSocket);
+        have_fds = true;
+    }
+
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR)
+    {
+        // Let every reader try its socket; recv() reports whatever is wrong
+        if (have_fds)
+        {
+            printf("socket select error %d\n", WSAGetLastError());
+            for (unsigned int i = 0; i < vInterest.size(); i++)
+                if (vInterest[i].nEvents & POLL_READ)
+                    vReady.push_back(make_pair(vInterest[i].pData, (int)POLL_READ));
+        }
+        vInterest.clear();
+        MilliSleep(nTimeoutMs);
+        return -1;
+    }
+
+    for (unsigned int i = 0; nSelect > 0 && i < vInterest.size(); i++)
+    {
+        const CInterest& interest = vInterest[i];
+        int nEvents = 0;
+        if (FD_ISSET(interest.hSocket, &fdsetRecv))
+            nEvents |= POLL_READ;
+        if (FD_ISSET(interest.hSocket, &fdsetSend))
+            nEvents |= POLL_WRITE;
+        if (FD_ISSET(interest.hSocket, &fdsetError))
+            nEvents |= POLL_ERR;
+        if (nEvents)
+            vReady.push_back(make_pair(interest.pData, nEvents));
+    }
+    vInterest.clear();
+    return vReady.size();
+}
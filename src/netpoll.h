@@ -0,0 +1,76 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_NETPOLL_H
+#define INNOVA_NETPOLL_H
+
+#include <utility>
+#include <vector>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "compat.h"
+
+/** Socket readiness for ThreadSocketHandler.
+  *
+  * The select() backend is level-triggered and takes its interest set anew
+  * before every Wait(). The epoll backend (built with USE_EPOLL) registers
+  * each socket once, edge-triggered for both directions: a socket reported
+  * readable or writable stays that way until a recv() or send() on it would
+  * block, so the caller must track readiness itself. Each socket carries an
+  * opaque pointer that Wait() hands back with its events.
+  *
+  * A registered socket is dropped by the kernel when it is closed, so there is
+  * no removal call; removing by descriptor after close could hit a socket that
+  * another thread has since opened with the same number.
+  */
+class CSocketPoller
+{
+public:
+    enum
+    {
+        POLL_READ = 1,
+        POLL_WRITE = 2,
+        POLL_ERR = 4,
+    };
+
+    explicit CSocketPoller(bool fEdgeTriggeredIn = HaveEdgeTriggered());
+    ~CSocketPoller();
+
+    /** Whether this build has the epoll backend. */
+    static bool HaveEdgeTriggered();
+
+    bool IsEdgeTriggered() const { return fEdgeTriggered; }
+
+    /** Start watching a socket (edge-triggered backend only; the select()
+      * backend returns true and ignores it). Listening sockets are watched
+      * level-triggered for reads so one accept() per Wait() suffices. */
+    bool Add(SOCKET hSocket, void* pData, bool fListen = false);
+
+    /** Interest for the next Wait() (select() backend only). */
+    void SetInterest(SOCKET hSocket, void* pData, int nEvents);
+
+    /** Wait up to nTimeoutMs for readiness and return the ready sockets'
+      * data pointers with their POLL_* events. Returns the number of ready
+      * sockets, or -1 on error. */
+    int Wait(int nTimeoutMs, std::vector<std::pair<void*, int> >& vReady);
+
+private:
+    CSocketPoller(const CSocketPoller&);
+    void operator=(const CSocketPoller&);
+
+    bool fEdgeTriggered;
+    int hEpoll;
+
+    struct CInterest
+    {
+        SOCKET hSocket;
+        void* pData;
+        int nEvents;
+    };
+    std::vector<CInterest> vInterest;
+};
+
+#endif
@@ -358,6 +358,7 @@ bool CNullSendSession::FinalizeTransaction()
 
     finalTx = unsignedTx;
     finalTx.bindingSig.bindingSig = aggBindingSig;
+    finalTx.ClearHashCache();
 
     bool fBindingActive = NullSendBindingActive();
 
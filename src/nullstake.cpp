@@ -6,6 +6,7 @@
 #include "poseidon2.h"
 #include "bulletproof_ac.h"
 #include "hash.h"
+#include "msm.h"
 #include "util.h"
 #include "verifycache.h"
 #include "bignum.h"
@@ -58,6 +59,52 @@ public:
     operator EC_POINT*() { return point; }
 };
 
+// True if sum_i vScalar[i] * vPoint[i] is the identity. The verifiers move
+// every term of an equation to one side, negating scalars mod the order, so
+// each check is one multi-scalar multiplication instead of an EC_POINT_mul
+// per term.
+static bool NullStakeTermsCancel(const EC_GROUP* group, BN_CTX* ctx,
+                                 const std::vector<EC_POINT*>& vPoint,
+                                 const std::vector<BIGNUM*>& vScalar)
+{
+    CZarcECPointGuard result(group);
+    return result.point && MultiScalarMul(group, ctx, vPoint, vScalar, result) &&
+           EC_POINT_is_at_infinity(group, result) == 1;
+}
+
+// G as a multi-scalar multiplication term; MultiScalarMul only reads it
+static EC_POINT* NullStakeGenerator(const EC_GROUP* group)
+{
+    return const_cast<EC_POINT*>(EC_GROUP_get0_generator(group));
+}
+
+// The link proof that Vv and cv commit to the same value,
+//   sL*G == RL + e*(Vv - cv),
+// checked as sL*G - RL - e*Vv + e*cv == identity
+static bool VerifyNullStakeLinkEquation(const EC_GROUP* group, BN_CTX* ctx, const BIGNUM* order,
+                                        BIGNUM* bnSLink, EC_POINT* RLink, BIGNUM* bnELink,
+                                        const CPedersenCommitment& vv, const CPedersenCommitment& cv)
+{
+    CZarcECPointGuard VvPoint(group), cvPoint(group);
+    if (!EC_POINT_oct2point(group, VvPoint, vv.vchCommitment.data(), vv.vchCommitment.size(), ctx))
+        return false;
+    if (!EC_POINT_oct2point(group, cvPoint, cv.vchCommitment.data(), cv.vchCommitment.size(), ctx))
+        return false;
+
+    CNullStakeBNGuard bnMinusOne, bnNegE;
+    if (!BN_sub(bnMinusOne, order, BN_value_one()) ||
+        !BN_mod_sub(bnNegE, order, bnELink, order, ctx))
+        return false;
+
+    std::vector<EC_POINT*> vPoint;
+    std::vector<BIGNUM*> vScalar;
+    vPoint.push_back(NullStakeGenerator(group)); vScalar.push_back(bnSLink);
+    vPoint.push_back(RLink);                     vScalar.push_back(bnMinusOne);
+    vPoint.push_back(VvPoint);                   vScalar.push_back(bnNegE);
+    vPoint.push_back(cvPoint);                   vScalar.push_back(bnELink);
+    return NullStakeTermsCancel(group, ctx, vPoint, vScalar);
+}
+
 static const char* NULLSTAKE_KERNEL_DOMAIN = "Innova_NullStakeKernel";
 static const char* NULLSTAKE_SIGMA_DOMAIN = "Innova_NullStakeSigma";
 
@@ -449,28 +496,26 @@ bool VerifyNullStakeKernelProof(const CNullStakeKernelProof& proof,
     if (BN_cmp(bnE, bnEExpected) != 0)
         return false;
 
-    CZarcECPointGuard lhs(group);
-    {
-        CZarcECPointGuard tmp1(group), tmp2(group);
-        EC_POINT_mul(group, tmp1, NULL, H, bnSV, ctx);
-        EC_POINT_mul(group, tmp2, bnSR, NULL, NULL, ctx);
-        EC_POINT_add(group, lhs, tmp1, tmp2, ctx);
-    }
+    CZarcECPointGuard cvPoint(group);
+    if (!EC_POINT_oct2point(group, cvPoint, cv.vchCommitment.data(), cv.vchCommitment.size(), ctx))
+        return false;
 
-    CZarcECPointGuard rhs(group);
+    // sV*H + sR*G == A + e*cv
+    CNullStakeBNGuard bnMinusOne, bnNegE;
+    if (!BN_sub(bnMinusOne, bnOrder, BN_value_one()) ||
+        !BN_mod_sub(bnNegE, bnOrder, bnE, bnOrder, ctx))
+        return false;
     {
-        CZarcECPointGuard cvPoint(group);
-        if (!EC_POINT_oct2point(group, cvPoint, cv.vchCommitment.data(), cv.vchCommitment.size(), ctx))
+        std::vector<EC_POINT*> vPoint;
+        std::vector<BIGNUM*> vScalar;
+        vPoint.push_back(NullStakeGenerator(group)); vScalar.push_back(bnSR);
+        vPoint.push_back(H);                         vScalar.push_back(bnSV);
+        vPoint.push_back(A);                         vScalar.push_back(bnMinusOne);
+        vPoint.push_back(cvPoint);                   vScalar.push_back(bnNegE);
+        if (!NullStakeTermsCancel(group, ctx, vPoint, vScalar))
             return false;
-
-        CZarcECPointGuard eCv(group);
-        EC_POINT_mul(group, eCv, NULL, cvPoint, bnE, ctx);
-        EC_POINT_add(group, rhs, A, eCv, ctx);
     }
 
-    if (EC_POINT_cmp(group, lhs, rhs, ctx) != 0)
-        return false;
-
     CNullStakeBNGuard bnWeightScalar;
     {
         unsigned char wBytes[8];
@@ -478,19 +523,19 @@ bool VerifyNullStakeKernelProof(const CNullStakeKernelProof& proof,
         BN_bin2bn(wBytes, 8, bnWeightScalar);
     }
 
-    CZarcECPointGuard expectedCW(group);
-    {
-        CZarcECPointGuard cvPoint(group);
-        EC_POINT_oct2point(group, cvPoint, cv.vchCommitment.data(), cv.vchCommitment.size(), ctx);
-        EC_POINT_mul(group, expectedCW, NULL, cvPoint, bnWeightScalar, ctx);
-    }
-
     CZarcECPointGuard actualCW(group);
     if (!EC_POINT_oct2point(group, actualCW, vchCW.data(), vchCW.size(), ctx))
         return false;
 
-    if (EC_POINT_cmp(group, actualCW, expectedCW, ctx) != 0)
-        return false;
+    // CW == weight*cv
+    {
+        std::vector<EC_POINT*> vPoint;
+        std::vector<BIGNUM*> vScalar;
+        vPoint.push_back(cvPoint);  vScalar.push_back(bnWeightScalar);
+        vPoint.push_back(actualCW); vScalar.push_back(bnMinusOne);
+        if (!NullStakeTermsCancel(group, ctx, vPoint, vScalar))
+            return false;
+    }
 
     if (offset + 4 > proof.vchProof.size())
         return false;
@@ -584,40 +629,30 @@ bool VerifyNullStakeKernelProof(const CNullStakeKernelProof& proof,
     BN_mod_inverse(bnDenomInv, bnDivisor, bnOrder, ctx);
     BN_mod_mul(bnK, bnKNum, bnDenomInv, bnOrder, ctx);
 
-    CZarcECPointGuard D(group);
-    {
-        CZarcECPointGuard excessPoint(group);
-        if (!EC_POINT_oct2point(group, excessPoint, excessCv.vchCommitment.data(), excessCv.vchCommitment.size(), ctx))
-            return false;
-
-        CNullStakeBNGuard bnHashKernel;
-        BN_bin2bn(hashKernel.begin(), 32, bnHashKernel);
-        BN_mod(bnHashKernel, bnHashKernel, bnOrder, ctx);
-
-        CZarcECPointGuard hashH(group);
-        EC_POINT_mul(group, hashH, NULL, H, bnHashKernel, ctx);
-
-        CZarcECPointGuard kCW(group);
-        EC_POINT_mul(group, kCW, NULL, actualCW, bnK, ctx);
-
-        EC_POINT_add(group, D, excessPoint, hashH, ctx);
-        CZarcECPointGuard negKCW(group);
-        EC_POINT_copy(negKCW, kCW);
-        EC_POINT_invert(group, negKCW, ctx);
-        EC_POINT_add(group, D, D, negKCW, ctx);
-    }
+    CZarcECPointGuard excessPoint(group);
+    if (!EC_POINT_oct2point(group, excessPoint, excessCv.vchCommitment.data(), excessCv.vchCommitment.size(), ctx))
+        return false;
 
-    CZarcECPointGuard lhsBinding(group);
-    EC_POINT_mul(group, lhsBinding, bnSD, NULL, NULL, ctx);
+    CNullStakeBNGuard bnHashKernel;
+    BN_bin2bn(hashKernel.begin(), 32, bnHashKernel);
+    BN_mod(bnHashKernel, bnHashKernel, bnOrder, ctx);
 
-    CZarcECPointGuard rhsBinding(group);
-    {
-        CZarcECPointGuard eD(group);
-        EC_POINT_mul(group, eD, NULL, D, bnED, ctx);
-        EC_POINT_add(group, rhsBinding, RD, eD, ctx);
-    }
+    // sD*G == RD + eD*D with D = excess + hashKernel*H - k*CW, expanded so the
+    // check is one multiplication over G, RD, excess, H and CW
+    CNullStakeBNGuard bnNegED, bnNegEDHash, bnEDK;
+    if (!BN_mod_sub(bnNegED, bnOrder, bnED, bnOrder, ctx) ||
+        !BN_mod_mul(bnNegEDHash, bnNegED, bnHashKernel, bnOrder, ctx) ||
+        !BN_mod_mul(bnEDK, bnED, bnK, bnOrder, ctx))
+        return false;
 
-    if (EC_POINT_cmp(group, lhsBinding, rhsBinding, ctx) != 0)
+    std::vector<EC_POINT*> vPoint;
+    std::vector<BIGNUM*> vScalar;
+    vPoint.push_back(NullStakeGenerator(group)); vScalar.push_back(bnSD);
+    vPoint.push_back(RD);                        vScalar.push_back(bnMinusOne);
+    vPoint.push_back(excessPoint);               vScalar.push_back(bnNegED);
+    vPoint.push_back(H);                         vScalar.push_back(bnNegEDHash);
+    vPoint.push_back(actualCW);                  vScalar.push_back(bnEDK);
+    if (!NullStakeTermsCancel(group, ctx, vPoint, vScalar))
     {
         if (fDebug)
             printf("VerifyNullStakeKernelProof: algebraic binding proof failed\n");
@@ -892,33 +927,8 @@ static bool VerifyNullStakeKernelProofV2Uncached(const CNullStakeKernelProofV2&
     if (BN_is_zero(bnELink))
         return false;
 
-    CZarcECPointGuard D(group);
-    {
-        CZarcECPointGuard VvPoint(group), cvPoint(group);
-        if (!EC_POINT_oct2point(group, VvPoint, proof.valueCommitment.vchCommitment.data(),
-                                proof.valueCommitment.vchCommitment.size(), ctx))
-            return false;
-        if (!EC_POINT_oct2point(group, cvPoint, cv.vchCommitment.data(),
-                                cv.vchCommitment.size(), ctx))
-            return false;
-
-        CZarcECPointGuard negCv(group);
-        EC_POINT_copy(negCv, cvPoint);
-        EC_POINT_invert(group, negCv, ctx);
-        EC_POINT_add(group, D, VvPoint, negCv, ctx);
-    }
-
-    CZarcECPointGuard lhsLink(group);
-    EC_POINT_mul(group, lhsLink, bnSLink, NULL, NULL, ctx);
-
-    CZarcECPointGuard rhsLink(group);
-    {
-        CZarcECPointGuard eD(group);
-        EC_POINT_mul(group, eD, NULL, D, bnELink, ctx);
-        EC_POINT_add(group, rhsLink, RLink, eD, ctx);
-    }
-
-    if (EC_POINT_cmp(group, lhsLink, rhsLink, ctx) != 0)
+    if (!VerifyNullStakeLinkEquation(group, ctx, bnOrder, bnSLink, RLink, bnELink,
+                                     proof.valueCommitment, cv))
     {
         if (fDebug)
             printf("VerifyNullStakeKernelProofV2: linking proof failed\n");
@@ -1622,29 +1632,8 @@ static bool VerifyNullStakeMofNKernelProofV3(const CNullStakeKernelProofV3& proo
     if (BN_is_zero(bnELink))
         return false;
 
-    CZarcECPointGuard D(group);
-    {
-        CZarcECPointGuard VvPoint(group), cvpPoint(group);
-        if (!EC_POINT_oct2point(group, VvPoint, proof.valueCommitment.vchCommitment.data(),
-                                proof.valueCommitment.vchCommitment.size(), ctx))
-            return false;
-        if (!EC_POINT_oct2point(group, cvpPoint, cvPlain.vchCommitment.data(),
-                                cvPlain.vchCommitment.size(), ctx))
-            return false;
-        CZarcECPointGuard negCvp(group);
-        EC_POINT_copy(negCvp, cvpPoint);
-        EC_POINT_invert(group, negCvp, ctx);
-        EC_POINT_add(group, D, VvPoint, negCvp, ctx);
-    }
-    CZarcECPointGuard lhsLink(group);
-    EC_POINT_mul(group, lhsLink, bnSLink, NULL, NULL, ctx);
-    CZarcECPointGuard rhsLink(group);
-    {
-        CZarcECPointGuard eD(group);
-        EC_POINT_mul(group, eD, NULL, D, bnELink, ctx);
-        EC_POINT_add(group, rhsLink, RLink, eD, ctx);
-    }
-    if (EC_POINT_cmp(group, lhsLink, rhsLink, ctx) != 0)
+    if (!VerifyNullStakeLinkEquation(group, ctx, bnOrder, bnSLink, RLink, bnELink,
+                                     proof.valueCommitment, cvPlain))
     {
         if (fDebug) printf("VerifyNullStakeMofNKernelProofV3: link proof failed\n");
         return false;
@@ -1760,29 +1749,8 @@ static bool VerifyNullStakeB2CHiddenKernelProofV3(const CNullStakeKernelProofV3&
     BN_mod(bnELink, bnELink, bnOrder, ctx);
     if (BN_is_zero(bnELink))
         return false;
-    CZarcECPointGuard Dpt(group);
-    {
-        CZarcECPointGuard VvPoint(group), cvpPoint(group);
-        if (!EC_POINT_oct2point(group, VvPoint, proof.valueCommitment.vchCommitment.data(),
-                                proof.valueCommitment.vchCommitment.size(), ctx))
-            return false;
-        if (!EC_POINT_oct2point(group, cvpPoint, cvPlain.vchCommitment.data(),
-                                cvPlain.vchCommitment.size(), ctx))
-            return false;
-        CZarcECPointGuard negCvp(group);
-        EC_POINT_copy(negCvp, cvpPoint);
-        EC_POINT_invert(group, negCvp, ctx);
-        EC_POINT_add(group, Dpt, VvPoint, negCvp, ctx);
-    }
-    CZarcECPointGuard lhsLink(group);
-    EC_POINT_mul(group, lhsLink, bnSLink, NULL, NULL, ctx);
-    CZarcECPointGuard rhsLink(group);
-    {
-        CZarcECPointGuard eD(group);
-        EC_POINT_mul(group, eD, NULL, Dpt, bnELink, ctx);
-        EC_POINT_add(group, rhsLink, RLink, eD, ctx);
-    }
-    if (EC_POINT_cmp(group, lhsLink, rhsLink, ctx) != 0)
+    if (!VerifyNullStakeLinkEquation(group, ctx, bnOrder, bnSLink, RLink, bnELink,
+                                     proof.valueCommitment, cvPlain))
     {
         if (fDebug) printf("VerifyNullStakeB2CHiddenKernelProofV3: link proof failed\n");
         return false;
@@ -1935,33 +1903,8 @@ static bool VerifyNullStakeKernelProofV3Uncached(const CNullStakeKernelProofV3&
     if (BN_is_zero(bnELink))
         return false;
 
-    CZarcECPointGuard D(group);
-    {
-        CZarcECPointGuard VvPoint(group), cvPoint(group);
-        if (!EC_POINT_oct2point(group, VvPoint, proof.valueCommitment.vchCommitment.data(),
-                                proof.valueCommitment.vchCommitment.size(), ctx))
-            return false;
-        if (!EC_POINT_oct2point(group, cvPoint, cv.vchCommitment.data(),
-                                cv.vchCommitment.size(), ctx))
-            return false;
-
-        CZarcECPointGuard negCv(group);
-        EC_POINT_copy(negCv, cvPoint);
-        EC_POINT_invert(group, negCv, ctx);
-        EC_POINT_add(group, D, VvPoint, negCv, ctx);
-    }
-
-    CZarcECPointGuard lhsLink(group);
-    EC_POINT_mul(group, lhsLink, bnSLink, NULL, NULL, ctx);
-
-    CZarcECPointGuard rhsLink(group);
-    {
-        CZarcECPointGuard eD(group);
-        EC_POINT_mul(group, eD, NULL, D, bnELink, ctx);
-        EC_POINT_add(group, rhsLink, RLink, eD, ctx);
-    }
-
-    if (EC_POINT_cmp(group, lhsLink, rhsLink, ctx) != 0)
+    if (!VerifyNullStakeLinkEquation(group, ctx, bnOrder, bnSLink, RLink, bnELink,
+                                     proof.valueCommitment, cv))
     {
         if (fDebug)
             printf("VerifyNullStakeKernelProofV3: linking proof failed\n");
@@ -2361,24 +2304,23 @@ static bool NullStakeB2CComputeProofCommitments(const std::vector<std::vector<un
         if (!NullStakeB2CBytesToPoint(group, vStakerSet[i], member, ctx))
             return false;
 
-        CZarcECPointGuard zG(group), cP(group), A(group);
-        if (EC_POINT_mul(group, zG, z, NULL, NULL, ctx) != 1)
-            return false;
-        if (EC_POINT_mul(group, cP, NULL, member, c, ctx) != 1)
-            return false;
-        if (EC_POINT_invert(group, cP, ctx) != 1)
-            return false;
-        if (EC_POINT_add(group, A, zG, cP, ctx) != 1)
-            return false;
-
-        CZarcECPointGuard zH(group), cT(group), B(group);
-        if (EC_POINT_mul(group, zH, NULL, tagBase, z, ctx) != 1)
-            return false;
-        if (EC_POINT_mul(group, cT, NULL, tag, c, ctx) != 1)
+        // A = z*G - c*P and B = z*H - c*T, each one two-term multiplication
+        CNullStakeBNGuard negC;
+        if (!BN_mod_sub(negC, order, c, order, ctx))
             return false;
-        if (EC_POINT_invert(group, cT, ctx) != 1)
+        std::vector<BIGNUM*> vScalar;
+        vScalar.push_back(z);
+        vScalar.push_back(negC);
+
+        CZarcECPointGuard A(group), B(group);
+        std::vector<EC_POINT*> vPoint;
+        vPoint.push_back(NullStakeGenerator(group));
+        vPoint.push_back(member);
+        if (!MultiScalarMul(group, ctx, vPoint, vScalar, A))
             return false;
-        if (EC_POINT_add(group, B, zH, cT, ctx) != 1)
+        vPoint[0] = const_cast<EC_POINT*>(tagBase);
+        vPoint[1] = const_cast<EC_POINT*>(tag);
+        if (!MultiScalarMul(group, ctx, vPoint, vScalar, B))
             return false;
 
         std::vector<unsigned char> aBytes, bBytes;
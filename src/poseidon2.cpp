@@ -290,6 +290,8 @@ void CPoseidon2Params::GenerateInternalDiag()
 }
 
 
+static void MontInitTables();
+
 bool CPoseidon2Params::Initialize()
 {
     static std::once_flag initFlag;
@@ -301,6 +303,7 @@ bool CPoseidon2Params::Initialize()
         GenerateRoundConstants();
         GenerateMDSMatrix();
         GenerateInternalDiag();
+        MontInitTables();
 
         fInitialized = true;
     });
@@ -334,6 +337,267 @@ const uint256& CPoseidon2Params::GetFieldOrder()
 
 
 
+// Montgomery backend for the permutation. Elements are four little-endian
+// 64-bit limbs, kept in Montgomery form (a * 2^256 mod n) from the first
+// round-constant addition to the last MDS multiply, so a whole permutation
+// runs without a single BIGNUM allocation or byte-order conversion. All
+// reductions are branch-free masked selects so timing does not depend on
+// the (stake-modifier derived) state.
+
+struct CFieldMont
+{
+    uint64_t d[4];
+};
+
+static const uint64_t MONT_N[4] = {
+    0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL,
+    0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL
+};
+
+// -n^-1 mod 2^64
+static uint64_t MontComputeN0Inv()
+{
+    uint64_t inv = 1;
+    for (int i = 0; i < 6; i++)
+        inv *= 2 - MONT_N[0] * inv;
+    return (uint64_t)0 - inv;
+}
+
+static const uint64_t MONT_N0INV = MontComputeN0Inv();
+
+// lo + hi * 2^64 = a * b + c + d; this never overflows 128 bits.
+static inline uint64_t MontMulAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t& hi)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 t = (unsigned __int128)a * b + c + d;
+    hi = (uint64_t)(t >> 64);
+    return (uint64_t)t;
+#else
+    uint64_t aLo = (uint32_t)a, aHi = a >> 32;
+    uint64_t bLo = (uint32_t)b, bHi = b >> 32;
+    uint64_t p0 = aLo * bLo, p1 = aLo * bHi, p2 = aHi * bLo, p3 = aHi * bHi;
+    uint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+    uint64_t lo = (mid << 32) | (uint32_t)p0;
+    hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+    lo += c;
+    hi += (lo < c);
+    lo += d;
+    hi += (lo < d);
+    return lo;
+#endif
+}
+
+static inline uint64_t MontAddCarry(uint64_t a, uint64_t b, uint64_t& carry)
+{
+    uint64_t t = a + carry;
+    uint64_t c1 = (t < carry);
+    uint64_t r = t + b;
+    carry = c1 | (r < b);
+    return r;
+}
+
+static inline uint64_t MontSubBorrow(uint64_t a, uint64_t b, uint64_t& borrow)
+{
+    uint64_t t = a - b;
+    uint64_t b1 = (a < b);
+    uint64_t r = t - borrow;
+    borrow = b1 | (t < borrow);
+    return r;
+}
+
+static CFieldMont montR2;
+static CFieldMont montRoundConstants[POSEIDON2_NUM_RC];
+static CFieldMont montMDS[POSEIDON2_T][POSEIDON2_T];
+static CFieldMont montInternalDiag[POSEIDON2_T];
+
+// r = t - n if (carry || t >= n) else t, for t < 2n held as carry:t.
+static inline void MontCondSubN(CFieldMont& r, const uint64_t t[4], uint64_t carry)
+{
+    uint64_t s[4];
+    uint64_t borrow = 0;
+    for (int i = 0; i < 4; i++)
+        s[i] = MontSubBorrow(t[i], MONT_N[i], borrow);
+    // Keep t only when there was no carry out and the subtraction borrowed.
+    uint64_t maskKeep = (uint64_t)0 - ((borrow & ~carry) & 1);
+    for (int i = 0; i < 4; i++)
+        r.d[i] = (t[i] & maskKeep) | (s[i] & ~maskKeep);
+}
+
+static inline void MontAdd(CFieldMont& r, const CFieldMont& a, const CFieldMont& b)
+{
+    uint64_t t[4];
+    uint64_t carry = 0;
+    for (int i = 0; i < 4; i++)
+        t[i] = MontAddCarry(a.d[i], b.d[i], carry);
+    MontCondSubN(r, t, carry);
+}
+
+// Coarsely integrated operand scanning; inputs < n give an output < n.
+static inline void MontMul(CFieldMont& r, const CFieldMont& a, const CFieldMont& b)
+{
+    uint64_t t[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 4; i++)
+    {
+        uint64_t carry = 0;
+        for (int j = 0; j < 4; j++)
+            t[j] = MontMulAdd(a.d[j], b.d[i], t[j], carry, carry);
+        uint64_t c = 0;
+        t[4] = MontAddCarry(t[4], carry, c);
+        t[5] = c;
+
+        uint64_t m = t[0] * MONT_N0INV;
+        MontMulAdd(m, MONT_N[0], t[0], 0, carry);
+        for (int j = 1; j < 4; j++)
+            t[j - 1] = MontMulAdd(m, MONT_N[j], t[j], carry, carry);
+        c = 0;
+        t[3] = MontAddCarry(t[4], carry, c);
+        t[4] = t[5] + c;
+    }
+    MontCondSubN(r, t, t[4]);
+}
+
+static inline void MontPow5(CFieldMont& r, const CFieldMont& a)
+{
+    CFieldMont x2, x4;
+    MontMul(x2, a, a);
+    MontMul(x4, x2, x2);
+    MontMul(r, x4, a);
+}
+
+// Canonical limbs from a little-endian uint256, reduced once: any 256-bit
+// value is below 2n, matching BN_nnmod on the same input.
+static void MontLimbsFromUint256(CFieldMont& r, const uint256& val)
+{
+    const unsigned char* p = val.begin();
+    uint64_t t[4];
+    for (int i = 0; i < 4; i++)
+    {
+        t[i] = 0;
+        for (int j = 7; j >= 0; j--)
+            t[i] = (t[i] << 8) | p[8 * i + j];
+    }
+    MontCondSubN(r, t, 0);
+}
+
+static void MontLimbsToUint256(const CFieldMont& a, uint256& val)
+{
+    unsigned char* p = val.begin();
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 8; j++)
+            p[8 * i + j] = (unsigned char)(a.d[i] >> (8 * j));
+}
+
+static void MontFromUint256(CFieldMont& r, const uint256& val)
+{
+    CFieldMont a;
+    MontLimbsFromUint256(a, val);
+    MontMul(r, a, montR2);
+}
+
+static void MontToUint256(const CFieldMont& a, uint256& val)
+{
+    CFieldMont one, r;
+    one.d[0] = 1; one.d[1] = 0; one.d[2] = 0; one.d[3] = 0;
+    MontMul(r, a, one);
+    MontLimbsToUint256(r, val);
+}
+
+static void MontInitTables()
+{
+    // R mod n = 2^256 - n; double it 256 more times to get R^2 mod n.
+    uint64_t t[4];
+    uint64_t borrow = 0;
+    for (int i = 0; i < 4; i++)
+        t[i] = MontSubBorrow(0, MONT_N[i], borrow);
+    memcpy(montR2.d, t, sizeof(t));
+    for (int i = 0; i < 256; i++)
+        MontAdd(montR2, montR2, montR2);
+
+    const std::vector<uint256>& rc = CPoseidon2Params::GetRoundConstants();
+    for (int i = 0; i < POSEIDON2_NUM_RC; i++)
+        MontFromUint256(montRoundConstants[i], rc[i]);
+
+    const std::vector<std::vector<uint256>>& M = CPoseidon2Params::GetMDSMatrix();
+    for (int i = 0; i < POSEIDON2_T; i++)
+        for (int j = 0; j < POSEIDON2_T; j++)
+            MontFromUint256(montMDS[i][j], M[i][j]);
+
+    const std::vector<uint256>& diag = CPoseidon2Params::GetInternalDiag();
+    for (int i = 0; i < POSEIDON2_T; i++)
+        MontFromUint256(montInternalDiag[i], diag[i]);
+}
+
+static void MontApplyMDS(CFieldMont state[POSEIDON2_T])
+{
+    CFieldMont newState[POSEIDON2_T];
+    for (int i = 0; i < POSEIDON2_T; i++)
+    {
+        MontMul(newState[i], montMDS[i][0], state[0]);
+        for (int j = 1; j < POSEIDON2_T; j++)
+        {
+            CFieldMont prod;
+            MontMul(prod, montMDS[i][j], state[j]);
+            MontAdd(newState[i], newState[i], prod);
+        }
+    }
+    for (int i = 0; i < POSEIDON2_T; i++)
+        state[i] = newState[i];
+}
+
+static void MontApplyInternalLinear(CFieldMont state[POSEIDON2_T])
+{
+    CFieldMont stateSum = state[0];
+    for (int i = 1; i < POSEIDON2_T; i++)
+        MontAdd(stateSum, stateSum, state[i]);
+
+    for (int i = 0; i < POSEIDON2_T; i++)
+    {
+        CFieldMont diagProduct;
+        MontMul(diagProduct, montInternalDiag[i], state[i]);
+        MontAdd(state[i], diagProduct, stateSum);
+    }
+}
+
+static void MontFullRound(CFieldMont state[POSEIDON2_T], int& rcIdx)
+{
+    for (int i = 0; i < POSEIDON2_T; i++)
+    {
+        MontAdd(state[i], state[i], montRoundConstants[rcIdx++]);
+        MontPow5(state[i], state[i]);
+    }
+    MontApplyMDS(state);
+}
+
+void Poseidon2Permute(CPoseidon2State& state)
+{
+    if (!CPoseidon2Params::IsInitialized())
+        CPoseidon2Params::Initialize();
+
+    CFieldMont s[POSEIDON2_T];
+    for (int i = 0; i < POSEIDON2_T; i++)
+        MontFromUint256(s[i], state.GetElement(i));
+
+    int rcIdx = 0;
+    for (int r = 0; r < POSEIDON2_RF / 2; r++)
+        MontFullRound(s, rcIdx);
+
+    for (int r = 0; r < POSEIDON2_RP; r++)
+    {
+        MontAdd(s[0], s[0], montRoundConstants[rcIdx++]);
+        MontPow5(s[0], s[0]);
+        MontApplyInternalLinear(s);
+    }
+
+    for (int r = 0; r < POSEIDON2_RF / 2; r++)
+        MontFullRound(s, rcIdx);
+
+    for (int i = 0; i < POSEIDON2_T; i++)
+        MontToUint256(s[i], state.elements[i]);
+}
+
+
+// BIGNUM reference permutation, built from the public Field* helpers. Kept so
+// tests can check the Montgomery path against it bit for bit.
 static void ApplyMDS(CPoseidon2State& state)
 {
     const std::vector<std::vector<uint256>>& M = CPoseidon2Params::GetMDSMatrix();
@@ -368,7 +632,7 @@ static void ApplyInternalLinear(CPoseidon2State& state)
     }
 }
 
-void Poseidon2Permute(CPoseidon2State& state)
+void Poseidon2PermuteReference(CPoseidon2State& state)
 {
     if (!CPoseidon2Params::IsInitialized())
         CPoseidon2Params::Initialize();
@@ -67,8 +67,13 @@ private:
 };
 
 
+// Runs the permutation on 4x64-bit Montgomery limbs; inputs need not be reduced.
 void Poseidon2Permute(CPoseidon2State& state);
 
+// Same permutation evaluated with the BIGNUM Field* helpers. Slow; used by the
+// tests to pin the Montgomery path to the original arithmetic.
+void Poseidon2PermuteReference(CPoseidon2State& state);
+
 void Poseidon2Hash(const uint256 inputs[6], uint256& output);
 
 uint256 Poseidon2KernelHash(uint64_t nStakeModifier,
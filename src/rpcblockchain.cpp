@@ -9,6 +9,8 @@
 #include "txdb.h"
 #include "bootstrap.h"
 #include "finality.h"
+#include "finalityverify.h"
+#include "txcache.h"
 #include "dag.h"
 #include "base58.h"
 #include "net.h"
@@ -970,6 +972,7 @@ Value getblockchaininfo(const Array& params, bool fHelp)
                 "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
                 "  \"initialblockdownload\": xxxx, (bool) estimate of whether this INN node is in Initial Block Download mode.\n"
                 "  \"moneysupply\": xxxx, (numeric) the current supply of INN in circulation\n"
+                "  \"txcache\": {...},     (object) txindex/transaction cache size and hit counters\n"
                 "}\n"
         );
 
@@ -991,6 +994,31 @@ Value getblockchaininfo(const Array& params, bool fHelp)
     obj.push_back(Pair("initialblockdownload",  IsInitialBlockDownload()));
     obj.push_back(Pair("moneysupply",   ValueFromAmount(pindexBest->nMoneySupply)));
     //obj.push_back(Pair("size_on_disk",   CalculateCurrentUsage()));
+
+    CTxCacheStats cacheStats;
+    g_txCache.GetStats(cacheStats);
+    Object txcache;
+    txcache.push_back(Pair("index_entries", (int)cacheStats.nIndexEntries));
+    txcache.push_back(Pair("tx_entries",    (int)cacheStats.nTxEntries));
+    txcache.push_back(Pair("bytes",         (int64_t)cacheStats.nBytes));
+    txcache.push_back(Pair("max_bytes",     (int64_t)cacheStats.nMaxBytes));
+    txcache.push_back(Pair("index_hits",    (int64_t)cacheStats.nIndexHits));
+    txcache.push_back(Pair("index_misses",  (int64_t)cacheStats.nIndexMisses));
+    txcache.push_back(Pair("tx_hits",       (int64_t)cacheStats.nTxHits));
+    txcache.push_back(Pair("tx_misses",     (int64_t)cacheStats.nTxMisses));
+    txcache.push_back(Pair("evictions",     (int64_t)cacheStats.nEvictions));
+    obj.push_back(Pair("txcache", txcache));
+
+    CRawBlockCacheStats rawStats;
+    g_rawBlockCache.GetStats(rawStats);
+    Object rawblockcache;
+    rawblockcache.push_back(Pair("entries",   (int)rawStats.nEntries));
+    rawblockcache.push_back(Pair("bytes",     (int64_t)rawStats.nBytes));
+    rawblockcache.push_back(Pair("max_bytes", (int64_t)rawStats.nMaxBytes));
+    rawblockcache.push_back(Pair("hits",      (int64_t)rawStats.nHits));
+    rawblockcache.push_back(Pair("misses",    (int64_t)rawStats.nMisses));
+    rawblockcache.push_back(Pair("evictions", (int64_t)rawStats.nEvictions));
+    obj.push_back(Pair("rawblockcache", rawblockcache));
     return obj;
 }
 
@@ -1389,6 +1417,29 @@ Value getfinalityinfo(const Array& params, bool fHelp)
     result.push_back(Pair("min_voters", FINALITY_MIN_VOTERS));
     result.push_back(Pair("fork_active", nCurrentHeight >= FORK_HEIGHT_FINALITY));
 
+    CFinalityVerifyStats verifyStats;
+    g_finalityVerifyQueue.GetStats(verifyStats);
+    Object verifyObj;
+    verifyObj.push_back(Pair("threads", verifyStats.nThreads));
+    verifyObj.push_back(Pair("running", verifyStats.nRunning));
+    verifyObj.push_back(Pair("queue_depth", (int)verifyStats.nQueueDepth));
+    verifyObj.push_back(Pair("in_flight", (int)verifyStats.nInFlight));
+    verifyObj.push_back(Pair("peak_queue_depth", (int)verifyStats.nPeakQueueDepth));
+    verifyObj.push_back(Pair("deferred_tally_shares", (int)verifyStats.nDeferredShares));
+    verifyObj.push_back(Pair("queued", (uint64_t)verifyStats.nQueued));
+    verifyObj.push_back(Pair("duplicates", (uint64_t)verifyStats.nDuplicates));
+    verifyObj.push_back(Pair("overflows", (uint64_t)verifyStats.nOverflows));
+    verifyObj.push_back(Pair("accepted", (uint64_t)verifyStats.nAccepted));
+    verifyObj.push_back(Pair("rejected", (uint64_t)verifyStats.nRejected));
+    verifyObj.push_back(Pair("batches", (uint64_t)verifyStats.nBatches));
+    verifyObj.push_back(Pair("fcmp_batched", (uint64_t)verifyStats.nFCMPBatched));
+    uint64_t nDone = verifyStats.nAccepted + verifyStats.nRejected;
+    verifyObj.push_back(Pair("last_latency_ms", verifyStats.nLastLatencyUs / 1000.0));
+    verifyObj.push_back(Pair("avg_latency_ms", nDone ? verifyStats.nTotalLatencyUs / 1000.0 / nDone : 0.0));
+    verifyObj.push_back(Pair("max_latency_ms", verifyStats.nMaxLatencyUs / 1000.0));
+    verifyObj.push_back(Pair("avg_batch_verify_ms", verifyStats.nBatches ? verifyStats.nTotalVerifyUs / 1000.0 / verifyStats.nBatches : 0.0));
+    result.push_back(Pair("verify_queue", verifyObj));
+
     return result;
 }
 
@@ -1723,6 +1774,7 @@ Value getdaginfo(const Array& params, bool fHelp)
     int nCurrentEpoch = GetEpochForHeight(nCurrentHeight);
     result.push_back(Pair("current_epoch", nCurrentEpoch));
     result.push_back(Pair("dag_entries", g_dagManager.GetDAGEntryCount()));
+    result.push_back(Pair("dag_memory_bytes", (int64_t)g_dagManager.GetDAGMemoryUsage()));
     int nPrunedBelow = g_dagManager.GetPrunedBelowHeight();
     result.push_back(Pair("pruned_below", nPrunedBelow));
     result.push_back(Pair("finality_tier", FinalityTierName(g_finalityTracker.GetFinalityTier())));
@@ -80,6 +80,8 @@ Value getmininginfo(const Array& params, bool fHelp)
     obj.push_back(Pair("netstakeweight", GetPoSKernelPS()));
     obj.push_back(Pair("errors",        GetWarnings("statusbar")));
     obj.push_back(Pair("pooledtx",      (uint64_t)mempool.size()));
+    obj.push_back(Pair("pooledbytes",   (uint64_t)mempool.GetTotalMemoryUsage()));
+    obj.push_back(Pair("poolminfeerate", mempool.GetMinFeeRate() * 1000 / COIN));
 
     weight.push_back(Pair("minimum",    (uint64_t)nMinWeight));
     weight.push_back(Pair("maximum",    (uint64_t)nMaxWeight));
@@ -379,6 +379,51 @@ Value getnettotals(const Array& params, bool fHelp)
     return obj;
 }
 
+static Object MessageLatencyHistogram(const uint64_t* vBuckets)
+{
+    Object hist;
+    for (int i = 0; i < MESSAGE_LATENCY_BUCKETS; i++)
+    {
+        if (vBuckets[i] == 0)
+            continue;
+        if (i == MESSAGE_LATENCY_BUCKETS - 1)
+            hist.push_back(Pair(strprintf(">=%" PRId64"us", (int64_t)1 << (i - 1)), (boost::uint64_t)vBuckets[i]));
+        else
+            hist.push_back(Pair(strprintf("<%" PRId64"us", (int64_t)1 << i), (boost::uint64_t)vBuckets[i]));
+    }
+    return hist;
+}
+
+Value getmsglatency(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+                "getmsglatency [reset]\n"
+                "Returns per-command message processing latency since startup or the last reset.\n"
+                "\"queue\" is the time from a message's last byte arriving to the start of its\n"
+                "processing, \"process\" the time spent processing it. Histogram buckets are\n"
+                "powers of two microseconds. If [reset] is true the counters are cleared.");
+
+    bool fReset = params.size() > 0 && params[0].get_bool();
+    map<string, CMessageLatency> mapStats = GetMessageLatencyStats(fReset);
+
+    Object ret;
+    for (map<string, CMessageLatency>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it)
+    {
+        const CMessageLatency& stats = it->second;
+        Object obj;
+        obj.push_back(Pair("count", (boost::uint64_t)stats.nCount));
+        obj.push_back(Pair("queue_avg_us", stats.nCount ? stats.nQueueTotal / (int64_t)stats.nCount : 0));
+        obj.push_back(Pair("queue_max_us", stats.nQueueMax));
+        obj.push_back(Pair("process_avg_us", stats.nCount ? stats.nProcessTotal / (int64_t)stats.nCount : 0));
+        obj.push_back(Pair("process_max_us", stats.nProcessMax));
+        obj.push_back(Pair("queue", MessageLatencyHistogram(stats.vQueue)));
+        obj.push_back(Pair("process", MessageLatencyHistogram(stats.vProcess)));
+        ret.push_back(Pair(it->first, obj));
+    }
+    return ret;
+}
+
 Value setdebug(const Array& params, bool fHelp)
 {
     string strType;
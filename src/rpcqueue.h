@@ -0,0 +1,192 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_RPCQUEUE_H
+#define INNOVA_RPCQUEUE_H
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+/** Work queue for the RPC server's fixed pool of worker threads.
+  *
+  * Accepted connections are queued with Enqueue(), which refuses work once
+  * nMaxDepth items are waiting so the listener can turn the client away
+  * instead of piling up threads. Pieces of a request that is already being
+  * served (the entries of a JSON-RPC batch) go through ParallelFor(); they
+  * skip ahead of queued connections and are never refused, and the calling
+  * worker runs whatever the others have not picked up, so a batch finishes
+  * even when every other worker is busy.
+  */
+class CRPCWorkQueue
+{
+public:
+    typedef std::function<void()> Job;
+
+    explicit CRPCWorkQueue(int nMaxDepthIn) :
+        nMaxDepth(std::max(nMaxDepthIn, 1)), nThreads(0), nIdle(0),
+        nPeakDepth(0), nRejected(0), fQuit(false) {}
+
+    /** Queue a job for the next free worker; false if the queue is full. */
+    bool Enqueue(const Job& job)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (fQuit || (int)queue.size() >= nMaxDepth)
+        {
+            nRejected++;
+            return false;
+        }
+        queue.push_back(job);
+        nPeakDepth = std::max(nPeakDepth, (int)queue.size());
+        cond.notify_one();
+        return true;
+    }
+
+    /** Run fn(0) .. fn(nItems - 1), spread over the idle workers and the
+      * calling thread. Returns when every call has finished; fn must not
+      * throw. */
+    void ParallelFor(unsigned int nItems, const std::function<void(unsigned int)>& fn)
+    {
+        std::shared_ptr<CParallelFor> state(new CParallelFor(nItems, fn));
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            int nHelpers = std::min((int)nItems - 1, nIdle - (int)helpers.size());
+            for (int i = 0; i < nHelpers && !fQuit; i++)
+                helpers.push_back(std::bind(&CParallelFor::Run, state));
+            if (nHelpers > 0)
+                cond.notify_all();
+        }
+        state->Run();
+        boost::unique_lock<boost::mutex> lock(state->mutex);
+        while (state->nDone < state->nItems)
+            state->cond.wait(lock);
+    }
+
+    /** Worker thread body: runs jobs until Interrupt() and an empty queue. */
+    void Run()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nThreads++;
+        while (true)
+        {
+            while (helpers.empty() && queue.empty() && !fQuit)
+            {
+                nIdle++;
+                cond.wait(lock);
+                nIdle--;
+            }
+            Job job;
+            if (!helpers.empty())
+            {
+                job.swap(helpers.front());
+                helpers.pop_front();
+            }
+            else if (!queue.empty())
+            {
+                job.swap(queue.front());
+                queue.pop_front();
+            }
+            else
+                break;
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+        nThreads--;
+    }
+
+    /** Let workers exit once the queued jobs have run; refuse new ones. */
+    void Interrupt()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fQuit = true;
+        cond.notify_all();
+    }
+
+    /** Connections waiting for a worker. */
+    int Depth()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        return queue.size();
+    }
+
+    struct Stats
+    {
+        int nThreads;
+        int nIdle;
+        int nDepth;
+        int nMaxDepth;
+        int nPeakDepth;
+        int64_t nRejected;
+    };
+
+    Stats GetStats(bool fReset = false)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        Stats stats;
+        stats.nThreads = nThreads;
+        stats.nIdle = nIdle;
+        stats.nDepth = queue.size();
+        stats.nMaxDepth = nMaxDepth;
+        stats.nPeakDepth = nPeakDepth;
+        stats.nRejected = nRejected;
+        if (fReset)
+        {
+            nPeakDepth = queue.size();
+            nRejected = 0;
+        }
+        return stats;
+    }
+
+private:
+    CRPCWorkQueue(const CRPCWorkQueue&);
+    void operator=(const CRPCWorkQueue&);
+
+    // Shared between a ParallelFor() caller and its helpers; a helper that
+    // starts after the caller has returned finds nothing left to claim.
+    struct CParallelFor
+    {
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        const unsigned int nItems;
+        const std::function<void(unsigned int)> fn;
+        unsigned int nNext;
+        unsigned int nDone;
+
+        CParallelFor(unsigned int nItemsIn, const std::function<void(unsigned int)>& fnIn) :
+            nItems(nItemsIn), fn(fnIn), nNext(0), nDone(0) {}
+
+        void Run()
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (nNext < nItems)
+            {
+                unsigned int n = nNext++;
+                lock.unlock();
+                fn(n);
+                lock.lock();
+                if (++nDone == nItems)
+                    cond.notify_all();
+            }
+        }
+    };
+
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<Job> queue;
+    std::deque<Job> helpers;
+    const int nMaxDepth;
+    int nThreads;
+    int nIdle;
+    int nPeakDepth;
+    int64_t nRejected;
+    bool fQuit;
+};
+
+#endif
@@ -452,6 +452,7 @@ Value signrawtransaction(const Array& params, bool fHelp)
     // mergedTx will end up with all the signatures; it
     // starts as a clone of the rawtx:
     CTransaction mergedTx(txVariants[0]);
+    mergedTx.ClearHashCache();
     bool fComplete = true;
 
     // Fetch previous transactions (inputs):
@@ -735,10 +736,6 @@ Value searchrawtransactions(const Array &params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Bitcoin address");
     CTxDestination dest = address.Get();
 
-    std::vector<uint256> vtxhash;
-    if (!FindTransactionsByDestination(dest, vtxhash))
-        throw JSONRPCError(RPC_DATABASE_ERROR, "Cannot search for address");
-
     int nSkip = 0;
     int nCount = 100;
     bool fVerbose = true;
@@ -749,18 +746,15 @@ Value searchrawtransactions(const Array &params, bool fHelp)
     if (params.size() > 3)
         nCount = params[3].get_int();
 
-    if (nSkip < 0)
-        nSkip += vtxhash.size();
-    if (nSkip < 0)
-        nSkip = 0;
-    if (nCount < 0)
-        nCount = 0;
+    // Only the requested page is read from the index
+    std::vector<uint256> vtxhash;
+    unsigned int nTotal;
+    if (!FindTransactionsByDestination(dest, vtxhash, nSkip, nCount, nTotal))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Cannot search for address");
 
     std::vector<uint256>::const_iterator it = vtxhash.begin();
-    while (it != vtxhash.end() && nSkip--) it++;
-
     Array result;
-    while (it != vtxhash.end() && nCount--) {
+    while (it != vtxhash.end()) {
         CTransaction tx;
         uint256 hashBlock;
         if (!GetTransaction(*it, tx, hashBlock))
@@ -790,3 +784,28 @@ Value searchrawtransactions(const Array &params, bool fHelp)
     }
     return result;
 }
+
+Value getaddresssummary(const Array &params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddresssummary <address>\n"
+            "Returns the totals the address index keeps for <address> (requires -addrindex).");
+
+    CBitcoinAddress address(params[0].get_str());
+    if (!address.IsValid())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Bitcoin address");
+
+    CAddrSummary summary;
+    if (!GetAddressSummary(address.Get(), summary))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Cannot search for address");
+
+    Object result;
+    result.push_back(Pair("address", address.ToString()));
+    result.push_back(Pair("txcount", (int)summary.nTxCount));
+    result.push_back(Pair("received", ValueFromAmount(summary.nReceived)));
+    result.push_back(Pair("sent", ValueFromAmount(summary.nSent)));
+    result.push_back(Pair("balance", ValueFromAmount(summary.GetBalance())));
+    result.push_back(Pair("unspentoutputs", (int)summary.GetUnspentCount()));
+    return result;
+}
@@ -659,23 +659,20 @@ Value z_unshield(const Array& params, bool fHelp)
             }
             spend.anchor = tree.Root();
 
-            vector<CPedersenCommitment> vAllCommitments;
-            txdb.ReadAllShieldedCommitments(vAllCommitments);
+            CCommitmentPoolSnapshot vAllCommitments;
+            if (!g_commitmentPool.GetSnapshot(txdb, vAllCommitments))
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the shielded commitment pool");
 
             if (fDebug)
                 printf("z_unshield: pool has %d commitments\n", (int)vAllCommitments.size());
 
-            bool fFound = false;
-            int64_t nGlobalOutputIndex = -1;
-            for (size_t ci = 0; ci < vAllCommitments.size(); ci++)
-            {
-                if (vAllCommitments[ci] == spend.cv) { fFound = true; nGlobalOutputIndex = (int64_t)ci; break; }
-            }
+            int64_t nGlobalOutputIndex = g_commitmentPool.FindIndex(txdb, vAllCommitments, spend.cv);
+            bool fFound = (nGlobalOutputIndex >= 0);
             if (fDebug)
                 printf("z_unshield: spend cv found in pool: %s\n", fFound ? "YES" : "NO");
 
             CAnonymitySet anonSet;
-            if (!BuildAnonymitySet(spend.cv, vAllCommitments, spend.anchor,
+            if (!BuildAnonymitySet(spend.cv, nGlobalOutputIndex, vAllCommitments, spend.anchor,
                                     nCurrentHeight, anonSet))
                 throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to build Lelantus anonymity set");
 
@@ -1033,17 +1030,14 @@ Value z_send(const Array& params, bool fHelp)
                 txdb.ReadShieldedTree(tree);
             spend.anchor = tree.Root();
 
-            vector<CPedersenCommitment> vAllCommitments;
-            txdb.ReadAllShieldedCommitments(vAllCommitments);
+            CCommitmentPoolSnapshot vAllCommitments;
+            if (!g_commitmentPool.GetSnapshot(txdb, vAllCommitments))
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the shielded commitment pool");
 
-            int64_t nGlobalOutputIndex = -1;
-            for (size_t ci = 0; ci < vAllCommitments.size(); ci++)
-            {
-                if (vAllCommitments[ci] == spend.cv) { nGlobalOutputIndex = (int64_t)ci; break; }
-            }
+            int64_t nGlobalOutputIndex = g_commitmentPool.FindIndex(txdb, vAllCommitments, spend.cv);
 
             CAnonymitySet anonSet;
-            if (!BuildAnonymitySet(spend.cv, vAllCommitments, spend.anchor,
+            if (!BuildAnonymitySet(spend.cv, nGlobalOutputIndex, vAllCommitments, spend.anchor,
                                     nCurrentHeight, anonSet))
                 throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to build Lelantus anonymity set");
 
@@ -1084,12 +1078,10 @@ Value z_send(const Array& params, bool fHelp)
             int64_t nSerialIdx2 = -1;
             if (nCurrentHeight >= FORK_HEIGHT_SERIAL_V2)
             {
-                vector<CPedersenCommitment> vAllCmts;
-                txdb.ReadAllShieldedCommitments(vAllCmts);
-                for (size_t ci = 0; ci < vAllCmts.size(); ci++)
-                {
-                    if (vAllCmts[ci] == spend.cv) { nSerialIdx2 = (int64_t)ci; break; }
-                }
+                CCommitmentPoolSnapshot vAllCmts;
+                if (!g_commitmentPool.GetSnapshot(txdb, vAllCmts))
+                    throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the shielded commitment pool");
+                nSerialIdx2 = g_commitmentPool.FindIndex(txdb, vAllCmts, spend.cv);
             }
             spend.lelantusSerial = ComputeLelantusSerial(sk.skSpend, wnote.note.rho, spend.cv, nSerialIdx2);
         }
@@ -2045,17 +2037,14 @@ Value z_nullsend(const Array& params, bool fHelp)
                 txdb.ReadShieldedTree(tree);
             spend.anchor = tree.Root();
 
-            std::vector<CPedersenCommitment> vAllCommitments;
-            txdb.ReadAllShieldedCommitments(vAllCommitments);
+            CCommitmentPoolSnapshot vAllCommitments;
+            if (!g_commitmentPool.GetSnapshot(txdb, vAllCommitments))
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the shielded commitment pool");
 
-            int64_t nGlobalOutputIndex = -1;
-            for (size_t ci = 0; ci < vAllCommitments.size(); ci++)
-            {
-                if (vAllCommitments[ci] == spend.cv) { nGlobalOutputIndex = (int64_t)ci; break; }
-            }
+            int64_t nGlobalOutputIndex = g_commitmentPool.FindIndex(txdb, vAllCommitments, spend.cv);
 
             CAnonymitySet anonSet;
-            if (!BuildAnonymitySet(spend.cv, vAllCommitments, spend.anchor,
+            if (!BuildAnonymitySet(spend.cv, nGlobalOutputIndex, vAllCommitments, spend.anchor,
                                     nCurrentHeight, anonSet))
                 throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to build anonymity set");
 
@@ -2096,12 +2085,10 @@ Value z_nullsend(const Array& params, bool fHelp)
             int64_t nSerialIdx2 = -1;
             if (nCurrentHeight >= FORK_HEIGHT_SERIAL_V2)
             {
-                std::vector<CPedersenCommitment> vAllCmts;
-                txdb.ReadAllShieldedCommitments(vAllCmts);
-                for (size_t ci = 0; ci < vAllCmts.size(); ci++)
-                {
-                    if (vAllCmts[ci] == spend.cv) { nSerialIdx2 = (int64_t)ci; break; }
-                }
+                CCommitmentPoolSnapshot vAllCmts;
+                if (!g_commitmentPool.GetSnapshot(txdb, vAllCmts))
+                    throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the shielded commitment pool");
+                nSerialIdx2 = g_commitmentPool.FindIndex(txdb, vAllCmts, spend.cv);
             }
             spend.lelantusSerial = ComputeLelantusSerial(sk.skSpend, wnote.note.rho, spend.cv, nSerialIdx2);
         }
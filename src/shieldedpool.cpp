@@ -0,0 +1,119 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#include "shieldedpool.h"
+
+#include "txdb.h"
+#include "util.h"
+
+CCommitmentPool g_commitmentPool;
+
+void CCommitmentPoolSnapshot::GetRange(uint64_t nBegin, uint64_t nEnd, std::vector<CPedersenCommitment>& vOut) const
+{
+    vOut.clear();
+    if (nEnd > nSize)
+        nEnd = nSize;
+    if (nBegin >= nEnd)
+        return;
+    vOut.reserve(nEnd - nBegin);
+    for (uint64_t i = nBegin; i < nEnd; i++)
+        vOut.push_back((*this)[i]);
+}
+
+int64_t CCommitmentPoolSnapshot::Find(const CPedersenCommitment& cv) const
+{
+    for (uint64_t i = 0; i < nSize; i++)
+    {
+        if ((*this)[i] == cv)
+            return (int64_t)i;
+    }
+    return -1;
+}
+
+CCommitmentPool::CCommitmentPool() : fLoaded(false)
+{
+}
+
+void CCommitmentPool::Append(const std::vector<CPedersenCommitment>& vCommitments)
+{
+    size_t nNext = 0;
+    while (nNext < vCommitments.size())
+    {
+        unsigned int nOffset = pool.nSize % COMMITMENT_POOL_CHUNK_SIZE;
+        // A partly filled last chunk may be shared with a snapshot: extend a copy.
+        boost::shared_ptr<std::vector<CPedersenCommitment> > chunk(new std::vector<CPedersenCommitment>());
+        if (nOffset > 0)
+        {
+            *chunk = *pool.vChunks.back();
+            pool.vChunks.pop_back();
+        }
+        chunk->reserve(COMMITMENT_POOL_CHUNK_SIZE);
+        while (chunk->size() < COMMITMENT_POOL_CHUNK_SIZE && nNext < vCommitments.size())
+        {
+            chunk->push_back(vCommitments[nNext++]);
+            pool.nSize++;
+        }
+        pool.vChunks.push_back(chunk);
+    }
+}
+
+bool CCommitmentPool::GetSnapshot(CTxDB& txdb, CCommitmentPoolSnapshot& snapshot)
+{
+    LOCK(cs);
+    uint64_t nCount = 0;
+    if (!txdb.ReadShieldedCommitmentCount(nCount))
+        return false;
+
+    if (nCount < pool.nSize)
+        Truncate(nCount);
+    if (nCount > pool.nSize)
+    {
+        int64_t nStart = GetTimeMicros();
+        uint64_t nFrom = pool.nSize;
+        std::vector<CPedersenCommitment> vNew;
+        if (!txdb.ReadShieldedCommitments(nFrom, nCount, vNew))
+            return error("CCommitmentPool::GetSnapshot() : commitments %" PRIu64"..%" PRIu64" missing from txdb",
+                         nFrom, nCount);
+        Append(vNew);
+        if (!fLoaded || fDebug)
+            printf("CCommitmentPool: read commitments %" PRIu64"..%" PRIu64" in %" PRId64"us\n",
+                   nFrom, nCount, GetTimeMicros() - nStart);
+    }
+    fLoaded = true;
+    snapshot = pool;
+    return true;
+}
+
+int64_t CCommitmentPool::FindIndex(CTxDB& txdb, const CCommitmentPoolSnapshot& snapshot, const CPedersenCommitment& cv) const
+{
+    uint64_t nIndex = 0;
+    if (txdb.ReadShieldedCommitmentIndex(cv.vchCommitment, nIndex) &&
+        nIndex < snapshot.size() && snapshot[nIndex] == cv)
+        return (int64_t)nIndex;
+    // Genesis seeds have no index entry, and the entry can lag a reorg.
+    return snapshot.Find(cv);
+}
+
+void CCommitmentPool::Truncate(uint64_t nCount)
+{
+    LOCK(cs);
+    if (nCount >= pool.nSize)
+        return;
+    uint64_t nChunks = (nCount + COMMITMENT_POOL_CHUNK_SIZE - 1) / COMMITMENT_POOL_CHUNK_SIZE;
+    pool.vChunks.resize(nChunks);
+    unsigned int nOffset = nCount % COMMITMENT_POOL_CHUNK_SIZE;
+    if (nOffset > 0)
+    {
+        boost::shared_ptr<std::vector<CPedersenCommitment> > chunk(
+            new std::vector<CPedersenCommitment>(pool.vChunks.back()->begin(), pool.vChunks.back()->begin() + nOffset));
+        pool.vChunks.back() = chunk;
+    }
+    pool.nSize = nCount;
+}
+
+void CCommitmentPool::Clear()
+{
+    LOCK(cs);
+    pool = CCommitmentPoolSnapshot();
+    fLoaded = false;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_SHIELDEDPOOL_H
+#define INNOVA_SHIELDEDPOOL_H
+
+#include "sync.h"
+#include "zkproof.h"
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+class CTxDB;
+
+// In-memory copy of the shielded commitment pool: txdb entries 'sc' 0 ..
+// 'scc'-1, in pool order.
+//
+// Building a Lelantus anonymity set used to read every commitment from
+// LevelDB, one Get each, and then scan them for the spender's own note. The
+// pool is append-only between reorgs, so it is loaded once and afterwards
+// only the commitments added since the last use are read. Callers take an
+// immutable snapshot (chunks are shared, never modified once full) and index
+// it directly, so choosing decoys costs O(set size).
+//
+// LevelDB stays the only store; nothing here is written to disk. A write of
+// the commitment count drops the entries at and above it once the write has
+// committed (CTxDB calls Truncate()), and they are re-read on next use.
+
+static const unsigned int COMMITMENT_POOL_CHUNK_SIZE = 4096;
+
+class CCommitmentPoolSnapshot
+{
+public:
+    CCommitmentPoolSnapshot() : nSize(0) {}
+
+    uint64_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    const CPedersenCommitment& operator[](uint64_t nIndex) const
+    {
+        return (*vChunks[nIndex / COMMITMENT_POOL_CHUNK_SIZE])[nIndex % COMMITMENT_POOL_CHUNK_SIZE];
+    }
+
+    /** Copy the commitments in [nBegin, nEnd) to vOut. */
+    void GetRange(uint64_t nBegin, uint64_t nEnd, std::vector<CPedersenCommitment>& vOut) const;
+
+    /** Position of the first entry equal to cv, or -1. Linear; prefer
+     *  CCommitmentPool::FindIndex(). */
+    int64_t Find(const CPedersenCommitment& cv) const;
+
+private:
+    friend class CCommitmentPool;
+
+    std::vector<boost::shared_ptr<const std::vector<CPedersenCommitment> > > vChunks;
+    uint64_t nSize;
+};
+
+class CCommitmentPool
+{
+public:
+    CCommitmentPool();
+
+    /** Bring the copy up to date with txdb and return a snapshot of it. */
+    bool GetSnapshot(CTxDB& txdb, CCommitmentPoolSnapshot& snapshot);
+
+    /** Pool position of cv: the txdb 'sci' index, checked against the
+     *  snapshot, falling back to a scan of the snapshot. -1 if absent. */
+    int64_t FindIndex(CTxDB& txdb, const CCommitmentPoolSnapshot& snapshot, const CPedersenCommitment& cv) const;
+
+    /** The commitment count was rewritten: entries at or above nCount may
+     *  have changed. */
+    void Truncate(uint64_t nCount);
+
+    void Clear();
+
+private:
+    mutable CCriticalSection cs;
+    CCommitmentPoolSnapshot pool;
+    bool fLoaded;
+
+    void Append(const std::vector<CPedersenCommitment>& vCommitments);
+};
+
+extern CCommitmentPool g_commitmentPool;
+
+#endif // INNOVA_SHIELDEDPOOL_H
@@ -0,0 +1,80 @@
+// Tests for the address index layout: keys of one address share a prefix and
+// sort by height, so a range scan pages through the history in chain order,
+// and summaries return to nothing when every block is disconnected again.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../main.h"
+
+namespace
+{
+
+std::string KeyString(const CAddrIndexKey& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << std::make_pair(std::string("adx"), key);
+    return ss.str();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(addrindex_tests)
+
+BOOST_AUTO_TEST_CASE(key_order)
+{
+    uint160 addrA = 0x1234;
+    uint160 addrB = 0x1235;
+    int vHeight[] = { 0, 1, 255, 256, 65535, 65536, 1000000, 16777216, 0x7fffffff };
+    unsigned int nHeights = sizeof(vHeight) / sizeof(vHeight[0]);
+
+    CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+    ssPrefix << std::make_pair(std::string("adx"), addrA);
+    std::string strPrefix = ssPrefix.str();
+
+    for (unsigned int i = 0; i < nHeights; i++)
+    {
+        CAddrIndexKey key(addrA, vHeight[i], uint256(1000 - i));
+        std::string str = KeyString(key);
+        BOOST_CHECK_EQUAL(str.size(), strPrefix.size() + 4 + 32);
+        BOOST_CHECK(str.compare(0, strPrefix.size(), strPrefix) == 0);
+        BOOST_CHECK(KeyString(CAddrIndexKey(addrB, 0, 0)).compare(0, strPrefix.size(), strPrefix) != 0);
+
+        // Later heights sort after earlier ones whatever the tx hash
+        if (i > 0)
+            BOOST_CHECK(KeyString(CAddrIndexKey(addrA, vHeight[i - 1], ~uint256(0))) < str);
+
+        CDataStream ss(str.data(), str.data() + str.size(), SER_DISK, CLIENT_VERSION);
+        std::pair<std::string, CAddrIndexKey> keyPair;
+        ss >> keyPair;
+        BOOST_CHECK(keyPair.second.addrId == addrA);
+        BOOST_CHECK_EQUAL(keyPair.second.nHeight, vHeight[i]);
+        BOOST_CHECK(keyPair.second.hashTx == uint256(1000 - i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(summary_connect_disconnect)
+{
+    CAddrIndexDelta received;
+    received.nReceived = 50 * COIN;
+    received.nOutputs = 2;
+    CAddrIndexDelta spent;
+    spent.nSent = 30 * COIN;
+    spent.nSpent = 1;
+
+    CAddrSummary summary;
+    BOOST_CHECK(summary.IsNull());
+    summary.Apply(received, 1, true);
+    summary.Apply(spent, 1, true);
+    BOOST_CHECK_EQUAL(summary.nTxCount, 2U);
+    BOOST_CHECK_EQUAL(summary.GetBalance(), 20 * COIN);
+    BOOST_CHECK_EQUAL(summary.GetUnspentCount(), 1U);
+
+    CAddrIndexDelta total = received;
+    total += spent;
+    summary.Apply(total, 2, false);
+    BOOST_CHECK(summary.IsNull());
+    BOOST_CHECK_EQUAL(summary.GetBalance(), 0);
+    BOOST_CHECK_EQUAL(summary.GetUnspentCount(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
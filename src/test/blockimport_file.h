@@ -0,0 +1,89 @@
+// Block files for the import tests and benchmark: synthetic blocks, a temporary
+// file holding them in blk*.dat framing, and an import that collects the
+// hashes of what it hands out.
+#ifndef INNOVA_TEST_BLOCKIMPORT_FILE_H
+#define INNOVA_TEST_BLOCKIMPORT_FILE_H
+
+#include "../blockimport.h"
+#include "../util.h"
+
+#include <boost/filesystem.hpp>
+
+inline CBlock MakeBlock(int n, int nTxs, int nPad = 0)
+{
+    CBlock block;
+    block.nTime = 1500000000 + n;
+    block.nBits = 0x1e0fffff;
+    block.nNonce = n;
+    block.hashPrevBlock = n;
+    for (int i = 0; i < nTxs; i++)
+    {
+        CTransaction tx;
+        tx.nTime = block.nTime;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << n << i;
+        if (nPad)
+            tx.vin[0].scriptSig << std::vector<unsigned char>(nPad, 0x01);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block.vtx.push_back(tx);
+    }
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    block.UpdateHash();
+    return block;
+}
+
+struct CBlockFile
+{
+    boost::filesystem::path path;
+    CDataStream ss;
+
+    CBlockFile() : ss(SER_DISK, CLIENT_VERSION)
+    {
+        path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("blockimport-%%%%%%%%.dat");
+    }
+
+    ~CBlockFile()
+    {
+        boost::filesystem::remove(path);
+    }
+
+    void Add(const CBlock& block)
+    {
+        ss << FLATDATA(pchMessageStart) << (unsigned int)ss.GetSerializeSize(block) << block;
+    }
+
+    void AddRaw(const std::vector<char>& vch)
+    {
+        ss.write(&vch[0], vch.size());
+    }
+
+    FILE* Open(size_t nTruncate = 0)
+    {
+        FILE* file = fopen(path.string().c_str(), "wb");
+        fwrite(&ss[0], 1, ss.size() - nTruncate, file);
+        fclose(file);
+        return fopen(path.string().c_str(), "rb");
+    }
+};
+
+// Hashes of the blocks an import hands out, with failures as 0
+inline std::vector<uint256> Import(FILE* file, unsigned int nThreads, CBlockImportStats* pstats = NULL)
+{
+    std::vector<uint256> vHash;
+    CBlockImporter importer(file, nThreads);
+    while (true)
+    {
+        std::unique_ptr<CImportedBlock> pframe = importer.Next();
+        if (!pframe)
+            break;
+        vHash.push_back(pframe->fParsed ? pframe->block.GetHash() : 0);
+    }
+    importer.Stop();
+    if (pstats)
+        *pstats = importer.GetStats();
+    fclose(file);
+    return vHash;
+}
+
+#endif
@@ -0,0 +1,129 @@
+// Tests for the pipelined block file import: blocks come out in file order
+// with their hashes memoized, bad size fields and frames that do not
+// deserialize are skipped the way the old single threaded scan skipped them,
+// and a file longer than the read-ahead limits still comes through whole.
+// How fast each stage runs is measured in bench/blockimport_bench.cpp.
+
+#include <boost/test/unit_test.hpp>
+
+#include "blockimport_file.h"
+
+BOOST_AUTO_TEST_SUITE(blockimport_tests)
+
+BOOST_AUTO_TEST_CASE(import_keeps_file_order)
+{
+    CBlockFile blocks;
+    std::vector<uint256> vExpected;
+    for (int i = 0; i < 200; i++)
+    {
+        CBlock block = MakeBlock(i, 1 + i % 7);
+        blocks.Add(block);
+        vExpected.push_back(block.GetHash());
+    }
+
+    for (unsigned int nThreads = 1; nThreads <= 4; nThreads++)
+    {
+        FILE* file = blocks.Open();
+        BOOST_REQUIRE(file);
+        BOOST_CHECK(Import(file, nThreads) == vExpected);
+    }
+
+    // Blocks come out with the header and transaction hashes memoized
+    FILE* file = blocks.Open();
+    CBlockImporter importer(file, 2);
+    std::unique_ptr<CImportedBlock> pframe = importer.Next();
+    BOOST_REQUIRE(pframe && pframe->fParsed);
+    uint64_t nBlockHits = nBlockHashCacheHits.load();
+    uint64_t nTxHits = nTxHashCacheHits.load();
+    BOOST_CHECK(pframe->block.GetHash() == vExpected[0]);
+    BOOST_CHECK(pframe->block.BuildMerkleTree() == pframe->block.hashMerkleRoot);
+    BOOST_CHECK_EQUAL(nBlockHashCacheHits.load() - nBlockHits, 1U);
+    BOOST_CHECK_EQUAL(nTxHashCacheHits.load() - nTxHits, pframe->block.vtx.size());
+    importer.Stop();
+    fclose(file);
+}
+
+BOOST_AUTO_TEST_CASE(import_skips_bad_frames)
+{
+    CBlockFile blocks;
+    std::vector<uint256> vExpected;
+    std::vector<char> vMagic(pchMessageStart, pchMessageStart + sizeof(pchMessageStart));
+
+    CBlock block = MakeBlock(0, 2);
+    blocks.Add(block);
+    vExpected.push_back(block.GetHash());
+
+    // Garbage between frames is scanned over
+    blocks.AddRaw(std::vector<char>(1000, 0x5a));
+
+    // A zero size field is skipped and counted
+    std::vector<char> vZero(vMagic);
+    vZero.insert(vZero.end(), 4, 0);
+    blocks.AddRaw(vZero);
+    vExpected.push_back(0);
+
+    block = MakeBlock(1, 3);
+    blocks.Add(block);
+    vExpected.push_back(block.GetHash());
+
+    // A frame too short for a block fails, and the scan resumes after its
+    // size field, so the block right behind it is still found
+    std::vector<char> vShort(vMagic);
+    unsigned int nShort = 10;
+    vShort.insert(vShort.end(), (char*)&nShort, (char*)&nShort + 4);
+    vShort.insert(vShort.end(), nShort, 0x01);
+    blocks.AddRaw(vShort);
+    vExpected.push_back(0);
+
+    // A size field that runs past the next blocks: the frame fails on its
+    // transaction count, and the blocks it swallowed are found on the rescan
+    std::vector<char> vLong(vMagic);
+    unsigned int nLong = 100000;
+    vLong.insert(vLong.end(), (char*)&nLong, (char*)&nLong + 4);
+    vLong.insert(vLong.end(), 80, 0x02);
+    vLong.insert(vLong.end(), 9, (char)0xff);
+    blocks.AddRaw(vLong);
+    vExpected.push_back(0);
+
+    for (int i = 2; i < 50; i++)
+    {
+        block = MakeBlock(i, 1);
+        blocks.Add(block);
+        vExpected.push_back(block.GetHash());
+    }
+
+    for (unsigned int nThreads = 1; nThreads <= 3; nThreads++)
+    {
+        FILE* file = blocks.Open();
+        CBlockImportStats stats;
+        BOOST_CHECK(Import(file, nThreads, &stats) == vExpected);
+        BOOST_CHECK_EQUAL(stats.nRestarts, 2U);
+    }
+
+    // A block cut short by the end of the file fails
+    FILE* file = blocks.Open(10);
+    vExpected.back() = 0;
+    BOOST_CHECK(Import(file, 2) == vExpected);
+}
+
+BOOST_AUTO_TEST_CASE(import_past_read_ahead_limit)
+{
+    // More blocks than the queue holds, with large ones mixed in so frames
+    // straddle the reader's IMPORT_READ_BYTES reads
+    CBlockFile blocks;
+    std::vector<uint256> vExpected;
+    for (int i = 0; i < (int)IMPORT_MAX_QUEUED_BLOCKS * 2 + 17; i++)
+    {
+        CBlock block = MakeBlock(i, i % 100 == 0 ? 64 : 1, i % 100 == 0 ? 8000 : 0);
+        blocks.Add(block);
+        vExpected.push_back(block.GetHash());
+    }
+    FILE* file = blocks.Open();
+    CBlockImportStats stats;
+    BOOST_CHECK(Import(file, 3, &stats) == vExpected);
+    BOOST_CHECK_EQUAL(stats.nFrames, vExpected.size());
+    BOOST_CHECK_EQUAL(stats.nParsed, vExpected.size());
+    BOOST_CHECK_EQUAL(stats.nBytesRead, (uint64_t)blocks.ss.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
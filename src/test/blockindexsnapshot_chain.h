@@ -0,0 +1,79 @@
+// A synthetic block index for the snapshot tests and benchmark: a main chain
+// with every stored field filled in and a side branch off it.
+#ifndef INNOVA_TEST_BLOCKINDEXSNAPSHOT_CHAIN_H
+#define INNOVA_TEST_BLOCKINDEXSNAPSHOT_CHAIN_H
+
+#include <boost/filesystem.hpp>
+
+#include "../blockindexsnapshot.h"
+#include "../util.h"
+
+struct SnapshotChain
+{
+    std::map<uint256, CBlockIndex*> mapIndex;
+    uint256 hashBest;
+
+    CBlockIndex* Add(CBlockIndex* pprev, unsigned int nSalt)
+    {
+        CBlockIndex* pindex = new CBlockIndex();
+        pindex->pprev = pprev;
+        pindex->nHeight = pprev ? pprev->nHeight + 1 : 0;
+        pindex->nFile = 1 + pindex->nHeight / 50000;
+        pindex->nBlockPos = pindex->nHeight * 311 + nSalt;
+        pindex->nChainTrust = (pprev ? pprev->nChainTrust : 0) + (pindex->nHeight % 7 + 1);
+        pindex->nMint = pindex->nHeight * 1000LL;
+        pindex->nMoneySupply = pindex->nHeight * 123456789LL;
+        pindex->nFlags = pindex->nHeight % 3 == 0 ? CBlockIndex::BLOCK_PROOF_OF_STAKE : 0;
+        pindex->nStakeModifier = 0x0123456789abcdefULL ^ pindex->nHeight;
+        pindex->nStakeModifierChecksum = pindex->nHeight * 2654435761U;
+        if (pindex->IsProofOfStake())
+        {
+            pindex->prevoutStake = COutPoint(Hash(BEGIN(nSalt), END(nSalt)), pindex->nHeight % 5);
+            pindex->nStakeTime = 1500000000 + pindex->nHeight;
+        }
+        pindex->hashProof = Hash(BEGIN(pindex->nBlockPos), END(pindex->nBlockPos));
+        pindex->nVersion = 7;
+        pindex->hashMerkleRoot = Hash(BEGIN(pindex->nStakeModifier), END(pindex->nStakeModifier));
+        pindex->nTime = 1500000000 + pindex->nHeight;
+        pindex->nBits = 0x1e0fffff;
+        pindex->nNonce = nSalt ^ pindex->nHeight;
+
+        uint256 hash = Hash(BEGIN(pindex->nNonce), END(pindex->nNonce), BEGIN(nSalt), END(nSalt));
+        std::map<uint256, CBlockIndex*>::iterator mi = mapIndex.insert(std::make_pair(hash, pindex)).first;
+        pindex->phashBlock = &mi->first;
+        return pindex;
+    }
+
+    SnapshotChain(int nHeight, int nForkHeight, int nForkLength)
+    {
+        CBlockIndex* pindexFork = NULL;
+        CBlockIndex* pindex = NULL;
+        for (int i = 0; i <= nHeight; i++)
+        {
+            CBlockIndex* pindexNew = Add(pindex, 1);
+            if (pindex)
+                pindex->pnext = pindexNew;
+            pindex = pindexNew;
+            if (i == nForkHeight)
+                pindexFork = pindex;
+        }
+        hashBest = pindex->GetBlockHash();
+        for (int i = 0; i < nForkLength; i++)
+            pindexFork = Add(pindexFork, 2);
+    }
+
+    ~SnapshotChain()
+    {
+        for (std::map<uint256, CBlockIndex*>::iterator mi = mapIndex.begin(); mi != mapIndex.end(); ++mi)
+            delete mi->second;
+    }
+};
+
+inline void FreeIndex(std::vector<std::pair<uint256, CBlockIndex*> >& vIndex)
+{
+    for (unsigned int i = 0; i < vIndex.size(); i++)
+        delete vIndex[i].second;
+    vIndex.clear();
+}
+
+#endif
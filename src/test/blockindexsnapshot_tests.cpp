@@ -0,0 +1,89 @@
+// Tests for the block index snapshot: a chain with a side branch, spanning
+// several checksummed chunks, reads back with every field and link intact;
+// a flipped byte, another best chain or another database state is refused.
+// Write and read times are measured in bench/blockindexsnapshot_bench.cpp.
+
+#include <boost/test/unit_test.hpp>
+
+#include "blockindexsnapshot_chain.h"
+
+namespace
+{
+
+uint256 LinkHash(const CBlockIndex* pindex)
+{
+    return pindex ? pindex->GetBlockHash() : uint256(0);
+}
+
+bool SameIndex(const CBlockIndex& a, const CBlockIndex& b)
+{
+    return a.nFile == b.nFile && a.nBlockPos == b.nBlockPos && a.nChainTrust == b.nChainTrust &&
+           a.nHeight == b.nHeight && a.nMint == b.nMint && a.nMoneySupply == b.nMoneySupply &&
+           a.nFlags == b.nFlags && a.nStakeModifier == b.nStakeModifier &&
+           a.nStakeModifierChecksum == b.nStakeModifierChecksum && a.prevoutStake == b.prevoutStake &&
+           a.nStakeTime == b.nStakeTime && a.hashProof == b.hashProof && a.nVersion == b.nVersion &&
+           a.hashMerkleRoot == b.hashMerkleRoot && a.nTime == b.nTime && a.nBits == b.nBits &&
+           a.nNonce == b.nNonce;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(blockindexsnapshot_tests)
+
+BOOST_AUTO_TEST_CASE(snapshot_round_trip)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path("blockindex-%%%%%%%%.snapshot");
+    const int nHeight = 150000;
+    SnapshotChain chain(nHeight, 100000, 40);
+
+    uint256 hashSnapshot;
+    BOOST_REQUIRE(WriteBlockIndexSnapshot(path, chain.mapIndex, chain.hashBest, hashSnapshot));
+
+    std::vector<std::pair<uint256, CBlockIndex*> > vIndex;
+    BOOST_REQUIRE(ReadBlockIndexSnapshot(path, hashSnapshot, chain.hashBest, vIndex));
+    BOOST_REQUIRE_EQUAL(vIndex.size(), chain.mapIndex.size());
+
+    // Heights never decrease, and every link lands on the right entry
+    std::map<const CBlockIndex*, uint256> mapHash;
+    for (unsigned int i = 0; i < vIndex.size(); i++)
+        mapHash[vIndex[i].second] = vIndex[i].first;
+    int nMismatch = 0;
+    for (unsigned int i = 0; i < vIndex.size(); i++)
+    {
+        const CBlockIndex* pindex = vIndex[i].second;
+        if (i > 0 && pindex->nHeight < vIndex[i - 1].second->nHeight)
+            nMismatch++;
+        std::map<uint256, CBlockIndex*>::const_iterator mi = chain.mapIndex.find(vIndex[i].first);
+        if (mi == chain.mapIndex.end() || !SameIndex(*pindex, *mi->second) ||
+            (pindex->pprev ? mapHash[pindex->pprev] : uint256(0)) != LinkHash(mi->second->pprev) ||
+            (pindex->pnext ? mapHash[pindex->pnext] : uint256(0)) != LinkHash(mi->second->pnext))
+            nMismatch++;
+    }
+    BOOST_CHECK_EQUAL(nMismatch, 0);
+    FreeIndex(vIndex);
+
+    // Only the database state the file was written for may use it
+    BOOST_CHECK(!ReadBlockIndexSnapshot(path, hashSnapshot, chain.mapIndex.begin()->first, vIndex));
+    BOOST_CHECK(!ReadBlockIndexSnapshot(path, chain.hashBest, chain.hashBest, vIndex));
+    BOOST_CHECK(vIndex.empty());
+
+    // A flipped byte inside a record chunk is caught by its chunk hash
+    {
+        FILE* file = fopen(path.string().c_str(), "r+b");
+        BOOST_REQUIRE(file);
+        long nPos = (long)boost::filesystem::file_size(path) - 70000 * BLOCK_INDEX_SNAPSHOT_RECORD_SIZE;
+        fseek(file, nPos, SEEK_SET);
+        int c = fgetc(file);
+        fseek(file, nPos, SEEK_SET);
+        fputc(c ^ 0x20, file);
+        fclose(file);
+    }
+    BOOST_CHECK(!ReadBlockIndexSnapshot(path, hashSnapshot, chain.hashBest, vIndex));
+    BOOST_CHECK(vIndex.empty());
+
+    boost::filesystem::remove(path);
+    BOOST_CHECK(!ReadBlockIndexSnapshot(path, hashSnapshot, chain.hashBest, vIndex));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
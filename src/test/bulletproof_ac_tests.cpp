@@ -3,6 +3,7 @@
 #include "../bulletproof_ac.h"
 #include "../bignum.h"
 #include "../key.h"
+#include "../msm.h"
 #include "../nullstake.h"
 #include "../poseidon2.h"
 #include "../shielded.h"
@@ -17,12 +18,6 @@
 
 extern unsigned int nStakeMinAge;
 
-// Pippenger multiexp under test (defined in bulletproof_ac.cpp, external linkage).
-extern bool BPACMultiScalarMul(const EC_GROUP* group, BN_CTX* ctx,
-                               const std::vector<EC_POINT*>& points,
-                               const std::vector<BIGNUM*>& scalars,
-                               EC_POINT* result);
-
 namespace
 {
 
@@ -942,7 +937,7 @@ BOOST_AUTO_TEST_CASE(multiscalarmul_matches_naive)
         }
 
         EC_POINT* pip = EC_POINT_new(group);
-        BOOST_REQUIRE(BPACMultiScalarMul(group, ctx, pts, scs, pip));
+        BOOST_REQUIRE(MultiScalarMul(group, ctx, pts, scs, pip));
         BOOST_CHECK_MESSAGE(EC_POINT_cmp(group, naive, pip, ctx) == 0,
                             "multiexp mismatch at n=" << n);
 
@@ -0,0 +1,91 @@
+// Tests for the script check queue behind ConnectBlock's -par workers: every
+// queued check is joined before Wait() returns, a single failure flips the
+// verdict, and the queue is reusable for the next block.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../checkqueue.h"
+
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+
+#include <vector>
+
+namespace {
+
+boost::atomic<int> nChecksRun(0);
+
+struct CFakeCheck
+{
+    bool fOk;
+
+    CFakeCheck() : fOk(true) {}
+    explicit CFakeCheck(bool fOkIn) : fOk(fOkIn) {}
+
+    bool operator()()
+    {
+        nChecksRun++;
+        return fOk;
+    }
+
+    void swap(CFakeCheck& check)
+    {
+        std::swap(fOk, check.fOk);
+    }
+};
+
+CCheckQueue<CFakeCheck> fakeQueue(16);
+
+void FakeQueueThread()
+{
+    fakeQueue.Thread();
+}
+
+bool RunBatch(int nChecks, int nFailAt)
+{
+    CCheckQueueControl<CFakeCheck> control(&fakeQueue);
+    for (int i = 0; i < nChecks; i += 10)
+    {
+        std::vector<CFakeCheck> vChecks;
+        for (int j = i; j < nChecks && j < i + 10; j++)
+            vChecks.push_back(CFakeCheck(j != nFailAt));
+        control.Add(vChecks);
+    }
+    return control.Wait();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(checkqueue_tests)
+
+BOOST_AUTO_TEST_CASE(checkqueue_joins_and_reports)
+{
+    boost::thread_group workers;
+    for (int i = 0; i < 3; i++)
+        workers.create_thread(&FakeQueueThread);
+
+    nChecksRun = 0;
+    BOOST_CHECK(RunBatch(1000, -1));
+    BOOST_CHECK_EQUAL(nChecksRun.load(), 1000);
+
+    // A failure must not stop the remaining checks from running: callers
+    // rely on every check reporting so the earliest failure can be charged.
+    nChecksRun = 0;
+    BOOST_CHECK(!RunBatch(1000, 17));
+    BOOST_CHECK_EQUAL(nChecksRun.load(), 1000);
+
+    // The failed verdict does not leak into the next block.
+    BOOST_CHECK(RunBatch(5, -1));
+
+    fakeQueue.Interrupt();
+    workers.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_null_control_is_serial)
+{
+    CCheckQueueControl<CFakeCheck> control(NULL);
+    BOOST_CHECK(!control.IsActive());
+    BOOST_CHECK(control.Wait());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
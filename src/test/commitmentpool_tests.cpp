@@ -0,0 +1,155 @@
+// Tests for the in-memory shielded commitment pool (shieldedpool.cpp): a
+// snapshot shares chunks with the pool but never sees a later append,
+// truncation or rewrite, and GetSnapshot follows the txdb commitment count
+// down as well as up.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../shieldedpool.h"
+#include "../txdb.h"
+
+namespace
+{
+
+CPedersenCommitment MakeCommitment(uint64_t nIndex, unsigned char chTag)
+{
+    CPedersenCommitment cv;
+    cv.vchCommitment[0] = chTag;
+    for (int i = 0; i < 8; i++)
+        cv.vchCommitment[1 + i] = nIndex >> (8 * i);
+    return cv;
+}
+
+// Commitments nBase + [nBegin, nEnd) tagged chTag, and a count of nBase + nEnd
+void WriteCommitments(CTxDB& txdb, uint64_t nBase, uint64_t nBegin, uint64_t nEnd, unsigned char chTag)
+{
+    for (uint64_t i = nBegin; i < nEnd; i++)
+        BOOST_REQUIRE(txdb.WriteShieldedCommitment(nBase + i, MakeCommitment(i, chTag)));
+    BOOST_REQUIRE(txdb.WriteShieldedCommitmentCount(nBase + nEnd));
+}
+
+// Entries nBase + [nBegin, nEnd) of snapshot are tagged chTag
+bool HasCommitments(const CCommitmentPoolSnapshot& snapshot, uint64_t nBase, uint64_t nBegin, uint64_t nEnd, unsigned char chTag)
+{
+    for (uint64_t i = nBegin; i < nEnd; i++)
+        if (!(snapshot[nBase + i] == MakeCommitment(i, chTag)))
+            return false;
+    return true;
+}
+
+// Writes a test's commitments past whatever the txdb already holds, and puts
+// the count back afterwards
+struct CCommitmentDBHarness
+{
+    CTxDB txdb;
+    uint64_t nBase;
+
+    CCommitmentDBHarness() : txdb("r+"), nBase(0)
+    {
+        txdb.ReadShieldedCommitmentCount(nBase);
+    }
+
+    ~CCommitmentDBHarness()
+    {
+        txdb.WriteShieldedCommitmentCount(nBase);
+    }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(commitmentpool_tests)
+
+BOOST_AUTO_TEST_CASE(snapshot_unchanged_by_append)
+{
+    CCommitmentDBHarness harness;
+    CTxDB& txdb = harness.txdb;
+    const uint64_t nBase = harness.nBase;
+    const uint64_t nChunk = COMMITMENT_POOL_CHUNK_SIZE;
+    CCommitmentPool pool;
+    WriteCommitments(txdb, nBase, 0, nChunk + 100, 1);
+    CCommitmentPoolSnapshot before;
+    BOOST_REQUIRE(pool.GetSnapshot(txdb, before));
+    BOOST_CHECK_EQUAL(before.size(), nBase + nChunk + 100);
+
+    // Fills the partly used chunk the snapshot shares, then starts new ones
+    WriteCommitments(txdb, nBase, nChunk + 100, 2 * nChunk + 50, 1);
+    CCommitmentPoolSnapshot after;
+    BOOST_REQUIRE(pool.GetSnapshot(txdb, after));
+    BOOST_CHECK_EQUAL(after.size(), nBase + 2 * nChunk + 50);
+    BOOST_CHECK(HasCommitments(after, nBase, 0, 2 * nChunk + 50, 1));
+
+    BOOST_CHECK_EQUAL(before.size(), nBase + nChunk + 100);
+    BOOST_CHECK(HasCommitments(before, nBase, 0, nChunk + 100, 1));
+    std::vector<CPedersenCommitment> vRange;
+    before.GetRange(nBase + nChunk, nBase + 2 * nChunk, vRange);
+    BOOST_CHECK_EQUAL(vRange.size(), 100U);
+    BOOST_CHECK(before.Find(MakeCommitment(nChunk + 100, 1)) == -1);
+    BOOST_CHECK_EQUAL(after.Find(MakeCommitment(nChunk + 100, 1)), (int64_t)(nBase + nChunk + 100));
+}
+
+BOOST_AUTO_TEST_CASE(truncate_mid_chunk_then_append)
+{
+    CCommitmentDBHarness harness;
+    CTxDB& txdb = harness.txdb;
+    const uint64_t nBase = harness.nBase;
+    const uint64_t nChunk = COMMITMENT_POOL_CHUNK_SIZE;
+    CCommitmentPool pool;
+    WriteCommitments(txdb, nBase, 0, nChunk + 300, 1);
+    CCommitmentPoolSnapshot before;
+    BOOST_REQUIRE(pool.GetSnapshot(txdb, before));
+
+    // A reorg rewrites the last 200 entries, as CTxDB does once the lower
+    // count is written, and the chain then grows past the old end
+    pool.Truncate(nBase + nChunk + 100);
+    WriteCommitments(txdb, nBase, nChunk + 100, nChunk + 400, 2);
+    CCommitmentPoolSnapshot after;
+    BOOST_REQUIRE(pool.GetSnapshot(txdb, after));
+    BOOST_CHECK_EQUAL(after.size(), nBase + nChunk + 400);
+    BOOST_CHECK(HasCommitments(after, nBase, 0, nChunk + 100, 1));
+    BOOST_CHECK(HasCommitments(after, nBase, nChunk + 100, nChunk + 400, 2));
+
+    BOOST_CHECK_EQUAL(before.size(), nBase + nChunk + 300);
+    BOOST_CHECK(HasCommitments(before, nBase, 0, nChunk + 300, 1));
+
+    // Truncating to a chunk boundary drops whole chunks only
+    pool.Truncate(nBase + nChunk);
+    CCommitmentPoolSnapshot trimmed;
+    WriteCommitments(txdb, nBase, nChunk, nChunk + 10, 3);
+    BOOST_REQUIRE(pool.GetSnapshot(txdb, trimmed));
+    BOOST_CHECK_EQUAL(trimmed.size(), nBase + nChunk + 10);
+    BOOST_CHECK(HasCommitments(trimmed, nBase, nChunk, nChunk + 10, 3));
+    BOOST_CHECK(HasCommitments(after, nBase, nChunk + 100, nChunk + 400, 2));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_after_count_decrease)
+{
+    CCommitmentDBHarness harness;
+    CTxDB& txdb = harness.txdb;
+    const uint64_t nBase = harness.nBase;
+    const uint64_t nChunk = COMMITMENT_POOL_CHUNK_SIZE;
+    CCommitmentPool pool;
+    WriteCommitments(txdb, nBase, 0, 2 * nChunk + 10, 1);
+    CCommitmentPoolSnapshot before;
+    BOOST_REQUIRE(pool.GetSnapshot(txdb, before));
+
+    // The count drops back into the previous chunk without a Truncate call
+    BOOST_REQUIRE(txdb.WriteShieldedCommitmentCount(nBase + nChunk + 500));
+    CCommitmentPoolSnapshot lower;
+    BOOST_REQUIRE(pool.GetSnapshot(txdb, lower));
+    BOOST_CHECK_EQUAL(lower.size(), nBase + nChunk + 500);
+    BOOST_CHECK(HasCommitments(lower, nBase, 0, nChunk + 500, 1));
+    BOOST_CHECK(lower.Find(MakeCommitment(nChunk + 500, 1)) == -1);
+
+    // Entries past the lower count are read again, not kept
+    WriteCommitments(txdb, nBase, nChunk + 500, nChunk + 600, 2);
+    CCommitmentPoolSnapshot regrown;
+    BOOST_REQUIRE(pool.GetSnapshot(txdb, regrown));
+    BOOST_CHECK_EQUAL(regrown.size(), nBase + nChunk + 600);
+    BOOST_CHECK(HasCommitments(regrown, nBase, nChunk + 500, nChunk + 600, 2));
+
+    BOOST_CHECK_EQUAL(before.size(), nBase + 2 * nChunk + 10);
+    BOOST_CHECK(HasCommitments(before, nBase, 0, 2 * nChunk + 10, 1));
+    BOOST_CHECK_EQUAL(lower.size(), nBase + nChunk + 500);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+// Tests for the DAG reachability index: on random DAGs, every IsInPast,
+// IsInBoundedPast and AnticoneSize answer matches the MarkPastSet and parent
+// walks the index stands in for, whether the index was rebuilt, extended one
+// tip at a time, or relabelled after its interval space ran out.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../dag.h"
+#include "../main.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+// A random DAG in its own manager. Heights rise along every edge, merge
+// parents come from the last few blocks, and some parents are never
+// delivered, as with pre-DAG or still pending blocks.
+struct CRandomDAG
+{
+    CDAGManager dag;
+    std::map<uint256, CBlockIndex> mapIndex;
+    std::vector<uint256> vHash;      // every hash a block names
+    std::vector<uint256> vPresent;   // delivered blocks
+    uint256 hashRoot;
+    int nHeight;
+    uint64_t nNextHash;
+
+    CRandomDAG() : nHeight(11), nNextHash(1)
+    {
+        hashRoot = NewHash();
+        NewIndex(hashRoot, 5);
+    }
+
+    uint256 NewHash()
+    {
+        return (uint256(nNextHash++) << 192) | uint256(insecure_rand());
+    }
+
+    CBlockIndex* NewIndex(const uint256& hash, int nHeightIn)
+    {
+        CBlockIndex& index = mapIndex[hash];
+        index.nHeight = nHeightIn;
+        index.phashBlock = &mapIndex.find(hash)->first;
+        vHash.push_back(hash);
+        return &index;
+    }
+
+    // fInOrder delivers each block as it is made and queries the index in
+    // between, so it grows one tip at a time; otherwise blocks arrive in
+    // small shuffled batches and the index is rebuilt.
+    void Build(int nBlocks, bool fInOrder)
+    {
+        std::vector<std::pair<CBlockIndex*, std::vector<uint256> > > vPending;
+        for (int i = 0; i < nBlocks; i++)
+        {
+            if (insecure_rand() % 3)
+                nHeight++;
+            std::vector<uint256> vParents;
+            if (insecure_rand() % 16 == 0)
+                vParents.push_back(NewIndex(NewHash(), nHeight - 1)->GetBlockHash());
+            int nParents = 1 + insecure_rand() % 4;
+            size_t nFirst = vPresent.size() > 12 ? vPresent.size() - 12 : 0;
+            for (int j = 0; j < nParents && nFirst < vPresent.size(); j++)
+            {
+                const uint256& hashParent = vPresent[nFirst + insecure_rand() % (vPresent.size() - nFirst)];
+                if (mapIndex[hashParent].nHeight < nHeight &&
+                    std::find(vParents.begin(), vParents.end(), hashParent) == vParents.end())
+                    vParents.push_back(hashParent);
+            }
+            if (vParents.empty())
+                vParents.push_back(hashRoot);
+
+            uint256 hash = NewHash();
+            vPending.push_back(std::make_pair(NewIndex(hash, nHeight), vParents));
+            vPresent.push_back(hash);
+            if (!fInOrder && vPending.size() < 1 + insecure_rand() % 4)
+                continue;
+
+            for (size_t k = vPending.size(); k > 1; k--)
+                std::swap(vPending[k - 1], vPending[insecure_rand() % k]);
+            for (size_t k = 0; k < vPending.size(); k++)
+            {
+                BOOST_REQUIRE(dag.InitBlockDAGData(vPending[k].first, vPending[k].second));
+                if (fInOrder)
+                    dag.IsInPastForTests(vPending[k].second[0], vPending[k].first->GetBlockHash());
+            }
+            vPending.clear();
+        }
+        for (size_t k = 0; k < vPending.size(); k++)
+            BOOST_REQUIRE(dag.InitBlockDAGData(vPending[k].first, vPending[k].second));
+    }
+
+    void CheckAgainstWalk()
+    {
+        const int vDepth[] = { 3, DAG_MERGE_DEPTH * 2 };
+        std::vector<uint256> vBlue;
+        for (const uint256& hash : vHash)
+            if (insecure_rand() % 2)
+                vBlue.push_back(hash);
+
+        for (const uint256& hash : vPresent)
+        {
+            std::set<uint256> setPast;
+            dag.GetPastSetForTests(hash, std::numeric_limits<int>::max(), setPast);
+            int nWrong = 0;
+            for (const uint256& hashAncestor : vHash)
+                if (dag.IsInPastForTests(hashAncestor, hash) != (setPast.count(hashAncestor) > 0))
+                    nWrong++;
+            BOOST_CHECK_MESSAGE(nWrong == 0, "IsInPast wrong for " << nWrong << " blocks below " << hash.ToString());
+
+            for (int nDepth : vDepth)
+            {
+                dag.GetPastSetForTests(hash, nDepth, setPast);
+                nWrong = 0;
+                for (const uint256& hashAncestor : vHash)
+                    if (dag.IsInBoundedPastForTests(hashAncestor, hash, nDepth) != (setPast.count(hashAncestor) > 0))
+                        nWrong++;
+                BOOST_CHECK_MESSAGE(nWrong == 0, "IsInBoundedPast(" << nDepth << ") wrong for " << nWrong
+                                    << " blocks below " << hash.ToString());
+            }
+
+            BOOST_CHECK_EQUAL(dag.AnticoneSizeForTests(hash, vBlue, false), dag.AnticoneSizeForTests(hash, vBlue, true));
+        }
+    }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(dagreach_tests)
+
+BOOST_AUTO_TEST_CASE(random_dags_match_walk)
+{
+    seed_insecure_rand(true);
+    for (int nRun = 0; nRun < 4; nRun++)
+    {
+        CRandomDAG random;
+        random.Build(250, nRun % 2 == 0);
+        random.CheckAgainstWalk();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(relabel_matches_walk)
+{
+    seed_insecure_rand(true);
+    CRandomDAG random;
+    random.dag.SetReachIntervalEndForTests((uint64_t)1 << 18);
+    random.Build(300, true);
+
+    // One relabel is the first full build; the rest are ranges running out
+    BOOST_CHECK(random.dag.GetReachRelabelCountForTests() > 3);
+    random.CheckAgainstWalk();
+
+    // A relabel caused by a later tip leaves earlier answers intact
+    uint64_t nRelabels = random.dag.GetReachRelabelCountForTests();
+    random.Build(100, true);
+    BOOST_CHECK(random.dag.GetReachRelabelCountForTests() > nRelabels);
+    random.CheckAgainstWalk();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
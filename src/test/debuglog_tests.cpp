@@ -0,0 +1,199 @@
+// Tests for the debug.log writer thread: lines from many threads arrive whole
+// and in order per thread, a thread that outruns the writer loses whole
+// lines and has them counted, and -lograte holds back lines per source and
+// reports how many. The cost of queued against unbuffered writes is measured
+// in bench/debuglog_bench.cpp.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../debuglog.h"
+#include "../util.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sstream>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+struct CLogFile
+{
+    boost::filesystem::path path;
+    FILE* file;
+
+    CLogFile()
+    {
+        path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("debuglog-%%%%%%%%.log");
+        file = fopen(path.string().c_str(), "a");
+        setbuf(file, NULL);
+    }
+
+    ~CLogFile()
+    {
+        fclose(file);
+        boost::filesystem::remove(path);
+    }
+
+    std::vector<std::string> Lines() const
+    {
+        std::vector<std::string> vLine;
+        std::ifstream stream(path.string().c_str());
+        std::string strLine;
+        while (std::getline(stream, strLine))
+            vLine.push_back(strLine);
+        return vLine;
+    }
+};
+
+void LogLines(CDebugLogWriter* pwriter, int nThread, int nLines)
+{
+    for (int i = 0; i < nLines; i++)
+    {
+        // Every other line arrives in two pieces
+        if (i % 2)
+        {
+            pwriter->Append(strprintf("thread %d ", nThread));
+            pwriter->Append(strprintf("line %d\n", i));
+        }
+        else
+            pwriter->Append(strprintf("thread %d line %d\n", nThread, i));
+    }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(debuglog_tests)
+
+BOOST_AUTO_TEST_CASE(writer_keeps_lines_whole)
+{
+    CLogFile log;
+    CDebugLogWriter writer;
+    BOOST_CHECK(!writer.Append("before start\n"));
+    BOOST_REQUIRE(writer.Start(log.file, log.path.string(), false));
+
+    const int nThreads = 4, nLines = 2000;
+    boost::thread_group threads;
+    for (int i = 0; i < nThreads; i++)
+        threads.create_thread(boost::bind(&LogLines, &writer, i, nLines));
+    threads.join_all();
+    writer.Stop();
+    BOOST_CHECK(!writer.Append("after stop\n"));
+
+    std::vector<int> vNext(nThreads, 0);
+    std::vector<std::string> vLine = log.Lines();
+    int nBad = 0;
+    for (unsigned int i = 0; i < vLine.size(); i++)
+    {
+        int nThread, nLine;
+        if (sscanf(vLine[i].c_str(), "thread %d line %d", &nThread, &nLine) != 2 ||
+            nThread < 0 || nThread >= nThreads || nLine != vNext[nThread]++)
+            nBad++;
+    }
+    BOOST_CHECK_EQUAL(nBad, 0);
+    BOOST_CHECK_EQUAL(vLine.size(), (size_t)(nThreads * nLines));
+
+    CDebugLogStats stats = writer.GetStats();
+    BOOST_CHECK_EQUAL(stats.nLines, (uint64_t)(nThreads * nLines));
+    BOOST_CHECK_EQUAL(stats.nDropped, 0U);
+    BOOST_CHECK(stats.nWrites < stats.nLines);
+}
+
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(writer_drops_whole_lines_when_full)
+{
+    // Log into a pipe nobody reads yet, so the writer stalls once the pipe
+    // is full and the ring fills up behind it
+    int fd[2];
+    BOOST_REQUIRE(pipe(fd) == 0);
+    FILE* file = fdopen(fd[1], "w");
+    setbuf(file, NULL);
+    CDebugLogWriter writer;
+    BOOST_REQUIRE(writer.Start(file, "", true));
+
+    const int nLines = 5000;
+    std::string strPad(200, 'x');
+    for (int i = 0; i < nLines; i++)
+        writer.Append(strprintf("line %d %s\n", i, strPad.c_str()));
+
+    // Lines are lost, but only a line that finds the ring newly full waits
+    // for the writer; the rest are dropped at once while it stays stuck
+    CDebugLogStats stats = writer.GetStats();
+    BOOST_CHECK(stats.nDropped > 0);
+    BOOST_CHECK(stats.nFullWaits > 0);
+    BOOST_CHECK(stats.nFullWaits < stats.nDropped);
+
+    std::string strOut;
+    boost::thread reader([&]() {
+        char buf[65536];
+        ssize_t n;
+        while ((n = read(fd[0], buf, sizeof(buf))) > 0)
+            strOut.append(buf, n);
+    });
+    writer.Stop();
+    fclose(file);
+    reader.join();
+    close(fd[0]);
+
+    // Every line was either written or counted as dropped
+    stats = writer.GetStats();
+    BOOST_CHECK_EQUAL(stats.nLines + stats.nDropped, (uint64_t)nLines);
+
+    std::istringstream stream(strOut);
+    std::string strLine;
+    uint64_t nLogged = 0, nReported = 0;
+    int nLast = -1, nBad = 0;
+    while (std::getline(stream, strLine))
+    {
+        // Timestamped: "YYYY-MM-DD HH:MM:SS text"
+        BOOST_REQUIRE(strLine.size() > 20);
+        std::string strText = strLine.substr(20);
+        unsigned long long nDropped;
+        int nLine;
+        if (sscanf(strText.c_str(), "debug.log: %llu lines dropped", &nDropped) == 1)
+            nReported += nDropped;
+        else if (sscanf(strText.c_str(), "line %d", &nLine) == 1 && nLine > nLast &&
+                 strText == strprintf("line %d %s", nLine, strPad.c_str()))
+        {
+            nLast = nLine;
+            nLogged++;
+        }
+        else
+            nBad++;
+    }
+    BOOST_CHECK_EQUAL(nBad, 0);
+    BOOST_CHECK_EQUAL(nLogged, stats.nLines);
+    BOOST_CHECK_EQUAL(nReported, stats.nDropped);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(rate_limiter)
+{
+    static CLogRateLimiter limiter;
+    const char* pszA = "source a";
+    const char* pszB = "source b";
+    uint32_t nSuppressed;
+    const char* pszName;
+
+    for (int i = 0; i < 3; i++)
+        BOOST_CHECK(limiter.Admit(1, pszA, 3, 1000, nSuppressed, pszName));
+    for (int i = 0; i < 5; i++)
+        BOOST_CHECK(!limiter.Admit(1, pszA, 3, 1000, nSuppressed, pszName));
+    BOOST_CHECK_EQUAL(nSuppressed, 0U);
+
+    // Other sources keep their own budget
+    BOOST_CHECK(limiter.Admit(2, pszB, 3, 1000, nSuppressed, pszName));
+
+    // The next second starts over and reports what was held back
+    pszName = NULL;
+    BOOST_CHECK(limiter.Admit(1, pszA, 3, 1001, nSuppressed, pszName));
+    BOOST_CHECK_EQUAL(nSuppressed, 5U);
+    BOOST_CHECK(pszName == pszA);
+    BOOST_CHECK(limiter.Admit(1, pszA, 3, 1001, nSuppressed, pszName));
+    BOOST_CHECK_EQUAL(nSuppressed, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,198 @@
+// Tests for ECDSA signature checking: ParseDERSignature() accepts exactly
+// the encodings OpenSSL's ECDSA_verify() accepts, CPubKey::Verify() agrees
+// with CECKey::Verify() on every signature tried (a real comparison when the
+// libsecp256k1 path is built). The verification rate is measured in
+// bench/ecdsa_bench.cpp.
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+#include "../key.h"
+#include "../util.h"
+
+#include <openssl/ecdsa.h>
+
+namespace
+{
+
+// What ECDSA_verify() accepts before doing any curve arithmetic.
+bool OpenSSLAcceptsEncoding(const std::vector<unsigned char>& vchSig)
+{
+    if (vchSig.empty())
+        return false;
+    const unsigned char* p = &vchSig[0];
+    ECDSA_SIG* sig = d2i_ECDSA_SIG(NULL, &p, vchSig.size());
+    if (sig == NULL)
+        return false;
+    unsigned char* der = NULL;
+    int nDerLen = i2d_ECDSA_SIG(sig, &der);
+    bool fOk = nDerLen == (int)vchSig.size() && memcmp(der, &vchSig[0], nDerLen) == 0;
+    OPENSSL_free(der);
+
+    const BIGNUM *r, *s;
+    ECDSA_SIG_get0(sig, &r, &s);
+    BIGNUM* order = BN_new();
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    EC_GROUP_get_order(group, order, NULL);
+    fOk = fOk && !BN_is_zero(r) && !BN_is_negative(r) && BN_cmp(r, order) < 0 &&
+          !BN_is_zero(s) && !BN_is_negative(s) && BN_cmp(s, order) < 0;
+    EC_GROUP_free(group);
+    BN_free(order);
+    ECDSA_SIG_free(sig);
+    return fOk;
+}
+
+bool VerifyOpenSSL(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    CECKey key;
+    return !vchSig.empty() && key.SetPubKey(pubkey) && key.Verify(hash, vchSig);
+}
+
+// The same signature with S replaced by n - S.
+std::vector<unsigned char> HighS(const std::vector<unsigned char>& vchSig)
+{
+    const unsigned char* p = &vchSig[0];
+    ECDSA_SIG* sig = d2i_ECDSA_SIG(NULL, &p, vchSig.size());
+    const BIGNUM *r, *s;
+    ECDSA_SIG_get0(sig, &r, &s);
+    BIGNUM* order = BN_new();
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    EC_GROUP_get_order(group, order, NULL);
+    BIGNUM* sNew = BN_new();
+    BN_sub(sNew, order, s);
+    ECDSA_SIG_set0(sig, BN_dup(r), sNew);
+    std::vector<unsigned char> vchOut(i2d_ECDSA_SIG(sig, NULL));
+    unsigned char* pOut = &vchOut[0];
+    i2d_ECDSA_SIG(sig, &pOut);
+    EC_GROUP_free(group);
+    BN_free(order);
+    ECDSA_SIG_free(sig);
+    return vchOut;
+}
+
+void AddMutations(const std::vector<unsigned char>& vchSig, std::vector<std::vector<unsigned char> >& vOut)
+{
+    vOut.push_back(vchSig);
+    for (unsigned int i = 0; i < vchSig.size(); i++)
+    {
+        static const unsigned char vFlips[] = { 0x01, 0x80, 0xff };
+        for (unsigned int j = 0; j < sizeof(vFlips); j++)
+        {
+            std::vector<unsigned char> v(vchSig);
+            v[i] ^= vFlips[j];
+            vOut.push_back(v);
+        }
+        vOut.push_back(std::vector<unsigned char>(vchSig.begin(), vchSig.begin() + i));
+
+        // Leading zero inserted in front of byte i, lengths adjusted.
+        std::vector<unsigned char> v(vchSig);
+        v.insert(v.begin() + i, 0x00);
+        v[1]++;
+        if (i > 4)
+            v[3]++;
+        vOut.push_back(v);
+    }
+    std::vector<unsigned char> v(vchSig);
+    v.push_back(0x01);
+    vOut.push_back(v);
+
+    // BER long-form sequence length.
+    v = vchSig;
+    v.insert(v.begin() + 1, 0x81);
+    vOut.push_back(v);
+}
+
+// DER-shaped byte runs found in the hex of the transaction test vectors.
+void AddVectorSignatures(const std::string& strFile, std::vector<std::vector<unsigned char> >& vOut)
+{
+    boost::filesystem::path path = boost::filesystem::current_path() / "test" / "data" / strFile;
+    std::ifstream ifs(path.string().c_str());
+    std::string strData((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    size_t nStart = 0;
+    while ((nStart = strData.find("30", nStart)) != std::string::npos)
+    {
+        std::string strRun = strData.substr(nStart, 2 * 75);
+        size_t nHex = strRun.find_first_not_of("0123456789abcdef");
+        if (nHex != std::string::npos)
+            strRun.resize(nHex - nHex % 2);
+        std::vector<unsigned char> vchRun = ParseHex(strRun);
+        if (vchRun.size() >= 4 && vchRun[2] == 0x02 && vchRun[1] + 2U <= vchRun.size())
+            vOut.push_back(std::vector<unsigned char>(vchRun.begin(), vchRun.begin() + vchRun[1] + 2));
+        nStart++;
+    }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ecdsa_tests)
+
+BOOST_AUTO_TEST_CASE(der_parse_matches_openssl)
+{
+    std::vector<std::vector<unsigned char> > vSigs;
+    AddVectorSignatures("tx_valid.json", vSigs);
+    AddVectorSignatures("tx_invalid.json", vSigs);
+    size_t nFromVectors = vSigs.size();
+
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+    uint256 hash = Hash(BEGIN(nFromVectors), END(nFromVectors));
+    for (int i = 0; i < 4; i++)
+    {
+        uint256 hashMsg = Hash(BEGIN(hash), END(hash));
+        hash = hashMsg;
+        std::vector<unsigned char> vchSig;
+        BOOST_REQUIRE(key.Sign(hash, vchSig));
+        AddMutations(vchSig, vSigs);
+        AddMutations(HighS(vchSig), vSigs);
+    }
+
+    int nAccepted = 0;
+    for (unsigned int i = 0; i < vSigs.size(); i++)
+    {
+        const std::vector<unsigned char>& vchSig = vSigs[i];
+        unsigned char vchRS[64];
+        bool fParsed = !vchSig.empty() && ParseDERSignature(&vchSig[0], vchSig.size(), vchRS);
+        BOOST_CHECK_MESSAGE(fParsed == OpenSSLAcceptsEncoding(vchSig), HexStr(vchSig));
+        BOOST_CHECK_MESSAGE(pubkey.Verify(hash, vchSig) == VerifyOpenSSL(pubkey, hash, vchSig), HexStr(vchSig));
+        nAccepted += fParsed;
+    }
+    BOOST_CHECK(nFromVectors > 0);
+    BOOST_CHECK(nAccepted > 0);
+}
+
+BOOST_AUTO_TEST_CASE(sign_verify_recover_agree)
+{
+    for (int nCompressed = 0; nCompressed < 2; nCompressed++)
+    {
+        CKey key;
+        key.MakeNewKey(nCompressed == 1);
+        CPubKey pubkey = key.GetPubKey();
+        BOOST_CHECK(pubkey.IsFullyValid());
+
+        uint256 hash = Hash(pubkey.begin(), pubkey.end());
+        std::vector<unsigned char> vchSig;
+        BOOST_REQUIRE(key.Sign(hash, vchSig));
+        BOOST_CHECK(pubkey.Verify(hash, vchSig));
+        BOOST_CHECK(VerifyOpenSSL(pubkey, hash, vchSig));
+        BOOST_CHECK(pubkey.Verify(hash, HighS(vchSig)));
+        uint256 hashOther = Hash(hash.begin(), hash.end());
+        BOOST_CHECK(!pubkey.Verify(hashOther, vchSig));
+
+        std::vector<unsigned char> vchCompact;
+        BOOST_REQUIRE(key.SignCompact(hash, vchCompact));
+        BOOST_CHECK(pubkey.VerifyCompact(hash, vchCompact));
+        CPubKey pubkeyRec;
+        BOOST_REQUIRE(pubkeyRec.RecoverCompact(hash, vchCompact));
+        BOOST_CHECK(pubkeyRec == pubkey);
+
+        CPubKey pubkeyFull = pubkey;
+        BOOST_REQUIRE(pubkeyFull.Decompress());
+        BOOST_CHECK(!pubkeyFull.IsCompressed());
+        BOOST_CHECK(pubkeyFull.Verify(hash, vchSig));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 
 #include "../main.h"
 #include "../shielded.h"
+#include "../verifycache.h"
 
 namespace
 {
@@ -119,6 +120,28 @@ CTransaction BuildReclaimTx()
     return tx;
 }
 
+// The first nLeaves leaves as an older writer would have left them: a leaf
+// level and no flags word, so RebuildParentNodes computes every interior node.
+void LoadLeavesWithoutParents(const std::vector<CPedersenCommitment>& vLeaves, size_t nLeaves,
+                              CCurveTree& treeOut)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << (uint64_t)nLeaves;
+    WriteCompactSize(ss, 1);
+    WriteCompactSize(ss, nLeaves);
+    for (size_t i = 0; i < nLeaves; i++)
+        ss << vLeaves[i].vchCommitment << (int)0 << (uint64_t)i;
+    ss >> treeOut;
+    BOOST_REQUIRE(treeOut.RebuildParentNodes());
+}
+
+uint256 GetRebuiltRoot(const std::vector<CPedersenCommitment>& vLeaves, size_t nLeaves)
+{
+    CCurveTree rebuilt;
+    LoadLeavesWithoutParents(vLeaves, nLeaves, rebuilt);
+    return rebuilt.GetRoot();
+}
+
 } // namespace
 
 BOOST_AUTO_TEST_SUITE(fcmp_root_tests)
@@ -337,4 +360,186 @@ BOOST_AUTO_TEST_CASE(binding_sighash_covers_reclaim_auth)
     BOOST_CHECK(hashBase != mSet.GetBindingSigHash());
 }
 
+BOOST_AUTO_TEST_CASE(batch_fcmp_verify_agrees_with_serial)
+{
+    BOOST_REQUIRE(CZKContext::Initialize());
+
+    CCurveTree tree;
+    std::vector<std::vector<unsigned char> > vBlinds;
+    std::vector<CPedersenCommitment> vLeaves;
+    for (int i = 0; i < 20; i++)
+    {
+        std::vector<unsigned char> vchBlind;
+        BOOST_REQUIRE(GenerateBlindingFactor(vchBlind));
+        CPedersenCommitment cv;
+        BOOST_REQUIRE(CreatePedersenCommitment(100 + i, vchBlind, cv));
+        BOOST_REQUIRE(tree.InsertLeaf(cv));
+        vBlinds.push_back(vchBlind);
+        vLeaves.push_back(cv);
+    }
+    CCurveTreeNode root = tree.GetRootNode();
+
+    std::vector<CFCMPProof> vProofs;
+    std::vector<CPedersenCommitment> vCommitments;
+    for (int i = 0; i < 20; i += 4)
+    {
+        CFCMPProof proof;
+        BOOST_REQUIRE(CreateFCMPProof(tree, i, vBlinds[i], 100 + i, vLeaves[i], proof, FCMP_PROOF_VERSION_IPA));
+        vProofs.push_back(proof);
+        vCommitments.push_back(vLeaves[i]);
+    }
+
+    // Clear the verify-once cache so the combined IPA check actually runs.
+    VerifyProofCacheClear();
+    BOOST_CHECK(BatchVerifyFCMPProofs(root, vProofs, vCommitments));
+    VerifyProofCacheClear();
+
+    // Damage the IPA part of one proof: the batch must agree with the serial verifier.
+    std::vector<CFCMPProof> vTampered(vProofs);
+    vTampered[3].vchProof[vTampered[3].vchProof.size() - 40] ^= 1;
+    BOOST_CHECK(!VerifyFCMPProof(root, vTampered[3], vCommitments[3]));
+    BOOST_CHECK(!BatchVerifyFCMPProofs(root, vTampered, vCommitments));
+
+    // Proofs presented against the wrong commitments.
+    std::vector<CPedersenCommitment> vSwapped(vCommitments);
+    std::swap(vSwapped[0], vSwapped[1]);
+    BOOST_CHECK(!BatchVerifyFCMPProofs(root, vProofs, vSwapped));
+    VerifyProofCacheClear();
+}
+
+BOOST_AUTO_TEST_CASE(curve_tree_block_delta_rewinds_appended_leaves)
+{
+    BOOST_REQUIRE(CZKContext::Initialize());
+
+    CCurveTree tree;
+    std::vector<CPedersenCommitment> vLeaves;
+    for (int i = 0; i < 8; i++)
+    {
+        std::vector<unsigned char> vchBlind;
+        BOOST_REQUIRE(GenerateBlindingFactor(vchBlind));
+        CPedersenCommitment cv;
+        BOOST_REQUIRE(CreatePedersenCommitment(1000 + i, vchBlind, cv));
+        vLeaves.push_back(cv);
+    }
+    for (int i = 0; i < 5; i++)
+        BOOST_REQUIRE(tree.InsertLeaf(vLeaves[i]));
+
+    CCurveTreeBlockDelta delta;
+    tree.GetBlockDelta(delta);
+    CDataStream ssBefore(SER_DISK, CLIENT_VERSION);
+    ssBefore << tree;
+
+    // Only the right-most interior node is kept, not the leaves.
+    BOOST_CHECK_EQUAL(delta.vTail.size(), 1U);
+
+    CCurveTree grown = tree;
+    for (int i = 5; i < 8; i++)
+        BOOST_REQUIRE(grown.InsertLeaf(vLeaves[i]));
+    BOOST_CHECK(grown.GetRoot() != delta.hashRoot);
+
+    BOOST_REQUIRE(grown.RewindToDelta(delta));
+    CDataStream ssAfter(SER_DISK, CLIENT_VERSION);
+    ssAfter << grown;
+    BOOST_CHECK(ssBefore.str() == ssAfter.str());
+
+    // A tree that is not the snapshot plus appends must be refused.
+    CCurveTree other;
+    for (int i = 1; i < 8; i++)
+        BOOST_REQUIRE(other.InsertLeaf(vLeaves[i]));
+    BOOST_CHECK(!other.RewindToDelta(delta));
+}
+
+BOOST_AUTO_TEST_CASE(curve_tree_serialization_and_leaf_lookup)
+{
+    BOOST_REQUIRE(CZKContext::Initialize());
+
+    CCurveTree tree;
+    std::vector<CPedersenCommitment> vLeaves;
+    for (int i = 0; i < 6; i++)
+    {
+        std::vector<unsigned char> vchBlind;
+        BOOST_REQUIRE(GenerateBlindingFactor(vchBlind));
+        CPedersenCommitment cv;
+        BOOST_REQUIRE(CreatePedersenCommitment(2000 + i, vchBlind, cv));
+        vLeaves.push_back(cv);
+    }
+    for (int i = 0; i < 4; i++)
+        BOOST_REQUIRE(tree.InsertLeaf(vLeaves[i]));
+
+    // The table is built on the first lookup and kept up to date by inserts.
+    BOOST_CHECK_EQUAL(tree.FindLeafIndex(vLeaves[2]), 2);
+    BOOST_CHECK_EQUAL(tree.FindLeafIndex(vLeaves[4]), -1);
+    BOOST_REQUIRE(tree.InsertLeaf(vLeaves[4]));
+    BOOST_CHECK_EQUAL(tree.FindLeafIndex(vLeaves[4]), 4);
+    BOOST_CHECK_EQUAL(tree.FindLeafIndex(vLeaves[5]), -1);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << tree;
+    BOOST_CHECK_EQUAL(ss.size(), tree.GetSerializeSize(SER_DISK, CLIENT_VERSION));
+
+    CCurveTree loaded;
+    CDataStream ssCopy(ss);
+    ssCopy >> loaded;
+    BOOST_CHECK(loaded.GetRoot() == tree.GetRoot());
+    BOOST_CHECK_EQUAL(loaded.FindLeafIndex(vLeaves[3]), 3);
+
+    // Without the trailing flags (an older writer) the interior nodes are
+    // not trusted: the stored root is replaced by the recomputed one.
+    std::string strLegacy = ss.str().substr(0, ss.size() - 4);
+    strLegacy[strLegacy.size() - 12 - 1] ^= 1;   // last byte of the root point
+    CDataStream ssLegacy(strLegacy.data(), strLegacy.data() + strLegacy.size(), SER_DISK, CLIENT_VERSION);
+    CCurveTree legacy;
+    ssLegacy >> legacy;
+    BOOST_CHECK(legacy.GetRoot() != tree.GetRoot());
+    BOOST_REQUIRE(legacy.RebuildParentNodes());
+    BOOST_CHECK(legacy.GetRoot() == tree.GetRoot());
+}
+
+BOOST_AUTO_TEST_CASE(curve_tree_incremental_root_across_arity_boundary)
+{
+    BOOST_REQUIRE(CZKContext::Initialize());
+
+    // Every insert maps a new ed25519 parent to the curve, so only the leaves
+    // around the boundary are inserted one at a time.
+    const size_t nBefore = CURVE_TREE_ARITY - 2;
+    const size_t nAfter = CURVE_TREE_ARITY + 4;
+    std::vector<CPedersenCommitment> vLeaves;
+    for (size_t i = 0; i < nAfter; i++)
+    {
+        std::vector<unsigned char> vchBlind;
+        BOOST_REQUIRE(GenerateBlindingFactor(vchBlind));
+        CPedersenCommitment cv;
+        BOOST_REQUIRE(CreatePedersenCommitment(3000 + i, vchBlind, cv));
+        vLeaves.push_back(cv);
+    }
+
+    CCurveTree tree;
+    LoadLeavesWithoutParents(vLeaves, nBefore, tree);
+    BOOST_CHECK_EQUAL(tree.GetLevelCount(), 2U);
+    CCurveTreeBlockDelta delta;
+    tree.GetBlockDelta(delta);
+
+    // Leaf 256 starts a second node one level up and a new root above it.
+    for (size_t i = nBefore; i < nAfter; i++)
+    {
+        BOOST_REQUIRE(tree.InsertLeaf(vLeaves[i]));
+        BOOST_CHECK_MESSAGE(tree.GetRoot() == GetRebuiltRoot(vLeaves, i + 1),
+                            "incremental root differs from rebuild at " << i + 1 << " leaves");
+    }
+    BOOST_CHECK_EQUAL(tree.GetLevelCount(), 3U);
+    BOOST_CHECK_EQUAL(tree.GetLevelSize(1), 2U);
+    const uint256 hashGrownRoot = tree.GetRoot();
+
+    // Reverting the leaves drops the second node and the new level again.
+    BOOST_REQUIRE(tree.RewindToDelta(delta));
+    BOOST_CHECK_EQUAL(tree.nLeafCount, nBefore);
+    BOOST_CHECK_EQUAL(tree.GetLevelSize(1), 1U);
+    BOOST_CHECK(tree.GetRoot() == delta.hashRoot);
+    BOOST_CHECK(tree.GetRoot() == GetRebuiltRoot(vLeaves, nBefore));
+
+    for (size_t i = nBefore; i < nAfter; i++)
+        BOOST_REQUIRE(tree.InsertLeaf(vLeaves[i]));
+    BOOST_CHECK(tree.GetRoot() == hashGrownRoot);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
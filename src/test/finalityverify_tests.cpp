@@ -0,0 +1,186 @@
+// Tests for CFinalityVerifyQueue: a vote relayed twice is queued once, a
+// tally share waits for its queued vote, a full queue hands votes back to the
+// message thread to verify inline, and Interrupt() lets the batch in flight
+// finish while dropping the backlog. The worker takes cs_main to resolve each
+// batch, so holding it here stalls the worker and every check sees a fixed
+// queue. The votes carry no valid proof and are rejected once processed.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../finalityverify.h"
+#include "../main.h"
+#include "../util.h"
+
+namespace
+{
+
+CFinalityVote MakeVote(int n)
+{
+    CFinalityVote vote;
+    vote.nProofMode = FINALITY_PROOF_NULLSTAKE_V2;
+    vote.nEpoch = 1;
+    vote.nHeight = n;
+    vote.nullifier = n + 1;
+    return vote;
+}
+
+CFinalityTallyShare MakeShare(const CFinalityVote& vote)
+{
+    CFinalityTallyShare share;
+    share.nEpoch = vote.nEpoch;
+    share.voteNullifier = vote.nullifier;
+    return share;
+}
+
+CFinalityVerifyStats Stats(const CFinalityVerifyQueue& queue)
+{
+    CFinalityVerifyStats stats;
+    queue.GetStats(stats);
+    return stats;
+}
+
+// Start one worker with cs_main held and hand it a first vote; it takes the
+// vote and stalls until cs_main is released.
+void StartStalled(CFinalityVerifyQueue& queue, const CFinalityVote& vote)
+{
+    ENTER_CRITICAL_SECTION(cs_main);
+    queue.Start(1);
+    BOOST_REQUIRE(queue.Push(vote, 1));
+    while (Stats(queue).nInFlight == 0)
+        MilliSleep(1);
+}
+
+void WaitForVerified(const CFinalityVerifyQueue& queue, uint64_t nVotes)
+{
+    while (true)
+    {
+        CFinalityVerifyStats stats = Stats(queue);
+        if (stats.nAccepted + stats.nRejected >= nVotes)
+            break;
+        MilliSleep(1);
+    }
+}
+
+void Stop(CFinalityVerifyQueue& queue)
+{
+    queue.Interrupt();
+    while (Stats(queue).nRunning > 0)
+        MilliSleep(1);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(finalityverify_tests)
+
+BOOST_AUTO_TEST_CASE(duplicate_vote_queued_once)
+{
+    CFinalityVerifyQueue queue;
+    CFinalityVote vote = MakeVote(1);
+    StartStalled(queue, vote);
+
+    // Relays from other peers are absorbed whether the vote is in flight or
+    // still waiting in the queue
+    BOOST_CHECK(queue.Push(vote, 2));
+    BOOST_CHECK(queue.Push(MakeVote(2), 2));
+    BOOST_CHECK(queue.Push(MakeVote(2), 3));
+
+    CFinalityVerifyStats stats = Stats(queue);
+    BOOST_CHECK_EQUAL(stats.nQueued, 2U);
+    BOOST_CHECK_EQUAL(stats.nDuplicates, 2U);
+    BOOST_CHECK_EQUAL(stats.nQueueDepth, 1U);
+    BOOST_CHECK_EQUAL(stats.nInFlight, 1U);
+
+    LEAVE_CRITICAL_SECTION(cs_main);
+    WaitForVerified(queue, 2);
+    stats = Stats(queue);
+    BOOST_CHECK_EQUAL(stats.nRejected, 2U);
+    BOOST_CHECK_EQUAL(stats.nInFlight, 0U);
+
+    // Once done with, the same vote is queued afresh
+    BOOST_CHECK(queue.Push(vote, 1));
+    WaitForVerified(queue, 3);
+    BOOST_CHECK_EQUAL(Stats(queue).nQueued, 3U);
+    Stop(queue);
+}
+
+BOOST_AUTO_TEST_CASE(tally_share_waits_for_vote)
+{
+    CFinalityVerifyQueue queue;
+    CFinalityVote voteA = MakeVote(1);
+    CFinalityVote voteB = MakeVote(2);
+    StartStalled(queue, voteA);
+    BOOST_REQUIRE(queue.Push(voteB, 1));
+
+    BOOST_CHECK(queue.DeferTallyShare(MakeShare(voteA), 2));
+    BOOST_CHECK(queue.DeferTallyShare(MakeShare(voteB), 2));
+    BOOST_CHECK(!queue.DeferTallyShare(MakeShare(MakeVote(3)), 2));
+    BOOST_CHECK_EQUAL(Stats(queue).nDeferredShares, 2U);
+
+    // Each share is handed on once its vote is done
+    LEAVE_CRITICAL_SECTION(cs_main);
+    WaitForVerified(queue, 2);
+    BOOST_CHECK_EQUAL(Stats(queue).nDeferredShares, 0U);
+    BOOST_CHECK(!queue.DeferTallyShare(MakeShare(voteA), 2));
+    Stop(queue);
+}
+
+BOOST_AUTO_TEST_CASE(full_queue_verifies_inline)
+{
+    CFinalityVerifyQueue queue;
+    StartStalled(queue, MakeVote(0));
+
+    unsigned int nPushed = 0;
+    for (unsigned int i = 1; i <= MAX_FINALITY_VERIFY_QUEUE; i++)
+        if (queue.Push(MakeVote(i), 1))
+            nPushed++;
+    BOOST_CHECK_EQUAL(nPushed, MAX_FINALITY_VERIFY_QUEUE);
+
+    // Full: the caller verifies on the message thread, but a relay of a vote
+    // already queued is still absorbed
+    BOOST_CHECK(!queue.Push(MakeVote(MAX_FINALITY_VERIFY_QUEUE + 1), 1));
+    BOOST_CHECK(queue.Push(MakeVote(1), 2));
+
+    CFinalityVerifyStats stats = Stats(queue);
+    BOOST_CHECK_EQUAL(stats.nOverflows, 1U);
+    BOOST_CHECK_EQUAL(stats.nDuplicates, 1U);
+    BOOST_CHECK_EQUAL(stats.nQueueDepth, MAX_FINALITY_VERIFY_QUEUE);
+    BOOST_CHECK_EQUAL(stats.nPeakQueueDepth, MAX_FINALITY_VERIFY_QUEUE);
+
+    queue.Interrupt();
+    LEAVE_CRITICAL_SECTION(cs_main);
+    Stop(queue);
+}
+
+BOOST_AUTO_TEST_CASE(interrupt_drains_queue)
+{
+    CFinalityVerifyQueue queue;
+    CFinalityVote voteA = MakeVote(1);
+    CFinalityVote voteB = MakeVote(2);
+    StartStalled(queue, voteA);
+    BOOST_REQUIRE(queue.Push(voteB, 1));
+    BOOST_REQUIRE(queue.Push(MakeVote(3), 1));
+    BOOST_REQUIRE(queue.DeferTallyShare(MakeShare(voteA), 2));
+    BOOST_REQUIRE(queue.DeferTallyShare(MakeShare(voteB), 2));
+
+    queue.Interrupt();
+    BOOST_CHECK(!queue.IsRunning());
+    BOOST_CHECK(!queue.Push(MakeVote(4), 1));
+    BOOST_CHECK(!queue.DeferTallyShare(MakeShare(voteB), 2));
+
+    // The backlog is gone; the vote in flight and its share are not
+    CFinalityVerifyStats stats = Stats(queue);
+    BOOST_CHECK_EQUAL(stats.nQueueDepth, 0U);
+    BOOST_CHECK_EQUAL(stats.nInFlight, 1U);
+    BOOST_CHECK_EQUAL(stats.nDeferredShares, 1U);
+    BOOST_CHECK_EQUAL(stats.nRunning, 1);
+
+    LEAVE_CRITICAL_SECTION(cs_main);
+    Stop(queue);
+    stats = Stats(queue);
+    BOOST_CHECK_EQUAL(stats.nInFlight, 0U);
+    BOOST_CHECK_EQUAL(stats.nRejected, 1U);
+    BOOST_CHECK_EQUAL(stats.nDeferredShares, 0U);
+    BOOST_CHECK_EQUAL(stats.nBatches, 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
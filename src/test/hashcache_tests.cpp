@@ -0,0 +1,103 @@
+// Tests for the memoized CTransaction/CBlock hashes: deserializing does not
+// hash, a deserialized object memoizes on its first GetHash() and answers
+// later calls from the memo, the memo always equals a fresh hash of the
+// serialized bytes, and mutation followed by ClearHashCache() rehashes.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../main.h"
+#include "../serialize.h"
+
+#include <boost/thread.hpp>
+
+BOOST_AUTO_TEST_SUITE(hashcache_tests)
+
+BOOST_AUTO_TEST_CASE(tx_hash_memo_matches_serialization)
+{
+    CTransaction txIn;
+    txIn.nTime = 1700000000;
+    txIn.vin.resize(1);
+    txIn.vin[0].prevout = COutPoint(uint256(7), 1);
+    txIn.vout.resize(1);
+    txIn.vout[0].nValue = 5 * COIN;
+    txIn.GetHash();
+    BOOST_CHECK(!txIn.hashMemo.IsSet());
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << txIn;
+    CTransaction tx;
+    ss >> tx;
+    BOOST_CHECK(!tx.hashMemo.IsSet());
+    BOOST_CHECK(tx.GetHash() == SerializeHash(txIn));
+    BOOST_CHECK(tx.hashMemo.IsSet());
+
+    uint64_t nHitsBefore = nTxHashCacheHits.load();
+    tx.GetHash();
+    BOOST_CHECK_EQUAL(nTxHashCacheHits.load(), nHitsBefore + 1);
+
+    // Copies carry the memo; mutating one must be followed by a clear.
+    CTransaction txCopy(tx);
+    txCopy.vout[0].nValue = 6 * COIN;
+    txCopy.ClearHashCache();
+    BOOST_CHECK(txCopy.GetHash() == SerializeHash(txCopy));
+    BOOST_CHECK(txCopy.GetHash() != tx.GetHash());
+
+    BOOST_CHECK(!txCopy.hashMemo.IsSet());
+
+    txCopy.UpdateHash();
+    BOOST_CHECK(txCopy.GetHash() == SerializeHash(txCopy));
+    BOOST_CHECK(txCopy.hashMemo.IsSet());
+
+    // Reading into a used object drops its memo
+    CDataStream ssAgain(SER_NETWORK, PROTOCOL_VERSION);
+    ssAgain << txIn;
+    ssAgain >> txCopy;
+    BOOST_CHECK(!txCopy.hashMemo.IsSet());
+    BOOST_CHECK(txCopy.GetHash() == tx.GetHash());
+
+    // Threads that race to fill the memo all get the right hash
+    CTransaction txShared;
+    ssAgain << txIn;
+    ssAgain >> txShared;
+    uint256 hashExpected = SerializeHash(txIn);
+    std::atomic<int> nWrong(0);
+    boost::thread_group threads;
+    for (int i = 0; i < 4; i++)
+        threads.create_thread([&]() {
+            for (int j = 0; j < 100; j++)
+                if (txShared.GetHash() != hashExpected)
+                    nWrong++;
+        });
+    threads.join_all();
+    BOOST_CHECK_EQUAL(nWrong.load(), 0);
+    BOOST_CHECK(txShared.hashMemo.IsSet());
+}
+
+BOOST_AUTO_TEST_CASE(block_hash_memo_matches_tribus)
+{
+    CBlock blockIn;
+    blockIn.nVersion = CBlock::CURRENT_VERSION;
+    blockIn.hashPrevBlock = uint256(42);
+    blockIn.nTime = 1700000000;
+    blockIn.nBits = 0x1e0fffff;
+    blockIn.nNonce = 12345;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << blockIn;
+    CBlock block;
+    ss >> block;
+    BOOST_CHECK(!block.hashMemo.IsSet());
+    BOOST_CHECK(block.GetHash() == Tribus(BEGIN(blockIn.nVersion), END(blockIn.nNonce)));
+    BOOST_CHECK(block.hashMemo.IsSet());
+    uint64_t nHitsBefore = nBlockHashCacheHits.load();
+    block.GetHash();
+    BOOST_CHECK_EQUAL(nBlockHashCacheHits.load(), nHitsBefore + 1);
+
+    // UpdateTime() mutates the header and must drop the memo.
+    block.nTime = 1;
+    block.UpdateTime(NULL);
+    BOOST_CHECK(!block.hashMemo.IsSet());
+    BOOST_CHECK(block.GetHash() == Tribus(BEGIN(block.nVersion), END(block.nNonce)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,8 @@
 #include "../finality.h"
 #include "../main.h"
 
+#include <algorithm>
+
 BOOST_AUTO_TEST_SUITE(idag_validation_tests)
 
 BOOST_AUTO_TEST_CASE(finality_stake_proof_spent_in_same_block_is_rejected)
@@ -93,6 +95,76 @@ BOOST_AUTO_TEST_CASE(select_best_dag_tip_allows_non_best_chain_tip)
     pindexBest = oldBest;
 }
 
+BOOST_AUTO_TEST_CASE(dag_store_links_children_delivered_before_parents)
+{
+    uint256 hRoot(4243000);
+    uint256 hMerge(4243001);
+    uint256 hChild(4243002);
+
+    CBlockIndex root;
+    CBlockIndex merge;
+    CBlockIndex child;
+    root.nHeight = FORK_HEIGHT_DAG;
+    merge.nHeight = FORK_HEIGHT_DAG;
+    child.nHeight = FORK_HEIGHT_DAG + 1;
+    child.pprev = &root;
+
+    mapBlockIndex[hRoot] = &root;
+    mapBlockIndex[hMerge] = &merge;
+    mapBlockIndex[hChild] = &child;
+    root.phashBlock = &mapBlockIndex.find(hRoot)->first;
+    merge.phashBlock = &mapBlockIndex.find(hMerge)->first;
+    child.phashBlock = &mapBlockIndex.find(hChild)->first;
+
+    int nEntriesBefore = g_dagManager.GetDAGEntryCount();
+
+    std::vector<uint256> noParents;
+    std::vector<uint256> childParents;
+    childParents.push_back(hRoot);
+    childParents.push_back(hMerge);
+
+    // The child arrives first: neither parent is in the DAG yet.
+    g_dagManager.InitBlockDAGData(&child, childParents);
+    BOOST_CHECK(!g_dagManager.HasDAGData(hRoot));
+    BOOST_CHECK_EQUAL(g_dagManager.GetDAGEntryCount(), nEntriesBefore + 1);
+
+    g_dagManager.InitBlockDAGData(&root, noParents);
+    g_dagManager.InitBlockDAGData(&merge, noParents);
+    BOOST_CHECK_EQUAL(g_dagManager.GetDAGEntryCount(), nEntriesBefore + 3);
+    BOOST_CHECK(g_dagManager.GetDAGMemoryUsage() > 0);
+
+    CBlockDAGData data;
+    BOOST_REQUIRE(g_dagManager.GetDAGData(hRoot, data));
+    BOOST_REQUIRE_EQUAL(data.vDAGChildren.size(), 1U);
+    BOOST_CHECK(data.vDAGChildren[0] == hChild);
+    BOOST_REQUIRE(g_dagManager.GetDAGData(hMerge, data));
+    BOOST_REQUIRE_EQUAL(data.vDAGChildren.size(), 1U);
+    BOOST_REQUIRE(g_dagManager.GetDAGData(hChild, data));
+    BOOST_REQUIRE_EQUAL(data.vDAGParents.size(), 2U);
+    BOOST_CHECK(data.vDAGParents[0] == hRoot);
+    BOOST_CHECK(data.vDAGParents[1] == hMerge);
+
+    std::vector<uint256> tips = g_dagManager.GetDAGTips();
+    BOOST_CHECK(std::find(tips.begin(), tips.end(), hChild) != tips.end());
+    BOOST_CHECK(std::find(tips.begin(), tips.end(), hRoot) == tips.end());
+
+    // Removing the child makes both parents tips again.
+    g_dagManager.RemoveBlockDAGData(hChild);
+    BOOST_CHECK(!g_dagManager.HasDAGData(hChild));
+    BOOST_REQUIRE(g_dagManager.GetDAGData(hRoot, data));
+    BOOST_CHECK(data.vDAGChildren.empty());
+    tips = g_dagManager.GetDAGTips();
+    BOOST_CHECK(std::find(tips.begin(), tips.end(), hRoot) != tips.end());
+    BOOST_CHECK(std::find(tips.begin(), tips.end(), hMerge) != tips.end());
+
+    g_dagManager.RemoveBlockDAGData(hMerge);
+    g_dagManager.RemoveBlockDAGData(hRoot);
+    BOOST_CHECK_EQUAL(g_dagManager.GetDAGEntryCount(), nEntriesBefore);
+    mapBlockIndex.erase(hChild);
+    mapBlockIndex.erase(hMerge);
+    mapBlockIndex.erase(hRoot);
+}
+
 BOOST_AUTO_TEST_CASE(dag_sibling_conflict_detection_covers_nullifiers_and_prevouts)
 {
     std::set<COutPoint> spentOutputs;
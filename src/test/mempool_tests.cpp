@@ -0,0 +1,150 @@
+// Tests for the memory pool's fee rate index: ancestor totals follow a
+// child-pays-for-parent chain as it is added and mined, the running memory
+// counter matches the entries, and trimming evicts the lowest descendant score
+// transactions together with their descendants, keeping a cheap parent that a
+// child pays for.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../main.h"
+
+namespace
+{
+
+CTransaction MakeTx(const uint256& hashPrev, unsigned int n, int64_t nValue)
+{
+    CTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(hashPrev, n);
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.resize(2);
+    tx.vout[0].nValue = nValue;
+    tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    tx.vout[1].nValue = nValue;
+    tx.vout[1].scriptPubKey = CScript() << OP_TRUE;
+    return tx;
+}
+
+uint256 Add(CTxMemPool& pool, CTransaction tx, int64_t nFee)
+{
+    uint256 hash = tx.GetHash();
+    pool.addUnchecked(hash, tx, CTxMemPoolEntry(tx, nFee, 0, 0, 0, 0));
+    return hash;
+}
+
+size_t SumUsage(const CTxMemPool& pool)
+{
+    size_t nUsage = 0;
+    for (std::map<uint256, CTxMemPoolEntry>::const_iterator it = pool.mapEntry.begin(); it != pool.mapEntry.end(); ++it)
+        nUsage += it->second.nUsage;
+    return nUsage;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(mempool_tests)
+
+BOOST_AUTO_TEST_CASE(ancestor_fee_rate_index)
+{
+    CTxMemPool pool;
+    CTransaction txParent = MakeTx(uint256(1), 0, 50000);
+    CTransaction txOther = MakeTx(uint256(2), 0, 50000);
+    uint256 hashParent = Add(pool, txParent, 1000);
+    uint256 hashOther = Add(pool, txOther, 20000);
+    BOOST_CHECK(pool.setByAncestorFeeRate.begin()->hash == hashOther);
+
+    // The child pays enough to lift its parent above the other tx
+    CTransaction txChild = MakeTx(hashParent, 0, 10000);
+    uint256 hashChild = Add(pool, txChild, 100000);
+    const CTxMemPoolEntry& child = pool.mapEntry[hashChild];
+    BOOST_CHECK_EQUAL(child.nAncestorCount, 2U);
+    BOOST_CHECK_EQUAL(child.nAncestorFee, 101000);
+    BOOST_CHECK_EQUAL(child.nAncestorSize, (uint64_t)(child.nTxSize + pool.mapEntry[hashParent].nTxSize));
+    BOOST_CHECK(pool.setByAncestorFeeRate.begin()->hash == hashChild);
+    BOOST_CHECK(pool.setByAncestorFeeRate.rbegin()->hash == hashParent);
+    BOOST_CHECK_EQUAL(pool.setByAncestorFeeRate.size(), 3U);
+
+    std::set<uint256> setAncestors, setDescendants;
+    pool.CalculateAncestors(txChild, setAncestors);
+    pool.CalculateDescendants(hashParent, setDescendants);
+    BOOST_CHECK(setAncestors.size() == 1 && setAncestors.count(hashParent));
+    BOOST_CHECK(setDescendants.size() == 1 && setDescendants.count(hashChild));
+
+    BOOST_CHECK_EQUAL(pool.GetTotalMemoryUsage(), SumUsage(pool));
+    // Eviction scores the parent with its child, leaving the other tx lowest
+    BOOST_CHECK_CLOSE(pool.GetMinFeeRate(), 20000.0 / pool.mapEntry[hashOther].nTxSize, 0.0001);
+
+    // Once the parent is mined the child stands on its own
+    pool.remove(txParent);
+    BOOST_CHECK_EQUAL(pool.mapEntry[hashChild].nAncestorCount, 1U);
+    BOOST_CHECK_EQUAL(pool.mapEntry[hashChild].nAncestorFee, 100000);
+    BOOST_CHECK_EQUAL(pool.setByAncestorFeeRate.size(), 2U);
+    BOOST_CHECK_EQUAL(pool.GetTotalMemoryUsage(), SumUsage(pool));
+
+    pool.clear();
+    BOOST_CHECK_EQUAL(pool.GetTotalMemoryUsage(), 0U);
+    BOOST_CHECK(pool.setByAncestorFeeRate.empty());
+}
+
+BOOST_AUTO_TEST_CASE(trim_to_size)
+{
+    CTxMemPool pool;
+    std::vector<uint256> vHash;
+    for (int i = 0; i < 10; i++)
+        vHash.push_back(Add(pool, MakeTx(uint256(100 + i), 0, 50000), 1000 * (i + 1)));
+
+    // A well paying child of the cheapest tx goes when its parent does
+    CTransaction txChild = MakeTx(vHash[0], 1, 10000);
+    uint256 hashChild = Add(pool, txChild, 1500);
+    BOOST_CHECK_EQUAL(pool.size(), 11U);
+
+    size_t nEntryUsage = pool.mapEntry[vHash[5]].nUsage;
+    size_t nLimit = pool.GetTotalMemoryUsage() - 3 * nEntryUsage - 1;
+    std::vector<uint256> vRemoved;
+    pool.TrimToSize(nLimit, &vRemoved);
+    BOOST_CHECK(pool.GetTotalMemoryUsage() <= nLimit);
+    BOOST_CHECK_EQUAL(pool.GetTotalMemoryUsage(), SumUsage(pool));
+
+    // Lowest descendant scores first: tx 0 (with its child), then 1 and 2
+    std::set<uint256> setRemoved(vRemoved.begin(), vRemoved.end());
+    BOOST_CHECK_EQUAL(setRemoved.size(), 4U);
+    BOOST_CHECK(setRemoved.count(vHash[0]) && setRemoved.count(hashChild));
+    BOOST_CHECK(setRemoved.count(vHash[1]) && setRemoved.count(vHash[2]));
+    BOOST_CHECK(!pool.exists(vHash[0]) && !pool.exists(hashChild) && pool.exists(vHash[3]));
+    BOOST_CHECK(pool.mapNextTx.count(COutPoint(vHash[0], 1)) == 0);
+    BOOST_CHECK_EQUAL(pool.mapEntry.size(), pool.mapTx.size());
+    BOOST_CHECK_CLOSE(pool.GetMinFeeRate(), 4000.0 / pool.mapEntry[vHash[3]].nTxSize, 0.0001);
+}
+
+BOOST_AUTO_TEST_CASE(trim_keeps_child_pays_for_parent)
+{
+    CTxMemPool pool;
+    CTransaction txParent = MakeTx(uint256(1), 0, 50000);
+    uint256 hashParent = Add(pool, txParent, 1000);
+    uint256 hashStandalone = Add(pool, MakeTx(uint256(2), 0, 50000), 5000);
+    uint256 hashChild = Add(pool, MakeTx(hashParent, 0, 10000), 100000);
+
+    // The parent alone pays less than the standalone tx, but not with its child
+    const CTxMemPoolEntry& parent = pool.mapEntry[hashParent];
+    BOOST_CHECK_EQUAL(parent.nDescendantCount, 2U);
+    BOOST_CHECK_EQUAL(parent.nDescendantFee, 101000);
+    BOOST_CHECK_EQUAL(parent.nDescendantSize, (uint64_t)(parent.nTxSize + pool.mapEntry[hashChild].nTxSize));
+    BOOST_CHECK(pool.setByAncestorFeeRate.rbegin()->hash == hashParent);
+    BOOST_CHECK(pool.setByDescendantScore.rbegin()->hash == hashStandalone);
+    BOOST_CHECK_CLOSE(pool.GetMinFeeRate(), 5000.0 / pool.mapEntry[hashStandalone].nTxSize, 0.0001);
+
+    std::vector<uint256> vRemoved;
+    pool.TrimToSize(pool.GetTotalMemoryUsage() - 1, &vRemoved);
+    BOOST_CHECK(vRemoved.size() == 1 && vRemoved[0] == hashStandalone);
+    BOOST_CHECK(pool.exists(hashParent) && pool.exists(hashChild));
+    BOOST_CHECK_EQUAL(pool.GetTotalMemoryUsage(), SumUsage(pool));
+
+    // Without the child the parent is scored on its own fee again
+    pool.remove(pool.mapTx[hashChild]);
+    BOOST_CHECK_EQUAL(pool.mapEntry[hashParent].nDescendantCount, 1U);
+    BOOST_CHECK_EQUAL(pool.mapEntry[hashParent].nDescendantFee, 1000);
+    BOOST_CHECK_EQUAL(pool.setByDescendantScore.size(), 1U);
+    BOOST_CHECK_CLOSE(pool.GetMinFeeRate(), 1000.0 / pool.mapEntry[hashParent].nTxSize, 0.0001);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,166 @@
+// Tests for message handler wakeups and per-command latency tracking:
+// samples land in the power-of-two bucket the getmsglatency histogram labels
+// them with, commands past MAX_MESSAGE_LATENCY_COMMANDS are counted under
+// "other", and a handler waiting on the condition variable is woken by the
+// last byte of a message arriving rather than by its timeout.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../innovarpc.h"
+#include "../net.h"
+#include "../util.h"
+
+#include <boost/atomic.hpp>
+#include <limits>
+
+using namespace json_spirit;
+
+namespace
+{
+
+const Value& Field(const Object& obj, const std::string& strName)
+{
+    const Value& val = find_value(obj, strName);
+    BOOST_REQUIRE(val.type() != null_type);
+    return val;
+}
+
+// Serialized header of an empty message, which is complete once read
+std::vector<char> EmptyMessage(const char* pszCommand)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CMessageHeader(pszCommand, 0);
+    return std::vector<char>(ss.begin(), ss.end());
+}
+
+struct CWaiter
+{
+    boost::atomic<bool> fDone;
+    bool fWoken;
+
+    CWaiter() : fDone(false), fWoken(false) {}
+
+    void Run()
+    {
+        fWoken = WaitForMessageHandlerWake(60 * 1000);
+        fDone = true;
+    }
+};
+
+void ThreadWaiter(void* parg)
+{
+    ((CWaiter*)parg)->Run();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(msglatency_tests)
+
+BOOST_AUTO_TEST_CASE(bucket_edges)
+{
+    BOOST_CHECK_EQUAL(CMessageLatency::GetBucket(-5), 0);
+    BOOST_CHECK_EQUAL(CMessageLatency::GetBucket(0), 0);
+    BOOST_CHECK_EQUAL(CMessageLatency::GetBucket(1), 1);
+    for (int i = 1; i < MESSAGE_LATENCY_BUCKETS - 1; i++)
+    {
+        // Bucket i holds [2^(i-1), 2^i)
+        BOOST_CHECK_EQUAL(CMessageLatency::GetBucket((int64_t)1 << (i - 1)), i);
+        BOOST_CHECK_EQUAL(CMessageLatency::GetBucket(((int64_t)1 << i) - 1), i);
+    }
+    // The last bucket is open-ended
+    const int nLast = MESSAGE_LATENCY_BUCKETS - 1;
+    BOOST_CHECK_EQUAL(CMessageLatency::GetBucket((int64_t)1 << (nLast - 1)), nLast);
+    BOOST_CHECK_EQUAL(CMessageLatency::GetBucket((int64_t)1 << 40), nLast);
+    BOOST_CHECK_EQUAL(CMessageLatency::GetBucket(std::numeric_limits<int64_t>::max()), nLast);
+
+    CMessageLatency stats;
+    stats.Add(-3, 0);
+    stats.Add(4, 7);
+    stats.Add(8, (int64_t)1 << 30);
+    BOOST_CHECK_EQUAL(stats.nCount, 3U);
+    BOOST_CHECK_EQUAL(stats.nQueueTotal, 12);
+    BOOST_CHECK_EQUAL(stats.nQueueMax, 8);
+    BOOST_CHECK_EQUAL(stats.nProcessMax, (int64_t)1 << 30);
+    BOOST_CHECK_EQUAL(stats.vQueue[0], 1U);
+    BOOST_CHECK_EQUAL(stats.vQueue[3], 1U);
+    BOOST_CHECK_EQUAL(stats.vQueue[4], 1U);
+    BOOST_CHECK_EQUAL(stats.vProcess[0], 1U);
+    BOOST_CHECK_EQUAL(stats.vProcess[3], 1U);
+    BOOST_CHECK_EQUAL(stats.vProcess[nLast], 1U);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_reports_buckets)
+{
+    GetMessageLatencyStats(true);
+    RecordMessageLatency("tx", 0, 1);
+    RecordMessageLatency("tx", 1023, 1024);
+    RecordMessageLatency("tx", (int64_t)1 << 22, 5);
+
+    Array params;
+    params.push_back(true);
+    Object ret = getmsglatency(params, false).get_obj();
+    BOOST_CHECK_EQUAL(ret.size(), 1U);
+    Object tx = Field(ret, "tx").get_obj();
+    BOOST_CHECK_EQUAL(Field(tx, "count").get_int(), 3);
+    BOOST_CHECK_EQUAL(Field(tx, "process_max_us").get_int(), 1024);
+
+    Object queue = Field(tx, "queue").get_obj();
+    BOOST_CHECK_EQUAL(queue.size(), 3U);
+    BOOST_CHECK_EQUAL(Field(queue, "<1us").get_int(), 1);
+    BOOST_CHECK_EQUAL(Field(queue, "<1024us").get_int(), 1);
+    BOOST_CHECK_EQUAL(Field(queue, ">=4194304us").get_int(), 1);
+
+    Object process = Field(tx, "process").get_obj();
+    BOOST_CHECK_EQUAL(process.size(), 3U);
+    BOOST_CHECK_EQUAL(Field(process, "<2us").get_int(), 1);
+    BOOST_CHECK_EQUAL(Field(process, "<2048us").get_int(), 1);
+    BOOST_CHECK_EQUAL(Field(process, "<8us").get_int(), 1);
+
+    // The reset cleared the counters
+    BOOST_CHECK(getmsglatency(Array(), false).get_obj().empty());
+}
+
+BOOST_AUTO_TEST_CASE(command_cap_folds_into_other)
+{
+    GetMessageLatencyStats(true);
+    for (unsigned int i = 0; i < MAX_MESSAGE_LATENCY_COMMANDS + 10; i++)
+        RecordMessageLatency(strprintf("cmd%u", i), 1, 1);
+    // Commands tracked before the cap keep their own entries
+    RecordMessageLatency("cmd0", 1, 1);
+
+    std::map<std::string, CMessageLatency> mapStats = GetMessageLatencyStats(true);
+    BOOST_CHECK_EQUAL(mapStats.size(), MAX_MESSAGE_LATENCY_COMMANDS + 1);
+    BOOST_CHECK_EQUAL(mapStats["cmd0"].nCount, 2U);
+    BOOST_CHECK_EQUAL(mapStats[strprintf("cmd%u", MAX_MESSAGE_LATENCY_COMMANDS - 1)].nCount, 1U);
+    BOOST_CHECK(!mapStats.count(strprintf("cmd%u", MAX_MESSAGE_LATENCY_COMMANDS)));
+    BOOST_CHECK_EQUAL(mapStats["other"].nCount, 10U);
+    BOOST_CHECK(GetMessageLatencyStats().empty());
+}
+
+BOOST_AUTO_TEST_CASE(complete_message_wakes_handler)
+{
+    CAddress addr(CService("127.0.0.1", 0));
+    CNode node(INVALID_SOCKET, addr, "", true);
+    std::vector<char> vMsg = EmptyMessage("ping");
+    WaitForMessageHandlerWake(0);
+
+    // A partial header leaves nothing for the handler to do
+    BOOST_REQUIRE(node.ReceiveMsgBytes(&vMsg[0], 10));
+    BOOST_CHECK(!WaitForMessageHandlerWake(0));
+
+    CWaiter waiter;
+    BOOST_REQUIRE(NewThread(ThreadWaiter, &waiter));
+    MilliSleep(50);
+    BOOST_CHECK(!waiter.fDone);
+
+    BOOST_REQUIRE(node.ReceiveMsgBytes(&vMsg[10], vMsg.size() - 10));
+    BOOST_CHECK(node.vRecvMsg.back().complete());
+    while (!waiter.fDone)
+        MilliSleep(1);
+    BOOST_CHECK(waiter.fWoken);
+
+    // The wake was consumed
+    BOOST_CHECK(!WaitForMessageHandlerWake(0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,70 @@
+// Random points and scalars for the multi-scalar multiplication tests and
+// benchmark, with the edge cases the engine must handle mixed in, and the
+// naive sum of EC_POINT_mul terms to compare against.
+#ifndef INNOVA_TEST_MSM_TERMS_H
+#define INNOVA_TEST_MSM_TERMS_H
+
+#include "../msm.h"
+#include "../util.h"
+
+#include <openssl/obj_mac.h>
+
+struct CMSMTestTerms
+{
+    EC_GROUP* group;
+    BN_CTX* ctx;
+    std::vector<EC_POINT*> vPoint;
+    std::vector<BIGNUM*> vScalar;
+
+    CMSMTestTerms(size_t n)
+    {
+        group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+        ctx = BN_CTX_new();
+        const BIGNUM* order = EC_GROUP_get0_order(group);
+        for (size_t i = 0; i < n; i++)
+        {
+            BIGNUM* k = BN_new();
+            BN_rand_range(k, order);
+            EC_POINT* p = EC_POINT_new(group);
+            EC_POINT_mul(group, p, k, NULL, NULL, ctx);
+            BN_free(k);
+            BIGNUM* s = BN_new();
+            BN_rand_range(s, order);
+            vPoint.push_back(p);
+            vScalar.push_back(s);
+        }
+        if (n >= 6)
+        {
+            BN_zero(vScalar[0]);
+            EC_POINT_set_to_infinity(group, vPoint[1]);
+            BN_add(vScalar[2], vScalar[2], order);          // above the order
+            BN_sub(vScalar[3], order, BN_value_one());      // order - 1: all high digits
+            EC_POINT_copy(vPoint[4], vPoint[5]);            // same point twice
+            BN_set_word(vScalar[5], 1);
+        }
+    }
+
+    ~CMSMTestTerms()
+    {
+        for (size_t i = 0; i < vPoint.size(); i++)
+        {
+            EC_POINT_free(vPoint[i]);
+            BN_free(vScalar[i]);
+        }
+        BN_CTX_free(ctx);
+        EC_GROUP_free(group);
+    }
+
+    bool Naive(EC_POINT* result)
+    {
+        EC_POINT* term = EC_POINT_new(group);
+        bool fOk = EC_POINT_set_to_infinity(group, result) == 1;
+        for (size_t i = 0; i < vPoint.size() && fOk; i++)
+            fOk = EC_POINT_mul(group, term, NULL, vPoint[i], vScalar[i], ctx) == 1 &&
+                  EC_POINT_add(group, result, result, term, ctx) == 1;
+        EC_POINT_free(term);
+        return fOk;
+    }
+};
+
+#endif
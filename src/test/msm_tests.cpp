@@ -0,0 +1,79 @@
+// Tests for the shared multi-scalar multiplication engine: the bucket method,
+// split over threads or not, and the fixed base tables all equal the naive
+// sum of EC_POINT_mul terms, including zero scalars, identity points,
+// scalars at or above the group order and repeated points. Throughput by
+// size is measured in bench/msm_bench.cpp.
+
+#include <boost/test/unit_test.hpp>
+
+#include "msm_terms.h"
+
+BOOST_AUTO_TEST_SUITE(msm_tests)
+
+BOOST_AUTO_TEST_CASE(msm_matches_naive)
+{
+    const size_t vSize[] = { 1, 2, 6, 33, 130, 257, 1000, 2053 };
+    for (unsigned int k = 0; k < sizeof(vSize) / sizeof(vSize[0]); k++)
+    {
+        CMSMTestTerms terms(vSize[k]);
+        EC_POINT* naive = EC_POINT_new(terms.group);
+        EC_POINT* result = EC_POINT_new(terms.group);
+        BOOST_REQUIRE(terms.Naive(naive));
+
+        BOOST_REQUIRE(MultiScalarMul(terms.group, terms.ctx, terms.vPoint, terms.vScalar, result));
+        BOOST_CHECK_MESSAGE(EC_POINT_cmp(terms.group, naive, result, terms.ctx) == 0, "mismatch at n=" << vSize[k]);
+        BOOST_REQUIRE(MultiScalarMul(terms.group, terms.ctx, terms.vPoint, terms.vScalar, result, 4));
+        BOOST_CHECK_MESSAGE(EC_POINT_cmp(terms.group, naive, result, terms.ctx) == 0, "threaded mismatch at n=" << vSize[k]);
+
+        CMSMFixedBase table;
+        BOOST_REQUIRE(table.Init(terms.group, terms.vPoint, terms.ctx));
+        BOOST_REQUIRE(table.Mul(terms.group, terms.ctx, terms.vScalar, result));
+        BOOST_CHECK_MESSAGE(EC_POINT_cmp(terms.group, naive, result, terms.ctx) == 0, "fixed base mismatch at n=" << vSize[k]);
+        BOOST_REQUIRE(table.Mul(terms.group, terms.ctx, terms.vScalar, result, 3));
+        BOOST_CHECK_MESSAGE(EC_POINT_cmp(terms.group, naive, result, terms.ctx) == 0, "threaded fixed base mismatch at n=" << vSize[k]);
+
+        EC_POINT_free(naive);
+        EC_POINT_free(result);
+    }
+
+    // Nothing to add is the identity, and mismatched inputs are refused
+    CMSMTestTerms terms(3);
+    EC_POINT* result = EC_POINT_new(terms.group);
+    BOOST_CHECK(MultiScalarMul(terms.group, terms.ctx, std::vector<EC_POINT*>(), std::vector<BIGNUM*>(), result));
+    BOOST_CHECK(EC_POINT_is_at_infinity(terms.group, result));
+    terms.vScalar.pop_back();
+    BOOST_CHECK(!MultiScalarMul(terms.group, terms.ctx, terms.vPoint, terms.vScalar, result));
+    EC_POINT_free(result);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_base_registry)
+{
+    CMSMTestTerms terms(40);
+    std::vector<std::vector<unsigned char> > vBytes(terms.vPoint.size());
+    for (size_t i = 2; i < terms.vPoint.size(); i++)
+    {
+        vBytes[i].resize(33);
+        EC_POINT_point2oct(terms.group, terms.vPoint[i], POINT_CONVERSION_COMPRESSED, &vBytes[i][0], 33, terms.ctx);
+    }
+    BOOST_CHECK(GetMSMFixedBase("msm_tests.bad", vBytes) == NULL);
+
+    // Drop the identity point, which has no compressed form
+    terms.vPoint.erase(terms.vPoint.begin(), terms.vPoint.begin() + 2);
+    terms.vScalar.erase(terms.vScalar.begin(), terms.vScalar.begin() + 2);
+    vBytes.erase(vBytes.begin(), vBytes.begin() + 2);
+    const CMSMFixedBase* pTable = GetMSMFixedBase("msm_tests.good", vBytes);
+    BOOST_REQUIRE(pTable);
+    BOOST_CHECK(GetMSMFixedBase("msm_tests.good", std::vector<std::vector<unsigned char> >()) == pTable);
+    BOOST_CHECK_EQUAL(pTable->size(), vBytes.size());
+    BOOST_CHECK(EC_POINT_cmp(terms.group, pTable->GetBase(5), terms.vPoint[5], terms.ctx) == 0);
+
+    EC_POINT* naive = EC_POINT_new(terms.group);
+    EC_POINT* result = EC_POINT_new(terms.group);
+    BOOST_REQUIRE(terms.Naive(naive));
+    BOOST_REQUIRE(pTable->Mul(terms.group, terms.ctx, terms.vScalar, result));
+    BOOST_CHECK(EC_POINT_cmp(terms.group, naive, result, terms.ctx) == 0);
+    EC_POINT_free(naive);
+    EC_POINT_free(result);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
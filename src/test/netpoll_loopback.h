@@ -0,0 +1,122 @@
+// Loopback connections and a read loop driving CSocketPoller, shared by
+// test/netpoll_tests.cpp and bench/netpoll_bench.cpp.
+#ifndef INNOVA_TEST_NETPOLL_LOOPBACK_H
+#define INNOVA_TEST_NETPOLL_LOOPBACK_H
+
+#include <boost/test/unit_test.hpp>
+
+#include <ctime>
+#include <vector>
+
+#include "../netpoll.h"
+#include "../util.h"
+
+struct LoopbackPeers
+{
+    std::vector<SOCKET> vClient;
+    std::vector<SOCKET> vServer;
+
+    explicit LoopbackPeers(int nPeers)
+    {
+        SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        BOOST_REQUIRE(hListen != INVALID_SOCKET);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        BOOST_REQUIRE(bind(hListen, (struct sockaddr*)&addr, len) == 0);
+        BOOST_REQUIRE(listen(hListen, 64) == 0);
+        BOOST_REQUIRE(getsockname(hListen, (struct sockaddr*)&addr, &len) == 0);
+
+        for (int i = 0; i < nPeers; i++)
+        {
+            SOCKET hClient = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            BOOST_REQUIRE(hClient != INVALID_SOCKET);
+            BOOST_REQUIRE(connect(hClient, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+            SOCKET hServer = accept(hListen, NULL, NULL);
+            BOOST_REQUIRE(hServer != INVALID_SOCKET);
+            fcntl(hServer, F_SETFL, fcntl(hServer, F_GETFL, 0) | O_NONBLOCK);
+            vClient.push_back(hClient);
+            vServer.push_back(hServer);
+        }
+        closesocket(hListen);
+    }
+
+    ~LoopbackPeers()
+    {
+        for (unsigned int i = 0; i < vClient.size(); i++)
+        {
+            closesocket(vClient[i]);
+            closesocket(vServer[i]);
+        }
+    }
+};
+
+// Drain a readable socket the way ThreadSocketHandler does. Returns the
+// bytes read and whether the socket may still have more.
+inline int ReadAvailable(SOCKET hSocket, bool& fReadable)
+{
+    int nTotal = 0;
+    char pchBuf[0x10000];
+    while (fReadable)
+    {
+        int nBytes = recv(hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+        if (nBytes > 0)
+            nTotal += nBytes;
+        if (nBytes < (int)sizeof(pchBuf))
+            fReadable = false;
+    }
+    return nTotal;
+}
+
+// Write nRounds batches of nActive small messages to rotating peers and read
+// them back through the poller. Returns CPU microseconds per message.
+inline double RunMessages(bool fEdgeTriggered, LoopbackPeers& peers, int nRounds, int nActive)
+{
+    const int nMessageSize = 64;
+    const char pchMessage[nMessageSize] = {};
+    int nPeers = peers.vServer.size();
+
+    CSocketPoller poller(fEdgeTriggered);
+    BOOST_REQUIRE(poller.IsEdgeTriggered() == fEdgeTriggered);
+    std::vector<char> vReadable(nPeers, 0);
+    for (int i = 0; i < nPeers; i++)
+        BOOST_REQUIRE(poller.Add(peers.vServer[i], &vReadable[i]));
+
+    int64_t nReceived = 0;
+    int nNext = 0;
+    clock_t nStart = clock();
+    for (int nRound = 0; nRound < nRounds; nRound++)
+    {
+        for (int i = 0; i < nActive; i++)
+        {
+            BOOST_REQUIRE(send(peers.vClient[nNext], pchMessage, nMessageSize, MSG_NOSIGNAL) == nMessageSize);
+            nNext = (nNext + 37) % nPeers;
+        }
+
+        int64_t nExpected = (int64_t)(nRound + 1) * nActive * nMessageSize;
+        while (nReceived < nExpected)
+        {
+            if (!poller.IsEdgeTriggered())
+                for (int i = 0; i < nPeers; i++)
+                    poller.SetInterest(peers.vServer[i], &vReadable[i], CSocketPoller::POLL_READ);
+            std::vector<std::pair<void*, int> > vReady;
+            BOOST_REQUIRE(poller.Wait(1000, vReady) >= 0);
+            BOOST_REQUIRE(!vReady.empty());
+            for (unsigned int i = 0; i < vReady.size(); i++)
+            {
+                int nPeer = (char*)vReady[i].first - &vReadable[0];
+                BOOST_REQUIRE(nPeer >= 0 && nPeer < nPeers);
+                bool fReadable = true;
+                nReceived += ReadAvailable(peers.vServer[nPeer], fReadable);
+            }
+        }
+        BOOST_CHECK_EQUAL(nReceived, nExpected);
+    }
+    double dCpu = (double)(clock() - nStart) / CLOCKS_PER_SEC;
+    return dCpu * 1000000.0 / ((double)nRounds * nActive);
+}
+
+#endif
@@ -0,0 +1,108 @@
+// Tests for the batched Bulletproof range proof verifier (zkproof.cpp): a
+// batch of valid proofs is accepted, and any tampered proof or mismatched
+// commitment is rejected with the same index the serial verifier would stop at.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../zkproof.h"
+
+#include <vector>
+
+namespace {
+
+void MakeRangeProofs(int nCount,
+                     std::vector<CPedersenCommitment>& vCommits,
+                     std::vector<CBulletproofRangeProof>& vProofs)
+{
+    for (int i = 0; i < nCount; i++)
+    {
+        int64_t nValue = 1000 + 37 * i;
+        std::vector<unsigned char> vchBlind;
+        BOOST_REQUIRE(GenerateBlindingFactor(vchBlind));
+        CPedersenCommitment commit;
+        BOOST_REQUIRE(CreatePedersenCommitment(nValue, vchBlind, commit));
+        CBulletproofRangeProof proof;
+        BOOST_REQUIRE(CreateBulletproofRangeProof(nValue, vchBlind, commit, proof));
+        vCommits.push_back(commit);
+        vProofs.push_back(proof);
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(rangeproof_batch_tests)
+
+BOOST_AUTO_TEST_CASE(batch_accepts_valid_proofs)
+{
+    BOOST_REQUIRE(CZKContext::Initialize());
+
+    std::vector<CPedersenCommitment> vCommits;
+    std::vector<CBulletproofRangeProof> vProofs;
+    MakeRangeProofs(4, vCommits, vProofs);
+
+    BOOST_CHECK(BatchVerifyBulletproofRangeProofs(vCommits, vProofs));
+    BOOST_CHECK(BatchVerifyBulletproofRangeProofs(std::vector<CPedersenCommitment>(),
+                                                  std::vector<CBulletproofRangeProof>()));
+
+    // A commitment/proof count mismatch is never a valid batch.
+    vCommits.pop_back();
+    BOOST_CHECK(!BatchVerifyBulletproofRangeProofs(vCommits, vProofs));
+}
+
+BOOST_AUTO_TEST_CASE(batch_reports_first_bad_proof)
+{
+    BOOST_REQUIRE(CZKContext::Initialize());
+
+    std::vector<CPedersenCommitment> vCommits;
+    std::vector<CBulletproofRangeProof> vProofs;
+    MakeRangeProofs(4, vCommits, vProofs);
+
+    // Flip a bit of t_hat (first equation) in proof 2.
+    std::vector<CBulletproofRangeProof> vTampered(vProofs);
+    vTampered[2].vchProof[4 * 33 + 2 * 32 + 31] ^= 1;
+    size_t nBad = 99;
+    BOOST_CHECK(!BatchVerifyBulletproofRangeProofs(vCommits, vTampered, &nBad));
+    BOOST_CHECK_EQUAL(nBad, 2U);
+
+    // Flip a bit of the final inner-product scalar (second equation) in proof 3.
+    vTampered = vProofs;
+    vTampered[3].vchProof[vTampered[3].vchProof.size() - 40] ^= 1;
+    BOOST_CHECK(!BatchVerifyBulletproofRangeProofs(vCommits, vTampered, &nBad));
+    BOOST_CHECK_EQUAL(nBad, 3U);
+
+    // A truncated proof cannot join the batch and is judged on its own.
+    vTampered = vProofs;
+    vTampered[1].vchProof.resize(100);
+    BOOST_CHECK(!BatchVerifyBulletproofRangeProofs(vCommits, vTampered, &nBad));
+    BOOST_CHECK_EQUAL(nBad, 1U);
+
+    // Proofs bound to the wrong commitments.
+    std::vector<CPedersenCommitment> vSwapped(vCommits);
+    std::swap(vSwapped[0], vSwapped[1]);
+    BOOST_CHECK(!BatchVerifyBulletproofRangeProofs(vSwapped, vProofs, &nBad));
+    BOOST_CHECK_EQUAL(nBad, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(range_proof_batch_collects_entries)
+{
+    BOOST_REQUIRE(CZKContext::Initialize());
+
+    std::vector<CPedersenCommitment> vCommits;
+    std::vector<CBulletproofRangeProof> vProofs;
+    MakeRangeProofs(3, vCommits, vProofs);
+
+    CRangeProofBatch batch;
+    BOOST_CHECK(batch.IsEmpty());
+    batch.Add(vCommits[0], vProofs[0], 1, "shielded output 0");
+    batch.Add(vCommits[1], vProofs[1], 4, "shielded output 0");
+    batch.Add(vCommits[1], vProofs[2], 4, "shielded output 1");
+    BOOST_CHECK_EQUAL(batch.Size(), 3U);
+
+    size_t nBad = 0;
+    BOOST_CHECK(!batch.Verify(nBad));
+    BOOST_CHECK_EQUAL(nBad, 2U);
+    BOOST_CHECK_EQUAL(batch.vTx[nBad], 4U);
+    BOOST_CHECK_EQUAL(batch.vDescription[nBad], "shielded output 1");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
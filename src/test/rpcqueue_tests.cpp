@@ -0,0 +1,148 @@
+// Tests for CRPCWorkQueue: connections beyond the queue limit are refused,
+// queued work drains before the workers exit, and ParallelFor() both
+// finishes without any free worker and spreads a batch over idle ones.
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/thread.hpp>
+#include <set>
+
+#include "../rpcqueue.h"
+#include "../util.h"
+
+namespace
+{
+
+struct WorkerPool
+{
+    CRPCWorkQueue& queue;
+    boost::thread_group threads;
+
+    WorkerPool(CRPCWorkQueue& queueIn, int nThreads) : queue(queueIn)
+    {
+        for (int i = 0; i < nThreads; i++)
+            threads.create_thread(boost::bind(&CRPCWorkQueue::Run, &queue));
+        while (queue.GetStats().nIdle < nThreads)
+            MilliSleep(1);
+    }
+
+    ~WorkerPool()
+    {
+        queue.Interrupt();
+        threads.join_all();
+    }
+};
+
+void Count(boost::mutex* mutex, int* pnCount)
+{
+    boost::unique_lock<boost::mutex> lock(*mutex);
+    (*pnCount)++;
+}
+
+void Block(boost::mutex* mutex, boost::condition_variable* cond, bool* pfRelease)
+{
+    boost::unique_lock<boost::mutex> lock(*mutex);
+    while (!*pfRelease)
+        cond->wait(lock);
+}
+
+void SleepItem(std::vector<boost::thread::id>* pvThread, unsigned int n)
+{
+    MilliSleep(20);
+    (*pvThread)[n] = boost::this_thread::get_id();
+}
+
+// Counts the runs of each item and the threads that ran them. Every item
+// waits for a second thread to join the batch, so the caller cannot finish it
+// alone before an idle worker picks up its share.
+struct BatchItems
+{
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::vector<int> vRuns;
+    std::set<boost::thread::id> setThreads;
+
+    explicit BatchItems(unsigned int nItems) : vRuns(nItems, 0) {}
+
+    void Run(unsigned int n)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        vRuns[n]++;
+        setThreads.insert(boost::this_thread::get_id());
+        cond.notify_all();
+        // Bounded only so a broken queue fails the checks instead of hanging
+        boost::system_time timeout = boost::get_system_time() + boost::posix_time::seconds(30);
+        while (setThreads.size() < 2)
+            if (!cond.timed_wait(lock, timeout))
+                break;
+    }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(rpcqueue_tests)
+
+BOOST_AUTO_TEST_CASE(bounded_depth)
+{
+    CRPCWorkQueue queue(3);
+    boost::mutex mutex;
+    int nCount = 0;
+    for (int i = 0; i < 3; i++)
+        BOOST_CHECK(queue.Enqueue(boost::bind(&Count, &mutex, &nCount)));
+    BOOST_CHECK(!queue.Enqueue(boost::bind(&Count, &mutex, &nCount)));
+
+    CRPCWorkQueue::Stats stats = queue.GetStats();
+    BOOST_CHECK_EQUAL(stats.nDepth, 3);
+    BOOST_CHECK_EQUAL(stats.nPeakDepth, 3);
+    BOOST_CHECK_EQUAL(stats.nRejected, 1);
+
+    // Everything accepted runs, even when the workers are told to stop first
+    queue.Interrupt();
+    BOOST_CHECK(!queue.Enqueue(boost::bind(&Count, &mutex, &nCount)));
+    queue.Run();
+    BOOST_CHECK_EQUAL(nCount, 3);
+    BOOST_CHECK_EQUAL(queue.Depth(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_without_free_workers)
+{
+    CRPCWorkQueue queue(4);
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    bool fRelease = false;
+    {
+        WorkerPool pool(queue, 1);
+        BOOST_REQUIRE(queue.Enqueue(boost::bind(&Block, &mutex, &cond, &fRelease)));
+        while (queue.GetStats().nIdle > 0)
+            MilliSleep(1);
+
+        // The only worker is busy, so the caller runs every item itself
+        std::vector<boost::thread::id> vThread(5);
+        queue.ParallelFor(vThread.size(), std::bind(&SleepItem, &vThread, std::placeholders::_1));
+        for (unsigned int i = 0; i < vThread.size(); i++)
+            BOOST_CHECK(vThread[i] == boost::this_thread::get_id());
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fRelease = true;
+            cond.notify_all();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_spreads_batch)
+{
+    const int nThreads = 4;
+    const unsigned int nItems = 16;
+    CRPCWorkQueue queue(16);
+    WorkerPool pool(queue, nThreads);
+
+    BatchItems items(nItems);
+    queue.ParallelFor(nItems, std::bind(&BatchItems::Run, &items, std::placeholders::_1));
+
+    for (unsigned int i = 0; i < nItems; i++)
+        BOOST_CHECK_EQUAL(items.vRuns[i], 1);
+    BOOST_CHECK(items.setThreads.size() > 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+// Tests for the txindex/transaction cache in front of CTxDB: read fills are
+// refused once a write has raced them, committed entries replace stale ones,
+// transactions only match at their own disk position, and the byte budget is
+// enforced least-recently-used first. The raw block cache shares its entries
+// and evicts the same way.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../main.h"
+#include "../txcache.h"
+
+BOOST_AUTO_TEST_SUITE(txcache_tests)
+
+BOOST_AUTO_TEST_CASE(txcache_index_fill_and_commit)
+{
+    CTxIndexCache cache;
+    cache.SetMaxSize(1 << 20);
+
+    uint256 hash(777);
+    CTxIndex txindex(CDiskTxPos(1, 100, 180), 2);
+    CTxIndex result;
+    BOOST_CHECK(!cache.GetIndex(hash, result));
+
+    // A lookup that started before a write must not cache what it read.
+    uint64_t nGeneration = cache.GetGeneration();
+    cache.BeginWrite(std::vector<uint256>(1, hash));
+    cache.FillIndex(nGeneration, hash, txindex);
+    BOOST_CHECK(!cache.GetIndex(hash, result));
+
+    cache.FillIndex(cache.GetGeneration(), hash, txindex);
+    BOOST_REQUIRE(cache.GetIndex(hash, result));
+    BOOST_CHECK(result.pos == txindex.pos);
+    BOOST_CHECK(result.vSpent[1].IsNull());
+
+    // Spending an output commits the new entry over the cached one.
+    CTxIndex spent = txindex;
+    spent.vSpent[1] = CDiskTxPos(1, 200, 281);
+    cache.BeginWrite(std::vector<uint256>(1, hash));
+    BOOST_CHECK(!cache.GetIndex(hash, result));
+    cache.CommitIndex(hash, &spent);
+    BOOST_REQUIRE(cache.GetIndex(hash, result));
+    BOOST_CHECK(result.vSpent[1] == spent.vSpent[1]);
+
+    cache.CommitIndex(hash, NULL);
+    BOOST_CHECK(!cache.GetIndex(hash, result));
+
+    CTxCacheStats stats;
+    cache.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nIndexHits, 2U);
+    BOOST_CHECK_EQUAL(stats.nIndexMisses, 4U);
+    BOOST_CHECK_EQUAL(stats.nIndexEntries, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(txcache_tx_position_and_budget)
+{
+    CTxIndexCache cache;
+    cache.SetMaxSize(64 * 1024);
+
+    CTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256(9), 0);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = COIN;
+    uint256 hash = tx.GetHash();
+    CDiskTxPos pos(1, 500, 581);
+
+    CTransaction result;
+    cache.PutTx(hash, pos, tx);
+    BOOST_REQUIRE(cache.GetTx(hash, pos, result));
+    BOOST_CHECK(result.GetHash() == hash);
+    BOOST_CHECK(!cache.GetTx(hash, CDiskTxPos(2, 500, 581), result));
+
+    // Fill well past the budget; the oldest entries go first.
+    for (int i = 0; i < 2000; i++)
+        cache.FillIndex(cache.GetGeneration(), uint256(10000 + i), CTxIndex(CDiskTxPos(1, i, i), 4));
+
+    CTxCacheStats stats;
+    cache.GetStats(stats);
+    BOOST_CHECK(stats.nBytes <= stats.nMaxBytes);
+    BOOST_CHECK(stats.nEvictions > 0);
+    BOOST_CHECK(!cache.GetTx(hash, pos, result));
+    CTxIndex txindex;
+    BOOST_CHECK(cache.GetIndex(uint256(10000 + 1999), txindex));
+    BOOST_CHECK(!cache.GetIndex(uint256(10000), txindex));
+
+    cache.SetMaxSize(0);
+    BOOST_CHECK(!cache.Enabled());
+    BOOST_CHECK(!cache.GetIndex(uint256(10000 + 1999), txindex));
+}
+
+BOOST_AUTO_TEST_CASE(rawblockcache_shares_and_evicts)
+{
+    CRawBlockCache cache;
+    cache.SetMaxSize(100 * 1024);
+
+    CRawBlockCache::BlockData pblock(new std::vector<char>(10 * 1024, 'b'));
+    cache.Put(uint256(1), pblock);
+    CRawBlockCache::BlockData pcached = cache.Get(uint256(1));
+    BOOST_CHECK(pcached == pblock);
+    BOOST_CHECK(!cache.Get(uint256(2)));
+
+    // Larger than a quarter of the budget: not kept.
+    cache.Put(uint256(2), CRawBlockCache::BlockData(new std::vector<char>(30 * 1024)));
+    BOOST_CHECK(!cache.Get(uint256(2)));
+
+    // Block 1 was used last, so block 3 is the first to go.
+    cache.Put(uint256(3), CRawBlockCache::BlockData(new std::vector<char>(10 * 1024)));
+    for (int i = 0; i < 8; i++)
+    {
+        BOOST_CHECK(cache.Get(uint256(1)));
+        cache.Put(uint256(100 + i), CRawBlockCache::BlockData(new std::vector<char>(10 * 1024)));
+    }
+    BOOST_CHECK(cache.Get(uint256(1)));
+    BOOST_CHECK(!cache.Get(uint256(3)));
+
+    CRawBlockCacheStats stats;
+    cache.GetStats(stats);
+    BOOST_CHECK(stats.nBytes <= stats.nMaxBytes);
+    BOOST_CHECK(stats.nEvictions > 0);
+
+    // Evicted data stays valid for whoever still holds it.
+    cache.Clear();
+    BOOST_CHECK_EQUAL(pcached->size(), 10 * 1024U);
+    BOOST_CHECK(!cache.Get(uint256(1)));
+}
+
+BOOST_AUTO_TEST_CASE(rawblock_disk_encoding_is_wire_encoding)
+{
+    // getdata serves blocks exactly as WriteToDisk() stored them.
+    CBlock block;
+    block.nTime = 1700000000;
+    block.nBits = 0x1e0fffff;
+    block.vtx.resize(1);
+    block.vtx[0].vin.resize(1);
+    block.vtx[0].vin[0].scriptSig = CScript() << OP_0 << OP_0;
+    block.vtx[0].vout.resize(1);
+    block.vtx[0].vout[0].nValue = 5 * COIN;
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    block.vchBlockSig.assign(71, 0x30);
+
+    CDataStream ssDisk(SER_DISK, CLIENT_VERSION);
+    ssDisk << block;
+    CDataStream ssWire(SER_NETWORK, PROTOCOL_VERSION);
+    ssWire << block;
+    BOOST_CHECK(std::vector<char>(ssDisk.begin(), ssDisk.end()) == std::vector<char>(ssWire.begin(), ssWire.end()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
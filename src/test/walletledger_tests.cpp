@@ -0,0 +1,60 @@
+// Tests for the wallet balance ledger: balances and the coins AvailableCoins()
+// returns follow transactions being added, spent, unspent and erased without
+// a rescan of mapWallet.
+
+#include <boost/test/unit_test.hpp>
+
+#include "../main.h"
+#include "../wallet.h"
+
+BOOST_AUTO_TEST_SUITE(walletledger_tests)
+
+BOOST_AUTO_TEST_CASE(balance_ledger)
+{
+    CWallet ledgerWallet;
+    LOCK2(cs_main, ledgerWallet.cs_wallet);
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_CHECK(ledgerWallet.AddKeyPubKey(key, key.GetPubKey()));
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+
+    // Three payments to us waiting in the mempool, each with an output that
+    // isn't ours
+    std::vector<uint256> vHash;
+    for (int i = 1; i <= 3; i++)
+    {
+        CWalletTx wtx(&ledgerWallet);
+        wtx.vout.push_back(CTxOut(i * COIN, scriptMine));
+        wtx.vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+        uint256 hash = wtx.GetHash();
+        BOOST_CHECK(mempool.addUnchecked(hash, wtx));
+        ledgerWallet.mapWallet[hash] = wtx;
+        ledgerWallet.mapWallet[hash].BindWallet(&ledgerWallet);
+        vHash.push_back(hash);
+    }
+    BOOST_CHECK_EQUAL(ledgerWallet.GetUnconfirmedBalance(), 6 * COIN);
+    BOOST_CHECK_EQUAL(ledgerWallet.GetBalance(), 0);
+
+    std::vector<COutput> vAvailable;
+    ledgerWallet.AvailableCoins(vAvailable, false);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 3U);
+
+    // Spending and unspending are picked up without a rescan
+    ledgerWallet.mapWallet[vHash[1]].MarkSpent(0);
+    BOOST_CHECK_EQUAL(ledgerWallet.GetUnconfirmedBalance(), 4 * COIN);
+    ledgerWallet.AvailableCoins(vAvailable, false);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 2U);
+    ledgerWallet.mapWallet[vHash[1]].MarkUnspent(0);
+    BOOST_CHECK_EQUAL(ledgerWallet.GetUnconfirmedBalance(), 6 * COIN);
+
+    // As is a tx leaving the wallet, marked or not
+    ledgerWallet.mapWallet.erase(vHash[2]);
+    BOOST_CHECK_EQUAL(ledgerWallet.GetUnconfirmedBalance(), 3 * COIN);
+    ledgerWallet.mapWallet.erase(vHash[0]);
+    ledgerWallet.MarkBalanceDirty(vHash[0]);
+    BOOST_CHECK_EQUAL(ledgerWallet.GetBalances().nUnconfirmed, 2 * COIN);
+
+    mempool.clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
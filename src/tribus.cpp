@@ -0,0 +1,514 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "tribus.h"
+#include "hashblock.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define TRIBUS_SSE2 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+namespace
+{
+
+enum
+{
+    TRIBUS_KERNEL_GENERIC,  // sph functions from the JH midstate
+    TRIBUS_KERNEL_SSE2,     // SSE2 JH, sph ECHO
+    TRIBUS_KERNEL_AESNI,    // SSE2 JH, AES-NI ECHO
+};
+
+const char* const pszKernelName[] = { "generic", "sse2", "sse2+aesni" };
+
+inline void WriteLE32(unsigned char* p, uint32_t n)
+{
+    p[0] = n;
+    p[1] = n >> 8;
+    p[2] = n >> 16;
+    p[3] = n >> 24;
+}
+
+/** Keccak512 then ECHO512 of a JH512 output, trimmed to the PoW hash */
+void FinishGeneric(const unsigned char* pJH, uint256& hash)
+{
+    sph_keccak512_context ctx_keccak;
+    sph_echo512_context ctx_echo;
+    uint512 hashKeccak, hashEcho;
+
+    sph_keccak512_init(&ctx_keccak);
+    sph_keccak512(&ctx_keccak, pJH, 64);
+    sph_keccak512_close(&ctx_keccak, static_cast<void*>(&hashKeccak));
+
+    sph_echo512_init(&ctx_echo);
+    sph_echo512(&ctx_echo, static_cast<const void*>(&hashKeccak), 64);
+    sph_echo512_close(&ctx_echo, static_cast<void*>(&hashEcho));
+    hash = hashEcho.trim256();
+}
+
+void HashGeneric(const sph_jh512_context& ctxMid, const unsigned char* pTail, const uint32_t* pNonce, uint256* pHash)
+{
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+    {
+        unsigned char vchTail[16];
+        memcpy(vchTail, pTail, 12);
+        WriteLE32(vchTail + 12, pNonce[k]);
+
+        sph_jh512_context ctx = ctxMid;
+        unsigned char vchJH[64];
+        sph_jh512(&ctx, vchTail, 16);
+        sph_jh512_close(&ctx, vchJH);
+        FinishGeneric(vchJH, pHash[k]);
+    }
+}
+
+#ifdef TRIBUS_SSE2
+
+/* JH512 in the bitsliced form of jh.c with each (high, low) word pair of the
+ * state in one SSE2 register. These are jh.c's round constants in that order:
+ * even high, even low, odd high, odd low for each of the 42 rounds. */
+const uint64_t JH_C[168] __attribute__((aligned(16))) = {
+    0x67f815dfa2ded572ULL, 0x571523b70a15847bULL, 0xf6875a4d90d6ab81ULL, 0x402bd1c3c54f9f4eULL,
+    0x9cfa455ce03a98eaULL, 0x9a99b26699d2c503ULL, 0x8a53bbf2b4960266ULL, 0x31a2db881a1456b5ULL,
+    0xdb0e199a5c5aa303ULL, 0x1044c1870ab23f40ULL, 0x1d959e848019051cULL, 0xdccde75eadeb336fULL,
+    0x416bbf029213ba10ULL, 0xd027bbf7156578dcULL, 0x5078aa3739812c0aULL, 0xd3910041d2bf1a3fULL,
+    0x907eccf60d5a2d42ULL, 0xce97c0929c9f62ddULL, 0xac442bc70ba75c18ULL, 0x23fcc663d665dfd1ULL,
+    0x1ab8e09e036c6e97ULL, 0xa8ec6c447e450521ULL, 0xfa618e5dbb03f1eeULL, 0x97818394b29796fdULL,
+    0x2f3003db37858e4aULL, 0x956a9ffb2d8d672aULL, 0x6c69b8f88173fe8aULL, 0x14427fc04672c78aULL,
+    0xc45ec7bd8f15f4c5ULL, 0x80bb118fa76f4475ULL, 0xbc88e4aeb775de52ULL, 0xf4a3a6981e00b882ULL,
+    0x1563a3a9338ff48eULL, 0x89f9b7d524565faaULL, 0xfde05a7c20edf1b6ULL, 0x362c42065ae9ca36ULL,
+    0x3d98fe4e433529ceULL, 0xa74b9a7374f93a53ULL, 0x86814e6f591ff5d0ULL, 0x9f5ad8af81ad9d0eULL,
+    0x6a6234ee670605a7ULL, 0x2717b96ebe280b8bULL, 0x3f1080c626077447ULL, 0x7b487ec66f7ea0e0ULL,
+    0xc0a4f84aa50a550dULL, 0x9ef18e979fe7e391ULL, 0xd48d605081727686ULL, 0x62b0e5f3415a9e7eULL,
+    0x7a205440ec1f9ffcULL, 0x84c9f4ce001ae4e3ULL, 0xd895fa9df594d74fULL, 0xa554c324117e2e55ULL,
+    0x286efebd2872df5bULL, 0xb2c4a50fe27ff578ULL, 0x2ed349eeef7c8905ULL, 0x7f5928eb85937e44ULL,
+    0x4a3124b337695f70ULL, 0x65e4d61df128865eULL, 0xe720b95104771bc7ULL, 0x8a87d423e843fe74ULL,
+    0xf2947692a3e8297dULL, 0xc1d9309b097acbddULL, 0xe01bdc5bfb301b1dULL, 0xbf829cf24f4924daULL,
+    0xffbf70b431bae7a4ULL, 0x48bcf8de0544320dULL, 0x39d3bb5332fcae3bULL, 0xa08b29e0c1c39f45ULL,
+    0x0f09aef7fd05c9e5ULL, 0x34f1904212347094ULL, 0x95ed44e301b771a2ULL, 0x4a982f4f368e3be9ULL,
+    0x15f66ca0631d4088ULL, 0xffaf52874b44c147ULL, 0x30c60ae2f14abb7eULL, 0xe68c6eccc5b67046ULL,
+    0x00ca4fbd56a4d5a4ULL, 0xae183ec84b849ddaULL, 0xadd1643045ce5773ULL, 0x67255c1468cea6e8ULL,
+    0x16e10ecbf28cdaa3ULL, 0x9a99949a5806e933ULL, 0x7b846fc220b2601fULL, 0x1885d1a07facced1ULL,
+    0xd319dd8da15b5932ULL, 0x46b4a5aac01c9a50ULL, 0xba6b04e467633d9fULL, 0x7eee560bab19caf6ULL,
+    0x742128a9ea79b11fULL, 0xee51363b35f7bde9ULL, 0x76d350755aac571dULL, 0x01707da3fec2463aULL,
+    0x42d8a498afc135f7ULL, 0x79676b9e20eced78ULL, 0xa8db3aea15638341ULL, 0x832c83324d3bc3faULL,
+    0xf347271c1f3b40a7ULL, 0x9a762db734f04059ULL, 0xfd4f21d26c4e3ee7ULL, 0xef5957dc398dfdb8ULL,
+    0xdaeb492b490c9b8dULL, 0x0d70f36849d7a25bULL, 0x84558d7ad0ae3b7dULL, 0x658ef8e4f0e9a5f5ULL,
+    0x533b1036f4a2b8a0ULL, 0x5aec3e759e07a80cULL, 0x4f88e85692946891ULL, 0x4cbcbaf8555cb05bULL,
+    0x7b9487f3993bbbe3ULL, 0x5d1c6b72d6f4da75ULL, 0x6db334dc28acae64ULL, 0x71db28b850a5346cULL,
+    0x2a518d10f2e261f8ULL, 0xfc75dd593364dbe3ULL, 0xa23fce43f1bcac1cULL, 0xb043e8023cd1bb67ULL,
+    0x75a12988ca5b0a33ULL, 0x5c5316b44d19347fULL, 0x1e4d790ec3943b92ULL, 0x3fafeeb6d7757479ULL,
+    0x21391abef7d4a8eaULL, 0x5127234c097ef45cULL, 0xd23c32ba5324a326ULL, 0xadd5a66d4a17a344ULL,
+    0x08c9f2afa63e1db5ULL, 0x563c6b91983d5983ULL, 0x4d608672a17cf84cULL, 0xf6c76e08cc3ee246ULL,
+    0x5e76bcb1b333982fULL, 0x2ae6c4efa566d62bULL, 0x36d4c1bee8b6f406ULL, 0x6321efbc1582ee74ULL,
+    0x69c953f40d4ec1fdULL, 0x26585806c45a7da7ULL, 0x16fae0061614c17eULL, 0x3f9d63283daf907eULL,
+    0x0cd29b00e3f2c9d2ULL, 0x300cd4b730ceaa5fULL, 0x9832e0f216512a74ULL, 0x9af8cee3d830eb0dULL,
+    0x9279f1b57b9ec54bULL, 0xd36886046ee651ffULL, 0x316796e6574d239bULL, 0x05750a17f3a6e6ccULL,
+    0xce6c3213d98176b1ULL, 0x62a205f88452173cULL, 0x47154778b3cb2bf4ULL, 0x486a9323825446ffULL,
+    0x65655e4e0758df38ULL, 0x8e5086fc897cfcf2ULL, 0x86ca0bd0442e7031ULL, 0x4e477830a20940f0ULL,
+    0x8338f7d139eea065ULL, 0xbd3a2ce437e95ef7ULL, 0x6ff8130126b29721ULL, 0xe7de9fefd1ed44a3ULL,
+    0xd992257615dfa08bULL, 0xbe42dc12f6f7853cULL, 0x7eb027ab7ceca7d8ULL, 0xdea83eaada7d8d53ULL,
+    0xd86902bd93ce25aaULL, 0xf908731afd43f65aULL, 0xa5194a17daef5fc0ULL, 0x6a21fd4c33664d97ULL,
+    0x701541db3198b435ULL, 0x9b54cdedbb0f1eeaULL, 0x72409751a163d09aULL, 0xe26f4791bf9d75f6ULL
+};
+
+#define TRIBUS_INLINE inline __attribute__((always_inline))
+
+TRIBUS_INLINE void JHSb(__m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3, const __m128i c)
+{
+    const __m128i ones = _mm_set1_epi32(-1);
+    x3 = _mm_xor_si128(x3, ones);
+    x0 = _mm_xor_si128(x0, _mm_andnot_si128(x2, c));
+    __m128i tmp = _mm_xor_si128(c, _mm_and_si128(x0, x1));
+    x0 = _mm_xor_si128(x0, _mm_and_si128(x2, x3));
+    x3 = _mm_xor_si128(x3, _mm_andnot_si128(x1, x2));
+    x1 = _mm_xor_si128(x1, _mm_and_si128(x0, x2));
+    x2 = _mm_xor_si128(x2, _mm_andnot_si128(x3, x0));
+    x0 = _mm_xor_si128(x0, _mm_or_si128(x1, x3));
+    x3 = _mm_xor_si128(x3, _mm_and_si128(x1, x2));
+    x1 = _mm_xor_si128(x1, _mm_and_si128(tmp, x0));
+    x2 = _mm_xor_si128(x2, tmp);
+}
+
+TRIBUS_INLINE void JHLb(__m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3,
+                        __m128i& x4, __m128i& x5, __m128i& x6, __m128i& x7)
+{
+    x4 = _mm_xor_si128(x4, x1);
+    x5 = _mm_xor_si128(x5, x2);
+    x6 = _mm_xor_si128(x6, _mm_xor_si128(x3, x0));
+    x7 = _mm_xor_si128(x7, x0);
+    x0 = _mm_xor_si128(x0, x5);
+    x1 = _mm_xor_si128(x1, x6);
+    x2 = _mm_xor_si128(x2, _mm_xor_si128(x7, x4));
+    x3 = _mm_xor_si128(x3, x4);
+}
+
+template<int n>
+TRIBUS_INLINE __m128i JHWz(__m128i x, uint64_t c)
+{
+    const __m128i m = _mm_set1_epi64x(c);
+    __m128i t = _mm_slli_epi64(_mm_and_si128(x, m), n);
+    return _mm_or_si128(_mm_and_si128(_mm_srli_epi64(x, n), m), t);
+}
+
+template<int ro>
+TRIBUS_INLINE __m128i JHW(__m128i x)
+{
+    switch (ro)
+    {
+    case 0: return JHWz<1>(x, 0x5555555555555555ULL);
+    case 1: return JHWz<2>(x, 0x3333333333333333ULL);
+    case 2: return JHWz<4>(x, 0x0F0F0F0F0F0F0F0FULL);
+    case 3: return JHWz<8>(x, 0x00FF00FF00FF00FFULL);
+    case 4: return JHWz<16>(x, 0x0000FFFF0000FFFFULL);
+    case 5: return JHWz<32>(x, 0x00000000FFFFFFFFULL);
+    default: return _mm_shuffle_epi32(x, 0x4E);     // swap the high and low words
+    }
+}
+
+template<int ro>
+TRIBUS_INLINE void JHRound(__m128i (*h)[8], unsigned int r)
+{
+    const __m128i ceven = _mm_load_si128((const __m128i*)&JH_C[(r << 2) + 0]);
+    const __m128i codd = _mm_load_si128((const __m128i*)&JH_C[(r << 2) + 2]);
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+    {
+        JHSb(h[k][0], h[k][2], h[k][4], h[k][6], ceven);
+        JHSb(h[k][1], h[k][3], h[k][5], h[k][7], codd);
+        JHLb(h[k][0], h[k][2], h[k][4], h[k][6], h[k][1], h[k][3], h[k][5], h[k][7]);
+        h[k][1] = JHW<ro>(h[k][1]);
+        h[k][3] = JHW<ro>(h[k][3]);
+        h[k][5] = JHW<ro>(h[k][5]);
+        h[k][7] = JHW<ro>(h[k][7]);
+    }
+}
+
+/** One JH compression of every lane: message words in, E8, message words out */
+void JHCompressLanes(__m128i (*h)[8], const __m128i (*m)[4])
+{
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+        for (int i = 0; i < 4; i++)
+            h[k][i] = _mm_xor_si128(h[k][i], m[k][i]);
+    for (unsigned int r = 0; r < 42; r += 7)
+    {
+        JHRound<0>(h, r);
+        JHRound<1>(h, r + 1);
+        JHRound<2>(h, r + 2);
+        JHRound<3>(h, r + 3);
+        JHRound<4>(h, r + 4);
+        JHRound<5>(h, r + 5);
+        JHRound<6>(h, r + 6);
+    }
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+        for (int i = 0; i < 4; i++)
+            h[k][i + 4] = _mm_xor_si128(h[k][i + 4], m[k][i]);
+}
+
+/** The rest of JH512 after the midstate: the block holding the last 16 header
+ * bytes and the first padding bit, then the block with the bit length (640) */
+void JHLanes(const sph_jh512_context& ctxMid, const unsigned char* pTail, const uint32_t* pNonce,
+             unsigned char (*pOut)[64])
+{
+    __m128i h[TRIBUS_LANES][8];
+    __m128i m[TRIBUS_LANES][4];
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+    {
+        unsigned char vchTail[16];
+        memcpy(vchTail, pTail, 12);
+        WriteLE32(vchTail + 12, pNonce[k]);
+        for (int i = 0; i < 8; i++)
+            h[k][i] = _mm_loadu_si128((const __m128i*)&ctxMid.H.wide[2 * i]);
+        m[k][0] = _mm_loadu_si128((const __m128i*)vchTail);
+        m[k][1] = _mm_cvtsi32_si128(0x80);
+        m[k][2] = _mm_setzero_si128();
+        m[k][3] = _mm_setzero_si128();
+    }
+    JHCompressLanes(h, m);
+
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+    {
+        m[k][1] = _mm_setzero_si128();
+        m[k][0] = _mm_setzero_si128();
+        m[k][3] = _mm_set_epi64x(0x8002000000000000ULL, 0);
+    }
+    JHCompressLanes(h, m);
+
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+        for (int i = 0; i < 4; i++)
+            _mm_storeu_si128((__m128i*)&pOut[k][16 * i], h[k][i + 4]);
+}
+
+void HashSSE2(const sph_jh512_context& ctxMid, const unsigned char* pTail, const uint32_t* pNonce, uint256* pHash)
+{
+    unsigned char vchJH[TRIBUS_LANES][64];
+    JHLanes(ctxMid, pTail, pNonce, vchJH);
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+        FinishGeneric(vchJH[k], pHash[k]);
+}
+
+/* ECHO512 of a single 64 byte message: one compression with the bit counter at
+ * 512, so the AES keys are 512, 513, ... 671 in the low word. Only the first
+ * 256 bits of the output are needed, which leaves the last round just the two
+ * columns that feed them. */
+
+#define TRIBUS_AES __attribute__((target("aes")))
+
+TRIBUS_AES TRIBUS_INLINE __m128i EchoXtime(__m128i x)
+{
+    const __m128i mask = _mm_and_si128(_mm_cmpgt_epi8(_mm_setzero_si128(), x), _mm_set1_epi8(0x1b));
+    return _mm_xor_si128(_mm_add_epi8(x, x), mask);
+}
+
+TRIBUS_AES TRIBUS_INLINE void EchoMixColumn(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    const __m128i ab = _mm_xor_si128(a, b);
+    const __m128i bc = _mm_xor_si128(b, c);
+    const __m128i cd = _mm_xor_si128(c, d);
+    const __m128i abx = EchoXtime(ab);
+    const __m128i bcx = EchoXtime(bc);
+    const __m128i cdx = EchoXtime(cd);
+    const __m128i a0 = a;
+    const __m128i c0 = c;
+    a = _mm_xor_si128(abx, _mm_xor_si128(bc, d));
+    b = _mm_xor_si128(bcx, _mm_xor_si128(a0, cd));
+    c = _mm_xor_si128(cdx, _mm_xor_si128(ab, d));
+    d = _mm_xor_si128(_mm_xor_si128(abx, bcx), _mm_xor_si128(cdx, _mm_xor_si128(ab, c0)));
+}
+
+TRIBUS_AES TRIBUS_INLINE void EchoSubWord(__m128i (*W)[16], int i, uint32_t nKey)
+{
+    const __m128i key = _mm_cvtsi32_si128(nKey);
+    const __m128i zero = _mm_setzero_si128();
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+        W[k][i] = _mm_aesenc_si128(_mm_aesenc_si128(W[k][i], key), zero);
+}
+
+TRIBUS_AES void EchoLanesAESNI(const unsigned char (*pIn)[64], uint256* pHash)
+{
+    const __m128i v = _mm_cvtsi32_si128(512);
+    __m128i W[TRIBUS_LANES][16];
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+    {
+        for (int i = 0; i < 8; i++)
+            W[k][i] = v;
+        for (int i = 0; i < 4; i++)
+            W[k][8 + i] = _mm_loadu_si128((const __m128i*)&pIn[k][16 * i]);
+        W[k][12] = _mm_cvtsi32_si128(0x80);
+        W[k][13] = _mm_setzero_si128();
+        W[k][14] = _mm_set_epi32(0x02000000, 0, 0, 0);     // output size, 512 bits
+        W[k][15] = v;                                       // bit counter
+    }
+
+    uint32_t nKey = 512;
+    for (int r = 0; r < 9; r++)
+    {
+        for (int i = 0; i < 16; i++)
+            EchoSubWord(W, i, nKey + i);
+        nKey += 16;
+        for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+        {
+            __m128i* w = W[k];
+            __m128i t = w[1];
+            w[1] = w[5]; w[5] = w[9]; w[9] = w[13]; w[13] = t;
+            t = w[2]; w[2] = w[10]; w[10] = t;
+            t = w[6]; w[6] = w[14]; w[14] = t;
+            t = w[15]; w[15] = w[11]; w[11] = w[7]; w[7] = w[3]; w[3] = t;
+            EchoMixColumn(w[0], w[1], w[2], w[3]);
+            EchoMixColumn(w[4], w[5], w[6], w[7]);
+            EchoMixColumn(w[8], w[9], w[10], w[11]);
+            EchoMixColumn(w[12], w[13], w[14], w[15]);
+        }
+    }
+
+    // Last round: after the row shift, columns 0 and 2 hold words 0, 5, 10, 15
+    // and 8, 13, 2, 7
+    const int vLast[8] = { 0, 5, 10, 15, 8, 13, 2, 7 };
+    for (int j = 0; j < 8; j++)
+        EchoSubWord(W, vLast[j], nKey + vLast[j]);
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+    {
+        __m128i* w = W[k];
+        __m128i a = w[0], b = w[5], c = w[10], d = w[15];
+        EchoMixColumn(a, b, c, d);
+        __m128i e = w[8], f = w[13], g = w[2], h = w[7];
+        EchoMixColumn(e, f, g, h);
+
+        // V ^= message ^ W[i] ^ W[i + 8]
+        const __m128i m0 = _mm_loadu_si128((const __m128i*)&pIn[k][0]);
+        const __m128i m1 = _mm_loadu_si128((const __m128i*)&pIn[k][16]);
+        _mm_storeu_si128((__m128i*)pHash[k].begin(), _mm_xor_si128(_mm_xor_si128(v, m0), _mm_xor_si128(a, e)));
+        _mm_storeu_si128((__m128i*)(pHash[k].begin() + 16), _mm_xor_si128(_mm_xor_si128(v, m1), _mm_xor_si128(b, f)));
+    }
+}
+
+void HashAESNI(const sph_jh512_context& ctxMid, const unsigned char* pTail, const uint32_t* pNonce, uint256* pHash)
+{
+    unsigned char vchJH[TRIBUS_LANES][64];
+    unsigned char vchKeccak[TRIBUS_LANES][64];
+    JHLanes(ctxMid, pTail, pNonce, vchJH);
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+    {
+        sph_keccak512_context ctx_keccak;
+        sph_keccak512_init(&ctx_keccak);
+        sph_keccak512(&ctx_keccak, vchJH[k], 64);
+        sph_keccak512_close(&ctx_keccak, vchKeccak[k]);
+    }
+    EchoLanesAESNI(vchKeccak, pHash);
+}
+
+bool HaveAESNI()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (ecx & bit_AES) != 0;
+}
+
+#endif // TRIBUS_SSE2
+
+void HashKernel(int nKernel, const sph_jh512_context& ctxMid, const unsigned char* pTail,
+                const uint32_t* pNonce, uint256* pHash)
+{
+#ifdef TRIBUS_SSE2
+    if (nKernel == TRIBUS_KERNEL_AESNI)
+        return HashAESNI(ctxMid, pTail, pNonce, pHash);
+    if (nKernel == TRIBUS_KERNEL_SSE2)
+        return HashSSE2(ctxMid, pTail, pNonce, pHash);
+#endif
+    HashGeneric(ctxMid, pTail, pNonce, pHash);
+}
+
+/** Compare one kernel with Tribus() over a few fixed headers and a stream of
+ * pseudo-random ones, nonces included */
+bool CheckKernel(int nKernel)
+{
+    uint64_t nState = 0x9e3779b97f4a7c15ULL;
+    for (int nHeader = 0; nHeader < 24; nHeader++)
+    {
+        unsigned char vchHeader[80];
+        for (int i = 0; i < 80; i++)
+        {
+            nState ^= nState << 13;
+            nState ^= nState >> 7;
+            nState ^= nState << 17;
+            vchHeader[i] = nHeader == 0 ? 0 : nHeader == 1 ? 0xff : (unsigned char)nState;
+        }
+
+        sph_jh512_context ctxMid;
+        sph_jh512_init(&ctxMid);
+        sph_jh512(&ctxMid, vchHeader, 64);
+
+        uint32_t vNonce[TRIBUS_LANES];
+        uint256 vHash[TRIBUS_LANES];
+        for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+            vNonce[k] = nHeader < 2 ? 0xffffffffU - k : (uint32_t)(nState >> (8 * k));
+        HashKernel(nKernel, ctxMid, vchHeader + 64, vNonce, vHash);
+
+        for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+        {
+            WriteLE32(vchHeader + 76, vNonce[k]);
+            if (vHash[k] != Tribus(vchHeader, vchHeader + 80))
+                return false;
+        }
+    }
+    return true;
+}
+
+struct CTribusKernel
+{
+    int nKernel;
+    bool fSelfTestOk;
+
+    CTribusKernel()
+    {
+        fSelfTestOk = CheckKernel(TRIBUS_KERNEL_GENERIC);
+        nKernel = TRIBUS_KERNEL_GENERIC;
+#ifdef TRIBUS_SSE2
+        if (CheckKernel(TRIBUS_KERNEL_SSE2))
+            nKernel = TRIBUS_KERNEL_SSE2;
+        else
+            fSelfTestOk = false;
+        if (nKernel == TRIBUS_KERNEL_SSE2 && HaveAESNI())
+        {
+            if (CheckKernel(TRIBUS_KERNEL_AESNI))
+                nKernel = TRIBUS_KERNEL_AESNI;
+            else
+                fSelfTestOk = false;
+        }
+#endif
+    }
+};
+
+const CTribusKernel& GetKernel()
+{
+    static const CTribusKernel kernel;
+    return kernel;
+}
+
+}
+
+CTribusMidstate::CTribusMidstate(const unsigned char* pHeader)
+{
+    sph_jh512_init(&ctxJH);
+    sph_jh512(&ctxJH, pHeader, 64);
+    memcpy(vchTail, pHeader + 64, 16);
+}
+
+void CTribusMidstate::HashLanes(const uint32_t* pNonce, uint256* pHash) const
+{
+    HashKernel(GetKernel().nKernel, ctxJH, vchTail, pNonce, pHash);
+}
+
+uint256 CTribusMidstate::Hash(uint32_t nNonce) const
+{
+    uint32_t vNonce[TRIBUS_LANES];
+    uint256 vHash[TRIBUS_LANES];
+    for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+        vNonce[k] = nNonce + k;
+    HashLanes(vNonce, vHash);
+    return vHash[0];
+}
+
+bool CTribusMidstate::Scan(uint32_t nNonceBegin, uint32_t nCount, const uint256& hashTarget,
+                           uint32_t& nNonceFound, uint256& hashFound, uint32_t& nHashesDone) const
+{
+    // Early reject: almost every hash is decided by its top 64 bits
+    const uint64_t nTargetTop = hashTarget.Get64(3);
+
+    nHashesDone = 0;
+    uint32_t vNonce[TRIBUS_LANES];
+    uint256 vHash[TRIBUS_LANES];
+    while (nHashesDone < nCount)
+    {
+        for (unsigned int k = 0; k < TRIBUS_LANES; k++)
+            vNonce[k] = nNonceBegin + nHashesDone + k;
+        HashLanes(vNonce, vHash);
+
+        for (unsigned int k = 0; k < TRIBUS_LANES && nHashesDone < nCount; k++)
+        {
+            nHashesDone++;
+            const uint64_t nTop = vHash[k].Get64(3);
+            if (nTop > nTargetTop || (nTop == nTargetTop && vHash[k] > hashTarget))
+                continue;
+            nNonceFound = vNonce[k];
+            hashFound = vHash[k];
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* TribusKernelName()
+{
+    return pszKernelName[GetKernel().nKernel];
+}
+
+bool TribusSelfTest()
+{
+    return GetKernel().fSelfTestOk;
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_TRIBUS_H
+#define INNOVA_TRIBUS_H
+
+#include "uint256.h"
+#include "sph_jh.h"
+
+#include <stdint.h>
+
+/** Nonces a scan hashes side by side */
+static const unsigned int TRIBUS_LANES = 2;
+
+/** Tribus (JH512, Keccak512, ECHO512) of one 80 byte block header for many
+ * nonces. The first 64 header bytes hold no nonce, so the JH state after them
+ * is computed once per work unit and every nonce costs two JH compressions
+ * instead of three. On x86-64 the JH rounds run on SSE2 registers and, when
+ * the CPU has AES-NI, ECHO512 uses the AES round instruction; TRIBUS_LANES
+ * nonces go through each stage together so their rounds interleave. Every
+ * kernel gives the same hash as Tribus().
+ */
+class CTribusMidstate
+{
+public:
+    /** pHeader is the serialized header; its nonce field is ignored */
+    explicit CTribusMidstate(const unsigned char* pHeader);
+
+    uint256 Hash(uint32_t nNonce) const;
+
+    /** Hash nonces nNonceBegin, nNonceBegin + 1, ... (nCount of them, wrapping
+     * at 2^32) and stop at the first whose hash is at or below hashTarget.
+     * nHashesDone is set to the number of nonces tried.
+     */
+    bool Scan(uint32_t nNonceBegin, uint32_t nCount, const uint256& hashTarget,
+              uint32_t& nNonceFound, uint256& hashFound, uint32_t& nHashesDone) const;
+
+private:
+    sph_jh512_context ctxJH;
+    unsigned char vchTail[16];
+
+    void HashLanes(const uint32_t* pNonce, uint256* pHash) const;
+};
+
+/** Name of the kernel in use, for the log */
+const char* TribusKernelName();
+
+/** Check every kernel this CPU can run against Tribus() over fixed and random
+ * headers. A kernel that disagrees is disabled and the portable one used.
+ */
+bool TribusSelfTest();
+
+#endif
@@ -0,0 +1,287 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#include "txcache.h"
+
+// Map and list node overhead, per entry.
+static const unsigned int TXCACHE_ENTRY_OVERHEAD = 128;
+
+CTxIndexCache g_txCache;
+
+CTxIndexCache::CTxIndexCache() :
+    nBytes(0), nMaxBytes(0), nGeneration(0),
+    nIndexHits(0), nIndexMisses(0), nTxHits(0), nTxMisses(0), nEvictions(0)
+{
+}
+
+void CTxIndexCache::SetMaxSize(uint64_t nMaxBytesIn)
+{
+    LOCK(cs);
+    nMaxBytes = nMaxBytesIn;
+    Trim();
+}
+
+bool CTxIndexCache::Enabled() const
+{
+    LOCK(cs);
+    return nMaxBytes > 0;
+}
+
+uint64_t CTxIndexCache::GetGeneration() const
+{
+    LOCK(cs);
+    return nGeneration;
+}
+
+bool CTxIndexCache::GetIndex(const uint256& hash, CTxIndex& txindex)
+{
+    LOCK(cs);
+    if (nMaxBytes == 0)
+        return false;
+    std::map<uint256, CIndexEntry>::iterator it = mapIndex.find(hash);
+    if (it == mapIndex.end())
+    {
+        nIndexMisses++;
+        return false;
+    }
+    lruOrder.splice(lruOrder.begin(), lruOrder, it->second.itLRU);
+    txindex = it->second.txindex;
+    nIndexHits++;
+    return true;
+}
+
+void CTxIndexCache::FillIndex(uint64_t nGenerationIn, const uint256& hash, const CTxIndex& txindex)
+{
+    LOCK(cs);
+    if (nMaxBytes == 0 || nGenerationIn != nGeneration)
+        return;
+    StoreIndex(hash, txindex);
+    Trim();
+}
+
+void CTxIndexCache::BeginWrite(const std::vector<uint256>& vHash)
+{
+    LOCK(cs);
+    nGeneration++;
+    for (unsigned int i = 0; i < vHash.size(); i++)
+        EraseIndex(vHash[i]);
+}
+
+void CTxIndexCache::CommitIndex(const uint256& hash, const CTxIndex* pvalue)
+{
+    LOCK(cs);
+    nGeneration++;
+    if (pvalue && nMaxBytes > 0)
+    {
+        StoreIndex(hash, *pvalue);
+        Trim();
+    }
+    else
+        EraseIndex(hash);
+}
+
+bool CTxIndexCache::GetTx(const uint256& hash, const CDiskTxPos& pos, CTransaction& tx)
+{
+    LOCK(cs);
+    if (nMaxBytes == 0)
+        return false;
+    std::map<uint256, CTxEntry>::iterator it = mapTx.find(hash);
+    if (it == mapTx.end() || it->second.pos != pos)
+    {
+        nTxMisses++;
+        return false;
+    }
+    lruOrder.splice(lruOrder.begin(), lruOrder, it->second.itLRU);
+    tx = it->second.tx;
+    nTxHits++;
+    return true;
+}
+
+void CTxIndexCache::PutTx(const uint256& hash, const CDiskTxPos& pos, const CTransaction& tx)
+{
+    // Decoded scripts and vectors take roughly twice the serialized size.
+    unsigned int nSize = sizeof(CTxEntry) + TXCACHE_ENTRY_OVERHEAD +
+                         2 * ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+
+    LOCK(cs);
+    if (nMaxBytes == 0 || nSize > nMaxBytes / 16)
+        return;
+    std::map<uint256, CTxEntry>::iterator it = mapTx.find(hash);
+    if (it != mapTx.end())
+    {
+        lruOrder.splice(lruOrder.begin(), lruOrder, it->second.itLRU);
+        if (it->second.pos == pos)
+            return;
+        nBytes -= it->second.nSize;
+    }
+    else
+    {
+        lruOrder.push_front(std::make_pair(hash, true));
+        it = mapTx.insert(std::make_pair(hash, CTxEntry())).first;
+        it->second.itLRU = lruOrder.begin();
+    }
+    it->second.pos = pos;
+    it->second.tx = tx;
+    it->second.nSize = nSize;
+    nBytes += nSize;
+    Trim();
+}
+
+void CTxIndexCache::Clear()
+{
+    LOCK(cs);
+    nGeneration++;
+    lruOrder.clear();
+    mapIndex.clear();
+    mapTx.clear();
+    nBytes = 0;
+}
+
+void CTxIndexCache::GetStats(CTxCacheStats& stats) const
+{
+    LOCK(cs);
+    stats.nIndexEntries = mapIndex.size();
+    stats.nTxEntries = mapTx.size();
+    stats.nBytes = nBytes;
+    stats.nMaxBytes = nMaxBytes;
+    stats.nIndexHits = nIndexHits;
+    stats.nIndexMisses = nIndexMisses;
+    stats.nTxHits = nTxHits;
+    stats.nTxMisses = nTxMisses;
+    stats.nEvictions = nEvictions;
+}
+
+void CTxIndexCache::StoreIndex(const uint256& hash, const CTxIndex& txindex)
+{
+    unsigned int nSize = sizeof(CIndexEntry) + TXCACHE_ENTRY_OVERHEAD +
+                         txindex.vSpent.size() * sizeof(CDiskTxPos);
+
+    std::map<uint256, CIndexEntry>::iterator it = mapIndex.find(hash);
+    if (it != mapIndex.end())
+    {
+        lruOrder.splice(lruOrder.begin(), lruOrder, it->second.itLRU);
+        nBytes -= it->second.nSize;
+    }
+    else
+    {
+        lruOrder.push_front(std::make_pair(hash, false));
+        it = mapIndex.insert(std::make_pair(hash, CIndexEntry())).first;
+        it->second.itLRU = lruOrder.begin();
+    }
+    it->second.txindex = txindex;
+    it->second.nSize = nSize;
+    nBytes += nSize;
+}
+
+void CTxIndexCache::EraseIndex(const uint256& hash)
+{
+    std::map<uint256, CIndexEntry>::iterator it = mapIndex.find(hash);
+    if (it == mapIndex.end())
+        return;
+    nBytes -= it->second.nSize;
+    lruOrder.erase(it->second.itLRU);
+    mapIndex.erase(it);
+}
+
+void CTxIndexCache::Trim()
+{
+    while (nBytes > nMaxBytes && !lruOrder.empty())
+    {
+        const std::pair<uint256, bool>& victim = lruOrder.back();
+        if (victim.second)
+        {
+            std::map<uint256, CTxEntry>::iterator it = mapTx.find(victim.first);
+            nBytes -= it->second.nSize;
+            mapTx.erase(it);
+        }
+        else
+        {
+            std::map<uint256, CIndexEntry>::iterator it = mapIndex.find(victim.first);
+            nBytes -= it->second.nSize;
+            mapIndex.erase(it);
+        }
+        lruOrder.pop_back();
+        nEvictions++;
+    }
+}
+
+CRawBlockCache g_rawBlockCache;
+
+CRawBlockCache::CRawBlockCache() :
+    nBytes(0), nMaxBytes(0), nHits(0), nMisses(0), nEvictions(0)
+{
+}
+
+void CRawBlockCache::SetMaxSize(uint64_t nMaxBytesIn)
+{
+    LOCK(cs);
+    nMaxBytes = nMaxBytesIn;
+    Trim();
+}
+
+CRawBlockCache::BlockData CRawBlockCache::Get(const uint256& hash)
+{
+    LOCK(cs);
+    if (nMaxBytes == 0)
+        return BlockData();
+    std::map<uint256, CEntry>::iterator it = mapBlocks.find(hash);
+    if (it == mapBlocks.end())
+    {
+        nMisses++;
+        return BlockData();
+    }
+    lruOrder.splice(lruOrder.begin(), lruOrder, it->second.itLRU);
+    nHits++;
+    return it->second.pblock;
+}
+
+void CRawBlockCache::Put(const uint256& hash, const BlockData& pblock)
+{
+    LOCK(cs);
+    // One block may not take more than a quarter of the budget
+    if (!pblock || nMaxBytes == 0 || pblock->size() > nMaxBytes / 4)
+        return;
+    std::map<uint256, CEntry>::iterator it = mapBlocks.find(hash);
+    if (it != mapBlocks.end())
+    {
+        lruOrder.splice(lruOrder.begin(), lruOrder, it->second.itLRU);
+        return;
+    }
+    lruOrder.push_front(hash);
+    it = mapBlocks.insert(std::make_pair(hash, CEntry())).first;
+    it->second.pblock = pblock;
+    it->second.itLRU = lruOrder.begin();
+    nBytes += pblock->size() + TXCACHE_ENTRY_OVERHEAD;
+    Trim();
+}
+
+void CRawBlockCache::Clear()
+{
+    LOCK(cs);
+    lruOrder.clear();
+    mapBlocks.clear();
+    nBytes = 0;
+}
+
+void CRawBlockCache::GetStats(CRawBlockCacheStats& stats) const
+{
+    LOCK(cs);
+    stats.nEntries = mapBlocks.size();
+    stats.nBytes = nBytes;
+    stats.nMaxBytes = nMaxBytes;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nEvictions = nEvictions;
+}
+
+void CRawBlockCache::Trim()
+{
+    while (nBytes > nMaxBytes && !lruOrder.empty())
+    {
+        std::map<uint256, CEntry>::iterator it = mapBlocks.find(lruOrder.back());
+        nBytes -= it->second.pblock->size() + TXCACHE_ENTRY_OVERHEAD;
+        mapBlocks.erase(it);
+        lruOrder.pop_back();
+        nEvictions++;
+    }
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2026 The Innova developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef INNOVA_TXCACHE_H
+#define INNOVA_TXCACHE_H
+
+#include "main.h"
+#include "sync.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Decoded txindex entries and transactions kept in memory in front of CTxDB.
+//
+// Connecting a block reads, for every input, the CTxIndex of the previous
+// transaction from LevelDB and then the transaction itself from the blk*.dat
+// file. Most inputs spend recent outputs, so those reads keep hitting the same
+// small working set; this cache answers them without a LevelDB lookup, a
+// deserialization, or a file seek.
+//
+// The cache never holds anything LevelDB does not: it is write-through at
+// commit granularity. CTxDB stages txindex changes made inside TxnBegin() ..
+// TxnCommit() next to its WriteBatch and applies them here only after the
+// batch has been written, so a block's txindex updates, hashBestChain and the
+// rest of its state still reach the disk in the one atomic batch they always
+// did, and a crash can never leave the on-disk txindex and best chain out of
+// step. TxnAbort() simply drops the staged changes. The cross-block write
+// batching that IBD needs is already done by -ibdbatchsize.
+//
+// Transactions are immutable once written, so they are keyed by hash and disk
+// position and need no invalidation at all.
+//
+// Thread-safe. Sized from -dbcache; a budget of 0 disables it.
+
+struct CTxCacheStats
+{
+    unsigned int nIndexEntries;
+    unsigned int nTxEntries;
+    uint64_t nBytes;
+    uint64_t nMaxBytes;
+    uint64_t nIndexHits;
+    uint64_t nIndexMisses;
+    uint64_t nTxHits;
+    uint64_t nTxMisses;
+    uint64_t nEvictions;
+};
+
+class CTxIndexCache
+{
+public:
+    CTxIndexCache();
+
+    void SetMaxSize(uint64_t nMaxBytesIn);
+    bool Enabled() const;
+
+    /** Changes on every write; pass the value read before a LevelDB lookup
+     *  to FillIndex() so a lookup that raced a commit cannot cache a stale
+     *  entry. */
+    uint64_t GetGeneration() const;
+
+    bool GetIndex(const uint256& hash, CTxIndex& txindex);
+    /** Cache an entry just read from LevelDB. */
+    void FillIndex(uint64_t nGeneration, const uint256& hash, const CTxIndex& txindex);
+
+    /** Called before a write reaches LevelDB: drop the affected entries. */
+    void BeginWrite(const std::vector<uint256>& vHash);
+    /** Called once the write succeeded. pvalue NULL means erased. */
+    void CommitIndex(const uint256& hash, const CTxIndex* pvalue);
+
+    bool GetTx(const uint256& hash, const CDiskTxPos& pos, CTransaction& tx);
+    void PutTx(const uint256& hash, const CDiskTxPos& pos, const CTransaction& tx);
+
+    void Clear();
+    void GetStats(CTxCacheStats& stats) const;
+
+private:
+    struct CIndexEntry
+    {
+        CTxIndex txindex;
+        unsigned int nSize;
+        std::list<std::pair<uint256, bool> >::iterator itLRU;
+    };
+    struct CTxEntry
+    {
+        CDiskTxPos pos;
+        CTransaction tx;
+        unsigned int nSize;
+        std::list<std::pair<uint256, bool> >::iterator itLRU;
+    };
+
+    mutable CCriticalSection cs;
+    // front = most recently used; second is true for a transaction entry
+    std::list<std::pair<uint256, bool> > lruOrder;
+    std::map<uint256, CIndexEntry> mapIndex;
+    std::map<uint256, CTxEntry> mapTx;
+    uint64_t nBytes;
+    uint64_t nMaxBytes;
+    uint64_t nGeneration;
+    uint64_t nIndexHits;
+    uint64_t nIndexMisses;
+    uint64_t nTxHits;
+    uint64_t nTxMisses;
+    uint64_t nEvictions;
+
+    void StoreIndex(const uint256& hash, const CTxIndex& txindex);
+    void EraseIndex(const uint256& hash);
+    void Trim();
+};
+
+extern CTxIndexCache g_txCache;
+
+// Serialized blocks recently served to peers, exactly as stored in blk*.dat.
+//
+// A new DAG tip is requested by most peers within the same second; this keeps
+// those getdata answers from each going back to the block file. Entries are
+// shared, so a hit hands out the bytes without copying them under the lock.
+// Blocks are immutable, keyed by hash and never invalidated.
+//
+// Thread-safe. Sized from -rawblockcache; a budget of 0 disables it.
+
+struct CRawBlockCacheStats
+{
+    unsigned int nEntries;
+    uint64_t nBytes;
+    uint64_t nMaxBytes;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+};
+
+class CRawBlockCache
+{
+public:
+    typedef std::shared_ptr<const std::vector<char> > BlockData;
+
+    CRawBlockCache();
+
+    void SetMaxSize(uint64_t nMaxBytesIn);
+
+    BlockData Get(const uint256& hash);
+    void Put(const uint256& hash, const BlockData& pblock);
+
+    void Clear();
+    void GetStats(CRawBlockCacheStats& stats) const;
+
+private:
+    struct CEntry
+    {
+        BlockData pblock;
+        std::list<uint256>::iterator itLRU;
+    };
+
+    mutable CCriticalSection cs;
+    // front = most recently used
+    std::list<uint256> lruOrder;
+    std::map<uint256, CEntry> mapBlocks;
+    uint64_t nBytes;
+    uint64_t nMaxBytes;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+
+    void Trim();
+};
+
+extern CRawBlockCache g_rawBlockCache;
+
+#endif // INNOVA_TXCACHE_H
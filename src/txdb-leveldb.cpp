@@ -17,6 +17,9 @@
 #include "kernel.h"
 #include "checkpoints.h"
 #include "txdb.h"
+#include "shieldedpool.h"
+#include "txcache.h"
+#include "blockindexsnapshot.h"
 #include "util.h"
 #include "main.h"
 
@@ -46,7 +49,10 @@ void FlushIBDBatch()
     LOCK(cs_IBDBatch);
     if (fIBDBatchPending && txdb)
     {
-        printf("Flushing pending IBD batch (%d blocks)...\n", nIBDBatchCount);
+        CTxCacheStats stats;
+        g_txCache.GetStats(stats);
+        printf("Flushing pending IBD batch (%d blocks)... txcache index %" PRIu64"/%" PRIu64" tx %" PRIu64"/%" PRIu64" hits/misses, %" PRIu64" KB\n",
+               nIBDBatchCount, stats.nIndexHits, stats.nIndexMisses, stats.nTxHits, stats.nTxMisses, stats.nBytes / 1024);
         CTxDB txdbFlush;
         txdbFlush.TxnBegin();
         txdbFlush.TxnCommit();
@@ -55,10 +61,18 @@ void FlushIBDBatch()
     }
 }
 
+// Share of -dbcache given to the decoded txindex/transaction cache (txcache.h);
+// the rest is LevelDB's block cache.
+static uint64_t GetTxCacheBytes()
+{
+    int64_t nCacheSizeMB = std::max((int64_t)0, GetArg("-dbcache", 300));
+    return (uint64_t)nCacheSizeMB * 1048576 / 4;
+}
+
 static leveldb::Options GetOptions() {
     leveldb::Options options;
-    int nCacheSizeMB = GetArg("-dbcache", 300);
-    options.block_cache = leveldb::NewLRUCache(nCacheSizeMB * 1048576);
+    int64_t nCacheSizeMB = std::max((int64_t)0, GetArg("-dbcache", 300));
+    options.block_cache = leveldb::NewLRUCache(nCacheSizeMB * 1048576 - GetTxCacheBytes());
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
     options.write_buffer_size = 64 * 1048576; // 64MB write buffer (default 4MB) for smoother IBD
     options.max_open_files = 1000;
@@ -102,6 +116,8 @@ CTxDB::CTxDB(const char* pszMode)
 {
     assert(pszMode);
     activeBatch = NULL;
+    fCommitCountWritten = false;
+    nCommitCountMin = 0;
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
 
     LOCK(cs_txdb);
@@ -115,6 +131,7 @@ CTxDB::CTxDB(const char* pszMode)
 
     options = GetOptions();
     options.create_if_missing = true; //fCreate
+    g_txCache.SetMaxSize(GetTxCacheBytes());
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
 
     init_blockindex(options); // Init directory
@@ -156,6 +173,8 @@ CTxDB::CTxDB(const char* pszMode)
             txdb = pdb = NULL;
             delete activeBatch;
             activeBatch = NULL;
+            g_txCache.Clear();
+            g_commitmentPool.Clear();
 
             init_blockindex(options, true); // Remove directory and create new database
             pdb = txdb;
@@ -189,6 +208,10 @@ void CTxDB::Close()
     options.block_cache = NULL;
     delete activeBatch;
     activeBatch = NULL;
+    mapTxIndexPending.clear();
+    fCommitCountWritten = false;
+    g_txCache.Clear();
+    g_commitmentPool.Clear();
 }
 
 bool CTxDB::TxnBegin()
@@ -213,13 +236,27 @@ bool CTxDB::TxnCommit()
         nIBDBatchCount++;
     }
 
+    std::vector<uint256> vTxIndexKeys;
+    vTxIndexKeys.reserve(mapTxIndexPending.size());
+    for (std::map<uint256, std::pair<bool, CTxIndex> >::const_iterator it = mapTxIndexPending.begin(); it != mapTxIndexPending.end(); ++it)
+        vTxIndexKeys.push_back(it->first);
+    g_txCache.BeginWrite(vTxIndexKeys);
+
     leveldb::Status status = pdb->Write(writeOptions, activeBatch);
     delete activeBatch;
     activeBatch = NULL;
     if (!status.ok()) {
+        mapTxIndexPending.clear();
+        fCommitCountWritten = false;
         printf("LevelDB batch commit failure: %s\n", status.ToString().c_str());
         return false;
     }
+    for (std::map<uint256, std::pair<bool, CTxIndex> >::const_iterator it = mapTxIndexPending.begin(); it != mapTxIndexPending.end(); ++it)
+        g_txCache.CommitIndex(it->first, it->second.first ? &it->second.second : NULL);
+    mapTxIndexPending.clear();
+    if (fCommitCountWritten)
+        g_commitmentPool.Truncate(nCommitCountMin);
+    fCommitCountWritten = false;
     return true;
 }
 
@@ -338,7 +375,19 @@ bool CTxDB::ReadShieldedCommitment(uint64_t nIndex, CPedersenCommitment& commit)
 
 bool CTxDB::WriteShieldedCommitmentCount(uint64_t nCount)
 {
-    return Write(string("scc"), nCount);
+    if (!Write(string("scc"), nCount))
+        return false;
+    // Entries at and above nCount may be rewritten: drop them from the
+    // in-memory pool once the write is on disk.
+    if (activeBatch)
+    {
+        if (!fCommitCountWritten || nCount < nCommitCountMin)
+            nCommitCountMin = nCount;
+        fCommitCountWritten = true;
+    }
+    else
+        g_commitmentPool.Truncate(nCount);
+    return true;
 }
 
 bool CTxDB::ReadShieldedCommitmentCount(uint64_t& nCount)
@@ -376,20 +425,58 @@ bool CTxDB::EraseShieldedCommitmentIndex(const std::vector<unsigned char>& vchCo
     return Erase(make_pair(string("sci"), vchCommitment));
 }
 
-bool CTxDB::ReadAllShieldedCommitments(std::vector<CPedersenCommitment>& vCommitments)
+bool CTxDB::ReadShieldedCommitments(uint64_t nBegin, uint64_t nEnd, std::vector<CPedersenCommitment>& vCommitments)
 {
     vCommitments.clear();
-    uint64_t nCount = 0;
-    if (!ReadShieldedCommitmentCount(nCount))
+    if (nBegin >= nEnd)
+        return true;
+    vCommitments.resize(nEnd - nBegin);
+
+    // A few new entries are cheaper to fetch one by one; a large range (the
+    // first load) is one sequential pass over the 'sc' keys, which are not
+    // stored in index order.
+    if (nEnd - nBegin <= 1024 || activeBatch)
+    {
+        for (uint64_t i = nBegin; i < nEnd; i++)
+            if (!ReadShieldedCommitment(i, vCommitments[i - nBegin]))
+                return false;
+        return true;
+    }
+
+    leveldb::DB* db = GetInstance();
+    if (!db)
         return false;
-    vCommitments.reserve(nCount);
-    for (uint64_t i = 0; i < nCount; i++)
+
+    CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+    ssPrefix << string("sc");
+    std::string strPrefix = ssPrefix.str();
+
+    std::vector<bool> vFound(nEnd - nBegin, false);
+    uint64_t nFound = 0;
+    leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
+    for (it->Seek(strPrefix); it->Valid(); it->Next())
     {
-        CPedersenCommitment commit;
-        if (ReadShieldedCommitment(i, commit))
-            vCommitments.push_back(commit);
+        std::string strKey = it->key().ToString();
+        if (strKey.compare(0, strPrefix.size(), strPrefix) != 0)
+            break;
+        try {
+            CDataStream ssKey(strKey.data(), strKey.data() + strKey.size(), SER_DISK, CLIENT_VERSION);
+            std::pair<std::string, uint64_t> keyPair;
+            ssKey >> keyPair;
+            if (keyPair.first != "sc" || keyPair.second < nBegin || keyPair.second >= nEnd)
+                continue;
+            CDataStream ssValue(it->value().data(), it->value().data() + it->value().size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> vCommitments[keyPair.second - nBegin];
+            if (!vFound[keyPair.second - nBegin])
+            {
+                vFound[keyPair.second - nBegin] = true;
+                nFound++;
+            }
+        }
+        catch (const std::exception&) { /* skip malformed */ }
     }
-    return true;
+    delete it;
+    return nFound == nEnd - nBegin;
 }
 
 bool CTxDB::WriteCurveTree(const CCurveTree& tree)
@@ -402,14 +489,64 @@ bool CTxDB::ReadCurveTree(CCurveTree& tree)
     return Read(string("ct"), tree);
 }
 
-bool CTxDB::WriteCurveTreeAtBlock(const uint256& blockHash, const CCurveTree& tree)
+bool CTxDB::WriteCurveTreeAtBlock(const uint256& blockHash, const CCurveTree& tree, int nHeight)
 {
-    return Write(make_pair(string("cb"), blockHash), tree);
+    // Per-block deltas ('cd'), with a full snapshot ('cb') at every checkpoint
+    // and at the first block that maintains the tree, so a replay always has
+    // a base to start from.
+    CCurveTreeBlockDelta delta;
+    tree.GetBlockDelta(delta);
+    delta.fCheckpoint = (nHeight % CURVE_TREE_CHECKPOINT_INTERVAL == 0 || nHeight == FORK_HEIGHT_FCMP);
+    if (delta.fCheckpoint && !Write(make_pair(string("cb"), blockHash), tree))
+        return false;
+    return Write(make_pair(string("cd"), blockHash), delta);
 }
 
 bool CTxDB::ReadCurveTreeAtBlock(const uint256& blockHash, CCurveTree& tree)
 {
-    return Read(make_pair(string("cb"), blockHash), tree);
+    // Checkpoints, and snapshots written before deltas existed, are full trees.
+    if (Read(make_pair(string("cb"), blockHash), tree))
+        return true;
+
+    CCurveTreeBlockDelta delta;
+    if (!Read(make_pair(string("cd"), blockHash), delta))
+        return false;
+
+    // Common case: the block is at or below the tip, so the live tree is the
+    // snapshot plus appended leaves.
+    if (ReadCurveTree(tree) && tree.RewindToDelta(delta))
+        return true;
+
+    // Otherwise replay the commitment index forward from the last checkpoint
+    // on this block's chain.
+    map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.find(blockHash);
+    if (mi == mapBlockIndex.end())
+        return false;
+    CBlockIndex* pindex = mi->second->pprev;
+    bool fHaveBase = false;
+    for (int i = 0; pindex && i <= CURVE_TREE_CHECKPOINT_INTERVAL; i++, pindex = pindex->pprev)
+    {
+        tree = CCurveTree();
+        if (Read(make_pair(string("cb"), pindex->GetBlockHash()), tree))
+        {
+            fHaveBase = true;
+            break;
+        }
+    }
+    if (!fHaveBase || tree.nLeafCount > delta.nLeafCount)
+        return error("ReadCurveTreeAtBlock() : no curve tree checkpoint below block %s",
+                     blockHash.ToString().substr(0,16).c_str());
+
+    for (uint64_t i = tree.nLeafCount; i < delta.nLeafCount; i++)
+    {
+        CPedersenCommitment commit;
+        if (!ReadShieldedCommitment(i, commit) || !tree.InsertLeaf(commit))
+            return error("ReadCurveTreeAtBlock() : commitment %" PRIu64 " missing during replay", i);
+    }
+    if (tree.GetRoot() != delta.hashRoot)
+        return error("ReadCurveTreeAtBlock() : replayed curve tree root mismatch for block %s",
+                     blockHash.ToString().substr(0,16).c_str());
+    return true;
 }
 
 bool CTxDB::WriteCurveTreeAtEpoch(int nEpoch, const CCurveTree& tree)
@@ -424,6 +561,7 @@ bool CTxDB::ReadCurveTreeAtEpoch(int nEpoch, CCurveTree& tree)
 
 bool CTxDB::EraseCurveTreeAtBlock(const uint256& blockHash)
 {
+    Erase(make_pair(string("cd"), blockHash));
     return Erase(make_pair(string("cb"), blockHash));
 }
 
@@ -1126,42 +1264,162 @@ bool CTxDB::ScanBatch(const CDataStream &key, string *value, bool *deleted) cons
     return scanner.foundEntry;
 }
 
-bool CTxDB::WriteAddrIndex(uint160 addrHash, uint256 txHash)
+bool CTxDB::WriteAddrIndex(const CAddrIndexEntry& entry)
 {
-    std::vector<uint256> txHashes;
-    if(!ReadAddrIndex(addrHash, txHashes))
-    {
-	txHashes.push_back(txHash);
-        return Write(make_pair(string("adr"), addrHash), txHashes);
-    }
-    else
+    return Write(make_pair(string("adx"), entry.first), entry.second);
+}
+
+bool CTxDB::EraseAddrIndex(const CAddrIndexKey& key)
+{
+    return Erase(make_pair(string("adx"), key));
+}
+
+bool CTxDB::ReadAddrIndex(uint160 addrId, std::vector<CAddrIndexEntry>& vEntries, unsigned int nSkip, unsigned int nCount)
+{
+    vEntries.clear();
+    leveldb::DB* db = GetInstance();
+    if (!db)
+        return false;
+
+    // Keys of one address share this prefix and follow it in height order
+    CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+    ssPrefix << make_pair(string("adx"), addrId);
+    std::string strPrefix = ssPrefix.str();
+
+    leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
+    for (it->Seek(strPrefix); it->Valid() && vEntries.size() < nCount; it->Next())
     {
-	if(std::find(txHashes.begin(), txHashes.end(), txHash) == txHashes.end())
-    	{
-    	    txHashes.push_back(txHash);
-            return Write(make_pair(string("adr"), addrHash), txHashes);
-	}
-	else
-	{
-	    return true; // already have this tx hash
-	}
+        if (!it->key().starts_with(strPrefix))
+            break;
+        if (nSkip > 0)
+        {
+            nSkip--;
+            continue;
+        }
+        try {
+            CDataStream ssKey(it->key().data(), it->key().data() + it->key().size(), SER_DISK, CLIENT_VERSION);
+            std::pair<std::string, CAddrIndexKey> keyPair;
+            ssKey >> keyPair;
+            CDataStream ssValue(it->value().data(), it->value().data() + it->value().size(), SER_DISK, CLIENT_VERSION);
+            CAddrIndexDelta delta;
+            ssValue >> delta;
+            vEntries.push_back(make_pair(keyPair.second, delta));
+        }
+        catch (std::exception &e) {
+            printf("ReadAddrIndex() : deserialize error %s\n", e.what());
+        }
     }
+    bool fOk = it->status().ok();
+    delete it;
+    return fOk;
+}
+
+bool CTxDB::WriteAddrSummary(uint160 addrId, const CAddrSummary& summary)
+{
+    return Write(make_pair(string("ads"), addrId), summary);
 }
 
-bool CTxDB::ReadAddrIndex(uint160 addrHash, std::vector<uint256>& txHashes)
+bool CTxDB::ReadAddrSummary(uint160 addrId, CAddrSummary& summary)
 {
-    return Read(make_pair(string("adr"), addrHash), txHashes);
+    return Read(make_pair(string("ads"), addrId), summary);
+}
+
+bool CTxDB::EraseAddrSummary(uint160 addrId)
+{
+    return Erase(make_pair(string("ads"), addrId));
+}
+
+bool CTxDB::ReadLegacyAddrIndex(uint160 addrId, std::vector<uint256>& txHashes)
+{
+    return Read(make_pair(string("adr"), addrId), txHashes);
+}
+
+bool CTxDB::EraseAddrIndexAll()
+{
+    leveldb::DB* db = GetInstance();
+    if (!db || fReadOnly || activeBatch)
+        return false;
+
+    const char* pszPrefixes[] = { "adx", "ads", "adr" };
+    for (unsigned int i = 0; i < sizeof(pszPrefixes) / sizeof(pszPrefixes[0]); i++)
+    {
+        CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+        ssPrefix << string(pszPrefixes[i]);
+        std::string strPrefix = ssPrefix.str();
+
+        leveldb::WriteBatch batch;
+        unsigned int nBatched = 0;
+        leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
+        for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next())
+        {
+            batch.Delete(it->key());
+            if (++nBatched == 10000)
+            {
+                leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+                if (!status.ok())
+                {
+                    delete it;
+                    return error("EraseAddrIndexAll() : %s", status.ToString().c_str());
+                }
+                batch.Clear();
+                nBatched = 0;
+            }
+        }
+        delete it;
+        leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+        if (!status.ok())
+            return error("EraseAddrIndexAll() : %s", status.ToString().c_str());
+    }
+    return true;
 }
 
 bool CTxDB::ReadTxIndex(uint256 hash, CTxIndex& txindex)
 {
     txindex.SetNull();
-    return Read(make_pair(string("tx"), hash), txindex);
+    if (activeBatch)
+    {
+        std::map<uint256, std::pair<bool, CTxIndex> >::const_iterator it = mapTxIndexPending.find(hash);
+        if (it != mapTxIndexPending.end())
+        {
+            if (it->second.first)
+                txindex = it->second.second;
+            return it->second.first;
+        }
+    }
+    if (g_txCache.GetIndex(hash, txindex))
+        return true;
+    uint64_t nGeneration = g_txCache.GetGeneration();
+    if (!Read(make_pair(string("tx"), hash), txindex))
+        return false;
+    g_txCache.FillIndex(nGeneration, hash, txindex);
+    return true;
+}
+
+bool CTxDB::WriteTxIndexEntry(const uint256& hash, const CTxIndex* pvalue)
+{
+    if (fReadOnly)
+    {
+        printf("ERROR: Write called on database in read-only mode\n");
+        return false;
+    }
+    if (activeBatch)
+    {
+        mapTxIndexPending[hash] = pvalue ? make_pair(true, *pvalue) : make_pair(false, CTxIndex());
+        return pvalue ? Write(make_pair(string("tx"), hash), *pvalue) : Erase(make_pair(string("tx"), hash));
+    }
+
+    // Outside a batch the write is immediate: drop the cached entry first so
+    // no reader can see it after LevelDB has changed.
+    g_txCache.BeginWrite(std::vector<uint256>(1, hash));
+    if (!(pvalue ? Write(make_pair(string("tx"), hash), *pvalue) : Erase(make_pair(string("tx"), hash))))
+        return false;
+    g_txCache.CommitIndex(hash, pvalue);
+    return true;
 }
 
 bool CTxDB::UpdateTxIndex(uint256 hash, const CTxIndex& txindex)
 {
-    return Write(make_pair(string("tx"), hash), txindex);
+    return WriteTxIndexEntry(hash, &txindex);
 }
 
 bool CTxDB::AddTxIndex(const CTransaction& tx, const CDiskTxPos& pos, int nHeight)
@@ -1169,27 +1427,46 @@ bool CTxDB::AddTxIndex(const CTransaction& tx, const CDiskTxPos& pos, int nHeigh
     // Add to tx index
     uint256 hash = tx.GetHash();
     CTxIndex txindex(pos, tx.vout.size());
-    return Write(make_pair(string("tx"), hash), txindex);
+    return WriteTxIndexEntry(hash, &txindex);
 }
 
 bool CTxDB::EraseTxIndex(const CTransaction& tx)
 {
     uint256 hash = tx.GetHash();
 
-    return Erase(make_pair(string("tx"), hash));
+    return WriteTxIndexEntry(hash, NULL);
 }
 
 bool CTxDB::ContainsTx(uint256 hash)
 {
+    if (activeBatch)
+    {
+        std::map<uint256, std::pair<bool, CTxIndex> >::const_iterator it = mapTxIndexPending.find(hash);
+        if (it != mapTxIndexPending.end())
+            return it->second.first;
+    }
+    CTxIndex txindex;
+    if (g_txCache.GetIndex(hash, txindex))
+        return true;
     return Exists(make_pair(string("tx"), hash));
 }
 
+bool CTxDB::ReadTxAtPos(const uint256& hash, const CDiskTxPos& pos, CTransaction& tx)
+{
+    if (g_txCache.GetTx(hash, pos, tx))
+        return true;
+    if (!tx.ReadFromDisk(pos))
+        return false;
+    g_txCache.PutTx(hash, pos, tx);
+    return true;
+}
+
 bool CTxDB::ReadDiskTx(uint256 hash, CTransaction& tx, CTxIndex& txindex)
 {
     tx.SetNull();
     if (!ReadTxIndex(hash, txindex))
         return false;
-    return (tx.ReadFromDisk(txindex.pos));
+    return ReadTxAtPos(hash, txindex.pos, tx);
 }
 
 bool CTxDB::ReadDiskTx(uint256 hash, CTransaction& tx)
@@ -1279,6 +1556,77 @@ static CBlockIndex *InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+static boost::filesystem::path GetBlockIndexSnapshotPath()
+{
+    return GetDataDir() / "blockindex.snapshot";
+}
+
+// Written at a clean shutdown. The hash of the file's header is stored next
+// to hashBestChain and erased again as soon as the next startup has looked at
+// it, before any new block can reach the database, so the file is only ever
+// used for the exact database state it was written from.
+bool CTxDB::WriteBlockIndexSnapshot()
+{
+    uint256 hashBest;
+    if (fSPVMode || fHybridSPV || !ReadHashBestChain(hashBest) || !mapBlockIndex.count(hashBest))
+        return false;
+
+    int64_t nStart = GetTimeMillis();
+    uint256 hashSnapshot;
+    if (!::WriteBlockIndexSnapshot(GetBlockIndexSnapshotPath(), mapBlockIndex, hashBest, hashSnapshot))
+        return false;
+    if (!Write(string("blockIndexSnapshot"), hashSnapshot))
+        return error("WriteBlockIndexSnapshot() : failed to record the snapshot");
+    printf("WriteBlockIndexSnapshot(): %" PRIszu" entries in %" PRId64"ms\n", mapBlockIndex.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
+bool CTxDB::LoadBlockIndexSnapshot()
+{
+    uint256 hashSnapshot;
+    if (!Read(string("blockIndexSnapshot"), hashSnapshot))
+        return false;
+    // Blocks written from here on aren't in the file
+    if (!Erase(string("blockIndexSnapshot")))
+        return false;
+    uint256 hashBest;
+    if (!GetBoolArg("-blockindexsnapshot", true) || fSPVMode || fHybridSPV || !ReadHashBestChain(hashBest))
+        return false;
+
+    int64_t nStart = GetTimeMillis();
+    vector<pair<uint256, CBlockIndex*> > vIndex;
+    if (!ReadBlockIndexSnapshot(GetBlockIndexSnapshotPath(), hashSnapshot, hashBest, vIndex))
+        return false;
+    for (unsigned int i = 0; i < vIndex.size(); i++)
+    {
+        const CBlockIndex* pindex = vIndex[i].second;
+        if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
+        {
+            for (unsigned int j = 0; j < vIndex.size(); j++)
+                delete vIndex[j].second;
+            return error("LoadBlockIndexSnapshot() : failed stake modifier checkpoint height=%d", pindex->nHeight);
+        }
+    }
+
+    // Ascending keys make every insert an O(1) append
+    sort(vIndex.begin(), vIndex.end());
+    for (unsigned int i = 0; i < vIndex.size(); i++)
+    {
+        map<uint256, CBlockIndex*>::iterator mi = mapBlockIndex.insert(mapBlockIndex.end(), vIndex[i]);
+        CBlockIndex* pindexNew = mi->second;
+        pindexNew->phashBlock = &mi->first;
+
+        if (pindexGenesisBlock == NULL && mi->first == GetGenesisBlockHash())
+            pindexGenesisBlock = pindexNew;
+        if (pindexNew->IsProofOfStake())
+            setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+    }
+
+    printf("LoadBlockIndex(): %" PRIszu" entries from %s in %" PRId64"ms\n",
+           vIndex.size(), GetBlockIndexSnapshotPath().filename().string().c_str(), GetTimeMillis() - nStart);
+    return true;
+}
+
 bool CTxDB::LoadBlockIndex()
 {
     if (mapBlockIndex.size() > 0) {
@@ -1286,90 +1634,95 @@ bool CTxDB::LoadBlockIndex()
         // from BDB.
         return true;
     }
-    // The block index is an in-memory structure that maps hashes to on-disk
-    // locations where the contents of the block can be found. Here, we scan it
-    // out of the DB and into mapBlockIndex.
-    leveldb::Iterator *iterator = pdb->NewIterator(leveldb::ReadOptions());
-    // Seek to start key.
-    CDataStream ssStartKey(SER_DISK, CLIENT_VERSION);
-    ssStartKey << make_pair(string("blockindex"), uint256(0));
-    iterator->Seek(ssStartKey.str());
-    // Now read each entry.
-    while (iterator->Valid())
+    // A snapshot from the last clean shutdown carries everything the scan
+    // below would produce, chain trust included
+    if (!LoadBlockIndexSnapshot())
     {
-        // Unpack keys and values.
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.write(iterator->key().data(), iterator->key().size());
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue.write(iterator->value().data(), iterator->value().size());
-        string strType;
-        ssKey >> strType;
-        // Did we reach the end of the data to read?
-        if (fRequestShutdown || strType != "blockindex")
-            break;
-        CDiskBlockIndex diskindex;
-        ssValue >> diskindex;
-
-        uint256 blockHash = diskindex.GetBlockHash();
-
-        // Construct block index object
-        CBlockIndex* pindexNew    = InsertBlockIndex(blockHash);
-        pindexNew->pprev          = InsertBlockIndex(diskindex.hashPrev);
-        pindexNew->pnext          = InsertBlockIndex(diskindex.hashNext);
-        pindexNew->nFile          = diskindex.nFile;
-        pindexNew->nBlockPos      = diskindex.nBlockPos;
-        pindexNew->nHeight        = diskindex.nHeight;
-        pindexNew->nMint          = diskindex.nMint;
-        pindexNew->nMoneySupply   = diskindex.nMoneySupply;
-        pindexNew->nFlags         = diskindex.nFlags;
-        pindexNew->nStakeModifier = diskindex.nStakeModifier;
-        pindexNew->prevoutStake   = diskindex.prevoutStake;
-        pindexNew->nStakeTime     = diskindex.nStakeTime;
-        pindexNew->hashProof      = diskindex.hashProof;
-        pindexNew->nVersion       = diskindex.nVersion;
-        pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-        pindexNew->nTime          = diskindex.nTime;
-        pindexNew->nBits          = diskindex.nBits;
-        pindexNew->nNonce         = diskindex.nNonce;
-        // nSize populated later during chain trust calculation pass (not serialized for backward compat)
-
-        // Watch for genesis block
-        if (pindexGenesisBlock == NULL && blockHash == GetGenesisBlockHash())
-            pindexGenesisBlock = pindexNew;
-
-        if (!pindexNew->CheckIndex()) {
-            delete iterator;
-            return error("LoadBlockIndex() : CheckIndex failed at %d", pindexNew->nHeight);
-        }
+        // The block index is an in-memory structure that maps hashes to on-disk
+        // locations where the contents of the block can be found. Here, we scan it
+        // out of the DB and into mapBlockIndex.
+        leveldb::Iterator *iterator = pdb->NewIterator(leveldb::ReadOptions());
+        // Seek to start key.
+        CDataStream ssStartKey(SER_DISK, CLIENT_VERSION);
+        ssStartKey << make_pair(string("blockindex"), uint256(0));
+        iterator->Seek(ssStartKey.str());
+        // Now read each entry.
+        while (iterator->Valid())
+        {
+            // Unpack keys and values.
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            ssKey.write(iterator->key().data(), iterator->key().size());
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            ssValue.write(iterator->value().data(), iterator->value().size());
+            string strType;
+            ssKey >> strType;
+            // Did we reach the end of the data to read?
+            if (fRequestShutdown || strType != "blockindex")
+                break;
+            CDiskBlockIndex diskindex;
+            ssValue >> diskindex;
+
+            uint256 blockHash = diskindex.GetBlockHash();
+
+            // Construct block index object
+            CBlockIndex* pindexNew    = InsertBlockIndex(blockHash);
+            pindexNew->pprev          = InsertBlockIndex(diskindex.hashPrev);
+            pindexNew->pnext          = InsertBlockIndex(diskindex.hashNext);
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nBlockPos      = diskindex.nBlockPos;
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nMint          = diskindex.nMint;
+            pindexNew->nMoneySupply   = diskindex.nMoneySupply;
+            pindexNew->nFlags         = diskindex.nFlags;
+            pindexNew->nStakeModifier = diskindex.nStakeModifier;
+            pindexNew->prevoutStake   = diskindex.prevoutStake;
+            pindexNew->nStakeTime     = diskindex.nStakeTime;
+            pindexNew->hashProof      = diskindex.hashProof;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            // nSize populated later during chain trust calculation pass (not serialized for backward compat)
+
+            // Watch for genesis block
+            if (pindexGenesisBlock == NULL && blockHash == GetGenesisBlockHash())
+                pindexGenesisBlock = pindexNew;
+
+            if (!pindexNew->CheckIndex()) {
+                delete iterator;
+                return error("LoadBlockIndex() : CheckIndex failed at %d", pindexNew->nHeight);
+            }
 
-        // NovaCoin: build setStakeSeen
-        if (pindexNew->IsProofOfStake())
-            setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+            // NovaCoin: build setStakeSeen
+            if (pindexNew->IsProofOfStake())
+                setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
 
-        iterator->Next();
-    }
-    delete iterator;
+            iterator->Next();
+        }
+        delete iterator;
 
-    if (fRequestShutdown)
-        return true;
+        if (fRequestShutdown)
+            return true;
 
-    // Calculate nChainTrust
-    vector<pair<int, CBlockIndex*> > vSortedByHeight;
-    vSortedByHeight.reserve(mapBlockIndex.size());
-    for (const PAIRTYPE(uint256, CBlockIndex*)& item : mapBlockIndex)
-    {
-        CBlockIndex* pindex = item.second;
-        vSortedByHeight.push_back(make_pair(pindex->nHeight, pindex));
-    }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    for (const PAIRTYPE(int, CBlockIndex*)& item : vSortedByHeight)
-    {
-        CBlockIndex* pindex = item.second;
-        pindex->nChainTrust = (pindex->pprev ? pindex->pprev->nChainTrust : 0) + pindex->GetBlockTrust();
-        // NovaCoin: calculate stake modifier checksum
-        pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
-        if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
-            return error("CTxDB::LoadBlockIndex() : Failed stake modifier checkpoint height=%d, modifier=0x%016" PRIx64, pindex->nHeight, pindex->nStakeModifier);
+        // Calculate nChainTrust
+        vector<pair<int, CBlockIndex*> > vSortedByHeight;
+        vSortedByHeight.reserve(mapBlockIndex.size());
+        for (const PAIRTYPE(uint256, CBlockIndex*)& item : mapBlockIndex)
+        {
+            CBlockIndex* pindex = item.second;
+            vSortedByHeight.push_back(make_pair(pindex->nHeight, pindex));
+        }
+        sort(vSortedByHeight.begin(), vSortedByHeight.end());
+        for (const PAIRTYPE(int, CBlockIndex*)& item : vSortedByHeight)
+        {
+            CBlockIndex* pindex = item.second;
+            pindex->nChainTrust = (pindex->pprev ? pindex->pprev->nChainTrust : 0) + pindex->GetBlockTrust();
+            // NovaCoin: calculate stake modifier checksum
+            pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
+            if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
+                return error("CTxDB::LoadBlockIndex() : Failed stake modifier checkpoint height=%d, modifier=0x%016" PRIx64, pindex->nHeight, pindex->nStakeModifier);
+        }
     }
 
     // Load DAG links; ordering is deferred to init.cpp for incremental support
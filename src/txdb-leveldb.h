@@ -12,6 +12,7 @@
 #include "ringsig.h"
 #include "curvetree.h"
 
+#include <limits>
 #include <map>
 #include <string>
 #include <vector>
@@ -51,6 +52,12 @@ private:
     // A batch stores up writes and deletes for atomic application. When this
     // field is non-NULL, writes/deletes go there instead of directly to disk.
     leveldb::WriteBatch *activeBatch;
+    // txindex changes staged in activeBatch, applied to g_txCache on commit.
+    // An entry with first == false is an erase.
+    std::map<uint256, std::pair<bool, CTxIndex> > mapTxIndexPending;
+    // Lowest shielded commitment count written in activeBatch.
+    bool fCommitCountWritten;
+    uint64_t nCommitCountMin;
     leveldb::Options options;
     bool fReadOnly;
     int nVersion;
@@ -182,6 +189,8 @@ public:
     {
         delete activeBatch;
         activeBatch = NULL;
+        mapTxIndexPending.clear();
+        fCommitCountWritten = false;
         return true;
     }
 
@@ -230,7 +239,8 @@ public:
 
     bool WriteShieldedCommitment(uint64_t nIndex, const CPedersenCommitment& commit);
     bool ReadShieldedCommitment(uint64_t nIndex, CPedersenCommitment& commit);
-    bool ReadAllShieldedCommitments(std::vector<CPedersenCommitment>& vCommitments);
+    // Pool entries [nBegin, nEnd); fails if any is missing. See shieldedpool.h.
+    bool ReadShieldedCommitments(uint64_t nBegin, uint64_t nEnd, std::vector<CPedersenCommitment>& vCommitments);
     bool ReadShieldedCommitmentCount(uint64_t& nCount);
     bool WriteShieldedCommitmentCount(uint64_t nCount);
 
@@ -245,14 +255,24 @@ public:
 
     bool WriteCurveTree(const CCurveTree& tree);
     bool ReadCurveTree(CCurveTree& tree);
-    bool WriteCurveTreeAtBlock(const uint256& blockHash, const CCurveTree& tree);
+    bool WriteCurveTreeAtBlock(const uint256& blockHash, const CCurveTree& tree, int nHeight);
     bool ReadCurveTreeAtBlock(const uint256& blockHash, CCurveTree& tree);
     bool EraseCurveTreeAtBlock(const uint256& blockHash);
     bool WriteCurveTreeAtEpoch(int nEpoch, const CCurveTree& tree);
     bool ReadCurveTreeAtEpoch(int nEpoch, CCurveTree& tree);
 
-	bool ReadAddrIndex(uint160 addrHash, std::vector<uint256>& txHashes);
-    bool WriteAddrIndex(uint160 addrHash, uint256 txHash);
+    // Address index: one 'adx' key per (address, height, tx), an 'ads'
+    // summary per address. 'adr' is the old one-vector-per-address layout,
+    // still read until -reindexaddr converts it.
+    bool WriteAddrIndex(const CAddrIndexEntry& entry);
+    bool EraseAddrIndex(const CAddrIndexKey& key);
+    bool ReadAddrIndex(uint160 addrId, std::vector<CAddrIndexEntry>& vEntries,
+                       unsigned int nSkip = 0, unsigned int nCount = std::numeric_limits<unsigned int>::max());
+    bool WriteAddrSummary(uint160 addrId, const CAddrSummary& summary);
+    bool ReadAddrSummary(uint160 addrId, CAddrSummary& summary);
+    bool EraseAddrSummary(uint160 addrId);
+    bool ReadLegacyAddrIndex(uint160 addrId, std::vector<uint256>& txHashes);
+    bool EraseAddrIndexAll();
     bool ReadTxIndex(uint256 hash, CTxIndex& txindex);
     bool UpdateTxIndex(uint256 hash, const CTxIndex& txindex);
     bool AddTxIndex(const CTransaction& tx, const CDiskTxPos& pos, int nHeight);
@@ -262,6 +282,8 @@ public:
     bool ReadDiskTx(uint256 hash, CTransaction& tx);
     bool ReadDiskTx(COutPoint outpoint, CTransaction& tx, CTxIndex& txindex);
     bool ReadDiskTx(COutPoint outpoint, CTransaction& tx);
+    // Read a transaction known to be at pos, from g_txCache when possible.
+    bool ReadTxAtPos(const uint256& hash, const CDiskTxPos& pos, CTransaction& tx);
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex);
     bool EraseBlockIndex(const uint256& blockhash);
     bool ReadHashBestChain(uint256& hashBestChain);
@@ -275,6 +297,8 @@ public:
     bool ReadCheckpointPubKey(std::string& strPubKey);
     bool WriteCheckpointPubKey(const std::string& strPubKey);
     bool LoadBlockIndex();
+    // Save mapBlockIndex for a fast LoadBlockIndex() next time; cs_main held
+    bool WriteBlockIndexSnapshot();
 
     // DAG link persistence
     bool WriteDAGLinks(const uint256& hash, const CBlockDAGData& data);
@@ -330,6 +354,8 @@ public:
     bool IterateFinalityConnectedRotationBlocks(std::map<uint256, std::vector<int> >& mapOut);
 private:
     bool LoadBlockIndexGuts();
+    bool LoadBlockIndexSnapshot();
+    bool WriteTxIndexEntry(const uint256& hash, const CTxIndex* pvalue);
 };
 
 void InitIBDBatching();
@@ -11,6 +11,7 @@
 #include "main.h"
 #include "ui_interface.h"
 #include "tinyformat.h"
+#include "debuglog.h"
 #include <boost/algorithm/string/join.hpp>
 
 // Work around clang compilation problem in Boost 1.46:
@@ -58,6 +59,10 @@ namespace boost {
 # include <sys/prctl.h>
 #endif
 
+#ifndef WIN32
+#include <signal.h>
+#endif
+
 using namespace std;
 
 //Collateralnode  features
@@ -102,6 +107,7 @@ bool fNoListen = false;
 bool fLogTimestamps = false;
 CMedianFilter<int64_t> vTimeOffsets(200,0);
 bool fReopenDebugLog = false;
+unsigned int nLogRateLimit = 0;
 
 // Init OpenSSL library multithreading support
 static CCriticalSection** ppmutexOpenSSL;
@@ -265,6 +271,118 @@ bool IsLogOpen()
     return fileout != NULL;
 }
 
+// Set once by StartDebugLogWriter() and never freed, like mutexDebugLog
+static std::atomic<CDebugLogWriter*> pDebugLogWriter(NULL);
+// Zero-initialized, so usable from global constructors and destructors
+static CLogRateLimiter logRateLimiter;
+
+// Write to debug.log: through the writer thread's queue while it runs,
+// otherwise synchronously
+static int DebugLogWrite(const std::string &str)
+{
+    CDebugLogWriter* pwriter = pDebugLogWriter.load();
+    if (pwriter && pwriter->Append(str))
+        return str.size();
+
+    static bool fStartedNewLine = true;
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+
+    if (fileout == NULL)
+        return 0;
+
+    boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+
+    // reopen the log file, if requested; the writer thread does this while it runs
+    if (fReopenDebugLog && !(pwriter && pwriter->IsRunning())) {
+        fReopenDebugLog = false;
+        boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+        if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
+            setbuf(fileout, NULL); // unbuffered
+    }
+
+    int ret = 0;
+    // Debug print useful for profiling
+    if (fLogTimestamps && fStartedNewLine)
+        ret += fprintf(fileout, "%s ", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()).c_str());
+    if (!str.empty() && str[str.size()-1] == '\n')
+        fStartedNewLine = true;
+    else
+        fStartedNewLine = false;
+
+    ret += fwrite(str.data(), 1, str.size(), fileout);
+    return ret;
+}
+
+// Apply -lograte to one source, and log what it held back in the source's
+// previous second
+static bool LogRateAdmit(uint64_t nKey, const char* pszKey)
+{
+    uint32_t nSuppressed = 0;
+    const char* pszName = NULL;
+    bool fAdmit = logRateLimiter.Admit(nKey, pszKey, nLogRateLimit, GetTime(), nSuppressed, pszName);
+    if (nSuppressed > 0)
+    {
+        std::string strName(pszName, std::min(strlen(pszName), (size_t)48));
+        for (unsigned int i = 0; i < strName.size(); i++)
+            if (!isprint((unsigned char)strName[i]))
+                strName[i] = ' ';
+        DebugLogWrite(strprintf("debug.log: %u lines suppressed by -lograte from \"%s\"\n", nSuppressed, strName.c_str()));
+    }
+    return fAdmit;
+}
+
+#ifndef WIN32
+static void HandleFatalSignal(int nSignal)
+{
+    CDebugLogWriter* pwriter = pDebugLogWriter.load();
+    if (pwriter)
+        pwriter->FlushForCrash();
+    raise(nSignal);
+}
+#endif
+
+void StartDebugLogWriter()
+{
+    if (fPrintToConsole || pDebugLogWriter.load() != NULL)
+        return;
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    if (fileout == NULL)
+        return;
+
+    CDebugLogWriter* pwriter = new CDebugLogWriter();
+    {
+        // No synchronous write may be halfway through a line
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        if (!pwriter->Start(fileout, (GetDataDir() / "debug.log").string(), fLogTimestamps))
+        {
+            delete pwriter;
+            return;
+        }
+    }
+    pDebugLogWriter.store(pwriter);
+    atexit(StopDebugLogWriter);
+
+#ifndef WIN32
+    // Write out what is still queued before a crash takes the process down
+    struct sigaction sa;
+    sa.sa_handler = HandleFatalSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESETHAND;
+    sigaction(SIGSEGV, &sa, NULL);
+    sigaction(SIGBUS, &sa, NULL);
+    sigaction(SIGFPE, &sa, NULL);
+    sigaction(SIGILL, &sa, NULL);
+    sigaction(SIGABRT, &sa, NULL);
+#endif
+}
+
+void StopDebugLogWriter()
+{
+    CDebugLogWriter* pwriter = pDebugLogWriter.load();
+    if (pwriter)
+        pwriter->Stop();
+}
+
 bool LogAcceptCategory(const char* category)
 {
     if (category != NULL)
@@ -289,6 +407,16 @@ bool LogAcceptCategory(const char* category)
         if (setCategories.count(string("")) == 0 &&
             setCategories.count(string(category)) == 0)
             return false;
+
+        // -lograte counts a category as one source wherever it is logged from
+        if (nLogRateLimit > 0)
+        {
+            uint64_t nKey = 14695981039346656037ULL;
+            for (const char* p = category; *p; p++)
+                nKey = (nKey ^ (unsigned char)*p) * 1099511628211ULL;
+            if (!LogRateAdmit(nKey, category))
+                return false;
+        }
     }
     return true;
 }
@@ -303,31 +431,7 @@ int LogPrintStr(const std::string &str)
     }
     else if (fDebug)
     {
-        static bool fStartedNewLine = false;
-        boost::call_once(&DebugPrintInit, debugPrintInitFlag);
-
-        if (fileout == NULL)
-            return ret;
-
-        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
-
-        // reopen the log file, if requested
-        if (fReopenDebugLog) {
-            fReopenDebugLog = false;
-            boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-            if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
-                setbuf(fileout, NULL); // unbuffered
-        }
-
-        // Debug print useful for profiling
-        if (fLogTimestamps && fStartedNewLine)
-            ret += fprintf(fileout, "%s ", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()).c_str());
-        if (!str.empty() && str[str.size()-1] == '\n')
-            fStartedNewLine = true;
-        else
-            fStartedNewLine = false;
-
-        ret = fwrite(str.data(), 1, str.size(), fileout);
+        ret = DebugLogWrite(str);
     }
 
     return ret;
@@ -347,48 +451,15 @@ inline int OutputDebugStringF(const char* pszFormat, ...)
     }
     else if (!fPrintToDebugger)
     {
-        // print to debug.log
-        static FILE* fileout = NULL;
-
-        if (!fileout)
-        {
-            boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-            fileout = fopen(pathDebug.string().c_str(), "a");
-            if (fileout) setbuf(fileout, NULL); // unbuffered
-        }
-        if (fileout)
-        {
-            static bool fStartedNewLine = true;
-
-            // This routine may be called by global destructors during shutdown.
-            // Since the order of destruction of static/global objects is undefined,
-            // allocate mutexDebugLog on the heap the first time this routine
-            // is called to avoid crashes during shutdown.
-            static boost::mutex* mutexDebugLog = NULL;
-            if (mutexDebugLog == NULL) mutexDebugLog = new boost::mutex();
-            boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
-
-            // reopen the log file, if requested
-            if (fReopenDebugLog) {
-                fReopenDebugLog = false;
-                boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-                if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
-                    setbuf(fileout, NULL); // unbuffered
-            }
+        // print to debug.log; -lograte tells call sites apart by format string
+        if (nLogRateLimit > 0 && !LogRateAdmit((uint64_t)(uintptr_t)pszFormat, pszFormat))
+            return 0;
 
-            // Debug print useful for profiling
-            if (fLogTimestamps && fStartedNewLine)
-                fprintf(fileout, "%s ", DateTimeStrFormat("%x %H:%M:%S", GetTime()).c_str());
-            if (pszFormat[strlen(pszFormat) - 1] == '\n')
-                fStartedNewLine = true;
-            else
-                fStartedNewLine = false;
-
-            va_list arg_ptr;
-            va_start(arg_ptr, pszFormat);
-            ret = vfprintf(fileout, pszFormat, arg_ptr);
-            va_end(arg_ptr);
-        }
+        va_list arg_ptr;
+        va_start(arg_ptr, pszFormat);
+        std::string str = vstrprintf(pszFormat, arg_ptr);
+        va_end(arg_ptr);
+        ret = DebugLogWrite(str);
     }
 
 #ifdef WIN32
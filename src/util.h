@@ -135,6 +135,10 @@ inline void MilliSleep(int64_t n)
 }
 
 bool IsLogOpen();
+/* Hand debug.log to a background writer thread, flushed at exit and on fatal signals */
+void StartDebugLogWriter();
+/* Write out everything queued and go back to synchronous writes */
+void StopDebugLogWriter();
 /* Return true if log accepts specified category */
 bool LogAcceptCategory(const char* category);
 /* Send a string to the log output */
@@ -243,6 +247,7 @@ extern bool fCNLock;
 extern bool fNoListen;
 extern bool fLogTimestamps;
 extern bool fReopenDebugLog;
+extern unsigned int nLogRateLimit;
 
 void RandAddSeed();
 void RandAddSeedPerfmon();
@@ -386,17 +386,21 @@ void CWallet::LockCoin(COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.insert(output);
+    MarkBalanceDirty(output.hash);
 }
 
 void CWallet::UnlockCoin(COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    MarkBalanceDirty(output.hash);
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
+    BOOST_FOREACH(const COutPoint& output, setLockedCoins)
+        MarkBalanceDirty(output.hash);
     setLockedCoins.clear();
 }
 
@@ -788,11 +792,34 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
+        {
+            LOCK(cs_balances);
+            fBalancesValid = false;
+            setBalanceDirty.clear();
+        }
         BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
             item.second.MarkDirty();
     }
 }
 
+void CWallet::MarkBalanceDirty(const CWalletTx& wtx) const
+{
+    // Nothing to track before the ledger is first built, e.g. while loading
+    {
+        LOCK(cs_balances);
+        if (!fBalancesValid)
+            return;
+    }
+    MarkBalanceDirty(wtx.GetHash());
+}
+
+void CWallet::MarkBalanceDirty(const uint256& hash) const
+{
+    LOCK(cs_balances);
+    if (fBalancesValid)
+        setBalanceDirty.insert(hash);
+}
+
 bool CWallet::AddToWallet(const CWalletTx& wtxIn)
 {
     uint256 hash = wtxIn.GetHash();
@@ -909,6 +936,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn)
 #endif
         // since AddToWallet is called directly for self-originating transactions, check for consumption of own coins
         WalletUpdateSpent(wtx, (wtxIn.hashBlock != 0));
+        MarkBalanceDirty(hash);
 
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1106,7 +1134,10 @@ bool CWallet::EraseFromWallet(uint256 hash)
     {
         LOCK(cs_wallet);
         if (mapWallet.erase(hash))
+        {
+            MarkBalanceDirty(hash);
             CWalletDB(strWalletFile).EraseTx(hash);
+        }
     }
     return true;
 }
@@ -1773,182 +1804,181 @@ void CWallet::ResendWalletTransactions(bool fForce)
 //
 
 
-int64_t CWallet::GetBalance() const
+// Work out again wallet tx hash's share of every balance, with the same
+// tests the full mapWallet scans used to apply to each tx.
+void CWallet::RefreshTxBalances(const uint256& hash) const
 {
-    int64_t nTotal = 0;
+    std::map<uint256, CWalletBalances>::iterator mi = mapTxBalances.find(hash);
+    if (mi != mapTxBalances.end())
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        balancesTotal -= mi->second;
+        mapTxBalances.erase(mi);
+    }
+    setBalanceVolatile.erase(hash);
+    setUnspentTx.erase(hash);
+
+    map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+    if (it == mapWallet.end())
+        return;
+    const CWalletTx* pcoin = &(*it).second;
+
+    CWalletBalances balances;
+    bool fFinal = pcoin->IsFinal();
+    bool fTrusted = pcoin->IsTrusted();
+    int nDepth = pcoin->GetDepthInMainChain();
+    int nBlocksToMaturity = pcoin->GetBlocksToMaturity();
+
+    if (fTrusted)
+    {
+        balances.nTrusted = pcoin->GetAvailableCredit();
+        balances.nWatchOnly = pcoin->GetAvailableWatchOnlyCredit();
+        if (pcoin->nVersion == ANON_TXN_VERSION)
+            balances.nAnon = pcoin->GetAvailableAnonCredit();
+        if (nDepth > 0)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-            {
-                int64_t nCredit = pcoin->GetAvailableCredit();
-                if (nCredit > 0 && nTotal > std::numeric_limits<int64_t>::max() - nCredit)
-                {
-                    printf("ERROR: GetBalance() : balance overflow detected\n");
-                    return std::numeric_limits<int64_t>::max();
-                }
-                nTotal += nCredit;
-            }
+            balances.nUnlocked = pcoin->GetUnlockedCredit();
+            balances.nLocked = pcoin->GetLockedCredit();
+            balances.nStakeable = balances.nTrusted;
         }
     }
 
-    return nTotal;
+    if (!fFinal || (!fTrusted && nDepth == 0))
+    {
+        balances.nUnconfirmed = pcoin->GetAvailableCredit();
+        balances.nUnconfirmedWatchOnly = pcoin->GetAvailableWatchOnlyCredit();
+    }
+
+    if ((pcoin->IsCoinBase() || pcoin->IsCoinStake()) && nBlocksToMaturity > 0 && pcoin->IsInMainChain())
+    {
+        balances.nImmature = pcoin->GetImmatureCredit();
+        balances.nImmatureWatchOnly = pcoin->GetImmatureWatchOnlyCredit();
+        if (nDepth > 0)
+        {
+            if (pcoin->IsCoinStake())
+                balances.nStake = pcoin->GetCredit(ISMINE_SPENDABLE);
+            else
+                balances.nNewMint = pcoin->GetCredit(ISMINE_SPENDABLE);
+        }
+    }
+
+    bool fUnspent = false;
+    for (unsigned int i = 0; i < pcoin->vout.size(); i++)
+    {
+        if (pcoin->IsSpent(i) || IsMine(pcoin->vout[i]) == MINE_NO)
+            continue;
+        fUnspent = true;
+        if (fFinal && fTrusted && IsPayToColdStaking(pcoin->vout[i].scriptPubKey) &&
+            pcoin->vout[i].nValue > 0 && balances.nColdStaking <= MAX_MONEY - pcoin->vout[i].nValue)
+            balances.nColdStaking += pcoin->vout[i].nValue;
+    }
+
+    mapTxBalances[hash] = balances;
+    balancesTotal += balances;
+    if (fUnspent)
+        setUnspentTx.insert(hash);
+    // Confirmed and mature: only a spend, a lock or a reorg changes it now
+    if (!fFinal || nDepth <= 0 || nBlocksToMaturity > 0)
+        setBalanceVolatile.insert(hash);
 }
 
-int64_t CWallet::GetAnonBalance() const
+void CWallet::UpdateBalances() const
 {
-    int64_t nTotal = 0;
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
+    bool fRebuild;
+    std::set<uint256> setDirty;
     {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted() && pcoin->nVersion == ANON_TXN_VERSION)
-            {
-                int64_t nCredit = pcoin->GetAvailableAnonCredit();
-                if (nCredit > 0 && nTotal > std::numeric_limits<int64_t>::max() - nCredit)
-                    return std::numeric_limits<int64_t>::max();
-                nTotal += nCredit;
-            }
-        };
+        LOCK(cs_balances);
+        fRebuild = !fBalancesValid;
+        fBalancesValid = true;
+        setDirty.swap(setBalanceDirty);
     }
 
-    return nTotal;
-};
+    if (!fRebuild && hashBalanceBest != hashBestChain)
+    {
+        // A tip that extends the last one seen leaves confirmed txs as they
+        // were; anything else means blocks were disconnected
+        map<uint256, CBlockIndex*>::const_iterator mi = mapBlockIndex.find(hashBalanceBest);
+        if (mi == mapBlockIndex.end() || !mi->second->IsInMainChain())
+            fRebuild = true;
+        else
+            setDirty.insert(setBalanceVolatile.begin(), setBalanceVolatile.end());
+    }
 
-int64_t CWallet::GetUnlockedBalance() const
-{
-    int64_t nTotal = 0;
+    if (!fRebuild)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH(const uint256& hash, setDirty)
+            RefreshTxBalances(hash);
+    }
 
-            if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
-            {
-                int64_t nCredit = pcoin->GetUnlockedCredit();
-                if (nCredit > 0 && nTotal > std::numeric_limits<int64_t>::max() - nCredit)
-                    return std::numeric_limits<int64_t>::max();
-                nTotal += nCredit;
-            }
-        }
+    // Catches txs that came or went without being marked
+    if (fRebuild || mapTxBalances.size() != mapWallet.size())
+    {
+        int64_t nStart = GetTimeMillis();
+        balancesTotal.SetNull();
+        mapTxBalances.clear();
+        setBalanceVolatile.clear();
+        setUnspentTx.clear();
+        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+            RefreshTxBalances((*it).first);
+        if (fDebug)
+            printf("UpdateBalances() : rebuilt for %" PRIszu" txs in %" PRId64"ms\n", mapWallet.size(), GetTimeMillis() - nStart);
     }
 
-    return nTotal;
+    hashBalanceBest = hashBestChain;
 }
 
-int64_t CWallet::GetLockedBalance() const
+CWalletBalances CWallet::GetBalances() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+    LOCK2(cs_main, cs_wallet);
+    UpdateBalances();
+    return balancesTotal;
+}
 
-            if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
-            {
-                int64_t nCredit = pcoin->GetLockedCredit();
-                if (nCredit > 0 && nTotal > std::numeric_limits<int64_t>::max() - nCredit)
-                    return std::numeric_limits<int64_t>::max();
-                nTotal += nCredit;
-            }
-        }
-    }
-    return nTotal;
+int64_t CWallet::GetBalance() const
+{
+    return GetBalances().nTrusted;
+}
+
+int64_t CWallet::GetAnonBalance() const
+{
+    return GetBalances().nAnon;
+};
+
+int64_t CWallet::GetUnlockedBalance() const
+{
+    return GetBalances().nUnlocked;
+}
+
+int64_t CWallet::GetLockedBalance() const
+{
+    return GetBalances().nLocked;
 }
 
 int64_t CWallet::GetUnconfirmedBalance() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsFinal() || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
-            {
-                int64_t nCredit = pcoin->GetAvailableCredit();
-                if (nCredit > 0 && nTotal > std::numeric_limits<int64_t>::max() - nCredit)
-                    return std::numeric_limits<int64_t>::max();
-                nTotal += nCredit;
-            }
-        }
-    }
-    return nTotal;
+    return GetBalances().nUnconfirmed;
 }
 
 int64_t CWallet::GetImmatureBalance() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if ((pcoin->IsCoinBase() || pcoin->IsCoinStake()) && pcoin->GetBlocksToMaturity() > 0 && pcoin->IsInMainChain())
-            {
-                int64_t nCredit = pcoin->GetImmatureCredit();
-                if (nCredit > 0 && nTotal > std::numeric_limits<int64_t>::max() - nCredit)
-                    return std::numeric_limits<int64_t>::max();
-                nTotal += nCredit;
-            }
-        }
-    }
-    return nTotal;
+    return GetBalances().nImmature;
 }
 
 int64_t CWallet::GetWatchOnlyBalance() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-            {
-                int64_t nCredit = pcoin->GetAvailableWatchOnlyCredit();
-                if (nCredit > 0 && nTotal > std::numeric_limits<int64_t>::max() - nCredit)
-                    return std::numeric_limits<int64_t>::max();
-                nTotal += nCredit;
-            }
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nWatchOnly;
 }
 
 int64_t CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!IsFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nUnconfirmedWatchOnly;
 }
 
 int64_t CWallet::GetImmatureWatchOnlyBalance() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if ((pcoin->IsCoinBase() || pcoin->IsCoinStake()) && pcoin->GetBlocksToMaturity() > 0 && pcoin->IsInMainChain())
-                nTotal += pcoin->GetImmatureWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nImmatureWatchOnly;
 }
 
 CBloomFilter* CWallet::CreateSPVBloomFilter(double nFPRate, unsigned int nFlags) const
@@ -2061,8 +2091,13 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        // Only txs with an unspent output of ours can contribute
+        UpdateBalances();
+        for (set<uint256>::const_iterator iu = setUnspentTx.begin(); iu != setUnspentTx.end(); ++iu)
         {
+            map<uint256, CWalletTx>::const_iterator it = mapWallet.find(*iu);
+            if (it == mapWallet.end())
+                continue;
             const CWalletTx* pcoin = &(*it).second;
 
             if (!pcoin->IsFinal())
@@ -2163,8 +2198,13 @@ void CWallet::AvailableCoinsForStaking(vector<COutput>& vCoins, unsigned int nSp
     {
         AssertLockHeld(cs_main);
         AssertLockHeld(cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        // Only txs with an unspent output of ours can contribute
+        UpdateBalances();
+        for (set<uint256>::const_iterator iu = setUnspentTx.begin(); iu != setUnspentTx.end(); ++iu)
         {
+            map<uint256, CWalletTx>::const_iterator it = mapWallet.find(*iu);
+            if (it == mapWallet.end())
+                continue;
             const CWalletTx* pcoin = &(*it).second;
 
             // Filtering by tx timestamp instead of block timestamp may give false positives but never false negatives
@@ -2233,44 +2273,17 @@ static void ApproximateBestSubset(vector<pair<int64_t, pair<const CWalletTx*,uns
 // innova: total coins available for staking - WIP needs updating
 int64_t CWallet::GetStakeAmount() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0) //Just pulls GetBalance() currently
-                nTotal += pcoin->GetAvailableCredit();
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nStakeable;
 }
 
 int64_t CWallet::GetStake() const
 {
-    int64_t nTotal = 0;
-    LOCK2(cs_main, cs_wallet);
-    for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-    {
-        const CWalletTx* pcoin = &(*it).second;
-        if (pcoin->IsCoinStake() && pcoin->GetBlocksToMaturity() > 0 && pcoin->GetDepthInMainChain() > 0)
-            nTotal += pcoin->GetCredit(ISMINE_SPENDABLE);
-    }
-    return nTotal;
+    return GetBalances().nStake;
 }
 
 int64_t CWallet::GetNewMint() const
 {
-    int64_t nTotal = 0;
-    LOCK2(cs_main, cs_wallet);
-    for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-    {
-        const CWalletTx* pcoin = &(*it).second;
-        if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0 && pcoin->GetDepthInMainChain() > 0)
-            nTotal += pcoin->GetCredit(ISMINE_SPENDABLE);
-    }
-    return nTotal;
+    return GetBalances().nNewMint;
 }
 
 
@@ -4657,11 +4670,13 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
                             txdb.ReadShieldedTree(tree);
                             stakeSpend.anchor = tree.Root();
 
-                            std::vector<CPedersenCommitment> vAllCommitments;
-                            txdb.ReadAllShieldedCommitments(vAllCommitments);
+                            CCommitmentPoolSnapshot vAllCommitments;
+                            if (!g_commitmentPool.GetSnapshot(txdb, vAllCommitments))
+                                continue;
+                            int64_t nGlobalOutputIndex = g_commitmentPool.FindIndex(txdb, vAllCommitments, stakeSpend.cv);
 
                             CAnonymitySet anonSet;
-                            if (!BuildAnonymitySet(stakeSpend.cv, vAllCommitments, stakeSpend.anchor,
+                            if (!BuildAnonymitySet(stakeSpend.cv, nGlobalOutputIndex, vAllCommitments, stakeSpend.anchor,
                                                     pindexPrev->nHeight, anonSet))
                                 continue;
 
@@ -4670,11 +4685,6 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
                                 continue;
 
                             CLelantusProof lelantusProof;
-                            int64_t nGlobalOutputIndex = -1;
-                            for (size_t ci = 0; ci < vAllCommitments.size(); ci++)
-                            {
-                                if (vAllCommitments[ci] == stakeSpend.cv) { nGlobalOutputIndex = (int64_t)ci; break; }
-                            }
                             int64_t nSerialIdx = (pindexPrev->nHeight >= FORK_HEIGHT_SERIAL_V2) ? nGlobalOutputIndex : -1;
                             uint256 serial = ComputeLelantusSerial(sk.skSpend, wnote.note.rho, stakeSpend.cv, nSerialIdx);
                             if (!CreateLelantusProof(anonSet, nRealIndex, wnote.note.nValue,
@@ -5052,11 +5062,13 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
                                 txdb.ReadShieldedTree(tree);
                                 stakeSpend.anchor = tree.Root();
 
-                                std::vector<CPedersenCommitment> vAllCommitments;
-                                txdb.ReadAllShieldedCommitments(vAllCommitments);
+                                CCommitmentPoolSnapshot vAllCommitments;
+                                if (!g_commitmentPool.GetSnapshot(txdb, vAllCommitments))
+                                    continue;
+                                int64_t nGlobalOutputIndex = g_commitmentPool.FindIndex(txdb, vAllCommitments, stakeSpend.cv);
 
                                 CAnonymitySet anonSet;
-                                if (!BuildAnonymitySet(stakeSpend.cv, vAllCommitments, stakeSpend.anchor,
+                                if (!BuildAnonymitySet(stakeSpend.cv, nGlobalOutputIndex, vAllCommitments, stakeSpend.anchor,
                                                         pindexPrev->nHeight, anonSet))
                                     continue;
 
@@ -5064,11 +5076,6 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
                                 if (nRealIndex < 0)
                                     continue;
 
-                                int64_t nGlobalOutputIndex = -1;
-                                for (size_t ci = 0; ci < vAllCommitments.size(); ci++)
-                                {
-                                    if (vAllCommitments[ci] == stakeSpend.cv) { nGlobalOutputIndex = (int64_t)ci; break; }
-                                }
                                 int64_t nSerialIdx = (pindexPrev->nHeight >= FORK_HEIGHT_SERIAL_V2) ? nGlobalOutputIndex : -1;
                                 uint256 serial = ComputeLelantusSerial(skStake, wnote.note.rho, stakeSpend.cv, nSerialIdx);
                                 CLelantusProof lelantusProof;
@@ -6550,6 +6557,7 @@ bool CWallet::UndoAnonTransaction(const CTransaction& tx)
     };
 
     mapWallet.erase(txnHash);
+    MarkBalanceDirty(txnHash);
 
     return true;
 };
@@ -9028,32 +9036,7 @@ bool CWallet::CreateColdStakeDelegation(const CKeyID& stakerKeyID, const CKeyID&
 
 int64_t CWallet::GetColdStakingBalance() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsFinal() || !pcoin->IsTrusted())
-                continue;
-
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++)
-            {
-                if (pcoin->IsSpent(i))
-                    continue;
-                if (IsPayToColdStaking(pcoin->vout[i].scriptPubKey))
-                {
-                    isminetype mine = IsMine(pcoin->vout[i]);
-                    if (mine != MINE_NO)
-                    {
-                        if (pcoin->vout[i].nValue > 0 && nTotal <= MAX_MONEY - pcoin->vout[i].nValue)
-                            nTotal += pcoin->vout[i].nValue;
-                    }
-                }
-            }
-        }
-    }
-    return nTotal;
+    return GetBalances().nColdStaking;
 }
 
 bool CWallet::NeedsStakingPreparation() const
@@ -9633,6 +9616,7 @@ bool CWallet::SelectCoinsForStakingSPV(std::set<std::pair<const CWalletTx*,unsig
                                         CWalletTx wtx(const_cast<CWallet*>(this), tx);
                                         wtx.hashBlock = spvIt->second.hashBlock;
                                         wtx.nTime = spvIt->second.nTime;
+                                        wtx.ClearHashCache();
                                         const_cast<CWallet*>(this)->AddToWallet(wtx);
 
                                         auto newIt = mapWallet.find(outpoint.hash);
@@ -156,12 +156,83 @@ struct SPVUtxo
     }
 };
 
+/** Wallet balances by kind, as the CWallet::Get*Balance() calls report them.
+  * The wallet keeps one per transaction and their sum, see GetBalances().
+  */
+struct CWalletBalances
+{
+    int64_t nTrusted;
+    int64_t nUnconfirmed;
+    int64_t nImmature;
+    int64_t nLocked;
+    int64_t nUnlocked;
+    int64_t nStakeable;         // trusted and confirmed, GetStakeAmount()
+    int64_t nStake;             // immature coinstake credit
+    int64_t nNewMint;           // immature coinbase credit
+    int64_t nWatchOnly;
+    int64_t nUnconfirmedWatchOnly;
+    int64_t nImmatureWatchOnly;
+    int64_t nAnon;
+    int64_t nColdStaking;
+
+    CWalletBalances() { SetNull(); }
+
+    void SetNull()
+    {
+        nTrusted = nUnconfirmed = nImmature = nLocked = nUnlocked = nStakeable = 0;
+        nStake = nNewMint = nWatchOnly = nUnconfirmedWatchOnly = nImmatureWatchOnly = 0;
+        nAnon = nColdStaking = 0;
+    }
+
+    CWalletBalances& operator+=(const CWalletBalances& b)
+    {
+        nTrusted += b.nTrusted; nUnconfirmed += b.nUnconfirmed; nImmature += b.nImmature;
+        nLocked += b.nLocked; nUnlocked += b.nUnlocked; nStakeable += b.nStakeable;
+        nStake += b.nStake; nNewMint += b.nNewMint; nWatchOnly += b.nWatchOnly;
+        nUnconfirmedWatchOnly += b.nUnconfirmedWatchOnly; nImmatureWatchOnly += b.nImmatureWatchOnly;
+        nAnon += b.nAnon; nColdStaking += b.nColdStaking;
+        return *this;
+    }
+
+    CWalletBalances& operator-=(const CWalletBalances& b)
+    {
+        nTrusted -= b.nTrusted; nUnconfirmed -= b.nUnconfirmed; nImmature -= b.nImmature;
+        nLocked -= b.nLocked; nUnlocked -= b.nUnlocked; nStakeable -= b.nStakeable;
+        nStake -= b.nStake; nNewMint -= b.nNewMint; nWatchOnly -= b.nWatchOnly;
+        nUnconfirmedWatchOnly -= b.nUnconfirmedWatchOnly; nImmatureWatchOnly -= b.nImmatureWatchOnly;
+        nAnon -= b.nAnon; nColdStaking -= b.nColdStaking;
+        return *this;
+    }
+};
+
 /** A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
  */
 class CWallet : public CCryptoKeyStore
 {
 private:
+    // Balance ledger. Every wallet tx has its share of the balances in
+    // mapTxBalances and balancesTotal is their sum, so reading a balance
+    // doesn't walk mapWallet. A tx's share is worked out again when it is
+    // marked dirty (added, spent, unspent, coins locked), and on a new tip
+    // for the txs whose share can still change with the chain alone:
+    // unconfirmed, immature or not final ones. A disconnected tip or
+    // CWallet::MarkDirty() rebuilds the lot. setUnspentTx holds the txs with
+    // an unspent output of ours, which is all AvailableCoins() has to look at.
+    // Guarded by cs_main and cs_wallet, except the dirty set and the valid
+    // flag, which only take cs_balances so marking never has lock order
+    // trouble.
+    mutable CWalletBalances balancesTotal;
+    mutable std::map<uint256, CWalletBalances> mapTxBalances;
+    mutable std::set<uint256> setBalanceVolatile;
+    mutable std::set<uint256> setUnspentTx;
+    mutable uint256 hashBalanceBest;
+    mutable CCriticalSection cs_balances;
+    mutable std::set<uint256> setBalanceDirty;
+    mutable bool fBalancesValid;
+
+    void UpdateBalances() const;
+    void RefreshTxBalances(const uint256& hash) const;
     bool SelectCoinsForStaking(int64_t nTargetValue, unsigned int nSpendTime, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, int64_t& nValueRet) const;
     bool SelectCoinsForStakingSPV(std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet) const;
     bool SelectCoins(int64_t nTargetValue, unsigned int nSpendTime, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, int64_t& nValueRet, const CCoinControl *coinControl=NULL) const;
@@ -287,6 +358,7 @@ public:
         pwalletdbEncryption = NULL;
         nOrderPosNext = 0;
         nTimeFirstKey = 0;
+        fBalancesValid = false;
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -406,6 +478,11 @@ public:
     TxItems OrderedTxItems(std::list<CAccountingEntry>& acentries, std::string strAccount = "", bool fShowCoinstake = true);
 
     void MarkDirty();
+    /** Have the balance ledger look at wtx again on the next read */
+    void MarkBalanceDirty(const CWalletTx& wtx) const;
+    void MarkBalanceDirty(const uint256& hash) const;
+    /** Current balances of every kind; O(1) unless something changed */
+    CWalletBalances GetBalances() const;
     bool AddToWallet(const CWalletTx& wtxIn);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate = false, bool fFindBlock = false);
     bool EraseFromWallet(uint256 hash);
@@ -913,6 +990,8 @@ public:
                 fAvailableCreditCached = false;
             }
         }
+        if (fReturn && pwallet)
+            pwallet->MarkBalanceDirty(*this);
         return fReturn;
     }
 
@@ -929,6 +1008,8 @@ public:
         fChangeCached = false;
         fAvailableAnonCreditCached = false;
         fCreditSplitCached = false;
+        if (pwallet)
+            pwallet->MarkBalanceDirty(*this);
     }
 
     void BindWallet(CWallet *pwalletIn)
@@ -946,6 +1027,8 @@ public:
         {
             vfSpent[nOut] = true;
             fAvailableCreditCached = false;
+            if (pwallet)
+                pwallet->MarkBalanceDirty(*this);
         }
     }
 
@@ -958,6 +1041,8 @@ public:
         {
             vfSpent[nOut] = false;
             fAvailableCreditCached = false;
+            if (pwallet)
+                pwallet->MarkBalanceDirty(*this);
         }
     }
 
@@ -4,6 +4,7 @@
 
 #include "zkproof.h"
 #include "hash.h"
+#include "msm.h"
 #include "util.h"
 #include "verifycache.h"
 
@@ -827,6 +828,35 @@ static void FreeBPGenerators(std::vector<EC_POINT*>& vG, std::vector<EC_POINT*>&
     vH.clear();
 }
 
+// The range proof generators as one fixed base table, in the order
+// G, H, G_0, H_0, G_1, H_1, ... The 2N hash-to-curve derivations and the table
+// are made once, on the first verify.
+static const int BP_RANGE_BITS = 64;
+static CCriticalSection cs_bpRangeGenerators;
+static const CMSMFixedBase* pBPRangeGenerators = NULL;
+
+static const CMSMFixedBase* GetBPRangeGenerators(const EC_GROUP* group, BN_CTX* ctx)
+{
+    LOCK(cs_bpRangeGenerators);
+    if (pBPRangeGenerators)
+        return pBPRangeGenerators;
+
+    std::vector<EC_POINT*> vGi, vHi;
+    if (!GenerateBPGenerators(group, BP_RANGE_BITS, vGi, vHi, ctx))
+        return NULL;
+    std::vector<std::vector<unsigned char> > vBaseBytes(2 + 2 * BP_RANGE_BITS);
+    vBaseBytes[0] = CZKContext::GetGeneratorG();
+    vBaseBytes[1] = CZKContext::GetGeneratorH();
+    bool fOk = true;
+    for (int i = 0; i < BP_RANGE_BITS && fOk; i++)
+        fOk = PointToBytes(group, vGi[i], vBaseBytes[2 + 2 * i], ctx) &&
+              PointToBytes(group, vHi[i], vBaseBytes[3 + 2 * i], ctx);
+    FreeBPGenerators(vGi, vHi);
+    if (fOk)
+        pBPRangeGenerators = GetMSMFixedBase("bp-range-64", vBaseBytes);
+    return pBPRangeGenerators;
+}
+
 static bool FiatShamirChallenge(const std::vector<unsigned char>& transcript,
                                  BIGNUM* challenge, const BIGNUM* order, BN_CTX* ctx)
 {
@@ -1450,242 +1480,546 @@ bool VerifyBulletproofRangeProof(const CPedersenCommitment& commit,
     BN_mod_mul(tmp, z3, sum2n, order, ctx);
     BN_mod_sub(delta, delta, tmp, order, ctx);
 
-    CECPointGuard LHS(group);
-    {
-        CECPointGuard p1(group), p2(group);
-        EC_POINT_mul(group, p1, NULL, H, t_hat, ctx);
-        EC_POINT_mul(group, p2, NULL, G, taux, ctx);
-        EC_POINT_add(group, LHS, p1, p2, ctx);
-    }
-
-    CECPointGuard RHS(group);
+    // (1) t_hat*H + taux*G - z^2*V - delta*H - x*T1 - x^2*T2 is the identity
+    bool fValid;
     {
-        CECPointGuard V(group);
+        CECPointGuard V(group), result(group);
         BytesToPoint(group, commit.vchCommitment, V, ctx);
 
-        CECPointGuard p1(group), p2(group), p3(group), p4(group);
-        EC_POINT_mul(group, p1, NULL, V, z2, ctx);
-        EC_POINT_mul(group, p2, NULL, H, delta, ctx);
-        EC_POINT_mul(group, p3, NULL, T1, x, ctx);
-        EC_POINT_mul(group, p4, NULL, T2, x2, ctx);
-
-        EC_POINT_add(group, RHS, p1, p2, ctx);
-        EC_POINT_add(group, RHS, RHS, p3, ctx);
-        EC_POINT_add(group, RHS, RHS, p4, ctx);
-    }
-
-    bool fValid = (EC_POINT_cmp(group, LHS, RHS, ctx) == 0);
-
+        CBNGuard hCoeff, negZ2, negX, negX2;
+        BN_mod_sub(hCoeff, t_hat, delta, order, ctx);
+        BN_sub(negZ2, order, z2);
+        BN_sub(negX, order, x);
+        BN_sub(negX2, order, x2);
+
+        std::vector<EC_POINT*> vPoints;
+        std::vector<BIGNUM*> vScalars;
+        vPoints.push_back(G); vScalars.push_back(taux);
+        vPoints.push_back(H); vScalars.push_back(hCoeff);
+        vPoints.push_back(V); vScalars.push_back(negZ2);
+        vPoints.push_back(T1); vScalars.push_back(negX);
+        vPoints.push_back(T2); vScalars.push_back(negX2);
+        fValid = MultiScalarMul(group, ctx, vPoints, vScalars, result) &&
+                 EC_POINT_is_at_infinity(group, result) == 1;
+    }
+
+    // (2) A + x*S - z*sum(Gi) + sum((z + z^2*2^i*y^-i)*Hi) - mu*G + t_hat*H
+    //     + sum(u_j^2*L_j + u_j^-2*R_j) - sum(a*s_i*Gi + b*s_i^-1*y^-i*Hi) - a*b*H
+    // is the identity. The proof's own points go through the variable
+    // multiplication and the generators through their fixed base table.
     if (fValid)
     {
-        std::vector<EC_POINT*> vL(logN), vR(logN);
-        std::vector<BIGNUM*> vChallenge(logN);
-
-        for (int round = 0; round < logN; round++)
+        const CMSMFixedBase* pGens = GetBPRangeGenerators(group, ctx);
+        std::vector<CECPointGuard*> vLR;
+        std::vector<BIGNUM*> vU, vUInv;
+        for (int round = 0; round < logN && fValid; round++)
         {
-            vL[round] = EC_POINT_new(group);
-            vR[round] = EC_POINT_new(group);
-
-            if (EC_POINT_oct2point(group, vL[round], proof.vchProof.data() + offset, 33, ctx) != 1 ||
-                EC_POINT_is_on_curve(group, vL[round], ctx) != 1)
+            CECPointGuard* pL = new CECPointGuard(group);
+            CECPointGuard* pR = new CECPointGuard(group);
+            vLR.push_back(pL);
+            vLR.push_back(pR);
+            if (EC_POINT_oct2point(group, *pL, proof.vchProof.data() + offset, 33, ctx) != 1 ||
+                EC_POINT_is_on_curve(group, *pL, ctx) != 1 ||
+                EC_POINT_oct2point(group, *pR, proof.vchProof.data() + offset + 33, 33, ctx) != 1 ||
+                EC_POINT_is_on_curve(group, *pR, ctx) != 1)
             {
                 fValid = false;
                 break;
             }
-            offset += 33;
-            if (EC_POINT_oct2point(group, vR[round], proof.vchProof.data() + offset, 33, ctx) != 1 ||
-                EC_POINT_is_on_curve(group, vR[round], ctx) != 1)
-            {
-                fValid = false;
-                break;
-            }
-            offset += 33;
+            offset += 66;
 
-            AppendToTranscript(transcript, group, vL[round], ctx);
-            AppendToTranscript(transcript, group, vR[round], ctx);
+            AppendToTranscript(transcript, group, *pL, ctx);
+            AppendToTranscript(transcript, group, *pR, ctx);
 
-            vChallenge[round] = BN_new();
-            FiatShamirChallenge(transcript, vChallenge[round], order, ctx);
+            vU.push_back(BN_new());
+            vUInv.push_back(BN_new());
+            FiatShamirChallenge(transcript, vU[round], order, ctx);
+            BN_mod_inverse(vUInv[round], vU[round], order, ctx);
         }
 
-        BIGNUM* a_final = BN_bin2bn(proof.vchProof.data() + offset, 32, NULL); offset += 32;
-        BIGNUM* b_final = BN_bin2bn(proof.vchProof.data() + offset, 32, NULL); offset += 32;
+        CBNGuard a_final, b_final;
+        if (fValid &&
+            (!BN_bin2bn(proof.vchProof.data() + offset, 32, a_final) ||
+             !BN_bin2bn(proof.vchProof.data() + offset + 32, 32, b_final) ||
+             BN_cmp(a_final, order) >= 0 || BN_cmp(b_final, order) >= 0))
+            fValid = false;
+        if (!pGens || pGens->size() != 2 + 2 * (size_t)N)
+            fValid = false;
 
-        if (!a_final || !b_final || BN_cmp(a_final, order) >= 0 || BN_cmp(b_final, order) >= 0)
+        if (fValid)
         {
-            if (a_final) BN_free(a_final);
-            if (b_final) BN_free(b_final);
-            return false;
-        }
+            std::vector<EC_POINT*> vPoints;
+            std::vector<BIGNUM*> vScalars;
+            std::vector<BIGNUM*> vGenScalars;
+            for (int i = 0; i < 2 + 2 * N; i++)
+                vGenScalars.push_back(BN_new());
+
+            CBNGuard one, uSq, tmp2;
+            BN_one(one);
+            vPoints.push_back(A); vScalars.push_back(BN_dup(one));
+            vPoints.push_back(S); vScalars.push_back(BN_dup(x));
+            for (int round = 0; round < logN; round++)
+            {
+                BN_mod_sqr(uSq, vU[round], order, ctx);
+                vPoints.push_back(*vLR[2 * round]); vScalars.push_back(BN_dup(uSq));
+                BN_mod_sqr(uSq, vUInv[round], order, ctx);
+                vPoints.push_back(*vLR[2 * round + 1]); vScalars.push_back(BN_dup(uSq));
+            }
 
-        BIGNUM* ab = BN_new();
-        BN_mod_mul(ab, a_final, b_final, order, ctx);
+            // G: -mu, H: t_hat - a*b
+            BN_sub(vGenScalars[0], order, mu);
+            BN_mod_mul(tmp, a_final, b_final, order, ctx);
+            BN_mod_sub(vGenScalars[1], t_hat, tmp, order, ctx);
 
-        std::vector<EC_POINT*> vGi, vHi;
-        GenerateBPGenerators(group, N, vGi, vHi, ctx);
+            CBNGuard sG, sH;
+            for (int i = 0; i < N; i++)
+            {
+                BN_one(sG);
+                BN_one(sH);
+                for (int j = 0; j < logN; j++)
+                {
+                    if ((i >> (logN - 1 - j)) & 1)
+                    {
+                        BN_mod_mul(sG, sG, vU[j], order, ctx);
+                        BN_mod_mul(sH, sH, vUInv[j], order, ctx);
+                    }
+                    else
+                    {
+                        BN_mod_mul(sG, sG, vUInv[j], order, ctx);
+                        BN_mod_mul(sH, sH, vU[j], order, ctx);
+                    }
+                }
 
-        CECPointGuard P(group);
-        {
-            CECPointGuard xS(group);
-            EC_POINT_mul(group, xS, NULL, S, x, ctx);
-            EC_POINT_add(group, P, A, xS, ctx);
+                // Gi: -(z + a*s_i)
+                BN_mod_mul(tmp, a_final, sG, order, ctx);
+                BN_mod_add(tmp, tmp, z, order, ctx);
+                BN_mod_sub(vGenScalars[2 + 2 * i], order, tmp, order, ctx);
+
+                // Hi: z + (z^2*2^i - b*s_i^-1)*y^-i
+                BN_mod_mul(tmp, z2, twon[i], order, ctx);
+                BN_mod_mul(tmp2, b_final, sH, order, ctx);
+                BN_mod_sub(tmp, tmp, tmp2, order, ctx);
+                BN_mod_mul(tmp, tmp, y_inv_n[i], order, ctx);
+                BN_mod_add(vGenScalars[3 + 2 * i], tmp, z, order, ctx);
+            }
+
+            CECPointGuard result(group), genSum(group);
+            fValid = MultiScalarMul(group, ctx, vPoints, vScalars, result) &&
+                     pGens->Mul(group, ctx, vGenScalars, genSum) &&
+                     EC_POINT_add(group, result, result, genSum, ctx) == 1 &&
+                     EC_POINT_is_at_infinity(group, result) == 1;
+
+            FreeScalars(vScalars);
+            FreeScalars(vGenScalars);
         }
 
+        for (size_t i = 0; i < vLR.size(); i++)
+            delete vLR[i];
+        FreeScalars(vU);
+        FreeScalars(vUInv);
+    }
+
+    BN_clear_free(taux);
+    BN_clear_free(mu);
+    BN_free(t_hat);
+    BN_free(y); BN_free(z);
+    BN_free(x); BN_free(x2);
+    BN_free(z2); BN_free(z3);
+    BN_free(delta); BN_free(sumYn); BN_free(sum2n);
+    BN_free(tmp);
+    FreeScalars(yn); FreeScalars(twon);
+    FreeScalars(y_inv_n);
+
+    return fValid;
+}
+
+// Accumulators for a batch of range proofs. Every proof contributes two
+// equations that must each be the identity:
+//
+//   (1) t_hat*H + taux*G - z^2*V - delta*H - x*T1 - x^2*T2
+//   (2) A + x*S - z*sum(Gi) + sum((z + z^2*2^i*y^-i)*Hi) - mu*G + t_hat*H
+//       + sum(u_j^2*L_j + u_j^-2*R_j) - sum(a*s_i*Gi + b*s_i^-1*y^-i*Hi) - a*b*H
+//
+// which are the two checks VerifyBulletproofRangeProof makes. Scaling (1) and
+// (2) by independent random weights and summing over all proofs folds the
+// whole batch into one multi-scalar multiplication: the coefficients on the
+// shared generators G, H, Gi and Hi are summed, and the per-proof points
+// (V, A, S, T1, T2, L, R) carry their own weighted scalar.
+struct CBulletproofBatch
+{
+    const EC_GROUP* group;
+    const BIGNUM* order;
+    BN_CTX* ctx;
+    BIGNUM* gCoeff;
+    BIGNUM* hCoeff;
+    std::vector<BIGNUM*> vGiCoeff;
+    std::vector<BIGNUM*> vHiCoeff;
+    std::vector<EC_POINT*> vPoints;
+    std::vector<BIGNUM*> vScalars;
+
+    CBulletproofBatch(const EC_GROUP* groupIn, const BIGNUM* orderIn, BN_CTX* ctxIn, int N)
+        : group(groupIn), order(orderIn), ctx(ctxIn)
+    {
+        gCoeff = BN_new(); BN_zero(gCoeff);
+        hCoeff = BN_new(); BN_zero(hCoeff);
+        vGiCoeff.resize(N);
+        vHiCoeff.resize(N);
         for (int i = 0; i < N; i++)
         {
-            CECPointGuard tmp2(group);
-            EC_POINT_mul(group, tmp2, NULL, vGi[i], z, ctx);
-            EC_POINT_invert(group, tmp2, ctx);
-            EC_POINT_add(group, P, P, tmp2, ctx);
+            vGiCoeff[i] = BN_new(); BN_zero(vGiCoeff[i]);
+            vHiCoeff[i] = BN_new(); BN_zero(vHiCoeff[i]);
         }
+    }
 
-        for (int i = 0; i < N; i++)
-        {
-            BIGNUM* coeff = BN_new();
-            BN_mod_mul(coeff, z2, twon[i], order, ctx);
-            BN_mod_mul(coeff, coeff, y_inv_n[i], order, ctx);
-            BN_mod_add(coeff, coeff, z, order, ctx);
+    ~CBulletproofBatch()
+    {
+        BN_free(gCoeff);
+        BN_free(hCoeff);
+        FreeScalars(vGiCoeff);
+        FreeScalars(vHiCoeff);
+        FreeScalars(vScalars);
+        for (size_t i = 0; i < vPoints.size(); i++)
+            EC_POINT_free(vPoints[i]);
+    }
 
-            CECPointGuard tmp2(group);
-            EC_POINT_mul(group, tmp2, NULL, vHi[i], coeff, ctx);
-            EC_POINT_add(group, P, P, tmp2, ctx);
+    void AddTerm(const EC_POINT* point, const BIGNUM* scalar)
+    {
+        vPoints.push_back(EC_POINT_dup(point, group));
+        vScalars.push_back(BN_dup(scalar));
+    }
 
-            BN_free(coeff);
-        }
+private:
+    CBulletproofBatch(const CBulletproofBatch&);
+    CBulletproofBatch& operator=(const CBulletproofBatch&);
+};
 
-        {
-            CECPointGuard muG(group);
-            EC_POINT_mul(group, muG, NULL, G, mu, ctx);
-            EC_POINT_invert(group, muG, ctx);
-            EC_POINT_add(group, P, P, muG, ctx);
-        }
+static bool ReadBatchPoint(const EC_GROUP* group, const std::vector<unsigned char>& vch,
+                           size_t& offset, EC_POINT* point, BN_CTX* ctx)
+{
+    if (EC_POINT_oct2point(group, point, vch.data() + offset, 33, ctx) != 1)
+        return false;
+    if (EC_POINT_is_on_curve(group, point, ctx) != 1)
+        return false;
+    offset += 33;
+    return true;
+}
 
-        {
-            CECPointGuard tH(group);
-            EC_POINT_mul(group, tH, NULL, H, t_hat, ctx);
-            EC_POINT_add(group, P, P, tH, ctx);
-        }
+static bool ReadBatchScalar(const std::vector<unsigned char>& vch, size_t& offset,
+                            BIGNUM* scalar, const BIGNUM* order)
+{
+    if (!BN_bin2bn(vch.data() + offset, 32, scalar))
+        return false;
+    offset += 32;
+    return BN_cmp(scalar, order) < 0;
+}
 
-        CECPointGuard Plhs(group);
-        EC_POINT_copy(Plhs, P);
+// Parse one range proof, replay its transcript exactly as
+// VerifyBulletproofRangeProof does and fold both of its equations into the
+// batch. Returns false, leaving the batch untouched, for anything the batch
+// cannot represent (malformed encoding, a zero challenge); the caller then
+// leaves the verdict on that proof to VerifyBulletproofRangeProof.
+static bool AddBulletproofToBatch(CBulletproofBatch& batch,
+                                  const CPedersenCommitment& commit,
+                                  const CBulletproofRangeProof& proof)
+{
+    const int N = 64;
+    const int logN = 6;
+    const EC_GROUP* group = batch.group;
+    const BIGNUM* order = batch.order;
+    BN_CTX* ctx = batch.ctx;
+    const std::vector<unsigned char>& vch = proof.vchProof;
 
-        for (int round = 0; round < logN; round++)
-        {
-            BIGNUM* u2 = BN_new();
-            BN_mod_sqr(u2, vChallenge[round], order, ctx);
+    if (vch.size() > MAX_BULLETPROOF_PROOF_SIZE)
+        return false;
+    if (vch.size() < 4 * 33 + 3 * 32 + logN * 2 * 33 + 2 * 32)
+        return false;
 
-            BIGNUM* u_inv = BN_new();
-            BN_mod_inverse(u_inv, vChallenge[round], order, ctx);
-            BIGNUM* u_inv2 = BN_new();
-            BN_mod_sqr(u_inv2, u_inv, order, ctx);
+    CECPointGuard V(group), A(group), S(group), T1(group), T2(group);
+    if (!BytesToPoint(group, commit.vchCommitment, V, ctx))
+        return false;
 
-            CECPointGuard tmpL(group), tmpR(group);
-            EC_POINT_mul(group, tmpL, NULL, vL[round], u2, ctx);
-            EC_POINT_mul(group, tmpR, NULL, vR[round], u_inv2, ctx);
+    size_t offset = 0;
+    if (!ReadBatchPoint(group, vch, offset, A, ctx) ||
+        !ReadBatchPoint(group, vch, offset, S, ctx) ||
+        !ReadBatchPoint(group, vch, offset, T1, ctx) ||
+        !ReadBatchPoint(group, vch, offset, T2, ctx))
+        return false;
 
-            EC_POINT_add(group, Plhs, Plhs, tmpL, ctx);
-            EC_POINT_add(group, Plhs, Plhs, tmpR, ctx);
+    CBNGuard taux, mu, t_hat;
+    if (!ReadBatchScalar(vch, offset, taux, order) ||
+        !ReadBatchScalar(vch, offset, mu, order) ||
+        !ReadBatchScalar(vch, offset, t_hat, order))
+        return false;
 
-            BN_free(u2);
-            BN_free(u_inv);
-            BN_free(u_inv2);
-        }
+    std::vector<unsigned char> transcript;
+    const char* bpDomain = "Innova_Bulletproof_v1";
+    transcript.insert(transcript.end(), bpDomain, bpDomain + strlen(bpDomain));
+    unsigned char nBuf[4] = {(unsigned char)(N>>24),(unsigned char)(N>>16),(unsigned char)(N>>8),(unsigned char)N};
+    transcript.insert(transcript.end(), nBuf, nBuf + 4);
+    transcript.insert(transcript.end(), CZKContext::GetGeneratorG().begin(), CZKContext::GetGeneratorG().end());
+    transcript.insert(transcript.end(), CZKContext::GetGeneratorH().begin(), CZKContext::GetGeneratorH().end());
+    transcript.insert(transcript.end(), commit.vchCommitment.begin(), commit.vchCommitment.end());
+    AppendToTranscript(transcript, group, A, ctx);
+    AppendToTranscript(transcript, group, S, ctx);
 
-        CECPointGuard Pcheck(group);
-        EC_POINT_set_to_infinity(group, Pcheck);
+    CBNGuard y, z, x;
+    if (!FiatShamirChallenge(transcript, y, order, ctx))
+        return false;
+    AppendScalarToTranscript(transcript, y);
+    if (!FiatShamirChallenge(transcript, z, order, ctx))
+        return false;
+    AppendToTranscript(transcript, group, T1, ctx);
+    AppendToTranscript(transcript, group, T2, ctx);
+    if (!FiatShamirChallenge(transcript, x, order, ctx))
+        return false;
 
+    std::vector<CECPointGuard*> vL, vR;
+    std::vector<BIGNUM*> vU;
+    bool fOk = true;
+    for (int round = 0; round < logN && fOk; round++)
+    {
+        vL.push_back(new CECPointGuard(group));
+        vR.push_back(new CECPointGuard(group));
+        vU.push_back(BN_new());
+        fOk = ReadBatchPoint(group, vch, offset, *vL[round], ctx) &&
+              ReadBatchPoint(group, vch, offset, *vR[round], ctx);
+        if (!fOk)
+            break;
+        AppendToTranscript(transcript, group, *vL[round], ctx);
+        AppendToTranscript(transcript, group, *vR[round], ctx);
+        fOk = FiatShamirChallenge(transcript, vU[round], order, ctx);
+    }
+
+    CBNGuard a_final, b_final;
+    fOk = fOk && ReadBatchScalar(vch, offset, a_final, order)
+              && ReadBatchScalar(vch, offset, b_final, order);
+
+    if (fOk)
+    {
+        // Independent nonzero weights for the two equations of this proof.
+        CBNGuard c, d, tmp, tmp2, zero;
+        BN_zero(zero);
+        do { BN_rand_range(c, order); } while (BN_is_zero(c));
+        do { BN_rand_range(d, order); } while (BN_is_zero(d));
+
+        CBNGuard x2, z2, z3, y_inv;
+        BN_mod_sqr(x2, x, order, ctx);
+        BN_mod_sqr(z2, z, order, ctx);
+        BN_mod_mul(z3, z2, z, order, ctx);
+        BN_mod_inverse(y_inv, y, order, ctx);
+
+        // delta = (z - z^2)*sum(y^i) - z^3*sum(2^i)
+        CBNGuard sumYn, sum2n, yPow, twoPow, delta;
+        BN_zero(sumYn); BN_zero(sum2n);
+        BN_one(yPow); BN_one(twoPow);
         for (int i = 0; i < N; i++)
         {
-            BIGNUM* sG = BN_new(); BN_one(sG);
-            BIGNUM* sH = BN_new(); BN_one(sH);
+            BN_mod_add(sumYn, sumYn, yPow, order, ctx);
+            BN_mod_add(sum2n, sum2n, twoPow, order, ctx);
+            BN_mod_mul(yPow, yPow, y, order, ctx);
+            BN_mod_add(twoPow, twoPow, twoPow, order, ctx);
+        }
+        BN_mod_sub(tmp, z, z2, order, ctx);
+        BN_mod_mul(delta, tmp, sumYn, order, ctx);
+        BN_mod_mul(tmp, z3, sum2n, order, ctx);
+        BN_mod_sub(delta, delta, tmp, order, ctx);
+
+        // Equation (1), weight c.
+        BN_mod_mul(tmp, c, taux, order, ctx);
+        BN_mod_add(batch.gCoeff, batch.gCoeff, tmp, order, ctx);
+        BN_mod_sub(tmp, t_hat, delta, order, ctx);
+        BN_mod_mul(tmp, tmp, c, order, ctx);
+        BN_mod_add(batch.hCoeff, batch.hCoeff, tmp, order, ctx);
+        BN_mod_mul(tmp, c, z2, order, ctx);
+        BN_mod_sub(tmp, zero, tmp, order, ctx);
+        batch.AddTerm(V, tmp);
+        BN_mod_mul(tmp, c, x, order, ctx);
+        BN_mod_sub(tmp, zero, tmp, order, ctx);
+        batch.AddTerm(T1, tmp);
+        BN_mod_mul(tmp, c, x2, order, ctx);
+        BN_mod_sub(tmp, zero, tmp, order, ctx);
+        batch.AddTerm(T2, tmp);
+
+        // Equation (2), weight d.
+        batch.AddTerm(A, d);
+        BN_mod_mul(tmp, d, x, order, ctx);
+        batch.AddTerm(S, tmp);
+
+        BN_mod_mul(tmp, d, mu, order, ctx);
+        BN_mod_sub(batch.gCoeff, batch.gCoeff, tmp, order, ctx);
+        BN_mod_mul(tmp, a_final, b_final, order, ctx);
+        BN_mod_sub(tmp, t_hat, tmp, order, ctx);
+        BN_mod_mul(tmp, tmp, d, order, ctx);
+        BN_mod_add(batch.hCoeff, batch.hCoeff, tmp, order, ctx);
+
+        std::vector<BIGNUM*> vUInv(logN);
+        for (int j = 0; j < logN; j++)
+        {
+            vUInv[j] = BN_new();
+            BN_mod_inverse(vUInv[j], vU[j], order, ctx);
+
+            BN_mod_sqr(tmp, vU[j], order, ctx);
+            BN_mod_mul(tmp, tmp, d, order, ctx);
+            batch.AddTerm(*vL[j], tmp);
+            BN_mod_sqr(tmp, vUInv[j], order, ctx);
+            BN_mod_mul(tmp, tmp, d, order, ctx);
+            batch.AddTerm(*vR[j], tmp);
+        }
 
+        CBNGuard sG, sH, yInvPow, twoPowI;
+        BN_one(yInvPow);
+        BN_one(twoPowI);
+        for (int i = 0; i < N; i++)
+        {
+            // s_i is the product over rounds of u_j or u_j^-1 picked by the
+            // bits of i, most significant first; its inverse weights Hi.
+            BN_one(sG);
+            BN_one(sH);
             for (int j = 0; j < logN; j++)
             {
-                int bit = (i >> (logN - 1 - j)) & 1;
-                if (bit)
+                if ((i >> (logN - 1 - j)) & 1)
                 {
-                    BN_mod_mul(sG, sG, vChallenge[j], order, ctx);
-                    BIGNUM* u_inv = BN_new();
-                    BN_mod_inverse(u_inv, vChallenge[j], order, ctx);
-                    BN_mod_mul(sH, sH, u_inv, order, ctx);
-                    BN_free(u_inv);
+                    BN_mod_mul(sG, sG, vU[j], order, ctx);
+                    BN_mod_mul(sH, sH, vUInv[j], order, ctx);
                 }
                 else
                 {
-                    BIGNUM* u_inv = BN_new();
-                    BN_mod_inverse(u_inv, vChallenge[j], order, ctx);
-                    BN_mod_mul(sG, sG, u_inv, order, ctx);
-                    BN_free(u_inv);
-                    BN_mod_mul(sH, sH, vChallenge[j], order, ctx);
+                    BN_mod_mul(sG, sG, vUInv[j], order, ctx);
+                    BN_mod_mul(sH, sH, vU[j], order, ctx);
                 }
             }
 
-            BIGNUM* asG = BN_new();
-            BN_mod_mul(asG, a_final, sG, order, ctx);
-            CECPointGuard tmpPt(group);
-            EC_POINT_mul(group, tmpPt, NULL, vGi[i], asG, ctx);
-            EC_POINT_add(group, Pcheck, Pcheck, tmpPt, ctx);
+            // Gi: d*(-z - a*s_i)
+            BN_mod_mul(tmp, a_final, sG, order, ctx);
+            BN_mod_add(tmp, tmp, z, order, ctx);
+            BN_mod_mul(tmp, tmp, d, order, ctx);
+            BN_mod_sub(batch.vGiCoeff[i], batch.vGiCoeff[i], tmp, order, ctx);
+
+            // Hi: d*(z + (z^2*2^i - b*s_i^-1)*y^-i)
+            BN_mod_mul(tmp, z2, twoPowI, order, ctx);
+            BN_mod_mul(tmp2, b_final, sH, order, ctx);
+            BN_mod_sub(tmp, tmp, tmp2, order, ctx);
+            BN_mod_mul(tmp, tmp, yInvPow, order, ctx);
+            BN_mod_add(tmp, tmp, z, order, ctx);
+            BN_mod_mul(tmp, tmp, d, order, ctx);
+            BN_mod_add(batch.vHiCoeff[i], batch.vHiCoeff[i], tmp, order, ctx);
+
+            BN_mod_mul(yInvPow, yInvPow, y_inv, order, ctx);
+            BN_mod_add(twoPowI, twoPowI, twoPowI, order, ctx);
+        }
+        FreeScalars(vUInv);
+    }
 
-            BIGNUM* bsH = BN_new();
-            BN_mod_mul(bsH, b_final, sH, order, ctx);
-            BN_mod_mul(bsH, bsH, y_inv_n[i], order, ctx);
-            EC_POINT_mul(group, tmpPt, NULL, vHi[i], bsH, ctx);
-            EC_POINT_add(group, Pcheck, Pcheck, tmpPt, ctx);
+    for (size_t j = 0; j < vL.size(); j++)
+    {
+        delete vL[j];
+        delete vR[j];
+    }
+    FreeScalars(vU);
+    return fOk;
+}
 
-            BN_free(sG); BN_free(sH);
-            BN_free(asG); BN_free(bsH);
-        }
+bool BatchVerifyBulletproofRangeProofs(const std::vector<CPedersenCommitment>& vCommits,
+                                        const std::vector<CBulletproofRangeProof>& vProofs,
+                                        size_t* pnBadIndex)
+{
+    if (vCommits.size() != vProofs.size()) return false;
+    if (vProofs.empty()) return true;
+    if (!CZKContext::IsInitialized()) return false;
 
-        {
-            CECPointGuard abH(group);
-            EC_POINT_mul(group, abH, NULL, H, ab, ctx);
-            EC_POINT_add(group, Pcheck, Pcheck, abH, ctx);
-        }
+    const int N = 64;
 
-        if (EC_POINT_cmp(group, Plhs, Pcheck, ctx) != 0)
-            fValid = false;
+    CECGroupGuard group;
+    if (!group.group) return false;
 
-        BN_free(ab);
-        BN_clear_free(a_final);
-        BN_clear_free(b_final);
-        FreeBPGenerators(vGi, vHi);
+    CBNCtxGuard ctx;
+    if (!ctx.ctx) return false;
 
-        for (int i = 0; i < logN; i++)
-        {
-            EC_POINT_free(vL[i]);
-            EC_POINT_free(vR[i]);
-            BN_free(vChallenge[i]);
-        }
+    const BIGNUM* order = EC_GROUP_get0_order(group);
+
+    // Proofs the batch cannot represent are decided one at a time; the rest
+    // go into one multi-exponentiation.
+    CBulletproofBatch batch(group, order, ctx, N);
+    std::vector<size_t> vBatched, vSingle;
+    for (size_t i = 0; i < vProofs.size(); i++)
+    {
+        if (AddBulletproofToBatch(batch, vCommits[i], vProofs[i]))
+            vBatched.push_back(i);
+        else
+            vSingle.push_back(i);
     }
 
-    BN_clear_free(taux);
-    BN_clear_free(mu);
-    BN_free(t_hat);
-    BN_free(y); BN_free(z);
-    BN_free(x); BN_free(x2);
-    BN_free(z2); BN_free(z3);
-    BN_free(delta); BN_free(sumYn); BN_free(sum2n);
-    BN_free(tmp);
-    FreeScalars(yn); FreeScalars(twon);
-    FreeScalars(y_inv_n);
+    bool fBatchOk = true;
+    if (!vBatched.empty())
+    {
+        const CMSMFixedBase* pGens = GetBPRangeGenerators(group, ctx);
+        if (!pGens || pGens->size() != 2 + 2 * (size_t)N)
+            return false;
 
-    return fValid;
-}
+        std::vector<BIGNUM*> vGenScalars;
+        vGenScalars.push_back(batch.gCoeff);
+        vGenScalars.push_back(batch.hCoeff);
+        for (int i = 0; i < N; i++)
+        {
+            vGenScalars.push_back(batch.vGiCoeff[i]);
+            vGenScalars.push_back(batch.vHiCoeff[i]);
+        }
 
-bool BatchVerifyBulletproofRangeProofs(const std::vector<CPedersenCommitment>& vCommits,
-                                        const std::vector<CBulletproofRangeProof>& vProofs)
-{
-    if (vCommits.size() != vProofs.size()) return false;
+        CECPointGuard result(group), genSum(group);
+        fBatchOk = MultiScalarMul(group, ctx, batch.vPoints, batch.vScalars, result, nMSMThreads) &&
+                   pGens->Mul(group, ctx, vGenScalars, genSum, nMSMThreads) &&
+                   EC_POINT_add(group, result, result, genSum, ctx) == 1 &&
+                   EC_POINT_is_at_infinity(group, result) == 1;
+    }
+
+    if (fBatchOk)
+    {
+        for (size_t k = 0; k < vSingle.size(); k++)
+        {
+            if (!VerifyBulletproofRangeProof(vCommits[vSingle[k]], vProofs[vSingle[k]]))
+            {
+                if (pnBadIndex)
+                    *pnBadIndex = vSingle[k];
+                return false;
+            }
+        }
+        return true;
+    }
 
-    for (size_t i = 0; i < vCommits.size(); i++)
+    // The batch only says that something is wrong; walk the proofs in order
+    // so the reported index is the first proof the serial verifier rejects.
+    for (size_t i = 0; i < vProofs.size(); i++)
     {
         if (!VerifyBulletproofRangeProof(vCommits[i], vProofs[i]))
+        {
+            if (pnBadIndex)
+                *pnBadIndex = i;
             return false;
+        }
     }
 
+    // Every proof passes on its own, so the batch failure came from an
+    // internal error rather than a bad proof.
+    if (fDebug)
+        printf("BatchVerifyBulletproofRangeProofs() : batch of %u failed but all proofs verify individually\n",
+               (unsigned int)vProofs.size());
     return true;
 }
 
+void CRangeProofBatch::Add(const CPedersenCommitment& commit, const CBulletproofRangeProof& proof,
+                           unsigned int nTx, const std::string& strDescription)
+{
+    vCommits.push_back(commit);
+    vProofs.push_back(proof);
+    vTx.push_back(nTx);
+    vDescription.push_back(strDescription);
+}
+
+bool CRangeProofBatch::Verify(size_t& nBadOut) const
+{
+    return BatchVerifyBulletproofRangeProofs(vCommits, vProofs, &nBadOut);
+}
+
 
 bool CreateBindingSignature(const std::vector<std::vector<unsigned char>>& vInputBlinds,
                              const std::vector<std::vector<unsigned char>>& vOutputBlinds,
@@ -3061,50 +3395,62 @@ bool VerifyHalfAggStakeSignature(const std::vector<std::vector<unsigned char> >&
     if (!BN_bin2bn(vchAggregatedSScalar.data(), 32, sAgg)) { strError = "bad aggregated s-scalar"; return false; }
     if (BN_is_negative(sAgg) || BN_cmp(sAgg, order) >= 0) { strError = "s-scalar out of range"; return false; }
 
-    // RLC half-agg verify: lhs = Sum_j rho_j*R_j ; rhs = s_agg*G + Sum_j (rho_j*e_j)*pk_j
-    CECPointGuard lhs(group);
-    EC_POINT_set_to_infinity(group, lhs);
-    CECPointGuard rhs(group);
-    if (!EC_POINT_mul(group, rhs, NULL, G, sAgg, ctx)) { strError = "s_agg*G failed"; return false; }
+    // RLC half-agg verify: Sum_j rho_j*R_j == s_agg*G + Sum_j (rho_j*e_j)*pk_j,
+    // checked as one multiplication of 2M+1 terms that must be the identity
+    std::vector<EC_POINT*> vPoints;
+    std::vector<BIGNUM*> vScalars;
+    vPoints.push_back(EC_POINT_dup(G, group));
+    vScalars.push_back(BN_new());
+    BN_sub(vScalars[0], order, sAgg);
 
-    for (size_t j = 0; j < M; j++)
+    for (size_t j = 0; j < M && strError.empty(); j++)
     {
-        if (vSignerPubKeys[j].size() != 33) { strError = "signer pubkey must be 33 bytes"; return false; }
-        if (vSignerRPoints[j].size() != 33) { strError = "R-point must be 33 bytes"; return false; }
+        if (vSignerPubKeys[j].size() != 33) { strError = "signer pubkey must be 33 bytes"; break; }
+        if (vSignerRPoints[j].size() != 33) { strError = "R-point must be 33 bytes"; break; }
 
-        CECPointGuard pk(group), R(group);
+        EC_POINT* pk = EC_POINT_new(group);
+        EC_POINT* R = EC_POINT_new(group);
+        vPoints.push_back(pk);
+        vPoints.push_back(R);
         if (EC_POINT_oct2point(group, pk, vSignerPubKeys[j].data(), 33, ctx) != 1 ||
             EC_POINT_is_at_infinity(group, pk) ||
             EC_POINT_is_on_curve(group, pk, ctx) != 1)
-        { strError = "invalid signer pubkey"; return false; }
+        { strError = "invalid signer pubkey"; break; }
         if (EC_POINT_oct2point(group, R, vSignerRPoints[j].data(), 33, ctx) != 1 ||
             EC_POINT_is_at_infinity(group, R) ||
             EC_POINT_is_on_curve(group, R, ctx) != 1)
-        { strError = "invalid R-point"; return false; }
+        { strError = "invalid R-point"; break; }
 
         CBNGuard e;
         if (!HalfAggStakeChallenge(vSignerRPoints[j].data(), vSignerPubKeys[j].data(), sighash, group, ctx, e))
-        { strError = "challenge computation failed"; return false; }
+        { strError = "challenge computation failed"; break; }
 
         // RLC coefficient rho_j binds signer j's term to the full ordered (R,pk) transcript.
-        CBNGuard rho;
+        BIGNUM* rho = BN_new();
+        BIGNUM* negRhoE = BN_new();
+        vScalars.push_back(negRhoE);
+        vScalars.push_back(rho);
         if (!HalfAggStakeRLCCoeff(j, M, vSignerRPoints, vSignerPubKeys, sighash, order, ctx, rho))
-        { strError = "rlc coefficient failed"; return false; }
-
-        // rhs += (rho_j * e_j) * pk_j
-        CBNGuard rhoE;
-        BN_mod_mul(rhoE, rho, e, order, ctx);
-        CECPointGuard ePk(group);
-        if (!EC_POINT_mul(group, ePk, NULL, pk, rhoE, ctx)) { strError = "e*pk failed"; return false; }
-        if (!EC_POINT_add(group, rhs, rhs, ePk, ctx)) { strError = "rhs add failed"; return false; }
-        // lhs += rho_j * R_j
-        CECPointGuard rhoR(group);
-        if (!EC_POINT_mul(group, rhoR, NULL, R, rho, ctx)) { strError = "rho*R failed"; return false; }
-        if (!EC_POINT_add(group, lhs, lhs, rhoR, ctx)) { strError = "lhs add failed"; return false; }
-    }
-
-    bool fValid = (EC_POINT_cmp(group, lhs, rhs, ctx) == 0);
-    if (!fValid) strError = "half-aggregated signature verification failed";
+        { strError = "rlc coefficient failed"; break; }
+
+        // pk_j takes -(rho_j * e_j), R_j takes rho_j
+        BN_mod_mul(negRhoE, rho, e, order, ctx);
+        BN_sub(negRhoE, order, negRhoE);
+    }
+
+    bool fValid = false;
+    if (strError.empty())
+    {
+        CECPointGuard result(group);
+        if (!MultiScalarMul(group, ctx, vPoints, vScalars, result))
+            strError = "multi-scalar multiplication failed";
+        else if (!(fValid = EC_POINT_is_at_infinity(group, result) == 1))
+            strError = "half-aggregated signature verification failed";
+    }
+
+    for (size_t i = 0; i < vPoints.size(); i++)
+        EC_POINT_free(vPoints[i]);
+    FreeScalars(vScalars);
     return fValid;
 }
 
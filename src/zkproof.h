@@ -9,6 +9,7 @@
 #include "serialize.h"
 #include "sync.h"
 
+#include <string>
 #include <vector>
 #include <stdint.h>
 #include <boost/thread/once.hpp>
@@ -131,8 +132,33 @@ bool CreateBulletproofRangeProof(int64_t nValue,
 bool VerifyBulletproofRangeProof(const CPedersenCommitment& commit,
                                   const CBulletproofRangeProof& proof);
 
+// Verify a set of range proofs as one random linear combination, evaluated
+// with a single multi-scalar multiplication. If the batch fails the proofs
+// are re-checked one at a time and pnBadIndex (if given) receives the index of
+// the first one VerifyBulletproofRangeProof rejects.
 bool BatchVerifyBulletproofRangeProofs(const std::vector<CPedersenCommitment>& vCommits,
-                                        const std::vector<CBulletproofRangeProof>& vProofs);
+                                        const std::vector<CBulletproofRangeProof>& vProofs,
+                                        size_t* pnBadIndex = NULL);
+
+// Range proofs collected while validating a transaction or a whole block, so
+// they can be verified in one batch once the cheaper checks have passed.
+class CRangeProofBatch
+{
+public:
+    std::vector<CPedersenCommitment> vCommits;
+    std::vector<CBulletproofRangeProof> vProofs;
+    std::vector<unsigned int> vTx;              // position of the owning tx in its block
+    std::vector<std::string> vDescription;      // what the proof covers, for error messages
+
+    void Add(const CPedersenCommitment& commit, const CBulletproofRangeProof& proof,
+             unsigned int nTx, const std::string& strDescription);
+
+    bool IsEmpty() const { return vProofs.empty(); }
+    size_t Size() const { return vProofs.size(); }
+
+    // False if any proof is invalid; nBadOut is then the first such entry.
+    bool Verify(size_t& nBadOut) const;
+};
 
 
 class CBindingSignature